@@ -11,7 +11,10 @@ CPP_SRCS += \
 ../src/BusDevice.cpp \
 ../src/Capteur.cpp \
 ../src/GPIO.cpp \
+../src/GPIOChip.cpp \
 ../src/I2CDevice.cpp \
+../src/MQTTPublisher.cpp \
+../src/MiWiGateway.cpp \
 ../src/US2066.cpp \
 ../src/util.cpp 
 
@@ -20,7 +23,10 @@ OBJS += \
 ./src/BusDevice.o \
 ./src/Capteur.o \
 ./src/GPIO.o \
+./src/GPIOChip.o \
 ./src/I2CDevice.o \
+./src/MQTTPublisher.o \
+./src/MiWiGateway.o \
 ./src/US2066.o \
 ./src/bme280.o \
 ./src/util.o 
@@ -33,7 +39,10 @@ CPP_DEPS += \
 ./src/BusDevice.d \
 ./src/Capteur.d \
 ./src/GPIO.d \
+./src/GPIOChip.d \
 ./src/I2CDevice.d \
+./src/MQTTPublisher.d \
+./src/MiWiGateway.d \
 ./src/US2066.d \
 ./src/util.d 
 
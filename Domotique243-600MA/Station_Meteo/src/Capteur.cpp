@@ -13,6 +13,12 @@
 #include"BME280_BB.h"
 #include <fstream>		// Pour l'utilisation des fichiers
 #include <string>		// Pour l'utilisation des objets string du C++
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <time.h>
+#include"MQTTPublisher.h"
+#include"MiWiGateway.h"
 
 using namespace std;
 
@@ -22,8 +28,67 @@ using namespace std;
 #define CHEMIN_FICHIER_TXT "/home/debian/243-510-A16/Domotique243-600MA/"
 #define NOM_FICHIER_TXT "FICHIER_TEXT.txt"
 
+#define NOM_FICHIER_SPOOL "Spool_MQTT.log"	// Mesures en attente du serveur MQTT
+#define MQTT_CLIENT_ID "Station_Meteo"
+#define MQTT_SUJET "classe/bme280"
+#define PERIODE_MESURE 30		// Secondes entre deux mesures en mode MQTT
+
+/**
+ * Mode MQTT: garde une connexion ouverte avec le serveur et publie une mesure
+ * a chaque PERIODE_MESURE secondes. Les mesures sont gardees dans le fichier
+ * NOM_FICHIER_SPOOL tant que le serveur n'est pas joignable.
+ * @param Serveur	Nom ou adresse du serveur MQTT
+ */
+static int Boucle_MQTT(const char *Serveur){
+	exploringBB::MQTTPublisher Publieur(Serveur, MQTT_CLIENT_ID, string(CHEMIN) + NOM_FICHIER_SPOOL);
+	char Tampon_Ecran[21];
+	int32_t Temperature;
+	uint32_t Humidite;
+	uint32_t Pression;
+
+	BME280_Initialiser();
+	US2066_Initialiser();
+
+	while(1){
+		bme280_set_power_mode(BME280_FORCED_MODE);
+		usleep(10 * 1000);
+		bme280_read_pressure_temperature_humidity(&Pression, &Temperature, &Humidite);
+
+		float Pression2 = (float)Pression / 1000;
+		float Temperature2 = (float)Temperature / 100;
+		float Humidite2 = (float)Humidite / 1024;
+
+		sprintf(Tampon_Ecran, "Temperature: %5.1f",Temperature2);
+		US2066_Afficher_Texte(Tampon_Ecran,0,0);
+		sprintf(Tampon_Ecran, "Humidite: %5.1f",Humidite2);
+		US2066_Afficher_Texte(Tampon_Ecran,1,0);
+		sprintf(Tampon_Ecran, "Pression: %5.1f",Pression2);
+		US2066_Afficher_Texte(Tampon_Ecran,2,0);
+
+		// Meme format que Donnee_BME280.json, avec l'heure de la mesure
+		ostringstream Message;
+		Message << "{\"Temps\":" << time(NULL) << ",\"Temp\":" << Temperature2
+				<< ",\"Humidite\":" << Humidite2 << ",\"Pres\":" << Pression2 << "}";
+		Publieur.publish(MQTT_SUJET, Message.str());
+
+		// Attendre la prochaine mesure en servant la connexion
+		for(int i = 0; i < PERIODE_MESURE; i++){
+			if(Publieur.loop(1000) != 0) sleep(1);
+		}
+	}
+	return 0;
+}
+
+
+int main(int argc, char *argv[]){            //PROGRAME MAIN
 
-int main(void){            //PROGRAME MAIN
+	// Capteur --mqtt <serveur> : mesures en continu publiees par MQTT
+	if(argc > 2 && strcmp(argv[1], "--mqtt") == 0) return Boucle_MQTT(argv[2]);
+	// Capteur --passerelle <port serie> [port TCP] : relais entre le reseau MiWi et les clients TCP
+	if(argc > 2 && strcmp(argv[1], "--passerelle") == 0){
+		exploringBB::MiWiGateway Passerelle(argv[2], argc > 3 ? atoi(argv[3]) : GW_PORT);
+		return Passerelle.run();
+	}
 
 	char Tampon_Ecran[21];
 
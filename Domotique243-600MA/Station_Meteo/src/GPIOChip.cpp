@@ -0,0 +1,314 @@
+/*
+ * GPIOChip.cpp
+ *
+ * Character-device GPIO backend, see GPIOChip.h.
+ */
+
+#include "GPIOChip.h"
+#include<sstream>
+#include<string>
+#include<cstdio>
+#include<cstring>
+#include<cerrno>
+#include<stdint.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#include<sys/epoll.h>
+#include<sys/eventfd.h>
+using namespace std;
+
+namespace exploringBB {
+
+/**
+ * Private helper that opens /dev/gpiochipN.
+ * @param chip The chip number
+ * @return the file handle or -1 on failure
+ */
+static int openChip(int chip){
+	ostringstream s;
+	s << GPIOCHIP_PATH << chip;
+	int fd = ::open(s.str().c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) perror("GPIOChip: Failed to open the chip");
+	return fd;
+}
+
+/**
+ * The constructor requests the lines from the kernel. The handle stays open until
+ * the object is destroyed, so no per-access open/close is needed.
+ * @param chip The chip number e.g. 1 for /dev/gpiochip1
+ * @param offsets The line offsets on the chip
+ * @param count The number of offsets (at most GPIOHANDLES_MAX)
+ * @param direction INPUT or OUTPUT for all the lines
+ * @param activeLow Invert the logical value of the lines
+ */
+GPIOLines::GPIOLines(int chip, const unsigned int *offsets, unsigned int count,
+		GPIO::DIRECTION direction, bool activeLow) {
+	this->chip = chip;
+	this->fd = -1;
+	this->count = count;
+	this->direction = direction;
+	memset(&this->values, 0, sizeof(this->values));
+	if (count == 0 || count > GPIOHANDLES_MAX){
+		fprintf(stderr, "GPIOChip: Invalid number of lines (%u)\n", count);
+		this->count = 0;
+		return;
+	}
+
+	struct gpiohandle_request req;
+	memset(&req, 0, sizeof(req));
+	for (unsigned int i=0; i<count; i++) req.lineoffsets[i] = offsets[i];
+	req.lines = count;
+	req.flags = (direction == GPIO::OUTPUT) ? GPIOHANDLE_REQUEST_OUTPUT : GPIOHANDLE_REQUEST_INPUT;
+	if (activeLow) req.flags |= GPIOHANDLE_REQUEST_ACTIVE_LOW;
+	strncpy(req.consumer_label, GPIOCHIP_CONSUMER, sizeof(req.consumer_label)-1);
+
+	int chipfd = openChip(chip);
+	if (chipfd < 0) return;
+	if (ioctl(chipfd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0){
+		perror("GPIOChip: Failed to request the lines");
+	}
+	else this->fd = req.fd;
+	close(chipfd);
+}
+
+/**
+ * Write all the lines of the handle with a single ioctl.
+ * @param values One value per line, in the order of the offsets
+ * @return 0 on success, -1 on failure
+ */
+int GPIOLines::setValues(const GPIO::VALUE *values){
+	if (this->direction != GPIO::OUTPUT) return -1;
+	for (unsigned int i=0; i<this->count; i++) this->values.values[i] = (values[i] == GPIO::HIGH);
+	if (ioctl(this->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &this->values) < 0){
+		perror("GPIOChip: Failed to set the line values");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Read all the lines of the handle with a single ioctl.
+ * @param values Receives one value per line, in the order of the offsets
+ * @return 0 on success, -1 on failure
+ */
+int GPIOLines::getValues(GPIO::VALUE *values){
+	if (ioctl(this->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &this->values) < 0){
+		perror("GPIOChip: Failed to get the line values");
+		return -1;
+	}
+	for (unsigned int i=0; i<this->count; i++) values[i] = this->values.values[i] ? GPIO::HIGH : GPIO::LOW;
+	return 0;
+}
+
+/**
+ * Write a single line. The other output lines of the handle are rewritten with
+ * their last value, which the kernel does in the same ioctl.
+ */
+int GPIOLines::setValue(unsigned int index, GPIO::VALUE value){
+	if (index >= this->count || this->direction != GPIO::OUTPUT) return -1;
+	this->values.values[index] = (value == GPIO::HIGH);
+	if (ioctl(this->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &this->values) < 0){
+		perror("GPIOChip: Failed to set the line value");
+		return -1;
+	}
+	return 0;
+}
+
+GPIO::VALUE GPIOLines::getValue(unsigned int index){
+	if (index >= this->count) return GPIO::LOW;
+	// Outputs are driven by us, no need to ask the kernel
+	if (this->direction == GPIO::INPUT &&
+			ioctl(this->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &this->values) < 0){
+		perror("GPIOChip: Failed to get the line value");
+	}
+	return this->values.values[index] ? GPIO::HIGH : GPIO::LOW;
+}
+
+int GPIOLines::toggleOutput(unsigned int index){
+	if (index >= this->count) return -1;
+	return this->setValue(index, this->values.values[index] ? GPIO::LOW : GPIO::HIGH);
+}
+
+GPIOLines::~GPIOLines() {
+	if (this->fd >= 0) close(this->fd);
+}
+
+/**
+ * The constructor creates the epoll instance shared by all the lines.
+ */
+GPIOEventLoop::GPIOEventLoop() {
+	this->threadRunning = false;
+	pthread_mutex_init(&this->lock, NULL);
+	this->epollfd = epoll_create1(EPOLL_CLOEXEC);
+	if (this->epollfd == -1) perror("GPIOChip: Failed to create epollfd");
+	this->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (this->wakefd == -1) perror("GPIOChip: Failed to create the wake eventfd");
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;  // NULL marks the wake handle
+	if (this->epollfd != -1 && this->wakefd != -1 &&
+			epoll_ctl(this->epollfd, EPOLL_CTL_ADD, this->wakefd, &ev) == -1){
+		perror("GPIOChip: Failed to add the wake handle");
+	}
+}
+
+/**
+ * Request edge events on a line and register it on the loop. Can be called while
+ * the loop is running.
+ * @param chip The chip number
+ * @param offset The line offset on the chip
+ * @param edge RISING, FALLING or BOTH
+ * @param callback Called from the loop for each edge
+ * @param context Passed back to the callback
+ * @param debounceTime Edges closer than this (ms) to the previous one are dropped
+ * @return 0 on success, -1 on failure
+ */
+int GPIOEventLoop::addLine(int chip, unsigned int offset, GPIO::EDGE edge,
+		EdgeCallbackType callback, void *context, int debounceTime){
+	struct gpioevent_request req;
+	memset(&req, 0, sizeof(req));
+	req.lineoffset = offset;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	switch(edge){
+	case GPIO::RISING: req.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+		break;
+	case GPIO::FALLING: req.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+		break;
+	case GPIO::BOTH: req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+		break;
+	default: return -1;
+	}
+	strncpy(req.consumer_label, GPIOCHIP_CONSUMER, sizeof(req.consumer_label)-1);
+
+	int chipfd = openChip(chip);
+	if (chipfd < 0) return -1;
+	int result = ioctl(chipfd, GPIO_GET_LINEEVENT_IOCTL, &req);
+	close(chipfd);
+	if (result < 0){
+		perror("GPIOChip: Failed to request the line events");
+		return -1;
+	}
+	fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+
+	Watch *watch = new Watch;
+	watch->fd = req.fd;
+	watch->chip = chip;
+	watch->offset = offset;
+	watch->callback = callback;
+	watch->context = context;
+	watch->debounce = (unsigned long long) debounceTime * 1000000ULL;
+	watch->lastEvent = 0;
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = watch;
+	pthread_mutex_lock(&this->lock);
+	if (epoll_ctl(this->epollfd, EPOLL_CTL_ADD, watch->fd, &ev) == -1){
+		pthread_mutex_unlock(&this->lock);
+		perror("GPIOChip: Failed to add the line to epoll");
+		close(watch->fd);
+		delete watch;
+		return -1;
+	}
+	this->watches.push_back(watch);
+	pthread_mutex_unlock(&this->lock);
+	return 0;
+}
+
+/**
+ * Private method that drains the pending events of a line and calls back.
+ */
+void GPIOEventLoop::handle(Watch *watch){
+	struct gpioevent_data events[GPIOCHIP_MAX_EVENTS];
+	ssize_t n;
+	for (;;){
+		n = ::read(watch->fd, events, sizeof(events));
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) break;   // EAGAIN: drained
+		for (unsigned int i=0; i < n / sizeof(struct gpioevent_data); i++){
+			if (watch->lastEvent != 0 &&
+					events[i].timestamp - watch->lastEvent < watch->debounce) continue;
+			watch->lastEvent = events[i].timestamp;
+			GPIO::EDGE edge = (events[i].id == GPIOEVENT_EVENT_RISING_EDGE) ? GPIO::RISING : GPIO::FALLING;
+			watch->callback(watch->chip, watch->offset, edge, events[i].timestamp, watch->context);
+		}
+	}
+}
+
+/**
+ * Wait for edges on any registered line and dispatch them. A signal delivered
+ * to the thread restarts the wait. When stop() wakes the loop, the line events
+ * returned in the same batch are still dispatched before returning -1.
+ * @param timeout Maximum wait in ms, -1 to wait forever
+ * @return the number of lines that had events, 0 on timeout, -1 on failure or stop()
+ */
+int GPIOEventLoop::dispatch(int timeout){
+	struct epoll_event events[GPIOCHIP_MAX_EVENTS];
+	int n;
+	do {
+		n = epoll_wait(this->epollfd, events, GPIOCHIP_MAX_EVENTS, timeout);
+	} while (n == -1 && errno == EINTR);
+	if (n == -1){
+		perror("GPIOChip: Poll Wait fail");
+		return -1;
+	}
+	int handled = 0;
+	bool woken = false;
+	for (int i=0; i<n; i++){
+		if (events[i].data.ptr == NULL){  // woken up by stop()
+			woken = true;
+			continue;
+		}
+		this->handle(static_cast<Watch*>(events[i].data.ptr));
+		handled++;
+	}
+	if (woken) return -1;
+	return handled;
+}
+
+// This thread function is a friend function of the class
+void* threadedEventLoop(void *value){
+	GPIOEventLoop *loop = static_cast<GPIOEventLoop*>(value);
+	while(loop->threadRunning){
+		if (loop->dispatch(-1) == -1) break;
+	}
+	return 0;
+}
+
+int GPIOEventLoop::start(){
+	if (this->threadRunning) return 0;
+	this->threadRunning = true;
+	if(pthread_create(&this->thread, NULL, &threadedEventLoop, static_cast<void*>(this))){
+		perror("GPIOChip: Failed to create the event loop thread");
+		this->threadRunning = false;
+		return -1;
+	}
+	return 0;
+}
+
+void GPIOEventLoop::stop(){
+	uint64_t one = 1;
+	if (!this->threadRunning) return;
+	this->threadRunning = false;
+	if (::write(this->wakefd, &one, sizeof(one)) != sizeof(one)){
+		perror("GPIOChip: Failed to wake the event loop");
+	}
+	pthread_join(this->thread, NULL);
+	// consume the wake-up so dispatch() can be used again
+	if (::read(this->wakefd, &one, sizeof(one)) < 0) one = 0;
+}
+
+GPIOEventLoop::~GPIOEventLoop() {
+	this->stop();
+	for (unsigned int i=0; i<this->watches.size(); i++){
+		close(this->watches[i]->fd);
+		delete this->watches[i];
+	}
+	if (this->wakefd != -1) close(this->wakefd);
+	if (this->epollfd != -1) close(this->epollfd);
+	pthread_mutex_destroy(&this->lock);
+}
+
+} /* namespace exploringBB */
@@ -0,0 +1,109 @@
+/*
+ * @file GPIOChip.h
+ *
+ * Character-device (/dev/gpiochipN) backend for the GPIO pins. Unlike the
+ * sysfs GPIO class, the lines are requested once and the file handle is kept
+ * open for the lifetime of the object, so no export delay and no
+ * open/write/close per access. Edge events for all the pins are dispatched
+ * by a single epoll loop instead of one thread per pin.
+ *
+ * Uses the GPIO uAPI v1 (linux/gpio.h, kernel 4.8 and up).
+ */
+
+#ifndef GPIOCHIP_H_
+#define GPIOCHIP_H_
+#include<vector>
+#include<pthread.h>
+#include<linux/gpio.h>
+#include"GPIO.h"
+
+#define GPIOCHIP_PATH "/dev/gpiochip"
+#define GPIOCHIP_CONSUMER "Station_Meteo"
+#define GPIOCHIP_MAX_EVENTS 16
+
+namespace exploringBB {
+
+/**
+ * Callback for an edge event.
+ * @param chip The chip number of the line
+ * @param offset The line offset on the chip
+ * @param edge RISING or FALLING
+ * @param timestamp Kernel timestamp of the edge in nanoseconds
+ * @param context The pointer that was given to GPIOEventLoop::addLine()
+ */
+typedef void (*EdgeCallbackType)(int chip, unsigned int offset, GPIO::EDGE edge,
+		unsigned long long timestamp, void *context);
+
+/**
+ * @class GPIOLines
+ * @brief Persistent handle on one or more lines of a GPIO chip. All the lines of
+ * the handle are read or written with a single ioctl.
+ */
+class GPIOLines {
+private:
+	int chip;                       /**< The chip number e.g. 1 for /dev/gpiochip1 */
+	int fd;                         /**< The line handle returned by the kernel */
+	unsigned int count;             /**< The number of lines in the handle */
+	GPIO::DIRECTION direction;      /**< The direction requested for all the lines */
+	struct gpiohandle_data values;  /**< Last values written or read */
+
+public:
+	GPIOLines(int chip, const unsigned int *offsets, unsigned int count,
+			GPIO::DIRECTION direction, bool activeLow=false);
+	virtual int getChip() { return chip; }
+	virtual unsigned int getCount() { return count; }
+	virtual bool isOpen() { return fd >= 0; }
+
+	// Batched access: one ioctl for all the lines of the handle
+	virtual int setValues(const GPIO::VALUE *values);
+	virtual int getValues(GPIO::VALUE *values);
+
+	// Single line access, index is the position of the line in the handle
+	virtual int setValue(unsigned int index, GPIO::VALUE value);
+	virtual GPIO::VALUE getValue(unsigned int index);
+	virtual int toggleOutput(unsigned int index);
+
+	virtual ~GPIOLines();  //destructor will release the lines
+};
+
+/**
+ * @class GPIOEventLoop
+ * @brief Single epoll reactor that waits for edge events on any number of lines and
+ * calls back with the kernel timestamp of each edge. The loop can run in its own
+ * thread with start() or be driven from the caller with dispatch().
+ */
+class GPIOEventLoop {
+public:
+	GPIOEventLoop();
+	virtual int addLine(int chip, unsigned int offset, GPIO::EDGE edge,
+			EdgeCallbackType callback, void *context=NULL, int debounceTime=0);
+	virtual int dispatch(int timeout=-1); // wait and dispatch once, timeout in ms
+	virtual int start();                  // threaded dispatch
+	virtual void stop();
+	virtual ~GPIOEventLoop();
+
+private:
+	struct Watch {
+		int fd;                         /**< The event handle returned by the kernel */
+		int chip;
+		unsigned int offset;
+		EdgeCallbackType callback;
+		void *context;
+		unsigned long long debounce;    /**< The debounce time in nanoseconds */
+		unsigned long long lastEvent;   /**< Timestamp of the last edge delivered */
+	};
+	int epollfd;
+	int wakefd;                         /**< eventfd used by stop() to wake the loop */
+	std::vector<Watch*> watches;
+	pthread_mutex_t lock;
+	pthread_t thread;
+	bool threadRunning;
+	void handle(Watch *watch);
+	friend void* threadedEventLoop(void *value);
+};
+
+void* threadedEventLoop(void *value);
+
+} /* namespace exploringBB */
+
+#endif /* GPIOCHIP_H_ */
@@ -0,0 +1,441 @@
+/*
+ * MQTTPublisher.cpp
+ *
+ * Minimal MQTT 3.1.1 publisher, see MQTTPublisher.h.
+ */
+
+#include "MQTTPublisher.h"
+#include<fstream>
+#include<sstream>
+#include<algorithm>
+#include<cstdio>
+#include<cstring>
+#include<errno.h>
+#include<netdb.h>
+#include<poll.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/time.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+using namespace std;
+
+// MQTT control packet types (high nibble of the fixed header)
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     2
+#define MQTT_PUBLISH_QOS1 0x32
+#define MQTT_PUBLISH_DUP 0x08
+#define MQTT_PUBACK      4
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    13
+#define MQTT_DISCONNECT  0xE0
+
+namespace exploringBB {
+
+/**
+ * Private helper, seconds from a clock that is not changed by NTP.
+ */
+static time_t now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/**
+ * Private helpers that append the MQTT encodings to a packet.
+ */
+static void putLength(string &out, unsigned int length){
+	do {
+		unsigned char digit = length % 128;
+		length /= 128;
+		if (length > 0) digit |= 0x80;
+		out += (char) digit;
+	} while (length > 0);
+}
+
+static void putShort(string &out, unsigned short value){
+	out += (char)(value >> 8);
+	out += (char)(value & 0xFF);
+}
+
+static void putString(string &out, const string &value){
+	putShort(out, value.size());
+	out += value;
+}
+
+/**
+ * The constructor doesn't connect, the first publish() or loop() will.
+ * @param host The broker name or address
+ * @param clientId The MQTT client identifier
+ * @param spoolPath File that keeps the messages while the broker is unreachable
+ * @param port The broker TCP port
+ */
+MQTTPublisher::MQTTPublisher(string host, string clientId, string spoolPath, int port) {
+	this->host = host;
+	this->port = port;
+	this->clientId = clientId;
+	this->spoolPath = spoolPath;
+	this->socket = -1;
+	this->connected = false;
+	this->nextId = 0;
+	this->lastSend = 0;
+	this->pingSent = 0;
+	this->oldestQueued = 0;
+	this->nextRetry = 0;
+	this->retryDelay = MQTT_RETRY_DELAY;
+}
+
+/**
+ * Open the connection and replay the spooled messages. Does nothing until the
+ * reconnection delay has expired after a failure.
+ * @return 0 when connected, -1 otherwise
+ */
+int MQTTPublisher::connect(){
+	if (this->connected) return 0;
+	if (now() < this->nextRetry) return -1;
+
+	struct addrinfo hints, *result, *rp;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	ostringstream service;
+	service << this->port;
+	if (getaddrinfo(this->host.c_str(), service.str().c_str(), &hints, &result) != 0){
+		fprintf(stderr, "MQTT: Failed to resolve %s\n", this->host.c_str());
+		result = NULL;
+	}
+	for (rp = result; rp != NULL; rp = rp->ai_next){
+		this->socket = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (this->socket == -1) continue;
+		struct timeval tv = { MQTT_ACK_TIMEOUT, 0 };
+		setsockopt(this->socket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		if (::connect(this->socket, rp->ai_addr, rp->ai_addrlen) == 0) break;
+		::close(this->socket);
+		this->socket = -1;
+	}
+	if (result != NULL) freeaddrinfo(result);
+
+	if (this->socket != -1){
+		// The batches are assembled here, no need for Nagle on top
+		int one = 1;
+		setsockopt(this->socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		string packet, body;
+		putString(body, "MQTT");
+		body += (char) 4;     // protocol level 3.1.1
+		body += (char) 0x02;  // clean session, unacked messages are resent by us
+		putShort(body, MQTT_KEEP_ALIVE);
+		putString(body, this->clientId);
+		packet += (char) MQTT_CONNECT;
+		putLength(packet, body.size());
+		packet += body;
+		this->rxBuffer.clear();
+		if (this->sendAll(packet) == 0){
+			time_t deadline = now() + MQTT_ACK_TIMEOUT;
+			while (this->socket != -1 && !this->connected && now() < deadline){
+				if (this->receive(1000) < 0) break;
+			}
+		}
+	}
+	if (!this->connected){
+		if (this->socket != -1) ::close(this->socket);
+		this->socket = -1;
+		this->nextRetry = now() + this->retryDelay;
+		this->retryDelay = min(this->retryDelay * 2, MQTT_RETRY_DELAY_MAX);
+		return -1;
+	}
+	this->retryDelay = MQTT_RETRY_DELAY;
+	this->pingSent = 0;
+	this->replaySpool();
+	return 0;
+}
+
+/**
+ * Queue a message. It is sent with the next batch, or spooled if the broker
+ * can't be reached.
+ * @param topic The topic, without wildcards
+ * @param payload The message, must not contain a newline to be spooled
+ * @return 0 if the message was queued or spooled, -1 on failure
+ */
+int MQTTPublisher::publish(string topic, string payload){
+	Message message;
+	message.id = 0;
+	message.topic = topic;
+	message.payload = payload;
+	message.sent = 0;
+	if (this->queued.empty()) this->oldestQueued = now();
+	this->queued.push_back(message);
+
+	if (!this->connected && this->connect() != 0) return this->spool();
+	if (this->queued.size() >= MQTT_BATCH_SIZE) this->flush();
+	return 0;
+}
+
+/**
+ * Private method that numbers a message and appends its PUBLISH packet.
+ */
+void MQTTPublisher::encodePublish(string &out, Message &message, bool dup){
+	if (message.id == 0){
+		if (++this->nextId == 0) this->nextId = 1;
+		message.id = this->nextId;
+	}
+	out += (char)(MQTT_PUBLISH_QOS1 | (dup ? MQTT_PUBLISH_DUP : 0));
+	putLength(out, 2 + message.topic.size() + 2 + message.payload.size());
+	putString(out, message.topic);
+	putShort(out, message.id);
+	out += message.payload;
+	message.sent = now();
+}
+
+/**
+ * Send every queued message, as many per send() as the in-flight window allows,
+ * and wait for acknowledgements when the window is full.
+ * @return 0 when everything was sent, -1 if the messages were spooled
+ */
+int MQTTPublisher::flush(){
+	if (!this->connected && this->connect() != 0) return this->spool();
+	while (!this->queued.empty()){
+		string batch;
+		while (!this->queued.empty() && this->inFlight.size() < MQTT_WINDOW_SIZE){
+			this->inFlight.push_back(this->queued.front());
+			this->queued.pop_front();
+			this->encodePublish(batch, this->inFlight.back(), false);
+		}
+		if (!batch.empty() && this->sendAll(batch) != 0) return -1;
+		if (!this->queued.empty()){
+			time_t deadline = now() + MQTT_ACK_TIMEOUT;
+			while (this->connected && this->inFlight.size() >= MQTT_WINDOW_SIZE && now() < deadline){
+				this->receive(1000);
+			}
+			if (!this->connected) return -1;
+			if (this->inFlight.size() >= MQTT_WINDOW_SIZE){
+				// the broker stopped answering
+				this->disconnected();
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * Service the connection: read the acknowledgements, resend the messages that
+ * timed out, keep the connection alive, flush an old batch and reconnect.
+ * A PINGREQ left without PINGRESP for MQTT_KEEP_ALIVE seconds means the
+ * connection is dead even if the socket is still open: it is closed and the
+ * messages are spooled until the reconnection.
+ * Should be called regularly, e.g. from the measurement loop.
+ * @param timeout Time to wait for the broker in ms
+ * @return 0 when connected, -1 otherwise
+ */
+int MQTTPublisher::loop(int timeout){
+	if (!this->connected){
+		if (this->connect() != 0) return -1;
+	}
+	this->receive(timeout);
+	if (!this->connected) return -1;
+
+	time_t t = now();
+	if (this->pingSent != 0 && t - this->pingSent >= MQTT_KEEP_ALIVE){
+		fprintf(stderr, "MQTT: No PINGRESP from the broker\n");
+		this->disconnected();
+		return -1;
+	}
+	string resend;
+	for (unsigned int i=0; i<this->inFlight.size(); i++){
+		if (t - this->inFlight[i].sent >= MQTT_ACK_TIMEOUT)
+			this->encodePublish(resend, this->inFlight[i], true);
+	}
+	if (!resend.empty() && this->sendAll(resend) != 0) return -1;
+
+	if (!this->queued.empty() &&
+			(this->queued.size() >= MQTT_BATCH_SIZE || t - this->oldestQueued >= MQTT_BATCH_DELAY)){
+		if (this->flush() != 0) return -1;
+	}
+	if (this->pingSent == 0 && t - this->lastSend >= MQTT_KEEP_ALIVE / 2){
+		string ping;
+		ping += (char) MQTT_PINGREQ;
+		ping += (char) 0;
+		if (this->sendAll(ping) != 0) return -1;
+		this->pingSent = t;
+	}
+	return 0;
+}
+
+/**
+ * Private method that writes a whole buffer to the broker.
+ * @return 0 on success, -1 if the connection was lost
+ */
+int MQTTPublisher::sendAll(const string &data){
+	size_t done = 0;
+	while (done < data.size()){
+		ssize_t n = ::send(this->socket, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0){
+			perror("MQTT: Failed to send");
+			this->disconnected();
+			return -1;
+		}
+		done += n;
+	}
+	this->lastSend = now();
+	return 0;
+}
+
+/**
+ * Private method that reads what the broker sent and handles complete packets.
+ * @param timeout Time to wait for data in ms
+ * @return the number of packets handled, -1 if the connection was lost
+ */
+int MQTTPublisher::receive(int timeout){
+	struct pollfd pfd;
+	pfd.fd = this->socket;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (this->socket == -1) return -1;
+	if (poll(&pfd, 1, timeout) <= 0) return 0;
+
+	char buffer[512];
+	ssize_t n = ::recv(this->socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+	if (n <= 0){
+		this->disconnected();
+		return -1;
+	}
+	this->rxBuffer.append(buffer, n);
+
+	int handled = 0;
+	while (this->rxBuffer.size() >= 2){
+		unsigned int length = 0, multiplier = 1, i = 1;
+		bool complete = false;
+		for (; i < this->rxBuffer.size() && i <= 4; i++){
+			length += (this->rxBuffer[i] & 0x7F) * multiplier;
+			multiplier *= 128;
+			if ((this->rxBuffer[i] & 0x80) == 0){
+				complete = true;
+				break;
+			}
+		}
+		if (!complete || this->rxBuffer.size() < i + 1 + length) break;
+		unsigned char type = (unsigned char) this->rxBuffer[0] >> 4;
+		string body = this->rxBuffer.substr(i + 1, length);
+		this->rxBuffer.erase(0, i + 1 + length);
+		this->handlePacket(type, body);
+		handled++;
+	}
+	return handled;
+}
+
+void MQTTPublisher::handlePacket(unsigned char type, const string &body){
+	switch(type){
+	case MQTT_CONNACK:
+		if (body.size() >= 2 && body[1] == 0) this->connected = true;
+		else fprintf(stderr, "MQTT: Connection refused (%d)\n", body.size() >= 2 ? body[1] : -1);
+		break;
+	case MQTT_PUBACK:
+		if (body.size() >= 2){
+			unsigned short id = ((unsigned char) body[0] << 8) | (unsigned char) body[1];
+			for (std::deque<Message>::iterator it = this->inFlight.begin(); it != this->inFlight.end(); ++it){
+				if (it->id == id){
+					this->inFlight.erase(it);
+					break;
+				}
+			}
+		}
+		break;
+	case MQTT_PINGRESP:
+		this->pingSent = 0;
+		break;
+	}
+}
+
+/**
+ * Private method called when the connection is lost: every message not
+ * acknowledged yet goes to the spool file.
+ */
+void MQTTPublisher::disconnected(){
+	if (this->socket != -1) ::close(this->socket);
+	this->socket = -1;
+	this->connected = false;
+	this->pingSent = 0;
+	this->nextRetry = now() + this->retryDelay;
+	this->spool();
+}
+
+/**
+ * Private method that appends the in-flight and queued messages to the spool file.
+ * @return 0 on success, -1 if the file can't be written
+ */
+int MQTTPublisher::spool(){
+	if (this->inFlight.empty() && this->queued.empty()) return 0;
+	ofstream fs(this->spoolPath.c_str(), ios::out | ios::app);
+	if (!fs.is_open()){
+		perror("MQTT: Failed to open the spool file");
+		return -1;
+	}
+	for (unsigned int i=0; i<this->inFlight.size(); i++)
+		fs << this->inFlight[i].topic << '\t' << this->inFlight[i].payload << '\n';
+	for (unsigned int i=0; i<this->queued.size(); i++)
+		fs << this->queued[i].topic << '\t' << this->queued[i].payload << '\n';
+	fs.close();
+	this->inFlight.clear();
+	this->queued.clear();
+	return 0;
+}
+
+/**
+ * Private method that queues the spooled messages, oldest first, ahead of the
+ * ones already queued, and empties the spool file.
+ * @return the number of messages replayed
+ */
+int MQTTPublisher::replaySpool(){
+	ifstream fs(this->spoolPath.c_str());
+	if (!fs.is_open()) return 0;
+	std::deque<Message> spooled;
+	string line;
+	while (getline(fs, line)){
+		size_t tab = line.find('\t');
+		if (tab == string::npos) continue;
+		Message message;
+		message.id = 0;
+		message.topic = line.substr(0, tab);
+		message.payload = line.substr(tab + 1);
+		message.sent = 0;
+		spooled.push_back(message);
+	}
+	fs.close();
+	// Truncate now, anything not acknowledged will be spooled again
+	ofstream truncate(this->spoolPath.c_str(), ios::out | ios::trunc);
+	truncate.close();
+	if (!spooled.empty()){
+		this->queued.insert(this->queued.begin(), spooled.begin(), spooled.end());
+		this->oldestQueued = 0;  // flush with the next loop()
+	}
+	return spooled.size();
+}
+
+/**
+ * Send what is queued, wait for the acknowledgements, spool what is left
+ * and close the connection.
+ */
+void MQTTPublisher::disconnect(){
+	if (this->connected && this->flush() == 0){
+		time_t deadline = now() + MQTT_ACK_TIMEOUT;
+		while (this->connected && !this->inFlight.empty() && now() < deadline) this->receive(1000);
+	}
+	if (this->connected){
+		string packet;
+		packet += (char) MQTT_DISCONNECT;
+		packet += (char) 0;
+		this->sendAll(packet);
+	}
+	if (this->socket != -1) ::close(this->socket);
+	this->socket = -1;
+	this->connected = false;
+	this->spool();
+}
+
+MQTTPublisher::~MQTTPublisher() {
+	this->disconnect();
+}
+
+} /* namespace exploringBB */
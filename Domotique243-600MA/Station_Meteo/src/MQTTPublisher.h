@@ -0,0 +1,89 @@
+/*
+ * @file MQTTPublisher.h
+ *
+ * Minimal MQTT 3.1.1 publisher (QoS 1) for the weather station.
+ * Messages are batched and written to the broker in one send(), up to
+ * MQTT_WINDOW_SIZE of them can be waiting for their PUBACK at the same time.
+ * While the broker can't be reached the messages are appended to a spool
+ * file, which is replayed as soon as the connection comes back.
+ */
+
+#ifndef MQTTPUBLISHER_H_
+#define MQTTPUBLISHER_H_
+#include<string>
+#include<deque>
+#include<time.h>
+using std::string;
+
+#define MQTT_PORT 1883
+#define MQTT_WINDOW_SIZE 16      /**< QoS 1 messages in flight */
+#define MQTT_BATCH_SIZE 8        /**< Messages queued before a flush */
+#define MQTT_RETRY_DELAY_MAX 300 /**< Reconnection delay doubles up to this */
+
+// The delays can be shortened from the command line, as test/mqtt_test does
+#ifndef MQTT_KEEP_ALIVE
+#define MQTT_KEEP_ALIVE 60       /**< Keep alive in seconds */
+#endif
+#ifndef MQTT_BATCH_DELAY
+#define MQTT_BATCH_DELAY 5       /**< Max seconds a message stays queued */
+#endif
+#ifndef MQTT_ACK_TIMEOUT
+#define MQTT_ACK_TIMEOUT 10      /**< Seconds before an unacked message is resent */
+#endif
+#ifndef MQTT_RETRY_DELAY
+#define MQTT_RETRY_DELAY 5       /**< First reconnection delay in seconds */
+#endif
+
+namespace exploringBB {
+
+/**
+ * @class MQTTPublisher
+ * @brief Keeps one connection to an MQTT broker and publishes with QoS 1.
+ */
+class MQTTPublisher {
+private:
+	struct Message {
+		unsigned short id;   /**< Packet identifier, 0 until sent */
+		string topic;
+		string payload;
+		time_t sent;         /**< Time of the last PUBLISH */
+	};
+	string host;
+	int port;
+	string clientId;
+	string spoolPath;        /**< Messages waiting for the broker, one per line */
+	int socket;
+	bool connected;
+	unsigned short nextId;
+	time_t lastSend;         /**< For the keep alive */
+	time_t pingSent;         /**< Time of the PINGREQ waiting for its PINGRESP, 0 if none */
+	time_t oldestQueued;     /**< Time the first message of the batch was queued */
+	time_t nextRetry;
+	int retryDelay;
+	string rxBuffer;
+	std::deque<Message> queued;    /**< Not sent yet */
+	std::deque<Message> inFlight;  /**< Sent, waiting for PUBACK */
+
+	int sendAll(const string &data);
+	int receive(int timeout);
+	void handlePacket(unsigned char type, const string &body);
+	void encodePublish(string &out, Message &message, bool dup);
+	void disconnected();
+	int spool();
+	int replaySpool();
+
+public:
+	MQTTPublisher(string host, string clientId, string spoolPath, int port=MQTT_PORT);
+	virtual int connect();
+	virtual int publish(string topic, string payload);
+	virtual int flush();
+	virtual int loop(int timeout=0);  // services acks, keep alive and reconnection
+	virtual bool isConnected() { return connected; }
+	virtual unsigned int getPending() { return queued.size() + inFlight.size(); }
+	virtual void disconnect();
+	virtual ~MQTTPublisher();
+};
+
+} /* namespace exploringBB */
+
+#endif /* MQTTPUBLISHER_H_ */
@@ -0,0 +1,413 @@
+/*
+ * MiWiGateway.cpp
+ *
+ * Serial MiWi gateway daemon, see MiWiGateway.h.
+ */
+
+#include "MiWiGateway.h"
+#include<cstdio>
+#include<cstring>
+#include<errno.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/time.h>
+#include<time.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+using namespace std;
+
+namespace exploringBB {
+
+/**
+ * Private helper, milliseconds from a clock that is not changed by NTP.
+ */
+static unsigned long long nowMs(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * CRC16 CCITT (polynomial 0x1021, initial value 0xFFFF), same as the firmware.
+ */
+unsigned short gatewayCRC16(const unsigned char *data, unsigned int length){
+	unsigned short crc = 0xFFFF;
+	while (length--){
+		crc ^= (unsigned short)(*data++) << 8;
+		for (int i=0; i<8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * Append a frame to out: length and CRC are added, then the whole frame is COBS
+ * encoded and terminated by 0x00. Frames are shorter than 254 bytes, so each COBS
+ * block ends with a zero.
+ */
+void encodeGatewayFrame(string &out, const GatewayFrame &frame){
+	unsigned char raw[GW_MAX_DATA + 5];
+	unsigned int length = frame.data.size() > GW_MAX_DATA ? GW_MAX_DATA : frame.data.size();
+	raw[0] = frame.type;
+	raw[1] = frame.seq;
+	raw[2] = length;
+	memcpy(&raw[3], frame.data.data(), length);
+	unsigned int n = length + 3;
+	unsigned short crc = gatewayCRC16(raw, n);
+	raw[n++] = crc >> 8;
+	raw[n++] = crc & 0xFF;
+
+	unsigned int i = 0;
+	while (true){
+		unsigned int j = i;
+		while (j < n && raw[j] != 0) j++;
+		out += (char)(j - i + 1);
+		out.append((const char *)&raw[i], j - i);
+		if (j >= n) break;
+		i = j + 1;
+	}
+	out += '\0';
+}
+
+FrameDecoder::FrameDecoder() {
+	this->valid = true;
+	this->code = 0xFF;
+	this->remaining = 0;
+	this->crcErrors = 0;
+}
+
+/**
+ * Feed one received byte to the decoder.
+ * @param byte The byte
+ * @param out Receives the frame when the function returns true
+ * @return true when the byte completed a frame with a good length and CRC
+ */
+bool FrameDecoder::push(unsigned char byte, GatewayFrame &out){
+	if (byte == 0){
+		bool complete = false;
+		unsigned int n = this->frame.size();
+		const unsigned char *raw = (const unsigned char *) this->frame.data();
+		if (this->valid && n >= 5 && raw[2] == n - 5){
+			if (((raw[n-2] << 8) | raw[n-1]) == gatewayCRC16(raw, n - 2)){
+				out.type = raw[0];
+				out.seq = raw[1];
+				out.data.assign((const char *)&raw[3], raw[2]);
+				complete = true;
+			}
+			else this->crcErrors++;
+		}
+		this->frame.clear();
+		this->valid = true;
+		this->code = 0xFF;
+		this->remaining = 0;
+		return complete;
+	}
+	if (this->frame.size() >= GW_MAX_DATA + 5) this->valid = false;  // too long, dropped at the next 0
+	if (!this->valid) return false;
+	if (this->remaining == 0){
+		if (this->code != 0xFF) this->frame += '\0';  // previous block ended with a zero
+		this->code = byte;
+		this->remaining = byte - 1;
+	}
+	else {
+		this->frame += (char) byte;
+		this->remaining--;
+	}
+	return false;
+}
+
+/**
+ * The constructor doesn't open anything, call open().
+ * @param device The serial device connected to the gateway e.g. /dev/ttyO4
+ * @param port The TCP port for the clients
+ */
+MiWiGateway::MiWiGateway(string device, int port) {
+	this->device = device;
+	this->port = port;
+	this->serial = -1;
+	this->server = -1;
+	this->nextSeq = 1;
+	this->inFlight = 0;
+	for (int i=0; i<256; i++) this->pending[i].fd = -1;
+	memset(&this->oldSettings, 0, sizeof(this->oldSettings));
+}
+
+/**
+ * Private method that puts the serial line in raw mode at GW_BAUDRATE.
+ */
+int MiWiGateway::openSerial(){
+	this->serial = ::open(this->device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (this->serial < 0){
+		perror("MiWiGateway: Failed to open the serial device");
+		return -1;
+	}
+	struct termios settings;
+	tcgetattr(this->serial, &this->oldSettings);
+	tcgetattr(this->serial, &settings);
+	cfmakeraw(&settings);
+	cfsetispeed(&settings, GW_BAUDRATE);
+	cfsetospeed(&settings, GW_BAUDRATE);
+	settings.c_cflag |= CLOCAL | CREAD;
+	settings.c_cc[VMIN] = 0;
+	settings.c_cc[VTIME] = 0;
+	tcflush(this->serial, TCIOFLUSH);
+	if (tcsetattr(this->serial, TCSANOW, &settings) < 0){
+		perror("MiWiGateway: Failed to set the serial attributes");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Private method that opens the listening socket.
+ */
+int MiWiGateway::openServer(){
+	this->server = socket(AF_INET, SOCK_STREAM, 0);
+	if (this->server < 0){
+		perror("MiWiGateway: Failed to create the socket");
+		return -1;
+	}
+	int one = 1;
+	setsockopt(this->server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(this->port);
+	if (bind(this->server, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+			listen(this->server, GW_MAX_CLIENTS) < 0){
+		perror("MiWiGateway: Failed to listen");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Open the serial line and start listening for clients.
+ * @return 0 on success, -1 on failure
+ */
+int MiWiGateway::open(){
+	if (this->openSerial() < 0 || this->openServer() < 0){
+		this->close();
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Private method that writes everything, waiting when the descriptor is full.
+ */
+int MiWiGateway::writeAll(int fd, const string &data){
+	size_t sent = 0;
+	while (sent < data.size()){
+		ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+		if (n > 0){
+			sent += n;
+			continue;
+		}
+		if (n < 0 && errno != EAGAIN && errno != EINTR) return -1;
+		struct pollfd p = { fd, POLLOUT, 0 };
+		if (poll(&p, 1, 1000) <= 0) return -1;
+	}
+	return 0;
+}
+
+void MiWiGateway::acceptClient(){
+	int fd = accept(this->server, NULL, NULL);
+	if (fd < 0) return;
+	if (this->clients.size() >= GW_MAX_CLIENTS){
+		fprintf(stderr, "MiWiGateway: Too many clients\n");
+		::close(fd);
+		return;
+	}
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	// A client that doesn't read must not block the gateway for long
+	struct timeval tv = { 1, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	Client *client = new Client;
+	client->fd = fd;
+	this->clients.push_back(client);
+}
+
+void MiWiGateway::closeClient(unsigned int index){
+	Client *client = this->clients[index];
+	// Still counted in flight until the gateway answers, but nobody to answer to
+	for (int i=0; i<256; i++){
+		if (this->pending[i].fd == client->fd) this->pending[i].fd = -2;
+	}
+	for (unsigned int i=this->waiting.size(); i-- > 0; ){
+		if (this->waiting[i].fd == client->fd) this->waiting.erase(this->waiting.begin() + i);
+	}
+	::close(client->fd);
+	delete client;
+	this->clients.erase(this->clients.begin() + index);
+}
+
+/**
+ * Private method, a frame from a client is queued for the gateway.
+ */
+void MiWiGateway::fromClient(Client *client, GatewayFrame &frame){
+	Waiting request;
+	request.fd = client->fd;
+	request.frame = frame;
+	this->waiting.push_back(request);
+	this->sendWaiting();
+}
+
+/**
+ * Private method that sends the queued requests to the gateway, with their
+ * sequence number remapped, as long as less than GW_MAX_IN_FLIGHT are pending.
+ * The firmware can't receive while it is sending on the radio, this keeps its
+ * UART buffer from overflowing.
+ */
+void MiWiGateway::sendWaiting(){
+	string out;
+	while (this->inFlight < GW_MAX_IN_FLIGHT && !this->waiting.empty()){
+		Waiting &request = this->waiting.front();
+		// 0 is used by GW_RECEIVED, and a request lost on the serial line keeps its
+		// number until it expires
+		while (this->nextSeq == 0 || this->pending[this->nextSeq].fd != -1) this->nextSeq++;
+		Pending &slot = this->pending[this->nextSeq];
+		slot.fd = request.fd;
+		slot.seq = request.frame.seq;
+		slot.sent = nowMs();
+		request.frame.seq = this->nextSeq++;
+		encodeGatewayFrame(out, request.frame);
+		this->waiting.pop_front();
+		this->inFlight++;
+	}
+	if (!out.empty() && this->writeAll(this->serial, out) < 0){
+		perror("MiWiGateway: Failed to write to the serial line");
+	}
+}
+
+/**
+ * Private method that answers GW_NO_ANSWER for the requests the gateway never
+ * answered, e.g. a frame lost on the serial line.
+ */
+void MiWiGateway::expirePending(){
+	if (this->inFlight == 0) return;
+	unsigned long long now = nowMs();
+	for (int i=0; i<256; i++){
+		Pending &slot = this->pending[i];
+		if (slot.fd == -1 || now - slot.sent < GW_STATUS_TIMEOUT) continue;
+		GatewayFrame frame;
+		frame.type = GW_STATUS;
+		frame.seq = i;
+		frame.data = (char) GW_NO_ANSWER;
+		this->fromGateway(frame);
+	}
+}
+
+/**
+ * Private method, a frame from the gateway: a status goes back to the client
+ * that sent the request, anything else goes to all the clients.
+ */
+void MiWiGateway::fromGateway(GatewayFrame &frame){
+	string out;
+	if (frame.type == GW_STATUS){
+		Pending &slot = this->pending[frame.seq];
+		if (slot.fd == -1) return;  // already expired
+		int fd = slot.fd;
+		frame.seq = slot.seq;
+		slot.fd = -1;
+		this->inFlight--;
+		if (fd < 0) return;         // client gone
+		encodeGatewayFrame(out, frame);
+		for (unsigned int i=0; i<this->clients.size(); i++){
+			if (this->clients[i]->fd != fd) continue;
+			if (this->writeAll(fd, out) < 0) this->closeClient(i);
+			break;
+		}
+		return;
+	}
+	encodeGatewayFrame(out, frame);
+	for (unsigned int i=this->clients.size(); i-- > 0; ){
+		if (this->writeAll(this->clients[i]->fd, out) < 0) this->closeClient(i);
+	}
+}
+
+int MiWiGateway::readSerial(){
+	unsigned char buffer[256];
+	ssize_t n = ::read(this->serial, buffer, sizeof(buffer));
+	if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+	GatewayFrame frame;
+	for (ssize_t i=0; i<n; i++){
+		if (this->serialDecoder.push(buffer[i], frame)) this->fromGateway(frame);
+	}
+	return 0;
+}
+
+int MiWiGateway::readClient(unsigned int index){
+	unsigned char buffer[256];
+	Client *client = this->clients[index];
+	ssize_t n = ::read(client->fd, buffer, sizeof(buffer));
+	if (n <= 0) return -1;
+	GatewayFrame frame;
+	for (ssize_t i=0; i<n; i++){
+		if (client->decoder.push(buffer[i], frame)) this->fromClient(client, frame);
+	}
+	return 0;
+}
+
+/**
+ * Wait for data on the serial line, the listening socket or a client and relay it.
+ * @param timeout Maximum wait in ms, -1 to wait forever
+ * @return 0 on success or timeout, -1 on a serial line or poll failure
+ */
+int MiWiGateway::loop(int timeout){
+	struct pollfd fds[GW_MAX_CLIENTS + 2];
+	unsigned int count = this->clients.size();
+	fds[0].fd = this->serial;
+	fds[1].fd = this->server;
+	for (unsigned int i=0; i<count; i++) fds[i+2].fd = this->clients[i]->fd;
+	for (unsigned int i=0; i<count+2; i++){
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
+	if (this->inFlight > 0 && (timeout < 0 || timeout > GW_STATUS_TIMEOUT)) timeout = GW_STATUS_TIMEOUT;
+	if (poll(fds, count + 2, timeout) < 0){
+		if (errno == EINTR) return 0;
+		perror("MiWiGateway: Poll fail");
+		return -1;
+	}
+	if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) return -1;
+	if ((fds[0].revents & POLLIN) && this->readSerial() < 0){
+		perror("MiWiGateway: Failed to read the serial line");
+		return -1;
+	}
+	// Backwards, a closed client is removed from the vector
+	for (unsigned int i=count; i-- > 0; ){
+		if (i >= this->clients.size() || this->clients[i]->fd != fds[i+2].fd) continue;
+		if (fds[i+2].revents && this->readClient(i) < 0) this->closeClient(i);
+	}
+	if (fds[1].revents & POLLIN) this->acceptClient();
+	this->expirePending();
+	this->sendWaiting();
+	return 0;
+}
+
+int MiWiGateway::run(){
+	if (this->serial < 0 && this->open() < 0) return -1;
+	while (this->loop(-1) == 0);
+	return -1;
+}
+
+void MiWiGateway::close(){
+	while (!this->clients.empty()) this->closeClient(this->clients.size() - 1);
+	if (this->server != -1) ::close(this->server);
+	if (this->serial != -1){
+		tcsetattr(this->serial, TCSANOW, &this->oldSettings);
+		::close(this->serial);
+	}
+	this->server = -1;
+	this->serial = -1;
+}
+
+MiWiGateway::~MiWiGateway() {
+	this->close();
+}
+
+} /* namespace exploringBB */
@@ -0,0 +1,128 @@
+/*
+ * @file MiWiGateway.h
+ *
+ * Linux side of the MiWi gateway (GATEWAY mode of the miwi_demo_kit firmware).
+ * The firmware carries the MiWi frames on a serial line in COBS encoded frames
+ * ending with 0x00:
+ *
+ *   COBS( type | seq | length | data... | CRC16 MSB | CRC16 LSB ) 0x00
+ *
+ * The daemon owns the serial line and accepts TCP clients that speak the same
+ * framing. The sequence numbers of the clients are remapped so that each
+ * GW_STATUS goes back to the client that sent the request, and the messages
+ * received from the nodes (GW_RECEIVED) are sent to every client.
+ */
+
+#ifndef MIWIGATEWAY_H_
+#define MIWIGATEWAY_H_
+#include<string>
+#include<vector>
+#include<deque>
+#include<termios.h>
+using std::string;
+
+#define GW_PORT 5021
+#define GW_BAUDRATE B115200
+#define GW_MAX_DATA 56          /**< Same as GW_DONNEES_MAX in the firmware */
+#define GW_MAX_CLIENTS 8
+#define GW_MAX_IN_FLIGHT 2      /**< Requests sent to the gateway before its status, the UART RX buffer holds 2 frames */
+#define GW_STATUS_TIMEOUT 1000  /**< ms before a request without status is forgotten */
+
+// Frame types, see gateway.h in the firmware
+#define GW_SEND 0x01            /**< to a node: [address length][address][payload] */
+#define GW_RECEIVED 0x02        /**< from a node: [address length][address][RSSI][LQI][payload] */
+#define GW_STATUS 0x03          /**< answer to a frame: [result], same seq */
+#define GW_PING 0x04            /**< answered by the gateway without using the radio */
+
+// GW_STATUS results
+#define GW_OK 0x00
+#define GW_MIWI_FAILED 0x01
+#define GW_INVALID_FRAME 0x02
+#define GW_NO_ANSWER 0x80        /**< Made by the daemon after GW_STATUS_TIMEOUT */
+
+namespace exploringBB {
+
+/**
+ * @struct GatewayFrame
+ * @brief A decoded frame, without the length and the CRC.
+ */
+struct GatewayFrame {
+	unsigned char type;
+	unsigned char seq;
+	string data;
+};
+
+/**
+ * @class FrameDecoder
+ * @brief Streaming COBS decoder, bytes can be fed as they arrive.
+ */
+class FrameDecoder {
+private:
+	string frame;
+	bool valid;
+	unsigned char code;
+	unsigned char remaining;
+public:
+	FrameDecoder();
+	bool push(unsigned char byte, GatewayFrame &out);  // true when a valid frame is complete
+	unsigned int crcErrors;
+};
+
+unsigned short gatewayCRC16(const unsigned char *data, unsigned int length);
+void encodeGatewayFrame(string &out, const GatewayFrame &frame);
+
+/**
+ * @class MiWiGateway
+ * @brief Single threaded poll() loop between the serial line and the TCP clients.
+ */
+class MiWiGateway {
+private:
+	struct Client {
+		int fd;
+		FrameDecoder decoder;
+	};
+	struct Pending {
+		int fd;                 /**< Client waiting for the status, -1 if free */
+		unsigned char seq;      /**< Sequence number used by the client */
+		unsigned long long sent; /**< Time the request was written, in ms */
+	};
+	struct Waiting {
+		int fd;
+		GatewayFrame frame;
+	};
+	string device;
+	int port;
+	int serial;
+	int server;
+	struct termios oldSettings;
+	FrameDecoder serialDecoder;
+	std::vector<Client*> clients;
+	Pending pending[256];       /**< Indexed by the sequence number sent to the gateway */
+	unsigned char nextSeq;
+	unsigned int inFlight;
+	std::deque<Waiting> waiting; /**< Requests held back while GW_MAX_IN_FLIGHT are pending */
+
+	int openSerial();
+	int openServer();
+	void acceptClient();
+	void closeClient(unsigned int index);
+	int readSerial();
+	int readClient(unsigned int index);
+	void fromClient(Client *client, GatewayFrame &frame);
+	void fromGateway(GatewayFrame &frame);
+	void sendWaiting();
+	void expirePending();
+	int writeAll(int fd, const string &data);
+
+public:
+	MiWiGateway(string device, int port=GW_PORT);
+	virtual int open();
+	virtual int loop(int timeout=-1);  // one poll() pass, timeout in ms
+	virtual int run();                 // loop() until an error on the serial line
+	virtual void close();
+	virtual ~MiWiGateway();
+};
+
+} /* namespace exploringBB */
+
+#endif /* MIWIGATEWAY_H_ */
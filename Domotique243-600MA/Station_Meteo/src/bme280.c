@@ -2231,3 +2231,271 @@ BME280_RETURN_FUNCTION_TYPE bme280_compute_wait_time(u8
 	T_SETUP_HUMIDITY_MAX : 0) + 15) / 16;
 	return com_rslt;
 }
+/**************************************************************/
+/**\name	BATCH COMPENSATION                            */
+/**************************************************************/
+/* The batch kernels below use the same formulas as the scalar
+ * compensation functions above, but take the calibration parameters
+ * as an argument and work on structure-of-arrays input, block by
+ * block. Temperature (t_fine) and humidity are branch-free 32 bit
+ * loops that the compiler can vectorize (SSE4.1/AVX2 pmulld, NEON
+ * vmul.s32); pressure needs a division per sample and stays scalar.
+ */
+#if defined(__GNUC__)
+#define BME280_RESTRICT __restrict__
+#else
+#define BME280_RESTRICT
+#endif
+
+static void bme280_batch_t_fine_int32(
+const struct bme280_calibration_param_t *cal_param,
+const s32 *BME280_RESTRICT v_uncomp_temperature_s32,
+s32 *BME280_RESTRICT v_t_fine_s32,
+s32 *BME280_RESTRICT v_temperature_s32, u32 v_count_u32)
+{
+	const s32 v_dig_T1_s32 = (s32)cal_param->dig_T1;
+	const s32 v_dig_T2_s32 = (s32)cal_param->dig_T2;
+	const s32 v_dig_T3_s32 = (s32)cal_param->dig_T3;
+	u32 v_index_u32 = BME280_INIT_VALUE;
+
+	for (v_index_u32 = 0; v_index_u32 < v_count_u32; v_index_u32++) {
+		s32 v_ut_s32 = v_uncomp_temperature_s32[v_index_u32];
+		s32 v_x1_s32 = (((v_ut_s32
+		>> BME280_SHIFT_BIT_POSITION_BY_03_BITS) -
+		(v_dig_T1_s32 << BME280_SHIFT_BIT_POSITION_BY_01_BIT)) *
+		v_dig_T2_s32) >> BME280_SHIFT_BIT_POSITION_BY_11_BITS;
+		s32 v_x2_s32 = ((v_ut_s32
+		>> BME280_SHIFT_BIT_POSITION_BY_04_BITS) - v_dig_T1_s32);
+
+		v_x2_s32 = (((v_x2_s32 * v_x2_s32)
+		>> BME280_SHIFT_BIT_POSITION_BY_12_BITS) * v_dig_T3_s32)
+		>> BME280_SHIFT_BIT_POSITION_BY_14_BITS;
+		v_t_fine_s32[v_index_u32] = v_x1_s32 + v_x2_s32;
+		v_temperature_s32[v_index_u32] =
+		(v_t_fine_s32[v_index_u32] * 5 + 128)
+		>> BME280_SHIFT_BIT_POSITION_BY_08_BITS;
+	}
+}
+
+static void bme280_batch_humidity_int32(
+const struct bme280_calibration_param_t *cal_param,
+const s32 *BME280_RESTRICT v_t_fine_s32,
+const s32 *BME280_RESTRICT v_uncomp_humidity_s32,
+u32 *BME280_RESTRICT v_humidity_u32, u32 v_count_u32)
+{
+	const s32 v_dig_H1_s32 = (s32)cal_param->dig_H1;
+	const s32 v_dig_H2_s32 = (s32)cal_param->dig_H2;
+	const s32 v_dig_H3_s32 = (s32)cal_param->dig_H3;
+	const s32 v_dig_H4_s32 = ((s32)cal_param->dig_H4)
+	<< BME280_SHIFT_BIT_POSITION_BY_20_BITS;
+	const s32 v_dig_H5_s32 = (s32)cal_param->dig_H5;
+	const s32 v_dig_H6_s32 = (s32)cal_param->dig_H6;
+	u32 v_index_u32 = BME280_INIT_VALUE;
+
+	for (v_index_u32 = 0; v_index_u32 < v_count_u32; v_index_u32++) {
+		s32 v_x1_s32 = v_t_fine_s32[v_index_u32] - ((s32)76800);
+
+		v_x1_s32 = (((((v_uncomp_humidity_s32[v_index_u32]
+		<< BME280_SHIFT_BIT_POSITION_BY_14_BITS) -
+		v_dig_H4_s32 - (v_dig_H5_s32 * v_x1_s32)) +
+		((s32)16384)) >> BME280_SHIFT_BIT_POSITION_BY_15_BITS)
+		* (((((((v_x1_s32 * v_dig_H6_s32)
+		>> BME280_SHIFT_BIT_POSITION_BY_10_BITS) *
+		(((v_x1_s32 * v_dig_H3_s32)
+		>> BME280_SHIFT_BIT_POSITION_BY_11_BITS) + ((s32)32768)))
+		>> BME280_SHIFT_BIT_POSITION_BY_10_BITS) + ((s32)2097152)) *
+		v_dig_H2_s32 + 8192) >> 14));
+		v_x1_s32 = (v_x1_s32 - (((((v_x1_s32
+		>> BME280_SHIFT_BIT_POSITION_BY_15_BITS) *
+		(v_x1_s32 >> BME280_SHIFT_BIT_POSITION_BY_15_BITS))
+		>> BME280_SHIFT_BIT_POSITION_BY_07_BITS) * v_dig_H1_s32)
+		>> BME280_SHIFT_BIT_POSITION_BY_04_BITS));
+		v_x1_s32 = (v_x1_s32 < 0 ? 0 : v_x1_s32);
+		v_x1_s32 = (v_x1_s32 > 419430400 ? 419430400 : v_x1_s32);
+		v_humidity_u32[v_index_u32] =
+		(u32)(v_x1_s32 >> BME280_SHIFT_BIT_POSITION_BY_12_BITS);
+	}
+}
+
+static u32 bme280_batch_pressure_int32(
+const struct bme280_calibration_param_t *cal_param,
+s32 v_t_fine_s32, s32 v_uncomp_pressure_s32)
+{
+	s32 v_x1_u32 = BME280_INIT_VALUE;
+	s32 v_x2_u32 = BME280_INIT_VALUE;
+	u32 v_pressure_u32 = BME280_INIT_VALUE;
+
+	v_x1_u32 = (v_t_fine_s32 >> BME280_SHIFT_BIT_POSITION_BY_01_BIT)
+	- (s32)64000;
+	v_x2_u32 = (((v_x1_u32 >> BME280_SHIFT_BIT_POSITION_BY_02_BITS)
+	* (v_x1_u32 >> BME280_SHIFT_BIT_POSITION_BY_02_BITS)
+	) >> BME280_SHIFT_BIT_POSITION_BY_11_BITS)
+	* ((s32)cal_param->dig_P6);
+	v_x2_u32 = v_x2_u32 + ((v_x1_u32 * ((s32)cal_param->dig_P5))
+	<< BME280_SHIFT_BIT_POSITION_BY_01_BIT);
+	v_x2_u32 = (v_x2_u32 >> BME280_SHIFT_BIT_POSITION_BY_02_BITS) +
+	(((s32)cal_param->dig_P4) << BME280_SHIFT_BIT_POSITION_BY_16_BITS);
+	v_x1_u32 = (((cal_param->dig_P3 *
+	(((v_x1_u32 >> BME280_SHIFT_BIT_POSITION_BY_02_BITS) *
+	(v_x1_u32 >> BME280_SHIFT_BIT_POSITION_BY_02_BITS))
+	>> BME280_SHIFT_BIT_POSITION_BY_13_BITS))
+	>> BME280_SHIFT_BIT_POSITION_BY_03_BITS) +
+	((((s32)cal_param->dig_P2) * v_x1_u32)
+	>> BME280_SHIFT_BIT_POSITION_BY_01_BIT))
+	>> BME280_SHIFT_BIT_POSITION_BY_18_BITS;
+	v_x1_u32 = ((((32768 + v_x1_u32)) * ((s32)cal_param->dig_P1))
+	>> BME280_SHIFT_BIT_POSITION_BY_15_BITS);
+	/* Avoid exception caused by division by zero */
+	if (v_x1_u32 == BME280_INIT_VALUE)
+		return BME280_INVALID_DATA;
+	v_pressure_u32 = (((u32)(((s32)1048576) - v_uncomp_pressure_s32)
+	- (v_x2_u32 >> BME280_SHIFT_BIT_POSITION_BY_12_BITS))) * 3125;
+	if (v_pressure_u32 < 0x80000000)
+		v_pressure_u32 = (v_pressure_u32
+		<< BME280_SHIFT_BIT_POSITION_BY_01_BIT) / ((u32)v_x1_u32);
+	else
+		v_pressure_u32 = (v_pressure_u32 / (u32)v_x1_u32) * 2;
+
+	v_x1_u32 = (((s32)cal_param->dig_P9) *
+	((s32)(((v_pressure_u32 >> BME280_SHIFT_BIT_POSITION_BY_03_BITS)
+	* (v_pressure_u32 >> BME280_SHIFT_BIT_POSITION_BY_03_BITS))
+	>> BME280_SHIFT_BIT_POSITION_BY_13_BITS)))
+	>> BME280_SHIFT_BIT_POSITION_BY_12_BITS;
+	v_x2_u32 = (((s32)(v_pressure_u32
+	>> BME280_SHIFT_BIT_POSITION_BY_02_BITS)) *
+	((s32)cal_param->dig_P8)) >> BME280_SHIFT_BIT_POSITION_BY_13_BITS;
+	return (u32)((s32)v_pressure_u32 +
+	((v_x1_u32 + v_x2_u32 + cal_param->dig_P7)
+	>> BME280_SHIFT_BIT_POSITION_BY_04_BITS));
+}
+#if defined(BME280_ENABLE_INT64) && defined(BME280_64BITSUPPORT_PRESENT)
+static u32 bme280_batch_pressure_int64(
+const struct bme280_calibration_param_t *cal_param,
+s32 v_t_fine_s32, s32 v_uncom_pressure_s32)
+{
+	s64 v_x1_s64r = BME280_INIT_VALUE;
+	s64 v_x2_s64r = BME280_INIT_VALUE;
+	s64 pressure = BME280_INIT_VALUE;
+
+	v_x1_s64r = ((s64)v_t_fine_s32) - 128000;
+	v_x2_s64r = v_x1_s64r * v_x1_s64r * (s64)cal_param->dig_P6;
+	v_x2_s64r = v_x2_s64r + ((v_x1_s64r * (s64)cal_param->dig_P5)
+	<< BME280_SHIFT_BIT_POSITION_BY_17_BITS);
+	v_x2_s64r = v_x2_s64r + (((s64)cal_param->dig_P4)
+	<< BME280_SHIFT_BIT_POSITION_BY_35_BITS);
+	v_x1_s64r = ((v_x1_s64r * v_x1_s64r * (s64)cal_param->dig_P3)
+	>> BME280_SHIFT_BIT_POSITION_BY_08_BITS) +
+	((v_x1_s64r * (s64)cal_param->dig_P2)
+	<< BME280_SHIFT_BIT_POSITION_BY_12_BITS);
+	v_x1_s64r = (((((s64)1)
+	<< BME280_SHIFT_BIT_POSITION_BY_47_BITS) + v_x1_s64r)) *
+	((s64)cal_param->dig_P1) >> BME280_SHIFT_BIT_POSITION_BY_33_BITS;
+	pressure = 1048576 - v_uncom_pressure_s32;
+	/* Avoid exception caused by division by zero */
+	if (v_x1_s64r == BME280_INIT_VALUE)
+		return BME280_INVALID_DATA;
+	#if defined __KERNEL__
+		pressure = div64_s64((((pressure
+		<< BME280_SHIFT_BIT_POSITION_BY_31_BITS) - v_x2_s64r)
+		* 3125), v_x1_s64r);
+	#else
+		pressure = (((pressure
+		<< BME280_SHIFT_BIT_POSITION_BY_31_BITS) - v_x2_s64r)
+		* 3125) / v_x1_s64r;
+	#endif
+	v_x1_s64r = (((s64)cal_param->dig_P9) *
+	(pressure >> BME280_SHIFT_BIT_POSITION_BY_13_BITS) *
+	(pressure >> BME280_SHIFT_BIT_POSITION_BY_13_BITS))
+	>> BME280_SHIFT_BIT_POSITION_BY_25_BITS;
+	v_x2_s64r = (((s64)cal_param->dig_P8) * pressure)
+	>> BME280_SHIFT_BIT_POSITION_BY_19_BITS;
+	pressure = (((pressure + v_x1_s64r + v_x2_s64r)
+	>> BME280_SHIFT_BIT_POSITION_BY_08_BITS) +
+	(((s64)cal_param->dig_P7) << BME280_SHIFT_BIT_POSITION_BY_04_BITS));
+
+	return (u32)pressure;
+}
+#endif
+/*!
+ * @brief Compensates an array of raw pressure, temperature
+ * and humidity samples, e.g. when replaying a log of raw ADC
+ * values with new calibration parameters
+ * @note Results are bit-exact with
+ * bme280_compensate_temperature_int32(),
+ * bme280_compensate_humidity_int32() and, depending on
+ * v_pressure_int64_u8, bme280_compensate_pressure_int32() or
+ * bme280_compensate_pressure_int64()
+ * @note cal_param->t_fine is not modified
+ *
+ *
+ *  @param cal_param : calibration parameters to use,
+ *  BME280_NULL for the ones of the initialized sensor
+ *  @param v_uncomp_pressure_s32 : array of uncompensated pressure
+ *  @param v_uncomp_temperature_s32 : array of uncompensated temperature
+ *  @param v_uncomp_humidity_s32 : array of uncompensated humidity
+ *  @param v_pressure_u32 : output array of pressure, in Pa or Q24.8 Pa
+ *  @param v_temperature_s32 : output array of temperature, in 0.01 DegC
+ *  @param v_humidity_u32 : output array of humidity, in Q22.10 %rH
+ *  @param v_count_u32 : number of samples in each array
+ *  @param v_pressure_int64_u8 : 1 for the 64 bit pressure formula
+ *
+ *
+ *	@return results of the compensation
+ *	@retval 0 -> Success
+ *	@retval -127 -> No calibration parameters
+ *	@retval -2 -> 64 bit pressure not supported
+ *
+ *
+*/
+BME280_RETURN_FUNCTION_TYPE bme280_compensate_batch_int32(
+const struct bme280_calibration_param_t *cal_param,
+const s32 *v_uncomp_pressure_s32, const s32 *v_uncomp_temperature_s32,
+const s32 *v_uncomp_humidity_s32, u32 *v_pressure_u32,
+s32 *v_temperature_s32, u32 *v_humidity_u32, u32 v_count_u32,
+u8 v_pressure_int64_u8)
+{
+	s32 a_t_fine_s32[BME280_BATCH_BLOCK_SIZE];
+	u32 v_offset_u32 = BME280_INIT_VALUE;
+	u32 v_length_u32 = BME280_INIT_VALUE;
+	u32 v_index_u32 = BME280_INIT_VALUE;
+
+	if (cal_param == BME280_NULL) {
+		if (p_bme280 == BME280_NULL)
+			return E_BME280_NULL_PTR;
+		cal_param = &p_bme280->cal_param;
+	}
+#if !(defined(BME280_ENABLE_INT64) && defined(BME280_64BITSUPPORT_PRESENT))
+	if (v_pressure_int64_u8)
+		return E_BME280_OUT_OF_RANGE;
+#endif
+	for (v_offset_u32 = 0; v_offset_u32 < v_count_u32;
+	v_offset_u32 += v_length_u32) {
+		v_length_u32 = v_count_u32 - v_offset_u32;
+		if (v_length_u32 > BME280_BATCH_BLOCK_SIZE)
+			v_length_u32 = BME280_BATCH_BLOCK_SIZE;
+
+		bme280_batch_t_fine_int32(cal_param,
+		v_uncomp_temperature_s32 + v_offset_u32, a_t_fine_s32,
+		v_temperature_s32 + v_offset_u32, v_length_u32);
+		bme280_batch_humidity_int32(cal_param, a_t_fine_s32,
+		v_uncomp_humidity_s32 + v_offset_u32,
+		v_humidity_u32 + v_offset_u32, v_length_u32);
+#if defined(BME280_ENABLE_INT64) && defined(BME280_64BITSUPPORT_PRESENT)
+		if (v_pressure_int64_u8) {
+			for (v_index_u32 = 0; v_index_u32 < v_length_u32;
+			v_index_u32++)
+				v_pressure_u32[v_offset_u32 + v_index_u32] =
+				bme280_batch_pressure_int64(cal_param,
+				a_t_fine_s32[v_index_u32],
+				v_uncomp_pressure_s32[v_offset_u32 + v_index_u32]);
+			continue;
+		}
+#endif
+		for (v_index_u32 = 0; v_index_u32 < v_length_u32; v_index_u32++)
+			v_pressure_u32[v_offset_u32 + v_index_u32] =
+			bme280_batch_pressure_int32(cal_param,
+			a_t_fine_s32[v_index_u32],
+			v_uncomp_pressure_s32[v_offset_u32 + v_index_u32]);
+	}
+	return SUCCESS;
+}
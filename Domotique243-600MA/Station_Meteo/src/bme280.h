@@ -1697,6 +1697,52 @@ u32 bme280_compensate_pressure_int64_twentyfour_bit_output(
 s32 v_uncom_pressure_s32);
 #endif
 /**************************************************************/
+/**\name	FUNCTION FOR BATCH COMPENSATION*/
+/**************************************************************/
+/*!
+ * @brief Number of samples compensated per block by
+ * bme280_compensate_batch_int32(), sized for the t_fine
+ * scratch array kept on the stack
+ */
+#define BME280_BATCH_BLOCK_SIZE	(256)
+/*!
+ * @brief Compensates an array of raw pressure, temperature
+ * and humidity samples, e.g. when replaying a log of raw ADC
+ * values with new calibration parameters
+ * @note Results are bit-exact with
+ * bme280_compensate_temperature_int32(),
+ * bme280_compensate_humidity_int32() and, depending on
+ * v_pressure_int64_u8, bme280_compensate_pressure_int32() or
+ * bme280_compensate_pressure_int64()
+ * @note cal_param->t_fine is not modified
+ *
+ *
+ *  @param cal_param : calibration parameters to use,
+ *  BME280_NULL for the ones of the initialized sensor
+ *  @param v_uncomp_pressure_s32 : array of uncompensated pressure
+ *  @param v_uncomp_temperature_s32 : array of uncompensated temperature
+ *  @param v_uncomp_humidity_s32 : array of uncompensated humidity
+ *  @param v_pressure_u32 : output array of pressure, in Pa or Q24.8 Pa
+ *  @param v_temperature_s32 : output array of temperature, in 0.01 DegC
+ *  @param v_humidity_u32 : output array of humidity, in Q22.10 %rH
+ *  @param v_count_u32 : number of samples in each array
+ *  @param v_pressure_int64_u8 : 1 for the 64 bit pressure formula
+ *
+ *
+ *	@return results of the compensation
+ *	@retval 0 -> Success
+ *	@retval -127 -> No calibration parameters
+ *	@retval -2 -> 64 bit pressure not supported
+ *
+ *
+*/
+BME280_RETURN_FUNCTION_TYPE bme280_compensate_batch_int32(
+const struct bme280_calibration_param_t *cal_param,
+const s32 *v_uncomp_pressure_s32, const s32 *v_uncomp_temperature_s32,
+const s32 *v_uncomp_humidity_s32, u32 *v_pressure_u32,
+s32 *v_temperature_s32, u32 *v_humidity_u32, u32 v_count_u32,
+u8 v_pressure_int64_u8);
+/**************************************************************/
 /**\name	FUNCTION FOR WAIT PERIOD*/
 /**************************************************************/
 /*!
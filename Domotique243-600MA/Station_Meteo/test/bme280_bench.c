@@ -0,0 +1,108 @@
+/*
+ * bme280_bench.c
+ *
+ * Host benchmark of the BME280 compensation: samples per second for the
+ * scalar functions of the driver and for bme280_compensate_batch_int32(),
+ * with the 32 and 64 bit pressure formulas, on a log of random raw values
+ * compensated with the datasheet calibration.
+ *   bme280_bench [samples] [runs]
+ */
+
+#include "bme280.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static struct bme280_t bme280;
+
+static s8 bench_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+	u8 i;
+	for (i = 0; i < cnt; i++)
+		reg_data[i] = (reg_addr + i == BME280_CHIP_ID_REG) ?
+			BME280_CHIP_ID : 0;
+	return 0;
+}
+
+static s8 bench_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+	return 0;
+}
+
+static void bench_delay(u32 msec)
+{
+}
+
+static double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	u32 count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	int runs = (argc > 2) ? atoi(argv[2]) : 10;
+	s32 *up = malloc(count * sizeof(s32));
+	s32 *ut = malloc(count * sizeof(s32));
+	s32 *uh = malloc(count * sizeof(s32));
+	u32 *p = malloc(count * sizeof(u32));
+	s32 *t = malloc(count * sizeof(s32));
+	u32 *h = malloc(count * sizeof(u32));
+	struct bme280_calibration_param_t *c = &bme280.cal_param;
+	u32 i, seed = 1;
+	u8 int64;
+	int run;
+	double start, scalar, batch;
+
+	if (!up || !ut || !uh || !p || !t || !h)
+		return 1;
+	bme280.bus_read = bench_bus_read;
+	bme280.bus_write = bench_bus_write;
+	bme280.delay_msec = bench_delay;
+	bme280.dev_addr = BME280_I2C_ADDRESS1;
+	bme280_init(&bme280);
+	c->dig_T1 = 27504; c->dig_T2 = 26435; c->dig_T3 = -1000;
+	c->dig_P1 = 36477; c->dig_P2 = -10685; c->dig_P3 = 3024;
+	c->dig_P4 = 2855; c->dig_P5 = 140; c->dig_P6 = -7;
+	c->dig_P7 = 15500; c->dig_P8 = -14600; c->dig_P9 = 6000;
+	c->dig_H1 = 75; c->dig_H2 = 362; c->dig_H3 = 0;
+	c->dig_H4 = 313; c->dig_H5 = 50; c->dig_H6 = 30;
+
+	/* around the datasheet sample, as a real log would be */
+	for (i = 0; i < count; i++) {
+		seed = seed * 1664525 + 1013904223;
+		ut[i] = 519888 + (s32)(seed >> 20) - 2048;
+		up[i] = 415148 + (s32)((seed >> 8) & 0x3FFF) - 8192;
+		uh[i] = 30000 + (s32)(seed & 0x1FFF);
+	}
+
+	for (int64 = 0; int64 <= 1; int64++) {
+		start = bench_now();
+		for (run = 0; run < runs; run++)
+			for (i = 0; i < count; i++) {
+				t[i] = bme280_compensate_temperature_int32(ut[i]);
+				p[i] = int64 ?
+					bme280_compensate_pressure_int64(up[i]) :
+					bme280_compensate_pressure_int32(up[i]);
+				h[i] = bme280_compensate_humidity_int32(uh[i]);
+			}
+		scalar = bench_now() - start;
+
+		start = bench_now();
+		for (run = 0; run < runs; run++)
+			bme280_compensate_batch_int32(c, up, ut, uh, p, t, h,
+				count, int64);
+		batch = bench_now() - start;
+
+		printf("%s pressure: scalar %6.1f Msamples/s, "
+			"batch %6.1f Msamples/s (x%.2f)\n",
+			int64 ? "int64" : "int32",
+			(double)count * runs / scalar / 1e6,
+			(double)count * runs / batch / 1e6, scalar / batch);
+	}
+	free(up); free(ut); free(uh);
+	free(p); free(t); free(h);
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * bme280_test.c
+ *
+ * Equivalence test of bme280_compensate_batch_int32() against the scalar
+ * compensation functions of the Bosch driver. For the datasheet calibration
+ * and for random calibration sets, every raw temperature and every raw
+ * pressure value of the 20 bit range is compensated, the humidity sweeping
+ * its 16 bit range along the way, with both pressure formulas. Exits with 1
+ * on the first mismatch.
+ */
+
+#include "bme280.h"
+#include <stdio.h>
+
+#define TEST_CAL_SETS	(16)
+#define TEST_CHUNK	(4096)
+#define TEST_RAW_20BIT	(0x100000)
+
+static struct bme280_t bme280;
+
+/* No sensor: the chip id reads back right, the calibration registers read 0 */
+static s8 test_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+	u8 i;
+	for (i = 0; i < cnt; i++)
+		reg_data[i] = (reg_addr + i == BME280_CHIP_ID_REG) ?
+			BME280_CHIP_ID : 0;
+	return 0;
+}
+
+static s8 test_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+	return 0;
+}
+
+static void test_delay(u32 msec)
+{
+}
+
+static u32 rand_state = 12345;
+
+static u32 test_rand(void)
+{
+	rand_state = rand_state * 1664525 + 1013904223;
+	return rand_state >> 8;
+}
+
+static void test_cal_param(int set)
+{
+	struct bme280_calibration_param_t *c = &bme280.cal_param;
+	if (set == 0) {
+		/* datasheet example */
+		c->dig_T1 = 27504; c->dig_T2 = 26435; c->dig_T3 = -1000;
+		c->dig_P1 = 36477; c->dig_P2 = -10685; c->dig_P3 = 3024;
+		c->dig_P4 = 2855; c->dig_P5 = 140; c->dig_P6 = -7;
+		c->dig_P7 = 15500; c->dig_P8 = -14600; c->dig_P9 = 6000;
+		c->dig_H1 = 75; c->dig_H2 = 362; c->dig_H3 = 0;
+		c->dig_H4 = 313; c->dig_H5 = 50; c->dig_H6 = 30;
+		return;
+	}
+	c->dig_T1 = test_rand(); c->dig_T2 = test_rand(); c->dig_T3 = test_rand();
+	c->dig_P1 = test_rand(); c->dig_P2 = test_rand(); c->dig_P3 = test_rand();
+	c->dig_P4 = test_rand(); c->dig_P5 = test_rand(); c->dig_P6 = test_rand();
+	c->dig_P7 = test_rand(); c->dig_P8 = test_rand(); c->dig_P9 = test_rand();
+	c->dig_H1 = test_rand(); c->dig_H2 = test_rand(); c->dig_H3 = test_rand();
+	/* H4 and H5 are 12 bit signed in the sensor */
+	c->dig_H4 = (s16)(test_rand() << 4) >> 4;
+	c->dig_H5 = (s16)(test_rand() << 4) >> 4;
+	c->dig_H6 = test_rand();
+}
+
+/*
+ * Compensates one chunk both ways and compares. sweep_t selects whether the
+ * temperature or the pressure walks the 20 bit range from first.
+ */
+static int test_chunk(int set, u32 first, int sweep_t, u8 int64)
+{
+	s32 up[TEST_CHUNK], ut[TEST_CHUNK], uh[TEST_CHUNK];
+	u32 p[TEST_CHUNK], h[TEST_CHUNK];
+	s32 t[TEST_CHUNK];
+	u32 i, sp, sh;
+	s32 st;
+
+	for (i = 0; i < TEST_CHUNK; i++) {
+		ut[i] = sweep_t ? (s32)(first + i) : (s32)(test_rand() & 0xFFFFF);
+		up[i] = sweep_t ? (s32)(test_rand() & 0xFFFFF) : (s32)(first + i);
+		uh[i] = (first + i) & 0xFFFF;
+	}
+	if (bme280_compensate_batch_int32(&bme280.cal_param, up, ut, uh,
+			p, t, h, TEST_CHUNK, int64) != SUCCESS) {
+		printf("cal set %d: batch compensation failed\n", set);
+		return 1;
+	}
+	for (i = 0; i < TEST_CHUNK; i++) {
+		st = bme280_compensate_temperature_int32(ut[i]);
+		sp = int64 ? bme280_compensate_pressure_int64(up[i]) :
+			bme280_compensate_pressure_int32(up[i]);
+		sh = bme280_compensate_humidity_int32(uh[i]);
+		if (st != t[i] || sp != p[i] || sh != h[i]) {
+			printf("cal set %d, %s pressure: raw T=%ld P=%ld H=%ld\n"
+				"  scalar T=%ld P=%lu H=%lu\n"
+				"  batch  T=%ld P=%lu H=%lu\n", set,
+				int64 ? "int64" : "int32",
+				(long)ut[i], (long)up[i], (long)uh[i],
+				(long)st, (unsigned long)sp, (unsigned long)sh,
+				(long)t[i], (unsigned long)p[i],
+				(unsigned long)h[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(void)
+{
+	int set, sweep_t;
+	u8 int64;
+	u32 first;
+	unsigned long samples = 0;
+
+	bme280.bus_read = test_bus_read;
+	bme280.bus_write = test_bus_write;
+	bme280.delay_msec = test_delay;
+	bme280.dev_addr = BME280_I2C_ADDRESS1;
+	if (bme280_init(&bme280) != SUCCESS) {
+		printf("bme280_init failed\n");
+		return 1;
+	}
+
+	for (set = 0; set < TEST_CAL_SETS; set++) {
+		test_cal_param(set);
+		for (int64 = 0; int64 <= 1; int64++)
+			for (sweep_t = 0; sweep_t <= 1; sweep_t++)
+				for (first = 0; first < TEST_RAW_20BIT;
+						first += TEST_CHUNK) {
+					if (test_chunk(set, first, sweep_t, int64))
+						return 1;
+					samples += TEST_CHUNK;
+				}
+	}
+	printf("bme280 batch == scalar: %d calibration sets, %lu samples\n",
+		TEST_CAL_SETS, samples);
+	return 0;
+}
@@ -0,0 +1,310 @@
+/*
+ * gateway_test.cpp
+ *
+ * Test of the MiWi gateway daemon (MiWiGateway.h) without the firmware.
+ *
+ * Framing: the CRC16 check value, random frames encoded back to back and fed
+ * one byte at a time to FrameDecoder, then corrupted and oversized frames,
+ * after which the decoder must find the next frame again.
+ *
+ * Sequence numbers: the daemon gets a pseudo terminal as its serial line, the
+ * test plays the firmware on the master side and two TCP clients. Both
+ * clients use the same sequence numbers, the statuses are answered out of
+ * order and one request is never answered. Each client must get its own
+ * statuses with its own numbers, the messages from the nodes must go to both,
+ * and no more than GW_MAX_IN_FLIGHT requests may wait on the serial line.
+ */
+
+#include "MiWiGateway.h"
+#include<string>
+#include<vector>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fcntl.h>
+#include<poll.h>
+#include<unistd.h>
+#include<time.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+using namespace std;
+using namespace exploringBB;
+
+#define TEST_FRAMES 20000
+
+static int failures = 0;
+
+static void check(bool ok, const char *what){
+	if (!ok){
+		printf("gateway_test: FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+static unsigned int randState = 12345;
+
+static unsigned int testRand(){
+	randState = randState * 1103515245u + 12345u;
+	return randState >> 8;
+}
+
+static GatewayFrame randomFrame(){
+	GatewayFrame f;
+	f.type = testRand();
+	f.seq = testRand();
+	unsigned int length = testRand() % (GW_MAX_DATA + 1);
+	for (unsigned int i=0; i<length; i++)
+		f.data += (char)((testRand() % 3 == 0) ? 0 : testRand());  // many zeros for COBS
+	return f;
+}
+
+static bool sameFrame(const GatewayFrame &a, const GatewayFrame &b){
+	return a.type == b.type && a.seq == b.seq && a.data == b.data;
+}
+
+static void testFraming(){
+	check(gatewayCRC16((const unsigned char *) "123456789", 9) == 0x29B1, "CRC16 check value");
+
+	vector<GatewayFrame> frames;
+	string stream;
+	for (int i=0; i<TEST_FRAMES; i++){
+		frames.push_back(randomFrame());
+		encodeGatewayFrame(stream, frames.back());
+	}
+	GatewayFrame edge;
+	edge.type = 0;
+	edge.seq = 0;
+	edge.data.assign(GW_MAX_DATA, '\0');
+	frames.push_back(edge);
+	encodeGatewayFrame(stream, edge);
+	edge.data.assign(GW_MAX_DATA, '\xff');
+	frames.push_back(edge);
+	encodeGatewayFrame(stream, edge);
+
+	unsigned int zeros = 0;
+	for (unsigned int i=0; i<stream.size(); i++) if (stream[i] == 0) zeros++;
+	check(zeros == frames.size(), "COBS: a zero inside an encoded frame");
+
+	FrameDecoder decoder;
+	GatewayFrame out;
+	unsigned int decoded = 0;
+	bool same = true;
+	for (unsigned int i=0; i<stream.size(); i++){
+		if (decoder.push(stream[i], out)){
+			if (decoded >= frames.size() || !sameFrame(out, frames[decoded])) same = false;
+			decoded++;
+		}
+	}
+	check(decoded == frames.size() && same && decoder.crcErrors == 0, "round trip of random frames");
+
+	// One byte changed, never to 0: that frame is lost, the next one is not.
+	// A larger code on the last COBS block still gives the right bytes, the
+	// frame may then come out unchanged, never altered.
+	unsigned int lost = 0, wrong = 0;
+	for (int i=0; i<TEST_FRAMES / 10; i++){
+		GatewayFrame bad = randomFrame(), good = randomFrame();
+		string encoded;
+		encodeGatewayFrame(encoded, bad);
+		unsigned int at = testRand() % (encoded.size() - 1);
+		unsigned char flip = 1 + testRand() % 255;
+		if ((unsigned char)(encoded[at] ^ flip) == 0) flip ^= 1;
+		encoded[at] ^= flip;
+		encodeGatewayFrame(encoded, good);
+		bool gotGood = false;
+		for (unsigned int j=0; j<encoded.size(); j++){
+			if (!decoder.push(encoded[j], out)) continue;
+			if (sameFrame(out, good)) gotGood = true;
+			else if (!sameFrame(out, bad)) wrong++;
+		}
+		if (!gotGood) lost++;
+	}
+	check(wrong == 0, "corrupted frames accepted");
+	check(lost == 0, "frame after a corrupted one lost");
+
+	string oversized(3 * GW_MAX_DATA, '\x05');
+	oversized += '\0';
+	encodeGatewayFrame(oversized, frames[0]);
+	decoded = 0;
+	for (unsigned int j=0; j<oversized.size(); j++)
+		if (decoder.push(oversized[j], out) && sameFrame(out, frames[0])) decoded++;
+	check(decoded == 1, "frame after an oversized one lost");
+}
+
+static unsigned long long nowMs(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * One end of the daemon: a descriptor and the frames read from it so far.
+ */
+struct Peer {
+	int fd;
+	FrameDecoder decoder;
+	vector<GatewayFrame> frames;
+};
+
+static void readPeer(Peer &peer){
+	unsigned char buffer[512];
+	ssize_t n;
+	GatewayFrame frame;
+	while ((n = ::read(peer.fd, buffer, sizeof(buffer))) > 0){
+		for (ssize_t i=0; i<n; i++)
+			if (peer.decoder.push(buffer[i], frame)) peer.frames.push_back(frame);
+	}
+}
+
+static void writeFrame(int fd, unsigned char type, unsigned char seq, const string &data){
+	GatewayFrame frame;
+	string out;
+	frame.type = type;
+	frame.seq = seq;
+	frame.data = data;
+	encodeGatewayFrame(out, frame);
+	if (::write(fd, out.data(), out.size()) != (ssize_t) out.size()) perror("gateway_test: write");
+}
+
+/**
+ * Run the daemon for ms milliseconds, then read what it sent to the peers.
+ */
+static void run(MiWiGateway &gw, unsigned int ms, Peer *peers[], unsigned int count){
+	unsigned long long end = nowMs() + ms;
+	while (nowMs() < end) gw.loop(5);
+	for (unsigned int i=0; i<count; i++) readPeer(*peers[i]);
+}
+
+static int connectClient(int port){
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (::connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0){
+		perror("gateway_test: connect");
+		return -1;
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return fd;
+}
+
+static int freePort(){
+	int s = ::socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	::bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	getsockname(s, (struct sockaddr *) &addr, &len);
+	::close(s);
+	return ntohs(addr.sin_port);
+}
+
+static bool hasStatus(const Peer &peer, unsigned char seq, unsigned char result){
+	for (unsigned int i=0; i<peer.frames.size(); i++){
+		const GatewayFrame &f = peer.frames[i];
+		if (f.type == GW_STATUS && f.seq == seq && f.data.size() == 1 && (unsigned char) f.data[0] == result)
+			return true;
+	}
+	return false;
+}
+
+static void testRemap(){
+	Peer firmware, a, b;
+	firmware.fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (firmware.fd < 0 || grantpt(firmware.fd) < 0 || unlockpt(firmware.fd) < 0){
+		perror("gateway_test: posix_openpt");
+		failures++;
+		return;
+	}
+	fcntl(firmware.fd, F_SETFL, O_NONBLOCK);
+	int port = freePort();
+	MiWiGateway gw(ptsname(firmware.fd), port);
+	if (gw.open() < 0){
+		failures++;
+		return;
+	}
+	a.fd = connectClient(port);
+	b.fd = connectClient(port);
+	Peer *all[] = { &firmware, &a, &b };
+	run(gw, 50, all, 3);
+
+	// Same sequence numbers on both clients, more requests than GW_MAX_IN_FLIGHT
+	writeFrame(a.fd, GW_SEND, 7, string("\x02\x34\x12" "A", 4));
+	run(gw, 20, all, 3);
+	writeFrame(b.fd, GW_SEND, 7, string("\x02\x34\x12" "B", 4));
+	run(gw, 20, all, 3);
+	writeFrame(a.fd, GW_PING, 9, "");
+	run(gw, 50, all, 3);
+	check(firmware.frames.size() == GW_MAX_IN_FLIGHT, "more than GW_MAX_IN_FLIGHT requests on the serial line");
+	if (firmware.frames.size() < 2){
+		failures++;
+		return;
+	}
+	unsigned char seqA = firmware.frames[0].seq, seqB = firmware.frames[1].seq;
+	check(seqA != 0 && seqB != 0 && seqA != seqB, "remapped sequence numbers not unique and nonzero");
+	check(firmware.frames[0].data[3] == 'A' && firmware.frames[1].data[3] == 'B', "requests sent out of order");
+
+	// Answered in reverse order, B's frees a slot for the ping
+	writeFrame(firmware.fd, GW_STATUS, seqB, string(1, (char) GW_MIWI_FAILED));
+	run(gw, 50, all, 3);
+	check(hasStatus(b, 7, GW_MIWI_FAILED) && b.frames.size() == 1, "status of B not sent back to B with its number");
+	check(a.frames.empty(), "status of B sent to A");
+	check(firmware.frames.size() == 3 && firmware.frames[2].type == GW_PING, "waiting request not sent after a status");
+	unsigned char seqPing = firmware.frames.size() == 3 ? firmware.frames[2].seq : 0;
+	check(seqPing != seqA && seqPing != 0, "sequence number of a pending request reused");
+	writeFrame(firmware.fd, GW_STATUS, seqPing, string(1, (char) GW_OK));
+	writeFrame(firmware.fd, GW_STATUS, seqA, string(1, (char) GW_OK));
+	run(gw, 50, all, 3);
+	check(hasStatus(a, 9, GW_OK) && hasStatus(a, 7, GW_OK) && a.frames.size() == 2, "statuses of A lost or renumbered");
+	check(b.frames.size() == 1, "status of A sent to B");
+
+	// A message from a node goes to every client
+	writeFrame(firmware.fd, GW_RECEIVED, 0, string("\x02\x34\x12\xc8\xff" "hello", 10));
+	run(gw, 50, all, 3);
+	check(a.frames.size() == 3 && b.frames.size() == 2 && a.frames[2].type == GW_RECEIVED &&
+			sameFrame(a.frames[2], b.frames[1]), "message from a node not sent to both clients");
+
+	// Never answered: GW_NO_ANSWER after GW_STATUS_TIMEOUT, the late status is dropped
+	writeFrame(a.fd, GW_PING, 11, "");
+	run(gw, 50, all, 3);
+	unsigned char seqLost = firmware.frames.back().seq;
+	unsigned long long start = nowMs();
+	while (!hasStatus(a, 11, GW_NO_ANSWER) && nowMs() - start < 3 * GW_STATUS_TIMEOUT) run(gw, 20, all, 3);
+	unsigned long long waited = nowMs() - start;
+	check(hasStatus(a, 11, GW_NO_ANSWER), "no GW_NO_ANSWER for a request left without status");
+	check(waited + 50 >= GW_STATUS_TIMEOUT, "GW_NO_ANSWER before GW_STATUS_TIMEOUT");
+	unsigned int before = a.frames.size();
+	writeFrame(firmware.fd, GW_STATUS, seqLost, string(1, (char) GW_OK));
+	run(gw, 50, all, 3);
+	check(a.frames.size() == before, "status after GW_NO_ANSWER sent to the client");
+
+	// A client that leaves with a request pending
+	writeFrame(b.fd, GW_PING, 12, "");
+	run(gw, 50, all, 3);
+	unsigned char seqGone = firmware.frames.back().seq;
+	::close(b.fd);
+	run(gw, 50, all, 2);
+	writeFrame(firmware.fd, GW_STATUS, seqGone, string(1, (char) GW_OK));
+	writeFrame(a.fd, GW_PING, 13, "");
+	run(gw, 50, all, 2);
+	check(firmware.frames.back().type == GW_PING && firmware.frames.back().seq != seqGone,
+			"request after a client left not sent");
+	writeFrame(firmware.fd, GW_STATUS, firmware.frames.back().seq, string(1, (char) GW_OK));
+	run(gw, 50, all, 2);
+	check(hasStatus(a, 13, GW_OK) && a.frames.size() == before + 1, "status lost after a client left");
+
+	::close(a.fd);
+	gw.close();
+	::close(firmware.fd);
+}
+
+int main(){
+	testFraming();
+	testRemap();
+	printf("gateway_test: %s\n", failures ? "FAILED" : "framing and sequence number remapping passed");
+	return failures ? 1 : 0;
+}
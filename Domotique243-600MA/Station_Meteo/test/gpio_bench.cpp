@@ -0,0 +1,176 @@
+/*
+ * gpio_bench.cpp
+ *
+ * Host benchmark of the sysfs GPIO class against the character-device backend
+ * (GPIOChip.h) on a gpio-sim chip. gpio_sim.sh creates the chip and starts this
+ * program with its numbers:
+ *
+ *   gpio_bench <chip> <sysfs base> <sim dir> [iterations]
+ *
+ * Toggle rate: setValue() in a loop on line 0 (sysfs) then on lines 0,2,3,4
+ * (character device, one line and four lines per ioctl).
+ * Edge latency: the input line 1 is driven through the gpio-sim "pull"
+ * attribute and the time from the write to the callback is measured, with
+ * GPIO::waitForEdge(callback) then with GPIOEventLoop.
+ */
+
+#include "GPIO.h"
+#include "GPIOChip.h"
+#include<iostream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<ctime>
+#include<fcntl.h>
+#include<unistd.h>
+using namespace std;
+using namespace exploringBB;
+
+#define BENCH_EDGES 200
+#define BENCH_EDGE_TIMEOUT 100000000ULL  // 100ms in ns
+
+static unsigned long long now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Set from the callbacks, read from the main thread
+static volatile unsigned long long edgeSeen;
+static volatile unsigned long long edgeKernel;
+
+static int sysfsCallback(int result){
+	if (result == 0) edgeSeen = now();
+	return 0;
+}
+
+static void chipCallback(int chip, unsigned int offset, GPIO::EDGE edge,
+		unsigned long long timestamp, void *context){
+	edgeKernel = timestamp;
+	edgeSeen = now();
+}
+
+/**
+ * Drive a gpio-sim input line from outside, as a switch on the pin would.
+ */
+static int simPull(const string &simDir, unsigned int offset, bool high){
+	ostringstream s;
+	s << simDir << "/sim_gpio" << offset << "/pull";
+	int fd = open(s.str().c_str(), O_WRONLY);
+	if (fd < 0){
+		perror("gpio_bench: Failed to open the pull attribute");
+		return -1;
+	}
+	const char *value = high ? "pull-up" : "pull-down";
+	int result = (::write(fd, value, strlen(value)) > 0) ? 0 : -1;
+	close(fd);
+	return result;
+}
+
+static void report(const char *name, vector<unsigned long long> &samples){
+	if (samples.empty()){
+		printf("%-28s no edge received\n", name);
+		return;
+	}
+	sort(samples.begin(), samples.end());
+	printf("%-28s n=%3u  min %7.1f  median %7.1f  p99 %7.1f us\n", name,
+			(unsigned int) samples.size(), samples[0] / 1000.0,
+			samples[samples.size() / 2] / 1000.0,
+			samples[samples.size() * 99 / 100] / 1000.0);
+}
+
+/**
+ * Toggle the input line BENCH_EDGES times and collect the delay between the
+ * pull write and the callback. Each edge waits for its callback (or a timeout)
+ * before the next one so that both backends see every edge.
+ */
+static void edgeLatency(const string &simDir, vector<unsigned long long> &toCallback,
+		vector<unsigned long long> *toKernel){
+	bool level = false;
+	for (int i=0; i<BENCH_EDGES; i++){
+		level = !level;
+		edgeSeen = 0;
+		unsigned long long start = now();
+		if (simPull(simDir, 1, level) < 0) return;
+		while (edgeSeen == 0 && now() - start < BENCH_EDGE_TIMEOUT) sched_yield();
+		if (edgeSeen != 0){
+			toCallback.push_back(edgeSeen - start);
+			if (toKernel) toKernel->push_back(edgeKernel - start);
+		}
+		usleep(2000);  // let the sysfs thread re-arm its poll
+	}
+}
+
+int main(int argc, char *argv[]){
+	if (argc < 4){
+		fprintf(stderr, "usage: %s <chip> <sysfs base> <sim dir> [iterations]\n", argv[0]);
+		return 1;
+	}
+	int chip = atoi(argv[1]);
+	int base = atoi(argv[2]);
+	string simDir = argv[3];
+	int iterations = (argc > 4) ? atoi(argv[4]) : 10000;
+	unsigned long long start;
+
+	simPull(simDir, 1, false);
+
+	// sysfs: export, toggle and wait for edges, then unexport for the chardev run
+	{
+		GPIO out(base), in(base + 1);
+		out.setDirection(GPIO::OUTPUT);
+		start = now();
+		for (int i=0; i<iterations; i++) out.setValue((i & 1) ? GPIO::HIGH : GPIO::LOW);
+		double sysfsRate = iterations / ((now() - start) / 1e9);
+		out.streamOpen();
+		start = now();
+		for (int i=0; i<iterations; i++) out.streamWrite((i & 1) ? GPIO::HIGH : GPIO::LOW);
+		double streamRate = iterations / ((now() - start) / 1e9);
+		out.streamClose();
+		printf("%-28s %10.0f toggles/s\n", "sysfs setValue()", sysfsRate);
+		printf("%-28s %10.0f toggles/s\n", "sysfs streamWrite()", streamRate);
+
+		vector<unsigned long long> latency;
+		in.setDirection(GPIO::INPUT);
+		in.setEdgeType(GPIO::BOTH);
+		in.waitForEdge(&sysfsCallback);
+		usleep(10000);
+		edgeLatency(simDir, latency, NULL);
+		// the poll thread is blocked in epoll_wait: one more edge lets it see the cancel
+		in.waitForEdgeCancel();
+		simPull(simDir, 1, in.getValue() == GPIO::LOW);
+		usleep(10000);
+		report("sysfs pull -> callback", latency);
+	}
+
+	{
+		const unsigned int offsets[] = { 0, 2, 3, 4 };
+		GPIOLines out(chip, offsets, 4, GPIO::OUTPUT);
+		if (!out.isOpen()) return 1;
+		start = now();
+		for (int i=0; i<iterations; i++) out.setValue(0, (i & 1) ? GPIO::HIGH : GPIO::LOW);
+		double lineRate = iterations / ((now() - start) / 1e9);
+		GPIO::VALUE values[4];
+		start = now();
+		for (int i=0; i<iterations; i++){
+			for (int j=0; j<4; j++) values[j] = (i & 1) ? GPIO::HIGH : GPIO::LOW;
+			out.setValues(values);
+		}
+		double batchRate = iterations / ((now() - start) / 1e9);
+		printf("%-28s %10.0f toggles/s\n", "chardev setValue()", lineRate);
+		printf("%-28s %10.0f toggles/s (x4 lines)\n", "chardev setValues()", batchRate);
+
+		GPIOEventLoop loop;
+		vector<unsigned long long> latency, kernel;
+		if (loop.addLine(chip, 1, GPIO::BOTH, &chipCallback) < 0) return 1;
+		loop.start();
+		edgeLatency(simDir, latency, &kernel);
+		loop.stop();
+		report("chardev pull -> kernel", kernel);
+		report("chardev pull -> callback", latency);
+	}
+	return 0;
+}
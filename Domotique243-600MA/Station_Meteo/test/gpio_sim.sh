@@ -0,0 +1,25 @@
+#!/bin/sh
+# Create a 5-line gpio-sim chip and run gpio_bench on it.
+# Needs root, CONFIG_GPIO_SIM and CONFIG_GPIO_SYSFS (for the sysfs side).
+#   ./gpio_sim.sh [iterations]
+
+CFG=/sys/kernel/config/gpio-sim/gpio_bench
+
+modprobe gpio-sim || exit 1
+mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+
+mkdir -p $CFG/bank0
+echo 5 > $CFG/bank0/num_lines
+echo 1 > $CFG/live || exit 1
+
+CHIP=$(cat $CFG/bank0/chip_name)
+SIMDIR=/sys/devices/platform/$(cat $CFG/dev_name)/$CHIP
+BASE=$(ls -d $SIMDIR/gpio/gpiochip* 2>/dev/null | sed 's/.*gpiochip//')
+if [ -z "$BASE" ]; then
+	echo "no sysfs GPIO for $CHIP (CONFIG_GPIO_SYSFS?)"
+else
+	./gpio_bench ${CHIP#gpiochip} $BASE $SIMDIR $1
+fi
+
+echo 0 > $CFG/live
+rmdir $CFG/bank0 $CFG
@@ -0,0 +1,336 @@
+/*
+ * mqtt_test.cpp
+ *
+ * Test of MQTTPublisher against a loopback broker run in a thread of this
+ * program. The Makefile shortens the delays of MQTTPublisher.h (keep alive
+ * 2 s, ack timeout 1 s, retry delay 1 s) so that the whole run takes a few
+ * seconds:
+ *   - every message is acknowledged, in order and without DUP;
+ *   - QoS 1: the broker ignores the first PUBLISH of each message, which
+ *     must come again with DUP after MQTT_ACK_TIMEOUT;
+ *   - spooling: messages published while nothing listens go to the spool
+ *     file and are replayed first, in order, once the broker is up;
+ *   - keep alive: the broker never answers PINGREQ, the connection must be
+ *     dropped after MQTT_KEEP_ALIVE and then come back.
+ *
+ *   mqtt_test [messages]
+ *
+ * With a message count the first test also prints the messages per second
+ * over loopback, from the first publish() to the last PUBACK.
+ */
+
+#include "MQTTPublisher.h"
+#include<string>
+#include<vector>
+#include<sstream>
+#include<fstream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<poll.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+using namespace std;
+using namespace exploringBB;
+
+struct Publish {
+	string topic;
+	string payload;
+	unsigned short id;
+	bool dup;
+};
+
+struct Broker {
+	int listener;
+	int port;
+	bool ackNew;         // PUBACK the first PUBLISH of a message, not only the DUP
+	bool answerPing;
+	volatile bool stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	vector<Publish> received;
+	int connects;
+	int pings;
+};
+
+static int failures = 0;
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void check(bool ok, const char *what){
+	if (!ok){
+		printf("mqtt_test: FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+static void brokerSend(int c, const char *packet, size_t len){
+	if (::send(c, packet, len, MSG_NOSIGNAL) != (ssize_t) len) perror("mqtt_test: broker send");
+}
+
+/**
+ * Serve one client until it disconnects or the broker stops.
+ */
+static void brokerServe(Broker *b, int c){
+	string rx;
+	char buffer[4096];
+	while (!b->stop){
+		struct pollfd pfd = { c, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0) continue;
+		ssize_t n = ::recv(c, buffer, sizeof(buffer), 0);
+		if (n <= 0) break;
+		rx.append(buffer, n);
+		while (rx.size() >= 2){
+			unsigned int length = 0, multiplier = 1, i = 1;
+			while (i < rx.size() && (rx[i] & 0x80)){
+				length += (rx[i] & 0x7F) * multiplier;
+				multiplier *= 128;
+				i++;
+			}
+			if (i >= rx.size()) break;
+			length += (rx[i] & 0x7F) * multiplier;
+			if (rx.size() < i + 1 + length) break;
+			unsigned char header = rx[0];
+			string body = rx.substr(i + 1, length);
+			rx.erase(0, i + 1 + length);
+
+			pthread_mutex_lock(&b->lock);
+			switch (header >> 4){
+			case 1:     // CONNECT
+				b->connects++;
+				brokerSend(c, "\x20\x02\x00\x00", 4);
+				break;
+			case 3: {   // PUBLISH, QoS 1
+				Publish p;
+				unsigned int topicLength = ((unsigned char) body[0] << 8) | (unsigned char) body[1];
+				p.topic = body.substr(2, topicLength);
+				p.id = ((unsigned char) body[2 + topicLength] << 8) | (unsigned char) body[3 + topicLength];
+				p.payload = body.substr(4 + topicLength);
+				p.dup = (header & 0x08) != 0;
+				b->received.push_back(p);
+				if (p.dup || b->ackNew){
+					char ack[4] = { 0x40, 0x02, (char)(p.id >> 8), (char)(p.id & 0xFF) };
+					brokerSend(c, ack, 4);
+				}
+				break;
+			}
+			case 12:    // PINGREQ
+				b->pings++;
+				if (b->answerPing) brokerSend(c, "\xd0\x00", 2);
+				break;
+			}
+			pthread_mutex_unlock(&b->lock);
+		}
+	}
+	::close(c);
+}
+
+static void *brokerThread(void *value){
+	Broker *b = static_cast<Broker*>(value);
+	while (!b->stop){
+		struct pollfd pfd = { b->listener, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0) continue;
+		int c = ::accept(b->listener, NULL, NULL);
+		if (c >= 0) brokerServe(b, c);
+	}
+	return NULL;
+}
+
+/**
+ * Listen on 127.0.0.1, on an ephemeral port if port is 0.
+ * @return the socket, -1 on failure
+ */
+static int brokerListen(int &port){
+	int s = ::socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if (::bind(s, (struct sockaddr *) &addr, sizeof(addr)) < 0 || ::listen(s, 1) < 0 ||
+			getsockname(s, (struct sockaddr *) &addr, &len) < 0){
+		perror("mqtt_test: broker listen");
+		::close(s);
+		return -1;
+	}
+	port = ntohs(addr.sin_port);
+	return s;
+}
+
+static bool brokerStart(Broker &b, int port, bool ackNew, bool answerPing){
+	b.port = port;
+	b.listener = brokerListen(b.port);
+	if (b.listener < 0) return false;
+	b.ackNew = ackNew;
+	b.answerPing = answerPing;
+	b.stop = false;
+	b.connects = 0;
+	b.pings = 0;
+	b.received.clear();
+	pthread_mutex_init(&b.lock, NULL);
+	return pthread_create(&b.thread, NULL, &brokerThread, &b) == 0;
+}
+
+static void brokerStop(Broker &b){
+	b.stop = true;
+	pthread_join(b.thread, NULL);
+	::close(b.listener);
+	pthread_mutex_destroy(&b.lock);
+}
+
+static unsigned int brokerReceived(Broker &b){
+	pthread_mutex_lock(&b.lock);
+	unsigned int n = b.received.size();
+	pthread_mutex_unlock(&b.lock);
+	return n;
+}
+
+/**
+ * Run the publisher until nothing is pending and the broker has count
+ * messages, or the time is out.
+ */
+static bool settle(MQTTPublisher &p, Broker &b, unsigned int count, double seconds){
+	double deadline = now() + seconds;
+	while (now() < deadline){
+		if (p.loop(50) != 0) usleep(10000);
+		if (p.isConnected() && p.getPending() == 0 && brokerReceived(b) >= count) return true;
+	}
+	return false;
+}
+
+static string payload(int i){
+	ostringstream s;
+	s << "{\"i\":" << i << "}";
+	return s.str();
+}
+
+static unsigned int spoolLines(const string &path){
+	ifstream fs(path.c_str());
+	string line;
+	unsigned int n = 0;
+	while (getline(fs, line)) n++;
+	return n;
+}
+
+static void testInOrder(const string &spoolPath, int count, bool bench){
+	Broker b;
+	if (!brokerStart(b, 0, true, true)){ failures++; return; }
+	{
+		MQTTPublisher p("127.0.0.1", "mqtt_test", spoolPath, b.port);
+		double start = now();
+		for (int i=0; i<count; i++) p.publish("station/bme280", payload(i));
+		p.flush();
+		check(settle(p, b, count, 30), "in order: not every message acknowledged");
+		double elapsed = now() - start;
+		bool ordered = b.received.size() == (unsigned int) count;
+		for (unsigned int i=0; ordered && i<b.received.size(); i++)
+			ordered = b.received[i].payload == payload(i) && !b.received[i].dup;
+		check(ordered, "in order: messages lost, reordered or resent");
+		if (bench) printf("mqtt_test: %d messages acknowledged in %.3f s, %.0f msgs/s\n",
+				count, elapsed, count / elapsed);
+	}
+	brokerStop(b);
+}
+
+static void testRetransmit(const string &spoolPath){
+	Broker b;
+	if (!brokerStart(b, 0, false, true)){ failures++; return; }
+	{
+		MQTTPublisher p("127.0.0.1", "mqtt_test", spoolPath, b.port);
+		for (int i=0; i<3; i++) p.publish("station/bme280", payload(i));
+		p.flush();
+		check(settle(p, b, 6, MQTT_ACK_TIMEOUT * 4 + 2), "QoS 1: messages not acknowledged after the resend");
+		bool resent = b.received.size() >= 6;
+		for (unsigned int i=0; resent && i<3; i++){
+			resent = !b.received[i].dup && b.received[i].payload == payload(i);
+			bool found = false;
+			for (unsigned int j=3; j<b.received.size(); j++){
+				if (b.received[j].dup && b.received[j].id == b.received[i].id &&
+						b.received[j].payload == b.received[i].payload) found = true;
+			}
+			resent = resent && found;
+		}
+		check(resent, "QoS 1: a message was not resent with DUP and the same identifier");
+	}
+	brokerStop(b);
+}
+
+static void testSpool(const string &spoolPath){
+	// A port where nothing listens yet
+	int port = 0;
+	int s = brokerListen(port);
+	::close(s);
+
+	Broker b;
+	{
+		MQTTPublisher p("127.0.0.1", "mqtt_test", spoolPath, port);
+		for (int i=0; i<5; i++) p.publish("station/bme280", payload(i));
+		check(!p.isConnected() && p.getPending() == 0, "spool: messages kept in memory without broker");
+		check(spoolLines(spoolPath) == 5, "spool: the spool file does not hold the 5 messages");
+
+		// The next publish() reconnects, once the retry delay is over, and
+		// must send the spooled messages before its own
+		if (!brokerStart(b, port, true, true)){ failures++; return; }
+		sleep(MQTT_RETRY_DELAY + 1);
+		p.publish("station/bme280", payload(5));
+		check(p.isConnected(), "spool: no reconnection after the retry delay");
+		check(settle(p, b, 6, 5), "spool: the spooled messages were not replayed");
+		bool ordered = b.received.size() == 6;
+		for (unsigned int i=0; ordered && i<b.received.size(); i++)
+			ordered = b.received[i].payload == payload(i);
+		check(ordered, "spool: the replay is not oldest first, before the new message");
+		check(spoolLines(spoolPath) == 0, "spool: the spool file was not emptied");
+	}
+	brokerStop(b);
+}
+
+static void testPingTimeout(const string &spoolPath){
+	Broker b;
+	if (!brokerStart(b, 0, true, false)){ failures++; return; }
+	{
+		MQTTPublisher p("127.0.0.1", "mqtt_test", spoolPath, b.port);
+		p.publish("station/bme280", payload(0));
+		p.flush();
+		check(settle(p, b, 1, 5), "keep alive: first message not acknowledged");
+
+		double start = now();
+		while (p.isConnected() && now() - start < MQTT_KEEP_ALIVE * 4) p.loop(50);
+		double elapsed = now() - start;
+		check(!p.isConnected(), "keep alive: connection kept without PINGRESP");
+		check(b.pings == 1, "keep alive: not exactly one PINGREQ before the drop");
+		check(elapsed >= MQTT_KEEP_ALIVE, "keep alive: connection dropped before MQTT_KEEP_ALIVE");
+
+		p.publish("station/bme280", payload(1));
+		check(settle(p, b, 2, MQTT_RETRY_DELAY * 4 + 2), "keep alive: no reconnection after the drop");
+		check(b.connects == 2 && b.received.size() == 2 && b.received[1].payload == payload(1),
+				"keep alive: the message of the dead connection was not delivered after it");
+	}
+	brokerStop(b);
+}
+
+int main(int argc, char *argv[]){
+	int count = (argc > 1) ? atoi(argv[1]) : 1000;
+	ostringstream path;
+	path << "/tmp/mqtt_test." << getpid() << ".spool";
+	string spoolPath = path.str();
+	unlink(spoolPath.c_str());
+
+	testInOrder(spoolPath, count, argc > 1);
+	testRetransmit(spoolPath);
+	testSpool(spoolPath);
+	testPingTimeout(spoolPath);
+
+	unlink(spoolPath.c_str());
+	printf("mqtt_test: %s\n", failures ? "FAILED" : "in order, QoS 1 resend, spool replay and keep alive passed");
+	return failures ? 1 : 0;
+}
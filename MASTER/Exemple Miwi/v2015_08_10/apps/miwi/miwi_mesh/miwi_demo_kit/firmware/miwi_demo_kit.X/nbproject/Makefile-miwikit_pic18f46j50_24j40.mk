@@ -45,17 +45,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=../../../../../../framework/driver/mrf_miwi/src/drv_mrf_miwi_24j40.c ../../../../../../framework/miwi/src/miwi_mesh.c ../../../../../../framework/miwi/src/miwi_nvm.c ../src/system_config/miwikit_pic18f46j50_24j40/lcd.c ../src/system_config/miwikit_pic18f46j50_24j40/serial_flash.c ../src/system_config/miwikit_pic18f46j50_24j40/system.c ../src/system_config/miwikit_pic18f46j50_24j40/delay.c ../src/system_config/miwikit_pic18f46j50_24j40/symbol.c ../src/system_config/miwikit_pic18f46j50_24j40/button.c ../src/system_config/miwikit_pic18f46j50_24j40/spi.c ../src/system_config/miwikit_pic18f46j50_24j40/eeprom.c ../src/main.c ../src/door_unlock.c ../src/pan.c ../src/student.c ../src/teacher.c ../src/projector_screen.c ../src/network.c ../src/computer_control.c ../src/demo_pan.c ../src/demo_mouvement.c ../src/demo_911.c ../src/soft_uart.c
+SOURCEFILES_QUOTED_IF_SPACED=../../../../../../framework/driver/mrf_miwi/src/drv_mrf_miwi_24j40.c ../../../../../../framework/miwi/src/miwi_mesh.c ../../../../../../framework/miwi/src/miwi_nvm.c ../src/system_config/miwikit_pic18f46j50_24j40/lcd.c ../src/system_config/miwikit_pic18f46j50_24j40/serial_flash.c ../src/system_config/miwikit_pic18f46j50_24j40/system.c ../src/system_config/miwikit_pic18f46j50_24j40/delay.c ../src/system_config/miwikit_pic18f46j50_24j40/symbol.c ../src/system_config/miwikit_pic18f46j50_24j40/button.c ../src/system_config/miwikit_pic18f46j50_24j40/spi.c ../src/system_config/miwikit_pic18f46j50_24j40/eeprom.c ../src/main.c ../src/door_unlock.c ../src/pan.c ../src/student.c ../src/teacher.c ../src/projector_screen.c ../src/network.c ../src/computer_control.c ../src/demo_pan.c ../src/demo_mouvement.c ../src/demo_911.c ../src/soft_uart.c ../src/gateway.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1 ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1 ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1 ${OBJECTDIR}/_ext/1255583909/lcd.p1 ${OBJECTDIR}/_ext/1255583909/serial_flash.p1 ${OBJECTDIR}/_ext/1255583909/system.p1 ${OBJECTDIR}/_ext/1255583909/delay.p1 ${OBJECTDIR}/_ext/1255583909/symbol.p1 ${OBJECTDIR}/_ext/1255583909/button.p1 ${OBJECTDIR}/_ext/1255583909/spi.p1 ${OBJECTDIR}/_ext/1255583909/eeprom.p1 ${OBJECTDIR}/_ext/1360937237/main.p1 ${OBJECTDIR}/_ext/1360937237/door_unlock.p1 ${OBJECTDIR}/_ext/1360937237/pan.p1 ${OBJECTDIR}/_ext/1360937237/student.p1 ${OBJECTDIR}/_ext/1360937237/teacher.p1 ${OBJECTDIR}/_ext/1360937237/projector_screen.p1 ${OBJECTDIR}/_ext/1360937237/network.p1 ${OBJECTDIR}/_ext/1360937237/computer_control.p1 ${OBJECTDIR}/_ext/1360937237/demo_pan.p1 ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1 ${OBJECTDIR}/_ext/1360937237/demo_911.p1 ${OBJECTDIR}/_ext/1360937237/soft_uart.p1
-POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1.d ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1.d ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1.d ${OBJECTDIR}/_ext/1255583909/lcd.p1.d ${OBJECTDIR}/_ext/1255583909/serial_flash.p1.d ${OBJECTDIR}/_ext/1255583909/system.p1.d ${OBJECTDIR}/_ext/1255583909/delay.p1.d ${OBJECTDIR}/_ext/1255583909/symbol.p1.d ${OBJECTDIR}/_ext/1255583909/button.p1.d ${OBJECTDIR}/_ext/1255583909/spi.p1.d ${OBJECTDIR}/_ext/1255583909/eeprom.p1.d ${OBJECTDIR}/_ext/1360937237/main.p1.d ${OBJECTDIR}/_ext/1360937237/door_unlock.p1.d ${OBJECTDIR}/_ext/1360937237/pan.p1.d ${OBJECTDIR}/_ext/1360937237/student.p1.d ${OBJECTDIR}/_ext/1360937237/teacher.p1.d ${OBJECTDIR}/_ext/1360937237/projector_screen.p1.d ${OBJECTDIR}/_ext/1360937237/network.p1.d ${OBJECTDIR}/_ext/1360937237/computer_control.p1.d ${OBJECTDIR}/_ext/1360937237/demo_pan.p1.d ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1.d ${OBJECTDIR}/_ext/1360937237/demo_911.p1.d ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1 ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1 ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1 ${OBJECTDIR}/_ext/1255583909/lcd.p1 ${OBJECTDIR}/_ext/1255583909/serial_flash.p1 ${OBJECTDIR}/_ext/1255583909/system.p1 ${OBJECTDIR}/_ext/1255583909/delay.p1 ${OBJECTDIR}/_ext/1255583909/symbol.p1 ${OBJECTDIR}/_ext/1255583909/button.p1 ${OBJECTDIR}/_ext/1255583909/spi.p1 ${OBJECTDIR}/_ext/1255583909/eeprom.p1 ${OBJECTDIR}/_ext/1360937237/main.p1 ${OBJECTDIR}/_ext/1360937237/door_unlock.p1 ${OBJECTDIR}/_ext/1360937237/pan.p1 ${OBJECTDIR}/_ext/1360937237/student.p1 ${OBJECTDIR}/_ext/1360937237/teacher.p1 ${OBJECTDIR}/_ext/1360937237/projector_screen.p1 ${OBJECTDIR}/_ext/1360937237/network.p1 ${OBJECTDIR}/_ext/1360937237/computer_control.p1 ${OBJECTDIR}/_ext/1360937237/demo_pan.p1 ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1 ${OBJECTDIR}/_ext/1360937237/demo_911.p1 ${OBJECTDIR}/_ext/1360937237/soft_uart.p1 ${OBJECTDIR}/_ext/1360937237/gateway.p1
+POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1.d ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1.d ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1.d ${OBJECTDIR}/_ext/1255583909/lcd.p1.d ${OBJECTDIR}/_ext/1255583909/serial_flash.p1.d ${OBJECTDIR}/_ext/1255583909/system.p1.d ${OBJECTDIR}/_ext/1255583909/delay.p1.d ${OBJECTDIR}/_ext/1255583909/symbol.p1.d ${OBJECTDIR}/_ext/1255583909/button.p1.d ${OBJECTDIR}/_ext/1255583909/spi.p1.d ${OBJECTDIR}/_ext/1255583909/eeprom.p1.d ${OBJECTDIR}/_ext/1360937237/main.p1.d ${OBJECTDIR}/_ext/1360937237/door_unlock.p1.d ${OBJECTDIR}/_ext/1360937237/pan.p1.d ${OBJECTDIR}/_ext/1360937237/student.p1.d ${OBJECTDIR}/_ext/1360937237/teacher.p1.d ${OBJECTDIR}/_ext/1360937237/projector_screen.p1.d ${OBJECTDIR}/_ext/1360937237/network.p1.d ${OBJECTDIR}/_ext/1360937237/computer_control.p1.d ${OBJECTDIR}/_ext/1360937237/demo_pan.p1.d ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1.d ${OBJECTDIR}/_ext/1360937237/demo_911.p1.d ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d ${OBJECTDIR}/_ext/1360937237/gateway.p1.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1 ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1 ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1 ${OBJECTDIR}/_ext/1255583909/lcd.p1 ${OBJECTDIR}/_ext/1255583909/serial_flash.p1 ${OBJECTDIR}/_ext/1255583909/system.p1 ${OBJECTDIR}/_ext/1255583909/delay.p1 ${OBJECTDIR}/_ext/1255583909/symbol.p1 ${OBJECTDIR}/_ext/1255583909/button.p1 ${OBJECTDIR}/_ext/1255583909/spi.p1 ${OBJECTDIR}/_ext/1255583909/eeprom.p1 ${OBJECTDIR}/_ext/1360937237/main.p1 ${OBJECTDIR}/_ext/1360937237/door_unlock.p1 ${OBJECTDIR}/_ext/1360937237/pan.p1 ${OBJECTDIR}/_ext/1360937237/student.p1 ${OBJECTDIR}/_ext/1360937237/teacher.p1 ${OBJECTDIR}/_ext/1360937237/projector_screen.p1 ${OBJECTDIR}/_ext/1360937237/network.p1 ${OBJECTDIR}/_ext/1360937237/computer_control.p1 ${OBJECTDIR}/_ext/1360937237/demo_pan.p1 ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1 ${OBJECTDIR}/_ext/1360937237/demo_911.p1 ${OBJECTDIR}/_ext/1360937237/soft_uart.p1
+OBJECTFILES=${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1 ${OBJECTDIR}/_ext/916281452/miwi_mesh.p1 ${OBJECTDIR}/_ext/916281452/miwi_nvm.p1 ${OBJECTDIR}/_ext/1255583909/lcd.p1 ${OBJECTDIR}/_ext/1255583909/serial_flash.p1 ${OBJECTDIR}/_ext/1255583909/system.p1 ${OBJECTDIR}/_ext/1255583909/delay.p1 ${OBJECTDIR}/_ext/1255583909/symbol.p1 ${OBJECTDIR}/_ext/1255583909/button.p1 ${OBJECTDIR}/_ext/1255583909/spi.p1 ${OBJECTDIR}/_ext/1255583909/eeprom.p1 ${OBJECTDIR}/_ext/1360937237/main.p1 ${OBJECTDIR}/_ext/1360937237/door_unlock.p1 ${OBJECTDIR}/_ext/1360937237/pan.p1 ${OBJECTDIR}/_ext/1360937237/student.p1 ${OBJECTDIR}/_ext/1360937237/teacher.p1 ${OBJECTDIR}/_ext/1360937237/projector_screen.p1 ${OBJECTDIR}/_ext/1360937237/network.p1 ${OBJECTDIR}/_ext/1360937237/computer_control.p1 ${OBJECTDIR}/_ext/1360937237/demo_pan.p1 ${OBJECTDIR}/_ext/1360937237/demo_mouvement.p1 ${OBJECTDIR}/_ext/1360937237/demo_911.p1 ${OBJECTDIR}/_ext/1360937237/soft_uart.p1 ${OBJECTDIR}/_ext/1360937237/gateway.p1
 
 # Source Files
-SOURCEFILES=../../../../../../framework/driver/mrf_miwi/src/drv_mrf_miwi_24j40.c ../../../../../../framework/miwi/src/miwi_mesh.c ../../../../../../framework/miwi/src/miwi_nvm.c ../src/system_config/miwikit_pic18f46j50_24j40/lcd.c ../src/system_config/miwikit_pic18f46j50_24j40/serial_flash.c ../src/system_config/miwikit_pic18f46j50_24j40/system.c ../src/system_config/miwikit_pic18f46j50_24j40/delay.c ../src/system_config/miwikit_pic18f46j50_24j40/symbol.c ../src/system_config/miwikit_pic18f46j50_24j40/button.c ../src/system_config/miwikit_pic18f46j50_24j40/spi.c ../src/system_config/miwikit_pic18f46j50_24j40/eeprom.c ../src/main.c ../src/door_unlock.c ../src/pan.c ../src/student.c ../src/teacher.c ../src/projector_screen.c ../src/network.c ../src/computer_control.c ../src/demo_pan.c ../src/demo_mouvement.c ../src/demo_911.c ../src/soft_uart.c
+SOURCEFILES=../../../../../../framework/driver/mrf_miwi/src/drv_mrf_miwi_24j40.c ../../../../../../framework/miwi/src/miwi_mesh.c ../../../../../../framework/miwi/src/miwi_nvm.c ../src/system_config/miwikit_pic18f46j50_24j40/lcd.c ../src/system_config/miwikit_pic18f46j50_24j40/serial_flash.c ../src/system_config/miwikit_pic18f46j50_24j40/system.c ../src/system_config/miwikit_pic18f46j50_24j40/delay.c ../src/system_config/miwikit_pic18f46j50_24j40/symbol.c ../src/system_config/miwikit_pic18f46j50_24j40/button.c ../src/system_config/miwikit_pic18f46j50_24j40/spi.c ../src/system_config/miwikit_pic18f46j50_24j40/eeprom.c ../src/main.c ../src/door_unlock.c ../src/pan.c ../src/student.c ../src/teacher.c ../src/projector_screen.c ../src/network.c ../src/computer_control.c ../src/demo_pan.c ../src/demo_mouvement.c ../src/demo_911.c ../src/soft_uart.c ../src/gateway.c
 
 
 CFLAGS=
@@ -265,6 +265,14 @@ ${OBJECTDIR}/_ext/1360937237/soft_uart.p1: ../src/soft_uart.c  nbproject/Makefil
 	@-${MV} ${OBJECTDIR}/_ext/1360937237/soft_uart.d ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d $(SILENT) -rsi ${MP_CC_DIR}../  
 	
+${OBJECTDIR}/_ext/1360937237/gateway.p1: ../src/gateway.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1360937237" 
+	@${RM} ${OBJECTDIR}/_ext/1360937237/gateway.p1.d 
+	@${RM} ${OBJECTDIR}/_ext/1360937237/gateway.p1 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G  -D__DEBUG=1 --debugger=pickit3  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug --addrqual=ignore --mode=pro -P -N255 -I"../src" -I"../../src" -I"../../../../../../framework" -I"../src/system_config/miwikit_pic18f46j50_24j40" --warn=0 --asmlist --summary=default,-psect,-class,+mem,-hex,-file --output=default,-inhx032 --runtime=default,+clear,+init,-keep,-no_startup,-download,+config,+clib,-plib --output=-mcof,+elf:multilocs --stack=compiled:auto:auto:auto "--errformat=%f:%l: error: (%n) %s" "--warnformat=%f:%l: warning: (%n) %s" "--msgformat=%f:%l: advisory: (%n) %s"    -o${OBJECTDIR}/_ext/1360937237/gateway.p1  ../src/gateway.c 
+	@-${MV} ${OBJECTDIR}/_ext/1360937237/gateway.d ${OBJECTDIR}/_ext/1360937237/gateway.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/_ext/1360937237/gateway.p1.d $(SILENT) -rsi ${MP_CC_DIR}../  
+	
 else
 ${OBJECTDIR}/_ext/1308774647/drv_mrf_miwi_24j40.p1: ../../../../../../framework/driver/mrf_miwi/src/drv_mrf_miwi_24j40.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}/_ext/1308774647" 
@@ -450,6 +458,14 @@ ${OBJECTDIR}/_ext/1360937237/soft_uart.p1: ../src/soft_uart.c  nbproject/Makefil
 	@-${MV} ${OBJECTDIR}/_ext/1360937237/soft_uart.d ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/_ext/1360937237/soft_uart.p1.d $(SILENT) -rsi ${MP_CC_DIR}../  
 	
+${OBJECTDIR}/_ext/1360937237/gateway.p1: ../src/gateway.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1360937237" 
+	@${RM} ${OBJECTDIR}/_ext/1360937237/gateway.p1.d 
+	@${RM} ${OBJECTDIR}/_ext/1360937237/gateway.p1 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug --addrqual=ignore --mode=pro -P -N255 -I"../src" -I"../../src" -I"../../../../../../framework" -I"../src/system_config/miwikit_pic18f46j50_24j40" --warn=0 --asmlist --summary=default,-psect,-class,+mem,-hex,-file --output=default,-inhx032 --runtime=default,+clear,+init,-keep,-no_startup,-download,+config,+clib,-plib --output=-mcof,+elf:multilocs --stack=compiled:auto:auto:auto "--errformat=%f:%l: error: (%n) %s" "--warnformat=%f:%l: warning: (%n) %s" "--msgformat=%f:%l: advisory: (%n) %s"    -o${OBJECTDIR}/_ext/1360937237/gateway.p1  ../src/gateway.c 
+	@-${MV} ${OBJECTDIR}/_ext/1360937237/gateway.d ${OBJECTDIR}/_ext/1360937237/gateway.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/_ext/1360937237/gateway.p1.d $(SILENT) -rsi ${MP_CC_DIR}../  
+	
 endif
 
 # ------------------------------------------------------------------------------------
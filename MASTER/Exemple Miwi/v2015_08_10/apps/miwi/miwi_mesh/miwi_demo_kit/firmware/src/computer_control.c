@@ -74,7 +74,6 @@ void ComputerControl(void)
             uart_tableau[k] = buffer;
             k++;
                         
-            delay_ms(35); // Delay ncessaire pour prvenir du re-entrancy dans UART_kbhit. 
             if (uart_tableau[k - 1] == '\r')
             {
                 uart_tableau[k - 1] = 0x00;
@@ -0,0 +1,272 @@
+//GATEWAY
+
+#include "gateway.h"
+#include "system.h"
+#include "system_config.h"
+#include "miwi/miwi_api.h"
+#include "string.h"
+
+/* Tampons circulaires de l'EUSART2, remplis et vides par Gateway_InterruptHandler().
+ * tete = prochaine case a ecrire, queue = prochaine case a lire. */
+static volatile uint8_t rx_tampon[GW_RX_TAILLE];
+static volatile uint8_t rx_tete = 0;
+static volatile uint8_t rx_queue = 0;
+static volatile uint8_t tx_tampon[GW_TX_TAILLE];
+static volatile uint8_t tx_tete = 0;
+static volatile uint8_t tx_queue = 0;
+static volatile uint8_t rx_perdus = 0;      // Octets perdus, tampon RX plein
+
+/* Trame en cours de decodage */
+static uint8_t trame[GW_DONNEES_MAX + 5];
+static uint8_t trame_longueur = 0;
+static bool trame_valide = true;
+static uint8_t cobs_code = 0xFF;
+static uint8_t cobs_reste = 0;
+
+/* Trame a envoyer, avant l'encodage COBS */
+static uint8_t trame_tx[GW_DONNEES_MAX + 5];
+
+uint16_t erreurs_crc = 0;
+
+/* Appelee par UserInterruptHandler() a chaque interruption */
+void Gateway_InterruptHandler(void)
+{
+    if(PIE3bits.RC2IE && PIR3bits.RC2IF)
+    {
+        if(RCSTA2bits.OERR)             // Debordement materiel, il faut redemarrer la reception
+        {
+            RCSTA2bits.CREN = 0;
+            RCSTA2bits.CREN = 1;
+        }
+        uint8_t octet = RCREG2;
+        uint8_t suivant = (rx_tete + 1) & (GW_RX_TAILLE - 1);
+        if(suivant != rx_queue)
+        {
+            rx_tampon[rx_tete] = octet;
+            rx_tete = suivant;
+        }
+        else
+            rx_perdus++;
+    }
+
+    if(PIE3bits.TX2IE && PIR3bits.TX2IF)
+    {
+        if(tx_queue != tx_tete)
+        {
+            TXREG2 = tx_tampon[tx_queue];
+            tx_queue = (tx_queue + 1) & (GW_TX_TAILLE - 1);
+        }
+        else
+            PIE3bits.TX2IE = 0;         // Plus rien a envoyer
+    }
+}
+
+/* EUSART2 a GW_BAUDRATE, BRG 16 bits : SPBRG = Fosc / (4 * baud) - 1 */
+static void Gateway_UART_Init(void)
+{
+    uint16_t brg = (uint16_t)((SYS_CLK_FrequencySystemGet() / 4 + GW_BAUDRATE / 2) / GW_BAUDRATE - 1);
+
+    RX_ANALOG_DIGITAL = 1;
+    GW_TX_TRIS = 0;
+    GW_RX_TRIS = 1;
+
+    TXSTA2 = 0x24;                      // TXEN, BRGH
+    BAUDCON2 = 0x08;                    // BRG16
+    SPBRGH2 = brg >> 8;
+    SPBRG2 = brg & 0xFF;
+    RCSTA2 = 0x90;                      // SPEN, CREN
+
+    PIR3bits.RC2IF = 0;
+    PIE3bits.RC2IE = 1;
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+}
+
+static void Gateway_UART_Write(uint8_t octet)
+{
+    uint8_t suivant = (tx_tete + 1) & (GW_TX_TAILLE - 1);
+    while(suivant == tx_queue)          // Tampon plein, l'interruption le vide
+        PIE3bits.TX2IE = 1;
+    tx_tampon[tx_tete] = octet;
+    tx_tete = suivant;
+    PIE3bits.TX2IE = 1;
+}
+
+static uint16_t Gateway_CRC16(const uint8_t *donnees, uint8_t longueur)
+{
+    uint16_t crc = 0xFFFF;
+    while(longueur--)
+    {
+        crc ^= (uint16_t)(*donnees++) << 8;
+        for(uint8_t i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/* Construit la trame, l'encode en COBS et la met dans le tampon TX.
+ * La trame fait moins de 254 octets, chaque bloc COBS se termine donc par un 0. */
+static void Gateway_EnvoieTrame(uint8_t type, uint8_t seq, const uint8_t *donnees, uint8_t longueur)
+{
+    uint8_t n, i, j;
+    uint16_t crc;
+
+    if(longueur > GW_DONNEES_MAX)
+        longueur = GW_DONNEES_MAX;
+    trame_tx[0] = type;
+    trame_tx[1] = seq;
+    trame_tx[2] = longueur;
+    memcpy(&trame_tx[3], donnees, longueur);
+    n = longueur + 3;
+    crc = Gateway_CRC16(trame_tx, n);
+    trame_tx[n++] = crc >> 8;
+    trame_tx[n++] = crc & 0xFF;
+
+    i = 0;
+    while(true)
+    {
+        j = i;
+        while(j < n && trame_tx[j] != 0)
+            j++;
+        Gateway_UART_Write(j - i + 1);
+        for(; i < j; i++)
+            Gateway_UART_Write(trame_tx[i]);
+        if(j >= n)
+            break;
+        i = j + 1;                      // Saute le 0 remplace par le code
+    }
+    Gateway_UART_Write(0x00);
+}
+
+static void Gateway_EnvoieStatut(uint8_t seq, uint8_t resultat)
+{
+    Gateway_EnvoieTrame(GW_STATUT, seq, &resultat, 1);
+}
+
+/* Trame complete et CRC verifie */
+static void Gateway_TraiteTrame(uint8_t type, uint8_t seq, uint8_t *donnees, uint8_t longueur)
+{
+    uint8_t longueur_adresse;
+    bool ok;
+
+    if(type == GW_PING)
+    {
+        Gateway_EnvoieStatut(seq, GW_OK);
+        return;
+    }
+
+    longueur_adresse = donnees[0];
+    if(type != GW_ENVOI || longueur < 1 + longueur_adresse ||
+       (longueur_adresse != 0 && longueur_adresse != 2 && longueur_adresse != MY_ADDRESS_LENGTH) ||
+       longueur - 1 - longueur_adresse > TX_BUFFER_SIZE)
+    {
+        Gateway_EnvoieStatut(seq, GW_TRAME_INVALIDE);
+        return;
+    }
+
+    MiApp_FlushTx();
+    for(uint8_t i = 1 + longueur_adresse; i < longueur; i++)
+        MiApp_WriteData(donnees[i]);
+
+    if(longueur_adresse == 0)
+        ok = MiApp_BroadcastPacket(false);
+    else
+        ok = MiApp_UnicastAddress(&donnees[1], longueur_adresse == MY_ADDRESS_LENGTH, false);
+
+    Gateway_EnvoieStatut(seq, ok ? GW_OK : GW_ECHEC_MIWI);
+}
+
+static void Gateway_Ajoute(uint8_t octet)
+{
+    if(trame_longueur < sizeof(trame))
+        trame[trame_longueur++] = octet;
+    else
+        trame_valide = false;           // Trop longue, ignoree jusqu'au prochain 0
+}
+
+/* Decodage COBS octet par octet, la trame est traitee sur le 0 de fin */
+static void Gateway_RecoitOctet(uint8_t octet)
+{
+    if(octet == 0x00)
+    {
+        if(trame_valide && trame_longueur >= 5 && trame[2] == trame_longueur - 5)
+        {
+            uint16_t crc = ((uint16_t)trame[trame_longueur - 2] << 8) | trame[trame_longueur - 1];
+            if(crc == Gateway_CRC16(trame, trame_longueur - 2))
+                Gateway_TraiteTrame(trame[0], trame[1], &trame[3], trame[2]);
+            else
+                erreurs_crc++;
+        }
+        trame_longueur = 0;
+        trame_valide = true;
+        cobs_code = 0xFF;
+        cobs_reste = 0;
+        return;
+    }
+
+    if(cobs_reste == 0)
+    {
+        if(cobs_code != 0xFF)           // Le bloc precedent se terminait par un 0
+            Gateway_Ajoute(0x00);
+        cobs_code = octet;
+        cobs_reste = octet - 1;
+    }
+    else
+    {
+        Gateway_Ajoute(octet);
+        cobs_reste--;
+    }
+}
+
+/* Message MiWi recu : [long. adresse][adresse][RSSI][LQI][payload] vers Linux */
+static void Gateway_TransmetMessage(void)
+{
+    uint8_t donnees[GW_DONNEES_MAX];
+    uint8_t n = 0;
+    uint8_t longueur_adresse = 0;
+
+    if(rxMessage.flags.bits.srcPrsnt)
+        longueur_adresse = rxMessage.flags.bits.altSrcAddr ? 2 : MY_ADDRESS_LENGTH;
+
+    donnees[n++] = longueur_adresse;
+    for(uint8_t i = 0; i < longueur_adresse; i++)
+        donnees[n++] = rxMessage.SourceAddress[i];
+    donnees[n++] = rxMessage.PacketRSSI;
+    donnees[n++] = rxMessage.PacketLQI;
+    for(uint8_t i = 0; i < rxMessage.PayloadSize && n < GW_DONNEES_MAX; i++)
+        donnees[n++] = rxMessage.Payload[i];
+
+    Gateway_EnvoieTrame(GW_RECU, 0, donnees, n);
+}
+
+void Gateway(void)
+{
+    uint8_t octet;
+
+    LCD_Erase();
+    sprintf((char *) &LCDText, (char*) "Passerelle MiWi %02X%02X  115200  ",
+            myShortAddress.v[1], myShortAddress.v[0]);
+    LCD_Update();
+
+    Gateway_UART_Init();
+    MiApp_DiscardMessage();
+
+    while(true)
+    {
+        // Commandes venant de Linux, deja bufferisees par l'interruption
+        while(rx_queue != rx_tete)
+        {
+            octet = rx_tampon[rx_queue];
+            rx_queue = (rx_queue + 1) & (GW_RX_TAILLE - 1);
+            Gateway_RecoitOctet(octet);
+        }
+
+        // Messages MiWi vers Linux
+        if(MiApp_MessageAvailable())
+        {
+            LED0 ^= 1;
+            Gateway_TransmetMessage();
+            MiApp_DiscardMessage();
+        }
+    }
+}
@@ -0,0 +1,38 @@
+/********************************************************************
+ * Passerelle MiWi <-> Linux
+ *
+ * Les trames MiWi sont transportees sur l'EUSART2 (RX2 = RA1, TX2 = RC0)
+ * dans des trames binaires encodees en COBS et terminees par 0x00 :
+ *
+ *      COBS( type | seq | longueur | donnees... | CRC16 MSB | CRC16 LSB ) 0x00
+ *
+ * Le CRC16 (CCITT, polynome 0x1021, valeur initiale 0xFFFF) couvre
+ * type, seq, longueur et les donnees.
+ *******************************************************************/
+#ifndef _GATEWAY_H
+    #define _GATEWAY_H
+
+#include <stdint.h>
+
+#define GW_BAUDRATE         115200
+#define GW_RX_TAILLE        128     // Puissance de 2, tampon RX de l'UART (2 trames de GW_DONNEES_MAX)
+#define GW_TX_TAILLE        64      // Puissance de 2, tampon TX de l'UART
+#define GW_DONNEES_MAX      56      // Donnees maximum dans une trame
+
+// Types de trames
+#define GW_ENVOI            0x01    // Linux -> noeud : [long. adresse][adresse][payload]
+#define GW_RECU             0x02    // noeud -> Linux : [long. adresse][adresse][RSSI][LQI][payload]
+#define GW_STATUT           0x03    // reponse a une trame, [resultat], meme seq
+#define GW_PING             0x04    // Linux -> passerelle, repond GW_STATUT sans passer par la radio
+
+// Resultats de GW_STATUT
+#define GW_OK               0x00
+#define GW_ECHEC_MIWI       0x01    // MiApp_UnicastAddress / MiApp_BroadcastPacket a echoue
+#define GW_TRAME_INVALIDE   0x02    // Type ou longueur d'adresse inconnu
+
+// Longueur d'adresse 0 = broadcast, 2 = adresse courte, MY_ADDRESS_LENGTH = adresse longue
+
+void Gateway(void);
+void Gateway_InterruptHandler(void);
+
+#endif
@@ -14,6 +14,7 @@
 #include "demo_pan.h"
 #include "demo_mouvement.h"
 #include "demo_911.h"
+#include "gateway.h"
 
 
 
@@ -26,6 +27,7 @@
 #define MOVEMENT 6                  //Beep Boop Boop
 #define DEMO_PAN 7
 #define DEMO_911 8                  //Can jet fuel melt steel beams?
+#define GATEWAY 9                   //Passerelle MiWi <-> Linux sur l'EUSART2
 
 //*************************************************************************
 
@@ -94,4 +96,9 @@ void main(void)
        Demo_911();
         
     }
+
+    if(DEVICEMODE == GATEWAY)
+    {
+        Gateway();
+    }
 }
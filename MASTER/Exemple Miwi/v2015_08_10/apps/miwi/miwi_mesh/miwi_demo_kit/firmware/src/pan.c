@@ -5,6 +5,7 @@
 #include "codes library.h"
 #include "system_config.h"
 #include "miwi/miwi_api.h"
+#include "soft_uart.h"
 
 void Pan(void)
 {
@@ -24,7 +25,7 @@ void Pan(void)
     
 */
     
-    LCD_BKLT = 1;
+    UART_Init_Projecteur();     // Trames du projecteur envoyees par interruptions sur E1
     while(true)
     {
         if(MiApp_MessageAvailable())
@@ -53,58 +54,24 @@ void Pan(void)
     }
 }
 
-void startBit(void)
+void putcv(int data)	//UART VIRTUEL, envoye en arriere-plan par soft_uart.c
 {
-	LCD_BKLT = 0;
-	__delay_us(102);
-}
-
-void stopBit(void)
-{
-	LCD_BKLT = 1;
-	__delay_us(102);
-}
-
-void putcv(int data)	//UART VIRTUEL
-{
-	int i,x;
-	startBit();
-	int data2 = data;      // = ~data
-	for(i=0;i<8;i++)
-    {
-		LCD_BKLT = data2;
-		data2 = data2>>1;
-		__delay_us(102);	
-	}
-	stopBit();
+	UART_Write_Projecteur(data, 0);
 }
 
 void Power_off() //POWER OFF PROJECTEUR
 {
-    LCD_BKLT = 1;
-	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x00);putcv(0xC0);
-	LCD_BKLT = 1;
-    delay_ms(19);
-	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x02);putcv(0xC2);
-	LCD_BKLT = 1;
-    delay_ms(19);
-	putcv(0x02);putcv(0x01);putcv(0x00);putcv(0x00);putcv(0x00);putcv(0x03);
-	LCD_BKLT = 1;
-    delay_ms(19);
+	// La derniere valeur de chaque trame est suivie de 19 ms de silence
+	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x00);UART_Write_Projecteur(0xC0, 19);
+	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x02);UART_Write_Projecteur(0xC2, 19);
+	putcv(0x02);putcv(0x01);putcv(0x00);putcv(0x00);putcv(0x00);UART_Write_Projecteur(0x03, 19);
 }
 
 void Power_on() //POWER ON PROJECTEUR
 {	
-	LCD_BKLT = 1;
-	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x00);putcv(0xC0);
-	LCD_BKLT = 1;
-    delay_ms(35);
-    putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x02);putcv(0xC2);
-	LCD_BKLT = 1;
-    delay_ms(19);
-	putcv(0x02);putcv(0x00);putcv(0x00);putcv(0x00);putcv(0x00);putcv(0x02);
-    LCD_BKLT = 1;
-    delay_ms(19);
+	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x00);UART_Write_Projecteur(0xC0, 35);
+	putcv(0x00);putcv(0xBF);putcv(0x00);putcv(0x00);putcv(0x01);putcv(0x02);UART_Write_Projecteur(0xC2, 19);
+	putcv(0x02);putcv(0x00);putcv(0x00);putcv(0x00);putcv(0x00);UART_Write_Projecteur(0x02, 19);
 }
 
 void alarm(int status) //Alarm is activated/desactivated     status=1=on    status=0=off
@@ -13,6 +13,8 @@
 /* LISTE DES MODIFICATIONS
  * 2016-11-03 : modification par S.Proulx pour changer la broche du UART Logiciel
  *              des broches B6 B7 aux broches A2 et A1. Fonctionnement de base
+ * 2026-10-19 : UART logiciel par interruptions (TMR2 + captures ECCP1/ECCP2) avec tampons
+ *              circulaires, full-duplex, et deuxime sortie pour le projecteur (E1)
  * 
  * 
  *
@@ -21,6 +23,7 @@
 
 #include "system_config.h"
 #include "soft_uart.h"
+#include <stdint.h>
 
 
 char UART_Init(const long int baudrate)
@@ -90,78 +93,372 @@ void UART_Write_Text(char *text)
 }
 
 //---------------------------------------------------------------------------
-// void UART_Init_B6_B7(void)
-//  PIN_A2 = TXD
-//  PIN_A1 = RXD
+//  UART logiciel par interruptions
+//  PIN_A2 = TXD (ORANGE)
+//  PIN_A1 = RXD (ROUGE), aussi entree de capture de ECCP1 et ECCP2 par PPS
+//  PIN_E1 = TXD du projecteur (LCD_BKLT)
+//
+//  TMR2 interrompt une fois par bit (9615 Hz, 416 cycles) pendant un envoi
+//  ou une reception. Au repos, il est coupe : seul le front descendant du
+//  start bit (capture ECCP1) reveille le UART, le CPU reste libre pour la
+//  pile MiWi.
+//
+//  Envoi : le niveau de chaque sortie est calcule au tick precedent et sorti
+//  des l'entree de l'interruption, la duree du reste du tick ne donne donc
+//  pas de gigue sur les bits.
+//  Reception : ECCP1 capture TMR1 sur chaque front descendant de RXD et ECCP2
+//  sur chaque front montant (TMR1 = minuterie des symboles MiWi, Fosc/32,
+//  les deux captures l'utilisent par defaut). Deux fronts de meme sens sont
+//  a au moins 2 bits l'un de l'autre, chaque tick trouve donc au plus un
+//  front dans chaque capture. La position du front depuis le start bit donne
+//  le nombre de bits au niveau precedent : l'horodatage est fait par le
+//  materiel, la latence des interruptions (radio comprise) ne change pas les
+//  bits recus tant qu'un tick n'est pas retarde de plus d'un bit.
+//  high_isr() recharge TMR1 a 0x3CB0 a chaque debordement (periode de
+//  100 ms du chronometre) : les ecarts entre deux instants sont calcules
+//  par SU_Ecart(), qui retire la valeur de recharge quand le debordement
+//  tombe entre les deux. Les comptes pendant la latence de high_isr sont
+//  perdus, quelques us pour un bit de 104 us.
+//---------------------------------------------------------------------------
+
+#define SU_CAPTURE_DESCENDANT   0x04    // CCPxCON, capture a chaque front descendant
+#define SU_CAPTURE_MONTANT      0x05    // CCPxCON, capture a chaque front montant
+#define SU_TMR1_RECHARGE        0x3CB0  // TMR1H:TMR1L recharges par high_isr()
+#define SU_TMR1_PERIODE         ((uint16_t)(0 - SU_TMR1_RECHARGE))  // 50000 comptes
+
+typedef struct
+{
+    volatile uint8_t octets[SU_TX_TAILLE];
+    volatile uint8_t pauses[SU_TX_TAILLE];   // ms de silence apres l'octet
+    volatile uint8_t tete;                   // prochaine case a ecrire
+    volatile uint8_t queue;                  // prochaine case a envoyer
+    volatile uint8_t actif;
+    uint8_t niveau;                          // niveau a sortir au prochain tick
+    uint16_t registre;                       // start + 8 bits + stop, LSB en premier
+    uint8_t bits;                            // bits restants dans registre
+    uint16_t attente;                        // bits de silence avant l'octet suivant
+} SU_TX;
+
+static SU_TX su_terminal;
+static SU_TX su_projecteur;
+
+static volatile uint8_t rx_tampon[SU_RX_TAILLE];
+static volatile uint8_t rx_tete = 0;
+static volatile uint8_t rx_queue = 0;
+static uint8_t rx_init = 0;                 // UART_Init_A2_A1() appelee
+static uint8_t rx_actif = 0;
+static uint16_t rx_debut;                   // TMR1 capture au front du start bit
+static uint16_t rx_sonde;                   // TMR1 au tick precedent
+static uint16_t rx_limite;                  // milieu du bit rx_bit, en cycles depuis le start bit
+static uint8_t rx_bit;                      // 0 = start, 1 a 8 = donnees, 9 = stop
+static uint8_t rx_niveau;                   // niveau de la ligne depuis le dernier front
+static uint8_t rx_octet;
+static uint8_t rx_stop;
+volatile uint8_t su_erreurs = 0;            // stop bit absent ou tampon RX plein
+
+// Niveau de la ligne pour le bit suivant, appelee seulement par l'interruption
+static uint8_t SU_Bit_TX(SU_TX *tx)
+{
+    uint8_t niveau;
+    if(tx->bits == 0)
+    {
+        if(tx->attente)
+        {
+            tx->attente--;
+            return 1;
+        }
+        if(tx->queue == tx->tete)
+        {
+            tx->actif = 0;                  // Plus rien a envoyer, ligne au repos
+            return 1;
+        }
+        tx->registre = ((uint16_t)tx->octets[tx->queue] << 1) | 0x200;
+        tx->attente = (uint16_t)tx->pauses[tx->queue] * SU_BITS_PAR_MS;
+        tx->queue = (tx->queue + 1) & (SU_TX_TAILLE - 1);
+        tx->bits = 10;
+    }
+    niveau = tx->registre & 1;
+    tx->registre >>= 1;
+    tx->bits--;
+    return niveau;
+}
+
+// TMR1 lu en 8 bits, relu si l'octet haut a change entre les deux lectures
+static uint16_t SU_TMR1(void)
+{
+    uint8_t h, l;
+    do
+    {
+        h = TMR1H;
+        l = TMR1L;
+    } while(h != TMR1H);
+    return ((uint16_t)h << 8) | l;
+}
+
+// Position de t (TMR1) dans la periode de high_isr(). Sous SU_TMR1_RECHARGE,
+// TMR1 a deborde et n'est pas encore recharge : fin de la periode
+static uint16_t SU_Position(uint16_t t)
+{
+    return (t >= SU_TMR1_RECHARGE) ? t - SU_TMR1_RECHARGE : SU_TMR1_PERIODE - 1;
+}
+
+// Comptes de TMR1 de debut a fin, au plus une periode de high_isr() entre les deux
+static uint16_t SU_Ecart(uint16_t debut, uint16_t fin)
+{
+    uint16_t a = SU_Position(debut);
+    uint16_t b = SU_Position(fin);
+    return (b >= a) ? b - a : b + (SU_TMR1_PERIODE - a);
+}
+
+// Les bits dont le milieu est passe a l'instant t (TMR1) ont le niveau rx_niveau
+static void SU_Bits_RX(uint16_t t)
+{
+    uint16_t ecart = SU_Ecart(rx_debut, t);
+    ecart = (ecart > SU_RX_MAX) ? 0xFFFF : ecart << 3;     // comptes de TMR1 -> cycles
+    while(rx_bit < 10 && ecart >= rx_limite)
+    {
+        if(rx_bit >= 1 && rx_bit <= 8)
+        {
+            rx_octet >>= 1;
+            if(rx_niveau)
+                rx_octet |= 0x80;
+        }
+        else if(rx_bit == 9)
+            rx_stop = rx_niveau;
+        rx_bit++;
+        rx_limite += SU_CYCLES_PAR_BIT;
+    }
+    if(rx_bit >= 10)                                        // Octet termine
+    {
+        uint8_t suivant = (rx_tete + 1) & (SU_RX_TAILLE - 1);
+        if(rx_stop && suivant != rx_queue)
+        {
+            rx_tampon[rx_tete] = rx_octet;
+            rx_tete = suivant;
+        }
+        else
+            su_erreurs++;
+        rx_actif = 0;
+    }
+}
+
+// Decode un front capture a l'instant t (TMR1)
+static void SU_Front(uint16_t t, uint8_t montant)
+{
+    if(rx_actif)
+        SU_Bits_RX(t);                                      // Bits avant le front
+    if(rx_actif)
+        rx_niveau = montant;
+    else if(!montant)                                       // Start bit
+    {
+        rx_actif = 1;
+        rx_debut = t;
+        rx_limite = SU_CYCLES_PAR_BIT / 2;
+        rx_bit = 0;
+        rx_niveau = 0;
+        rx_octet = 0;
+    }
+}
+
+// Fronts captures depuis le tick precedent, dans l'ordre ou ils sont arrives
+static void SU_Sonde_RX(void)
+{
+    uint16_t maintenant = SU_TMR1();
+    uint8_t d = PIR1bits.CCP1IF;                            // Drapeaux avant les captures
+    uint8_t m = PIR2bits.CCP2IF;
+    uint16_t descendant = ((uint16_t)CCPR1H << 8) | CCPR1L;
+    uint16_t montant = ((uint16_t)CCPR2H << 8) | CCPR2L;
+
+    if(d)
+        PIR1bits.CCP1IF = 0;
+    if(m)
+        PIR2bits.CCP2IF = 0;
+    if(d && m && SU_Ecart(rx_sonde, montant) < SU_Ecart(rx_sonde, descendant))
+    {
+        SU_Front(montant, 1);
+        m = 0;
+    }
+    if(d)
+        SU_Front(descendant, 0);
+    if(m)
+        SU_Front(montant, 1);
+    if(rx_actif)
+        SU_Bits_RX(maintenant);                             // Fin de l'octet sans front
+    rx_sonde = maintenant;
+}
+
+static void SU_Tick_On(void)
+{
+    if(!PIE1bits.TMR2IE)
+    {
+        PIR1bits.TMR2IF = 0;        // Tick perime, TMR2 tournait sans interruption
+        PIE1bits.TMR2IE = 1;
+        PIE1bits.CCP1IE = 0;        // Les fronts sont lus par le tick
+        if(rx_init && PIR1bits.CCP1IF)
+        {
+            // Start bit decode tout de suite : si l'interruption a ete retardee
+            // (radio), le premier tick peut arriver apres le front descendant
+            // suivant, qui ecraserait CCPR1
+            uint8_t m = PIR2bits.CCP2IF;
+            uint16_t montant = ((uint16_t)CCPR2H << 8) | CCPR2L;
+            uint16_t maintenant = SU_TMR1();
+
+            PIR1bits.CCP1IF = 0;
+            SU_Front(((uint16_t)CCPR1H << 8) | CCPR1L, 0);
+            rx_sonde = rx_debut;
+            if(m && SU_Ecart(rx_debut, montant) > SU_Ecart(rx_debut, maintenant))
+                PIR2bits.CCP2IF = 0;    // Front montant d'avant le start bit
+        }
+        else
+        {
+            PIR2bits.CCP2IF = 0;        // Front montant perime, pas d'octet en cours
+            rx_sonde = SU_TMR1();
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//  void SoftUART_InterruptHandler(void)
+//  Appelee par UserInterruptHandler() a chaque interruption
+//---------------------------------------------------------------------------
+void SoftUART_InterruptHandler(void)
+{
+    if(PIE1bits.TMR2IE && PIR1bits.TMR2IF)
+    {
+        PIR1bits.TMR2IF = 0;
+        if(su_terminal.actif)
+            UART_TX_V = su_terminal.niveau;
+        if(su_projecteur.actif)
+            LCD_BKLT = su_projecteur.niveau;
+        if(su_terminal.actif)
+            su_terminal.niveau = SU_Bit_TX(&su_terminal);
+        if(su_projecteur.actif)
+            su_projecteur.niveau = SU_Bit_TX(&su_projecteur);
+
+        if(rx_init)
+            SU_Sonde_RX();
+
+        if(!su_terminal.actif && !su_projecteur.actif && !rx_actif)
+        {
+            PIE1bits.TMR2IE = 0;
+            PIE1bits.CCP1IE = rx_init;      // Attente du prochain start bit
+        }
+    }
+
+    if(PIE1bits.CCP1IE && PIR1bits.CCP1IF)                  // Start bit, decode par le tick
+        SU_Tick_On();
+}
+
+// TMR2 a SU_BAUDRATE, l'interruption est activee au besoin
+static void SU_Timer_Init(void)
+{
+    T2CON = 0x05;                   // TMR2ON, prescaler 1:4, postscaler 1:1
+    PR2 = SU_PR2;
+    IPR1bits.TMR2IP = 1;
+    PIR1bits.TMR2IF = 0;
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+}
+
+static void SU_Ecrit(SU_TX *tx, uint8_t data, uint8_t pause)
+{
+    uint8_t suivant = (tx->tete + 1) & (SU_TX_TAILLE - 1);
+    while(suivant == tx->queue);    // Tampon plein, l'interruption le vide
+    tx->octets[tx->tete] = data;
+    tx->pauses[tx->tete] = pause;
+    tx->tete = suivant;
+
+    INTCONbits.GIE = 0;
+    SU_Tick_On();
+    if(!tx->actif)
+        tx->niveau = 1;             // Un tick au repos avant le start bit
+    tx->actif = 1;
+    INTCONbits.GIE = 1;
+}
+
+//---------------------------------------------------------------------------
+//  void UART_Init_A2_A1(void)
+//  PIN_A2 = TXD, PIN_A1 = RXD (captures ECCP1 et ECCP2 sur RP1, voir SYSTEM_Initialize)
 //---------------------------------------------------------------------------
 void UART_Init_A2_A1(void)
 {
+    RX_ANALOG_DIGITAL = 1;
+    TX_ANALOG_DIGITAL = 1;
     UART_TX_TRIS = 0; // Sortie
     UART_RX_TRIS = 1; // Entre
     UART_TX_V = 1;     // Niveau haut
-    UART_RX_V = 1;
+    SU_Timer_Init();
+
+    CCP1CON = SU_CAPTURE_DESCENDANT;
+    CCP2CON = SU_CAPTURE_MONTANT;
+    IPR1bits.CCP1IP = 1;
+    PIR1bits.CCP1IF = 0;            // Fausses captures du changement de mode
+    PIR2bits.CCP2IF = 0;
+    rx_init = 1;
+    PIE1bits.CCP1IE = !PIE1bits.TMR2IE;     // Attente du start bit si le tick est arrete
 }
+
 //---------------------------------------------------------------------------
-//  void UART_Write_A2_A1(char data)
-//  crit le caractre sur le port srie software
-//  PIN_A2 = TXD (ORANGE))
-//  PIN_A1 = RXD (ROUGE)
-//  dure d'un bit  9600 bps
-//  t = 1/9600 = 104 us
-//  4 us environ pour instructions
+//  void UART_Init_Projecteur(void)
+//  PIN_E1 (LCD_BKLT) = TXD vers le projecteur, pas de rception
 //---------------------------------------------------------------------------
+void UART_Init_Projecteur(void)
+{
+    LCD_BKLT_TRIS = 0;
+    LCD_BKLT = 1;
+    SU_Timer_Init();
+}
 
+//---------------------------------------------------------------------------
+//  void UART_Write_A2_A1(char data)
+//  Met le caractre dans le tampon d'envoi, bloque seulement si plein
+//---------------------------------------------------------------------------
 void UART_Write_A2_A1(char data)
 {
-    int i;
-    UART_TX_V = 0;        // start bit
-    __delay_us(100);
-    for(i=0; i<8; i++)
-    {
-        UART_TX_V = (short) data;
-        data = data >> 1;
-        __delay_us(100);
-    }
-    UART_TX_V = 1;    // stop bit
-    __delay_us(100);
+    SU_Ecrit(&su_terminal, data, 0);
 }
 
 //---------------------------------------------------------------------------
-//  char UART_Read_A2_A1(void)
-//  Reoit le caractre sur le port srie software
-//  PIN_A2 = TXD
-//  PIN_A1 = RXD
-//  dure d'un bit  9600 bps
-//  t = 1/9600 = 104 us
-//  4 us environ pour instructions
+//  void UART_Write_Projecteur(char data, unsigned char pause)
+//  Met le caractre dans le tampon du projecteur, la ligne reste au repos
+//  pendant pause ms aprs l'octet (sparation des trames)
 //---------------------------------------------------------------------------
+void UART_Write_Projecteur(char data, unsigned char pause)
+{
+    SU_Ecrit(&su_projecteur, data, pause);
+}
+
+//---------------------------------------------------------------------------
+//  short UART_Busy_Projecteur(void)
+//  1 tant que des octets du projecteur restent  envoyer
+//---------------------------------------------------------------------------
+short UART_Busy_Projecteur(void)
+{
+    return su_projecteur.actif;
+}
 
+//---------------------------------------------------------------------------
+//  char UART_Read_A2_A1(void)
+//  Retourne le prochain caractre reu, 0 si le tampon est vide
+//---------------------------------------------------------------------------
 char UART_Read_A2_A1(void)
 {
-    int i;
-    char data, lecture;
-    data = 0b00000000;
-    if (UART_RX_V == 0)           // Dtecte le start bit
+    char data = 0;
+    if(rx_queue != rx_tete)
     {
-        __delay_us(50);         // demi-bit
-        for(i=0; i<8; i++)
-        {
-            __delay_us(100);    // chantillone au milieu des bits
-            UART_TX_V = !UART_TX_V;
-            data = (data >> 1) + (UART_RX_V << 7);  
-        }
-        UART_RX_V = 1;                // stop bit (en attente)
+        data = rx_tampon[rx_queue];
+        rx_queue = (rx_queue + 1) & (SU_RX_TAILLE - 1);
     }
     return data;
- }
+}
 
 //---------------------------------------------------------------------------
 //  short UART_kbhit_A2_A1(void)
-//  Teste la rception d'un caractre su PIN_B7
+//  Teste la prsence d'un caractre dans le tampon de rception
 //---------------------------------------------------------------------------
 short UART_kbhit_A2_A1(void)
 {   
-    return (UART_RX_V == 0);
+    return (rx_queue != rx_tete);
 }
 
 //---------------------------------------------------------------------------
@@ -28,6 +28,15 @@
 /* Prototypes pour fonctions pour UART Matriel et Logiciel par Claude Barbaud*/
 
 #define _XTAL_FREQ 16000000
+
+// UART logiciel par interruptions, voir soft_uart.c
+#define SU_BAUDRATE         9600
+#define SU_PR2              ((_XTAL_FREQ / 16) / SU_BAUDRATE - 1)   // TMR2 prescaler 1:4, un tick par bit
+#define SU_BITS_PAR_MS      ((SU_BAUDRATE + 500) / 1000)
+#define SU_CYCLES_PAR_BIT   ((_XTAL_FREQ / 4 + SU_BAUDRATE / 2) / SU_BAUDRATE)
+#define SU_RX_MAX           1000    // Comptes de TMR1 (2 us) au-dela desquels l'octet est termine
+#define SU_RX_TAILLE        32      // Puissance de 2
+#define SU_TX_TAILLE        32      // Puissance de 2, pour chaque sortie
 //----------------------------------------------------------------------
 // prototypes des fonctions
 //----------------------------------------------------------------------
@@ -43,6 +52,10 @@ void UART_Write_A2_A1(char data);
 char UART_Read_A2_A1(void);
 short UART_kbhit_A2_A1(void);
 void UART_Write_Text_A2_A1(char *text);
+void UART_Init_Projecteur(void);
+void UART_Write_Projecteur(char data, unsigned char pause);
+short UART_Busy_Projecteur(void);
+void SoftUART_InterruptHandler(void);
 //-------------------LCD------------------------------------------------
 void LCD_Init(void);
 void LCD_Set_Cursor(int pos);
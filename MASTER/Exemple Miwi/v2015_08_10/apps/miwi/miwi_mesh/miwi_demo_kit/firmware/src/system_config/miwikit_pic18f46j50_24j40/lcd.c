@@ -23,6 +23,8 @@
 #include "system.h"
 #include "system_config.h"
 #include "string.h"
+#include "gateway.h"
+#include "soft_uart.h"
 
 
 uint8_t LCDText[16*2+1];
@@ -185,6 +187,8 @@ void LCD_Display(char *text, uint8_t value, bool delay)
 
 void UserInterruptHandler(void)
 {
+    Gateway_InterruptHandler();     // EUSART2 de la passerelle MiWi
+    SoftUART_InterruptHandler();    // UART logiciel, TMR2 et captures ECCP1/ECCP2
 //    if( PIR3bits.SSP2IF )
 //    {
 //        PIR3bits.SSP2IF = 0;
@@ -65,6 +65,10 @@ void SYSTEM_Initialize(void)
     RPINR21 = 23;			// Mapping SDI2 to RD6(RP23)
     RPOR21 = 10;			// Mapping SCK2 to RD4(RP21)
     RPOR19 = 9;			    // Mapping SDO2 to RD2(RP19)
+    RPINR16 = 1;            // Mapping RX2 to RA1(RP1) * Used by the MiWi gateway
+    RPOR11 = 5;             // Mapping TX2 to RC0(RP11) * Used by the MiWi gateway
+    RPINR7 = 1;             // Mapping IC1 (ECCP1 capture) to RA1(RP1) * RXD of the software UART, falling edges
+    RPINR8 = 1;             // Mapping IC2 (ECCP2 capture) to RA1(RP1) * RXD of the software UART, rising edges
 	
 	// Lock System
     EECON2 = 0x55;
@@ -120,6 +120,10 @@
 #define UART_RX_V           PORTAbits.RA1
 #define RX_ANALOG_DIGITAL   ANCON0bits.PCFG1
 
+//Passerelle MiWi, EUSART2 par PPS : RX2 = RA1 (RP1), TX2 = RC0 (RP11)
+#define GW_TX_TRIS          TRISCbits.TRISC0
+#define GW_RX_TRIS          TRISAbits.TRISA1
+
 //movement_detector
 
 #define DETECT_TRIS         TRISAbits.TRISA0
@@ -0,0 +1,490 @@
+/********************************************************************
+ * soft_uart_test.c
+ *
+ * Modele du UART logiciel de soft_uart.c sur le PC, pas a pas au cycle
+ * d'instruction (Fcy = _XTAL_FREQ / 4 = 4 MHz). soft_uart.c est compile
+ * tel quel avec les registres de xc.h :
+ *  - TMR2 leve TMR2IF tous les (PR2 + 1) * 4 cycles ;
+ *  - TMR1 compte tous les 8 cycles et, comme dans high_isr() du pilote
+ *    MRF24J40, il est recharge a 0x3CB0 apres chaque debordement, avec 1 a
+ *    8 comptes de retard ;
+ *  - ECCP1 et ECCP2 capturent TMR1 sur les fronts de la ligne RX ;
+ *  - un terminal distant envoie des octets aleatoires, avec une erreur de
+ *    debit ;
+ *  - l'interruption est prise apres une latence d'entree, puis occupe le
+ *    CPU pendant une duree estimee (MODELE_COUT_*) ;
+ *  - des rafales de l'interruption radio, au plus une par ms, bloquent les
+ *    interruptions.
+ * Les sorties du terminal et du projecteur sont decodees comme par un
+ * recepteur a 9600 bauds.
+ *
+ *   soft_uart_test          cas de "make check", code 1 si un cas echoue
+ *   soft_uart_test bench    erreurs et charge CPU selon le debit, la radio
+ *                           et le trafic
+ *
+ * La charge CPU vient des durees estimees, pas d'un simulateur du PIC18.
+ *******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/soft_uart.c"
+
+#define FCY                 (_XTAL_FREQ / 4)
+#define PERIODE_9600        ((double)FCY / 9600)    // Bit du recepteur des sorties TX
+#define LATENCE_TMR1_MAX    8                       // Comptes avant la recharge de high_isr()
+
+// Durees estimees de l'interruption, en cycles
+#define MODELE_COUT_ENTREE  90      // Entree, sauvegarde du contexte, retour
+#define MODELE_COUT_TICK    25
+#define MODELE_COUT_TX      45      // Par sortie active
+#define MODELE_COUT_SONDE   60      // SU_Sonde_RX()
+#define MODELE_COUT_FRONT   80      // Par front decode
+#define MODELE_COUT_START   30      // SU_Tick_On() sur le start bit
+
+volatile PIR1bits_t PIR1bits;
+volatile PIE1bits_t PIE1bits;
+volatile IPR1bits_t IPR1bits;
+volatile PIR2bits_t PIR2bits;
+volatile INTCONbits_t INTCONbits;
+volatile LATAbits_t LATAbits;
+volatile TRISAbits_t TRISAbits;
+volatile ANCON0bits_t ANCON0bits;
+volatile LATEbits_t LATEbits;
+volatile TRISEbits_t TRISEbits;
+volatile uint8_t T2CON, PR2;
+volatile uint8_t CCP1CON, CCPR1H, CCPR1L;
+volatile uint8_t CCP2CON, CCPR2H, CCPR2L;
+volatile uint8_t SPBRG, SYNC, SPEN, TRISC6, TRISC7, CREN, TXEN, TRMT, TXREG, RCIF, RCREG;
+
+typedef struct
+{
+    double erreur;          // Erreur de debit du terminal distant, %
+    int latence;            // Latence d'entree de l'interruption, cycles
+    double rafales;         // Rafales de l'interruption radio par seconde
+    int rafale;             // Duree d'une rafale, cycles
+    int tx;                 // Le programme envoie au terminal en continu
+    int rx;                 // Le terminal envoie en continu
+    int projecteur;         // Trames de 8 octets et 5 ms de silence au projecteur
+    int intervalle;         // Sinon, un octet envoye tous les intervalle cycles
+    double duree;           // Secondes simulees
+} CAS;
+
+typedef struct
+{
+    int recus, mauvais, erreurs_su;
+    int tx_envoyes, tx_decodes, tx_mauvais;
+    int pr_decodes, pr_mauvais, pr_silences_courts;
+    double cpu;             // %
+} RESULTAT;
+
+// Decodeur d'une sortie TX, comme un recepteur 9600 bauds
+typedef struct
+{
+    int precedent;
+    long long debut;        // Front du start bit, -1 au repos
+    int bit;
+    uint8_t octet;
+    long long fin;          // Fin du dernier stop bit
+    uint8_t attendus[4096];
+    uint8_t pauses[4096];
+    unsigned int ecrits, decodes, suivant, mauvais, silences_courts;
+} DECODEUR;
+
+static long long cycle;
+static uint16_t tmr1;
+static int tmr1_recharge;   // Comptes avant la recharge, 0 si pas de debordement
+static int tmr2;
+
+static double rx_periode;   // Cycles par bit du terminal distant
+static long long rx_t0;
+static uint8_t *rx_octets;
+static int rx_n;
+
+uint16_t Modele_TMR1(void)
+{
+    return tmr1;
+}
+
+static uint32_t alea = 1;
+
+static uint32_t Alea(void)
+{
+    alea = alea * 1103515245u + 12345u;
+    return alea >> 8;
+}
+
+// Niveau de la ligne RX a l'instant t : start, 8 bits LSB d'abord, stop
+static int Ligne_RX(long long t)
+{
+    double b;
+    int octet, bit;
+
+    if(t < rx_t0)
+        return 1;
+    b = (t - rx_t0) / rx_periode;
+    octet = (int)(b / 10);
+    bit = (int)(b - octet * 10.0);
+    if(octet >= rx_n)
+        return 1;
+    if(bit == 0)
+        return 0;
+    if(bit <= 8)
+        return (rx_octets[octet] >> (bit - 1)) & 1;
+    return 1;
+}
+
+static void Timers(void)
+{
+    if((cycle & 7) == 0)
+    {
+        if(tmr1 == 0xFFFF)
+        {
+            tmr1 = 0;
+            tmr1_recharge = 1 + Alea() % LATENCE_TMR1_MAX;
+        }
+        else if(tmr1_recharge && --tmr1_recharge == 0)
+            tmr1 = SU_TMR1_RECHARGE;
+        else
+            tmr1++;
+    }
+    if((T2CON & 0x04) && ++tmr2 >= (PR2 + 1) * 4)
+    {
+        tmr2 = 0;
+        PIR1bits.TMR2IF = 1;
+    }
+}
+
+static void Decode(DECODEUR *d, int niveau, long long silence_min)
+{
+    if(d->debut < 0)
+    {
+        if(d->precedent && !niveau)
+        {
+            d->debut = cycle;
+            d->bit = 1;
+            d->octet = 0;
+            if(d->suivant > 0 && d->suivant <= d->ecrits && d->pauses[(d->suivant - 1) % 4096] &&
+               cycle - d->fin < silence_min * d->pauses[(d->suivant - 1) % 4096])
+                d->silences_courts++;
+        }
+    }
+    else if(cycle == d->debut + (long long)((d->bit + 0.5) * PERIODE_9600))
+    {
+        if(d->bit <= 8)
+            d->octet |= niveau << (d->bit - 1);
+        else
+        {
+            unsigned int perdus = 0;
+            // Un octet abime ne doit pas compter tous les suivants
+            while(perdus < 3 && d->suivant + perdus < d->ecrits &&
+                  d->octet != d->attendus[(d->suivant + perdus) % 4096])
+                perdus++;
+            if(!niveau || perdus == 3 || d->suivant + perdus >= d->ecrits)
+                d->mauvais++;
+            else
+                d->suivant += perdus;
+            d->suivant++;
+            d->decodes++;
+            d->debut = -1;
+            d->fin = cycle + (long long)(PERIODE_9600 / 2);
+        }
+        d->bit++;
+    }
+    d->precedent = niveau;
+}
+
+static int Place(SU_TX *tx)
+{
+    return ((tx->tete + 1) & (SU_TX_TAILLE - 1)) != tx->queue;
+}
+
+static void Remise_A_Zero(void)
+{
+    memset((void *)&PIR1bits, 0, sizeof(PIR1bits));
+    memset((void *)&PIE1bits, 0, sizeof(PIE1bits));
+    memset((void *)&PIR2bits, 0, sizeof(PIR2bits));
+    memset((void *)&INTCONbits, 0, sizeof(INTCONbits));
+    memset(&su_terminal, 0, sizeof(su_terminal));
+    memset(&su_projecteur, 0, sizeof(su_projecteur));
+    T2CON = PR2 = CCP1CON = CCP2CON = 0;
+    rx_tete = rx_queue = rx_init = rx_actif = 0;
+    su_erreurs = 0;
+    cycle = 0;
+    tmr2 = 0;
+    tmr1 = SU_TMR1_RECHARGE + Alea() % SU_TMR1_PERIODE;
+    tmr1_recharge = 0;
+}
+
+static RESULTAT Simule(const CAS *c)
+{
+    static DECODEUR terminal, projecteur;
+    RESULTAT r;
+    long long total = (long long)(c->duree * FCY);
+    long long occupe = 0, occupe_jusqua = 0, radio_jusqua = 0, entree = -1;
+    long long prochain_octet = 0;
+    int ligne = 1, attendu = 0, i;
+
+    memset(&r, 0, sizeof(r));
+    memset(&terminal, 0, sizeof(terminal));
+    memset(&projecteur, 0, sizeof(projecteur));
+    terminal.debut = projecteur.debut = -1;
+    terminal.precedent = projecteur.precedent = 1;
+    Remise_A_Zero();
+
+    rx_periode = FCY / 9600.0 / (1 + c->erreur / 100);
+    rx_t0 = 1003;
+    rx_n = c->rx ? (int)((total - rx_t0) / rx_periode / 10) - 1 : 0;
+    rx_octets = malloc(rx_n + 1);
+    for(i = 0; i < rx_n; i++)
+        rx_octets[i] = Alea();
+
+    UART_Init_A2_A1();
+    UART_Init_Projecteur();
+
+    for(cycle = 0; cycle < total; cycle++)
+    {
+        int niveau = Ligne_RX(cycle);
+
+        Timers();
+        if(niveau != ligne)
+        {
+            uint16_t t = tmr1;
+            if(!niveau && CCP1CON == SU_CAPTURE_DESCENDANT)
+            {
+                CCPR1H = t >> 8;
+                CCPR1L = t & 0xFF;
+                PIR1bits.CCP1IF = 1;
+            }
+            if(niveau && CCP2CON == SU_CAPTURE_MONTANT)
+            {
+                CCPR2H = t >> 8;
+                CCPR2L = t & 0xFF;
+                PIR2bits.CCP2IF = 1;
+            }
+            ligne = niveau;
+        }
+        Decode(&terminal, UART_TX_V, 0);
+        Decode(&projecteur, LCD_BKLT, FCY / 1000);
+
+        // Au plus une rafale par trame radio, une trame dure au moins 1 ms a 250 kb/s
+        if(c->rafales > 0 && cycle >= radio_jusqua + FCY / 1000 && Alea() % 1000000 < c->rafales * 1000000 / FCY)
+            radio_jusqua = cycle + c->rafale;
+        if(cycle < occupe_jusqua || cycle < radio_jusqua)
+            continue;
+
+        if(INTCONbits.GIE && ((PIE1bits.TMR2IE && PIR1bits.TMR2IF) || (PIE1bits.CCP1IE && PIR1bits.CCP1IF)))
+        {
+            if(entree < 0)
+                entree = cycle + c->latence;
+            if(cycle >= entree)
+            {
+                int tick = PIE1bits.TMR2IE && PIR1bits.TMR2IF;
+                int start = PIE1bits.CCP1IE && PIR1bits.CCP1IF;
+                int sorties = su_terminal.actif + su_projecteur.actif;
+                int fronts = PIR1bits.CCP1IF + PIR2bits.CCP2IF;
+                long long cout = MODELE_COUT_ENTREE;
+
+                SoftUART_InterruptHandler();
+                if(tick)
+                    cout += MODELE_COUT_TICK + MODELE_COUT_TX * sorties + MODELE_COUT_SONDE + MODELE_COUT_FRONT * fronts;
+                if(start)
+                    cout += MODELE_COUT_START;
+                occupe += cout;
+                occupe_jusqua = cycle + cout;
+                entree = -1;
+                continue;
+            }
+        }
+
+        // Programme principal
+        while(UART_kbhit_A2_A1())
+        {
+            uint8_t octet = UART_Read_A2_A1();
+            int perdus = 0;
+            // Un octet perdu (su_erreurs) ne doit pas compter tous les suivants
+            while(perdus < 3 && attendu + perdus < rx_n && octet != rx_octets[attendu + perdus])
+                perdus++;
+            if(perdus == 3 || attendu + perdus >= rx_n)
+                r.mauvais++;
+            else
+                attendu += perdus;
+            attendu++;
+            r.recus++;
+        }
+        if(cycle < prochain_octet)
+            continue;
+        if(c->tx && Place(&su_terminal))
+        {
+            uint8_t octet = Alea();
+            terminal.attendus[terminal.ecrits++ % 4096] = octet;
+            UART_Write_A2_A1(octet);
+            prochain_octet = cycle + c->intervalle;
+        }
+        if(c->projecteur && Place(&su_projecteur))
+        {
+            uint8_t octet = Alea();
+            uint8_t pause = (projecteur.ecrits % 8 == 7) ? 5 : 0;
+            projecteur.attendus[projecteur.ecrits % 4096] = octet;
+            projecteur.pauses[projecteur.ecrits++ % 4096] = pause;
+            UART_Write_Projecteur(octet, pause);
+        }
+    }
+
+    r.erreurs_su = su_erreurs;
+    r.tx_envoyes = terminal.ecrits;
+    r.tx_decodes = terminal.decodes;
+    r.tx_mauvais = terminal.mauvais;
+    r.pr_decodes = projecteur.decodes;
+    r.pr_mauvais = projecteur.mauvais;
+    r.pr_silences_courts = projecteur.silences_courts;
+    r.cpu = 100.0 * occupe / total;
+    free(rx_octets);
+    return r;
+}
+
+// Pire ecart de SU_Ecart() avec le nombre de comptes reel, TMR1 recharge par high_isr()
+static int Pire_Ecart(void)
+{
+    enum { N = 400000 };
+    static uint16_t valeurs[N];
+    int pire = 0, i;
+
+    tmr1 = SU_TMR1_RECHARGE;
+    tmr1_recharge = 0;
+    for(i = 0; i < N; i++)
+    {
+        valeurs[i] = tmr1;
+        cycle = 0;
+        Timers();
+    }
+    for(i = 0; i < 2000000; i++)
+    {
+        int debut = Alea() % (N - 45000);
+        int comptes = Alea() % 45000;
+        int erreur = comptes - SU_Ecart(valeurs[debut], valeurs[debut + comptes]);
+        if(erreur < 0)
+            erreur = -erreur;
+        if(erreur > pire)
+            pire = erreur;
+    }
+    return pire;
+}
+
+static int echecs = 0;
+
+static void Verifie(int ok, const char *cas, const char *quoi)
+{
+    if(!ok)
+    {
+        printf("soft_uart_test: ECHEC %s : %s\n", cas, quoi);
+        echecs++;
+    }
+}
+
+static void Affiche(const char *nom, const CAS *c, const RESULTAT *r)
+{
+    printf("%-24s erreur %+4.1f%%  radio %4.0f/s x %3d us  rx %5d mauvais %3d err %3d  "
+           "tx %5d mauvais %3d  projecteur %4d mauvais %2d  CPU %5.1f%%\n",
+           nom, c->erreur, c->rafales, c->rafale / (FCY / 1000000), r->recus, r->mauvais, r->erreurs_su,
+           r->tx_decodes, r->tx_mauvais, r->pr_decodes, r->pr_mauvais, r->cpu);
+}
+
+static void Check(void)
+{
+    static const double erreurs[] = { -3, -1.5, 0, 1.5, 3 };
+    CAS c;
+    RESULTAT r;
+    char nom[64];
+    unsigned int i;
+    int pire = Pire_Ecart();
+
+    Verifie(pire <= LATENCE_TMR1_MAX + 1, "SU_Ecart", "plus que la latence de la recharge perdue");
+    printf("soft_uart_test: SU_Ecart, pire erreur %d comptes de TMR1 sur 2000000 paires\n", pire);
+
+    // Full duplex et projecteur a la fois
+    memset(&c, 0, sizeof(c));
+    c.latence = 40;
+    c.tx = c.rx = c.projecteur = 1;
+    c.duree = 2;
+    for(i = 0; i < sizeof(erreurs) / sizeof(erreurs[0]); i++)
+    {
+        c.erreur = erreurs[i];
+        r = Simule(&c);
+        snprintf(nom, sizeof(nom), "full duplex %+.1f%%", c.erreur);
+        Affiche(nom, &c, &r);
+        Verifie(r.mauvais == 0 && r.erreurs_su == 0 && r.recus >= rx_n, nom, "octets recus perdus ou faux");
+        Verifie(r.tx_mauvais == 0 && r.tx_decodes + SU_TX_TAILLE >= r.tx_envoyes, nom, "envoi au terminal faux");
+        Verifie(r.pr_mauvais == 0 && r.pr_decodes > 0, nom, "envoi au projecteur faux");
+        Verifie(r.pr_silences_courts == 0, nom, "silence apres une trame du projecteur trop court");
+    }
+
+    // Reception pendant des rafales radio de 100 us
+    c.tx = c.projecteur = 0;
+    c.rafales = 500;
+    c.rafale = 100 * (FCY / 1000000);
+    for(i = 0; i < sizeof(erreurs) / sizeof(erreurs[0]); i += 2)
+    {
+        c.erreur = erreurs[i];
+        r = Simule(&c);
+        snprintf(nom, sizeof(nom), "rx, radio %+.1f%%", c.erreur);
+        Affiche(nom, &c, &r);
+        Verifie(r.mauvais == 0 && r.erreurs_su == 0 && r.recus >= rx_n, nom, "octets recus perdus ou faux");
+    }
+
+    // Au repos, le tick est coupe
+    memset(&c, 0, sizeof(c));
+    c.latence = 40;
+    c.duree = 1;
+    r = Simule(&c);
+    Verifie(r.cpu == 0 && !PIE1bits.TMR2IE && PIE1bits.CCP1IE, "repos", "interruptions sans trafic");
+}
+
+static void Bench(void)
+{
+    CAS c;
+    RESULTAT r;
+    int i;
+
+    memset(&c, 0, sizeof(c));
+    c.latence = 40;
+    c.duree = 4;
+    c.tx = c.rx = 1;
+    for(i = -6; i <= 6; i++)
+    {
+        c.erreur = i;
+        r = Simule(&c);
+        Affiche("full duplex", &c, &r);
+    }
+    c.erreur = 0;
+    c.rafales = 500;
+    for(i = 25; i <= 150; i += 25)
+    {
+        c.rafale = i * (FCY / 1000000);
+        r = Simule(&c);
+        Affiche("full duplex, radio", &c, &r);
+    }
+    c.rafales = 0;
+    c.rafale = 0;
+    c.rx = 0;
+    r = Simule(&c);
+    Affiche("tx seulement", &c, &r);
+    c.intervalle = FCY / 50;
+    r = Simule(&c);
+    Affiche("tx, un octet / 20 ms", &c, &r);
+    c.tx = 0;
+    r = Simule(&c);
+    Affiche("repos", &c, &r);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 1 && strcmp(argv[1], "bench") == 0)
+        Bench();
+    else
+        Check();
+    if(echecs == 0)
+        printf("soft_uart_test: %s\n", argc > 1 ? "fini" : "tous les cas passent");
+    return echecs ? 1 : 0;
+}
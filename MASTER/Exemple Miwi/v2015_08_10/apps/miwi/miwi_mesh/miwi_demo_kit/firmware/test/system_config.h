@@ -0,0 +1,20 @@
+/********************************************************************
+ * Broches du UART logiciel pour soft_uart_test.c, memes noms que
+ * system_config/miwikit_pic18f46j50_24j40/system_config.h
+ *******************************************************************/
+#ifndef _SYSTEM_CONFIG_H_TEST
+#define _SYSTEM_CONFIG_H_TEST
+
+#include <xc.h>
+
+#define UART_TX_V           LATAbits.LATA2
+#define UART_TX_TRIS        TRISAbits.TRISA2
+#define TX_ANALOG_DIGITAL   ANCON0bits.PCFG2
+
+#define UART_RX_TRIS        TRISAbits.TRISA1
+#define RX_ANALOG_DIGITAL   ANCON0bits.PCFG1
+
+#define LCD_BKLT_TRIS       TRISEbits.TRISE1
+#define LCD_BKLT            LATEbits.LATE1
+
+#endif
@@ -0,0 +1,46 @@
+/********************************************************************
+ * Remplacant de <xc.h> pour compiler soft_uart.c sur le PC
+ *
+ * Seuls les registres utilises par soft_uart.c sont declares. Ils sont
+ * definis par soft_uart_test.c, qui fait avancer TMR1, TMR2 et les
+ * captures cycle par cycle. TMR1H et TMR1L sont lus dans le modele.
+ *******************************************************************/
+#ifndef _XC_H_TEST
+#define _XC_H_TEST
+
+#include <stdint.h>
+
+typedef struct { unsigned TMR2IF:1; unsigned CCP1IF:1; } PIR1bits_t;
+typedef struct { unsigned TMR2IE:1; unsigned CCP1IE:1; } PIE1bits_t;
+typedef struct { unsigned TMR2IP:1; unsigned CCP1IP:1; } IPR1bits_t;
+typedef struct { unsigned CCP2IF:1; } PIR2bits_t;
+typedef struct { unsigned GIE:1; unsigned PEIE:1; } INTCONbits_t;
+typedef struct { unsigned LATA2:1; } LATAbits_t;
+typedef struct { unsigned TRISA1:1; unsigned TRISA2:1; } TRISAbits_t;
+typedef struct { unsigned PCFG1:1; unsigned PCFG2:1; } ANCON0bits_t;
+typedef struct { unsigned LATE1:1; } LATEbits_t;
+typedef struct { unsigned TRISE1:1; } TRISEbits_t;
+
+extern volatile PIR1bits_t PIR1bits;
+extern volatile PIE1bits_t PIE1bits;
+extern volatile IPR1bits_t IPR1bits;
+extern volatile PIR2bits_t PIR2bits;
+extern volatile INTCONbits_t INTCONbits;
+extern volatile LATAbits_t LATAbits;
+extern volatile TRISAbits_t TRISAbits;
+extern volatile ANCON0bits_t ANCON0bits;
+extern volatile LATEbits_t LATEbits;
+extern volatile TRISEbits_t TRISEbits;
+
+extern volatile uint8_t T2CON, PR2;
+extern volatile uint8_t CCP1CON, CCPR1H, CCPR1L;
+extern volatile uint8_t CCP2CON, CCPR2H, CCPR2L;
+
+uint16_t Modele_TMR1(void);
+#define TMR1H   ((uint8_t)(Modele_TMR1() >> 8))
+#define TMR1L   ((uint8_t)Modele_TMR1())
+
+// UART materiel, pas utilise par le modele
+extern volatile uint8_t SPBRG, SYNC, SPEN, TRISC6, TRISC7, CREN, TXEN, TRMT, TXREG, RCIF, RCREG;
+
+#endif
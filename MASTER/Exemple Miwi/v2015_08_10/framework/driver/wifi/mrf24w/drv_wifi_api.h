@@ -70,6 +70,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define WF_USE_INDIVIDUAL_SET_GETS
 #define WF_USE_GROUP_SET_GETS
 //#define USE_GRATUITOUS_ARP
+//#define WF_USE_FAST_RECONNECT /* needs WF_USE_SCAN_FUNCTIONS and WF_USE_INDIVIDUAL_SET_GETS */
 
 /*******************************************************************************
 *                              DEFINES
@@ -865,6 +866,20 @@ typedef struct
 
 } tWFScanResult;
 
+/*--------------------------------------------*/
+/* Host cache of scan results, see WF_Scan()  */
+/*--------------------------------------------*/
+typedef struct
+{
+    uint8_t      bssid[WF_BSSID_LENGTH]; // Network BSSID value
+    uint8_t      ssid[WF_MAX_SSID_LENGTH]; // Network SSID value
+    uint8_t      ssidLen; // Number of valid characters in ssid, 0 if the entry is free
+    uint8_t      channel; // Channel number
+    uint8_t      rssi; // Signal strength, see tWFScanResult
+    uint8_t      apConfig; // Security bits, see tWFScanResult
+    uint32_t     updated; // TickGet() when the AP was last seen
+} tWFScanCacheEntry;
+
 typedef struct WFHibernate {
     uint8_t state;
     uint8_t wakeup_notice;
@@ -2284,6 +2299,48 @@ void WF_CAGetElements(tWFCAElements *p_elements);
   *****************************************************************************/
 void WF_CMConnect(uint8_t CpId);
 
+#if defined(WF_USE_FAST_RECONNECT)
+/*******************************************************************************
+  Function:
+    void WF_CMFastConnect(uint8_t CpId)
+
+  Summary:
+    Connects with the help of the host scan cache, and reconnects the same
+    way after a link loss.
+
+  Description:
+    Replaces WF_CMConnect() for a single Connection Profile.  When the scan
+    cache knows an access point with the SSID of the profile, the MRF24W
+    first probes only that BSSID on its channel.  If that attempt fails, the
+    access point is removed from the cache and a normal connection over the
+    whole channel list follows.
+
+    The host then handles link losses itself: the beacon timeout and deauth
+    actions are set to WF_DO_NOT_ATTEMPT_TO_RECONNECT and, as soon as the
+    link is lost, MACProcess() starts a directed attempt to the last access
+    point (MRF24WG only), then to the access points of the cache.  While connected,
+    MACProcess() also scans one channel of the list every
+    WF_ROAM_SCAN_INTERVAL when the stack is idle, so that the cache always
+    holds the strongest access point of the network.
+
+  Precondition:
+    MACInit must be called first.  The connection profile and the connection
+    algorithm (channel list, list retry count, scan type) are set.
+
+  Parameters:
+    CpId - Connection Profile to connect with.
+
+  Returns:
+    None.
+
+  Remarks:
+    The channel list, list retry count, scan type and BSSID of the profile
+    are restored after each directed attempt.  Call WF_CMDisconnect() as
+    usual to stop, this also stops the reconnections.
+  *****************************************************************************/
+void WF_CMFastConnect(uint8_t CpId);
+#endif /* WF_USE_FAST_RECONNECT */
+
 /*******************************************************************************
   Function:
     uint16_t WF_CMDisconnect(void)
@@ -3290,6 +3347,60 @@ void WF_GetMacStats(tWFMacStats *p_macStats);
   *****************************************************************************/
     void WF_ScanGetResult(uint8_t         listIndex,
                           tWFScanResult *p_scanResult);
+
+/*******************************************************************************
+  Function:
+    bool WF_ScanCacheFind(uint8_t *p_ssid, uint8_t ssidLen, tWFScanCacheEntry *p_entry)
+
+  Summary:
+    Looks up the host cache of scan results.
+
+  Description:
+    Every infrastructure network read with WF_ScanGetResult() is kept in a
+    cache of WF_SCAN_CACHE_SIZE entries, the least recently seen access point
+    being replaced.  This function returns the strongest access point with
+    the given SSID seen in the last WF_SCAN_CACHE_AGE ticks.
+
+  Precondition:
+    None.
+
+  Parameters:
+    p_ssid - SSID of the network
+    ssidLen - Number of bytes in p_ssid
+    p_entry - Where the cache entry is copied
+
+  Returns:
+    true if an access point was found, else false.
+
+  Remarks:
+    None.
+  *****************************************************************************/
+    bool WF_ScanCacheFind(uint8_t *p_ssid, uint8_t ssidLen, tWFScanCacheEntry *p_entry);
+
+/*******************************************************************************
+  Function:
+    void WF_ScanCacheRemove(uint8_t *p_bssid)
+
+  Summary:
+    Removes an access point from the host cache of scan results.
+
+  Description:
+    Used when a connection to the access point failed, so that it is not
+    tried first again before a scan sees it anew.
+
+  Precondition:
+    None.
+
+  Parameters:
+    p_bssid - BSSID of the access point
+
+  Returns:
+    None.
+
+  Remarks:
+    None.
+  *****************************************************************************/
+    void WF_ScanCacheRemove(uint8_t *p_bssid);
 #endif /* WF_SCAN_FUNCTIONS */
 
 /*****************************************************************************
@@ -3582,6 +3693,8 @@ extern void WF_DisableModuleConnectionManager(void);
 extern void pbkdf2_sha1(const char *passphrase, const char *ssid, uint16_t ssid_len,
                         uint16_t iterations, uint8_t *buf, uint16_t buflen);
 
+extern void sha1_vector(size_t num_elem, const uint8_t *addr[], const size_t *len, uint8_t *mac);
+
 extern void WF_ConvPassphraseToKey(uint8_t key_len, uint8_t *key, uint8_t ssid_len, uint8_t *ssid);
 
 #endif /* __DRV_WF_API_H_ */
@@ -55,12 +55,71 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
     #define WF_MODULE_NUMBER    WF_MODULE_WF_CONNECTION_MANAGER
 #endif
 
+#if defined(WF_USE_FAST_RECONNECT)
+#if !defined(WF_USE_SCAN_FUNCTIONS) || !defined(WF_USE_INDIVIDUAL_SET_GETS)
+    #error "WF_USE_FAST_RECONNECT needs WF_USE_SCAN_FUNCTIONS and WF_USE_INDIVIDUAL_SET_GETS"
+#endif
+
+/* Interval between the background scans of one channel while connected */
+#if !defined(WF_ROAM_SCAN_INTERVAL)
+    #define WF_ROAM_SCAN_INTERVAL       (10ul * TICK_SECOND)
+#endif
+
+/* A background scan only starts when no stack timer expires sooner, see StackGetIdleTime() */
+#if !defined(WF_ROAM_SCAN_MIN_IDLE)
+    #define WF_ROAM_SCAN_MIN_IDLE       (TICK_SECOND / 2)
+#endif
+
+/* Delay before the next attempt when a connection over the whole channel list failed */
+#if !defined(WF_FAST_RECONNECT_RETRY)
+    #define WF_FAST_RECONNECT_RETRY     (5ul * TICK_SECOND)
+#endif
+
+#define FR_NO_EVENT         (0xff)
+
+/* States of the host driven connection, see WF_CMFastConnect() */
+typedef enum
+{
+    FR_STOPPED = 0,     /* not used, or stopped by WF_CMDisconnect() */
+    FR_CONNECT,         /* connection to start from MACProcess() */
+    FR_DIRECTED,        /* connecting to the access point found in the scan cache */
+    FR_FULL,            /* connecting over the whole channel list */
+    FR_CONNECTED,
+    FR_SCANNING,        /* background scan of one channel */
+    FR_RETRY            /* waiting WF_FAST_RECONNECT_RETRY after FR_FULL failed */
+} tFastReconnectState;
+#endif /* WF_USE_FAST_RECONNECT */
+
 /*******************************************************************************
  *                          LOCAL GLOBAL VARIABLES
  *******************************************************************************/
 
 static bool g_LogicalConnection = false;
 
+#if defined(WF_USE_FAST_RECONNECT)
+static struct
+{
+    uint8_t  state;
+    uint8_t  cpId;
+    uint8_t  event;                                 /* last connection event, FR_NO_EVENT if none */
+    uint8_t  scanResults;                           /* results of the background scan, FR_NO_EVENT until ready */
+    uint8_t  channelList[WF_CHANNEL_LIST_LENGTH];   /* settings of the application, restored */
+    uint8_t  numChannels;                           /* after each directed attempt */
+    uint8_t  listRetryCount;
+    uint8_t  scanType;
+    uint8_t  cpBssid[WF_BSSID_LENGTH];
+    uint8_t  bssid[WF_BSSID_LENGTH];                /* access point of the directed attempt */
+    uint8_t  lastBssid[WF_BSSID_LENGTH];            /* access point of the last connection */
+    uint8_t  lastChannel;                           /* 0 if unknown */
+    uint8_t  scanIndex;                             /* next channel of the background scan */
+    uint32_t timer;
+} g_fastReconnect;
+
+static void FastConnectStart(bool lastAp);
+static void FastConnectRestore(void);
+static void FastConnectDone(void);
+#endif /* WF_USE_FAST_RECONNECT */
+
 /*******************************************************************************
   Function:
     void WF_CMConnect(uint8_t CpId)
@@ -183,6 +242,14 @@ uint16_t WF_CMDisconnect(void)
 {
     uint8_t  hdrBuf[2];
 
+#if defined(WF_USE_FAST_RECONNECT)
+    if (g_fastReconnect.state == FR_DIRECTED)
+        FastConnectRestore();
+    else if (g_fastReconnect.state == FR_SCANNING)
+        WF_CASetChannelList(g_fastReconnect.channelList, g_fastReconnect.numChannels);
+    g_fastReconnect.state = FR_STOPPED;
+#endif
+
     /* Check if we can call disconnect. Disconnect can work only in the connected state */
     if (!WF_CMIsDisconnectAllowed())
     {
@@ -404,6 +471,291 @@ void WF_CMGetConnectContext(tWFConnectContext *p_ctx)
 }
 #endif /* MRF24WG */
 
+#if defined(WF_USE_FAST_RECONNECT)
+/*******************************************************************************
+  Function:
+    void WF_CMFastConnect(uint8_t CpId)
+
+  Summary:
+    Connects with the help of the host scan cache, and reconnects the same
+    way after a link loss.
+
+  Description:
+    Saves the connection algorithm settings of the application, makes the
+    MRF24W report link losses instead of reconnecting by itself, and lets
+    WFFastReconnectTask() start the connection from MACProcess().
+
+  Precondition:
+    MACInit must be called first.
+
+  Parameters:
+    CpId - Connection Profile to connect with.
+
+  Returns:
+    None.
+
+  Remarks:
+    See drv_wifi_api.h.
+  *****************************************************************************/
+void WF_CMFastConnect(uint8_t CpId)
+{
+    g_fastReconnect.cpId = CpId;
+    WF_CAGetChannelList(g_fastReconnect.channelList, &g_fastReconnect.numChannels);
+    WF_CAGetListRetryCount(&g_fastReconnect.listRetryCount);
+    WF_CAGetScanType(&g_fastReconnect.scanType);
+    WF_CPGetBssid(CpId, g_fastReconnect.cpBssid);
+
+    WF_CASetBeaconTimeoutAction(WF_DO_NOT_ATTEMPT_TO_RECONNECT);
+    WF_CASetDeauthAction(WF_DO_NOT_ATTEMPT_TO_RECONNECT);
+
+    g_fastReconnect.lastChannel = 0;
+    g_fastReconnect.state = FR_CONNECT;
+}
+
+/*****************************************************************************
+ * FUNCTION: FastConnectStart
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   lastAp -- true to try the access point of the last connection
+ *                     first
+ *
+ *  NOTES:   Starts a connection with a directed probe on one channel only, to
+ *           the last access point or else to the strongest access point of
+ *           the network in the scan cache, or a normal connection when the
+ *           cache has none.
+ *****************************************************************************/
+static void FastConnectStart(bool lastAp)
+{
+    tWFScanCacheEntry ap;
+    uint8_t ssid[WF_MAX_SSID_LENGTH];
+    uint8_t ssidLen;
+
+    g_fastReconnect.event = FR_NO_EVENT;
+
+    WF_CPGetSsid(g_fastReconnect.cpId, ssid, &ssidLen);
+    if (lastAp && g_fastReconnect.lastChannel != 0u)
+    {
+        // Its cache entry may be old, its channel is scanned only once per
+        // round of background scans
+        memcpy(ap.bssid, g_fastReconnect.lastBssid, WF_BSSID_LENGTH);
+        ap.channel = g_fastReconnect.lastChannel;
+        lastAp = true;
+    }
+    else
+    {
+        lastAp = WF_ScanCacheFind(ssid, ssidLen, &ap);
+    }
+
+    if (lastAp)
+    {
+        memcpy(g_fastReconnect.bssid, ap.bssid, WF_BSSID_LENGTH);
+        WF_CASetChannelList(&ap.channel, 1);
+        WF_CASetListRetryCount(1);
+        WF_CASetScanType(WF_ACTIVE_SCAN);
+        WF_CPSetBssid(g_fastReconnect.cpId, ap.bssid);
+        g_fastReconnect.state = FR_DIRECTED;
+    }
+    else
+    {
+        g_fastReconnect.state = FR_FULL;
+    }
+
+    WF_CMConnect(g_fastReconnect.cpId);
+}
+
+/*****************************************************************************
+ * FUNCTION: FastConnectRestore
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   None
+ *
+ *  NOTES:   Restores the settings of the application changed by a directed
+ *           connection attempt or a background scan.
+ *****************************************************************************/
+static void FastConnectRestore(void)
+{
+    WF_CASetChannelList(g_fastReconnect.channelList, g_fastReconnect.numChannels);
+    WF_CASetListRetryCount(g_fastReconnect.listRetryCount);
+    WF_CASetScanType(g_fastReconnect.scanType);
+    WF_CPSetBssid(g_fastReconnect.cpId, g_fastReconnect.cpBssid);
+}
+
+/*****************************************************************************
+ * FUNCTION: FastConnectDone
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   None
+ *
+ *  NOTES:   Records the access point of a new connection and schedules the
+ *           first background scan, on its channel.
+ *****************************************************************************/
+static void FastConnectDone(void)
+{
+    uint8_t i;
+#if defined(MRF24WG)
+    tWFConnectContext context;
+
+    WF_CMGetConnectContext(&context);
+    memcpy(g_fastReconnect.lastBssid, context.bssid, WF_BSSID_LENGTH);
+    g_fastReconnect.lastChannel = context.channel;
+#endif
+
+    for (i = 0; i < g_fastReconnect.numChannels; i++)
+    {
+        if (g_fastReconnect.channelList[i] == g_fastReconnect.lastChannel)
+            break;
+    }
+    g_fastReconnect.scanIndex = i;
+    g_fastReconnect.state = FR_CONNECTED;
+    g_fastReconnect.timer = TickGet() - WF_ROAM_SCAN_INTERVAL;
+}
+
+/*****************************************************************************
+ * FUNCTION: WFFastReconnectEvent
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   event     -- WF_EVENT_* from the MRF24W
+ *           eventInfo -- additional info, number of results for a scan
+ *
+ *  NOTES:   Called by WFProcessMgmtIndicateMsg() for every event.  No
+ *           management message can be sent from there, the events are only
+ *           recorded for WFFastReconnectTask().
+ *****************************************************************************/
+void WFFastReconnectEvent(uint8_t event, uint16_t eventInfo)
+{
+    switch (event)
+    {
+    case WF_EVENT_CONNECTION_SUCCESSFUL:
+    case WF_EVENT_CONNECTION_FAILED:
+    case WF_EVENT_CONNECTION_TEMPORARILY_LOST:
+    case WF_EVENT_CONNECTION_PERMANENTLY_LOST:
+        g_fastReconnect.event = event;
+        break;
+
+    case WF_EVENT_SCAN_RESULTS_READY:
+        g_fastReconnect.scanResults = (uint8_t)eventInfo;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*****************************************************************************
+ * FUNCTION: WFFastReconnectTask
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   None
+ *
+ *  NOTES:   Called from MACProcess().  Connects and reconnects after a link
+ *           loss, first to the access point in the scan cache, and keeps the
+ *           cache up to date with one channel scans while the stack is idle.
+ *****************************************************************************/
+void WFFastReconnectTask(void)
+{
+    uint8_t event;
+    uint8_t i;
+    tWFScanResult result;
+
+    if (g_fastReconnect.state == FR_STOPPED)
+        return;
+
+    event = g_fastReconnect.event;
+    g_fastReconnect.event = FR_NO_EVENT;
+
+    switch (g_fastReconnect.state)
+    {
+    case FR_CONNECT:
+        FastConnectStart(false);
+        break;
+
+    case FR_DIRECTED:
+        if (event == WF_EVENT_CONNECTION_SUCCESSFUL)
+        {
+            FastConnectRestore();
+            FastConnectDone();
+        }
+        else if (event == WF_EVENT_CONNECTION_FAILED || event == WF_EVENT_CONNECTION_PERMANENTLY_LOST)
+        {
+            // Not there anymore, try the next access point of the cache,
+            // then all the channels
+            WF_ScanCacheRemove(g_fastReconnect.bssid);
+            FastConnectRestore();
+            FastConnectStart(false);
+        }
+        break;
+
+    case FR_FULL:
+        if (event == WF_EVENT_CONNECTION_SUCCESSFUL)
+        {
+            FastConnectDone();
+        }
+        else if (event == WF_EVENT_CONNECTION_FAILED || event == WF_EVENT_CONNECTION_PERMANENTLY_LOST)
+        {
+            g_fastReconnect.state = FR_RETRY;
+            g_fastReconnect.timer = TickGet();
+        }
+        break;
+
+    case FR_RETRY:
+        if (TickGet() - g_fastReconnect.timer >= WF_FAST_RECONNECT_RETRY)
+            FastConnectStart(false);
+        break;
+
+    case FR_CONNECTED:
+        if (event == WF_EVENT_CONNECTION_TEMPORARILY_LOST || event == WF_EVENT_CONNECTION_PERMANENTLY_LOST)
+        {
+            FastConnectStart(true);
+            break;
+        }
+
+        if (TickGet() - g_fastReconnect.timer < WF_ROAM_SCAN_INTERVAL
+            || StackGetIdleTime() < WF_ROAM_SCAN_MIN_IDLE)
+            break;
+
+        g_fastReconnect.timer = TickGet();
+        if (g_fastReconnect.numChannels == 0u)
+            break;
+
+        if (g_fastReconnect.scanIndex >= g_fastReconnect.numChannels)
+            g_fastReconnect.scanIndex = 0;
+
+        g_fastReconnect.scanResults = FR_NO_EVENT;
+        WF_CASetChannelList(&g_fastReconnect.channelList[g_fastReconnect.scanIndex], 1);
+        if (WF_Scan(g_fastReconnect.cpId) == WF_SUCCESS)
+            g_fastReconnect.state = FR_SCANNING;
+        else
+            WF_CASetChannelList(g_fastReconnect.channelList, g_fastReconnect.numChannels);
+        g_fastReconnect.scanIndex++;
+        break;
+
+    case FR_SCANNING:
+        if (event == WF_EVENT_CONNECTION_TEMPORARILY_LOST || event == WF_EVENT_CONNECTION_PERMANENTLY_LOST)
+        {
+            WF_CASetChannelList(g_fastReconnect.channelList, g_fastReconnect.numChannels);
+            FastConnectStart(true);
+            break;
+        }
+
+        if (g_fastReconnect.scanResults == FR_NO_EVENT)
+            break;
+
+        // WF_ScanGetResult() adds the results to the cache
+        for (i = 0; i < g_fastReconnect.scanResults; i++)
+            WF_ScanGetResult(i, &result);
+
+        WF_CASetChannelList(g_fastReconnect.channelList, g_fastReconnect.numChannels);
+        g_fastReconnect.state = FR_CONNECTED;
+        break;
+    }
+}
+#endif /* WF_USE_FAST_RECONNECT */
+
 #if defined(__XC32)
 /*******************************************************************************
   Function:
@@ -427,16 +779,51 @@ void WF_CMGetConnectContext(tWFConnectContext *p_ctx)
     None.
 
   Remarks:
-    None.
+    With EZ_CONFIG_STORE, the last WF_PSK_CACHE_SIZE keys are kept in
+    AppConfig.PskCache, indexed by a hash of the SSID and passphrase, and
+    a passphrase found there is converted without the 4096 PBKDF2
+    iterations.  The cache reaches NVM with the rest of AppConfig when the
+    application calls SaveAppConfig(), as WFEasyConfigProcess() does.
  *****************************************************************************/
 void
 WF_ConvPassphraseToKey(uint8_t key_len, uint8_t *key, uint8_t ssid_len, uint8_t *ssid)
 {
     uint8_t psk[32];
+#if defined(EZ_CONFIG_STORE)
+    uint8_t tag[SHA1_MAC_LEN];
+    const uint8_t *addr[3];
+    size_t len[3];
+    uint8_t i;
+#endif
 
     key[key_len] = '\0';
+
+#if defined(EZ_CONFIG_STORE)
+    addr[0] = &ssid_len;
+    len[0] = 1;
+    addr[1] = ssid;
+    len[1] = ssid_len;
+    addr[2] = key;
+    len[2] = key_len;
+    sha1_vector(3, addr, len, tag);
+
+    for (i = 0; i < WF_PSK_CACHE_SIZE; i++) {
+        if (memcmp(AppConfig.PskCache[i].tag, tag, sizeof(AppConfig.PskCache[i].tag)) == 0) {
+            memcpy(key, AppConfig.PskCache[i].psk, 32);
+            return;
+        }
+    }
+#endif
+
     pbkdf2_sha1((const char *)key, (const char *)ssid, ssid_len, 4096, (uint8_t *)psk, 32);
     memcpy(key, psk, 32);
+
+#if defined(EZ_CONFIG_STORE)
+    i = AppConfig.PskCacheNext % WF_PSK_CACHE_SIZE;
+    memcpy(AppConfig.PskCache[i].tag, tag, sizeof(AppConfig.PskCache[i].tag));
+    memcpy(AppConfig.PskCache[i].psk, psk, 32);
+    AppConfig.PskCacheNext = i + 1;
+#endif
 }
 #endif /* __XC32 */
 
@@ -92,6 +92,9 @@ static bool isEventNotifyBitSet(uint8_t notifyMask, uint8_t notifyBit);
 
 extern void SignalWiFiConnectionChanged(bool state);
 extern void RenewDhcp(void);
+#if defined(WF_USE_FAST_RECONNECT)
+extern void WFFastReconnectEvent(uint8_t event, uint16_t eventInfo);
+#endif
 
 /*****************************************************************************
  * FUNCTION: WFProcessMgmtIndicateMsg
@@ -256,6 +259,10 @@ void WFProcessMgmtIndicateMsg()
     /* free mgmt buffer */
     DeallocateMgmtRxBuffer();
 
+    #if defined(WF_USE_FAST_RECONNECT)
+    WFFastReconnectEvent(event, eventInfo);
+    #endif
+
     /* if the application wants to be notified of the event */
     if (isNotifyApp(event))
     {
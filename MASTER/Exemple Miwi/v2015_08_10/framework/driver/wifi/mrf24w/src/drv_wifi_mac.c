@@ -177,6 +177,10 @@ extern void WFDisplayScanMgr(void);
 
 extern void WF_Connect(void);
 
+#if defined(WF_USE_FAST_RECONNECT)
+extern void WFFastReconnectTask(void);
+#endif
+
 /*****************************************************************************
  * FUNCTION: SyncENCPtrRAWState
  *
@@ -438,6 +442,11 @@ void MACProcess(void)
     // Let 802.11 processes have a chance to run
     WFProcess();
 
+    // reconnects after a link loss and refreshes the scan cache, see WF_CMFastConnect()
+    #if defined(WF_USE_FAST_RECONNECT)
+    WFFastReconnectTask();
+    #endif
+
     #if defined( WF_CONSOLE_IFCFGUTIL )
            if (WF_hibernate.wakeup_notice && WF_hibernate.state == WF_HB_WAIT_WAKEUP)
          {
@@ -1472,6 +1481,42 @@ bool MACIsMemCopyDone(void)
     return true;
 }
 
+/******************************************************************************
+ * Function:        uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+ *
+ * PreCondition:    SPI bus must be initialized (done in MACInit()).
+ *
+ * Input:           destAddr:   Destination address in the Ethernet memory
+ *                  sourceAddr: Source address in the Ethernet memory
+ *                  len:        Number of bytes to copy
+ *
+ * Output:          One's complement sum of the copied bytes, not
+ *                  complemented (see CalcIPChecksumAdd())
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies bytes within the buffer and returns their sum.
+ *
+ * Note:            The copy is done by the MRF24W, the bytes are read back
+ *                  from the destination to sum them.  The current pointers
+ *                  cannot be used for destAddr and sourceAddr, the read
+ *                  pointer is restored.
+ *****************************************************************************/
+uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+{
+    PTR_BASE rdSave;
+    uint16_t sum;
+
+    MACMemCopyAsync(destAddr, sourceAddr, len);
+    while (!MACIsMemCopyDone());
+
+    rdSave = MACSetReadPtr(destAddr);
+    sum = ~CalcIPBufferChecksum(len);
+    MACSetReadPtr(rdSave);
+
+    return sum;
+}
+
 /******************************************************************************
  * Function:        uint8_t MACGet()
  *
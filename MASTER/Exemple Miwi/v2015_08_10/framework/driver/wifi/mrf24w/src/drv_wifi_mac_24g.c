@@ -254,6 +254,10 @@ static void SyncENCPtrRAWState(uint8_t encPtrId, uint16_t encIndex);
 
 extern void WF_Connect(void);
 
+#if defined(WF_USE_FAST_RECONNECT)
+extern void WFFastReconnectTask(void);
+#endif
+
 //#if defined ( WF_CONSOLE ) && defined ( EZ_CONFIG_SCAN ) && !defined(__XC8)
 #if defined ( EZ_CONFIG_SCAN ) && !defined(__XC8)
 extern void WFDisplayScanMgr();
@@ -834,6 +838,11 @@ void MACProcess(void)
     CheckHibernate();
     #endif
 
+    // reconnects after a link loss and refreshes the scan cache, see WF_CMFastConnect()
+    #if defined(WF_USE_FAST_RECONNECT)
+    WFFastReconnectTask();
+    #endif
+
     #if defined(STACK_CLIENT_MODE) && defined(USE_GRATUITOUS_ARP)
         //following is the workaround algorithm for the 11Mbps broadcast bugfix
         WFPeriodicGratuitousArp();
@@ -1696,6 +1705,42 @@ bool MACIsMemCopyDone(void)
     return true;
 }
 
+/******************************************************************************
+ * Function:        uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+ *
+ * PreCondition:    SPI bus must be initialized (done in MACInit()).
+ *
+ * Input:           destAddr:   Destination address in the Ethernet memory
+ *                  sourceAddr: Source address in the Ethernet memory
+ *                  len:        Number of bytes to copy
+ *
+ * Output:          One's complement sum of the copied bytes, not
+ *                  complemented (see CalcIPChecksumAdd())
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies bytes within the buffer and returns their sum.
+ *
+ * Note:            The copy is done by the MRF24W, the bytes are read back
+ *                  from the destination to sum them.  The current pointers
+ *                  cannot be used for destAddr and sourceAddr, the read
+ *                  pointer is restored.
+ *****************************************************************************/
+uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+{
+    PTR_BASE rdSave;
+    uint16_t sum;
+
+    MACMemCopyAsync(destAddr, sourceAddr, len);
+    while (!MACIsMemCopyDone());
+
+    rdSave = MACSetReadPtr(destAddr);
+    sum = ~CalcIPBufferChecksum(len);
+    MACSetReadPtr(rdSave);
+
+    return sum;
+}
+
 /******************************************************************************
  * Function:        uint8_t MACGet()
  *
@@ -76,35 +76,44 @@ typedef uint8_t U8;
 typedef uint32_t U32;
 typedef uint16_t U16;
 
-#define LITTLEENDIAN 1
-
 void sha1_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac);
 
+typedef struct {
+    u32 state[5];
+    u32 count[2];
+    unsigned char buffer[64];
+} SHA1_CTX;
+
+/* SHA-1 states after the K XOR ipad and K XOR opad blocks of HMAC-SHA1.
+ * They only depend on the key, so PBKDF2 computes them once per passphrase
+ * instead of twice per iteration. */
+typedef struct {
+    u32 inner[5];
+    u32 outer[5];
+} HMAC_SHA1_PADS;
+
+static void SHA1Init(SHA1_CTX *context);
+static void SHA1Resume(SHA1_CTX *context, const u32 state[5]);
+static void SHA1Update(SHA1_CTX *context, const void *data, u32 len);
+static void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
+static void SHA1Transform(u32 state[5], const unsigned char buffer[64]);
+static void SHA1TransformWords(u32 state[5], u32 block[16]);
+
+static const u32 sha1_init_state[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
 /**
- * hmac_sha1_vector - HMAC-SHA1 over data vector (RFC 2104)
+ * hmac_sha1_pads - Precompute the HMAC-SHA1 inner and outer states of a key
  * @key: Key for HMAC operations
  * @key_len: Length of the key in bytes
- * @num_elem: Number of elements in the data vector
- * @addr: Pointers to the data areas
- * @len: Lengths of the data blocks
- * @mac: Buffer for the hash (20 bytes)
+ * @pads: Buffer for the two states
  */
-void hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
-              const u8 *addr[], const size_t *len, u8 *mac)
+static void hmac_sha1_pads(const u8 *key, size_t key_len, HMAC_SHA1_PADS *pads)
 {
-    unsigned char k_pad[64]; /* padding - key XORd with ipad/opad */
+    u32 k[16], block[16]; /* key, then key XORd with ipad/opad, as words */
     unsigned char tk[20];
     int i;
-    const u8 *_addr[6];
-    size_t _len[6];
-
-    if (num_elem > 5) {
-        /*
-         * Fixed limit on the number of fragments to avoid having to
-         * allocate memory (which could fail).
-         */
-        return;
-    }
 
         /* if key is longer than 64 bytes reset it to key = SHA1(key) */
         if (key_len > 64) {
@@ -113,6 +122,10 @@ void hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
         key_len = 20;
         }
 
+    memset(k, 0, sizeof(k));
+    for (i = 0; i < key_len; i++)
+        k[i >> 2] |= (u32)key[i] << ((3 - (i & 3)) * 8);
+
     /* the HMAC_SHA1 transform looks like:
      *
      * SHA1(K XOR opad, SHA1(K XOR ipad, text))
@@ -121,35 +134,49 @@ void hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
      * ipad is the byte 0x36 repeated 64 times
      * opad is the byte 0x5c repeated 64 times
      * and text is the data being protected */
+    memcpy(pads->inner, sha1_init_state, sizeof(pads->inner));
+    for (i = 0; i < 16; i++)
+        block[i] = k[i] ^ 0x36363636;
+    SHA1TransformWords(pads->inner, block);
 
-    /* start out by storing key in ipad */
-    memset(k_pad, 0, sizeof(k_pad));
-    memcpy((U8*)k_pad, (U8*)key, key_len);
-    /* XOR key with ipad values */
-    for (i = 0; i < 64; i++)
-        k_pad[i] ^= 0x36;
+    memcpy(pads->outer, sha1_init_state, sizeof(pads->outer));
+    for (i = 0; i < 16; i++)
+        block[i] = k[i] ^ 0x5c5c5c5c;
+    SHA1TransformWords(pads->outer, block);
 
-    /* perform inner SHA1 */
-    _addr[0] = k_pad;
-    _len[0] = 64;
-    for (i = 0; i < num_elem; i++) {
-        _addr[i + 1] = addr[i];
-        _len[i + 1] = len[i];
-    }
-    sha1_vector(1 + num_elem, _addr, _len, mac);
+    memset(k, 0, sizeof(k));
+}
+
+/**
+ * hmac_sha1_vector - HMAC-SHA1 over data vector (RFC 2104)
+ * @key: Key for HMAC operations
+ * @key_len: Length of the key in bytes
+ * @num_elem: Number of elements in the data vector
+ * @addr: Pointers to the data areas
+ * @len: Lengths of the data blocks
+ * @mac: Buffer for the hash (20 bytes)
+ */
+void hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
+              const u8 *addr[], const size_t *len, u8 *mac)
+{
+    HMAC_SHA1_PADS pads;
+    SHA1_CTX ctx;
+    int i;
 
-    memset(k_pad, 0, sizeof(k_pad));
-    memcpy((U8*)k_pad, (U8*)key, key_len);
-    /* XOR key with opad values */
-    for (i = 0; i < 64; i++)
-        k_pad[i] ^= 0x5c;
+    hmac_sha1_pads(key, key_len, &pads);
+
+    /* perform inner SHA1 */
+    SHA1Resume(&ctx, pads.inner);
+    for (i = 0; i < num_elem; i++)
+        SHA1Update(&ctx, addr[i], len[i]);
+    SHA1Final(mac, &ctx);
 
     /* perform outer SHA1 */
-    _addr[0] = k_pad;
-    _len[0] = 64;
-    _addr[1] = mac;
-    _len[1] = SHA1_MAC_LEN;
-    sha1_vector(2, _addr, _len, mac);
+    SHA1Resume(&ctx, pads.outer);
+    SHA1Update(&ctx, mac, SHA1_MAC_LEN);
+    SHA1Final(mac, &ctx);
+
+    memset(&pads, 0, sizeof(pads));
 }
 
 /**
@@ -269,21 +296,29 @@ void sha1_t_prf(const u8 *key, size_t key_len, const char *label,
     }
 }
 
-static void pbkdf2_sha1_f(const char *passphrase, const char *ssid,
+/* Second block of HMAC-SHA1 over a 20 byte digest: the digest, then the
+ * SHA-1 padding for a 64 + 20 byte message */
+static void sha1_digest_block(u32 block[16], const u32 digest[5])
+{
+    int i;
+
+    for (i = 0; i < 5; i++)
+        block[i] = digest[i];
+    block[5] = 0x80000000;
+    for (i = 6; i < 15; i++)
+        block[i] = 0;
+    block[15] = (64 + SHA1_MAC_LEN) * 8;
+}
+
+static void pbkdf2_sha1_f(const HMAC_SHA1_PADS *pads, const char *ssid,
               size_t ssid_len, int iterations, int count,
               u8 *digest)
 {
-    unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
+    SHA1_CTX ctx;
+    unsigned char tmp[SHA1_MAC_LEN];
+    u32 u[5], sum[5], block[16];
     int i, j;
     unsigned char count_buf[4];
-    const u8 *addr[2];
-    size_t len[2];
-    size_t passphrase_len = strlen(passphrase);
-
-    addr[0] = (u8 *) ssid;
-    len[0] = ssid_len;
-    addr[1] = count_buf;
-    len[1] = 4;
 
     /* F(P, S, c, i) = U1 xor U2 xor ... Uc
      * U1 = PRF(P, S || i)
@@ -295,21 +330,40 @@ static void pbkdf2_sha1_f(const char *passphrase, const char *ssid,
     count_buf[1] = (count >> 16) & 0xff;
     count_buf[2] = (count >> 8) & 0xff;
     count_buf[3] = count & 0xff;
-    hmac_sha1_vector((u8 *) passphrase, passphrase_len, 2, addr, len, tmp);
-    memcpy(digest, tmp, SHA1_MAC_LEN);
-
+    SHA1Resume(&ctx, pads->inner);
+    SHA1Update(&ctx, ssid, ssid_len);
+    SHA1Update(&ctx, count_buf, 4);
+    SHA1Final(tmp, &ctx);
+    SHA1Resume(&ctx, pads->outer);
+    SHA1Update(&ctx, tmp, SHA1_MAC_LEN);
+    SHA1Final(tmp, &ctx);
+
+    for (j = 0; j < 5; j++)
+        u[j] = sum[j] = ((u32)tmp[4 * j] << 24) | ((u32)tmp[4 * j + 1] << 16) |
+                        ((u32)tmp[4 * j + 2] << 8) | tmp[4 * j + 3];
+
+    /* U2 to Uc are HMACs of a 20 byte digest, which fits the single block
+     * after the pad block with a padding that never changes.  They are
+     * computed on words with one transform each for the inner and outer
+     * hash, without going through SHA1Update() and SHA1Final(). */
     for (i = 1; i < iterations; i++) {
-        U8* pTemp;
-
-        hmac_sha1((u8 *) passphrase, passphrase_len, ((i&0x01)? tmp:tmp2), SHA1_MAC_LEN,
-              ((i&0x01)? tmp2:tmp));
-        //memcpy(tmp, tmp2, SHA1_MAC_LEN);
+        sha1_digest_block(block, u);
+        memcpy(u, pads->inner, sizeof(u));
+        SHA1TransformWords(u, block);
 
-        pTemp = (i&0x01) ?  tmp2 : tmp;
+        sha1_digest_block(block, u);
+        memcpy(u, pads->outer, sizeof(u));
+        SHA1TransformWords(u, block);
 
-        for (j = 0; j < SHA1_MAC_LEN; j++)
-            digest[j] ^= pTemp[j];
+        for (j = 0; j < 5; j++)
+            sum[j] ^= u[j];
     }
+
+    for (j = 0; j < SHA1_MAC_LEN; j++)
+        digest[j] = (u8)(sum[j >> 2] >> ((3 - (j & 3)) * 8));
+
+    memset(u, 0, sizeof(u));
+    memset(sum, 0, sizeof(sum));
 }
 
 /**
@@ -333,28 +387,23 @@ void pbkdf2_sha1(const char *passphrase, const char *ssid, U16 ssid_len,
     unsigned char *pos = buf;
     size_t left = buflen, plen;
     unsigned char digest[SHA1_MAC_LEN];
+    HMAC_SHA1_PADS pads;
+
+    hmac_sha1_pads((const u8 *) passphrase, strlen(passphrase), &pads);
 
     while (left > 0) {
         count++;
-        pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations, count,
+        pbkdf2_sha1_f(&pads, ssid, ssid_len, iterations, count,
                   digest);
         plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
         memcpy(pos, digest, plen);
         pos += plen;
         left -= plen;
     }
-}
 
-typedef struct {
-    u32 state[5];
-    u32 count[2];
-    unsigned char buffer[64];
-} SHA1_CTX;
-
-static void SHA1Init(SHA1_CTX *context);
-static void SHA1Update(SHA1_CTX *context, const void *data, u32 len);
-static void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
-static void SHA1Transform(u32 state[5], const unsigned char buffer[64]);
+    memset(&pads, 0, sizeof(pads));
+    memset(digest, 0, sizeof(digest));
+}
 
 /**
  * sha1_vector - SHA-1 hash for data vector
@@ -474,14 +523,10 @@ A million repetitions of "a"
 
 /* blk0() and blk() perform the initial expand. */
 /* I got the idea of expanding during the round function from SSLeay */
-#if LITTLEENDIAN == 1
-#define blk0(i) (block->l[i] = (rol(block->l[i], 24) & 0xFF00FF00) | \
-    (rol(block->l[i], 8) & 0x00FF00FF))
-#else
-#define blk0(i) block->l[i]
-#endif
-#define blk(i) (block->l[i & 15] = rol(block->l[(i + 13) & 15] ^ \
-    block->l[(i + 8) & 15] ^ block->l[(i + 2) & 15] ^ block->l[i & 15], 1))
+/* The block is already in host order words, see SHA1Transform(). */
+#define blk0(i) block[i]
+#define blk(i) (block[i & 15] = rol(block[(i + 13) & 15] ^ \
+    block[(i + 8) & 15] ^ block[(i + 2) & 15] ^ block[i & 15], 1))
 
 /* (R0 + R1), R2, R3, R4 are the different operations used in SHA1 */
 #define R0(v,w,x,y,z,i) \
@@ -516,17 +561,25 @@ void SHAPrintContext(SHA1_CTX *context, char *msg)
 /* Hash a single 512-bit block. This is the core of the algorithm. */
 
 static void SHA1Transform(u32 state[5], const unsigned char buffer[64])
+{
+    u32 block[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        block[i] = ((u32)buffer[4 * i] << 24) | ((u32)buffer[4 * i + 1] << 16) |
+                   ((u32)buffer[4 * i + 2] << 8) | buffer[4 * i + 3];
+    SHA1TransformWords(state, block);
+
+    memset((U8*)block, 0, 64);
+}
+
+/* Same as SHA1Transform() on a block of 16 big endian words already loaded
+ * in host order.  The message schedule is expanded in place, so the block
+ * is overwritten. */
+static void SHA1TransformWords(u32 state[5], u32 block[16])
 {
     u32 a, b, c, d, e;
-    typedef union {
-        unsigned char c[64];
-        u32 l[16];
-    } CHAR64LONG16;
-    CHAR64LONG16* block;
-
-    u32 workspace[16];
-    block = (CHAR64LONG16 *) workspace;
-    memcpy((U8*)block, (U8*)buffer, 64);
+
     /* Copy context->state[] to working vars */
     a = state[0];
     b = state[1];
@@ -562,22 +615,25 @@ static void SHA1Transform(u32 state[5], const unsigned char buffer[64])
     state[4] += e;
     /* Wipe variables */
     a = b = c = d = e = 0;
-
-    memset((U8*)block, 0, 64);
 }
 
 /* SHA1Init - Initialize new context */
 static void SHA1Init(SHA1_CTX* context)
 {
     /* SHA1 initialization constants */
-    context->state[0] = 0x67452301;
-    context->state[1] = 0xEFCDAB89;
-    context->state[2] = 0x98BADCFE;
-    context->state[3] = 0x10325476;
-    context->state[4] = 0xC3D2E1F0;
+    memcpy(context->state, sha1_init_state, sizeof(context->state));
     context->count[0] = context->count[1] = 0;
 }
 
+/* SHA1Resume - Initialize a context from the state after one block, ex: an
+ * HMAC pad block from hmac_sha1_pads() */
+static void SHA1Resume(SHA1_CTX* context, const u32 state[5])
+{
+    memcpy(context->state, state, sizeof(context->state));
+    context->count[0] = 512;
+    context->count[1] = 0;
+}
+
 /* Run your data through this. */
 
 static void SHA1Update(SHA1_CTX* context, const void *_data, u32 len)
@@ -58,6 +58,23 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
     #define WF_MODULE_NUMBER    WF_MODULE_WF_SCAN
 #endif
 
+/* Number of access points kept by the host cache of scan results */
+#if !defined(WF_SCAN_CACHE_SIZE)
+    #define WF_SCAN_CACHE_SIZE  (4u)
+#endif
+
+/* Access points not seen for that long are no longer returned by WF_ScanCacheFind() */
+#if !defined(WF_SCAN_CACHE_AGE)
+    #define WF_SCAN_CACHE_AGE   (60ul * TICK_SECOND)
+#endif
+
+/*******************************************************************************
+*                                LOCAL GLOBAL VARIABLES
+********************************************************************************/
+static tWFScanCacheEntry g_scanCache[WF_SCAN_CACHE_SIZE];
+
+static void ScanCacheUpdate(tWFScanResult *p_scanResult);
+
 static bool WF_CMIsHostScanAllowed(void)
 {
     uint8_t   profileID;
@@ -227,10 +244,147 @@ void WF_ScanGetResult(uint8_t          listIndex,
     p_scanResult->beaconPeriod = WFSTOHS(p_scanResult->beaconPeriod);
     p_scanResult->atimWindow   = WFSTOHS(p_scanResult->atimWindow);
 
+    ScanCacheUpdate(p_scanResult);
+
     /* reference for how to retrieve RSSI */
     /* Display SSID  & Channel */
     /* sprintf(rssiChan, "  => RSSI: %u, Channel: %u\r\n",  p_scanResult->rssi, p_scanResult->channel);  */
     /* putsUART(rssiChan); */
 }
 
+/*****************************************************************************
+ * FUNCTION: ScanCacheUpdate
+ *
+ * RETURNS:  None
+ *
+ * PARAMS:   p_scanResult -- scan result read from the MRF24W
+ *
+ *  NOTES:   Adds or refreshes an infrastructure network in the cache.  A new
+ *           access point takes a free entry, else the least recently seen.
+ *****************************************************************************/
+static void ScanCacheUpdate(tWFScanResult *p_scanResult)
+{
+    tWFScanCacheEntry *p_entry, *p_oldest;
+    uint32_t now;
+
+    if (p_scanResult->bssType != WF_INFRASTRUCTURE || p_scanResult->ssidLen == 0u
+        || p_scanResult->ssidLen > WF_MAX_SSID_LENGTH)
+        return;
+
+    now = TickGet();
+    p_oldest = &g_scanCache[0];
+    for (p_entry = g_scanCache; p_entry < &g_scanCache[WF_SCAN_CACHE_SIZE]; p_entry++)
+    {
+        if (p_entry->ssidLen == 0u)
+        {
+            p_oldest = p_entry;
+            continue;
+        }
+        if (memcmp(p_entry->bssid, p_scanResult->bssid, WF_BSSID_LENGTH) == 0)
+        {
+            p_oldest = p_entry;
+            break;
+        }
+        if (p_oldest->ssidLen != 0u && (now - p_entry->updated) > (now - p_oldest->updated))
+            p_oldest = p_entry;
+    }
+
+    memcpy(p_oldest->bssid, p_scanResult->bssid, WF_BSSID_LENGTH);
+    memcpy(p_oldest->ssid, p_scanResult->ssid, p_scanResult->ssidLen);
+    p_oldest->ssidLen  = p_scanResult->ssidLen;
+    p_oldest->channel  = p_scanResult->channel;
+    p_oldest->rssi     = p_scanResult->rssi;
+    p_oldest->apConfig = p_scanResult->apConfig;
+    p_oldest->updated  = now;
+}
+
+/*******************************************************************************
+  Function:
+    bool WF_ScanCacheFind(uint8_t *p_ssid, uint8_t ssidLen, tWFScanCacheEntry *p_entry)
+
+  Summary:
+    Looks up the host cache of scan results.
+
+  Description:
+    Returns the strongest access point with the given SSID seen in the last
+    WF_SCAN_CACHE_AGE ticks.  The cache is filled by WF_ScanGetResult().
+
+  Precondition:
+    None.
+
+  Parameters:
+    p_ssid - SSID of the network
+    ssidLen - Number of bytes in p_ssid
+    p_entry - Where the cache entry is copied
+
+  Returns:
+    true if an access point was found, else false.
+
+  Remarks:
+    None.
+  *****************************************************************************/
+bool WF_ScanCacheFind(uint8_t *p_ssid, uint8_t ssidLen, tWFScanCacheEntry *p_entry)
+{
+    tWFScanCacheEntry *p_cache, *p_best;
+    uint32_t now;
+
+    now = TickGet();
+    p_best = NULL;
+    for (p_cache = g_scanCache; p_cache < &g_scanCache[WF_SCAN_CACHE_SIZE]; p_cache++)
+    {
+        if (p_cache->ssidLen != ssidLen || memcmp(p_cache->ssid, p_ssid, ssidLen) != 0)
+            continue;
+
+        // Aged entries are free for the next scan results
+        if ((now - p_cache->updated) > WF_SCAN_CACHE_AGE)
+        {
+            p_cache->ssidLen = 0;
+            continue;
+        }
+
+        if (p_best == NULL || p_cache->rssi > p_best->rssi)
+            p_best = p_cache;
+    }
+
+    if (p_best == NULL)
+        return false;
+
+    memcpy(p_entry, p_best, sizeof(*p_entry));
+    return true;
+}
+
+/*******************************************************************************
+  Function:
+    void WF_ScanCacheRemove(uint8_t *p_bssid)
+
+  Summary:
+    Removes an access point from the host cache of scan results.
+
+  Description:
+    Used when a connection to the access point failed, so that it is not
+    tried first again before a scan sees it anew.
+
+  Precondition:
+    None.
+
+  Parameters:
+    p_bssid - BSSID of the access point
+
+  Returns:
+    None.
+
+  Remarks:
+    None.
+  *****************************************************************************/
+void WF_ScanCacheRemove(uint8_t *p_bssid)
+{
+    tWFScanCacheEntry *p_cache;
+
+    for (p_cache = g_scanCache; p_cache < &g_scanCache[WF_SCAN_CACHE_SIZE]; p_cache++)
+    {
+        if (memcmp(p_cache->bssid, p_bssid, WF_BSSID_LENGTH) == 0)
+            p_cache->ssidLen = 0;
+    }
+}
+
 #endif /* WF_CS_TRIS && WF_USE_SCAN_FUNCTIONS */
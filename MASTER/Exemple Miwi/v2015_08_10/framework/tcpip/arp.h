@@ -47,6 +47,19 @@ void ARPInit(void);
 #define ARPInit()
 #endif
 
+// Number of peers kept in the ARP cache, hashed on the IP address
+#if !defined(ARP_CACHE_ENTRIES)
+#define ARP_CACHE_ENTRIES   (8u)
+#endif
+// Seconds a resolved entry stays valid after the last ARP packet of the peer
+#if !defined(ARP_CACHE_TTL)
+#define ARP_CACHE_TTL       (20ul*60ul)
+#endif
+// ARPResolve() calls for a pending entry closer than this share one request
+#if !defined(ARP_REQUEST_HOLDOFF)
+#define ARP_REQUEST_HOLDOFF (TICK_SECOND/2)
+#endif
+
 #define ARP_OPERATION_REQ   0x0001u  // Operation code indicating an ARP Request
 #define ARP_OPERATION_RESP  0x0002u  // Operation code indicating an ARP Response
 
@@ -68,9 +81,22 @@ typedef struct __attribute__((aligned(2), packed)) {
 }
 ARP_PACKET;
 
+// ARP cache counters, see ARPGetStats()
+
+typedef struct {
+    uint32_t RequestsSent; // ARP requests broadcast by ARPResolve()
+    uint32_t RequestsCoalesced; // ARPResolve() calls served by a request already pending
+    uint32_t Hits; // ARPIsResolved() calls answered from the cache
+    uint32_t Misses; // ARPResolve() calls that found no valid entry and started a request
+    uint32_t Evictions; // Valid entries replaced to make room for another peer
+    uint32_t Refreshes; // Entries renewed by a reply, a request or a gratuitous ARP
+}
+ARP_STATS;
+
 bool ARPProcess(void);
 void ARPResolve(IP_ADDR *IPAddr);
 bool ARPIsResolved(IP_ADDR *IPAddr, MAC_ADDR *MACAddr);
+void ARPGetStats(ARP_STATS *stats);
 void SwapARPPacket(ARP_PACKET *p);
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
@@ -120,6 +120,36 @@ struct __attribute__((__packed__)) sockaddr_in {
 typedef struct sockaddr_in SOCKADDR_IN; // In the Internet address family
 typedef struct sockaddr SOCKADDR; // generic address structure for all address families
 
+// BSD-prefixed so that the C library's select() and poll(), which the Linux
+// build also declares, keep their names.
+#define BSD_FD_SETSIZE BSD_SOCKET_COUNT // Number of sockets in a BSDFdSet
+
+typedef struct {
+    uint32_t fd_bits[(BSD_SOCKET_COUNT + 31u) / 32u]; // One bit per socket
+} BSDFdSet; // Set of sockets for BerkeleySelect()
+
+#define BSD_FD_SET(s, set)   ((set)->fd_bits[(s) >> 5] |= 1ul << ((s) & 31u)) // Adds socket s to the set
+#define BSD_FD_CLR(s, set)   ((set)->fd_bits[(s) >> 5] &= ~(1ul << ((s) & 31u))) // Removes socket s from the set
+#define BSD_FD_ISSET(s, set) (((set)->fd_bits[(s) >> 5] & (1ul << ((s) & 31u))) != 0u) // Socket s is in the set
+#define BSD_FD_ZERO(set)     memset((void *) (set), 0x00, sizeof (*(set))) // Empties the set
+
+typedef struct {
+    long tv_sec; // seconds
+    long tv_usec; // and microseconds
+} BSDTimeval; // BerkeleySelect() timeout
+
+typedef struct {
+    SOCKET fd; // Socket descriptor
+    short events; // Requested events, BSD_POLLIN and/or BSD_POLLOUT
+    short revents; // Returned events
+} BSDPollFd; // BerkeleyPoll() entry
+
+#define BSD_POLLIN   0x0001 // Data, a datagram or a connection to accept is waiting
+#define BSD_POLLOUT  0x0004 // send() can write, or connect() completed
+#define BSD_POLLERR  0x0008 // The connection was reset, always returned
+#define BSD_POLLHUP  0x0010 // The connection was closed, always returned
+#define BSD_POLLNVAL 0x0020 // fd is not an open socket, always returned
+
 void BerkeleySocketInit(void);
 SOCKET socket(int af, int type, int protocol);
 int bind(SOCKET s, const struct sockaddr *name, int namelen);
@@ -132,5 +162,8 @@ int recv(SOCKET s, char *buf, int len, int flags);
 int recvfrom(SOCKET s, char *buf, int len, int flags, struct sockaddr *from, int *fromlen);
 int gethostname(char *name, int namelen);
 int closesocket(SOCKET s);
+int BerkeleySelect(int nfds, BSDFdSet *readfds, BSDFdSet *writefds, BSDFdSet *exceptfds, const BSDTimeval *timeout);
+int BerkeleyPoll(BSDPollFd *fds, unsigned int nfds, int timeout);
+void BerkeleySocketSignal(int type, uint8_t hSocket);
 
 #endif
@@ -44,6 +44,56 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define DNS_TYPE_A (1u) // Constant for record type in DNSResolve. Indicates an A (standard address) record.
 #define DNS_TYPE_MX (15u) // Constant for record type in DNSResolve. Indicates an MX (mail exchanger) record.
 
+// Queries that can be in flight at the same time, shared by all the users of DNSQuery()
+#if !defined(DNS_MAX_QUERIES)
+#define DNS_MAX_QUERIES     (2u)
+#endif
+// Answers kept in the resolver cache, the least recently used one is replaced
+#if !defined(DNS_CACHE_ENTRIES)
+#define DNS_CACHE_ENTRIES   (4u)
+#endif
+// Characters of the host name kept in a cache entry and compared on a hash match
+#if !defined(DNS_CACHE_NAME_SIZE)
+#define DNS_CACHE_NAME_SIZE (32u)
+#endif
+// Upper bound in seconds of the TTL given by the servers for a cached address
+#if !defined(DNS_CACHE_MAX_TTL)
+#define DNS_CACHE_MAX_TTL   (3600ul)
+#endif
+// Seconds a name without address (NXDOMAIN or no A record) is remembered, at most
+#if !defined(DNS_NEGATIVE_TTL)
+#define DNS_NEGATIVE_TTL    (60ul)
+#endif
+// Queries sent for one name, alternating between the primary and secondary servers
+#if !defined(DNS_MAX_ATTEMPTS)
+#define DNS_MAX_ATTEMPTS    (4u)
+#endif
+
+// Handle of a query started by DNSQuery()
+typedef uint8_t DNS_HANDLE;
+
+#define DNS_INVALID_HANDLE  (0xFFu)
+
+// Results of DNSQueryResult()
+typedef enum {
+    DNS_RES_PENDING = 0, // The query is still in progress
+    DNS_RES_OK, // The address is valid
+    DNS_RES_NAME_ERROR, // The name does not exist or has no address record
+    DNS_RES_SERVER_ERROR, // No server gave an answer after DNS_MAX_ATTEMPTS
+    DNS_RES_INVALID_HANDLE // The handle is not a query in use
+} DNS_RESULT;
+
+// Resolver counters, returned by DNSGetStats()
+typedef struct {
+    uint32_t Lookups; // Queries started, including the IP address strings
+    uint32_t CacheHits; // Queries answered from a positive cache entry
+    uint32_t NegativeHits; // Queries answered from a negative cache entry
+    uint32_t QueriesSent; // DNS packets sent, including the retransmissions
+    uint32_t Retransmits; // Queries sent again after a timeout or a server failure
+    uint32_t Failovers; // Swaps between the primary and secondary servers
+    uint32_t Failures; // Queries that ended with DNS_RES_SERVER_ERROR
+} DNS_STATS;
+
 // dns_client.c function prototypes
 void DNSInit(void);
 bool DNSBeginUsage(void);
@@ -51,11 +101,19 @@ void DNSResolve(uint8_t *HostName, uint8_t Type);
 bool DNSIsResolved(IP_ADDR *HostIP);
 bool DNSEndUsage(void);
 
+DNS_HANDLE DNSQuery(uint8_t *HostName, uint8_t Type);
+DNS_RESULT DNSQueryResult(DNS_HANDLE hQuery, IP_ADDR *HostIP);
+void DNSQueryRelease(DNS_HANDLE hQuery);
+void DNSFlushCache(void);
+void DNSGetStats(DNS_STATS *stats);
+
 #if defined(__XC8)
 void DNSResolveROM(ROM uint8_t *Hostname, uint8_t Type);
+DNS_HANDLE DNSQueryROM(ROM uint8_t *HostName, uint8_t Type);
 #else
 // Non-ROM variant for C30/C32
 #define DNSResolveROM(a,b)  DNSResolve((uint8_t *)a,b)
+#define DNSQueryROM(a,b)    DNSQuery((uint8_t *)a,b)
 #endif
 
 // dns_server.c function prototype
@@ -60,8 +60,20 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #if !defined(HTTP_MIN_CALLBACK_FREE)
 #define HTTP_MIN_CALLBACK_FREE  (16u)
 #endif
-#define HTTP_CACHE_LEN          ("600") // Max lifetime (sec) of static responses as string
+#if !defined(HTTP_MIN_HEADER_FREE)
+#define HTTP_MIN_HEADER_FREE    (256u)  // Min TX FIFO space before the headers of a response on a persistent connection are written
+#endif
+#define HTTP_CACHE_LEN          ("600") // Max lifetime (sec) of static responses as string, unless the MPFS image sets one for the file
 #define HTTP_TIMEOUT            (45u)   // Max time (sec) to await more data before timing out and disconnecting the socket
+#if !defined(HTTP_KEEP_ALIVE_TIMEOUT)
+#define HTTP_KEEP_ALIVE_TIMEOUT (5u)    // Max time (sec) a persistent connection awaits the next request, 0 to close after each response
+#endif
+#if !defined(HTTP_MAX_CONN_PER_CLIENT)
+#define HTTP_MAX_CONN_PER_CLIENT ((MAX_HTTP_CONNECTIONS + 1u) / 2u) // Max connections one client may keep open, so that other clients still get sockets
+#endif
+#if !defined(HTTP_KEEP_ALIVE_RX_SIZE)
+#define HTTP_KEEP_ALIVE_RX_SIZE (256u)  // RX FIFO left to a persistent connection for its next requests while it sends
+#endif
 
 // Authentication requires Base64 decoding
 #if defined(HTTP_USE_AUTHENTICATION)
@@ -92,7 +104,8 @@ typedef enum {
     HTTP_MPFS_ERROR, // An MPFS Upload was not a valid image
 #endif
     HTTP_REDIRECT, // 302 Redirect will be returned
-    HTTP_SSL_REQUIRED // 403 Forbidden is returned, indicating SSL is required
+    HTTP_SSL_REQUIRED, // 403 Forbidden is returned, indicating SSL is required
+    HTTP_NOT_MODIFIED // 304 Not Modified is returned, the client's cached copy is current
 } HTTP_STATUS;
 
 /***************************************************************************
@@ -113,6 +126,7 @@ typedef enum {
     SM_HTTP_SERVE_COOKIES, // Adds any cookies to the response
     SM_HTTP_SERVE_BODY, // Serves the actual content
     SM_HTTP_SEND_FROM_CALLBACK, // Invokes a dynamic variable callback
+    SM_HTTP_KEEP_ALIVE, // Awaits the next request on a persistent connection
     SM_HTTP_DISCONNECT // Disconnects the server and closes all files
 } SM_HTTP2;
 
@@ -171,6 +185,12 @@ typedef struct {
     uint8_t isAuthorized; // 0x00-0x79 on fail, 0x80-0xff on pass
     HTTP_STATUS httpStatus; // Request method/status
     HTTP_FILE_TYPE fileType; // File type to return with Content-Type
+    bool keepAlive; // Connection stays open once the response is sent
+    bool isPersistent; // Connection was kept open after a previous response
+    bool isChunked; // Body is sent with the chunked transfer coding
+    bool chunkNeedsCRLF; // CRLF ending the last chunk is not written yet
+    bool hasIfNoneMatch; // Request carried If-None-Match, which overrides If-Modified-Since
+    bool isNotModified; // Request validators match the file, so a 304 can be sent
     uint8_t data[HTTP_MAX_DATA_LEN]; // General purpose data buffer
 #if defined(HTTP_USE_POST)
     uint8_t smPost; // POST state machine variable
@@ -58,7 +58,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #error "Error in system_config.h.  Must select either the ENC28J60 or the ENCX24J600 but not both ENC_CS_TRIS and ENC100_INTERFACE_MODE."
 #endif
 
-#if !defined(ENC_CS_TRIS) && !defined(WF_CS_TRIS) && !defined(ENC100_INTERFACE_MODE) && \
+#if !defined(ENC_CS_TRIS) && !defined(WF_CS_TRIS) && !defined(ENC100_INTERFACE_MODE) && !defined(TAP_INTERFACE) && \
     (defined(__18F97J60) || defined(__18F96J65) || defined(__18F96J60) || defined(__18F87J60) || defined(__18F86J65) || defined(__18F86J60) || defined(__18F67J60) || defined(__18F66J65) || defined(__18F66J60) || \
     defined(_18F97J60) || defined(_18F96J65) || defined(_18F96J60) || defined(_18F87J60) || defined(_18F86J65) || defined(_18F86J60) || defined(_18F67J60) || defined(_18F66J65) || defined(_18F66J60))
 #include "eth97j60.h"
@@ -67,6 +67,8 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #elif defined(ENC100_INTERFACE_MODE)
 #include "tcpip/src/encx24j600.h"
 #define PHYREG uint16_t
+#elif defined(TAP_INTERFACE)
+#include "tcpip/src/linux_tap.h"
 #elif defined(__XC32) && defined(_ETH)
 // extra includes for PIC32MX with embedded ETH Controller
 #else
@@ -125,6 +127,17 @@ ETHER_HEADER;
 #define BASE_HTTPB_ADDR    (BASE_SCRATCH_ADDR)
 #define BASE_SSLB_ADDR     (BASE_HTTPB_ADDR + RESERVED_HTTP_MEMORY)
 #define BASE_TCB_ADDR      (BASE_SSLB_ADDR + RESERVED_SSL_MEMORY)
+#elif defined(TAP_INTERFACE)
+// Emulated MAC RAM, addresses must stay below 0x8000 (MACMemCopyAsync())
+#define RAMSIZE         (32*1024ul)
+#define TXSTART         (0x0000ul)
+#define BASE_TX_ADDR    (TXSTART)
+#define BASE_TCB_ADDR   (BASE_TX_ADDR + 1518ul)
+#define BASE_HTTPB_ADDR (BASE_TCB_ADDR + TCP_ETH_RAM_SIZE)
+#define BASE_SSLB_ADDR  (BASE_HTTPB_ADDR + RESERVED_HTTP_MEMORY)
+#define RXSTART         ((BASE_SSLB_ADDR + RESERVED_SSL_MEMORY + 1ul) & 0xFFFE)
+#define RXSTOP          (RAMSIZE-1ul)
+#define RXSIZE          (RXSTOP-RXSTART+1ul)
 #elif defined(__XC32) && defined(_ETH) && !defined(ENC_CS_TRIS)
 #define BASE_TX_ADDR    (MACGetTxBaseAddr())
 #define BASE_HTTPB_ADDR (MACGetHttpBaseAddr())
@@ -274,9 +287,14 @@ PTR_BASE MACSetReadPtr(PTR_BASE address);
 uint8_t MACGet(void);
 uint16_t MACGetArray(uint8_t *val, uint16_t len);
 void MACDiscardRx(void);
+#if defined(MAC_CAN_HOLD_RX)
+PTR_BASE MACHoldRx(void);
+void MACReleaseRx(PTR_BASE address);
+#endif
 uint16_t MACGetFreeRxSize(void);
 void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len);
 bool MACIsMemCopyDone(void);
+uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len);
 
 void MACPutHeader(MAC_ADDR *remote, uint8_t type, uint16_t dataLen);
 bool MACIsTxReady(void);
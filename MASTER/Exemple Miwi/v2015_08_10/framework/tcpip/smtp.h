@@ -50,6 +50,12 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define SMTP_RESOLVE_ERROR  (0x8000u) // DNS lookup for SMTP server failed
 #define SMTP_CONNECT_ERROR  (0x8001u) // Connection to SMTP server failed
 
+// Number of messages that SMTPSendMail() can hold, including the one being
+// sent.  All the queued messages are sent over the same connection.
+#if !defined(SMTP_QUEUE_SIZE)
+#define SMTP_QUEUE_SIZE     (3u)
+#endif
+
 /***************************************************************************
   Function:
       typedef struct SMTP_POINTERS
@@ -185,7 +191,7 @@ extern SMTP_POINTERS SMTPClient;
 bool SMTPBeginUsage(void);
 uint16_t SMTPEndUsage(void);
 void SMTPTask(void);
-void SMTPSendMail(void);
+bool SMTPSendMail(void);
 bool SMTPIsBusy(void);
 uint16_t SMTPIsPutReady(void);
 bool SMTPPut(uint8_t c);
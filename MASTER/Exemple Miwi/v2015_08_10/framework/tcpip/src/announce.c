@@ -74,6 +74,7 @@ static DiscoverySM DiscoveryState;
 void AnnounceInit(void)
 {
     DiscoveryState = DISCOVERY_HOME;
+    StackSignal(STACK_MODULE_ANNOUNCE, STACK_EVENT_BUSY);
 }
 
 /****************************************************************************************************
@@ -198,7 +199,7 @@ void DiscoveryTask(void)
         MySocket = UDPOpenEx(0, UDP_OPEN_SERVER, ANNOUNCE_PORT, ANNOUNCE_PORT);
 
         if (MySocket == INVALID_UDP_SOCKET)
-            return;
+            break;
         else
             DiscoveryState++;
         break;
@@ -206,13 +207,13 @@ void DiscoveryTask(void)
     case DISCOVERY_LISTEN:
         // Do nothing if no data is waiting
         if (!UDPIsGetReady(MySocket))
-            return;
+            break;
 
         // See if this is a discovery query or reply
         UDPGet(&i);
         UDPDiscard();
         if (i != 'D')
-            return;
+            break;
 
         // We received a discovery request, reply when we can
         DiscoveryState++;
@@ -224,7 +225,7 @@ void DiscoveryTask(void)
 
     case DISCOVERY_REQUEST_RECEIVED:
         if (!UDPIsPutReady(MySocket))
-            return;
+            break;
 
         // Begin sending our MAC address in human readable form.
         // The MAC address theoretically could be obtained from the
@@ -260,6 +261,10 @@ void DiscoveryTask(void)
     case DISCOVERY_DISABLED:
         break;
     }
+
+    // Queries wake the module up through UDP once it listens
+    if (DiscoveryState == DISCOVERY_HOME || DiscoveryState == DISCOVERY_REQUEST_RECEIVED)
+        StackSignal(STACK_MODULE_ANNOUNCE, STACK_EVENT_BUSY);
 }
 
 #endif // #if defined(STACK_USE_ANNOUNCE)
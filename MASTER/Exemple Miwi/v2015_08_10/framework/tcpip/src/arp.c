@@ -57,9 +57,26 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #endif
 
 #ifdef STACK_CLIENT_MODE
-static NODE_INFO Cache; // Cache for one ARP response
+#define ARP_ENTRY_FREE      (0u) // Unused since ARPInit(), ends the hash probing
+#define ARP_ENTRY_PENDING   (1u) // Request sent, waiting for the reply
+#define ARP_ENTRY_RESOLVED  (2u)
+
+// Cache times are kept with TickGetDiv256() so that they do not wrap for days
+#define ARP_TTL_DIV256      ((uint32_t)(ARP_CACHE_TTL * TICK_SECOND / 256ull))
+#define ARP_HOLDOFF_DIV256  ((uint32_t)(ARP_REQUEST_HOLDOFF / 256ull))
+
+typedef struct {
+    NODE_INFO Node;
+    uint32_t Time; // Request sent (pending) or last ARP packet of the peer (resolved)
+    uint32_t LastUsed; // Last ARPIsResolved() hit, picks the entry to evict
+    uint8_t State;
+} ARP_CACHE_ENTRY;
+
+static ARP_CACHE_ENTRY Cache[ARP_CACHE_ENTRIES]; // Open addressing, linear probing
 #endif
 
+static ARP_STATS Stats;
+
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
 #define MAX_REG_APPS  2 // MAX num allowed registrations of Modules/Apps
 static struct arp_app_callbacks reg_apps[MAX_REG_APPS]; // Call-Backs storage for MAX of two Modules/Apps
@@ -86,6 +103,14 @@ typedef struct __attribute__((aligned(2), packed))
     Helper Function Prototypes
  ***************************************************************************/
 static bool ARPPut(ARP_PACKET* packet);
+#ifdef STACK_CLIENT_MODE
+static ARP_CACHE_ENTRY* ARPCacheFind(IP_ADDR *IPAddr);
+static ARP_CACHE_ENTRY* ARPCacheAlloc(IP_ADDR *IPAddr, uint32_t now);
+static void ARPCacheUpdate(ARP_PACKET *packet);
+#endif
+#if defined(STACK_USE_ZEROCONF_LINK_LOCAL)
+static bool ARPIsMulticast(IP_ADDR *IPAddr, MAC_ADDR *MACAddr);
+#endif
 
 /****************************************************************************
   Section:
@@ -256,25 +281,9 @@ bool ARPSendPkt(uint32_t SrcIPAddr, uint32_t DestIPAddr, uint8_t op_req)
     ARP_PACKET packet;
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
-#define KS_ARP_IP_MULTICAST_HACK y
-#ifdef KS_ARP_IP_MULTICAST_HACK
-    TCPIP_UINT32_VAL *DestAddr = (TCPIP_UINT32_VAL *) & DestIPAddr;
-    if ((DestAddr->v[0] >= 224) &&(DestAddr->v[0] <= 239)) {
-        // "Resolve" the IP to MAC address mapping for
-        // IP multicast address range from 224.0.0.0 to 239.255.255.255
-
-        Cache.MACAddr.v[0] = 0x01;
-        Cache.MACAddr.v[1] = 0x00;
-        Cache.MACAddr.v[2] = 0x5E;
-        Cache.MACAddr.v[3] = 0x7f & DestAddr->v[1];
-        Cache.MACAddr.v[4] = DestAddr->v[2];
-        Cache.MACAddr.v[5] = DestAddr->v[3];
-
-        Cache.IPAddr.Val = DestAddr->Val;
-
+    // Multicast addresses are mapped by ARPIsResolved(), nothing to send
+    if (ARPIsMulticast((IP_ADDR *) & DestIPAddr, NULL))
         return true;
-    }
-#endif
 #endif
 
     packet.Operation = op_req;
@@ -344,7 +353,7 @@ static bool ARPPut(ARP_PACKET* packet)
 
   Description:
     Initializes the ARP module.  Call this function once at boot to
-    invalidate the cached lookup.
+    empty the ARP cache.
 
   Precondition:
     None
@@ -362,14 +371,7 @@ static bool ARPPut(ARP_PACKET* packet)
 #ifdef STACK_CLIENT_MODE
 void ARPInit(void)
 {
-    Cache.MACAddr.v[0] = 0xff;
-    Cache.MACAddr.v[1] = 0xff;
-    Cache.MACAddr.v[2] = 0xff;
-    Cache.MACAddr.v[3] = 0xff;
-    Cache.MACAddr.v[4] = 0xff;
-    Cache.MACAddr.v[5] = 0xff;
-
-    Cache.IPAddr.Val = 0xfffffffful;
+    memset((void *) Cache, 0x00, sizeof (Cache));
 }
 #endif
 
@@ -436,6 +438,7 @@ bool ARPProcess(void)
 
         // Handle incoming ARP responses
 #ifdef STACK_CLIENT_MODE
+        ARPCacheUpdate(&packet);
         if (packet.Operation == ARP_OPERATION_RESP) {
             /*                
 #if defined(STACK_USE_AUTO_IP)
@@ -444,9 +447,6 @@ bool ARPProcess(void)
                     AutoIPConflict(i);
 #endif
              */
-            Cache.MACAddr = packet.SenderMACAddr;
-            Cache.IPAddr = packet.SenderIPAddr;
-
             //putsUART("ARPProcess: SM_ARP_IDLE: ARP_OPERATION_RESP  \r\n");
             return true;
         }
@@ -525,7 +525,10 @@ bool ARPProcess(void)
 
   Description:
     This function transmits and ARP request to determine the hardware
-    address of a given IP address.
+    address of a given IP address.  Nothing is sent if the address is
+    already in the ARP cache, or if a request for the same address was sent
+    less than ARP_REQUEST_HOLDOFF ago: the modules resolving the same peer
+    share one request.
 
   Precondition:
     None
@@ -547,26 +550,13 @@ bool ARPProcess(void)
 void ARPResolve(IP_ADDR* IPAddr)
 {
     ARP_PACKET packet;
+    ARP_CACHE_ENTRY *entry;
+    uint32_t now;
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
-#define KS_ARP_IP_MULTICAST_HACK y
-#ifdef KS_ARP_IP_MULTICAST_HACK
-    if ((IPAddr->v[0] >= 224) &&(IPAddr->v[0] <= 239)) {
-        // "Resolve" the IP to MAC address mapping for
-        // IP multicast address range from 224.0.0.0 to 239.255.255.255
-
-        Cache.MACAddr.v[0] = 0x01;
-        Cache.MACAddr.v[1] = 0x00;
-        Cache.MACAddr.v[2] = 0x5E;
-        Cache.MACAddr.v[3] = 0x7f & IPAddr->v[1];
-        Cache.MACAddr.v[4] = IPAddr->v[2];
-        Cache.MACAddr.v[5] = IPAddr->v[3];
-
-        Cache.IPAddr.Val = IPAddr->Val;
-
+    // Multicast addresses are mapped by ARPIsResolved(), nothing to send
+    if (ARPIsMulticast(IPAddr, NULL))
         return;
-    }
-#endif
 #endif
 
     packet.Operation = ARP_OPERATION_REQ;
@@ -585,7 +575,22 @@ void ARPResolve(IP_ADDR* IPAddr)
     packet.SenderIPAddr = AppConfig.MyIPAddr;
 #endif
 
+    now = TickGetDiv256();
+    entry = ARPCacheAlloc(&packet.TargetIPAddr, now);
+    if (entry->State == ARP_ENTRY_RESOLVED && now - entry->Time <= ARP_TTL_DIV256)
+        return;
+    if (entry->State == ARP_ENTRY_PENDING && now - entry->Time < ARP_HOLDOFF_DIV256) {
+        Stats.RequestsCoalesced++;
+        return;
+    }
+    // A miss is counted once per resolution, not per retry or poll
+    if (entry->State != ARP_ENTRY_PENDING)
+        Stats.Misses++;
+    entry->State = ARP_ENTRY_PENDING;
+    entry->Time = now;
+
     ARPPut(&packet);
+    Stats.RequestsSent++;
 }
 #endif
 
@@ -627,19 +632,235 @@ void ARPResolve(IP_ADDR* IPAddr)
 #ifdef STACK_CLIENT_MODE
 bool ARPIsResolved(IP_ADDR* IPAddr, MAC_ADDR* MACAddr)
 {
-    if ((Cache.IPAddr.Val == IPAddr->Val) ||
-            ((Cache.IPAddr.Val == AppConfig.MyGateway.Val) && ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val))) {
-        *MACAddr = Cache.MACAddr;
+    ARP_CACHE_ENTRY *entry;
+    uint32_t now = TickGetDiv256();
+
+#ifdef STACK_USE_ZEROCONF_LINK_LOCAL
+    if (ARPIsMulticast(IPAddr, MACAddr))
+        return true;
+#endif
+
+    entry = ARPCacheFind(IPAddr);
+    if ((entry == NULL || entry->State != ARP_ENTRY_RESOLVED) &&
+            ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val))
+        entry = ARPCacheFind(&AppConfig.MyGateway);
+
+    if (entry != NULL && entry->State == ARP_ENTRY_RESOLVED && now - entry->Time <= ARP_TTL_DIV256) {
+        *MACAddr = entry->Node.MACAddr;
+        entry->LastUsed = now;
+        Stats.Hits++;
         //putsUART("ARPIsResolved  \r\n");
         return true;
     }
 
     //putsUART("ARPIs  NOT Resolved  \r\n");
-
     return false;
 }
 #endif
 
+/*****************************************************************************
+  Function:
+    void ARPGetStats(ARP_STATS *stats)
+
+  Summary:
+    Copies the ARP cache counters.
+
+  Description:
+    The counters run from boot, ARPInit() empties the cache but keeps them.
+    RequestsSent gives the ARP broadcasts sent by the stack, the other
+    counters show how well the cache serves the active peers.  Misses only
+    counts the resolutions started, so RequestsSent - Misses is the number
+    of requests sent again for lack of a reply.
+
+  Precondition:
+    None
+
+  Parameters:
+    stats - Location to store the counters
+
+  Returns:
+    None
+ ***************************************************************************/
+void ARPGetStats(ARP_STATS *stats)
+{
+    memcpy((void *) stats, (void *) &Stats, sizeof (Stats));
+}
+
+#ifdef STACK_CLIENT_MODE
+/*****************************************************************************
+  Function:
+    static ARP_CACHE_ENTRY* ARPCacheFind(IP_ADDR *IPAddr)
+
+  Description:
+    Looks for the cache entry of an IP address, in any state.
+
+  Precondition:
+    None
+
+  Parameters:
+    IPAddr - IP address to look for
+
+  Returns:
+    The entry, or NULL if the address is not in the cache.
+ ***************************************************************************/
+static ARP_CACHE_ENTRY* ARPCacheFind(IP_ADDR *IPAddr)
+{
+    uint8_t i, n;
+
+    i = (IPAddr->v[3] ^ IPAddr->v[2]) % ARP_CACHE_ENTRIES;
+    for (n = 0; n < ARP_CACHE_ENTRIES; n++) {
+        if (Cache[i].State == ARP_ENTRY_FREE)
+            break;
+        if (Cache[i].Node.IPAddr.Val == IPAddr->Val)
+            return &Cache[i];
+        if (++i == ARP_CACHE_ENTRIES)
+            i = 0;
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+  Function:
+    static ARP_CACHE_ENTRY* ARPCacheAlloc(IP_ADDR *IPAddr, uint32_t now)
+
+  Description:
+    Returns the cache entry of an IP address, taking one if the address is
+    not in the cache yet.  The probing stops at the first free entry so
+    that ARPCacheFind() will reach the one taken.  Without a free entry on
+    the way, an expired or pending entry is reused first, then the least
+    recently used one.
+
+  Precondition:
+    None
+
+  Parameters:
+    IPAddr - IP address to look for
+    now - TickGetDiv256() value
+
+  Returns:
+    The entry.  A new entry is in the ARP_ENTRY_FREE state with its IP
+    address set.
+ ***************************************************************************/
+static ARP_CACHE_ENTRY* ARPCacheAlloc(IP_ADDR *IPAddr, uint32_t now)
+{
+    ARP_CACHE_ENTRY *entry, *victim = NULL;
+    bool victimValid = true;
+    bool valid;
+    uint8_t i, n;
+
+    i = (IPAddr->v[3] ^ IPAddr->v[2]) % ARP_CACHE_ENTRIES;
+    for (n = 0; n < ARP_CACHE_ENTRIES; n++) {
+        entry = &Cache[i];
+        if (entry->State == ARP_ENTRY_FREE) {
+            victim = entry;
+            victimValid = false;
+            break;
+        }
+        if (entry->Node.IPAddr.Val == IPAddr->Val)
+            return entry;
+
+        valid = entry->State == ARP_ENTRY_RESOLVED && now - entry->Time <= ARP_TTL_DIV256;
+        if (victim == NULL || (victimValid && !valid) ||
+                (victimValid == valid && now - entry->LastUsed > now - victim->LastUsed)) {
+            victim = entry;
+            victimValid = valid;
+        }
+        if (++i == ARP_CACHE_ENTRIES)
+            i = 0;
+    }
+
+    if (victimValid)
+        Stats.Evictions++;
+    victim->State = ARP_ENTRY_FREE;
+    victim->Node.IPAddr.Val = IPAddr->Val;
+    victim->LastUsed = now;
+
+    return victim;
+}
+
+/*****************************************************************************
+  Function:
+    static void ARPCacheUpdate(ARP_PACKET *packet)
+
+  Description:
+    Records the sender of a received ARP packet, as in RFC 826: a peer
+    already in the cache is refreshed by any of its packets, gratuitous
+    ARPs included, and a new peer is added when it answers or when it
+    queries our address.
+
+  Precondition:
+    None
+
+  Parameters:
+    packet - Received ARP packet, in host byte order
+
+  Returns:
+    None
+ ***************************************************************************/
+static void ARPCacheUpdate(ARP_PACKET *packet)
+{
+    ARP_CACHE_ENTRY *entry;
+    uint32_t now;
+
+    // Probes do not have a sender address yet
+    if (packet->SenderIPAddr.Val == 0u)
+        return;
+
+    now = TickGetDiv256();
+    entry = ARPCacheFind(&packet->SenderIPAddr);
+    if (entry == NULL) {
+        if (packet->SenderIPAddr.Val == packet->TargetIPAddr.Val)
+            return;
+        if (packet->Operation != ARP_OPERATION_RESP && packet->TargetIPAddr.Val != AppConfig.MyIPAddr.Val)
+            return;
+        entry = ARPCacheAlloc(&packet->SenderIPAddr, now);
+    } else if (entry->State == ARP_ENTRY_RESOLVED) {
+        Stats.Refreshes++;
+    }
+
+    entry->Node.MACAddr = packet->SenderMACAddr;
+    entry->State = ARP_ENTRY_RESOLVED;
+    entry->Time = now;
+}
+#endif
+
+#if defined(STACK_USE_ZEROCONF_LINK_LOCAL)
+/*****************************************************************************
+  Function:
+    static bool ARPIsMulticast(IP_ADDR *IPAddr, MAC_ADDR *MACAddr)
+
+  Description:
+    "Resolves" the IP to MAC address mapping for the IP multicast address
+    range from 224.0.0.0 to 239.255.255.255.
+
+  Precondition:
+    None
+
+  Parameters:
+    IPAddr - IP address to map
+    MACAddr - Location to store the multicast MAC address, or NULL
+
+  Returns:
+    true if IPAddr is a multicast address.
+ ***************************************************************************/
+static bool ARPIsMulticast(IP_ADDR *IPAddr, MAC_ADDR *MACAddr)
+{
+    if ((IPAddr->v[0] < 224) || (IPAddr->v[0] > 239))
+        return false;
+
+    if (MACAddr != NULL) {
+        MACAddr->v[0] = 0x01;
+        MACAddr->v[1] = 0x00;
+        MACAddr->v[2] = 0x5E;
+        MACAddr->v[3] = 0x7f & IPAddr->v[1];
+        MACAddr->v[4] = IPAddr->v[2];
+        MACAddr->v[5] = IPAddr->v[3];
+    }
+    return true;
+}
+#endif
+
 /*****************************************************************************
   Function:
     void SwapARPPacket(ARP_PACKET *p)
@@ -43,6 +43,13 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #if defined(STACK_USE_BERKELEY_API)
 
 static bool HandlePossibleTCPDisconnection(SOCKET s);
+static uint8_t SocketReadiness(SOCKET s);
+static void SetTimeout(uint32_t dwMilliseconds);
+
+// Values returned by SocketReadiness()
+#define BSD_READABLE    0x01u // recv(), recvfrom() or accept() has something
+#define BSD_WRITABLE    0x02u // send() or sendto() can write
+#define BSD_CLOSED      0x04u // The connection is gone
 
 // Array of BSDSocket elements; used to track all socket state and connection information.
 static struct BSDSocket BSDSocketArray[BSD_SOCKET_COUNT];
@@ -50,6 +57,12 @@ static struct BSDSocket BSDSocketArray[BSD_SOCKET_COUNT];
 // Contains the next local port number to associate with a socket.
 static uint16_t gAutoPortNumber = 1024;
 
+// Sockets which may be readable or writable.  The TCP and UDP modules set
+// them on every event (BerkeleySocketSignal()), BerkeleySelect() and
+// BerkeleyPoll() clear them when they find the socket idle, so idle sockets
+// are not checked.
+static BSDFdSet readHints, writeHints;
+
 /*****************************************************************************
   Function:
     void BerkeleySocketInit(void)
@@ -83,6 +96,9 @@ void BerkeleySocketInit(void)
         socket->bsdState = SKT_CLOSED;
         socket->SocketID = INVALID_UDP_SOCKET;
     }
+
+    BSD_FD_ZERO(&readHints);
+    BSD_FD_ZERO(&writeHints);
 }
 
 /*****************************************************************************
@@ -142,6 +158,9 @@ SOCKET socket(int af, int type, int protocol)
 
         if (type == SOCK_DGRAM && protocol == IPPROTO_UDP) {
             socket->bsdState = SKT_CREATED;
+
+            // UDP sockets can always send
+            BSD_FD_SET(s, &writeHints);
             return s;
         } else if (type == SOCK_STREAM && protocol == IPPROTO_TCP) {
             socket->bsdState = SKT_CREATED;
@@ -792,7 +811,11 @@ int recvfrom(SOCKET s, char *buf, int len, int flags, struct sockaddr *from, int
                 }
             }
 
-            return UDPGetArray((uint8_t *) buf, len);
+            // The excess bytes are discarded, the next call returns the
+            // next datagram queued on the socket
+            len = UDPGetArray((uint8_t *) buf, len);
+            UDPDiscard();
+            return len;
         }
     } else // TCP recieve from already connected socket.
     {
@@ -1021,4 +1044,338 @@ static bool HandlePossibleTCPDisconnection(SOCKET s)
     return false;
 }
 
+/*****************************************************************************
+  Function:
+    int BerkeleySelect(int nfds, BSDFdSet *readfds, BSDFdSet *writefds,
+                       BSDFdSet *exceptfds, const BSDTimeval *timeout)
+
+  Summary:
+    Finds the sockets which can be read or written.
+
+  Description:
+    The BerkeleySelect() function checks the sockets of readfds and
+    writefds and leaves in them only the ones that are ready:
+    - readfds: recv() or recvfrom() returns data, accept() returns a
+      connection, or the connection is gone and recv() returns
+      SOCKET_ERROR.
+    - writefds: send() or sendto() can write, connect() completed, or the
+      connection is gone and send() returns SOCKET_ERROR.
+
+    Only the sockets which had a TCP or UDP event since BerkeleySelect() or
+    BerkeleyPoll() last found them idle are checked, so the cost depends on
+    the number of ready sockets rather than on the number of open ones.
+
+  Precondition:
+    BerkeleySocketInit function should be called.
+
+  Parameters:
+    nfds - One more than the highest socket descriptor in the sets.
+    readfds - Sockets to check for reading, or NULL.
+    writefds - Sockets to check for writing, or NULL.
+    exceptfds - Emptied if not NULL, there is no out-of-band data.
+    timeout - Time after which the application wants to call
+    BerkeleySelect() again, see Remarks.  NULL or zero if it does not matter.
+
+  Returns:
+    The number of sockets left in readfds and writefds, 0 if none is ready.
+    SOCKET_ERROR if nfds is negative.
+
+  Remarks:
+    The stack is cooperative, so BerkeleySelect() never waits.  When no
+    socket is ready, the timeout only makes StackGetIdleTime() end no later
+    than it, so that an application sleeping in STACK_IDLE_HOOK calls
+    BerkeleySelect() again in time.  Sockets which are not open are never
+    ready.
+ ***************************************************************************/
+int BerkeleySelect(int nfds, BSDFdSet *readfds, BSDFdSet *writefds, BSDFdSet *exceptfds, const BSDTimeval *timeout)
+{
+    BSDFdSet readable, writable;
+    uint32_t dwCheck;
+    uint8_t vReady;
+    unsigned int i;
+    SOCKET s;
+    int count;
+
+    if (nfds < 0)
+        return SOCKET_ERROR;
+    if (nfds > BSD_SOCKET_COUNT)
+        nfds = BSD_SOCKET_COUNT;
+
+    BSD_FD_ZERO(&readable);
+    BSD_FD_ZERO(&writable);
+    count = 0;
+
+    for (i = 0; i < ((unsigned int) nfds + 31u) / 32u; i++) {
+        dwCheck = 0;
+        if (readfds)
+            dwCheck |= readfds->fd_bits[i] & readHints.fd_bits[i];
+        if (writefds)
+            dwCheck |= writefds->fd_bits[i] & writeHints.fd_bits[i];
+        if ((unsigned int) nfds - i * 32u < 32u)
+            dwCheck &= (1ul << ((unsigned int) nfds - i * 32u)) - 1u;
+
+        for (s = i * 32u; dwCheck != 0u; s++, dwCheck >>= 1) {
+            if (!(dwCheck & 1u))
+                continue;
+
+            vReady = SocketReadiness(s);
+            if (readfds && BSD_FD_ISSET(s, readfds) && (vReady & BSD_READABLE)) {
+                BSD_FD_SET(s, &readable);
+                count++;
+            }
+            if (writefds && BSD_FD_ISSET(s, writefds) && (vReady & BSD_WRITABLE)) {
+                BSD_FD_SET(s, &writable);
+                count++;
+            }
+        }
+    }
+
+    if (readfds)
+        memcpy((void *) readfds, (void *) &readable, sizeof (readable));
+    if (writefds)
+        memcpy((void *) writefds, (void *) &writable, sizeof (writable));
+    if (exceptfds)
+        BSD_FD_ZERO(exceptfds);
+
+    if (count == 0 && timeout && (timeout->tv_sec > 0 || timeout->tv_usec > 0))
+        SetTimeout((uint32_t) timeout->tv_sec * 1000u + (uint32_t) timeout->tv_usec / 1000u);
+
+    return count;
+}
+
+/*****************************************************************************
+  Function:
+    int BerkeleyPoll(BSDPollFd *fds, unsigned int nfds, int timeout)
+
+  Summary:
+    Finds the events waiting on a list of sockets.
+
+  Description:
+    The BerkeleyPoll() function sets the revents member of each entry of
+    fds:
+    - BSD_POLLIN if requested and the socket is readable, see
+      BerkeleySelect().
+    - BSD_POLLOUT if requested and the socket is writable, see
+      BerkeleySelect().
+    - BSD_POLLHUP if the connection is gone.
+    - BSD_POLLNVAL if fd is not an open socket.
+    Entries whose fd is INVALID_SOCKET are ignored.
+
+    As with BerkeleySelect(), the sockets which had no TCP or UDP event since
+    they were last found idle are skipped without being checked.
+
+  Precondition:
+    BerkeleySocketInit function should be called.
+
+  Parameters:
+    fds - Sockets and requested events.
+    nfds - Number of entries in fds.
+    timeout - Time in milliseconds after which the application wants to
+    call BerkeleyPoll() again, see BerkeleySelect().  0 or negative if it
+    does not matter.
+
+  Returns:
+    The number of entries with a non zero revents, 0 if none.
+
+  Remarks:
+    BerkeleyPoll() never waits, see BerkeleySelect().
+ ***************************************************************************/
+int BerkeleyPoll(BSDPollFd *fds, unsigned int nfds, int timeout)
+{
+    BSDPollFd *p;
+    uint8_t vReady;
+    int count;
+
+    count = 0;
+    for (p = fds; p < fds + nfds; p++) {
+        p->revents = 0;
+        if (p->fd == INVALID_SOCKET)
+            continue;
+
+        if (p->fd >= BSD_SOCKET_COUNT || BSDSocketArray[p->fd].bsdState == SKT_CLOSED) {
+            p->revents = BSD_POLLNVAL;
+            count++;
+            continue;
+        }
+
+        // Any event sets the read hint, an idle writable socket only keeps
+        // its write hint
+        if (!BSD_FD_ISSET(p->fd, &readHints) &&
+                !((p->events & BSD_POLLOUT) && BSD_FD_ISSET(p->fd, &writeHints)))
+            continue;
+
+        vReady = SocketReadiness(p->fd);
+        if ((p->events & BSD_POLLIN) && (vReady & BSD_READABLE))
+            p->revents |= BSD_POLLIN;
+        if ((p->events & BSD_POLLOUT) && (vReady & BSD_WRITABLE))
+            p->revents |= BSD_POLLOUT;
+        if (vReady & BSD_CLOSED)
+            p->revents |= BSD_POLLHUP;
+
+        if (p->revents)
+            count++;
+    }
+
+    if (count == 0 && timeout > 0)
+        SetTimeout((uint32_t) timeout);
+
+    return count;
+}
+
+/*****************************************************************************
+  Function:
+    void BerkeleySocketSignal(int type, uint8_t hSocket)
+
+  Summary:
+    Marks the Berkeley socket of a TCP or UDP socket for BerkeleySelect()
+    and BerkeleyPoll().
+
+  Description:
+    Called by the stack when data, a connection, a reset or TX space
+    arrived on a TCP socket, or a datagram on a UDP socket.  The Berkeley
+    socket using it, and the listening socket of a connection to accept,
+    are checked by the next BerkeleySelect() or BerkeleyPoll() call.
+
+  Precondition:
+    BerkeleySocketInit function should be called.
+
+  Parameters:
+    type - SOCK_STREAM for a TCP socket, SOCK_DGRAM for a UDP socket.
+    hSocket - The TCP_SOCKET or UDP_SOCKET.
+
+  Returns:
+    None.
+
+  Remarks:
+    Sockets which no Berkeley socket uses are ignored.
+ ***************************************************************************/
+void BerkeleySocketSignal(int type, uint8_t hSocket)
+{
+    struct BSDSocket *socket;
+    SOCKET s, i;
+
+    for (s = 0; s < BSD_SOCKET_COUNT; s++) {
+        socket = &BSDSocketArray[s];
+        if (socket->SocketType != type || socket->SocketID != hSocket)
+            continue;
+
+        // Skip the sockets whose TCP or UDP socket was given back
+        if (type == SOCK_DGRAM) {
+            if (socket->bsdState != SKT_BOUND)
+                continue;
+        } else if (socket->bsdState < SKT_LISTEN || socket->bsdState > SKT_EST)
+            continue;
+
+        BSD_FD_SET(s, &readHints);
+        BSD_FD_SET(s, &writeHints);
+
+        // A connection to accept makes the listening socket readable
+        if (socket->bsdState == SKT_LISTEN) {
+            for (i = 0; i < BSD_SOCKET_COUNT; i++) {
+                if (BSDSocketArray[i].bsdState == SKT_BSD_LISTEN &&
+                        BSDSocketArray[i].localPort == socket->localPort) {
+                    BSD_FD_SET(i, &readHints);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static uint8_t SocketReadiness(SOCKET s)
+
+  Summary:
+    Checks if a socket can be read or written.
+
+  Description:
+    This function returns what BerkeleySelect() and BerkeleyPoll() report
+    for the socket, and clears its hints that no longer hold.
+
+  Precondition:
+    s is a valid socket descriptor.
+
+  Parameters:
+    s - Socket to check.
+
+  Returns:
+    BSD_READABLE, BSD_WRITABLE and BSD_CLOSED flags.
+
+  Remarks:
+    A lost connection is handled as in recv() and send(), so the socket
+    goes to the state they report.
+ ***************************************************************************/
+static uint8_t SocketReadiness(SOCKET s)
+{
+    struct BSDSocket *socket;
+    uint8_t vReady;
+    SOCKET i;
+
+    socket = &BSDSocketArray[s];
+    vReady = 0;
+
+    if (socket->SocketType == SOCK_DGRAM) {
+        if (socket->bsdState == SKT_BOUND && UDPSocketInfo[socket->SocketID].rxCount != 0u)
+            vReady |= BSD_READABLE;
+        if (socket->bsdState == SKT_CREATED || socket->bsdState == SKT_BOUND)
+            vReady |= BSD_WRITABLE;
+    } else {
+        switch (socket->bsdState) {
+        case SKT_BSD_LISTEN:
+            for (i = 0; i < BSD_SOCKET_COUNT; i++) {
+                if (BSDSocketArray[i].bsdState == SKT_LISTEN &&
+                        BSDSocketArray[i].localPort == socket->localPort &&
+                        TCPIsConnected(BSDSocketArray[i].SocketID)) {
+                    vReady = BSD_READABLE;
+                    break;
+                }
+            }
+            break;
+
+        case SKT_IN_PROGRESS:
+        case SKT_EST:
+            if (HandlePossibleTCPDisconnection(s)) {
+                vReady = BSD_READABLE | BSD_WRITABLE | BSD_CLOSED;
+                break;
+            }
+
+            if (socket->bsdState == SKT_IN_PROGRESS) {
+                if (TCPIsConnected(socket->SocketID))
+                    vReady = BSD_WRITABLE;
+                break;
+            }
+
+            if (TCPIsGetReady(socket->SocketID))
+                vReady |= BSD_READABLE;
+            if (TCPIsPutReady(socket->SocketID))
+                vReady |= BSD_WRITABLE;
+            break;
+
+        case SKT_DISCONNECTED:
+            vReady = BSD_READABLE | BSD_WRITABLE | BSD_CLOSED;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (!(vReady & BSD_READABLE))
+        BSD_FD_CLR(s, &readHints);
+    if (!(vReady & BSD_WRITABLE))
+        BSD_FD_CLR(s, &writeHints);
+
+    return vReady;
+}
+
+// Makes StackGetIdleTime() end no later than dwMilliseconds from now
+static void SetTimeout(uint32_t dwMilliseconds)
+{
+    StackSetTimer(STACK_MODULE_BERKELEY, TickGet() +
+            dwMilliseconds / 1000u * TICK_SECOND +
+            dwMilliseconds % 1000u * TICK_SECOND / 1000u);
+}
+
 #endif // STACK_USE_BERKELEY_API
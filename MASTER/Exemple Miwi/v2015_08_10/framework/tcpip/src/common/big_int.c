@@ -803,6 +803,141 @@ void BigIntSquare(BIGINT *a, BIGINT *res)
 }
 #endif
 
+/*********************************************************************
+ * Function:        BIGINT_DATA_TYPE BigIntMontgomeryInverse(BIGINT *m)
+ *
+ * PreCondition:    m is odd
+ *
+ * Input:           *m: a pointer to the modulus
+ *
+ * Output:          Returns -1/m % 2^BIGINT_DATA_SIZE
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Call BigIntMontgomeryInverse() once per modulus to
+ *                  get the constant used by BigIntMontgomeryMultiply().
+ *
+ * Note:            Only the least significant word of m is used.  Each
+ *                  Newton iteration doubles the number of correct bits,
+ *                  starting with 3 since m*m = 1 % 8 for any odd m.
+ ********************************************************************/
+#if defined(BI_USE_MONTGOMERY)
+BIGINT_DATA_TYPE BigIntMontgomeryInverse(BIGINT *m)
+{
+    BIGINT_DATA_TYPE m0, x;
+    uint8_t bits;
+
+    m0 = *m->ptrLSB;
+    x = m0;
+    for (bits = 3; bits < BIGINT_DATA_SIZE; bits <<= 1)
+        x = (BIGINT_DATA_TYPE) ((BIGINT_DATA_TYPE_2) x * (BIGINT_DATA_TYPE) (2u - (BIGINT_DATA_TYPE) ((BIGINT_DATA_TYPE_2) m0 * x)));
+
+    return (BIGINT_DATA_TYPE) (0u - x);
+}
+#endif
+
+/*********************************************************************
+ * Function:        void BigIntMontgomeryMultiply(BIGINT *a, BIGINT *b, BIGINT *m,
+ *                                                BIGINT_DATA_TYPE mInv, BIGINT *res)
+ *
+ * PreCondition:    a < m, b < m, m is odd,
+ *                  res->ptrMSBMax - res->ptrLSB + 1 >= BigIntMagnitude(m) + 2,
+ *                  &res != &[a|b|m]
+ *
+ * Input:           *a: a pointer to the first number
+ *                  *b: a pointer to the second number
+ *                  *m: a pointer to the modulus
+ *                  mInv: -1/m % 2^BIGINT_DATA_SIZE from BigIntMontgomeryInverse()
+ *                  *res: a pointer to memory to store the result
+ *
+ * Output:          *res contains a * b / R % m, where R is 2^BIGINT_DATA_SIZE
+ *                  to the power of the number of significant words in m
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Call BigIntMontgomeryMultiply() to multiply two numbers
+ *                  in Montgomery form, a*R % m and b*R % m, giving
+ *                  a*b*R % m without any division.  The product is
+ *                  reduced one word at a time as it is accumulated
+ *                  (CIOS method), so res only needs one more word than m.
+ *
+ * Note:            Written in C, the assembly helpers have no multiply and
+ *                  accumulate for it.  This is O(n^2), about the cost of
+ *                  BigIntMultiply() and half the cost of BigIntMultiply()
+ *                  followed by BigIntMod().
+ ********************************************************************/
+#if defined(BI_USE_MONTGOMERY)
+void BigIntMontgomeryMultiply(BIGINT *a, BIGINT *b, BIGINT *m, BIGINT_DATA_TYPE mInv, BIGINT *res)
+{
+    BIGINT_DATA_TYPE *pa, *pb, *pm, *pr, *xA, *xB, *xM, *rTop;
+    BIGINT_DATA_TYPE ai, u, carry, top;
+    BIGINT_DATA_TYPE_2 acc;
+
+    xA = BigIntMSB(a);
+    xB = BigIntMSB(b);
+    xM = BigIntMSB(m);
+
+    // The accumulator is res[0..words of m], plus top for its carry
+    BigIntZero(res);
+    rTop = res->ptrLSB + (xM - m->ptrLSB + 1);
+    top = 0;
+
+    for (pa = a->ptrLSB; pa <= a->ptrLSB + (xM - m->ptrLSB); pa++) {
+        // res = res + a[i] * b
+        ai = (pa <= xA) ? *pa : 0u;
+        if (ai != 0u) {
+            carry = 0;
+            for (pb = b->ptrLSB, pr = res->ptrLSB; pb <= xB; pb++, pr++) {
+                acc = (BIGINT_DATA_TYPE_2) ai * *pb + *pr + carry;
+                *pr = (BIGINT_DATA_TYPE) acc;
+                carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+            }
+            for (; carry != 0u && pr <= rTop; pr++) {
+                acc = (BIGINT_DATA_TYPE_2) *pr + carry;
+                *pr = (BIGINT_DATA_TYPE) acc;
+                carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+            }
+            top += carry;
+        }
+
+        // res = (res + u * m) / 2^BIGINT_DATA_SIZE, u being chosen so
+        // that the least significant word becomes zero
+        u = (BIGINT_DATA_TYPE) (*res->ptrLSB * mInv);
+        acc = (BIGINT_DATA_TYPE_2) u * *m->ptrLSB + *res->ptrLSB;
+        carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+        for (pm = m->ptrLSB + 1, pr = res->ptrLSB + 1; pm <= xM; pm++, pr++) {
+            acc = (BIGINT_DATA_TYPE_2) u * *pm + *pr + carry;
+            *(pr - 1) = (BIGINT_DATA_TYPE) acc;
+            carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+        }
+        acc = (BIGINT_DATA_TYPE_2) *rTop + carry;
+        *(rTop - 1) = (BIGINT_DATA_TYPE) acc;
+        *rTop = top + (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+        top = 0;
+    }
+
+    // The result is less than 2*m, subtract m once if needed
+    if (*rTop == 0u) {
+        for (pm = xM, pr = rTop - 1; pm != m->ptrLSB && *pr == *pm; pm--, pr--);
+        if (*pr < *pm) {
+            res->bMSBValid = 0;
+            return;
+        }
+    }
+
+    carry = 0;
+    for (pm = m->ptrLSB, pr = res->ptrLSB; pm <= xM; pm++, pr++) {
+        acc = (BIGINT_DATA_TYPE_2) *pr - *pm - carry;
+        *pr = (BIGINT_DATA_TYPE) acc;
+        carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE) & 1u;
+    }
+    *rTop = 0;
+
+    // Invalidate the MSB ptr
+    res->bMSBValid = 0;
+}
+#endif
+
 /*********************************************************************
  * Function:        void BigIntAdd(BIGINT *a, const BIGINT *b)
  *
@@ -55,7 +55,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define BIGINT_DATA_TYPE    uint16_t
 #define BIGINT_DATA_MAX     0xFFFFu
 #define BIGINT_DATA_TYPE_2  uint32_t
-#elif defined(__XC32)
+#else // PIC32, and the hosts using big_int_helper.c
 #define BIGINT_DATA_SIZE    32ul // bits
 #define BIGINT_DATA_TYPE    uint32_t
 #define BIGINT_DATA_MAX     0xFFFFFFFFu
@@ -88,6 +88,8 @@ void BigIntSubtractROM(BIGINT*, BIGINT_ROM*);
 void BigIntCopy(BIGINT*, BIGINT*);
 void BigIntSquare(BIGINT *a, BIGINT *res);
 void BigIntZero(BIGINT *theInt);
+BIGINT_DATA_TYPE BigIntMontgomeryInverse(BIGINT *m);
+void BigIntMontgomeryMultiply(BIGINT *a, BIGINT *b, BIGINT *m, BIGINT_DATA_TYPE mInv, BIGINT *res);
 
 int BigIntMagnitudeDifference(BIGINT *a, BIGINT *b);
 int BigIntMagnitudeDifferenceROM(BIGINT *a, BIGINT_ROM *b);
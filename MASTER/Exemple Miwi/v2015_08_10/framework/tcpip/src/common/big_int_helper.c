@@ -0,0 +1,192 @@
+/*******************************************************************************
+  File Name:
+    big_int_helper.c
+
+  Summary:
+    Portable C version of the BigInt helpers.
+
+  Description:
+    Same functions and globals as big_int_helper.asm (PIC18),
+    big_int_helper.S (PIC24/dsPIC) and big_int_helper_pic32.S (PIC32), for
+    the builds that have none of them, ex: the Linux build over a TAP
+    device.  Words are 32 bits, see big_int.h.
+ *******************************************************************************/
+
+#define __BIG_INT_HELPER_C_
+
+#include "tcpip/tcpip.h"
+
+#if (defined(STACK_USE_SSL_SERVER) || defined(STACK_USE_SSL_CLIENT)) && (!defined(ENC100_INTERFACE_MODE) || (SSL_RSA_CLIENT_SIZE > 1024)) \
+    && !defined(__XC8) && !defined(__XC16) && !defined(__XC32)
+
+BIGINT_DATA_TYPE *_iA, *_xA, *_iB, *_xB, *_iR, _wC;
+
+/*********************************************************************
+ * Function:        void _addBI(void)
+ *
+ * PreCondition:    _iA/_xA and _iB/_xB are the LSB/MSB of A and B,
+ *                  A is at least as long as B
+ *
+ * Output:          A = A + B
+ ********************************************************************/
+void _addBI(void)
+{
+    BIGINT_DATA_TYPE *a, *b, carry;
+    BIGINT_DATA_TYPE_2 acc;
+
+    carry = 0;
+    for (a = _iA, b = _iB; b <= _xB; a++, b++) {
+        acc = (BIGINT_DATA_TYPE_2) *a + *b + carry;
+        *a = (BIGINT_DATA_TYPE) acc;
+        carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+    }
+
+    // Propagate the carry up to the end of A
+    for (; carry != 0u && a <= _xA; a++)
+        carry = (++*a == 0u);
+}
+
+/*********************************************************************
+ * Function:        void _subBI(void)
+ *
+ * PreCondition:    _iA/_xA and _iB/_xB are the LSB/MSB of A and B,
+ *                  A is at least as long as B
+ *
+ * Output:          A = A - B
+ ********************************************************************/
+void _subBI(void)
+{
+    BIGINT_DATA_TYPE *a, *b, borrow;
+    BIGINT_DATA_TYPE_2 acc;
+
+    borrow = 0;
+    for (a = _iA, b = _iB; b <= _xB; a++, b++) {
+        acc = (BIGINT_DATA_TYPE_2) *a - *b - borrow;
+        *a = (BIGINT_DATA_TYPE) acc;
+        borrow = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE) & 1u;
+    }
+
+    // Propagate the borrow up to the end of A
+    for (; borrow != 0u && a <= _xA; a++)
+        borrow = ((*a)-- == 0u);
+}
+
+/*********************************************************************
+ * Function:        void _zeroBI(void)
+ *
+ * PreCondition:    _iA/_xA are the LSB/MSB of A
+ *
+ * Output:          A = 0
+ ********************************************************************/
+void _zeroBI(void)
+{
+    BIGINT_DATA_TYPE *a;
+
+    for (a = _iA; a <= _xA; a++)
+        *a = 0;
+}
+
+/*********************************************************************
+ * Function:        void _msbBI(void)
+ *
+ * PreCondition:    _iA/_xA are the first and last words of A
+ *
+ * Output:          _xA points to the most significant non-zero word of
+ *                  A, or to _iA if A is zero
+ ********************************************************************/
+void _msbBI(void)
+{
+    while (_xA != _iA && *_xA == 0u)
+        _xA--;
+}
+
+/*********************************************************************
+ * Function:        void _mulBI(void)
+ *
+ * PreCondition:    _iA/_xA and _iB/_xB are the LSB/MSB of A and B,
+ *                  _iR is the LSB of R, zeroed and long enough for the
+ *                  product
+ *
+ * Output:          R = A * B
+ ********************************************************************/
+void _mulBI(void)
+{
+    BIGINT_DATA_TYPE *a, *b, *r, *r0, carry;
+    BIGINT_DATA_TYPE_2 acc;
+
+    for (b = _iB, r0 = _iR; b <= _xB; b++, r0++) {
+        if (*b == 0u)
+            continue;
+
+        carry = 0;
+        for (a = _iA, r = r0; a <= _xA; a++, r++) {
+            acc = (BIGINT_DATA_TYPE_2) *a * *b + *r + carry;
+            *r = (BIGINT_DATA_TYPE) acc;
+            carry = (BIGINT_DATA_TYPE) (acc >> BIGINT_DATA_SIZE);
+        }
+        *r = carry;
+    }
+}
+
+/*********************************************************************
+ * Function:        void _sqrBI(void)
+ *
+ * PreCondition:    _iA/_xA are the LSB/MSB of A, _iR is the LSB of R,
+ *                  zeroed and long enough for the product
+ *
+ * Output:          R = A * A
+ ********************************************************************/
+void _sqrBI(void)
+{
+    _iB = _iA;
+    _xB = _xA;
+    _mulBI();
+}
+
+/*********************************************************************
+ * Function:        void _masBI(void)
+ *
+ * PreCondition:    _iB/_xB are the LSB/MSB of B, _wC is the word by
+ *                  which to multiply, _iR is the LSB of R
+ *
+ * Output:          R = R - (B * C)
+ *
+ * Note:            Like the assembly versions, the last borrow is taken
+ *                  from the word of R above B and not further, BigIntMod()
+ *                  corrects an underflow by adding B back.
+ ********************************************************************/
+void _masBI(void)
+{
+    BIGINT_DATA_TYPE *b, *r;
+    BIGINT_DATA_TYPE_2 acc, carry;
+
+    carry = 0;
+    for (b = _iB, r = _iR; b <= _xB; b++, r++) {
+        acc = (BIGINT_DATA_TYPE_2) *b * _wC + carry;
+        carry = acc >> BIGINT_DATA_SIZE;
+        if (*r < (BIGINT_DATA_TYPE) acc)
+            carry++;
+        *r -= (BIGINT_DATA_TYPE) acc;
+    }
+    *r -= (BIGINT_DATA_TYPE) carry;
+}
+
+/*********************************************************************
+ * Function:        void _copyBI(void)
+ *
+ * PreCondition:    _iA/_xA and _iB/_xB are the first and last words of
+ *                  A and B
+ *
+ * Output:          A = B, truncated to the length of A or zero filled
+ ********************************************************************/
+void _copyBI(void)
+{
+    BIGINT_DATA_TYPE *a, *b;
+
+    for (a = _iA, b = _iB; a <= _xA && b <= _xB; a++, b++)
+        *a = *b;
+    for (; a <= _xA; a++)
+        *a = 0;
+}
+
+#endif
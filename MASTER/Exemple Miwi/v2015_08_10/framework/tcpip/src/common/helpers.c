@@ -44,6 +44,10 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 
 #include "tcpip/tcpip.h"
 
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+
 // Default Random Number Generator seed. 0x41FE9F9E corresponds to calling LFSRSeedRand(1)
 static uint32_t dwLFSRRandSeed = 0x41FE9F9E;
 
@@ -193,6 +197,19 @@ uint16_t LFSRRand(void)
     cryptographically secure random number.  Whether or not this is true on
     all (or any) devices/voltages/temperatures is not tested.
  ***************************************************************************/
+#if defined(__linux__)
+uint32_t GenerateRandomDWORD(void)
+{
+    uint32_t dw;
+
+    // No A/D converter to time, take the entropy from the kernel
+    if (getrandom(&dw, sizeof (dw), 0) != sizeof (dw))
+        dw = TickGet() ^ ((uint32_t) LFSRRand() << 16);
+    LFSRSeedRand(dw);
+
+    return dw;
+}
+#else
 uint32_t GenerateRandomDWORD(void)
 {
     uint8_t vBitCount;
@@ -346,6 +363,7 @@ uint32_t GenerateRandomDWORD(void)
 
     return randomResult.dw;
 }
+#endif
 
 #if defined(STACK_USE_HTTP_SERVER)
 
@@ -1084,7 +1102,7 @@ uint32_t swapl(uint32_t v)
     summed).  This checksum is defined in RFC 793.
 
   Precondition:
-    buffer is uint16_t aligned (even memory address) on 16- and 32-bit PICs.
+    None
 
   Parameters:
     buffer - pointer to the data to be checksummed
@@ -1092,40 +1110,288 @@ uint32_t swapl(uint32_t v)
 
   Returns:
     The calculated checksum.
-
-  Internal:
-    This function could be improved to do 32-bit sums on PIC32 platforms.
  ***************************************************************************/
 uint16_t CalcIPChecksum(uint8_t * buffer, uint16_t count)
 {
-    uint16_t i;
-    uint16_t *val;
+    return ~CalcIPChecksumAdd(0, buffer, count);
+}
 
-    union {
-        uint16_t w[2];
-        uint32_t dw;
-    } sum;
+/*****************************************************************************
+  Function:
+    uint16_t CalcIPChecksumAdd(uint16_t wSum, uint8_t * buffer, uint16_t count)
 
-    i = count >> 1;
-    val = (uint16_t*) buffer;
+  Summary:
+    Adds an array to a one's complement sum.
+
+  Description:
+    This function adds the 16-bit words of an array to a partial one's
+    complement sum, so that a checksum can be calculated over data that is
+    not contiguous.  The final checksum is the complement of the sum.
+
+    On 32-bit targets, the words are summed 32 bits at a time in a 64-bit
+    accumulator, which is folded only at the end.
+
+  Precondition:
+    None
+
+  Parameters:
+    wSum   - sum of the previous data, 0 for the first array
+    buffer - pointer to the data to be summed
+    count  - number of bytes to be summed
 
+  Returns:
+    The one's complement sum of the previous data and the array, not
+    complemented.
+
+  Remarks:
+    The array is summed as if it started at an even offset of the data.  If
+    the previous data had an odd length, swap the bytes of the returned sum
+    before adding it (RFC 1071).
+
+    The buffer may start at an odd address, the words are read aligned.
+ ***************************************************************************/
+uint16_t CalcIPChecksumAdd(uint16_t wSum, uint8_t * buffer, uint16_t count)
+{
+    TCPIP_UINT16_VAL wFirst, wLast;
+    TCPIP_UINT32_VAL dwTotal;
+    uint16_t *val;
+#if defined(__XC8) || defined(__XC16)
+    TCPIP_UINT32_VAL sum;
+#else
+    uint32_t *dwVal;
+    uint64_t sum;
+#endif
+    bool bOddAddress;
+
+    // Sum from the next (even) address, the first byte is added back at the
+    // end as the first byte of its word
+    wFirst.Val = 0x0000;
+    bOddAddress = ((PTR_BASE) buffer & 0x1u) && count;
+    if (bOddAddress) {
+        wFirst.v[0] = *buffer++;
+        count--;
+    }
+
+    val = (uint16_t *) buffer;
+
+#if defined(__XC8) || defined(__XC16)
     // Calculate the sum of all words
-    sum.dw = 0x00000000ul;
-    while (i--)
-        sum.dw += (uint32_t) * val++;
+    sum.Val = 0x00000000ul;
+    while (count > 1u) {
+        sum.Val += (uint32_t) * val++;
+        count -= 2;
+    }
+#else
+    sum = 0;
+
+    // Align to 32 bits, then sum 32 bytes per loop
+    if (((PTR_BASE) val & 0x2u) && (count > 1u)) {
+        sum += *val++;
+        count -= 2;
+    }
+
+    dwVal = (uint32_t *) val;
+    while (count >= 32u) {
+        sum += (uint64_t) dwVal[0] + dwVal[1] + dwVal[2] + dwVal[3];
+        sum += (uint64_t) dwVal[4] + dwVal[5] + dwVal[6] + dwVal[7];
+        dwVal += 8;
+        count -= 32;
+    }
+    while (count >= 4u) {
+        sum += *dwVal++;
+        count -= 4;
+    }
+
+    val = (uint16_t *) dwVal;
+    if (count > 1u) {
+        sum += *val++;
+        count -= 2;
+    }
+#endif
 
     // Add in the sum of the remaining byte, if present
-    if (count & 0x1)
-        sum.dw += (uint32_t)*(uint8_t *) val;
+    wLast.Val = 0x0000;
+    if (count)
+        wLast.v[0] = *(uint8_t *) val;
+
+#if defined(__XC8) || defined(__XC16)
+    sum.Val += wLast.Val;
 
     // Do an end-around carry (one's complement arrithmatic)
-    sum.dw = (uint32_t) sum.w[0] + (uint32_t) sum.w[1];
+    sum.Val = (uint32_t) sum.w[0] + (uint32_t) sum.w[1];
 
     // Do another end-around carry in case if the prior add
     // caused a carry out
     sum.w[0] += sum.w[1];
+    wLast.Val = sum.w[0];
+#else
+    sum += wLast.Val;
+
+    // Fold the 64-bit accumulator with end-around carries
+    sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+    sum = (sum & 0xFFFFull) + (sum >> 16);
+    sum = (sum & 0xFFFFull) + (sum >> 16);
+    wLast.Val = (uint16_t) sum;
+#endif
+
+    // The bytes after an odd address were summed one position off
+    if (bOddAddress)
+        wLast.Val = swaps(wLast.Val);
+
+    dwTotal.Val = (uint32_t) wSum + wFirst.Val + wLast.Val;
+    dwTotal.Val = (uint32_t) dwTotal.w[0] + (uint32_t) dwTotal.w[1];
+    dwTotal.w[0] += dwTotal.w[1];
+
+    return dwTotal.w[0];
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t CalcIPChecksumCopy(uint16_t wSum, uint8_t * dest, uint8_t * source,
+                                uint16_t count)
+
+  Summary:
+    Copies an array and adds it to a one's complement sum.
+
+  Description:
+    This function copies an array like memcpy() and returns the same sum as
+    CalcIPChecksumAdd() on the copied bytes.  It is used when packet data is
+    copied into a MAC buffer that is mapped in RAM.
+
+    On PIC32, the words are summed as they are copied, so each byte is read
+    only once.  On other targets the array is copied with memcpy() and summed
+    in the destination while it is still in the cache, which is faster than
+    a word loop when the C library copies with vector instructions.
+
+  Precondition:
+    The arrays do not overlap.
+
+  Parameters:
+    wSum   - sum of the previous data, 0 for the first array
+    dest   - where to copy the data
+    source - pointer to the data to be copied and summed
+    count  - number of bytes to be copied
+
+  Returns:
+    The one's complement sum of the previous data and the array, not
+    complemented.
+
+  Remarks:
+    On PIC32, if dest and source do not have the same alignment, the array
+    is copied with memcpy() and then summed.
+ ***************************************************************************/
+uint16_t CalcIPChecksumCopy(uint16_t wSum, uint8_t * dest, uint8_t * source, uint16_t count)
+{
+#if defined(__XC32)
+    uint8_t *start;
+    uint32_t *dwSource, *dwDest;
+    uint32_t dw0, dw1, dw2, dw3;
+    uint64_t sum;
+    TCPIP_UINT32_VAL dwTotal;
+    uint16_t wHead;
+
+    if (((PTR_BASE) dest ^ (PTR_BASE) source) & 0x3u) {
+        memcpy((void *) dest, (void *) source, count);
+        return CalcIPChecksumAdd(wSum, dest, count);
+    }
+
+    // Copy up to 3 bytes to reach 32-bit alignment, they are summed in the
+    // destination at the end
+    start = dest;
+    wHead = (0u - (uint16_t) (PTR_BASE) dest) & 0x3u;
+    if (wHead > count)
+        wHead = count;
+    memcpy((void *) dest, (void *) source, wHead);
+    dest += wHead;
+    source += wHead;
+    count -= wHead;
+
+    dwSource = (uint32_t *) source;
+    dwDest = (uint32_t *) dest;
+    sum = 0;
+    while (count >= 16u) {
+        dw0 = dwSource[0];
+        dw1 = dwSource[1];
+        dw2 = dwSource[2];
+        dw3 = dwSource[3];
+        dwDest[0] = dw0;
+        dwDest[1] = dw1;
+        dwDest[2] = dw2;
+        dwDest[3] = dw3;
+        sum += (uint64_t) dw0 + dw1 + dw2 + dw3;
+        dwSource += 4;
+        dwDest += 4;
+        count -= 16;
+    }
+    while (count >= 4u) {
+        dw0 = *dwSource++;
+        *dwDest++ = dw0;
+        sum += dw0;
+        count -= 4;
+    }
+    memcpy((void *) dwDest, (void *) dwSource, count);
+    sum += CalcIPChecksumAdd(0, (uint8_t *) dwDest, count);
+
+    // Fold the 64-bit accumulator with end-around carries
+    sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+    sum = (sum & 0xFFFFull) + (sum >> 16);
+    sum = (sum & 0xFFFFull) + (sum >> 16);
+    dwTotal.Val = (uint16_t) sum;
+
+    // The words were summed from offset wHead of the array
+    if (wHead & 0x1u)
+        dwTotal.Val = swaps(dwTotal.w[0]);
+
+    dwTotal.Val += CalcIPChecksumAdd(wSum, start, wHead);
+    dwTotal.Val = (uint32_t) dwTotal.w[0] + (uint32_t) dwTotal.w[1];
+    dwTotal.w[0] += dwTotal.w[1];
+
+    return dwTotal.w[0];
+#else
+    memcpy((void *) dest, (void *) source, count);
+    return CalcIPChecksumAdd(wSum, dest, count);
+#endif
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t CalcIPChecksumUpdate(uint16_t wChecksum, uint16_t wOld, uint16_t wNew)
+
+  Summary:
+    Updates an IP checksum after a word of the data changed.
+
+  Description:
+    This function updates a checksum for one 16-bit word of the data changed
+    from wOld to wNew, without summing the data again.  It uses equation 3
+    of RFC 1624: HC' = ~(~HC + ~m + m').
+
+  Precondition:
+    None
+
+  Parameters:
+    wChecksum - checksum of the data before the change
+    wOld      - previous value of the word, as stored in the data
+    wNew      - new value of the word, as stored in the data
+
+  Returns:
+    The checksum of the changed data.
+
+  Remarks:
+    Call once per changed word, the changed words must be at even offsets
+    of the data.  Reordering the bytes of the data, like the Swap*Header()
+    functions do, changes the words but not their sum: a header swapped in
+    place keeps its checksum.
+ ***************************************************************************/
+uint16_t CalcIPChecksumUpdate(uint16_t wChecksum, uint16_t wOld, uint16_t wNew)
+{
+    TCPIP_UINT32_VAL sum;
+
+    sum.Val = (uint32_t) (uint16_t) ~wChecksum + (uint32_t) (uint16_t) ~wOld + (uint32_t) wNew;
+    sum.Val = (uint32_t) sum.w[0] + (uint32_t) sum.w[1];
+    sum.w[0] += sum.w[1];
 
-    // Return the resulting checksum
     return ~sum.w[0];
 }
 
@@ -94,6 +94,9 @@ uint32_t swapl(uint32_t v);
 #endif
 
 uint16_t CalcIPChecksum(uint8_t * buffer, uint16_t len);
+uint16_t CalcIPChecksumAdd(uint16_t wSum, uint8_t * buffer, uint16_t count);
+uint16_t CalcIPChecksumCopy(uint16_t wSum, uint8_t * dest, uint8_t * source, uint16_t count);
+uint16_t CalcIPChecksumUpdate(uint16_t wChecksum, uint16_t wOld, uint16_t wNew);
 
 #if defined(__XC8)
 uint32_t leftRotateDWORD(uint32_t val, uint8_t bits);
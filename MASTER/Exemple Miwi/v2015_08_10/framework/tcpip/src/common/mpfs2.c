@@ -75,7 +75,8 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
  *
  *     Pointers are absolute addresses within the MPFS image.
  *     Timestamp is the UNIX timestamp
- *     Microtime is currently unimplemented
+ *     Microtime holds the Cache-Control max-age when MPFS2_FLAG_MAXAGE is
+ *     set, and is unused otherwise
  *
  * String Structure (1 to 64 bytes):
  *     ["path/to/file.ext"][0x00]
@@ -93,6 +94,10 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
  * When a file has an index, that index file has no file name,
  * but is accessible as the file immediately following in the image.
  *
+ * The MPFS2 builder sorts the files by name hash, each index file staying
+ * after its file with the same hash, so that MPFSOpen() can binary search
+ * the hashes.  Images with unsorted hashes are searched linearly.
+ *
  * Current version is 2.1
  */
 
@@ -114,11 +119,40 @@ static MPFS_FAT_RECORD fatCache;
 // ID of currently loaded fatCache
 static uint16_t fatCacheID;
 
+// Recently used FAT records, so that files opened again don't need to be
+// searched and read from the image
+typedef struct {
+    MPFS_FAT_RECORD rec; // Copy of the FAT record
+    uint16_t fatID; // ID of the record, MPFS_INVALID_FAT if unused
+    uint16_t nameHash; // Hash of the file name, valid when isNamed
+    bool isNamed; // The file was opened by name
+} MPFS_FAT_RECENT;
+
+static MPFS_FAT_RECENT fatRecent[MPFS_FAT_CACHE_SIZE];
+
+// Slot of fatRecent holding fatCache, and next slot to be replaced
+static uint8_t fatRecentSlot, fatRecentNext;
+
 // Number of files in this MPFS image
 static uint16_t numFiles;
 
+// The name hashes are in ascending order, so they can be binary searched
+static bool isHashSorted;
+
 static void _LoadFATRecord(uint16_t fatID);
+static uint16_t _ReadNameHash(uint16_t fatID);
+static uint16_t _FindNameHash(uint16_t nameHash, uint16_t fatID);
+static bool _FindRecentName(uint16_t nameHash);
+static bool _CompareName(uint8_t *cFile);
+#if defined(__XC8)
+static bool _CompareNameROM(ROM uint8_t *cFile);
+#endif
 static void _Validate(void);
+#if defined(MPFS_USE_SPI_FLASH)
+static void _WritePump(bool flush);
+static void _WriteErase(void);
+static uint16_t _CRC16(uint16_t wCRC, uint8_t *vData, uint16_t wLen);
+#endif
 
 /****************************************************************************
   Section:
@@ -139,6 +173,30 @@ MPFS_PTR lastRead;
 // Beginning address of MPFS Image
 #define MPFS_HEAD  MPFS_RESERVE_BLOCK
 
+#if (MPFS_WRITE_BUFFER_SIZE > SPI_FLASH_PROGRAM_PAGE) || ((MPFS_WRITE_BUFFER_SIZE & (MPFS_WRITE_BUFFER_SIZE - 1)) != 0)
+#error MPFS_WRITE_BUFFER_SIZE must be a power of 2 up to SPI_FLASH_PROGRAM_PAGE
+#endif
+
+#define MPFS_WRITE_BUFFER_MASK  (MPFS_WRITE_BUFFER_SIZE - 1)
+
+// Image being written.  MPFSPutArray() fills one buffer while the other one
+// is programmed, and the sectors ahead are erased while the data arrives,
+// so that the SPI Flash is never waited for while there is data to take.
+// Each buffer holds the data of one aligned MPFS_WRITE_BUFFER_SIZE block
+// of the image, at the offset of its address in the block.
+static struct {
+    uint8_t vData[2][MPFS_WRITE_BUFFER_SIZE];
+    uint16_t wLen[2]; // Bytes in each buffer
+    MPFS_PTR dwProgAddr; // Flash address of the first byte in vData[vProg]
+    MPFS_PTR dwFillAddr; // Flash address of the next byte put
+    MPFS_PTR dwEraseAddr; // First sector not erased yet
+    uint16_t wInCRC; // Running CRC of the data put
+    uint16_t wOutCRC; // Running CRC of the data read back after programming
+    uint8_t vProg; // Oldest buffer, the next one to program
+    uint8_t vClosed; // Buffers ready to program from vProg on, the next one is being filled
+    bool isProgramming; // vData[vProg] is being programmed
+} mpfsWrite;
+
 #else
 
 // An address where MPFS data starts in program memory.
@@ -231,11 +289,7 @@ MPFS_HANDLE MPFSOpen(uint8_t * cFile)
 {
     MPFS_HANDLE hMPFS;
     uint16_t nameHash, i;
-    uint16_t hashCache[8];
-    uint8_t *ptr, c;
-
-    // Initialize c to avoid "may be used uninitialized" compiler warning
-    c = 0;
+    uint8_t *ptr;
 
     // Make sure MPFS is unlocked and we got a filename
     if (*cFile == '\0' || isMPFSLocked == true)
@@ -251,44 +305,33 @@ MPFS_HANDLE MPFSOpen(uint8_t * cFile)
     for (hMPFS = 1; hMPFS <= MAX_MPFS_HANDLES; hMPFS++)
         if (MPFSStubs[hMPFS].addr == MPFS_INVALID)
             break;
-    if (hMPFS == MAX_MPFS_HANDLES)
+    if (hMPFS > MAX_MPFS_HANDLES)
         return MPFS_INVALID_HANDLE;
 
-    // Read in hashes, and check remainder on a match.  Store 8 in cache for performance
-    for (i = 0; i < numFiles; i++) {
-        // For new block of 8, read in data
-        if ((i & 0x07) == 0u) {
-            MPFSStubs[0].addr = 8 + i * 2;
-            MPFSStubs[0].bytesRem = 16;
-            MPFSGetArray(0, (uint8_t *) hashCache, 16);
-        }
-
-        // If the hash matches, compare the full filename
-        if (hashCache[i & 0x07] == nameHash) {
+    // Check the files opened recently, then each file with a matching hash
+    if (_FindRecentName(nameHash) && _CompareName(cFile)) {
+        i = fatCacheID;
+    } else {
+        for (i = _FindNameHash(nameHash, 0); i < numFiles; i = _FindNameHash(nameHash, i + 1)) {
             _LoadFATRecord(i);
-            MPFSStubs[0].addr = fatCache.string;
-            MPFSStubs[0].bytesRem = 255;
-
-            // Loop over filename to perform comparison
-            for (ptr = cFile; *ptr != '\0'; ptr++) {
-                MPFSGet(0, &c);
-                if (*ptr != c)
-                    break;
-            }
+            if (_CompareName(cFile))
+                break;
+        }
 
-            MPFSGet(0, &c);
+        // No file name matched, so return nothing
+        if (i >= numFiles)
+            return MPFS_INVALID_HANDLE;
 
-            if (c == '\0' && *ptr == '\0') { // Filename matches, so return true
-                MPFSStubs[hMPFS].addr = fatCache.data;
-                MPFSStubs[hMPFS].bytesRem = fatCache.len;
-                MPFSStubs[hMPFS].fatID = i;
-                return hMPFS;
-            }
-        }
+        // Remember the name of the record, for the next time it is opened
+        fatRecent[fatRecentSlot].nameHash = nameHash;
+        fatRecent[fatRecentSlot].isNamed = true;
     }
 
-    // No file name matched, so return nothing
-    return MPFS_INVALID_HANDLE;
+    // Set up the file handle
+    MPFSStubs[hMPFS].addr = fatCache.data;
+    MPFSStubs[hMPFS].bytesRem = fatCache.len;
+    MPFSStubs[hMPFS].fatID = i;
+    return hMPFS;
 }
 
 /*****************************************************************************
@@ -316,9 +359,7 @@ MPFS_HANDLE MPFSOpenROM(ROM uint8_t * cFile)
 {
     MPFS_HANDLE hMPFS;
     uint16_t nameHash, i;
-    uint16_t hashCache[8];
     ROM uint8_t *ptr;
-    uint8_t c;
 
     // Make sure MPFS is unlocked and we got a filename
     if (*cFile == '\0' || isMPFSLocked == true)
@@ -334,45 +375,35 @@ MPFS_HANDLE MPFSOpenROM(ROM uint8_t * cFile)
     for (hMPFS = 1; hMPFS <= MAX_MPFS_HANDLES; hMPFS++)
         if (MPFSStubs[hMPFS].addr == MPFS_INVALID)
             break;
-    if (hMPFS == MAX_MPFS_HANDLES)
+    if (hMPFS > MAX_MPFS_HANDLES)
         return MPFS_INVALID_HANDLE;
 
-    // Read in hashes, and check remainder on a match.  Store 8 in cache for performance
-    for (i = 0; i < numFiles; i++) {
-        // For new block of 8, read in data
-        if ((i & 0x07) == 0u) {
-            MPFSStubs[0].addr = 8 + i * 2;
-            MPFSStubs[0].bytesRem = 16;
-            MPFSGetArray(0, (uint8_t *) hashCache, 16);
-        }
-
-        // If the hash matches, compare the full filename
-        if (hashCache[i & 0x07] == nameHash) {
+    // Check the files opened recently, then each file with a matching hash
+    if (_FindRecentName(nameHash) && _CompareNameROM(cFile)) {
+        i = fatCacheID;
+    } else {
+        for (i = _FindNameHash(nameHash, 0); i < numFiles; i = _FindNameHash(nameHash, i + 1)) {
             _LoadFATRecord(i);
-            MPFSStubs[0].addr = fatCache.string;
-            MPFSStubs[0].bytesRem = 255;
-
-            // Loop over filename to perform comparison
-            for (ptr = cFile; *ptr != '\0'; ptr++) {
-                MPFSGet(0, &c);
-                if (*ptr != c)
-                    break;
-            }
+            if (_CompareNameROM(cFile))
+                break;
+        }
 
-            MPFSGet(0, &c);
+        // No file name matched, so return nothing
+        if (i >= numFiles)
+            return MPFS_INVALID_HANDLE;
 
-            if (c == '\0' && *ptr == '\0') { // Filename matches, so return true
-                MPFSStubs[hMPFS].addr = fatCache.data;
-                MPFSStubs[hMPFS].bytesRem = fatCache.len;
-                MPFSStubs[hMPFS].fatID = i;
-                return hMPFS;
-            }
-        }
+        // Remember the name of the record, for the next time it is opened
+        fatRecent[fatRecentSlot].nameHash = nameHash;
+        fatRecent[fatRecentSlot].isNamed = true;
     }
 
-    // No file name matched, so return nothing
-    return MPFS_INVALID_HANDLE;
+    // Set up the file handle
+    MPFSStubs[hMPFS].addr = fatCache.data;
+    MPFSStubs[hMPFS].bytesRem = fatCache.len;
+    MPFSStubs[hMPFS].fatID = i;
+    return hMPFS;
 }
+
 #endif
 
 /*****************************************************************************
@@ -402,14 +433,14 @@ MPFS_HANDLE MPFSOpenID(uint16_t hFatID)
     MPFS_HANDLE hMPFS;
 
     // Make sure MPFS is unlocked and we got a valid id
-    if (isMPFSLocked == true || hFatID > numFiles)
+    if (isMPFSLocked == true || hFatID >= numFiles)
         return MPFS_INVALID_HANDLE;
 
     // Find a free file handle to use
     for (hMPFS = 1; hMPFS <= MAX_MPFS_HANDLES; hMPFS++)
         if (MPFSStubs[hMPFS].addr == MPFS_INVALID)
             break;
-    if (hMPFS == MAX_MPFS_HANDLES)
+    if (hMPFS > MAX_MPFS_HANDLES)
         return MPFS_INVALID_HANDLE;
 
     // Load the FAT record
@@ -819,8 +850,18 @@ MPFS_HANDLE MPFSFormat(void)
 
     return MPFS_INVALID_HANDLE;
 #else
-    // Set up SPI Flash for writing
-    SPIFlashBeginWrite(MPFS_HEAD);
+    // Set up the write buffers, and start erasing the first sectors
+    mpfsWrite.wLen[0] = 0;
+    mpfsWrite.wLen[1] = 0;
+    mpfsWrite.dwProgAddr = MPFS_HEAD;
+    mpfsWrite.dwFillAddr = MPFS_HEAD;
+    mpfsWrite.dwEraseAddr = MPFS_HEAD;
+    mpfsWrite.wInCRC = 0xffff;
+    mpfsWrite.wOutCRC = 0xffff;
+    mpfsWrite.vProg = 0;
+    mpfsWrite.vClosed = 0;
+    mpfsWrite.isProgramming = false;
+    _WritePump(false);
     return 0x00;
 #endif
 }
@@ -848,6 +889,9 @@ MPFS_HANDLE MPFSFormat(void)
     For EEPROM, the actual write may not initialize until the internal write
     page is full.  To ensure that previously written data gets stored,
     MPFSPutEnd must be called after the last call to MPFSPutArray.
+
+    For SPI Flash, the data is buffered and this function only waits for
+    the Flash when more than MPFSIsPutReady bytes are put.
  ***************************************************************************/
 #if defined(MPFS_USE_EEPROM) || defined(MPFS_USE_SPI_FLASH)
 uint16_t MPFSPutArray(MPFS_HANDLE hMPFS, uint8_t * cData, uint16_t wLen)
@@ -873,16 +917,208 @@ uint16_t MPFSPutArray(MPFS_HANDLE hMPFS, uint8_t * cData, uint16_t wLen)
     return count;
 
 #else
-    // Write to the SPI Flash
-    SPIFlashWriteArray(cData, wLen);
-    return wLen;
+    // Buffer the data for the SPI Flash
+    uint16_t count, wChunk;
+    uint8_t vFill;
+
+    for (count = 0; count < wLen; count += wChunk) {
+        wChunk = MPFSIsPutReady(hMPFS);
+        if (wChunk == 0u)
+            continue;
+        if (wChunk > wLen - count)
+            wChunk = wLen - count;
+
+        vFill = mpfsWrite.vProg ^ mpfsWrite.vClosed;
+        memcpy(&mpfsWrite.vData[vFill][mpfsWrite.dwFillAddr & MPFS_WRITE_BUFFER_MASK], &cData[count], wChunk);
+        mpfsWrite.wInCRC = _CRC16(mpfsWrite.wInCRC, &cData[count], wChunk);
+        mpfsWrite.wLen[vFill] += wChunk;
+        mpfsWrite.dwFillAddr += wChunk;
+
+        // A full buffer can be programmed
+        if ((mpfsWrite.dwFillAddr & MPFS_WRITE_BUFFER_MASK) == 0u)
+            mpfsWrite.vClosed++;
+    }
+
+    return count;
 #endif
 }
 #endif
 
 /*****************************************************************************
   Function:
-    void MPFSPutEnd(void)
+    uint16_t MPFSIsPutReady(MPFS_HANDLE hMPFS)
+
+  Description:
+    Determines how many bytes MPFSPutArray can take without waiting.
+
+  Precondition:
+    MPFSFormat was sucessfully called.
+
+  Parameters:
+    hMPFS - the file handle for writing
+
+  Returns:
+    The number of bytes that can be written without waiting for the
+    external memory.
+
+  Remarks:
+    For SPI Flash, this function also moves the erasing and programming
+    forward, so it should be called while waiting for the data to write.
+    EEPROM writes always wait, and 0xffff is returned.
+ ***************************************************************************/
+#if defined(MPFS_USE_EEPROM) || defined(MPFS_USE_SPI_FLASH)
+uint16_t MPFSIsPutReady(MPFS_HANDLE hMPFS)
+{
+#if defined(MPFS_USE_EEPROM)
+    return 0xffff;
+#else
+    _WritePump(false);
+
+    // Both buffers are waiting for the SPI Flash
+    if (mpfsWrite.vClosed == 2u)
+        return 0;
+
+    return MPFS_WRITE_BUFFER_SIZE - (uint16_t) (mpfsWrite.dwFillAddr & MPFS_WRITE_BUFFER_MASK);
+#endif
+}
+#endif
+
+/*****************************************************************************
+  Function:
+    static void _WritePump(bool flush)
+
+  Description:
+    Moves the writing of the image to SPI Flash forward without waiting.
+
+  Precondition:
+    MPFSFormat was sucessfully called.
+
+  Parameters:
+    flush - true to also program the buffer being filled
+
+  Returns:
+    None
+
+  Remarks:
+    When the SPI Flash is idle, this function either checks the buffer just
+    programmed, programs the next buffer, or erases the next sector: on
+    demand for the next buffer, or ahead of the data when no buffer is
+    ready.  Each buffer is read back into a running CRC, which MPFSPutEnd
+    compares to the CRC of the data put.
+ ***************************************************************************/
+#if defined(MPFS_USE_SPI_FLASH)
+static void _WritePump(bool flush)
+{
+    uint8_t vProg;
+
+    if (SPIFlashIsBusy())
+        return;
+
+    vProg = mpfsWrite.vProg;
+    if (mpfsWrite.isProgramming) {
+        // Read the data back over the buffer, which is free now
+        SPIFlashReadArray(mpfsWrite.dwProgAddr, &mpfsWrite.vData[vProg][mpfsWrite.dwProgAddr & MPFS_WRITE_BUFFER_MASK], mpfsWrite.wLen[vProg]);
+        mpfsWrite.wOutCRC = _CRC16(mpfsWrite.wOutCRC, &mpfsWrite.vData[vProg][mpfsWrite.dwProgAddr & MPFS_WRITE_BUFFER_MASK], mpfsWrite.wLen[vProg]);
+
+        mpfsWrite.dwProgAddr += mpfsWrite.wLen[vProg];
+        mpfsWrite.wLen[vProg] = 0;
+        vProg ^= 1;
+        mpfsWrite.vProg = vProg;
+        mpfsWrite.vClosed--;
+        mpfsWrite.isProgramming = false;
+    }
+
+    // Program the partly filled buffer too when flushing
+    if (flush && mpfsWrite.vClosed < 2u && mpfsWrite.wLen[vProg ^ mpfsWrite.vClosed] != 0u)
+        mpfsWrite.vClosed++;
+
+    if (mpfsWrite.vClosed == 0u) {
+        // Nothing to program, so keep the next sector erased ahead
+        if (!flush && mpfsWrite.dwEraseAddr <= mpfsWrite.dwFillAddr + SPI_FLASH_SECTOR_SIZE)
+            _WriteErase();
+        return;
+    }
+
+    // A buffer never crosses a sector, which must be erased first
+    if (mpfsWrite.dwProgAddr >= mpfsWrite.dwEraseAddr) {
+        _WriteErase();
+        return;
+    }
+
+    SPIFlashStartWritePage(mpfsWrite.dwProgAddr, &mpfsWrite.vData[vProg][mpfsWrite.dwProgAddr & MPFS_WRITE_BUFFER_MASK], mpfsWrite.wLen[vProg]);
+    mpfsWrite.isProgramming = true;
+}
+
+/*****************************************************************************
+  Function:
+    static void _WriteErase(void)
+
+  Description:
+    Starts erasing the SPI Flash after the part already erased.
+
+  Precondition:
+    The SPI Flash is idle.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+
+  Remarks:
+    A 32kB block erases about as fast as a 4kB sector, so sectors are only
+    erased up to the first block boundary.  Up to a block past the end of
+    the image may be erased.
+ ***************************************************************************/
+static void _WriteErase(void)
+{
+    if ((mpfsWrite.dwEraseAddr & (SPI_FLASH_BLOCK_SIZE - 1)) == 0u) {
+        SPIFlashStartEraseBlock(mpfsWrite.dwEraseAddr);
+        mpfsWrite.dwEraseAddr += SPI_FLASH_BLOCK_SIZE;
+    } else {
+        SPIFlashStartEraseSector(mpfsWrite.dwEraseAddr);
+        mpfsWrite.dwEraseAddr += SPI_FLASH_SECTOR_SIZE;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static uint16_t _CRC16(uint16_t wCRC, uint8_t *vData, uint16_t wLen)
+
+  Description:
+    Adds an array to a CRC-16-CCITT, four bits at a time.
+
+  Precondition:
+    None
+
+  Parameters:
+    wCRC - the CRC so far, 0xffff to start
+    vData - the array of bytes
+    wLen - how many bytes to add
+
+  Returns:
+    The updated CRC
+ ***************************************************************************/
+static uint16_t _CRC16(uint16_t wCRC, uint8_t *vData, uint16_t wLen)
+{
+    static ROM uint16_t wTable[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+    };
+
+    while (wLen--) {
+        wCRC = (wCRC << 4) ^ wTable[(wCRC >> 12) ^ (*vData >> 4)];
+        wCRC = (wCRC << 4) ^ wTable[(wCRC >> 12) ^ (*vData & 0x0f)];
+        vData++;
+    }
+
+    return wCRC;
+}
+#endif
+
+/*****************************************************************************
+  Function:
+    bool MPFSPutEnd(bool final)
 
   Description:
     Finalizes an MPFS writing operation.
@@ -895,20 +1131,37 @@ uint16_t MPFSPutArray(MPFS_HANDLE hMPFS, uint8_t * cData, uint16_t wLen)
         this function locally.
 
   Returns:
-    None
+    true if the data was written, false if the SPI Flash does not hold the
+    data put.  The image is then made invalid.
  ***************************************************************************/
 #if defined(MPFS_USE_EEPROM) || defined(MPFS_USE_SPI_FLASH)
-void MPFSPutEnd(bool final)
+bool MPFSPutEnd(bool final)
 {
+    bool isWritten;
+
     isMPFSLocked = false;
+    isWritten = true;
 
 #if defined(MPFS_USE_EEPROM)
     XEEEndWrite();
     while (XEEIsBusy());
+#else
+    // Program the data still buffered
+    while (mpfsWrite.dwProgAddr != mpfsWrite.dwFillAddr)
+        _WritePump(true);
+    while (SPIFlashIsBusy());
+
+    // Compare the data read back with the data put
+    if (mpfsWrite.wOutCRC != mpfsWrite.wInCRC) {
+        SPIFlashEraseSector(MPFS_HEAD);
+        isWritten = false;
+    }
 #endif
 
     if (final)
         _Validate();
+
+    return isWritten;
 }
 #endif
 
@@ -934,20 +1187,233 @@ void MPFSPutEnd(bool final)
     None
 
   Remarks:
-    The FAT record will be stored in fatCache.
+    The FAT record will be stored in fatCache, and kept in fatRecent
+    until MPFS_FAT_CACHE_SIZE other records have been read.
  ***************************************************************************/
 static void _LoadFATRecord(uint16_t fatID)
 {
+    uint8_t i;
+
     if (fatID == fatCacheID || fatID >= numFiles)
         return;
 
+    // Use a recently read copy if there is one
+    for (i = 0; i < MPFS_FAT_CACHE_SIZE; i++) {
+        if (fatRecent[i].fatID == fatID) {
+            memcpy((void *) &fatCache, (void *) &fatRecent[i].rec, sizeof (MPFS_FAT_RECORD));
+            fatCacheID = fatID;
+            fatRecentSlot = i;
+            return;
+        }
+    }
+
     // Read the FAT record to the cache
     MPFSStubs[0].bytesRem = 22;
     MPFSStubs[0].addr = 8 + numFiles * 2 + fatID * 22;
     MPFSGetArray(0, (uint8_t *) & fatCache, 22);
     fatCacheID = fatID;
+
+    // Keep a copy in place of the oldest one
+    fatRecentSlot = fatRecentNext;
+    if (++fatRecentNext == MPFS_FAT_CACHE_SIZE)
+        fatRecentNext = 0;
+    memcpy((void *) &fatRecent[fatRecentSlot].rec, (void *) &fatCache, sizeof (MPFS_FAT_RECORD));
+    fatRecent[fatRecentSlot].fatID = fatID;
+    fatRecent[fatRecentSlot].isNamed = false;
+}
+
+/*****************************************************************************
+  Function:
+    static uint16_t _ReadNameHash(uint16_t fatID)
+
+  Description:
+    Reads the name hash of a file from the hash table of the image.
+
+  Precondition:
+    None
+
+  Parameters:
+    fatID - the ID of the file, less than numFiles
+
+  Returns:
+    The name hash of the file.
+ ***************************************************************************/
+static uint16_t _ReadNameHash(uint16_t fatID)
+{
+    uint16_t nameHash;
+
+    MPFSStubs[0].addr = 8 + fatID * 2;
+    MPFSStubs[0].bytesRem = 2;
+    MPFSGetArray(0, (uint8_t *) & nameHash, 2);
+    return nameHash;
+}
+
+/*****************************************************************************
+  Function:
+    static uint16_t _FindNameHash(uint16_t nameHash, uint16_t fatID)
+
+  Description:
+    Finds the next file whose name hash matches.  When the hashes of the
+    image are sorted, the first match is found by a binary search and the
+    following ones are next to it.  Otherwise the hashes are checked one
+    by one, reading 8 at a time for performance.
+
+  Precondition:
+    None
+
+  Parameters:
+    nameHash - the name hash to look for
+    fatID - the ID of the first file to check, 0 to start a new search
+
+  Returns:
+    The ID of the first file at or after fatID with a matching hash, or
+    numFiles if there is none.
+ ***************************************************************************/
+static uint16_t _FindNameHash(uint16_t nameHash, uint16_t fatID)
+{
+    uint16_t hashCache[8];
+    uint16_t lo, hi, mid;
+    uint8_t i;
+
+    if (isHashSorted) {
+        if (fatID == 0u) {
+            // Find the first hash not lower than nameHash
+            for (lo = 0, hi = numFiles; lo < hi;) {
+                mid = lo + (hi - lo) / 2;
+                if (_ReadNameHash(mid) < nameHash)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            fatID = lo;
+        }
+
+        if (fatID < numFiles && _ReadNameHash(fatID) == nameHash)
+            return fatID;
+        return numFiles;
+    }
+
+    for (i = 8; fatID < numFiles; fatID++, i++) {
+        // For new block of 8, read in data
+        if (i == 8u) {
+            MPFSStubs[0].addr = 8 + fatID * 2;
+            MPFSStubs[0].bytesRem = 16;
+            MPFSGetArray(0, (uint8_t *) hashCache, 16);
+            i = 0;
+        }
+
+        if (hashCache[i] == nameHash)
+            return fatID;
+    }
+    return numFiles;
+}
+
+/*****************************************************************************
+  Function:
+    static bool _FindRecentName(uint16_t nameHash)
+
+  Description:
+    Looks for a recently opened file with a matching name hash, and loads
+    its FAT record if there is one.
+
+  Precondition:
+    None
+
+  Parameters:
+    nameHash - the name hash to look for
+
+  Returns:
+    true if a FAT record was loaded in fatCache, false otherwise.
+
+  Remarks:
+    The file name still has to be compared, since the hash may also match
+    another file.
+ ***************************************************************************/
+static bool _FindRecentName(uint16_t nameHash)
+{
+    uint8_t i;
+
+    for (i = 0; i < MPFS_FAT_CACHE_SIZE; i++) {
+        if (fatRecent[i].isNamed && fatRecent[i].nameHash == nameHash) {
+            _LoadFATRecord(fatRecent[i].fatID);
+            return true;
+        }
+    }
+    return false;
 }
 
+/*****************************************************************************
+  Function:
+    static bool _CompareName(uint8_t *cFile)
+
+  Description:
+    Compares a file name with the name of the file in fatCache.
+
+  Precondition:
+    The FAT record of the file is loaded in fatCache.
+
+  Parameters:
+    cFile - a null terminated file name
+
+  Returns:
+    true if the names match, false otherwise.
+ ***************************************************************************/
+static bool _CompareName(uint8_t *cFile)
+{
+    uint8_t nameCache[16];
+    uint8_t i, len;
+
+    MPFSStubs[0].addr = fatCache.string;
+    MPFSStubs[0].bytesRem = 255;
+
+    // Compare the filename, reading 16 bytes at a time for performance
+    do {
+        len = MPFSGetArray(0, nameCache, sizeof (nameCache));
+        for (i = 0; i < len; i++, cFile++) {
+            if (*cFile != nameCache[i])
+                return false;
+            if (*cFile == '\0')
+                return true;
+        }
+    } while (len == sizeof (nameCache));
+
+    return false;
+}
+
+/*****************************************************************************
+  Function:
+    static bool _CompareNameROM(ROM uint8_t *cFile)
+
+  Description:
+    Compares a file name in ROM with the name of the file in fatCache.
+
+  Remarks:
+    This function is only needed on PIC18, see _CompareName().
+ ***************************************************************************/
+#if defined(__XC8)
+static bool _CompareNameROM(ROM uint8_t *cFile)
+{
+    uint8_t nameCache[16];
+    uint8_t i, len;
+
+    MPFSStubs[0].addr = fatCache.string;
+    MPFSStubs[0].bytesRem = 255;
+
+    // Compare the filename, reading 16 bytes at a time for performance
+    do {
+        len = MPFSGetArray(0, nameCache, sizeof (nameCache));
+        for (i = 0; i < len; i++, cFile++) {
+            if (*cFile != nameCache[i])
+                return false;
+            if (*cFile == '\0')
+                return true;
+        }
+    } while (len == sizeof (nameCache));
+
+    return false;
+}
+#endif
+
 /*****************************************************************************
   Function:
     uint32_t MPFSGetTimestamp(MPFS_HANDLE hMPFS)
@@ -1268,6 +1734,9 @@ uint16_t MPFSGetID(MPFS_HANDLE hMPFS)
  ***************************************************************************/
 static void _Validate(void)
 {
+    uint16_t hashCache[8];
+    uint16_t i, prevHash;
+
     // If this function causes an Address Error Exception on 16-bit
     // platforms with code stored in internal Flash, make sure your
     // compiler memory model settings are correct.
@@ -1280,11 +1749,32 @@ static void _Validate(void)
     // Validate the image and update numFiles
     MPFSStubs[0].addr = 0;
     MPFSStubs[0].bytesRem = 8;
-    MPFSGetArray(0, (uint8_t *) & fatCache, 6);
-    if (!memcmppgm2ram((void *) &fatCache, (ROM void *) "MPFS\x02\x01", 6))
+    MPFSGetArray(0, (uint8_t *) hashCache, 6);
+    if (!memcmppgm2ram((void *) hashCache, (ROM void *) "MPFS\x02\x01", 6))
         MPFSGetArray(0, (uint8_t *) & numFiles, 2);
     else
         numFiles = 0;
+
+    // Images from older builders don't have their hashes sorted
+    isHashSorted = true;
+    for (i = 0, prevHash = 0; i < numFiles; i++) {
+        if ((i & 0x07) == 0u) {
+            MPFSStubs[0].addr = 8 + i * 2;
+            MPFSStubs[0].bytesRem = 16;
+            MPFSGetArray(0, (uint8_t *) hashCache, 16);
+        }
+        if (hashCache[i & 0x07] < prevHash) {
+            isHashSorted = false;
+            break;
+        }
+        prevHash = hashCache[i & 0x07];
+    }
+
+    // Forget the FAT records of the previous image
     fatCacheID = MPFS_INVALID_FAT;
+    for (i = 0; i < MPFS_FAT_CACHE_SIZE; i++) {
+        fatRecent[i].fatID = MPFS_INVALID_FAT;
+        fatRecent[i].isNamed = false;
+    }
 }
 #endif // #if defined(STACK_USE_MPFS2)
@@ -60,12 +60,31 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #endif
 #endif
 
+#if defined(MPFS_USE_SPI_FLASH)
+// Size of each of the two buffers through which MPFSPutArray() writes the
+// image to SPI Flash, a power of 2 up to SPI_FLASH_PROGRAM_PAGE
+#if !defined(MPFS_WRITE_BUFFER_SIZE)
+#if defined(__XC8)
+#define MPFS_WRITE_BUFFER_SIZE  (64u)
+#else
+#define MPFS_WRITE_BUFFER_SIZE  (256u)
+#endif
+#endif
+#endif
+
+// Number of recently used FAT records kept in RAM, so that the files served
+// most often are opened without searching the image
+#if !defined(MPFS_FAT_CACHE_SIZE)
+#define MPFS_FAT_CACHE_SIZE   (4u)
+#endif
+
 /****************************************************************************
   Section:
     Type Definitions
  ***************************************************************************/
 #define MPFS2_FLAG_ISZIPPED  ((uint16_t)0x0001) // Indicates a file is compressed with GZIP compression
 #define MPFS2_FLAG_HASINDEX  ((uint16_t)0x0002) // Indicates a file has an associated index of dynamic variables
+#define MPFS2_FLAG_MAXAGE    ((uint16_t)0x0004) // Indicates the microtime field holds the Cache-Control max-age (sec) set by the image builder
 #define MPFS_INVALID         (0xffffffffu) // Indicates a position pointer is invalid
 #define MPFS_INVALID_FAT     (0xffffu) // Indicates an invalid FAT cache
 #define MPFS_INVALID_HANDLE  (0xffu) // Indicates that a handle is not valid
@@ -124,8 +143,9 @@ extern uint32_t ReadProgramMemory(uint32_t address);
 #endif
 
 MPFS_HANDLE MPFSFormat(void);
-void MPFSPutEnd(bool final);
+bool MPFSPutEnd(bool final);
 uint16_t MPFSPutArray(MPFS_HANDLE hMPFS, uint8_t * cData, uint16_t wLen);
+uint16_t MPFSIsPutReady(MPFS_HANDLE hMPFS);
 
 uint32_t MPFSGetTimestamp(MPFS_HANDLE hMPFS);
 uint32_t MPFSGetMicrotime(MPFS_HANDLE hMPFS);
@@ -67,8 +67,10 @@ uint8_t rsaData[SSL_RSA_CLIENT_SIZE / 8]; // Temporary space to store PKCS forma
 
 uint8_t eData[4]; // Temporary space to store E for encryption
 
+#if !RSA_USE_MONTGOMERY
 static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n);
 #endif
+#endif
 
 #if defined(STACK_USE_RSA_DECRYPT)
 BIGINT_ROM P; // BigInt to hold RSA prime P
@@ -81,7 +83,11 @@ extern ROM BIGINT_DATA_TYPE SSL_P[RSA_PRIME_WORDS], SSL_Q[RSA_PRIME_WORDS];
 extern ROM BIGINT_DATA_TYPE SSL_dP[RSA_PRIME_WORDS], SSL_dQ[RSA_PRIME_WORDS];
 extern ROM BIGINT_DATA_TYPE SSL_qInv[RSA_PRIME_WORDS];
 
-#if defined(__XC8)
+#if RSA_USE_MONTGOMERY
+static BIGINT_DATA_TYPE rsaWindowData[RSA_WINDOW_SIZE][RSA_PRIME_WORDS]; // Odd powers of the message for decryption
+static BIGINT rsaWindow[RSA_WINDOW_SIZE]; // BigInts to hold x, x^3, x^5... in Montgomery form
+#define _RSAModExpROM(y,x,e,n)  _RSAModExp(y,x,e,n,rsaWindow,RSA_WINDOW_BITS)
+#elif defined(__XC8)
 static bool _RSAModExpROM(BIGINT * y, BIGINT * x, BIGINT_ROM * e, BIGINT_ROM * n);
 #else
 static bool _RSAModExp(BIGINT * y, BIGINT * x, BIGINT * e, BIGINT * n);
@@ -90,6 +96,13 @@ static bool _RSAModExp(BIGINT * y, BIGINT * x, BIGINT * e, BIGINT * n);
 
 #endif
 
+#if RSA_USE_MONTGOMERY
+static BIGINT montTmp; // BigInt to hold Montgomery products, one word longer than the modulus
+
+static void _RSAToMontgomery(BIGINT *y, BIGINT *x, BIGINT *n);
+static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n, BIGINT *window, uint8_t windowBits);
+#endif
+
 #if defined(__XC8) && (SSL_RSA_CLIENT_SIZE > 1024)
 #error "SSL_RSA_CLIENT_SIZE greater than 1024 bits not supported on the PIC18"
 #endif
@@ -126,6 +139,13 @@ uint8_t rsaTemp[SSL_RSA_CLIENT_SIZE / 4]; // Temporary data storage space for en
  ***************************************************************************/
 void RSAInit(void)
 {
+#if defined(STACK_USE_RSA_DECRYPT) && RSA_USE_MONTGOMERY
+    uint8_t i;
+
+    for (i = 0; i < RSA_WINDOW_SIZE; i++)
+        BigInt(&rsaWindow[i], rsaWindowData[i], RSA_PRIME_WORDS);
+#endif
+
 #if defined(STACK_USE_RSA_DECRYPT)
     BigIntROM(&P, (ROM BIGINT_DATA_TYPE *) SSL_P, RSA_PRIME_WORDS);
     BigIntROM(&Q, (ROM BIGINT_DATA_TYPE *) SSL_Q, RSA_PRIME_WORDS);
@@ -457,7 +477,12 @@ RSA_STATUS RSAStep(void)
 
     case SM_RSA_ENCRYPT:
         // Call ModExp until complete
+#if RSA_USE_MONTGOMERY
+        // Public exponents have few bits, so X is the only power kept
+        if (_RSAModExp(&Y, &X, &E, &N, &X, 1)) { // Calculation is finished
+#else
         if (_RSAModExp(&Y, &X, &E, &N)) { // Calculation is finished
+#endif
             // Swap endian-ness if needed
             if (outputFormat == RSA_BIG_ENDIAN)
                 BigIntSwapEndianness(&Y);
@@ -497,7 +522,7 @@ RSA_STATUS RSAStep(void)
     case SM_RSA_DECRYPT_FINISH:
         // Almost done...finalize the CRT math
 
-        if (BigIntCompare(&m1, &m2) > 0) { // if(m1 > m2)
+        if (BigIntCompare(&m1, &m2) >= 0) { // if(m1 >= m2)
             // m1 = m1 - m2
             BigIntSubtract(&m1, &m2);
 
@@ -596,7 +621,7 @@ RSA_STATUS RSAStep(void)
     decryption capabilities are required.  All other platforms use
     the non-ROM variant.
  ***************************************************************************/
-#if defined(__XC8) && defined(STACK_USE_RSA_DECRYPT)
+#if defined(__XC8) && defined(STACK_USE_RSA_DECRYPT) && !RSA_USE_MONTGOMERY
 
 static bool _RSAModExpROM(BIGINT *y, BIGINT *x, BIGINT_ROM *e, BIGINT_ROM *n)
 {
@@ -772,7 +797,7 @@ static bool _RSAModExpROM(BIGINT *y, BIGINT *x, BIGINT_ROM *e, BIGINT_ROM *n)
     This function is not required on 8-bit platforms that do not need
     encryption support.
  ***************************************************************************/
-#if defined(STACK_USE_RSA_ENCRYPT) || (defined(STACK_USE_RSA_DECRYPT) && !defined(__XC8))
+#if (defined(STACK_USE_RSA_ENCRYPT) || (defined(STACK_USE_RSA_DECRYPT) && !defined(__XC8))) && !RSA_USE_MONTGOMERY
 static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n)
 {
     static uint8_t *pe = NULL, *pend = NULL;
@@ -921,4 +946,162 @@ static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n)
 }
 #endif
 
+/*****************************************************************************
+  Function:
+    static void _RSAToMontgomery(BIGINT *y, BIGINT *x, BIGINT *n)
+
+  Summary:
+    Converts a number to Montgomery form, y = x * R % n
+
+  Description:
+    R is 2^BIGINT_DATA_SIZE to the power of the number of significant words
+    in n, as used by BigIntMontgomeryMultiply().  x is shifted up by that
+    many words in tmp, then reduced by n.
+
+  Precondition:
+    RSA has already been initialized and RSABeginUsage has returned true.
+
+  Parameters:
+    y - where the result should be stored, may be x
+    x - the number to convert, of any size
+    n - the modulus
+
+  Return Values:
+    None
+ ***************************************************************************/
+#if RSA_USE_MONTGOMERY
+static void _RSAToMontgomery(BIGINT *y, BIGINT *x, BIGINT *n)
+{
+    BIGINT shifted;
+
+    BigIntZero(&tmp);
+    BigInt(&shifted, tmp.ptrLSB + BigIntMagnitude(n) + 1, BigIntMagnitude(x) + 1);
+    BigIntCopy(&shifted, x);
+    tmp.bMSBValid = 0;
+    BigIntMod(&tmp, n);
+    BigIntCopy(y, &tmp);
+}
+
+/*****************************************************************************
+  Function:
+    static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n,
+                            BIGINT *window, uint8_t windowBits)
+
+  Summary:
+    Performs the base RSA operation y = x^e % n
+
+  Description:
+    This function solves y = x^e % n, the fundamental RSA calculation, with
+    Montgomery multiplications so that no division is needed after each
+    product.  The exponent is scanned from its most significant bit with
+    a sliding window: up to windowBits bits ending with a 1 are taken at
+    once, and y is multiplied by the matching odd power of x from the
+    window table.  With 4 bit windows, a k bit exponent takes about k/5
+    multiplications besides the squarings, instead of k/2.
+
+    The first call converts x and computes the window table, then each
+    call processes one window or one 0 bit, allowing the function to
+    operate in a co-operative multi-tasking environment.
+
+  Precondition:
+    RSA has already been initialized and RSABeginUsage has returned true.
+
+  Parameters:
+    y - where the result should be stored
+    x - the message value, left unmodified unless it is window
+    e - the exponent
+    n - the modulus, odd
+    window - 2^(windowBits-1) BigInts of the size of n for the odd powers
+             of x, may be x itself when windowBits is 1
+    windowBits - the number of exponent bits taken at once
+
+  Return Values:
+    true - the operation is complete
+    false - more bits remain to be processed
+ ***************************************************************************/
+static bool _RSAModExp(BIGINT *y, BIGINT *x, BIGINT *e, BIGINT *n, BIGINT *window, uint8_t windowBits)
+{
+    static uint16_t bitsLeft = 0;
+    static BIGINT_DATA_TYPE nInv;
+    static bool isFirstWindow;
+    BIGINT one;
+    BIGINT_DATA_TYPE oneData;
+    uint16_t low, i;
+    uint8_t val;
+
+    // Bit i of the exponent
+#define expBit(i)   ((((uint8_t *) e->ptrLSB)[(i) >> 3] >> ((i) & 7u)) & 1u)
+
+    // Determine if this is a new computation
+    if (bitsLeft == 0u) {
+        // Find the most significant bit of e
+        bitsLeft = (BigIntMagnitude(e) + 1) * BIGINT_DATA_SIZE;
+        while (bitsLeft != 0u && !expBit(bitsLeft - 1))
+            bitsLeft--;
+
+        // Handle special case where e is zero (result y should be 1)
+        if (bitsLeft == 0u) {
+            BigIntZero(y);
+            *(y->ptrLSB) = 0x01;
+            return true;
+        }
+
+        nInv = BigIntMontgomeryInverse(n);
+        BigInt(&montTmp, (BIGINT_DATA_TYPE *) rsaTemp, BigIntMagnitude(n) + 2);
+
+        // window[0] = x, window[i] = window[i-1] * x^2
+        _RSAToMontgomery(&window[0], x, n);
+        if (windowBits > 1u) {
+            BigIntMontgomeryMultiply(&window[0], &window[0], n, nInv, &montTmp);
+            BigIntCopy(y, &montTmp);
+            for (i = 1; i < (1u << (windowBits - 1u)); i++) {
+                BigIntMontgomeryMultiply(&window[i - 1], y, n, nInv, &montTmp);
+                BigIntCopy(&window[i], &montTmp);
+            }
+        }
+
+        isFirstWindow = true;
+        return false;
+    }
+
+    bitsLeft--;
+    if (!expBit(bitsLeft)) { // A 0 bit only squares y
+        BigIntMontgomeryMultiply(y, y, n, nInv, &montTmp);
+        BigIntCopy(y, &montTmp);
+    } else {
+        // Take up to windowBits bits, ending with a 1
+        low = (bitsLeft + 1u > windowBits) ? bitsLeft + 1u - windowBits : 0u;
+        while (!expBit(low))
+            low++;
+        for (val = 0, i = bitsLeft + 1u; i-- > low;)
+            val = (val << 1) | expBit(i);
+
+        if (isFirstWindow) { // y = 1, so y = x^val
+            BigIntCopy(y, &window[val >> 1]);
+            isFirstWindow = false;
+        } else { // y = y^(2^bits) * x^val
+            for (i = low; i <= bitsLeft; i++) {
+                BigIntMontgomeryMultiply(y, y, n, nInv, &montTmp);
+                BigIntCopy(y, &montTmp);
+            }
+            BigIntMontgomeryMultiply(y, &window[val >> 1], n, nInv, &montTmp);
+            BigIntCopy(y, &montTmp);
+        }
+        bitsLeft = low;
+    }
+
+    if (bitsLeft != 0u)
+        return false;
+
+    // Convert y back from Montgomery form, y = y * 1 / R
+    oneData = 1;
+    BigInt(&one, &oneData, 1);
+    BigIntMontgomeryMultiply(y, &one, n, nInv, &montTmp);
+    BigIntCopy(y, &montTmp);
+    return true;
+
+#undef expBit
+}
+#endif
+
 #endif // #if (defined(STACK_USE_SSL_SERVER) || defined(STACK_USE_SSL_CLIENT)) && !defined(ENC100_INTERFACE_MODE)
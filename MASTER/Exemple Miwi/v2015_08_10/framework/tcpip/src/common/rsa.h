@@ -44,6 +44,25 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define RSA_KEY_WORDS  (SSL_RSA_KEY_SIZE/BIGINT_DATA_SIZE) // Represents the number of words in a key
 #define RSA_PRIME_WORDS  (SSL_RSA_KEY_SIZE/BIGINT_DATA_SIZE/2) // Represents the number of words in an RSA prime
 
+// 1 to exponentiate with Montgomery multiplications in C, 0 to multiply
+// and reduce with the big_int_helper assembly for each bit.  The PIC18
+// keeps the assembly, its 8-bit multiplications are slower in C.
+#if !defined(RSA_USE_MONTGOMERY)
+#if defined(__XC8)
+#define RSA_USE_MONTGOMERY  0
+#else
+#define RSA_USE_MONTGOMERY  1
+#endif
+#endif
+
+// Exponent bits taken at once by decryption with RSA_USE_MONTGOMERY, which
+// keeps 2^(RSA_WINDOW_BITS-1) odd powers of the message of RSA_PRIME_WORDS
+// each in RAM.  Encryption exponents are short and use a single bit.
+#if !defined(RSA_WINDOW_BITS)
+#define RSA_WINDOW_BITS     (4u)
+#endif
+#define RSA_WINDOW_SIZE     (1u << (RSA_WINDOW_BITS - 1u))
+
 /****************************************************************************
   Section:
     State Machines and Status Codes
@@ -120,6 +139,9 @@ void RSASetN(uint8_t * data, RSA_DATA_FORMAT format);
 #define BI_USE_MULTIPLY
 #define BI_USE_SQUARE
 #define BI_USE_COPY
+#if RSA_USE_MONTGOMERY
+#define BI_USE_MONTGOMERY
+#endif
 #endif
 
 #if defined(STACK_USE_RSA_DECRYPT)
@@ -133,6 +155,9 @@ void RSASetN(uint8_t * data, RSA_DATA_FORMAT format);
 #define BI_USE_ADD
 #define BI_USE_SUBTRACT
 #define BI_USE_COPY
+#if RSA_USE_MONTGOMERY
+#define BI_USE_MONTGOMERY
+#endif
 
 #if defined(__XC8)
 #define BI_USE_CONSTRUCTOR_ROM
@@ -133,6 +133,7 @@ static union {
 
 static void _SendCmd(uint8_t cmd);
 static void _WaitWhileBusy(void);
+static void _StartErase(uint8_t vOpcode, uint32_t dwAddr);
 //static void _GetStatus(void);
 
 /*****************************************************************************
@@ -535,6 +536,7 @@ void SPIFlashWriteArray(uint8_t * vData, uint16_t wLen)
     bool isStarted;
     uint8_t vOpcode;
     uint8_t i;
+    uint16_t wChunk;
 
     // Do nothing if no data to process
     if (wLen == 0u)
@@ -549,6 +551,29 @@ void SPIFlashWriteArray(uint8_t * vData, uint16_t wLen)
     SPIFLASH_SPICON1 = PROPER_SPICON1;
     SPI_ON_BIT = 1;
 
+    // Parts without AAI mode are programmed up to a page at a time
+    if (deviceCaps.bits.bPageProgram) {
+        while (wLen) {
+            if ((dwWriteAddr & SPI_FLASH_SECTOR_MASK) == 0u)
+                SPIFlashEraseSector(dwWriteAddr);
+
+            wChunk = SPI_FLASH_PROGRAM_PAGE - (uint16_t) (dwWriteAddr & (SPI_FLASH_PROGRAM_PAGE - 1));
+            if (wChunk > wLen)
+                wChunk = wLen;
+            SPIFlashStartWritePage(dwWriteAddr, vData, wChunk);
+            _WaitWhileBusy();
+
+            vData += wChunk;
+            wLen -= wChunk;
+        }
+
+        // Restore SPI state
+        SPI_ON_BIT = 0;
+        SPIFLASH_SPICON1 = SPICON1Save;
+        SPI_ON_BIT = vSPIONSave;
+        return;
+    }
+
     // If starting at an odd address, write a single byte
     if ((dwWriteAddr & 0x01) && wLen) {
         SPIFlashWrite(*vData);
@@ -576,20 +601,9 @@ void SPIFlashWriteArray(uint8_t * vData, uint16_t wLen)
             _SendCmd(WREN);
 
             // Select appropriate programming opcode.  The WRITE_WORD_STREAM
-            // mode is the default if neither of these flags are set.
+            // mode is the default if this flag is not set.
             if (deviceCaps.bits.bWriteByteStream)
                 vOpcode = WRITE_BYTE_STREAM;
-            else if (deviceCaps.bits.bPageProgram) {
-                // Note: Writing one byte at a time is extremely slow (ex: ~667
-                // bytes/second write speed on SST SST25VF064C).  You can
-                // improve this by over a couple of orders of magnitude by
-                // writing a function to write full pages of up to 256 bytes at
-                // a time.  This is implemented this way only because I don't
-                // have an SST25VF064C handy to test with right now. -HS
-                while (wLen--)
-                    SPIFlashWrite(*vData++);
-                return;
-            }
 
             // Activate the chip select
             SPIFLASH_CS_IO = 0;
@@ -685,6 +699,111 @@ void SPIFlashWriteArray(uint8_t * vData, uint16_t wLen)
     memory parts.
  ***************************************************************************/
 void SPIFlashEraseSector(uint32_t dwAddr)
+{
+    uint8_t vSPIONSave;
+#if defined(__XC8)
+    uint8_t SPICON1Save;
+#elif defined(__XC16)
+    uint16_t SPICON1Save;
+#else
+    uint32_t SPICON1Save;
+#endif
+
+    SPIFlashStartEraseSector(dwAddr);
+
+    // Save SPI state (clock speed)
+    SPICON1Save = SPIFLASH_SPICON1;
+    vSPIONSave = SPI_ON_BIT;
+
+    // Configure SPI
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = PROPER_SPICON1;
+    SPI_ON_BIT = 1;
+
+    // Wait for erase to complete
+    _WaitWhileBusy();
+
+    // Restore SPI state
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = SPICON1Save;
+    SPI_ON_BIT = vSPIONSave;
+}
+
+/*****************************************************************************
+  Function:
+    void SPIFlashStartEraseSector(uint32_t dwAddr)
+
+  Summary:
+    Starts the erase of a sector.
+
+  Description:
+    This function starts the erase of a sector in the Flash part and
+    returns without waiting for it, so that the application can receive the
+    data to write in the meantime.  Poll SPIFlashIsBusy to know when the
+    sector is erased.
+
+  Precondition:
+    SPIFlashInit has been called, and SPIFlashIsBusy returns false.
+
+  Parameters:
+    dwAddr - The address of the sector to be erased.
+
+  Returns:
+    None
+ ***************************************************************************/
+void SPIFlashStartEraseSector(uint32_t dwAddr)
+{
+    _StartErase(ERASE_4K, dwAddr);
+}
+
+/*****************************************************************************
+  Function:
+    void SPIFlashStartEraseBlock(uint32_t dwAddr)
+
+  Summary:
+    Starts the erase of a 32kB block.
+
+  Description:
+    This function starts the erase of a SPI_FLASH_BLOCK_SIZE block and
+    returns without waiting for it, like SPIFlashStartEraseSector.  On SST25
+    parts, a block takes about as long to erase as a sector.
+
+  Precondition:
+    SPIFlashInit has been called, and SPIFlashIsBusy returns false.
+
+  Parameters:
+    dwAddr - The address of the block to be erased.
+
+  Returns:
+    None
+ ***************************************************************************/
+void SPIFlashStartEraseBlock(uint32_t dwAddr)
+{
+    _StartErase(ERASE_32K, dwAddr);
+}
+
+/*****************************************************************************
+  Function:
+    static void _StartErase(uint8_t vOpcode, uint32_t dwAddr)
+
+  Summary:
+    Sends an erase command.
+
+  Description:
+    This function sends an erase command with its address, the part
+    erasing once the chip select is released.
+
+  Precondition:
+    SPIFlashInit has been called.
+
+  Parameters:
+    vOpcode - ERASE_4K or ERASE_32K
+    dwAddr - The address of the sector or block to be erased.
+
+  Returns:
+    None
+ ***************************************************************************/
+static void _StartErase(uint8_t vOpcode, uint32_t dwAddr)
 {
     volatile uint8_t Dummy;
     uint8_t vSPIONSave;
@@ -713,7 +832,7 @@ void SPIFlashEraseSector(uint32_t dwAddr)
     ClearSPIDoneFlag();
 
     // Issue ERASE command with address
-    SPIFLASH_SSPBUF = ERASE_4K;
+    SPIFLASH_SSPBUF = vOpcode;
     WaitForDataByte();
     Dummy = SPIFLASH_SSPBUF;
 
@@ -732,8 +851,180 @@ void SPIFlashEraseSector(uint32_t dwAddr)
     // Deactivate chip select to perform the erase
     SPIFLASH_CS_IO = 1;
 
-    // Wait for erase to complete
-    _WaitWhileBusy();
+    // Restore SPI state
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = SPICON1Save;
+    SPI_ON_BIT = vSPIONSave;
+}
+
+/*****************************************************************************
+  Function:
+    void SPIFlashStartWritePage(uint32_t dwAddr, uint8_t *vData, uint16_t wLen)
+
+  Summary:
+    Starts writing an array of bytes to erased memory.
+
+  Description:
+    This function writes an array of bytes to the SPI Flash part without
+    erasing any sector.  Parts with a page program opcode get the whole
+    array in one command, and the function returns while the page is being
+    programmed.  AAI parts are written a word or a byte at a time, the
+    function returning once the array is written.  Poll SPIFlashIsBusy
+    before the next erase or write.  Subsequent calls to SPIFlashWrite or
+    SPIFlashWriteArray continue after the array.
+
+  Precondition:
+    SPIFlashInit has been called, SPIFlashIsBusy returns false, and the
+    memory from dwAddr to dwAddr + wLen is erased.
+
+  Parameters:
+    dwAddr - Address where the writing will begin
+    vData - The array to write
+    wLen - The length of the data to be written, the array must not cross
+           a SPI_FLASH_PROGRAM_PAGE boundary
+
+  Returns:
+    None
+ ***************************************************************************/
+void SPIFlashStartWritePage(uint32_t dwAddr, uint8_t *vData, uint16_t wLen)
+{
+    volatile uint8_t Dummy;
+    uint8_t vSPIONSave;
+#if defined(__XC8)
+    uint8_t SPICON1Save;
+#elif defined(__XC16)
+    uint16_t SPICON1Save;
+#else
+    uint32_t SPICON1Save;
+#endif
+    bool isStarted;
+    uint8_t vOpcode;
+    uint8_t i;
+
+    dwWriteAddr = dwAddr;
+
+    // Do nothing if no data to process
+    if (wLen == 0u)
+        return;
+
+    // Save SPI state (clock speed)
+    SPICON1Save = SPIFLASH_SPICON1;
+    vSPIONSave = SPI_ON_BIT;
+
+    // Configure SPI
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = PROPER_SPICON1;
+    SPI_ON_BIT = 1;
+
+    if (deviceCaps.bits.bPageProgram) {
+        // Enable writing
+        _SendCmd(WREN);
+
+        // Activate the chip select
+        SPIFLASH_CS_IO = 0;
+        ClearSPIDoneFlag();
+
+        // Issue WRITE command with address
+        SPIFLASH_SSPBUF = WRITE;
+        WaitForDataByte();
+        Dummy = SPIFLASH_SSPBUF;
+
+        SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[2];
+        WaitForDataByte();
+        Dummy = SPIFLASH_SSPBUF;
+
+        SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[1];
+        WaitForDataByte();
+        Dummy = SPIFLASH_SSPBUF;
+
+        SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[0];
+        WaitForDataByte();
+        Dummy = SPIFLASH_SSPBUF;
+
+        // Send the page
+        dwWriteAddr += wLen;
+        while (wLen--) {
+            SPIFLASH_SSPBUF = *vData++;
+            WaitForDataByte();
+            Dummy = SPIFLASH_SSPBUF;
+        }
+
+        // Deactivate chip select to program the page
+        SPIFLASH_CS_IO = 1;
+    } else {
+        // If starting at an odd address, write a single byte
+        if (dwWriteAddr & 0x01) {
+            SPIFlashWrite(*vData);
+            vData++;
+            wLen--;
+        }
+
+        vOpcode = WRITE_WORD_STREAM;
+        if (deviceCaps.bits.bWriteByteStream)
+            vOpcode = WRITE_BYTE_STREAM;
+
+        isStarted = false;
+
+        // Loop over all remaining WORDs, or BYTEs for the AAI byte parts
+        while (wLen > 1u) {
+            // Activate the chip select
+            if (isStarted) {
+                _WaitWhileBusy();
+                SPIFLASH_CS_IO = 0;
+                ClearSPIDoneFlag();
+
+                // Issue the WRITE_STREAM command for continuation
+                SPIFLASH_SSPBUF = vOpcode;
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+            } else {
+                _SendCmd(WREN);
+                SPIFLASH_CS_IO = 0;
+                ClearSPIDoneFlag();
+
+                // Issue WRITE_xxx_STREAM command with address
+                SPIFLASH_SSPBUF = vOpcode;
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+
+                SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[2];
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+
+                SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[1];
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+
+                SPIFLASH_SSPBUF = ((uint8_t *) & dwWriteAddr)[0];
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+
+                isStarted = true;
+            }
+
+            // Write a byte or two
+            for (i = 0; i <= deviceCaps.bits.bWriteWordStream; i++) {
+                SPIFLASH_SSPBUF = *vData++;
+                dwWriteAddr++;
+                wLen--;
+                WaitForDataByte();
+                Dummy = SPIFLASH_SSPBUF;
+            }
+
+            // Release the chip select to begin the write
+            SPIFLASH_CS_IO = 1;
+        }
+
+        // Wait for write to complete, then exit AAI mode
+        if (isStarted) {
+            _WaitWhileBusy();
+            _SendCmd(WRDI);
+        }
+
+        // If a byte remains, write the odd address
+        if (wLen)
+            SPIFlashWrite(*vData);
+    }
 
     // Restore SPI state
     SPI_ON_BIT = 0;
@@ -741,6 +1032,73 @@ void SPIFlashEraseSector(uint32_t dwAddr)
     SPI_ON_BIT = vSPIONSave;
 }
 
+/*****************************************************************************
+  Function:
+    bool SPIFlashIsBusy(void)
+
+  Summary:
+    Tells if the part is still erasing or programming.
+
+  Description:
+    This function reads the BUSY bit of the status register once.  It is
+    used after SPIFlashStartEraseSector and SPIFlashStartWritePage, which
+    return before the part is done.
+
+  Precondition:
+    SPIFlashInit has been called.
+
+  Parameters:
+    None
+
+  Returns:
+    true if an erase or a write is in progress, else false
+ ***************************************************************************/
+bool SPIFlashIsBusy(void)
+{
+    volatile uint8_t Dummy;
+    uint8_t vSPIONSave;
+#if defined(__XC8)
+    uint8_t SPICON1Save;
+#elif defined(__XC16)
+    uint16_t SPICON1Save;
+#else
+    uint32_t SPICON1Save;
+#endif
+
+    // Save SPI state (clock speed)
+    SPICON1Save = SPIFLASH_SPICON1;
+    vSPIONSave = SPI_ON_BIT;
+
+    // Configure SPI
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = PROPER_SPICON1;
+    SPI_ON_BIT = 1;
+
+    // Activate chip select
+    SPIFLASH_CS_IO = 0;
+    ClearSPIDoneFlag();
+
+    // Send Read Status Register instruction
+    SPIFLASH_SSPBUF = RDSR;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Read the status once
+    SPIFLASH_SSPBUF = 0x00;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Deactivate chip select
+    SPIFLASH_CS_IO = 1;
+
+    // Restore SPI state
+    SPI_ON_BIT = 0;
+    SPIFLASH_SPICON1 = SPICON1Save;
+    SPI_ON_BIT = vSPIONSave;
+
+    return (Dummy & BUSY) != 0u;
+}
+
 /*****************************************************************************
   Function:
     static void _SendCmd(uint8_t cmd)
@@ -44,7 +44,9 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define __SPIFLASH_H_
 
 #define SPI_FLASH_SECTOR_SIZE  (4096ul)
+#define SPI_FLASH_BLOCK_SIZE   (32768ul) // See SPIFlashStartEraseBlock
 #define SPI_FLASH_PAGE_SIZE    (0ul) // SST has no page boundary requirements
+#define SPI_FLASH_PROGRAM_PAGE (256ul) // Page of the parts without AAI mode, see SPIFlashStartWritePage
 
 #define SPI_FLASH_SECTOR_MASK  (SPI_FLASH_SECTOR_SIZE - 1)
 
@@ -55,6 +57,10 @@ void SPIFlashBeginWrite(uint32_t dwAddr);
 void SPIFlashWrite(uint8_t vData);
 void SPIFlashWriteArray(uint8_t *vData, uint16_t wLen);
 void SPIFlashEraseSector(uint32_t dwAddr);
+void SPIFlashStartEraseSector(uint32_t dwAddr);
+void SPIFlashStartEraseBlock(uint32_t dwAddr);
+void SPIFlashStartWritePage(uint32_t dwAddr, uint8_t *vData, uint16_t wLen);
+bool SPIFlashIsBusy(void);
 #endif
 
 // If the above funtions are called without SPIFLASH_CS_TRIS's definition, it
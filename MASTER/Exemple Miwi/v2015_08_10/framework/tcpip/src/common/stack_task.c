@@ -69,6 +69,25 @@ static SM_STACK smStack;
 
 NODE_INFO remoteNode;
 
+// Events waiting for each STACK_MODULE.  A module is called when they are
+// not 0, and clears them when it runs.
+static uint8_t stackEvents[STACK_MODULE_COUNT];
+
+// Module timers: expiry time of each one, mask of the running ones, and the
+// earliest expiry, so that a pass with no expired timer costs one compare
+static uint32_t stackTimers[STACK_MODULE_COUNT];
+static uint16_t stackTimerMask;
+static uint32_t stackNextTimer;
+
+// The last StackTask() call left frames in the MAC
+static bool stackRxPending;
+
+// How often StackTask() checks the link to restart the DHCP client after the
+// cable was unplugged
+#if !defined(STACK_LINK_CHECK_INTERVAL)
+#define STACK_LINK_CHECK_INTERVAL (TICK_SECOND / 4)
+#endif
+
 #if defined (WF_CS_TRIS) && defined (STACK_USE_DHCP_CLIENT)
 bool g_DhcpRenew = false;
 extern void SetDhcpProgressState(void);
@@ -79,6 +98,10 @@ uint32_t g_DhcpRetryTimer = 0;
 extern void GenericTCPServerInit(void);
 #endif
 
+static bool StackDispatch(STACK_MODULE module);
+static void StackCheckTimers(void);
+static void StackSignalUDP(void);
+
 /*********************************************************************
  * Function:        void StackInit(void)
  *
@@ -99,6 +122,11 @@ void StackInit(void)
     static bool once = false;
     smStack = SM_STACK_IDLE;
 
+    // The modules start their timers or ask to run from their Init functions
+    memset((void *) stackEvents, 0x00, sizeof (stackEvents));
+    stackTimerMask = 0;
+    stackRxPending = false;
+
 #if defined(STACK_USE_IP_GLEANING) || defined(STACK_USE_DHCP_CLIENT)
     /*
      * If DHCP or IP Gleaning is enabled,
@@ -213,6 +241,10 @@ void StackInit(void)
  *                  This function must be called periodically to
  *                  ensure timely responses.
  *
+ *                  The modules listed in STACK_MODULE are only called
+ *                  when they were signaled or their timer expired, see
+ *                  StackSignal() and StackSetTimer().
+ *
  ********************************************************************/
 void StackTask(void)
 {
@@ -221,6 +253,8 @@ void StackTask(void)
     uint8_t cFrameType;
     uint8_t cIPFrameType;
 
+    StackCheckTimers();
+
 #if defined( WF_CS_TRIS )
     // This task performs low-level MAC processing specific to the MRF24W
     MACProcess();
@@ -234,7 +268,7 @@ void StackTask(void)
     // if it is not enabled. But in case some one wants to disable
     // DHCP module at run-time, remember to not clear our IP
     // address if link is removed.
-    if (AppConfig.Flags.bIsDHCPEnabled) {
+    if (StackDispatch(STACK_MODULE_DHCP_CLIENT) && AppConfig.Flags.bIsDHCPEnabled) {
         if (g_DhcpRenew == true) {
             g_DhcpRenew = false;
             AppConfig.MyIPAddr.Val = AppConfig.DefaultIPAddr.Val;
@@ -259,6 +293,10 @@ void StackTask(void)
             AppConfig.Flags.bInConfigMode = false;
             g_DhcpRetryTimer = 0;
         }
+
+        // Come back for the retry if DHCPTask() does not before
+        if (g_DhcpRetryTimer)
+            StackSetTimer(STACK_MODULE_DHCP_CLIENT, g_DhcpRetryTimer + TICKS_PER_SECOND * 8);
     }
 #endif // STACK_USE_DHCP_CLIENT
 
@@ -269,7 +307,7 @@ void StackTask(void)
     // if it is not enabled. But in case some one wants to disable
     // DHCP module at run-time, remember to not clear our IP
     // address if link is removed.
-    if (AppConfig.Flags.bIsDHCPEnabled) {
+    if (StackDispatch(STACK_MODULE_DHCP_CLIENT) && AppConfig.Flags.bIsDHCPEnabled) {
         static bool bLastLinkState = false;
         bool bCurrentLinkState;
 
@@ -292,6 +330,9 @@ void StackTask(void)
 
         if (DHCPIsBound(0))
             AppConfig.Flags.bInConfigMode = false;
+
+        // Check the link again later, even if the DHCP client waits longer
+        StackSetTimer(STACK_MODULE_DHCP_CLIENT, TickGet() + STACK_LINK_CHECK_INTERVAL);
     }
 #endif
 
@@ -301,11 +342,19 @@ void StackTask(void)
 
 #if defined(STACK_USE_TCP)
     // Perform all TCP time related tasks (retransmit, send acknowledge, close connection, etc)
-    TCPTick();
+    if (StackDispatch(STACK_MODULE_TCP))
+        TCPTick();
 #endif
 
 #if defined(STACK_USE_UDP)
-    UDPTask();
+    if (StackDispatch(STACK_MODULE_UDP))
+        UDPTask();
+#endif
+
+    // Give the RX buffer space of the datagrams that the applications
+    // read back to the MAC before fetching new packets
+#if defined(STACK_USE_UDP)
+    UDPReleaseRx();
 #endif
 
     // Process as many incomming packets as we can
@@ -315,17 +364,12 @@ void StackTask(void)
         RandomAdd(remoteNode.MACAddr.v[5]);
 #endif
 
-        // We are about to fetch a new packet, make sure that the
-        // UDP module knows that any old RX data it has laying
-        // around will now be gone.
-#if defined(STACK_USE_UDP)
-        UDPDiscard();
-#endif
-
         // Fetch a packet (throws old one away, if not thrown away
         // yet)
-        if (!MACGetHeader(&remoteNode.MACAddr, &cFrameType))
+        if (!MACGetHeader(&remoteNode.MACAddr, &cFrameType)) {
+            stackRxPending = false;
             break;
+        }
 
         // When using a WiFi module, filter out all incoming packets that have
         // the same source MAC address as our own MAC address.  This is to
@@ -386,9 +430,15 @@ void StackTask(void)
 
 #if defined(STACK_USE_UDP)
             if (cIPFrameType == IP_PROT_UDP) {
-                // Stop processing packets if we came upon a UDP frame with application data in it
-                if (UDPProcess(&remoteNode, &tempLocalIP, dataCount))
-                    return;
+                // Stop processing packets if we came upon a UDP frame with
+                // application data in it and no other one can be queued
+                if (UDPProcess(&remoteNode, &tempLocalIP, dataCount)) {
+                    StackSignalUDP();
+                    if (UDPIsRxQueueFull()) {
+                        stackRxPending = true;
+                        return;
+                    }
+                }
             }
 #endif
 
@@ -411,11 +461,22 @@ void StackTask(void)
  * Note:            This function must be called periodically to
  *                  ensure timely responses.
  *
+ *                  When STACK_IDLE_HOOK(ticks) is defined, it is called
+ *                  at the end with the result of StackGetIdleTime() if
+ *                  that is not 0.
+ *
  ********************************************************************/
 void StackApplications(void)
 {
+#if defined(STACK_USE_BERKELEY_API)
+    // The timeout of BerkeleySelect() or BerkeleyPoll() only ends the idle
+    // time, the application calls them again
+    StackDispatch(STACK_MODULE_BERKELEY);
+#endif
+
 #if defined(STACK_USE_HTTP2_SERVER)
-    HTTPServer();
+    if (StackDispatch(STACK_MODULE_HTTP))
+        HTTPServer();
 #endif
 
 #if defined(STACK_USE_FTP_SERVER) && defined(STACK_USE_MPFS2)
@@ -423,11 +484,13 @@ void StackApplications(void)
 #endif
 
 #if defined(STACK_USE_ANNOUNCE)
-    DiscoveryTask();
+    if (StackDispatch(STACK_MODULE_ANNOUNCE))
+        DiscoveryTask();
 #endif
 
 #if defined(STACK_USE_NBNS)
-    NBNSTask();
+    if (StackDispatch(STACK_MODULE_NBNS))
+        NBNSTask();
 #endif
 
 #if defined(STACK_USE_DHCP_SERVER)
@@ -451,7 +514,8 @@ void StackApplications(void)
 #endif
 
 #if defined(STACK_USE_SNTP_CLIENT)
-    SNTPClient();
+    if (StackDispatch(STACK_MODULE_SNTP))
+        SNTPClient();
 #endif
 
 #if defined(STACK_USE_UDP_PERFORMANCE_TEST)
@@ -463,18 +527,261 @@ void StackApplications(void)
 #endif
 
 #if defined(STACK_USE_SMTP_CLIENT)
-    SMTPTask();
+    if (StackDispatch(STACK_MODULE_SMTP))
+        SMTPTask();
 #endif
 
 #if defined(STACK_USE_UART2TCP_BRIDGE)
     UART2TCPBridgeTask();
 #endif
+
+#if defined(STACK_IDLE_HOOK)
+    // Let the application sleep until the next timer or interrupt
+    {
+        uint32_t dwIdleTime = StackGetIdleTime();
+
+        if (dwIdleTime != 0u)
+            STACK_IDLE_HOOK(dwIdleTime);
+    }
+#endif
+}
+
+/*********************************************************************
+ * Function:        void StackSignal(STACK_MODULE module, uint8_t events)
+ *
+ * PreCondition:    None
+ *
+ * Input:           module - Module to wake up
+ *                  events - Any of the STACK_EVENT_* flags
+ *
+ * Output:          The module is called on the next StackTask() or
+ *                  StackApplications() pass.
+ *
+ * Side Effects:    None
+ *
+ * Note:            A module still busy after its pass calls this with
+ *                  STACK_EVENT_BUSY to be called again.
+ *
+ ********************************************************************/
+void StackSignal(STACK_MODULE module, uint8_t events)
+{
+    stackEvents[module] |= events;
+}
+
+/*********************************************************************
+ * Function:        void StackSignalSocket(uint8_t hSocket,
+ *                                         uint8_t vSocketPurpose,
+ *                                         uint8_t events)
+ *
+ * PreCondition:    None
+ *
+ * Input:           hSocket - The TCP socket
+ *                  vSocketPurpose - TCP_PURPOSE_* of the socket
+ *                  events - Any of the STACK_EVENT_* flags
+ *
+ * Output:          The module owning the sockets of this purpose, if it
+ *                  is event-driven, is woken up.  A Berkeley socket is
+ *                  marked for BerkeleySelect() and BerkeleyPoll().
+ *
+ * Side Effects:    None
+ *
+ * Note:            Called by the TCP module when a segment changed the
+ *                  state of a socket.  The other TCP applications are
+ *                  called on every pass.
+ *
+ ********************************************************************/
+void StackSignalSocket(uint8_t hSocket, uint8_t vSocketPurpose, uint8_t events)
+{
+#if defined(STACK_USE_HTTP2_SERVER)
+    if (vSocketPurpose == TCP_PURPOSE_HTTP_SERVER)
+        StackSignal(STACK_MODULE_HTTP, events);
+#endif
+
+#if defined(STACK_USE_BERKELEY_API)
+    if (vSocketPurpose == TCP_PURPOSE_BERKELEY_SERVER || vSocketPurpose == TCP_PURPOSE_BERKELEY_CLIENT)
+        BerkeleySocketSignal(SOCK_STREAM, hSocket);
+#endif
+}
+
+/*********************************************************************
+ * Function:        void StackSetTimer(STACK_MODULE module, uint32_t dwTime)
+ *
+ * PreCondition:    None
+ *
+ * Input:           module - Module to wake up
+ *                  dwTime - TickGet() value at which to wake it up
+ *
+ * Output:          The module gets STACK_EVENT_TIMER when TickGet()
+ *                  reaches dwTime.
+ *
+ * Side Effects:    None
+ *
+ * Note:            If the timer of the module is already running, the
+ *                  earliest of the two times is kept.  A module with
+ *                  several timeouts may set them all, and one which woke
+ *                  up early sets its timer again.
+ *
+ ********************************************************************/
+void StackSetTimer(STACK_MODULE module, uint32_t dwTime)
+{
+    uint16_t wBit = 1u << module;
+
+    if (stackTimerMask & wBit) {
+        if ((int32_t) (dwTime - stackTimers[module]) >= 0)
+            return;
+    }
+
+    stackTimers[module] = dwTime;
+    if (stackTimerMask == 0u || (int32_t) (dwTime - stackNextTimer) < 0)
+        stackNextTimer = dwTime;
+    stackTimerMask |= wBit;
+}
+
+/*********************************************************************
+ * Function:        uint32_t StackGetIdleTime(void)
+ *
+ * PreCondition:    StackInit() is already called.
+ *
+ * Input:           None
+ *
+ * Output:          0 if an event-driven module has work to do or the
+ *                  MAC holds frames, else the number of ticks until the
+ *                  next module timer, or STACK_IDLE_FOREVER.
+ *
+ * Side Effects:    None
+ *
+ * Note:            Call after StackApplications().  The modules which
+ *                  are not in STACK_MODULE (FTP, Telnet, ...) and the
+ *                  MAC interrupt must still be able to end the sleep.
+ *
+ ********************************************************************/
+uint32_t StackGetIdleTime(void)
+{
+    uint8_t i;
+    int32_t lWait;
+
+    if (stackRxPending)
+        return 0;
+
+    for (i = 0; i < STACK_MODULE_COUNT; i++) {
+        if (stackEvents[i])
+            return 0;
+    }
+
+    if (stackTimerMask == 0u)
+        return STACK_IDLE_FOREVER;
+
+    lWait = (int32_t) (stackNextTimer - TickGet());
+    return lWait > 0 ? (uint32_t) lWait : 0;
+}
+
+/*********************************************************************
+ * Function:        static bool StackDispatch(STACK_MODULE module)
+ *
+ * PreCondition:    None
+ *
+ * Input:           module - Module about to be called
+ *
+ * Output:          true if the module has events, which are cleared
+ *
+ * Side Effects:    None
+ *
+ * Note:            None
+ *
+ ********************************************************************/
+static bool StackDispatch(STACK_MODULE module)
+{
+    if (stackEvents[module] == 0u)
+        return false;
+
+    stackEvents[module] = 0;
+    return true;
+}
+
+/*********************************************************************
+ * Function:        static void StackCheckTimers(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          Modules with an expired timer get STACK_EVENT_TIMER.
+ *
+ * Side Effects:    None
+ *
+ * Note:            The table is only scanned when the earliest timer
+ *                  expired.
+ *
+ ********************************************************************/
+static void StackCheckTimers(void)
+{
+    uint32_t dwNow;
+    uint8_t i;
+    bool bNext;
+
+    if (stackTimerMask == 0u)
+        return;
+
+    dwNow = TickGet();
+    if ((int32_t) (dwNow - stackNextTimer) < 0)
+        return;
+
+    bNext = false;
+    for (i = 0; i < STACK_MODULE_COUNT; i++) {
+        if (!(stackTimerMask & (1u << i)))
+            continue;
+
+        if ((int32_t) (dwNow - stackTimers[i]) >= 0) {
+            stackTimerMask &= ~(1u << i);
+            stackEvents[i] |= STACK_EVENT_TIMER;
+        } else if (!bNext || (int32_t) (stackTimers[i] - stackNextTimer) < 0) {
+            stackNextTimer = stackTimers[i];
+            bNext = true;
+        }
+    }
+}
+
+/*********************************************************************
+ * Function:        static void StackSignalUDP(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          The event-driven modules reading UDP datagrams are
+ *                  woken up.
+ *
+ * Side Effects:    None
+ *
+ * Note:            A datagram that no module reads is dropped after
+ *                  UDP_RX_TIMEOUT, so every module which may own the
+ *                  socket runs.
+ *
+ ********************************************************************/
+static void StackSignalUDP(void)
+{
+#if defined(STACK_USE_DHCP_CLIENT)
+    StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_RX);
+#endif
+
+#if defined(STACK_USE_SNTP_CLIENT)
+    StackSignal(STACK_MODULE_SNTP, STACK_EVENT_RX);
+#endif
+
+#if defined(STACK_USE_NBNS)
+    StackSignal(STACK_MODULE_NBNS, STACK_EVENT_RX);
+#endif
+
+#if defined(STACK_USE_ANNOUNCE)
+    StackSignal(STACK_MODULE_ANNOUNCE, STACK_EVENT_RX);
+#endif
 }
 
 #if defined(WF_CS_TRIS) && defined(STACK_USE_DHCP_CLIENT)
 void RenewDhcp(void)
 {
     g_DhcpRenew = true;
+    StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_APP);
     SetDhcpProgressState();
 }
 #endif
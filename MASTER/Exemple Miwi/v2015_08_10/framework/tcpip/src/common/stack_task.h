@@ -73,6 +73,21 @@ typedef struct __attribute__((__packed__)) {
 }
 NODE_INFO;
 
+#if defined(WF_CS_TRIS) && defined(EZ_CONFIG_STORE) && defined(__XC32)
+// Number of WPA PSKs kept in AppConfig by WF_ConvPassphraseToKey(), so that
+// connecting again to a known network skips the PBKDF2 derivation.  That
+// function is only built for the PIC32.
+#if !defined(WF_PSK_CACHE_SIZE)
+#define WF_PSK_CACHE_SIZE   (2u)
+#endif
+
+typedef struct __attribute__((__packed__)) {
+    uint8_t tag[8]; // First bytes of SHA1(SSID length, SSID, passphrase)
+    uint8_t psk[32]; // PSK derived from that SSID and passphrase
+}
+WF_PSK_CACHE_ENTRY;
+#endif
+
 // Application-dependent structure used to contain address information
 typedef struct __attribute__((__packed__)) appConfigStruct {
     IP_ADDR MyIPAddr; // IP address
@@ -107,6 +122,10 @@ typedef struct __attribute__((__packed__)) appConfigStruct {
 #endif
 #if defined(EZ_CONFIG_STORE) // WLAN configuration data stored to NVM
     uint8_t saveSecurityInfo; // Save 32-byte PSK
+#if defined(__XC32)
+    WF_PSK_CACHE_ENTRY PskCache[WF_PSK_CACHE_SIZE]; // Recently derived PSKs
+    uint8_t PskCacheNext; // Next entry of PskCache to replace
+#endif
 #endif
 #endif
 }
@@ -116,8 +135,38 @@ APP_CONFIG;
 extern APP_CONFIG AppConfig;
 #endif
 
+// Modules that StackTask() and StackApplications() call only when they
+// have work to do.  The other modules are still called on every pass.
+typedef enum {
+    STACK_MODULE_TCP = 0u,
+    STACK_MODULE_UDP,
+    STACK_MODULE_DHCP_CLIENT,
+    STACK_MODULE_HTTP,
+    STACK_MODULE_SNTP,
+    STACK_MODULE_SMTP,
+    STACK_MODULE_NBNS,
+    STACK_MODULE_ANNOUNCE,
+    STACK_MODULE_BERKELEY, // Only for the timeouts of BerkeleySelect() and BerkeleyPoll()
+
+    STACK_MODULE_COUNT
+} STACK_MODULE;
+
+// Reasons for which a module is ready to run
+#define STACK_EVENT_RX      0x01u   // Data, a connection or a reset arrived on one of its sockets
+#define STACK_EVENT_TX      0x02u   // TX space was freed, or TX work is waiting
+#define STACK_EVENT_TIMER   0x04u   // Its timer expired
+#define STACK_EVENT_APP     0x08u   // The application called one of its functions
+#define STACK_EVENT_BUSY    0x10u   // It did not finish its work on the last pass
+
+// Value of StackGetIdleTime() when no module timer is running
+#define STACK_IDLE_FOREVER  (0xFFFFFFFFul)
+
 void StackInit(void);
 void StackTask(void);
 void StackApplications(void);
+void StackSignal(STACK_MODULE module, uint8_t events);
+void StackSignalSocket(uint8_t hSocket, uint8_t vSocketPurpose, uint8_t events);
+void StackSetTimer(STACK_MODULE module, uint32_t dwTime);
+uint32_t StackGetIdleTime(void);
 
 #endif
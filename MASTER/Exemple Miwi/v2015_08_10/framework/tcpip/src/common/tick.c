@@ -41,6 +41,10 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 
 #include "tcpip/tcpip.h"
 
+#if defined(__linux__)
+#include <time.h>
+#endif
+
 // Internal counter to store Ticks.  This variable is incremented in an ISR and
 // therefore must be marked volatile to prevent the compiler optimizer from
 // reordering code to use this value in the main context while interrupts are
@@ -76,7 +80,9 @@ static void GetTickCopy(void);
  ***************************************************************************/
 void TickInit(void)
 {
-#if defined(__XC8)
+#if defined(__linux__)
+    // CLOCK_MONOTONIC is always running, nothing to configure
+#elif defined(__XC8)
     // Use Timer0 for 8 bit processors
     // Initialize the time
     TMR0H = 0;
@@ -139,7 +145,20 @@ static void GetTickCopy(void)
 {
     // Perform an Interrupt safe and synchronized read of the 48-bit
     // tick value
-#if defined(__XC8)
+#if defined(__linux__)
+    struct timespec ts;
+    uint64_t qwTicks;
+
+    // One tick per microsecond, see TICKS_PER_SECOND
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    qwTicks = (uint64_t) ts.tv_sec * 1000000ull + (uint64_t) ts.tv_nsec / 1000ull;
+    vTickReading[0] = (uint8_t) qwTicks;
+    vTickReading[1] = (uint8_t) (qwTicks >> 8);
+    vTickReading[2] = (uint8_t) (qwTicks >> 16);
+    vTickReading[3] = (uint8_t) (qwTicks >> 24);
+    vTickReading[4] = (uint8_t) (qwTicks >> 32);
+    vTickReading[5] = (uint8_t) (qwTicks >> 40);
+#elif defined(__XC8)
     do {
         INTCONbits.TMR0IE = 1; // Enable interrupt
         Nop();
@@ -380,7 +399,12 @@ uint32_t TickConvertToMilliseconds(uint32_t dwTickValue)
   Returns:
     None
  ***************************************************************************/
-#if defined(__XC8)
+#if defined(__linux__)
+void TickUpdate(void)
+{
+    // No timer interrupt, GetTickCopy() reads CLOCK_MONOTONIC
+}
+#elif defined(__XC8)
 void TickUpdate(void)
 {
     if (INTCONbits.TMR0IF) {
@@ -52,7 +52,11 @@ typedef __attribute__((__deprecated__)) uint32_t TICK;
 // For this definition, the Timer must be initialized to use a 1:256 prescalar
 // in tick.c.  If using a 32kHz watch crystal as the time base, modify the
 // tick.c file to use no prescalar.
+#if defined(__linux__)
+#define TICKS_PER_SECOND  (1000000ull) // CLOCK_MONOTONIC in microseconds (tick.c)
+#else
 #define TICKS_PER_SECOND  ((SYS_CLK_FrequencyPeripheralGet()+128ull)/256ull) // Internal core clock drives timer with 1:256 prescaler
+#endif
 //#define TICKS_PER_SECOND  (32768ul) // 32kHz crystal drives timer with no scalar
 
 #if defined(__XC8)
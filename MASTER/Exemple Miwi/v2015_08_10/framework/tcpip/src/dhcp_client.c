@@ -196,6 +196,7 @@ void DHCPInit(uint8_t vInterface)
     DHCPClient.flags.val = 0;
     DHCPClient.flags.bits.bUseUnicastMode = true; // This flag toggles before use, so this statement actually means to start out using broadcast mode.
     DHCPClient.flags.bits.bEvent = true;
+    StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_APP);
 }
 
 /*****************************************************************************
@@ -268,6 +269,7 @@ void DHCPEnable(uint8_t vInterface)
         DHCPClient.dwBaseTime = DHCP_BASE_TIMEOUT;
         DHCPClient.smState = SM_DHCP_GET_SOCKET;
         DHCPClient.flags.bits.bIsBound = false;
+        StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_APP);
     }
 }
 
@@ -689,6 +691,37 @@ void DHCPTask(void)
             }
             break;
         }
+
+        // Tell StackTask() when to call again.  Replies wake the module up
+        // through UDP.
+        switch (DHCPClient.smState) {
+        case SM_DHCP_DISABLED:
+            break;
+
+        case SM_DHCP_SEND_DISCOVERY:
+            // Poll the link slowly while unlinked
+            if (!MACIsLinked())
+                StackSetTimer(STACK_MODULE_DHCP_CLIENT, TickGet() + TICK_SECOND / 4);
+            else
+                StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_BUSY);
+            break;
+
+        case SM_DHCP_GET_OFFER:
+        case SM_DHCP_GET_REQUEST_ACK:
+        case SM_DHCP_GET_RENEW_ACK:
+        case SM_DHCP_GET_RENEW_ACK2:
+        case SM_DHCP_GET_RENEW_ACK3:
+            StackSetTimer(STACK_MODULE_DHCP_CLIENT, DHCPClient.dwTimer + 1);
+            break;
+
+        case SM_DHCP_BOUND:
+            StackSetTimer(STACK_MODULE_DHCP_CLIENT, DHCPClient.dwTimer + TICK_SECOND);
+            break;
+
+        default:
+            StackSignal(STACK_MODULE_DHCP_CLIENT, STACK_EVENT_BUSY);
+            break;
+        }
     }
 }
 
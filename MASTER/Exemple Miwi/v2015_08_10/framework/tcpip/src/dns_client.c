@@ -11,7 +11,8 @@
      -Reference: RFC 1035
 
   Description:
-    Domain Name System (DNS) Client
+    Domain Name System (DNS) Client, with several queries in flight and a
+    cache of the answers (positive and negative) honoring their TTL.
 
  *******************************************************************************/
 
@@ -40,6 +41,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
  *******************************************************************************/
 //DOM-IGNORE-END
 
+
 #define __DNS_C_
 
 #include "tcpip/tcpip.h"
@@ -52,13 +54,22 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
  ***************************************************************************/
 
 #define DNS_PORT  53u // Default port for DNS resolutions
-#define DNS_TIMEOUT  (TICK_SECOND * 1) // Elapsed time after which a DNS resolution is considered to have timed out
-
-static UDP_SOCKET MySocket = INVALID_UDP_SOCKET; // UDP socket to use for DNS queries
-static uint8_t *DNSHostName; // Host name in RAM to look up
-static ROM uint8_t *DNSHostNameROM; // Host name in ROM to look up
-static uint8_t RecordType; // Record type being queried
-static NODE_INFO ResolvedInfo; // Node information about the resolved node
+#define DNS_TIMEOUT  (TICK_SECOND * 1) // Elapsed time after which a DNS query is considered to have timed out
+#define DNS_ARP_ATTEMPTS  (3u) // ARP requests for a server before switching to the other one
+
+#define DNS_TYPE_SOA  (6u) // Start of authority record, carries the negative caching TTL
+#define DNS_FLAG_RESPONSE  0x80u // QR bit, in the upper byte of the header flags
+#define DNS_RCODE_MASK  0x0Fu // Response code, in the lower byte of the header flags
+#define DNS_RCODE_NO_ERROR  0u
+#define DNS_RCODE_NAME_ERROR  3u // NXDOMAIN
+
+static UDP_SOCKET MySocket = INVALID_UDP_SOCKET; // UDP socket shared by all the queries in flight
+static NODE_INFO ServerInfo; // Primary DNS server IP and the MAC to reach it
+static uint8_t *DNSHostName; // Host name in RAM given to DNSResolve
+static ROM uint8_t *DNSHostNameROM; // Host name in ROM given to DNSResolveROM
+static uint8_t RecordType; // Record type given to DNSResolve
+static DNS_HANDLE hLegacyQuery = DNS_INVALID_HANDLE; // Query behind DNSResolve and DNSIsResolved
+static DNS_STATS Stats;
 
 // Semaphore flags for the DNS module
 static union {
@@ -71,17 +82,54 @@ static union {
     } bits;
 } Flags = {0x00};
 
-// State machine for a DNS query
+// State machine for the MAC address of the primary DNS server
 static enum {
-    DNS_START = 0, // Initial state to reset client state variables
-    DNS_ARP_START_RESOLVE, // Send ARP resolution of DNS server or gateway MAC address
-    DNS_ARP_RESOLVE, // Wait for response to ARP request
-    DNS_OPEN_SOCKET, // Open UDP socket
-    DNS_QUERY, // Send DNS query to DNS server
-    DNS_GET_RESULT, // Wait for response from DNS server
-    DNS_FAIL, // ARP or DNS server not responding
-    DNS_DONE // DNS query is finished
-} smDNS = DNS_DONE;
+    DNS_SERVER_ARP_START = 0, // Send ARP resolution of DNS server or gateway MAC address
+    DNS_SERVER_ARP_RESOLVE, // Wait for response to ARP request
+    DNS_SERVER_READY // ServerInfo can be used to send queries
+} smServer = DNS_SERVER_ARP_START;
+
+static uint32_t ServerARPTime; // Time the last ARP request was sent
+static uint8_t vARPAttemptCount; // ARP requests sent to the current primary server
+
+// State of a query slot
+typedef enum {
+    DNS_QUERY_FREE = 0, // Slot not in use
+    DNS_QUERY_SEND, // Query to send once the server is resolved
+    DNS_QUERY_WAIT, // Wait for response from DNS server
+    DNS_QUERY_DONE // Result is available until DNSQueryRelease
+} DNS_QUERY_STATE;
+
+// A query in flight, matched to the responses by its transaction ID
+typedef struct {
+    uint8_t *HostName; // Host name in RAM, or NULL
+    ROM uint8_t *HostNameROM; // Host name in ROM when HostName is NULL
+    uint32_t NameHash; // DNSHashName() of the host name
+    uint32_t StartTime; // Time the current attempt started
+    IP_ADDR IPAddr; // Resolved address, 0.0.0.0 on error
+    IP_ADDR Server; // Server the last query was sent to
+    TCPIP_UINT16_VAL TransactionID; // Same for all the attempts, so a late answer is still used
+    uint8_t Type; // DNS_TYPE_A or DNS_TYPE_MX
+    uint8_t State; // DNS_QUERY_STATE
+    uint8_t Result; // DNS_RESULT once State is DNS_QUERY_DONE
+    uint8_t Attempts; // Attempts that timed out
+} DNS_QUERY;
+
+// A cached answer.  Names are compared by their 32 bit hash, then by the
+// first DNS_CACHE_NAME_SIZE characters on a match.
+typedef struct {
+    uint32_t NameHash; // DNSHashName() of the host name
+    uint8_t Name[DNS_CACHE_NAME_SIZE]; // Host name in lower case, not terminated when full
+    uint32_t Time; // TickGetDiv256() when the answer was received
+    uint32_t TTL; // Validity of the answer, in TickGetDiv256() units
+    uint32_t LastUsed; // CacheClock at the last hit, for the LRU replacement
+    IP_ADDR IPAddr; // Address, 0.0.0.0 for a negative answer
+    uint8_t Type; // Record type of the query, 0 when the entry is free
+} DNS_CACHE_ENTRY;
+
+static DNS_QUERY Queries[DNS_MAX_QUERIES];
+static DNS_CACHE_ENTRY Cache[DNS_CACHE_ENTRIES];
+static uint32_t CacheClock; // Incremented on each cache hit or update
 
 // Structure for the DNS header
 typedef struct {
@@ -105,13 +153,28 @@ typedef struct {
   Section:
     Function Prototypes
  ***************************************************************************/
+static void DNSTask(void);
+static DNS_HANDLE DNSQueryAlloc(void);
+static void DNSQueryStart(DNS_QUERY *q);
+static void DNSQueryRetry(DNS_QUERY *q);
+static DNS_QUERY *DNSFindQuery(uint16_t TransactionID);
+static bool DNSSendQuery(DNS_QUERY *q);
+static void DNSProcessResponse(void);
+static void DNSFailover(void);
+static bool DNSCacheLookup(DNS_QUERY *q);
+static void DNSCacheAdd(DNS_QUERY *q, uint32_t TTL);
+static uint8_t DNSNameChar(DNS_QUERY *q, uint8_t i);
+static bool DNSCacheNameMatch(DNS_CACHE_ENTRY *entry, DNS_QUERY *q);
+static uint32_t DNSHashName(uint8_t *String);
 static void DNSPutString(uint8_t *String);
 static void DNSDiscardName(void);
 
 #if defined(__XC8)
+static uint32_t DNSHashROMName(ROM uint8_t *String);
 static void DNSPutROMString(ROM uint8_t *String);
 #else
 // Non-ROM alias for C30/C32
+#define DNSHashROMName(a)  DNSHashName((uint8_t *)a)
 #define DNSPutROMString(a)  DNSPutString((uint8_t *)a)
 #endif
 
@@ -123,9 +186,9 @@ static void DNSPutROMString(ROM uint8_t *String);
     DNS module initialization function.
 
   Description:
-    This function does not do anything when the stack is initialized for the
-    first time. The real work it does is to clean DNS semaphore during Wi-Fi
-    Soft AP redirection. So it is actually a re-initialization function.
+    This function empties the query slots and the cache.  During Wi-Fi
+    Soft AP redirection it also cleans the DNS semaphore, so it is
+    actually a re-initialization function.
 
   Precondition:
     Stack is initialized.
@@ -137,16 +200,28 @@ static void DNSPutROMString(ROM uint8_t *String);
     None
 
   Remarks:
-    None
+    The counters returned by DNSGetStats are kept.
 
  ***************************************************************************/
 void DNSInit(void)
 {
+#if defined(WF_CS_TRIS)
     if (AppConfig.hibernateFlag) {
         DNSBeginUsage();
         DNSDiscardName();
         DNSEndUsage();
     }
+#endif
+
+    if (MySocket != INVALID_UDP_SOCKET) {
+        UDPClose(MySocket);
+        MySocket = INVALID_UDP_SOCKET;
+    }
+    hLegacyQuery = DNS_INVALID_HANDLE;
+    smServer = DNS_SERVER_ARP_START;
+    vARPAttemptCount = 0;
+    memset((void *) Queries, 0x00, sizeof (Queries));
+    memset((void *) Cache, 0x00, sizeof (Cache));
 }
 
 /***************************************************************************
@@ -178,6 +253,9 @@ void DNSInit(void)
     Ensure that DNSEndUsage is always called once your application has
     obtained control of the DNS module.  If this is not done, the stack
     will hang for all future applications requiring DNS access.
+
+    The semaphore only guards DNSResolve and DNSIsResolved.  DNSQuery
+    does not need it.
  ***************************************************************************/
 bool DNSBeginUsage(void)
 {
@@ -217,11 +295,8 @@ bool DNSBeginUsage(void)
  ***************************************************************************/
 bool DNSEndUsage(void)
 {
-    if (MySocket != INVALID_UDP_SOCKET) {
-        UDPClose(MySocket);
-        MySocket = INVALID_UDP_SOCKET;
-    }
-    smDNS = DNS_DONE;
+    DNSQueryRelease(hLegacyQuery);
+    hLegacyQuery = DNS_INVALID_HANDLE;
     Flags.bits.DNSInUse = false;
 
     return Flags.bits.AddressValid;
@@ -236,11 +311,12 @@ bool DNSEndUsage(void)
 
   Description:
     This function attempts to resolve a host name to an IP address.  When
-    called, it starts the DNS state machine.  Call DNSIsResolved repeatedly
+    called, it starts a query with DNSQuery.  Call DNSIsResolved repeatedly
     to determine if the resolution is complete.
 
-    Only one DNS resoultion may be executed at a time.  The Hostname must
-    not be modified in memory until the resolution is complete.
+    Only one DNS resoultion may be executed at a time through this
+    function.  The Hostname must not be modified in memory until the
+    resolution is complete.
 
   Precondition:
     DNSBeginUsage returned true on a previous call.
@@ -260,16 +336,16 @@ bool DNSEndUsage(void)
  ***************************************************************************/
 void DNSResolve(uint8_t *Hostname, uint8_t Type)
 {
-    if (StringToIPAddress(Hostname, &ResolvedInfo.IPAddr)) {
+    DNSQueryRelease(hLegacyQuery);
+    DNSHostName = Hostname;
+    DNSHostNameROM = NULL;
+    RecordType = Type;
+    Flags.bits.AddressValid = false;
+
+    // Retried by DNSIsResolved if all the query slots are in use
+    hLegacyQuery = DNSQuery(Hostname, Type);
+    if (hLegacyQuery != DNS_INVALID_HANDLE && Queries[hLegacyQuery].Result == DNS_RES_OK)
         Flags.bits.AddressValid = true;
-        smDNS = DNS_DONE;
-    } else {
-        DNSHostName = Hostname;
-        DNSHostNameROM = NULL;
-        smDNS = DNS_START;
-        RecordType = Type;
-        Flags.bits.AddressValid = false;
-    }
 }
 
 /***************************************************************************
@@ -281,11 +357,12 @@ void DNSResolve(uint8_t *Hostname, uint8_t Type)
 
   Description:
     This function attempts to resolve a host name to an IP address.  When
-    called, it starts the DNS state machine.  Call DNSIsResolved repeatedly
-    to determine if the resolution is complete.
+    called, it starts a query with DNSQueryROM.  Call DNSIsResolved
+    repeatedly to determine if the resolution is complete.
 
-    Only one DNS resoultion may be executed at a time.  The Hostname must
-    not be modified in memory until the resolution is complete.
+    Only one DNS resoultion may be executed at a time through this
+    function.  The Hostname must not be modified in memory until the
+    resolution is complete.
 
   Precondition:
     DNSBeginUsage returned true on a previous call.
@@ -308,16 +385,15 @@ void DNSResolve(uint8_t *Hostname, uint8_t Type)
 #if defined(__XC8)
 void DNSResolveROM(ROM uint8_t *Hostname, uint8_t Type)
 {
-    if (ROMStringToIPAddress(Hostname, &ResolvedInfo.IPAddr)) {
+    DNSQueryRelease(hLegacyQuery);
+    DNSHostName = NULL;
+    DNSHostNameROM = Hostname;
+    RecordType = Type;
+    Flags.bits.AddressValid = false;
+
+    hLegacyQuery = DNSQueryROM(Hostname, Type);
+    if (hLegacyQuery != DNS_INVALID_HANDLE && Queries[hLegacyQuery].Result == DNS_RES_OK)
         Flags.bits.AddressValid = true;
-        smDNS = DNS_DONE;
-    } else {
-        DNSHostName = NULL;
-        DNSHostNameROM = Hostname;
-        smDNS = DNS_START;
-        RecordType = Type;
-        Flags.bits.AddressValid = false;
-    }
 }
 #endif
 
@@ -348,263 +424,1015 @@ void DNSResolveROM(ROM uint8_t *Hostname, uint8_t Type)
  ***************************************************************************/
 bool DNSIsResolved(IP_ADDR *HostIP)
 {
-    static uint32_t StartTime;
-    static TCPIP_UINT16_VAL SentTransactionID __attribute__((persistent));
-    static uint8_t vARPAttemptCount;
-    static uint8_t vDNSAttemptCount;
+    if (hLegacyQuery == DNS_INVALID_HANDLE) {
+        if (DNSHostName)
+            hLegacyQuery = DNSQuery(DNSHostName, RecordType);
+        else
+            hLegacyQuery = DNSQueryROM(DNSHostNameROM, RecordType);
+
+        if (hLegacyQuery == DNS_INVALID_HANDLE)
+            return false;
+    }
+
+    switch (DNSQueryResult(hLegacyQuery, HostIP)) {
+    case DNS_RES_PENDING:
+        return false;
+
+    case DNS_RES_OK:
+        Flags.bits.AddressValid = true;
+        break;
+
+    default:
+        // Return an invalid IP address 0.0.0.0 on any error
+        Flags.bits.AddressValid = false;
+        HostIP->Val = 0x00000000;
+        break;
+    }
+
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    DNS_HANDLE DNSQuery(uint8_t *HostName, uint8_t Type)
+
+  Summary:
+    Starts the resolution of a host name in a query slot of its own.
+
+  Description:
+    Up to DNS_MAX_QUERIES queries can be in flight at the same time,
+    without DNSBeginUsage.  A name found in the cache is resolved at once,
+    including a name already known not to exist.  Otherwise the query is
+    sent to the primary DNS server, and again every DNS_TIMEOUT up to
+    DNS_MAX_ATTEMPTS times, switching to the secondary server when the
+    primary one does not answer.
+
+    A HostName holding an IP address string is resolved without any query.
+
+  Precondition:
+    Stack is initialized.
+
+  Parameters:
+    HostName - A pointer to the null terminated string specifiying the
+        host for which to resolve an IP.  It must not be modified until
+        DNSQueryResult returns something else than DNS_RES_PENDING.
+    Type - DNS_TYPE_A or DNS_TYPE_MX depending on what type of
+        record resolution is desired.
+
+  Returns:
+    Handle to give to DNSQueryResult and DNSQueryRelease, or
+    DNS_INVALID_HANDLE if all the query slots are in use.
+
+  Remarks:
+    The queries share one UDP socket, opened while a query is in flight.
+ ***************************************************************************/
+DNS_HANDLE DNSQuery(uint8_t *HostName, uint8_t Type)
+{
+    DNS_HANDLE hQuery;
+    DNS_QUERY *q;
+
+    hQuery = DNSQueryAlloc();
+    if (hQuery == DNS_INVALID_HANDLE)
+        return DNS_INVALID_HANDLE;
+
+    q = &Queries[hQuery];
+    q->Type = Type;
+    if (StringToIPAddress(HostName, &q->IPAddr)) {
+        q->State = DNS_QUERY_DONE;
+        q->Result = DNS_RES_OK;
+        return hQuery;
+    }
+
+    q->HostName = HostName;
+    q->NameHash = DNSHashName(HostName);
+    DNSQueryStart(q);
+    return hQuery;
+}
+
+/*****************************************************************************
+  Function:
+    DNS_HANDLE DNSQueryROM(ROM uint8_t *HostName, uint8_t Type)
+
+  Summary:
+    Starts the resolution of a host name in a query slot of its own.
+
+  Description:
+    Same as DNSQuery, for a host name in ROM.
+
+  Precondition:
+    Stack is initialized.
+
+  Parameters:
+    HostName - A pointer to the null terminated string specifiying the
+        host for which to resolve an IP.
+    Type - DNS_TYPE_A or DNS_TYPE_MX depending on what type of
+        record resolution is desired.
+
+  Returns:
+    Handle to give to DNSQueryResult and DNSQueryRelease, or
+    DNS_INVALID_HANDLE if all the query slots are in use.
+
+  Remarks:
+    This function is aliased to DNSQuery on non-PIC18 platforms.
+ ***************************************************************************/
+#if defined(__XC8)
+DNS_HANDLE DNSQueryROM(ROM uint8_t *HostName, uint8_t Type)
+{
+    DNS_HANDLE hQuery;
+    DNS_QUERY *q;
+
+    hQuery = DNSQueryAlloc();
+    if (hQuery == DNS_INVALID_HANDLE)
+        return DNS_INVALID_HANDLE;
+
+    q = &Queries[hQuery];
+    q->Type = Type;
+    if (ROMStringToIPAddress(HostName, &q->IPAddr)) {
+        q->State = DNS_QUERY_DONE;
+        q->Result = DNS_RES_OK;
+        return hQuery;
+    }
+
+    q->HostNameROM = HostName;
+    q->NameHash = DNSHashROMName(HostName);
+    DNSQueryStart(q);
+    return hQuery;
+}
+#endif
+
+/*****************************************************************************
+  Function:
+    DNS_RESULT DNSQueryResult(DNS_HANDLE hQuery, IP_ADDR *HostIP)
+
+  Summary:
+    Runs the resolver and gives the state of a query.
+
+  Description:
+    Each call sends the queries that are due and handles one response from
+    the DNS servers, whichever query it belongs to.  Poll it until the
+    result is not DNS_RES_PENDING.  The result stays available until
+    DNSQueryRelease is called.
+
+  Precondition:
+    DNSQuery or DNSQueryROM returned hQuery.
+
+  Parameters:
+    hQuery - Handle of the query
+    HostIP - Receives the resolved address, 0.0.0.0 on error
+
+  Returns:
+    DNS_RES_PENDING, DNS_RES_OK, DNS_RES_NAME_ERROR, DNS_RES_SERVER_ERROR,
+    or DNS_RES_INVALID_HANDLE if hQuery is not in use.
+ ***************************************************************************/
+DNS_RESULT DNSQueryResult(DNS_HANDLE hQuery, IP_ADDR *HostIP)
+{
+    DNS_QUERY *q;
+
+    if (hQuery >= DNS_MAX_QUERIES || Queries[hQuery].State == DNS_QUERY_FREE)
+        return DNS_RES_INVALID_HANDLE;
+
+    q = &Queries[hQuery];
+    if (q->State != DNS_QUERY_DONE) {
+        DNSTask();
+        if (q->State != DNS_QUERY_DONE)
+            return DNS_RES_PENDING;
+    }
+
+    HostIP->Val = q->IPAddr.Val;
+    return (DNS_RESULT) q->Result;
+}
+
+/*****************************************************************************
+  Function:
+    void DNSQueryRelease(DNS_HANDLE hQuery)
+
+  Summary:
+    Frees a query slot.
+
+  Description:
+    Gives the slot back, whether the query is finished or not.  The UDP
+    socket is closed once no query is in flight.
+
+  Precondition:
+    None
+
+  Parameters:
+    hQuery - Handle returned by DNSQuery, or DNS_INVALID_HANDLE
+
+  Returns:
+    None
+ ***************************************************************************/
+void DNSQueryRelease(DNS_HANDLE hQuery)
+{
+    if (hQuery >= DNS_MAX_QUERIES)
+        return;
+
+    Queries[hQuery].State = DNS_QUERY_FREE;
+    DNSTask();
+}
+
+/*****************************************************************************
+  Function:
+    void DNSFlushCache(void)
+
+  Summary:
+    Forgets every cached answer.
+
+  Description:
+    Call it when the DNS servers or the network change, ex: after a new
+    DHCP lease.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+void DNSFlushCache(void)
+{
+    memset((void *) Cache, 0x00, sizeof (Cache));
+}
+
+/*****************************************************************************
+  Function:
+    void DNSGetStats(DNS_STATS *stats)
+
+  Summary:
+    Copies the resolver counters.
+
+  Description:
+    The counters start at 0 on reset and are not cleared by DNSInit.
+    Lookups - CacheHits - NegativeHits gives the queries that needed the
+    network.
+
+  Precondition:
+    None
+
+  Parameters:
+    stats - Receives the counters
+
+  Returns:
+    None
+ ***************************************************************************/
+void DNSGetStats(DNS_STATS *stats)
+{
+    memcpy((void *) stats, (const void *) &Stats, sizeof (Stats));
+}
+
+/*****************************************************************************
+  Function:
+    static void DNSTask(void)
+
+  Summary:
+    Sends the queries that are due and handles the responses.
+
+  Description:
+    Retries the queries that timed out, reads one response from the
+    socket, resolves the MAC address of the primary server and sends the
+    queries waiting for it.  The socket is opened by the first query and
+    closed when no query is in flight.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSTask(void)
+{
+    DNS_QUERY *q;
     uint8_t i;
-    TCPIP_UINT16_VAL w;
-    DNS_HEADER DNSHeader;
-    DNS_ANSWER_HEADER DNSAnswerHeader;
+    bool bActive;
+    bool bSend;
+
+    bActive = false;
+    bSend = false;
+    for (i = 0, q = Queries; i < DNS_MAX_QUERIES; i++, q++) {
+        if (q->State != DNS_QUERY_SEND && q->State != DNS_QUERY_WAIT)
+            continue;
+
+        if (TickGet() - q->StartTime > DNS_TIMEOUT)
+            DNSQueryRetry(q);
+
+        if (q->State == DNS_QUERY_SEND)
+            bSend = true;
+        else if (q->State == DNS_QUERY_WAIT)
+            bActive = true;
+    }
 
-    switch (smDNS) {
-    case DNS_START:
-        vARPAttemptCount = 0;
-        vDNSAttemptCount = 0;
-        // No break;
+    if (!bActive && !bSend) {
+        if (MySocket != INVALID_UDP_SOCKET) {
+            UDPClose(MySocket);
+            MySocket = INVALID_UDP_SOCKET;
+        }
+        return;
+    }
 
-    case DNS_ARP_START_RESOLVE:
+    if (MySocket != INVALID_UDP_SOCKET && UDPIsGetReady(MySocket))
+        DNSProcessResponse();
+
+    if (!bSend)
+        return;
+
+    switch (smServer) {
+    case DNS_SERVER_ARP_START:
         ARPResolve(&AppConfig.PrimaryDNSServer);
         vARPAttemptCount++;
-        StartTime = TickGet();
-        smDNS = DNS_ARP_RESOLVE;
+        ServerARPTime = TickGet();
+        smServer = DNS_SERVER_ARP_RESOLVE;
+        return;
+
+    case DNS_SERVER_ARP_RESOLVE:
+        if (!ARPIsResolved(&AppConfig.PrimaryDNSServer, &ServerInfo.MACAddr)) {
+            if (TickGet() - ServerARPTime > DNS_TIMEOUT) {
+                if (vARPAttemptCount >= DNS_ARP_ATTEMPTS)
+                    DNSFailover();
+                else
+                    smServer = DNS_SERVER_ARP_START;
+            }
+            return;
+        }
+        ServerInfo.IPAddr.Val = AppConfig.PrimaryDNSServer.Val;
+        smServer = DNS_SERVER_READY;
         break;
 
-    case DNS_ARP_RESOLVE:
-        if (!ARPIsResolved(&AppConfig.PrimaryDNSServer, &ResolvedInfo.MACAddr)) {
-            if (TickGet() - StartTime > DNS_TIMEOUT)
-                smDNS = (vARPAttemptCount >= 3u) ? DNS_FAIL : DNS_ARP_START_RESOLVE;
-            break;
+    case DNS_SERVER_READY:
+        // The server may have been changed by DHCP
+        if (ServerInfo.IPAddr.Val != AppConfig.PrimaryDNSServer.Val) {
+            vARPAttemptCount = 0;
+            smServer = DNS_SERVER_ARP_START;
+            return;
         }
-        ResolvedInfo.IPAddr.Val = AppConfig.PrimaryDNSServer.Val;
-        smDNS = DNS_OPEN_SOCKET;
-        // No break: DNS_OPEN_SOCKET is the correct next state
-
-    case DNS_OPEN_SOCKET:
-        //MySocket = UDPOpen(0, &ResolvedInfo, DNS_PORT);
+        break;
+    }
 
-        MySocket = UDPOpenEx((uint32_t) (PTR_BASE) & ResolvedInfo, UDP_OPEN_NODE_INFO, 0, DNS_PORT);
+    if (MySocket == INVALID_UDP_SOCKET) {
+        MySocket = UDPOpenEx((uint32_t) (PTR_BASE) & ServerInfo, UDP_OPEN_NODE_INFO, 0, DNS_PORT);
         if (MySocket == INVALID_UDP_SOCKET)
+            return;
+    }
+
+    for (i = 0, q = Queries; i < DNS_MAX_QUERIES; i++, q++) {
+        if (q->State == DNS_QUERY_SEND && !DNSSendQuery(q))
             break;
+    }
+}
 
-        smDNS = DNS_QUERY;
-        // No need to break, we can immediately start resolution
+/*****************************************************************************
+  Function:
+    static DNS_HANDLE DNSQueryAlloc(void)
 
-    case DNS_QUERY:
-        if (!UDPIsPutReady(MySocket))
-            break;
+  Summary:
+    Finds a free query slot and clears it.
 
-        // Put DNS query here
-        SentTransactionID.Val++;
-        UDPPut(SentTransactionID.v[1]); // User chosen transaction ID
-        UDPPut(SentTransactionID.v[0]);
-        UDPPut(0x01); // Standard query with recursion
-        UDPPut(0x00);
-        UDPPut(0x00); // 0x0001 questions
-        UDPPut(0x01);
-        UDPPut(0x00); // 0x0000 answers
-        UDPPut(0x00);
-        UDPPut(0x00); // 0x0000 name server resource records
-        UDPPut(0x00);
-        UDPPut(0x00); // 0x0000 additional records
-        UDPPut(0x00);
-
-        // Put hostname string to resolve
-        if (DNSHostName)
-            DNSPutString(DNSHostName);
-        else
-            DNSPutROMString(DNSHostNameROM);
+  Description:
+    Also counts the lookup in the statistics.
 
-        UDPPut(0x00); // Type: DNS_TYPE_A A (host address) or DNS_TYPE_MX for mail exchange
-        UDPPut(RecordType);
-        UDPPut(0x00); // Class: IN (Internet)
-        UDPPut(0x01);
+  Precondition:
+    None
 
-        UDPFlush();
-        StartTime = TickGet();
-        smDNS = DNS_GET_RESULT;
-        break;
+  Parameters:
+    None
 
-    case DNS_GET_RESULT:
-        if (!UDPIsGetReady(MySocket)) {
-            if (TickGet() - StartTime > DNS_TIMEOUT)
-                smDNS = DNS_FAIL;
-            break;
+  Returns:
+    Index of the slot, or DNS_INVALID_HANDLE if none is free.
+ ***************************************************************************/
+static DNS_HANDLE DNSQueryAlloc(void)
+{
+    DNS_HANDLE hQuery;
+
+    for (hQuery = 0; hQuery < DNS_MAX_QUERIES; hQuery++) {
+        if (Queries[hQuery].State == DNS_QUERY_FREE) {
+            memset((void *) &Queries[hQuery], 0x00, sizeof (DNS_QUERY));
+            Stats.Lookups++;
+            return hQuery;
         }
+    }
 
-        // Retrieve the DNS header and de-big-endian it
-        UDPGet(&DNSHeader.TransactionID.v[1]);
-        UDPGet(&DNSHeader.TransactionID.v[0]);
+    return DNS_INVALID_HANDLE;
+}
+
+/*****************************************************************************
+  Function:
+    static void DNSQueryStart(DNS_QUERY *q)
+
+  Summary:
+    Answers a query from the cache or queues it for sending.
+
+  Description:
+    The transaction ID is random and unique among the queries in flight,
+    so that responses can be matched to their query.
+
+  Precondition:
+    q->NameHash, q->Type and the host name are set.
+
+  Parameters:
+    q - Query to start
+
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSQueryStart(DNS_QUERY *q)
+{
+    if (DNSCacheLookup(q)) {
+        q->State = DNS_QUERY_DONE;
+        return;
+    }
+
+    do {
+        q->TransactionID.Val = LFSRRand();
+    } while (DNSFindQuery(q->TransactionID.Val) != NULL);
+
+    q->StartTime = TickGet();
+    q->State = DNS_QUERY_SEND;
+    DNSTask();
+}
+
+/*****************************************************************************
+  Function:
+    static void DNSQueryRetry(DNS_QUERY *q)
+
+  Summary:
+    Handles a query that timed out or was refused by the server.
+
+  Description:
+    After DNS_MAX_ATTEMPTS the query ends with DNS_RES_SERVER_ERROR.
+    Otherwise it is queued to be sent again, to the secondary server if
+    the primary one was asked the last time.
+
+  Precondition:
+    q is in the DNS_QUERY_SEND or DNS_QUERY_WAIT state.
+
+  Parameters:
+    q - Query to retry
 
-        // Throw this packet away if it isn't in response to our last query
-        if (DNSHeader.TransactionID.Val != SentTransactionID.Val) {
-            UDPDiscard();
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSQueryRetry(DNS_QUERY *q)
+{
+    if (++q->Attempts >= DNS_MAX_ATTEMPTS) {
+        q->IPAddr.Val = 0x00000000;
+        q->Result = DNS_RES_SERVER_ERROR;
+        q->State = DNS_QUERY_DONE;
+        Stats.Failures++;
+        return;
+    }
+
+    if (q->State == DNS_QUERY_WAIT) {
+        Stats.Retransmits++;
+        // Another query may already have switched to the other server
+        if (q->Server.Val == AppConfig.PrimaryDNSServer.Val)
+            DNSFailover();
+    }
+
+    q->StartTime = TickGet();
+    q->State = DNS_QUERY_SEND;
+}
+
+/*****************************************************************************
+  Function:
+    static DNS_QUERY *DNSFindQuery(uint16_t TransactionID)
+
+  Summary:
+    Finds the query in flight with a transaction ID.
+
+  Description:
+    None
+
+  Precondition:
+    None
+
+  Parameters:
+    TransactionID - ID of the response
+
+  Returns:
+    The query, or NULL if no query in flight has this ID.
+ ***************************************************************************/
+static DNS_QUERY *DNSFindQuery(uint16_t TransactionID)
+{
+    DNS_QUERY *q;
+    uint8_t i;
+
+    for (i = 0, q = Queries; i < DNS_MAX_QUERIES; i++, q++) {
+        if ((q->State == DNS_QUERY_SEND || q->State == DNS_QUERY_WAIT) &&
+                q->TransactionID.Val == TransactionID)
+            return q;
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+  Function:
+    static bool DNSSendQuery(DNS_QUERY *q)
+
+  Summary:
+    Sends a query to the primary DNS server.
+
+  Description:
+    The remote node of the shared socket is set back to the server, since
+    the UDP module replaces it with the source of each received packet.
+
+  Precondition:
+    MySocket is open and ServerInfo is resolved.
+
+  Parameters:
+    q - Query to send
+
+  Returns:
+    true if the query was sent, false if the socket is not ready.
+ ***************************************************************************/
+static bool DNSSendQuery(DNS_QUERY *q)
+{
+    memcpy((void *) &UDPSocketInfo[MySocket].remote.remoteNode, (const void *) &ServerInfo, sizeof (ServerInfo));
+    UDPSocketInfo[MySocket].remotePort = DNS_PORT;
+
+    if (!UDPIsPutReady(MySocket))
+        return false;
+
+    // Put DNS query here
+    UDPPut(q->TransactionID.v[1]); // User chosen transaction ID
+    UDPPut(q->TransactionID.v[0]);
+    UDPPut(0x01); // Standard query with recursion
+    UDPPut(0x00);
+    UDPPut(0x00); // 0x0001 questions
+    UDPPut(0x01);
+    UDPPut(0x00); // 0x0000 answers
+    UDPPut(0x00);
+    UDPPut(0x00); // 0x0000 name server resource records
+    UDPPut(0x00);
+    UDPPut(0x00); // 0x0000 additional records
+    UDPPut(0x00);
+
+    // Put hostname string to resolve
+    if (q->HostName)
+        DNSPutString(q->HostName);
+    else
+        DNSPutROMString(q->HostNameROM);
+
+    UDPPut(0x00); // Type: DNS_TYPE_A A (host address) or DNS_TYPE_MX for mail exchange
+    UDPPut(q->Type);
+    UDPPut(0x00); // Class: IN (Internet)
+    UDPPut(0x01);
+
+    UDPFlush();
+    Stats.QueriesSent++;
+    q->Server.Val = ServerInfo.IPAddr.Val;
+    q->StartTime = TickGet();
+    q->State = DNS_QUERY_WAIT;
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    static void DNSProcessResponse(void)
+
+  Summary:
+    Reads a response from the DNS socket and completes its query.
+
+  Description:
+    The first A record of the answer, authority or additional sections is
+    the result, as for an MX query the address of the mail exchanger comes
+    in the additional section.  It is cached for the smallest TTL of the
+    answer records read up to it.
+
+    A name error, or a response without address, completes the query with
+    DNS_RES_NAME_ERROR.  It is cached for the TTL of the SOA record of the
+    authority section (RFC 2308), limited to DNS_NEGATIVE_TTL.  Other
+    response codes are handled as a timeout.
+
+  Precondition:
+    UDPIsGetReady(MySocket) returned non-zero.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSProcessResponse(void)
+{
+    DNS_QUERY *q;
+    DNS_HEADER DNSHeader;
+    DNS_ANSWER_HEADER DNSAnswerHeader;
+    TCPIP_UINT32_VAL Minimum;
+    TCPIP_UINT16_VAL w;
+    IP_ADDR Source;
+    uint32_t TTL;
+    uint32_t NegativeTTL;
+    uint16_t Records;
+    uint16_t i;
+
+    // Retrieve the DNS header and de-big-endian it
+    UDPGet(&DNSHeader.TransactionID.v[1]);
+    UDPGet(&DNSHeader.TransactionID.v[0]);
+    UDPGet(&DNSHeader.Flags.v[1]);
+    UDPGet(&DNSHeader.Flags.v[0]);
+
+    // Throw this packet away if it isn't a response of our servers to a query in flight
+    q = DNSFindQuery(DNSHeader.TransactionID.Val);
+    Source.Val = UDPSocketInfo[MySocket].remote.remoteNode.IPAddr.Val;
+    if (q == NULL || !(DNSHeader.Flags.v[1] & DNS_FLAG_RESPONSE) ||
+            (Source.Val != AppConfig.PrimaryDNSServer.Val && Source.Val != AppConfig.SecondaryDNSServer.Val)) {
+        UDPDiscard();
+        return;
+    }
+
+    switch (DNSHeader.Flags.v[0] & DNS_RCODE_MASK) {
+    case DNS_RCODE_NO_ERROR:
+    case DNS_RCODE_NAME_ERROR:
+        break;
+
+    default:
+        // Server failure or refused query, try again with the other server
+        UDPDiscard();
+        DNSQueryRetry(q);
+        return;
+    }
+
+    UDPGet(&DNSHeader.Questions.v[1]);
+    UDPGet(&DNSHeader.Questions.v[0]);
+    UDPGet(&DNSHeader.Answers.v[1]);
+    UDPGet(&DNSHeader.Answers.v[0]);
+    UDPGet(&DNSHeader.AuthoritativeRecords.v[1]);
+    UDPGet(&DNSHeader.AuthoritativeRecords.v[0]);
+    UDPGet(&DNSHeader.AdditionalRecords.v[1]);
+    UDPGet(&DNSHeader.AdditionalRecords.v[0]);
+
+    // Remove all questions (queries)
+    while (DNSHeader.Questions.Val--) {
+        DNSDiscardName();
+        UDPGet(&w.v[1]); // Question type
+        UDPGet(&w.v[0]);
+        UDPGet(&w.v[1]); // Question class
+        UDPGet(&w.v[0]);
+    }
+
+    TTL = DNS_CACHE_MAX_TTL;
+    NegativeTTL = DNS_NEGATIVE_TTL;
+    q->IPAddr.Val = 0x00000000;
+    Records = DNSHeader.Answers.Val + DNSHeader.AuthoritativeRecords.Val + DNSHeader.AdditionalRecords.Val;
+
+    // Scan through answers, authoritative and additional records
+    for (i = 0; i < Records; i++) {
+        DNSDiscardName(); // Throw away response name
+        UDPGet(&DNSAnswerHeader.ResponseType.v[1]); // Response type
+        UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
+        UDPGet(&DNSAnswerHeader.ResponseClass.v[1]); // Response class
+        UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
+        UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]); // Time to live
+        UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
+        UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
+        UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
+        UDPGet(&DNSAnswerHeader.ResponseLen.v[1]); // Response length
+        UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
+
+        // CNAME and MX records of the answer also limit the life of the address
+        if (i < DNSHeader.Answers.Val && DNSAnswerHeader.ResponseTTL.Val < TTL)
+            TTL = DNSAnswerHeader.ResponseTTL.Val;
+
+        // Make sure that this is a 4 byte IP address, response type A, class 1
+        if (DNSAnswerHeader.ResponseType.Val == DNS_TYPE_A &&
+                DNSAnswerHeader.ResponseClass.Val == 0x0001u && // Internet class
+                DNSAnswerHeader.ResponseLen.Val == 0x0004u) {
+            UDPGet(&q->IPAddr.v[0]);
+            UDPGet(&q->IPAddr.v[1]);
+            UDPGet(&q->IPAddr.v[2]);
+            UDPGet(&q->IPAddr.v[3]);
+            if (DNSAnswerHeader.ResponseTTL.Val < TTL)
+                TTL = DNSAnswerHeader.ResponseTTL.Val;
             break;
         }
 
-        UDPGet(&DNSHeader.Flags.v[1]);
-        UDPGet(&DNSHeader.Flags.v[0]);
-        UDPGet(&DNSHeader.Questions.v[1]);
-        UDPGet(&DNSHeader.Questions.v[0]);
-        UDPGet(&DNSHeader.Answers.v[1]);
-        UDPGet(&DNSHeader.Answers.v[0]);
-        UDPGet(&DNSHeader.AuthoritativeRecords.v[1]);
-        UDPGet(&DNSHeader.AuthoritativeRecords.v[0]);
-        UDPGet(&DNSHeader.AdditionalRecords.v[1]);
-        UDPGet(&DNSHeader.AdditionalRecords.v[0]);
-
-        // Remove all questions (queries)
-        while (DNSHeader.Questions.Val--) {
-            DNSDiscardName();
-            UDPGet(&w.v[1]); // Question type
-            UDPGet(&w.v[0]);
-            UDPGet(&w.v[1]); // Question class
-            UDPGet(&w.v[0]);
+        // The MINIMUM field ends the SOA record
+        if (DNSAnswerHeader.ResponseType.Val == DNS_TYPE_SOA && DNSAnswerHeader.ResponseLen.Val >= 4u) {
+            UDPGetArray(NULL, DNSAnswerHeader.ResponseLen.Val - 4u);
+            UDPGet(&Minimum.v[3]);
+            UDPGet(&Minimum.v[2]);
+            UDPGet(&Minimum.v[1]);
+            UDPGet(&Minimum.v[0]);
+            if (DNSAnswerHeader.ResponseTTL.Val < NegativeTTL)
+                NegativeTTL = DNSAnswerHeader.ResponseTTL.Val;
+            if (Minimum.Val < NegativeTTL)
+                NegativeTTL = Minimum.Val;
+            continue;
         }
 
-        // Scan through answers
-        while (DNSHeader.Answers.Val--) {
-            DNSDiscardName(); // Throw away response name
-            UDPGet(&DNSAnswerHeader.ResponseType.v[1]); // Response type
-            UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[1]); // Response class
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]); // Time to live
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[1]); // Response length
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-            // Make sure that this is a 4 byte IP address, response type A or MX, class 1
-            // Check if this is Type A or MX
-            if (DNSAnswerHeader.ResponseType.Val == 0x0001u &&
-                    DNSAnswerHeader.ResponseClass.Val == 0x0001u && // Internet class
-                    DNSAnswerHeader.ResponseLen.Val == 0x0004u) {
-                Flags.bits.AddressValid = true;
-                UDPGet(&ResolvedInfo.IPAddr.v[0]);
-                UDPGet(&ResolvedInfo.IPAddr.v[1]);
-                UDPGet(&ResolvedInfo.IPAddr.v[2]);
-                UDPGet(&ResolvedInfo.IPAddr.v[3]);
-                goto DoneSearchingRecords;
-            } else {
-                while (DNSAnswerHeader.ResponseLen.Val--) {
-                    UDPGet(&i);
-                }
-            }
-        }
+        UDPGetArray(NULL, DNSAnswerHeader.ResponseLen.Val);
+    }
 
-        // Remove all Authoritative Records
-        while (DNSHeader.AuthoritativeRecords.Val--) {
-            DNSDiscardName(); // Throw away response name
-            UDPGet(&DNSAnswerHeader.ResponseType.v[1]); // Response type
-            UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[1]); // Response class
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]); // Time to live
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[1]); // Response length
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-            // Make sure that this is a 4 byte IP address, response type A or MX, class 1
-            // Check if this is Type A
-            if (DNSAnswerHeader.ResponseType.Val == 0x0001u &&
-                    DNSAnswerHeader.ResponseClass.Val == 0x0001u && // Internet class
-                    DNSAnswerHeader.ResponseLen.Val == 0x0004u) {
-                Flags.bits.AddressValid = true;
-                UDPGet(&ResolvedInfo.IPAddr.v[0]);
-                UDPGet(&ResolvedInfo.IPAddr.v[1]);
-                UDPGet(&ResolvedInfo.IPAddr.v[2]);
-                UDPGet(&ResolvedInfo.IPAddr.v[3]);
-                goto DoneSearchingRecords;
-            } else {
-                while (DNSAnswerHeader.ResponseLen.Val--) {
-                    UDPGet(&i);
-                }
-            }
+    UDPDiscard();
+
+    q->State = DNS_QUERY_DONE;
+    if (q->IPAddr.Val) {
+        q->Result = DNS_RES_OK;
+        DNSCacheAdd(q, TTL);
+    } else {
+        q->Result = DNS_RES_NAME_ERROR;
+        DNSCacheAdd(q, NegativeTTL);
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static void DNSFailover(void)
+
+  Summary:
+    Swaps the primary and secondary DNS servers.
+
+  Description:
+    The new primary server is resolved by ARP before the next query.
+    Without secondary server, the primary one is resolved again.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSFailover(void)
+{
+    vARPAttemptCount = 0;
+    smServer = DNS_SERVER_ARP_START;
+
+    // Swap primary and secondary DNS servers if there is a secondary DNS server programmed
+    if (AppConfig.SecondaryDNSServer.Val) {
+        AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
+        AppConfig.SecondaryDNSServer.Val ^= AppConfig.PrimaryDNSServer.Val;
+        AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
+        Stats.Failovers++;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static bool DNSCacheLookup(DNS_QUERY *q)
+
+  Summary:
+    Looks for the answer of a query in the cache.
+
+  Description:
+    An expired entry is freed when it is found.
+
+  Precondition:
+    q->NameHash, q->Type and the host name are set.
+
+  Parameters:
+    q - Query, receives IPAddr and Result on a hit
+
+  Returns:
+    true on a hit, false otherwise.
+ ***************************************************************************/
+static bool DNSCacheLookup(DNS_QUERY *q)
+{
+    DNS_CACHE_ENTRY *entry;
+    uint32_t now;
+    uint8_t i;
+
+    now = TickGetDiv256();
+    for (i = 0, entry = Cache; i < DNS_CACHE_ENTRIES; i++, entry++) {
+        if (entry->Type != q->Type || entry->NameHash != q->NameHash ||
+                !DNSCacheNameMatch(entry, q))
+            continue;
+
+        if (now - entry->Time > entry->TTL) {
+            entry->Type = 0;
+            return false;
         }
 
-        // Remove all Additional Records
-        while (DNSHeader.AdditionalRecords.Val--) {
-            DNSDiscardName(); // Throw away response name
-            UDPGet(&DNSAnswerHeader.ResponseType.v[1]); // Response type
-            UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[1]); // Response class
-            UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]); // Time to live
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-            UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[1]); // Response length
-            UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-            // Make sure that this is a 4 byte IP address, response type A or MX, class 1
-            // Check if this is Type A
-            if (DNSAnswerHeader.ResponseType.Val == 0x0001u &&
-                    DNSAnswerHeader.ResponseClass.Val == 0x0001u && // Internet class
-                    DNSAnswerHeader.ResponseLen.Val == 0x0004u) {
-                Flags.bits.AddressValid = true;
-                UDPGet(&ResolvedInfo.IPAddr.v[0]);
-                UDPGet(&ResolvedInfo.IPAddr.v[1]);
-                UDPGet(&ResolvedInfo.IPAddr.v[2]);
-                UDPGet(&ResolvedInfo.IPAddr.v[3]);
-                goto DoneSearchingRecords;
-            } else {
-                while (DNSAnswerHeader.ResponseLen.Val--) {
-                    UDPGet(&i);
-                }
-            }
+        entry->LastUsed = ++CacheClock;
+        q->IPAddr.Val = entry->IPAddr.Val;
+        if (entry->IPAddr.Val) {
+            q->Result = DNS_RES_OK;
+            Stats.CacheHits++;
+        } else {
+            q->Result = DNS_RES_NAME_ERROR;
+            Stats.NegativeHits++;
         }
+        return true;
+    }
 
-    DoneSearchingRecords:
+    return false;
+}
 
-        UDPDiscard();
-        UDPClose(MySocket);
-        MySocket = INVALID_UDP_SOCKET;
-        smDNS = DNS_DONE;
-        // No break, DNS_DONE is the correct step
-
-    case DNS_DONE:
-        // Return 0.0.0.0 if DNS resolution failed, otherwise return the
-        // resolved IP address
-        if (!Flags.bits.AddressValid)
-            ResolvedInfo.IPAddr.Val = 0;
-        HostIP->Val = ResolvedInfo.IPAddr.Val;
-        return true;
+/*****************************************************************************
+  Function:
+    static void DNSCacheAdd(DNS_QUERY *q, uint32_t TTL)
 
-    case DNS_FAIL:
-        // If 3 attempts or more, quit
-        if (vDNSAttemptCount >= 2u) {
-            // Return an invalid IP address 0.0.0.0 if we can't finish ARP or DNS query step
-            HostIP->Val = 0x00000000;
-            return true;
-        }
-        vDNSAttemptCount++;
+  Summary:
+    Caches the answer of a query.
 
-        // Swap primary and secondary DNS servers if there is a secondary DNS server programmed
-        if (AppConfig.SecondaryDNSServer.Val) {
-            AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
-            AppConfig.SecondaryDNSServer.Val ^= AppConfig.PrimaryDNSServer.Val;
-            AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
+  Description:
+    The entry of the same name and type is updated, otherwise a free entry
+    or the least recently used one is taken.
 
-            // Start another ARP resolution for the secondary server (now primary)
-            vARPAttemptCount = 0;
-            if (MySocket != INVALID_UDP_SOCKET) {
-                UDPClose(MySocket);
-                MySocket = INVALID_UDP_SOCKET;
-            }
-            smDNS = DNS_ARP_START_RESOLVE;
+  Precondition:
+    q->IPAddr holds the answer, 0.0.0.0 for a negative one.
+
+  Parameters:
+    q - Query that received the answer
+    TTL - Seconds the answer may be used, 0 to not cache it
+
+  Returns:
+    None
+ ***************************************************************************/
+static void DNSCacheAdd(DNS_QUERY *q, uint32_t TTL)
+{
+    DNS_CACHE_ENTRY *entry;
+    DNS_CACHE_ENTRY *victim;
+    uint32_t now;
+    uint8_t i;
+
+    if (TTL == 0u)
+        return;
+    if (TTL > DNS_CACHE_MAX_TTL)
+        TTL = DNS_CACHE_MAX_TTL;
+
+    now = TickGetDiv256();
+    victim = NULL;
+    for (i = 0, entry = Cache; i < DNS_CACHE_ENTRIES; i++, entry++) {
+        if (entry->Type == q->Type && entry->NameHash == q->NameHash &&
+                DNSCacheNameMatch(entry, q)) {
+            victim = entry;
+            break;
         }
+        if (victim == NULL || (victim->Type != 0u &&
+                (entry->Type == 0u || entry->LastUsed < victim->LastUsed)))
+            victim = entry;
+    }
 
-        break;
+    victim->NameHash = q->NameHash;
+    for (i = 0; i < DNS_CACHE_NAME_SIZE; i++) {
+        victim->Name[i] = DNSNameChar(q, i);
+        if (victim->Name[i] == 0x00u)
+            break;
+    }
+    victim->Type = q->Type;
+    victim->IPAddr.Val = q->IPAddr.Val;
+    victim->Time = now;
+    victim->LastUsed = ++CacheClock;
+    victim->TTL = TTL * (uint32_t) (TICK_SECOND / 256ull);
+}
+
+/*****************************************************************************
+  Function:
+    static uint8_t DNSNameChar(DNS_QUERY *q, uint8_t i)
+
+  Summary:
+    Returns a character of the host name of a query.
+
+  Description:
+    The name is read from RAM or ROM, in lower case, and ends at the
+    characters that also end it in DNSHashName.
+
+  Precondition:
+    The characters before i are not the end of the name.
+
+  Parameters:
+    q - Query
+    i - Index of the character
+
+  Returns:
+    The character, 0x00 at the end of the name.
+ ***************************************************************************/
+static uint8_t DNSNameChar(DNS_QUERY *q, uint8_t i)
+{
+    uint8_t c;
+
+    c = q->HostName ? q->HostName[i] : q->HostNameROM[i];
+    if (c == '/' || c == ',' || c == '>')
+        return 0x00;
+    if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+    return c;
+}
+
+/*****************************************************************************
+  Function:
+    static bool DNSCacheNameMatch(DNS_CACHE_ENTRY *entry, DNS_QUERY *q)
+
+  Summary:
+    Checks that a cache entry is for the host name of a query.
+
+  Description:
+    Called when the hashes match, so that two names of the same hash do not
+    share an answer.  Names longer than DNS_CACHE_NAME_SIZE are compared on
+    their first DNS_CACHE_NAME_SIZE characters, the hash covering the rest.
 
+  Precondition:
+    None
+
+  Parameters:
+    entry - Cache entry in use
+    q - Query
+
+  Returns:
+    true if the names are the same, false otherwise.
+ ***************************************************************************/
+static bool DNSCacheNameMatch(DNS_CACHE_ENTRY *entry, DNS_QUERY *q)
+{
+    uint8_t i, c;
+
+    for (i = 0; i < DNS_CACHE_NAME_SIZE; i++) {
+        c = DNSNameChar(q, i);
+        if (entry->Name[i] != c)
+            return false;
+        if (c == 0x00u)
+            break;
     }
+    return true;
+}
 
-    return false;
+/*****************************************************************************
+  Function:
+    static uint32_t DNSHashName(uint8_t *String)
+
+  Summary:
+    Computes the cache key of a host name.
+
+  Description:
+    32 bit FNV-1a hash of the name, case insensitive, up to the characters
+    that also end the name in DNSPutString.
+
+  Precondition:
+    None
+
+  Parameters:
+    String - the host name
+
+  Returns:
+    The hash
+ ***************************************************************************/
+static uint32_t DNSHashName(uint8_t *String)
+{
+    uint32_t Hash;
+    uint8_t i;
+
+    Hash = 2166136261ul;
+    while (1) {
+        i = *String++;
+        if (i == 0x00u || i == '/' || i == ',' || i == '>')
+            break;
+        if (i >= 'A' && i <= 'Z')
+            i += 'a' - 'A';
+        Hash = (Hash ^ i) * 16777619ul;
+    }
+
+    return Hash;
 }
 
+/*****************************************************************************
+  Function:
+    static uint32_t DNSHashROMName(ROM uint8_t *String)
+
+  Summary:
+    Computes the cache key of a host name in ROM.
+
+  Description:
+    Same as DNSHashName.
+
+  Precondition:
+    None
+
+  Parameters:
+    String - the host name
+
+  Returns:
+    The hash
+
+  Remarks:
+    This function is aliased to DNSHashName on non-PIC18 platforms.
+ ***************************************************************************/
+#if defined(__XC8)
+static uint32_t DNSHashROMName(ROM uint8_t *String)
+{
+    uint32_t Hash;
+    uint8_t i;
+
+    Hash = 2166136261ul;
+    while (1) {
+        i = *String++;
+        if (i == 0x00u || i == '/' || i == ',' || i == '>')
+            break;
+        if (i >= 'A' && i <= 'Z')
+            i += 'a' - 'A';
+        Hash = (Hash ^ i) * 16777619ul;
+    }
+
+    return Hash;
+}
+#endif
+
 /*****************************************************************************
   Function:
     static void DNSPutString(uint8_t *String)
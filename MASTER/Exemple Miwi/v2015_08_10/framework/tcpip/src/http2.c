@@ -56,6 +56,10 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
  ***************************************************************************/
 static ROM uint8_t HTTP_CRLF[] = "\r\n"; // New line sequence
 #define HTTP_CRLF_LEN  2 // Length of above string
+static ROM uint8_t HTTP_CHUNK_HEADER[] = "\r\n0000\r\n"; // End of the previous chunk and size of the next one, filled in once written
+#define HTTP_CHUNK_HEADER_LEN  8 // Length of above string
+static ROM uint8_t HTTP_LAST_CHUNK[] = "\r\n0\r\n\r\n"; // End of the previous chunk and of a chunked body
+#define HTTP_LAST_CHUNK_LEN  7 // Length of above string
 
 /****************************************************************************
   Section:
@@ -100,8 +104,8 @@ static ROM char * ROM httpContentTypes[HTTP_UNKNOWN + 1] = {
 
 // Initial response strings (Corresponding to HTTP_STATUS)
 static ROM char * ROM HTTPResponseHeaders[] = {
-    "HTTP/1.1 200 OK\r\nConnection: close\r\n",
-    "HTTP/1.1 200 OK\r\nConnection: close\r\n",
+    "HTTP/1.1 200 OK\r\n",
+    "HTTP/1.1 200 OK\r\n",
     "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n400 Bad Request: can't handle Content-Length\r\n",
     "HTTP/1.1 401 Unauthorized\r\nWWW-Authenticate: Basic realm=\"Protected\"\r\nConnection: close\r\n\r\n401 Unauthorized: Password required\r\n",
 #if defined(HTTP_MPFS_UPLOAD)
@@ -119,9 +123,18 @@ static ROM char * ROM HTTPResponseHeaders[] = {
     "HTTP/1.1 500 Internal Server Error\r\nConnection: close\r\nContent-Type: text/html\r\n\r\n<html><body style=\"margin:100px\"><b>MPFS Image Corrupt or Wrong Version</b><p><a href=\"/" HTTP_MPFS_UPLOAD "\">Try again?</a></body></html>",
 #endif
     "HTTP/1.1 302 Found\r\nConnection: close\r\nLocation: ",
-    "HTTP/1.1 403 Forbidden\r\nConnection: close\r\n\r\n403 Forbidden: SSL Required - use HTTPS\r\n"
+    "HTTP/1.1 403 Forbidden\r\nConnection: close\r\n\r\n403 Forbidden: SSL Required - use HTTPS\r\n",
+    "HTTP/1.1 304 Not Modified\r\n"
 };
 
+// Day and month names for HTTP dates, three letters each
+static ROM char HTTPDays[] = "SunMonTueWedThuFriSat";
+static ROM char HTTPMonths[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static ROM uint8_t HTTPMonthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+#define HTTP_DATE_LEN  (29u) // Length of an HTTP date, ex: "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_ETAG_LEN  (19u) // Length of an entity tag, ex: "\"5a3c1d20-000004b2\""
+
 /****************************************************************************
   Section:
     Header Parsing Configuration
@@ -131,11 +144,14 @@ static ROM char * ROM HTTPResponseHeaders[] = {
 static ROM char * ROM HTTPRequestHeaders[] = {
     "Cookie:",
     "Authorization:",
-    "Content-Length:"
+    "Content-Length:",
+    "Connection:",
+    "If-None-Match:",
+    "If-Modified-Since:"
 };
 
 // Set to length of longest string above
-#define HTTP_MAX_HEADER_LEN  (15u)
+#define HTTP_MAX_HEADER_LEN  (18u)
 
 /****************************************************************************
   Section:
@@ -150,12 +166,16 @@ static void HTTPLoadConn(uint8_t hHTTP);
 #endif
 HTTP_STUB httpStubs[MAX_HTTP_CONNECTIONS]; // HTTP stubs with state machine and socket
 uint8_t curHTTPID; // ID of the currently loaded HTTP_CONN
+static uint8_t httpFreeSockets; // HTTP sockets left for new connections, counted by HTTPServer()
 
 /****************************************************************************
   Section:
     Function Prototypes
  ***************************************************************************/
 static void HTTPHeaderParseLookup(uint8_t i);
+static void HTTPHeaderParseConnection(void);
+static void HTTPHeaderParseIfNoneMatch(void);
+static void HTTPHeaderParseIfModifiedSince(void);
 #if defined(HTTP_USE_COOKIES)
 static void HTTPHeaderParseCookie(void);
 #endif
@@ -169,6 +189,12 @@ static HTTP_READ_STATUS HTTPReadTo(uint8_t delim, uint8_t * buf, uint16_t len);
 
 static void HTTPProcess(void);
 static bool HTTPSendFile(void);
+static bool HTTPKeepAliveAllowed(void);
+static uint16_t HTTPChunkBegin(void);
+static void HTTPChunkEnd(uint16_t wStart);
+static void HTTPGetETag(uint8_t *vETag);
+static void HTTPFormatDate(uint32_t dwTime, uint8_t *vDate);
+static void HTTPPutValidators(void);
 
 #if defined(HTTP_MPFS_UPLOAD)
 static HTTP_IO_RESULT HTTPMPFSUpload(void);
@@ -213,6 +239,7 @@ void HTTPInit(void)
         // Save the default record (just invalid file handles)
         curHTTP.file = MPFS_INVALID_HANDLE;
         curHTTP.offsets = MPFS_INVALID_HANDLE;
+        curHTTP.isPersistent = false;
 #if !defined(HTTP_SAVE_CONTEXT_IN_PIC_RAM)
         {
             PTR_BASE oldPtr;
@@ -259,6 +286,14 @@ void HTTPServer(void)
 {
     uint8_t conn;
 
+    // Count the sockets new clients can connect to, persistent connections
+    // are closed when there are none left
+    httpFreeSockets = 0;
+    for (conn = 0; conn < MAX_HTTP_CONNECTIONS; conn++) {
+        if (httpStubs[conn].socket != INVALID_SOCKET && !TCPIsConnected(httpStubs[conn].socket))
+            httpFreeSockets++;
+    }
+
     for (conn = 0; conn < MAX_HTTP_CONNECTIONS; conn++) {
         if (httpStubs[conn].socket == INVALID_SOCKET)
             continue;
@@ -270,6 +305,7 @@ void HTTPServer(void)
         if (TCPWasReset(httpStubs[conn].socket)) {
             HTTPLoadConn(conn);
             smHTTP = SM_HTTP_IDLE;
+            curHTTP.isPersistent = false;
 
             // Make sure any opened files are closed
             if (curHTTP.file != MPFS_INVALID_HANDLE) {
@@ -290,6 +326,13 @@ void HTTPServer(void)
         if (httpStubs[conn].sm != SM_HTTP_IDLE || TCPIsGetReady(httpStubs[conn].socket)) {
             HTTPLoadConn(conn);
             HTTPProcess();
+
+            // Tell StackApplications() when to call again.  New data and
+            // resets wake the module up through TCP.
+            if (smHTTP == SM_HTTP_KEEP_ALIVE)
+                StackSetTimer(STACK_MODULE_HTTP, curHTTP.callbackID + 1);
+            else if (smHTTP != SM_HTTP_IDLE)
+                StackSignal(STACK_MODULE_HTTP, STACK_EVENT_BUSY);
         }
     }
 }
@@ -382,13 +425,21 @@ static void HTTPProcess(void)
                 curHTTP.callbackID = TickGet() + HTTP_TIMEOUT*TICK_SECOND;
                 curHTTP.callbackPos = 0xffffffff;
                 curHTTP.byteCount = 0;
+                curHTTP.keepAlive = false;
+                curHTTP.isChunked = false;
+                curHTTP.chunkNeedsCRLF = false;
+                curHTTP.hasIfNoneMatch = false;
+                curHTTP.isNotModified = false;
 #if defined(HTTP_USE_POST)
                 curHTTP.smPost = 0x00;
 #endif
 
                 // Adjust the TCP FIFOs for optimal reception of
-                // the next HTTP request from the browser
-                TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_PRESERVE_RX | TCP_ADJUST_GIVE_REST_TO_RX);
+                // the next HTTP request from the browser.  A persistent
+                // connection keeps its FIFOs as they are, since the RX FIFO
+                // may already hold the requests that follow.
+                if (!curHTTP.isPersistent)
+                    TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_PRESERVE_RX | TCP_ADJUST_GIVE_REST_TO_RX);
             } else
                 // Don't break for new connections.  There may be
                 // an entire request in the buffer already.
@@ -543,8 +594,10 @@ static void HTTPProcess(void)
 
             }
 
-            // Clear the rest of the line
+            // Clear the rest of the line.  HTTP/1.1 connections are
+            // persistent unless the client asks to close them.
             lenA = TCPFind(sktHTTP, '\n', 0, false);
+            curHTTP.keepAlive = (TCPFindROMArrayEx(sktHTTP, (ROM uint8_t *) "HTTP/1.1", 8, 0, lenA, false) != 0xffffu);
             TCPGetArray(sktHTTP, NULL, lenA + 1);
 
             // Move to parsing the headers
@@ -740,15 +793,35 @@ static void HTTPProcess(void)
                 MPFSGetLong(curHTTP.offsets, &(curHTTP.nextCallback));
             }
 
+            // Answer 304 when the client already has this static file
+            if (curHTTP.isNotModified && curHTTP.httpStatus == HTTP_GET && curHTTP.nextCallback == 0xffffffff)
+                curHTTP.httpStatus = HTTP_NOT_MODIFIED;
+
             // Move to next state
             smHTTP = SM_HTTP_SERVE_HEADERS;
 
         case SM_HTTP_SERVE_HEADERS:
 
+            // A persistent connection may still be sending the previous
+            // response, so wait until the headers fit in the TX FIFO
+            if (curHTTP.isPersistent && TCPIsPutReady(sktHTTP) < HTTP_MIN_HEADER_FREE && TCPGetTxFIFOFull(sktHTTP) != 0u)
+                break;
+
+            // Decide whether the connection stays open for another request
+            if (curHTTP.keepAlive && !HTTPKeepAliveAllowed())
+                curHTTP.keepAlive = false;
+
             // We're in write mode now:
             // Adjust the TCP FIFOs for optimal transmission of
-            // the HTTP response to the browser
-            TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_GIVE_REST_TO_TX);
+            // the HTTP response to the browser.  A persistent connection
+            // keeps enough RX FIFO for its next requests, including any
+            // already received.
+            if (!curHTTP.isPersistent) {
+                if (!curHTTP.keepAlive || !TCPAdjustFIFOSize(sktHTTP, HTTP_KEEP_ALIVE_RX_SIZE, 0, TCP_ADJUST_PRESERVE_RX | TCP_ADJUST_GIVE_REST_TO_TX)) {
+                    curHTTP.keepAlive = false;
+                    TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_GIVE_REST_TO_TX);
+                }
+            }
 
             // Send headers
             TCPPutROMString(sktHTTP, (ROM uint8_t *) HTTPResponseHeaders[curHTTP.httpStatus]);
@@ -761,33 +834,61 @@ static void HTTPProcess(void)
                 TCPPutROMString(sktHTTP, (ROM uint8_t *) HTTP_CRLF);
             }
 
-            // If not GET or POST, we're done
-            if (curHTTP.httpStatus != HTTP_GET && curHTTP.httpStatus != HTTP_POST) { // Disconnect
+            // If not GET, POST or 304, we're done
+            if (curHTTP.httpStatus != HTTP_GET && curHTTP.httpStatus != HTTP_POST && curHTTP.httpStatus != HTTP_NOT_MODIFIED) { // Disconnect
                 smHTTP = SM_HTTP_DISCONNECT;
                 break;
             }
 
-            // Output the content type, if known
-            if (curHTTP.fileType != HTTP_UNKNOWN) {
-                TCPPutROMString(sktHTTP, (ROM uint8_t *) "Content-Type: ");
-                TCPPutROMString(sktHTTP, (ROM uint8_t *) httpContentTypes[curHTTP.fileType]);
-                TCPPutROMString(sktHTTP, HTTP_CRLF);
+            // Frame the body of a persistent connection: static files have
+            // a known length, dynamic ones are sent in chunks and a 304
+            // has no body
+            if (!curHTTP.keepAlive) {
+                TCPPutROMString(sktHTTP, (ROM uint8_t *) "Connection: close\r\n");
+            } else if (curHTTP.httpStatus != HTTP_NOT_MODIFIED) {
+                if (curHTTP.nextCallback == 0xffffffff) {
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) "Content-Length: ");
+                    ultoa(MPFSGetSize(curHTTP.file), buffer);
+                    TCPPutString(sktHTTP, buffer);
+                    TCPPutROMString(sktHTTP, HTTP_CRLF);
+                } else {
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) "Transfer-Encoding: chunked\r\n");
+                    curHTTP.isChunked = true;
+                }
             }
 
-            // Output the gzip encoding header if needed
-            if (MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_ISZIPPED) {
-                TCPPutROMString(sktHTTP, (ROM uint8_t *) "Content-Encoding: gzip\r\n");
+            // Output the content type, if known, and the gzip encoding
+            // header if needed.  A 304 only repeats the cache headers.
+            if (curHTTP.httpStatus != HTTP_NOT_MODIFIED) {
+                if (curHTTP.fileType != HTTP_UNKNOWN) {
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) "Content-Type: ");
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) httpContentTypes[curHTTP.fileType]);
+                    TCPPutROMString(sktHTTP, HTTP_CRLF);
+                }
+
+                if (MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_ISZIPPED) {
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) "Content-Encoding: gzip\r\n");
+                }
             }
 
             // Output the cache-control
             TCPPutROMString(sktHTTP, (ROM uint8_t *) "Cache-Control: ");
             if (curHTTP.httpStatus == HTTP_POST || curHTTP.nextCallback != 0xffffffff) { // This is a dynamic page or a POST request, so no cache
-                TCPPutROMString(sktHTTP, (ROM uint8_t *) "no-cache");
-            } else { // This is a static page, so save it for the specified amount of time
+                TCPPutROMString(sktHTTP, (ROM uint8_t *) "no-cache\r\n");
+            } else { // This is a static page, so save it for the time set in the MPFS image or the default one
                 TCPPutROMString(sktHTTP, (ROM uint8_t *) "max-age=");
-                TCPPutROMString(sktHTTP, (ROM uint8_t *) HTTP_CACHE_LEN);
+                if (MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_MAXAGE) {
+                    ultoa(MPFSGetMicrotime(curHTTP.file), buffer);
+                    TCPPutString(sktHTTP, buffer);
+                } else {
+                    TCPPutROMString(sktHTTP, (ROM uint8_t *) HTTP_CACHE_LEN);
+                }
+                TCPPutROMString(sktHTTP, HTTP_CRLF);
+
+                // Output the validators the client sends back to revalidate
+                // its copy once max-age has expired
+                HTTPPutValidators();
             }
-            TCPPutROMString(sktHTTP, HTTP_CRLF);
 
             // Check if we should output cookies
             if (curHTTP.hasArgs)
@@ -852,10 +953,34 @@ static void HTTPProcess(void)
 
             isDone = false;
 
-            // Try to send next packet
-            if (HTTPSendFile()) { // If EOF, then we're done so close and disconnect
+            // A chunk needs room for its header
+            if (curHTTP.isChunked) {
+                if (TCPIsPutReady(sktHTTP) <= HTTP_CHUNK_HEADER_LEN) {
+                    isDone = true;
+                    break;
+                }
+                lenA = HTTPChunkBegin();
+            }
+
+            // Try to send next packet, a 304 has no body to send
+            if (curHTTP.httpStatus == HTTP_NOT_MODIFIED)
+                c = true;
+            else
+                c = HTTPSendFile();
+            if (curHTTP.isChunked)
+                HTTPChunkEnd(lenA);
+
+            if (c) { // If EOF, then we're done so close and disconnect
                 MPFSClose(curHTTP.file);
                 curHTTP.file = MPFS_INVALID_HANDLE;
+                if (curHTTP.keepAlive) { // Unless the connection stays open for the next request
+                    if (!curHTTP.isChunked)
+                        TCPFlush(sktHTTP);
+                    curHTTP.isPersistent = true;
+                    curHTTP.callbackID = TickGet() + HTTP_KEEP_ALIVE_TIMEOUT*TICK_SECOND;
+                    smHTTP = SM_HTTP_KEEP_ALIVE;
+                    break;
+                }
                 smHTTP = SM_HTTP_DISCONNECT;
                 isDone = true;
             }
@@ -870,11 +995,18 @@ static void HTTPProcess(void)
             isDone = true;
 
             // Check that at least the minimum bytes are free
-            if (TCPIsPutReady(sktHTTP) < HTTP_MIN_CALLBACK_FREE)
+            lenA = HTTP_MIN_CALLBACK_FREE;
+            if (curHTTP.isChunked)
+                lenA += HTTP_CHUNK_HEADER_LEN;
+            if (TCPIsPutReady(sktHTTP) < lenA)
                 break;
 
             // Fill TX FIFO from callback
+            if (curHTTP.isChunked)
+                lenA = HTTPChunkBegin();
             HTTPPrint(curHTTP.callbackID);
+            if (curHTTP.isChunked)
+                HTTPChunkEnd(lenA);
 
             if (curHTTP.callbackPos == 0u) { // Callback finished its output, so move on
                 isDone = false;
@@ -883,6 +1015,39 @@ static void HTTPProcess(void)
 
             break;
 
+        case SM_HTTP_KEEP_ALIVE:
+
+            isDone = true;
+
+            // End a chunked body once there is room for the last chunk
+            if (curHTTP.isChunked) {
+                if (TCPIsPutReady(sktHTTP) < HTTP_LAST_CHUNK_LEN)
+                    break;
+                if (curHTTP.chunkNeedsCRLF)
+                    TCPPutROMArray(sktHTTP, HTTP_LAST_CHUNK, HTTP_LAST_CHUNK_LEN);
+                else
+                    TCPPutROMArray(sktHTTP, HTTP_LAST_CHUNK + HTTP_CRLF_LEN, HTTP_LAST_CHUNK_LEN - HTTP_CRLF_LEN);
+                curHTTP.isChunked = false;
+                TCPFlush(sktHTTP);
+            }
+
+            // Serve the next request as soon as it arrives, it may even
+            // be in the RX FIFO already
+            if (TCPIsGetReady(sktHTTP)) {
+                smHTTP = SM_HTTP_IDLE;
+                isDone = false;
+                break;
+            }
+
+            // Close the connection when it has been idle for too long, when
+            // the client closed its side, or when no socket is left for
+            // other clients
+            if ((int32_t) (TickGet() - curHTTP.callbackID) > (int32_t) 0 || !TCPIsConnected(sktHTTP) || httpFreeSockets == 0u) {
+                smHTTP = SM_HTTP_DISCONNECT;
+                isDone = false;
+            }
+            break;
+
         case SM_HTTP_DISCONNECT:
             // Make sure any opened files are closed
             if (curHTTP.file != MPFS_INVALID_HANDLE) {
@@ -895,6 +1060,7 @@ static void HTTPProcess(void)
             }
 
             TCPDisconnect(sktHTTP);
+            curHTTP.isPersistent = false;
             smHTTP = SM_HTTP_IDLE;
             break;
         }
@@ -968,6 +1134,287 @@ static bool HTTPSendFile(void)
     return false;
 }
 
+/*****************************************************************************
+  Function:
+    static bool HTTPKeepAliveAllowed(void)
+
+  Description:
+    Determines whether the current connection may stay open once its
+    response is sent.  Only GET responses are kept open, and only while
+    another HTTP socket is left for new clients and the client does not
+    hold more than HTTP_MAX_CONN_PER_CLIENT connections, so that one
+    browser cannot keep every socket to itself.
+
+  Precondition:
+    The request has been processed up to SM_HTTP_SERVE_HEADERS.
+
+  Parameters:
+    None
+
+  Return Values:
+    true - the connection can stay open
+    false - the connection must be closed after the response
+ ***************************************************************************/
+static bool HTTPKeepAliveAllowed(void)
+{
+#if HTTP_KEEP_ALIVE_TIMEOUT > 0
+    uint8_t conn, vFree, vSameClient;
+    IP_ADDR remoteIP;
+
+    if (curHTTP.httpStatus != HTTP_GET && curHTTP.httpStatus != HTTP_NOT_MODIFIED)
+        return false;
+
+    // Dynamic pages are chunked by changing the TX FIFO in place, which
+    // SSL records don't allow
+#if defined(STACK_USE_SSL_SERVER)
+    if (curHTTP.nextCallback != 0xffffffff && TCPIsSSL(sktHTTP))
+        return false;
+#endif
+
+    // Count the free sockets and those of the same client
+    remoteIP.Val = TCPGetRemoteInfo(sktHTTP)->remote.IPAddr.Val;
+    vFree = 0;
+    vSameClient = 1;
+    for (conn = 0; conn < MAX_HTTP_CONNECTIONS; conn++) {
+        if (conn == curHTTPID || httpStubs[conn].socket == INVALID_SOCKET)
+            continue;
+        if (!TCPIsConnected(httpStubs[conn].socket))
+            vFree++;
+        else if (TCPGetRemoteInfo(httpStubs[conn].socket)->remote.IPAddr.Val == remoteIP.Val)
+            vSameClient++;
+    }
+
+    return (vFree != 0u && vSameClient <= HTTP_MAX_CONN_PER_CLIENT);
+#else
+    return false;
+#endif
+}
+
+/*****************************************************************************
+  Function:
+    static uint16_t HTTPChunkBegin(void)
+
+  Description:
+    Starts a chunk of a chunked response body.  The chunk header is written
+    with a blank size and held in the TX FIFO, so that HTTPChunkEnd() can
+    fill in the size of the data written after it.
+
+  Precondition:
+    curHTTP.isChunked is set and more than HTTP_CHUNK_HEADER_LEN bytes are
+    free in the TX FIFO.
+
+  Parameters:
+    None
+
+  Returns:
+    Position of the chunk header in the TX FIFO, for HTTPChunkEnd().
+
+  Remarks:
+    The CRLF ending the previous chunk is written with this header rather
+    than after the data, so that a callback can fill the TX FIFO.
+ ***************************************************************************/
+static uint16_t HTTPChunkBegin(void)
+{
+    uint16_t wStart;
+
+    wStart = TCPGetTxFIFOFull(sktHTTP);
+    TCPHoldTX(sktHTTP, true);
+
+    if (curHTTP.chunkNeedsCRLF)
+        TCPPutROMArray(sktHTTP, HTTP_CHUNK_HEADER, HTTP_CHUNK_HEADER_LEN);
+    else
+        TCPPutROMArray(sktHTTP, HTTP_CHUNK_HEADER + HTTP_CRLF_LEN, HTTP_CHUNK_HEADER_LEN - HTTP_CRLF_LEN);
+
+    return wStart;
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPChunkEnd(uint16_t wStart)
+
+  Description:
+    Ends the chunk started by HTTPChunkBegin(), filling in its size and
+    releasing it for transmission.  A chunk without data is removed, since
+    an empty chunk would end the body.
+
+  Precondition:
+    HTTPChunkBegin() has been called.
+
+  Parameters:
+    wStart - the value returned by HTTPChunkBegin()
+
+  Returns:
+    None
+ ***************************************************************************/
+static void HTTPChunkEnd(uint16_t wStart)
+{
+    uint16_t wHeaderLen, wLen;
+    uint8_t vSize[4];
+
+    wHeaderLen = HTTP_CHUNK_HEADER_LEN;
+    if (!curHTTP.chunkNeedsCRLF)
+        wHeaderLen -= HTTP_CRLF_LEN;
+    wLen = TCPGetTxFIFOFull(sktHTTP) - wStart - wHeaderLen;
+
+    if (wLen == 0u) {
+        TCPUnput(sktHTTP, wHeaderLen);
+    } else {
+        vSize[0] = btohexa_high(wLen >> 8);
+        vSize[1] = btohexa_low(wLen >> 8);
+        vSize[2] = btohexa_high(wLen);
+        vSize[3] = btohexa_low(wLen);
+        TCPPokeArray(sktHTTP, vSize, sizeof (vSize), wStart + wHeaderLen - sizeof (vSize) - HTTP_CRLF_LEN);
+        curHTTP.chunkNeedsCRLF = true;
+    }
+
+    TCPHoldTX(sktHTTP, false);
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPGetETag(uint8_t *vETag)
+
+  Description:
+    Builds the strong entity tag of curHTTP.file from its MPFS record: the
+    timestamp and the size, in hex and quoted.  A new MPFS image changes
+    both for any file that was modified.
+
+  Precondition:
+    curHTTP.file is open.
+
+  Parameters:
+    vETag - buffer of HTTP_ETAG_LEN bytes receiving the tag, not null
+            terminated
+
+  Returns:
+    None
+ ***************************************************************************/
+static void HTTPGetETag(uint8_t *vETag)
+{
+    uint32_t dwVal;
+    uint8_t i;
+
+    *vETag++ = '"';
+    dwVal = MPFSGetTimestamp(curHTTP.file);
+    for (i = 0; i < 8u; i++, dwVal <<= 4)
+        *vETag++ = btohexa_high(dwVal >> 24);
+    *vETag++ = '-';
+    dwVal = MPFSGetSize(curHTTP.file);
+    for (i = 0; i < 8u; i++, dwVal <<= 4)
+        *vETag++ = btohexa_high(dwVal >> 24);
+    *vETag = '"';
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPFormatDate(uint32_t dwTime, uint8_t *vDate)
+
+  Description:
+    Formats a time as an HTTP date, ex: "Sun, 06 Nov 1994 08:49:37 GMT".
+
+  Precondition:
+    None
+
+  Parameters:
+    dwTime - seconds since 1970-01-01 00:00:00 UTC, as in the MPFS records
+    vDate - buffer of HTTP_DATE_LEN bytes receiving the date, not null
+            terminated
+
+  Returns:
+    None
+ ***************************************************************************/
+static void HTTPFormatDate(uint32_t dwTime, uint8_t *vDate)
+{
+    uint32_t dwDays;
+    uint16_t wYear, wYearDays;
+    uint8_t vMonth, vMonthDays, vSecs;
+
+    dwDays = dwTime / 86400ul;
+    dwTime -= dwDays * 86400ul;
+
+    // 1970-01-01 was a Thursday
+    memcpypgm2ram(vDate, (ROM void *) &HTTPDays[((dwDays + 4u) % 7u) * 3u], 3);
+    vDate[3] = ',';
+    vDate[4] = ' ';
+
+    for (wYear = 1970u;; wYear++) {
+        wYearDays = ((wYear & 3u) == 0u) ? 366u : 365u;
+        if (dwDays < wYearDays)
+            break;
+        dwDays -= wYearDays;
+    }
+    for (vMonth = 0; vMonth < 11u; vMonth++) {
+        vMonthDays = HTTPMonthDays[vMonth];
+        if (vMonth == 1u && (wYear & 3u) == 0u)
+            vMonthDays++;
+        if (dwDays < vMonthDays)
+            break;
+        dwDays -= vMonthDays;
+    }
+
+    dwDays++;
+    vDate[5] = '0' + dwDays / 10u;
+    vDate[6] = '0' + dwDays % 10u;
+    vDate[7] = ' ';
+    memcpypgm2ram(&vDate[8], (ROM void *) &HTTPMonths[vMonth * 3u], 3);
+    vDate[11] = ' ';
+    vDate[12] = '0' + wYear / 1000u;
+    vDate[13] = '0' + (wYear / 100u) % 10u;
+    vDate[14] = '0' + (wYear / 10u) % 10u;
+    vDate[15] = '0' + wYear % 10u;
+    vDate[16] = ' ';
+
+    vSecs = dwTime / 3600u;
+    vDate[17] = '0' + vSecs / 10u;
+    vDate[18] = '0' + vSecs % 10u;
+    vDate[19] = ':';
+    vSecs = (dwTime / 60u) % 60u;
+    vDate[20] = '0' + vSecs / 10u;
+    vDate[21] = '0' + vSecs % 10u;
+    vDate[22] = ':';
+    vSecs = dwTime % 60u;
+    vDate[23] = '0' + vSecs / 10u;
+    vDate[24] = '0' + vSecs % 10u;
+    memcpypgm2ram(&vDate[25], (ROM void *) " GMT", 4);
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPPutValidators(void)
+
+  Description:
+    Writes the "ETag:" and "Last-Modified:" headers of curHTTP.file, which
+    the client sends back in "If-None-Match:" and "If-Modified-Since:" to
+    revalidate its cached copy.
+
+  Precondition:
+    curHTTP.file is open and the TX FIFO has room for the headers.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void HTTPPutValidators(void)
+{
+    uint32_t dwTime;
+    uint8_t vBuf[HTTP_DATE_LEN];
+
+    HTTPGetETag(vBuf);
+    TCPPutROMString(sktHTTP, (ROM uint8_t *) "ETag: ");
+    TCPPutArray(sktHTTP, vBuf, HTTP_ETAG_LEN);
+    TCPPutROMString(sktHTTP, HTTP_CRLF);
+
+    dwTime = MPFSGetTimestamp(curHTTP.file);
+    if (dwTime != 0u) {
+        HTTPFormatDate(dwTime, vBuf);
+        TCPPutROMString(sktHTTP, (ROM uint8_t *) "Last-Modified: ");
+        TCPPutArray(sktHTTP, vBuf, HTTP_DATE_LEN);
+        TCPPutROMString(sktHTTP, HTTP_CRLF);
+    }
+}
+
 /*****************************************************************************
   Function:
     static void HTTPHeaderParseLookup(uint8_t i)
@@ -1010,6 +1457,138 @@ static void HTTPHeaderParseLookup(uint8_t i)
         return;
     }
 #endif
+
+    if (i == 3u) {
+        HTTPHeaderParseConnection();
+        return;
+    }
+
+    if (i == 4u) {
+        HTTPHeaderParseIfNoneMatch();
+        return;
+    }
+
+    if (i == 5u) {
+        HTTPHeaderParseIfModifiedSince();
+        return;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPHeaderParseConnection(void)
+
+  Summary:
+    Parses the "Connection:" header for a request.
+
+  Description:
+    Parses the "Connection:" header for a request.  HTTP/1.1 connections
+    are persistent by default, so only "close" is looked for.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void HTTPHeaderParseConnection(void)
+{
+    uint16_t len;
+
+    len = TCPFindROMArray(sktHTTP, HTTP_CRLF, HTTP_CRLF_LEN, 0, false);
+    if (len != 0u && TCPFindROMArrayEx(sktHTTP, (ROM uint8_t *) "close", 5, 0, len, true) != 0xffffu)
+        curHTTP.keepAlive = false;
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPHeaderParseIfNoneMatch(void)
+
+  Summary:
+    Parses the "If-None-Match:" header for a request.
+
+  Description:
+    Parses the "If-None-Match:" header, which lists the entity tags of the
+    copies the client has cached.  If one of them, or "*", matches the
+    requested static file, a 304 Not Modified is sent instead of the file.
+    Weak tags (W/"...") are matched on their value.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+
+  Remarks:
+    When present, this header overrides "If-Modified-Since:".
+ ***************************************************************************/
+static void HTTPHeaderParseIfNoneMatch(void)
+{
+    uint16_t len;
+    uint8_t vETag[HTTP_ETAG_LEN];
+
+    curHTTP.hasIfNoneMatch = true;
+    curHTTP.isNotModified = false;
+    if (curHTTP.file == MPFS_INVALID_HANDLE)
+        return;
+
+    len = TCPFindROMArray(sktHTTP, HTTP_CRLF, HTTP_CRLF_LEN, 0, false);
+    if (len == 0u)
+        return;
+
+    HTTPGetETag(vETag);
+    curHTTP.isNotModified = (TCPFindEx(sktHTTP, '*', 0, len, false) != 0xffffu ||
+            TCPFindArrayEx(sktHTTP, vETag, sizeof (vETag), 0, len, false) != 0xffffu);
+}
+
+/*****************************************************************************
+  Function:
+    static void HTTPHeaderParseIfModifiedSince(void)
+
+  Summary:
+    Parses the "If-Modified-Since:" header for a request.
+
+  Description:
+    Parses the "If-Modified-Since:" header.  Clients send back the
+    Last-Modified date of their copy, so the date is compared as is to the
+    one of the requested static file and a 304 Not Modified is sent when
+    they are the same.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+
+  Remarks:
+    Only exact matches are recognized, a later date still gets the file.
+    This avoids parsing the three date formats clients may use.
+ ***************************************************************************/
+static void HTTPHeaderParseIfModifiedSince(void)
+{
+    uint16_t len;
+    uint32_t dwTime;
+    uint8_t vDate[HTTP_DATE_LEN];
+
+    if (curHTTP.hasIfNoneMatch || curHTTP.file == MPFS_INVALID_HANDLE)
+        return;
+
+    dwTime = MPFSGetTimestamp(curHTTP.file);
+    len = TCPFindROMArray(sktHTTP, HTTP_CRLF, HTTP_CRLF_LEN, 0, false);
+    if (dwTime == 0u || len == 0u)
+        return;
+
+    HTTPFormatDate(dwTime, vDate);
+    curHTTP.isNotModified = (TCPFindArrayEx(sktHTTP, vDate, sizeof (vDate), 0, len, false) != 0xffffu);
 }
 
 /*****************************************************************************
@@ -1573,6 +2152,7 @@ static HTTP_READ_STATUS HTTPReadTo(uint8_t cDelim, uint8_t *cData, uint16_t wLen
   Return Values:
     HTTP_IO_DONE - on success
     HTTP_IO_NEED_DATA - if more data is still expected
+    HTTP_IO_WAITING - if the external memory cannot take more data yet
 
   Remarks:
     This function is only available when MPFS uploads are enabled and
@@ -1583,6 +2163,9 @@ static HTTP_READ_STATUS HTTPReadTo(uint8_t cDelim, uint8_t *cData, uint16_t wLen
     separator.  Following that is more headers about the file, which
     are discarded.  After another CRLFCRLF pair the file data begins,
     which is read 16 bytes at a time and written to external memory.
+    Data is only read as MPFSIsPutReady allows, so that the stack keeps
+    running while SPI Flash sectors are erased and programmed, the rest
+    staying in the TCP RX FIFO.
  ***************************************************************************/
 #if defined(HTTP_MPFS_UPLOAD)
 static HTTP_IO_RESULT HTTPMPFSUpload(void)
@@ -1644,16 +2227,24 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
         if (lenA > curHTTP.byteCount)
             lenA = curHTTP.byteCount;
 
+        // Also keeps the external memory busy while waiting for data
+        lenB = MPFSIsPutReady(curHTTP.file);
         while (lenA > 0u) {
-            lenB = TCPGetArray(sktHTTP, c, mMIN(lenA, 16u));
+            // Come back when the external memory is ready for more
+            if (lenB == 0u)
+                return HTTP_IO_WAITING;
+
+            lenB = TCPGetArray(sktHTTP, c, mMIN(mMIN(lenA, 16u), lenB));
             curHTTP.byteCount -= lenB;
             lenA -= lenB;
             MPFSPutArray(curHTTP.file, c, lenB);
+            lenB = MPFSIsPutReady(curHTTP.file);
         }
 
         // If we've read all the data
         if (curHTTP.byteCount == 0u) {
-            MPFSPutEnd(true);
+            if (!MPFSPutEnd(true))
+                curHTTP.httpStatus = HTTP_MPFS_ERROR;
             smHTTP = SM_HTTP_SERVE_HEADERS;
             return HTTP_IO_DONE;
         }
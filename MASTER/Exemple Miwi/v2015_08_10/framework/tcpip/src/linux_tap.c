@@ -0,0 +1,1216 @@
+/*******************************************************************************
+  File Name:
+    linux_tap.c
+
+  Summary:
+    MAC driver over a Linux TAP device or a pcap capture file.
+
+  Description:
+    Emulates the buffer RAM of the Microchip MACs so that the stack runs
+    unmodified as a Linux process: the TX buffer, the TCBs and the RX buffer
+    share one array with the layout given in mac.h, and the read and write
+    pointers follow the ENC28J60 rules.  The RX buffer is a ring holding the
+    frame being processed and the ones kept by MACHoldRx(), a frame is only
+    read from the kernel queue of the TAP device (or the capture file) when
+    one of maximum size fits.  Frames are never split at the end of the
+    ring, so a held frame can be read from its address without wrapping.
+    Frames are filtered like the hardware does: our unicast address,
+    broadcast and all multicast.  The system calls on the TAP device are
+    made by linux_tap_device.c, which does not include the stack.  A
+    capture on a named pipe is unbuffered and only read when a record is
+    waiting, so that the stack keeps running between the frames of a peer.
+
+    See linux_tap.h for the configuration.
+ *******************************************************************************/
+
+#include "tcpip/tcpip.h"
+
+#if defined(TAP_INTERFACE)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tcpip/src/linux_tap_device.h"
+
+#define ETHER_MIN_FRAME     (60u)       // Without FCS, padded by MACFlush()
+#define ETHER_MAX_FRAME     (1518u)
+
+// Frames that the RX ring can hold at once
+#if !defined(TAP_RX_FRAMES)
+#define TAP_RX_FRAMES       (32u)
+#endif
+
+// Frames that the TX delay line can hold, the next ones are dropped like
+// by the queue of a router
+#if !defined(TAP_TX_QUEUE)
+#define TAP_TX_QUEUE        (256u)
+#endif
+
+#define RX_FRAME_FREE       (0u)        // Discarded or released, space reused once the older ones are
+#define RX_FRAME_CURRENT    (1u)        // Returned by the last MACGetHeader()
+#define RX_FRAME_HELD       (2u)        // Kept by MACHoldRx()
+
+#define PCAP_MAGIC          (0xA1B2C3D4ul)
+#define PCAP_MAGIC_NSEC     (0xA1B23C4Dul)
+#define PCAP_LINKTYPE_ETHERNET (1ul)
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t  thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLen;
+    uint32_t linkType;
+} PCAP_FILE_HEADER;
+
+typedef struct
+{
+    PTR_BASE start;
+    uint16_t length;
+    uint8_t state;                      // RX_FRAME_*
+} TAP_RX_FRAME;
+
+typedef struct
+{
+    uint64_t due;                       // MonotonicMicroseconds() when it reaches the wire
+    uint16_t length;
+    uint8_t data[ETHER_MAX_FRAME];
+} TAP_TX_FRAME;
+
+typedef struct
+{
+    uint32_t seconds;
+    uint32_t fraction;                  // Microseconds, or nanoseconds with PCAP_MAGIC_NSEC
+    uint32_t capturedLen;
+    uint32_t originalLen;
+} PCAP_RECORD_HEADER;
+
+static uint8_t macRAM[RAMSIZE];
+static PTR_BASE rdPtr;                  // ERDPT
+static PTR_BASE wrPtr;                  // EWRPT
+static uint16_t txLength;               // Frame in the TX buffer, set by MACPutHeader()
+
+static TAP_RX_FRAME rxFrames[TAP_RX_FRAMES]; // Frames in the RX ring, oldest first
+static uint8_t rxFirst;
+static uint8_t rxCount;
+static PTR_BASE rxFrame = RXSTART;      // Start of the current frame
+
+static int tapFd = -1;
+static FILE *pcapIn = NULL;
+static FILE *pcapOut = NULL;
+static bool pcapInPipe;                 // pcapIn is a named pipe, poll it before reading
+static bool pcapOutPipe;                // pcapOut is a named pipe, flush every frame
+static bool pcapSwapped;                // Capture written on a host of the other endianness
+static bool pcapNano;
+static uint8_t replayFrame[ETHER_MAX_FRAME];
+static uint16_t replayLength;           // Frame read ahead from pcapIn, 0 if none
+static uint64_t replayStamp;            // Its capture time in microseconds
+static uint64_t replayFirstStamp;
+static uint64_t replayStart;            // CLOCK_MONOTONIC at the first frame
+
+// TX delay line, see TAP_TX_LOSS in linux_tap.h
+static TAP_TX_FRAME *txQueue;           // NULL without delay nor rate limit
+static uint16_t txFirst;
+static uint16_t txCount;
+static uint64_t txLineFree;             // End of the transmission of the last frame on the limited link
+static uint32_t txLossThreshold;        // Drop when the random number is below it, 0 for no loss
+static uint32_t txDelay;                // Microseconds
+static uint32_t txRate;                 // Kilobits per second, 0 for no limit
+static uint32_t txRandom = 1;
+static uint32_t txDropped;
+
+static uint64_t MonotonicMicroseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+}
+
+static uint32_t PcapSwap(uint32_t v)
+{
+    return pcapSwapped ? __builtin_bswap32(v) : v;
+}
+
+// Number of bytes that can be accessed at address without leaving macRAM
+static uint16_t RAMSpan(PTR_BASE address, uint16_t len)
+{
+    if (address >= RAMSIZE)
+        return 0;
+    if (len > RAMSIZE - address)
+        return (uint16_t)(RAMSIZE - address);
+    return len;
+}
+
+static bool PcapOpenInput(const char *path)
+{
+    PCAP_FILE_HEADER header;
+
+    pcapIn = fopen(path, "rb");
+    if (pcapIn == NULL)
+    {
+        perror(path);
+        return false;
+    }
+    // A record must not wait in the stdio buffer while the pipe is empty
+    pcapInPipe = TAPDeviceIsPipe(fileno(pcapIn));
+    if (pcapInPipe)
+        setvbuf(pcapIn, NULL, _IONBF, 0);
+    if (fread(&header, sizeof(header), 1, pcapIn) != 1)
+    {
+        fprintf(stderr, "%s: truncated pcap header\n", path);
+        goto error;
+    }
+
+    pcapSwapped = (header.magic == __builtin_bswap32(PCAP_MAGIC) || header.magic == __builtin_bswap32(PCAP_MAGIC_NSEC));
+    header.magic = PcapSwap(header.magic);
+    if (header.magic != PCAP_MAGIC && header.magic != PCAP_MAGIC_NSEC)
+    {
+        fprintf(stderr, "%s: not a pcap file\n", path);
+        goto error;
+    }
+    pcapNano = (header.magic == PCAP_MAGIC_NSEC);
+    if (PcapSwap(header.linkType) != PCAP_LINKTYPE_ETHERNET)
+    {
+        fprintf(stderr, "%s: link type %lu is not Ethernet\n", path, (unsigned long)PcapSwap(header.linkType));
+        goto error;
+    }
+    return true;
+
+error:
+    fclose(pcapIn);
+    pcapIn = NULL;
+    return false;
+}
+
+static void PcapOpenOutput(const char *path)
+{
+    PCAP_FILE_HEADER header;
+
+    pcapOut = fopen(path, "wb");
+    if (pcapOut == NULL)
+    {
+        perror(path);
+        return;
+    }
+    pcapOutPipe = TAPDeviceIsPipe(fileno(pcapOut));
+
+    header.magic = PCAP_MAGIC;
+    header.versionMajor = 2;
+    header.versionMinor = 4;
+    header.thisZone = 0;
+    header.sigFigs = 0;
+    header.snapLen = ETHER_MAX_FRAME;
+    header.linkType = PCAP_LINKTYPE_ETHERNET;
+    fwrite(&header, sizeof(header), 1, pcapOut);
+    if (pcapOutPipe)
+        fflush(pcapOut);
+}
+
+static void PcapWrite(const uint8_t *frame, uint16_t len)
+{
+    PCAP_RECORD_HEADER record;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    record.seconds = (uint32_t)ts.tv_sec;
+    record.fraction = (uint32_t)(ts.tv_nsec / 1000);
+    record.capturedLen = len;
+    record.originalLen = len;
+    fwrite(&record, sizeof(record), 1, pcapOut);
+    fwrite(frame, 1, len, pcapOut);
+    if (pcapOutPipe)
+        fflush(pcapOut);
+}
+
+static void TxWire(const uint8_t *frame, uint16_t len)
+{
+    if (tapFd >= 0)
+        TAPDeviceWrite(tapFd, frame, len);
+    if (pcapOut != NULL)
+        PcapWrite(frame, len);
+}
+
+static uint32_t EnvNumber(const char *name)
+{
+    const char *value = getenv(name);
+
+    return value != NULL ? strtoul(value, NULL, 10) : 0u;
+}
+
+static void TxLineInit(void)
+{
+    double loss = getenv("TAP_TX_LOSS") != NULL ? atof(getenv("TAP_TX_LOSS")) : 0.0;
+
+    txLossThreshold = (loss > 0.0) ? (uint32_t)(loss / 100.0 * 4294967295.0) : 0u;
+    txDelay = EnvNumber("TAP_TX_DELAY_MS") * 1000ul;
+    txRate = EnvNumber("TAP_TX_RATE_KBPS");
+    if (getenv("TAP_TX_SEED") != NULL)
+        txRandom = EnvNumber("TAP_TX_SEED") | 1u;
+    txFirst = 0;
+    txCount = 0;
+    txLineFree = 0;
+    txDropped = 0;
+
+    if ((txDelay != 0u || txRate != 0u) && txQueue == NULL)
+        txQueue = malloc(sizeof(TAP_TX_FRAME) * TAP_TX_QUEUE);
+}
+
+// Puts the frames of the delay line that are due on the wire
+static void TxLinePump(void)
+{
+    uint64_t now;
+
+    if (txCount == 0u)
+        return;
+
+    now = MonotonicMicroseconds();
+    while (txCount != 0u && txQueue[txFirst].due <= now)
+    {
+        TxWire(txQueue[txFirst].data, txQueue[txFirst].length);
+        if (++txFirst == TAP_TX_QUEUE)
+            txFirst = 0;
+        txCount--;
+    }
+}
+
+// Reads ahead the next usable frame of the capture into replayFrame
+static void PcapReadAhead(void)
+{
+    PCAP_RECORD_HEADER record;
+    uint32_t len;
+
+    while (replayLength == 0u && pcapIn != NULL)
+    {
+        // End of file is readable too, and closes the replay below
+        if (pcapInPipe && !TAPDeviceIsReadable(fileno(pcapIn)))
+            return;
+        if (fread(&record, sizeof(record), 1, pcapIn) != 1)
+        {
+            fclose(pcapIn);
+            pcapIn = NULL;
+            return;
+        }
+
+        len = PcapSwap(record.capturedLen);
+        if (len < sizeof(ETHER_HEADER) || len > sizeof(replayFrame))
+        {
+            // Runt or jumbo frame, the hardware would drop it too.  Read
+            // rather than seek past it, a pipe cannot seek.
+            while (len != 0u)
+            {
+                uint32_t chunk = (len < sizeof(replayFrame)) ? len : sizeof(replayFrame);
+
+                if (fread(replayFrame, 1, chunk, pcapIn) != chunk)
+                    break;
+                len -= chunk;
+            }
+            continue;
+        }
+        if (fread(replayFrame, 1, len, pcapIn) != len)
+        {
+            fclose(pcapIn);
+            pcapIn = NULL;
+            return;
+        }
+
+        replayLength = (uint16_t)len;
+        replayStamp = (uint64_t)PcapSwap(record.seconds) * 1000000ull +
+                (pcapNano ? PcapSwap(record.fraction) / 1000ul : PcapSwap(record.fraction));
+    }
+}
+
+// Copies the next received frame to the RX buffer at address, returns its
+// length or 0
+static uint16_t TapReceive(PTR_BASE address)
+{
+    uint16_t len;
+
+    if (tapFd >= 0)
+        return TAPDeviceRead(tapFd, &macRAM[address], ETHER_MAX_FRAME);
+
+    PcapReadAhead();
+    if (replayLength == 0u)
+        return 0;
+
+    if (replayStart == 0u)
+    {
+        replayStart = MonotonicMicroseconds();
+        replayFirstStamp = replayStamp;
+    }
+#if defined(TAP_PCAP_REALTIME)
+    if (MonotonicMicroseconds() - replayStart < replayStamp - replayFirstStamp)
+        return 0;
+#endif
+
+    len = replayLength;
+    memcpy(&macRAM[address], replayFrame, len);
+    replayLength = 0;
+    return (uint16_t)len;
+}
+
+// Forgets the oldest frames once they are no longer used
+static void RxFreeFrames(void)
+{
+    while (rxCount != 0u && rxFrames[rxFirst].state == RX_FRAME_FREE)
+    {
+        if (++rxFirst == TAP_RX_FRAMES)
+            rxFirst = 0;
+        rxCount--;
+    }
+}
+
+// Address where a frame of maximum size fits in the RX ring, or RXSTOP + 1
+static PTR_BASE RxRoom(void)
+{
+    TAP_RX_FRAME *last;
+    PTR_BASE first, next;
+
+    if (rxCount == 0u)
+        return RXSTART;
+    if (rxCount == TAP_RX_FRAMES)
+        return RXSTOP + 1u;
+
+    last = &rxFrames[(rxFirst + rxCount - 1u) % TAP_RX_FRAMES];
+    first = rxFrames[rxFirst].start;
+    next = last->start + last->length;
+
+    if (next > first)
+    {
+        if (RXSTOP + 1u - next >= ETHER_MAX_FRAME)
+            return next;
+        if (first - RXSTART > ETHER_MAX_FRAME)
+            return RXSTART;
+    }
+    else if (first - next > ETHER_MAX_FRAME)
+        return next;
+
+    return RXSTOP + 1u;
+}
+
+/******************************************************************************
+ * Function:        void MACInit(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Opens the TAP device, or the capture file to replay, and
+ *                  the optional TX capture file.
+ *
+ * Note:            On error the reason is printed and MACIsLinked() stays
+ *                  false.
+ *****************************************************************************/
+void MACInit(void)
+{
+    const char *interface = getenv("TAP_INTERFACE");
+    const char *input = getenv("TAP_PCAP_INPUT");
+    const char *output = getenv("TAP_PCAP_OUTPUT");
+
+    if (interface == NULL)
+        interface = TAP_INTERFACE;
+#if defined(TAP_PCAP_INPUT)
+    if (input == NULL)
+        input = TAP_PCAP_INPUT;
+#endif
+#if defined(TAP_PCAP_OUTPUT)
+    if (output == NULL)
+        output = TAP_PCAP_OUTPUT;
+#endif
+
+    rdPtr = BASE_TCB_ADDR;
+    wrPtr = BASE_TX_ADDR;
+    txLength = 0;
+    rxFirst = 0;
+    rxCount = 0;
+    rxFrame = RXSTART;
+    replayLength = 0;
+    replayStart = 0;
+    TxLineInit();
+
+    if (input != NULL && input[0] != '\0')
+        PcapOpenInput(input);
+    else
+        tapFd = TAPDeviceOpen(interface);
+
+    if (output != NULL && output[0] != '\0')
+        PcapOpenOutput(output);
+}
+
+/******************************************************************************
+ * Function:        bool MACTapReplayDone(void)
+ *
+ * PreCondition:    MACInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          true: In replay mode, once every frame of the capture
+ *                        has been handed to the stack
+ *                  false: Otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Lets a benchmark stop when the replay is over.
+ *
+ * Note:            None
+ *****************************************************************************/
+bool MACTapReplayDone(void)
+{
+    return tapFd < 0 && pcapIn == NULL && replayLength == 0u;
+}
+
+/******************************************************************************
+ * Function:        uint32_t MACTapTxDropped(void)
+ *
+ * PreCondition:    MACInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          Frames dropped by the TX delay line since MACInit()
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Lets a benchmark report the losses of TAP_TX_LOSS and
+ *                  of the queue of TAP_TX_RATE_KBPS.
+ *
+ * Note:            None
+ *****************************************************************************/
+uint32_t MACTapTxDropped(void)
+{
+    return txDropped;
+}
+
+/******************************************************************************
+ * Function:        void MACTapWait(uint32_t microseconds)
+ *
+ * PreCondition:    MACInit() has been called.
+ *
+ * Input:           microseconds: Longest wait
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Lets an idle hook sleep like a PIC would until its next
+ *                  interrupt: returns when a frame can be read from the TAP
+ *                  device or the capture pipe, when the next frame of the
+ *                  TX delay line is due, after the given time, or on a
+ *                  signal.
+ *
+ * Note:            Returns at once while a frame of the capture waits to
+ *                  be received, or when the capture is a file.
+ *****************************************************************************/
+void MACTapWait(uint32_t microseconds)
+{
+    uint64_t now;
+    int fd = tapFd;
+
+    if (replayLength != 0u || (pcapIn != NULL && !pcapInPipe))
+        return;
+    if (pcapIn != NULL)
+        fd = fileno(pcapIn);
+
+    if (txCount != 0u)
+    {
+        now = MonotonicMicroseconds();
+        if (txQueue[txFirst].due <= now)
+            return;
+        if (txQueue[txFirst].due - now < microseconds)
+            microseconds = (uint32_t)(txQueue[txFirst].due - now);
+    }
+    TAPDeviceWait(fd, microseconds);
+}
+
+/******************************************************************************
+ * Function:        bool MACIsLinked(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          true: If the TAP device or the capture file is open
+ *                  false: Otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:        A TAP device has no link state of its own, the kernel
+ *                  queues the frames even while the interface is down.
+ *
+ * Note:            The link stays up after the end of a replay so that the
+ *                  stack keeps its state.
+ *****************************************************************************/
+bool MACIsLinked(void)
+{
+    return tapFd >= 0 || pcapIn != NULL || replayStart != 0u;
+}
+
+/******************************************************************************
+ * Function:        bool MACIsTxReady(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          true, MACFlush() hands the frame to the kernel at once.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        None
+ *
+ * Note:            None
+ *****************************************************************************/
+bool MACIsTxReady(void)
+{
+    return true;
+}
+
+/******************************************************************************
+ * Function:        void MACDiscardRx(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Marks the last received frame as discarded, freeing its
+ *                  space in the RX buffer once the frames held before it
+ *                  are released.
+ *
+ * Note:            It is safe to call this function multiple times between
+ *                  MACGetHeader() calls.
+ *****************************************************************************/
+void MACDiscardRx(void)
+{
+    TAP_RX_FRAME *last;
+
+    if (rxCount == 0u)
+        return;
+
+    last = &rxFrames[(rxFirst + rxCount - 1u) % TAP_RX_FRAMES];
+    if (last->state == RX_FRAME_CURRENT)
+        last->state = RX_FRAME_FREE;
+    RxFreeFrames();
+}
+
+/******************************************************************************
+ * Function:        PTR_BASE MACHoldRx(void)
+ *
+ * PreCondition:    MACGetHeader() returned true.
+ *
+ * Input:           None
+ *
+ * Output:          The read pointer, an address inside the frame
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Keeps the last received frame in the RX buffer.  The
+ *                  next MACGetHeader() moves on to the following frame
+ *                  without discarding it, and the frame can still be read
+ *                  with MACSetReadPtr() until MACReleaseRx() is called.
+ *
+ * Note:            Held frames take RX buffer space from the frames that
+ *                  arrive after them, see MACGetFreeRxSize().
+ *****************************************************************************/
+PTR_BASE MACHoldRx(void)
+{
+    TAP_RX_FRAME *last;
+
+    if (rxCount != 0u)
+    {
+        last = &rxFrames[(rxFirst + rxCount - 1u) % TAP_RX_FRAMES];
+        if (last->state == RX_FRAME_CURRENT)
+            last->state = RX_FRAME_HELD;
+    }
+
+    return rdPtr;
+}
+
+/******************************************************************************
+ * Function:        void MACReleaseRx(PTR_BASE address)
+ *
+ * PreCondition:    None
+ *
+ * Input:           address: Any address inside a frame kept by MACHoldRx(),
+ *                           ex: the value it returned
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Frees the frame.  Its space is reused once the frames
+ *                  received before it are freed too.
+ *
+ * Note:            Addresses outside of the held frames are ignored.
+ *****************************************************************************/
+void MACReleaseRx(PTR_BASE address)
+{
+    TAP_RX_FRAME *frame;
+    uint8_t i;
+
+    for (i = 0; i < rxCount; i++)
+    {
+        frame = &rxFrames[(rxFirst + i) % TAP_RX_FRAMES];
+        if (frame->state == RX_FRAME_HELD && address >= frame->start &&
+                address - frame->start < frame->length)
+        {
+            frame->state = RX_FRAME_FREE;
+            RxFreeFrames();
+            return;
+        }
+    }
+}
+
+/******************************************************************************
+ * Function:        uint16_t MACGetFreeRxSize(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          An estimate of how much RX buffer space is free at the
+ *                  present time.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        None
+ *
+ * Note:            None
+ *****************************************************************************/
+uint16_t MACGetFreeRxSize(void)
+{
+    TAP_RX_FRAME *last;
+    PTR_BASE first, next;
+
+    if (rxCount == 0u)
+        return (uint16_t)(RXSIZE - 1u);
+
+    last = &rxFrames[(rxFirst + rxCount - 1u) % TAP_RX_FRAMES];
+    first = rxFrames[rxFirst].start;
+    next = last->start + last->length;
+
+    if (next > first)
+        return (uint16_t)((RXSTOP + 1u - next) + (first - RXSTART));
+    return (uint16_t)(first - next);
+}
+
+/******************************************************************************
+ * Function:        bool MACGetHeader(MAC_ADDR *remote, uint8_t* type)
+ *
+ * PreCondition:    None
+ *
+ * Input:           *remote: Location to store the Source MAC address of the
+ *                           received frame.
+ *                  *type: Location of a uint8_t to store the constant
+ *                         MAC_UNKNOWN, ETHER_IP, or ETHER_ARP, representing
+ *                         the contents of the Ethernet type field.
+ *
+ * Output:          true: If a frame was received.  The remote and type
+ *                        values are updated.
+ *                  false: If no frame was pending, or the frames held
+ *                         leave no room for one.  remote and type are
+ *                         not changed.
+ *
+ * Side Effects:    Last frame is discarded if MACDiscardRx() or
+ *                  MACHoldRx() hasn't already been called.
+ *
+ * Overview:        None
+ *
+ * Note:            None
+ *****************************************************************************/
+bool MACGetHeader(MAC_ADDR *remote, uint8_t* type)
+{
+    ETHER_HEADER *header;
+    PTR_BASE address;
+    uint16_t len;
+
+    MACDiscardRx();
+    TxLinePump();
+
+    // Leave the frame in the kernel queue until there is room for it
+    address = RxRoom();
+    if (address > RXSTOP)
+        return false;
+    header = (ETHER_HEADER *)&macRAM[address];
+
+    while (true)
+    {
+        len = TapReceive(address);
+        if (len == 0u)
+            return false;
+        if (len < sizeof(ETHER_HEADER))
+            continue;
+
+        // Destination filter of the hardware: unicast to us, broadcast and multicast
+        if ((header->DestMACAddr.v[0] & 0x01u) ||
+            memcmp(header->DestMACAddr.v, AppConfig.MyMACAddr.v, sizeof(MAC_ADDR)) == 0)
+            break;
+    }
+
+    rxFrames[(rxFirst + rxCount) % TAP_RX_FRAMES].start = address;
+    rxFrames[(rxFirst + rxCount) % TAP_RX_FRAMES].length = len;
+    rxFrames[(rxFirst + rxCount) % TAP_RX_FRAMES].state = RX_FRAME_CURRENT;
+    rxCount++;
+    rxFrame = address;
+    rdPtr = address + sizeof(ETHER_HEADER);
+
+    memcpy(remote->v, header->SourceMACAddr.v, sizeof(*remote));
+
+    *type = MAC_UNKNOWN;
+    if (header->Type.v[0] == 0x08u && (header->Type.v[1] == MAC_IP || header->Type.v[1] == MAC_ARP))
+        *type = header->Type.v[1];
+
+    return true;
+}
+
+/******************************************************************************
+ * Function:        void MACPutHeader(MAC_ADDR *remote, uint8_t type, uint16_t dataLen)
+ *
+ * PreCondition:    MACIsTxReady() must return true.
+ *
+ * Input:           *remote: Pointer to memory which contains the destination
+ *                           MAC address (6 bytes)
+ *                  type: The constant MAC_ARP or MAC_IP, defining which
+ *                        value to write into the Ethernet header's type field.
+ *                  dataLen: Length of the Ethernet data payload
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes the Ethernet header at the start of the TX buffer
+ *                  and leaves the write pointer on the payload.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACPutHeader(MAC_ADDR *remote, uint8_t type, uint16_t dataLen)
+{
+    ETHER_HEADER *header = (ETHER_HEADER *)&macRAM[BASE_TX_ADDR];
+
+    memcpy(header->DestMACAddr.v, remote->v, sizeof(*remote));
+    memcpy(header->SourceMACAddr.v, AppConfig.MyMACAddr.v, sizeof(MAC_ADDR));
+    header->Type.v[0] = 0x08;
+    header->Type.v[1] = (type == MAC_IP) ? MAC_IP : MAC_ARP;
+
+    txLength = dataLen + sizeof(ETHER_HEADER);
+    wrPtr = BASE_TX_ADDR + sizeof(ETHER_HEADER);
+}
+
+/******************************************************************************
+ * Function:        void MACFlush(void)
+ *
+ * PreCondition:    A packet has been created by calling MACPut() and
+ *                  MACPutHeader().
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes the TX buffer to the TAP device and to the TX
+ *                  capture file, padded to the Ethernet minimum, or to the
+ *                  TX delay line when one is set.
+ *
+ * Note:            The TX buffer is not changed, MACFlush() can be called
+ *                  again to retransmit the same frame.
+ *****************************************************************************/
+void MACFlush(void)
+{
+    uint8_t frame[ETHER_MAX_FRAME];
+    uint16_t len = txLength;
+    uint64_t now;
+    TAP_TX_FRAME *queued;
+
+    if (len > ETHER_MAX_FRAME)
+        len = ETHER_MAX_FRAME;
+    memcpy(frame, &macRAM[BASE_TX_ADDR], len);
+    if (len < ETHER_MIN_FRAME)
+    {
+        memset(&frame[len], 0x00, ETHER_MIN_FRAME - len);
+        len = ETHER_MIN_FRAME;
+    }
+
+    // xorshift32, the same losses for the same TAP_TX_SEED
+    txRandom ^= txRandom << 13;
+    txRandom ^= txRandom >> 17;
+    txRandom ^= txRandom << 5;
+    if (txRandom < txLossThreshold)
+    {
+        txDropped++;
+        return;
+    }
+
+    if (txQueue == NULL)
+    {
+        TxWire(frame, len);
+        return;
+    }
+
+    TxLinePump();
+    if (txCount == TAP_TX_QUEUE)
+    {
+        txDropped++;
+        return;
+    }
+
+    // The frame leaves when the link has sent the frames before it and
+    // itself, and arrives txDelay later
+    now = MonotonicMicroseconds();
+    if (txLineFree < now)
+        txLineFree = now;
+    if (txRate != 0u)
+        txLineFree += (uint64_t)len * 8000ull / txRate;
+    queued = &txQueue[(txFirst + txCount) % TAP_TX_QUEUE];
+    queued->due = txLineFree + txDelay;
+    queued->length = len;
+    memcpy(queued->data, frame, len);
+    txCount++;
+}
+
+/******************************************************************************
+ * Function:        void MACSetReadPtrInRx(uint16_t offset)
+ *
+ * PreCondition:    A packet has been obtained by calling MACGetHeader() and
+ *                  getting a true result.
+ *
+ * Input:           offset: uint16_t specifying how many bytes beyond the Ethernet
+ *                          header's type field to relocate the read pointer.
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The read pointer is updated.  All calls to MACGet() and
+ *                  MACGetArray() will use this new value.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACSetReadPtrInRx(uint16_t offset)
+{
+    rdPtr = rxFrame + sizeof(ETHER_HEADER) + offset;
+}
+
+/******************************************************************************
+ * Function:        PTR_BASE MACSetWritePtr(PTR_BASE address)
+ *
+ * PreCondition:    None
+ *
+ * Input:           address: Address to seek to
+ *
+ * Output:          Old write pointer
+ *
+ * Side Effects:    None
+ *
+ * Overview:        All calls to MACPut() and MACPutArray() will use this
+ *                  new value.
+ *
+ * Note:            None
+ *****************************************************************************/
+PTR_BASE MACSetWritePtr(PTR_BASE address)
+{
+    PTR_BASE oldVal = wrPtr;
+
+    wrPtr = address;
+    return oldVal;
+}
+
+/******************************************************************************
+ * Function:        PTR_BASE MACSetReadPtr(PTR_BASE address)
+ *
+ * PreCondition:    None
+ *
+ * Input:           address: Address to seek to
+ *
+ * Output:          Old read pointer
+ *
+ * Side Effects:    None
+ *
+ * Overview:        All calls to MACGet() and MACGetArray() will use this
+ *                  new value.
+ *
+ * Note:            None
+ *****************************************************************************/
+PTR_BASE MACSetReadPtr(PTR_BASE address)
+{
+    PTR_BASE oldVal = rdPtr;
+
+    rdPtr = address;
+    return oldVal;
+}
+
+/******************************************************************************
+ * Function:        uint16_t MACCalcRxChecksum(uint16_t offset, uint16_t len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           offset  - Number of bytes beyond the beginning of the
+ *                          Ethernet data (first byte after the type field)
+ *                          where the checksum should begin
+ *                  len     - Total number of bytes to include in the checksum
+ *
+ * Output:          16-bit checksum as defined by RFC 793.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function performs a checksum calculation in the MAC
+ *                  buffer itself
+ *
+ * Note:            None
+ *****************************************************************************/
+uint16_t MACCalcRxChecksum(uint16_t offset, uint16_t len)
+{
+    PTR_BASE rdSave = rdPtr;
+    uint16_t checksum;
+
+    rdPtr = rxFrame + sizeof(ETHER_HEADER) + offset;
+    checksum = CalcIPBufferChecksum(len);
+    rdPtr = rdSave;
+
+    return checksum;
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t CalcIPBufferChecksum(uint16_t len)
+
+  Summary:
+    Calculates an IP checksum in the MAC buffer itself.
+
+  Description:
+    This function calculates an IP checksum over an array of input data
+    existing in the MAC buffer, starting at the read pointer.  The checksum
+    is the 16-bit one's complement of one's complement sum of all words in
+    the data (with zero-padding if an odd number of bytes are summed).  This
+    checksum is defined in RFC 793.
+
+  Precondition:
+    The MAC buffer read pointer is set to the start of the data.
+
+  Parameters:
+    len - number of bytes to be checksummed
+
+  Returns:
+    The calculated checksum.
+
+  Remarks:
+    The read pointer is advanced by len, like MACGetArray() does.
+  ***************************************************************************/
+uint16_t CalcIPBufferChecksum(uint16_t len)
+{
+    uint16_t checksum;
+
+    len = RAMSpan(rdPtr, len);
+    checksum = ~CalcIPChecksumAdd(0, &macRAM[rdPtr], len);
+    rdPtr += len;
+
+    return checksum;
+}
+
+/******************************************************************************
+ * Function:        void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           destAddr:   Destination address in the MAC memory to
+ *                              copy to.  If bit 15 is set, the current write
+ *                              pointer will be used instead.
+ *                  sourceAddr: Source address to read from.  If bit 15 is
+ *                              set, the current read pointer will be used
+ *                              instead.
+ *                  len:        Number of bytes to copy
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Bytes are copied within the MAC memory, the copy is
+ *                  finished when the function returns.
+ *
+ * Note:            If bit 15 is used for the sourceAddr or destAddr
+ *                  parameters, then that pointer will get updated with the
+ *                  next address after the read or write.
+ *****************************************************************************/
+void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+{
+    if (destAddr & 0x8000u)
+    {
+        destAddr = wrPtr;
+        wrPtr += len;
+    }
+    if (sourceAddr & 0x8000u)
+    {
+        sourceAddr = rdPtr;
+        rdPtr += len;
+    }
+
+    len = RAMSpan(sourceAddr, RAMSpan(destAddr, len));
+    if (len)
+        memmove(&macRAM[destAddr], &macRAM[sourceAddr], len);
+}
+
+bool MACIsMemCopyDone(void)
+{
+    return true;
+}
+
+/******************************************************************************
+ * Function:        uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           destAddr:   Destination address in the MAC memory
+ *                  sourceAddr: Source address in the MAC memory, the
+ *                              regions must not overlap
+ *                  len:        Number of bytes to copy
+ *
+ * Output:          One's complement sum of the copied bytes, not
+ *                  complemented (see CalcIPChecksumAdd())
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies bytes within the MAC memory and sums them in the
+ *                  same pass, so that TCP data is not read again to
+ *                  calculate the segment checksum.
+ *
+ * Note:            The read and write pointers are not used.
+ *****************************************************************************/
+uint16_t MACMemCopyChecksum(PTR_BASE destAddr, PTR_BASE sourceAddr, uint16_t len)
+{
+    len = RAMSpan(sourceAddr, RAMSpan(destAddr, len));
+    return CalcIPChecksumCopy(0, &macRAM[destAddr], &macRAM[sourceAddr], len);
+}
+
+/******************************************************************************
+ * Function:        uint8_t MACGet(void)
+ *
+ * PreCondition:    The read pointer must point to the place to read from.
+ *
+ * Input:           None
+ *
+ * Output:          Byte read from the MAC memory
+ *
+ * Side Effects:    None
+ *
+ * Overview:        MACGet returns the byte pointed to by the read pointer
+ *                  and increments it so MACGet() can be called again.
+ *
+ * Note:            Reads outside of the MAC memory return 0.
+ *****************************************************************************/
+uint8_t MACGet(void)
+{
+    uint8_t val = 0;
+
+    if (rdPtr < RAMSIZE)
+        val = macRAM[rdPtr];
+    rdPtr++;
+    return val;
+}
+
+/******************************************************************************
+ * Function:        uint16_t MACGetArray(uint8_t *val, uint16_t len)
+ *
+ * PreCondition:    The read pointer must point to the place to read from.
+ *
+ * Input:           *val: Pointer to storage location, NULL to skip bytes
+ *                  len:  Number of bytes to read from the data buffer.
+ *
+ * Output:          Number of bytes read
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads several sequential bytes from the MAC memory.  The
+ *                  read pointer is incremented by len.
+ *
+ * Note:            None
+ *****************************************************************************/
+uint16_t MACGetArray(uint8_t *val, uint16_t len)
+{
+    uint16_t span = RAMSpan(rdPtr, len);
+
+    if (val)
+    {
+        if (span)
+            memcpy(val, &macRAM[rdPtr], span);
+        memset(val + span, 0x00, len - span);
+    }
+    rdPtr += len;
+
+    return len;
+}
+
+/******************************************************************************
+ * Function:        void MACPut(uint8_t val)
+ *
+ * PreCondition:    The write pointer must point to the location to begin
+ *                  writing.
+ *
+ * Input:           Byte to write into the MAC memory
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The write pointer is incremented after the write.
+ *
+ * Note:            Writes outside of the MAC memory are dropped.
+ *****************************************************************************/
+void MACPut(uint8_t val)
+{
+    if (wrPtr < RAMSIZE)
+        macRAM[wrPtr] = val;
+    wrPtr++;
+}
+
+/******************************************************************************
+ * Function:        void MACPutArray(uint8_t *val, uint16_t len)
+ *
+ * PreCondition:    The write pointer must point to the location to begin
+ *                  writing.
+ *
+ * Input:           *val: Pointer to source of bytes to copy.
+ *                  len:  Number of bytes to write to the data buffer.
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes several sequential bytes to the MAC memory.  The
+ *                  write pointer is incremented by len.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACPutArray(uint8_t *val, uint16_t len)
+{
+    uint16_t span = RAMSpan(wrPtr, len);
+
+    if (span)
+        memcpy(&macRAM[wrPtr], val, span);
+    wrPtr += len;
+}
+
+// No hash table to program, MACGetHeader() accepts every multicast frame
+void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
+{
+    (void)DestMACAddr;
+}
+
+void MACPowerDown(void)
+{
+}
+
+void MACPowerUp(void)
+{
+}
+
+#endif // TAP_INTERFACE
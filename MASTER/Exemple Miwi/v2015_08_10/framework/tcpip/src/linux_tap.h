@@ -0,0 +1,67 @@
+/*******************************************************************************
+  File Name:
+    linux_tap.h
+
+  Summary:
+    MAC driver over a Linux TAP device or a pcap capture file.
+
+  Description:
+    Selected in system_config.h by defining TAP_INTERFACE with the name of
+    the TAP device, ex: #define TAP_INTERFACE "tap0".  The stack then runs
+    as a Linux process, with TickGet() bound to CLOCK_MONOTONIC (tick.c).
+
+    The device must exist before the process starts, ex:
+        ip tuntap add dev tap0 mode tap user $USER
+        ip addr add 192.168.10.1/24 dev tap0
+        ip link set tap0 up
+
+    Optional settings:
+      TAP_PCAP_INPUT    Capture file replayed instead of opening the TAP
+                        device (Ethernet link type only).
+      TAP_PCAP_OUTPUT   Capture file receiving every frame sent by the stack.
+      TAP_PCAP_REALTIME Replay the frames with their original spacing instead
+                        of as fast as the stack takes them.
+      TAP_RX_FRAMES     Frames that the RX buffer can hold at once (32).
+      TAP_TX_QUEUE      Frames that the TX delay line can hold (256).
+
+    The environment variables of the same names override TAP_INTERFACE,
+    TAP_PCAP_INPUT and TAP_PCAP_OUTPUT at MACInit(), so that one binary can
+    run several benchmarks.
+
+    A lossy link can be put in front of the TAP device, where netem is not
+    available, with these environment variables read by MACInit():
+      TAP_TX_LOSS       Percentage of the frames sent that are dropped.
+      TAP_TX_DELAY_MS   Delay before a frame reaches the wire.
+      TAP_TX_RATE_KBPS  Rate of the link, the frames queue behind each other
+                        and the ones that find TAP_TX_QUEUE frames waiting
+                        are dropped.
+      TAP_TX_SEED       Seed of the losses, the same losses for the same seed.
+    The frames of the delay line are written out by MACGetHeader(), which
+    StackTask() calls at each pass.  MACTapTxDropped() counts the drops.
+
+    Either capture may be a named pipe, to exchange frames with a scripted
+    peer instead of a file: frames are read from the input pipe as they
+    come, and every frame sent is flushed to the output pipe at once.  The
+    input is opened first, the peer must open it for writing and write the
+    pcap header before opening the output.  The replay, and with it
+    MACTapReplayDone(), ends when the peer closes the input.  See
+    framework/tcpip/test/tap.
+ *******************************************************************************/
+
+#ifndef __LINUX_TAP_H_
+#define __LINUX_TAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tcpip/src/tcpip_types.h"
+
+// Received frames can stay in the RX buffer while the next ones are
+// processed, see MACHoldRx()
+#define MAC_CAN_HOLD_RX
+
+bool MACTapReplayDone(void);
+uint32_t MACTapTxDropped(void);
+void MACTapWait(uint32_t microseconds);
+
+#endif
@@ -0,0 +1,204 @@
+/*******************************************************************************
+  File Name:
+    linux_tap_device.c
+
+  Summary:
+    System calls of the TAP MAC driver.
+
+  Description:
+    See linux_tap_device.h.  Empty when not built for Linux.
+ *******************************************************************************/
+
+#if defined(__linux__)
+
+// ppoll()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#include "tcpip/src/linux_tap_device.h"
+
+/******************************************************************************
+ * Function:        int TAPDeviceOpen(const char *name)
+ *
+ * PreCondition:    The device exists and the process may use it, see
+ *                  linux_tap.h.
+ *
+ * Input:           name: Name of the TAP device, ex: "tap0"
+ *
+ * Output:          The file descriptor, or -1 after printing the reason
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Opens /dev/net/tun in non-blocking mode and binds it to
+ *                  the TAP device, without packet information header.
+ *
+ * Note:            None
+ *****************************************************************************/
+int TAPDeviceOpen(const char *name)
+{
+    struct ifreq ifr;
+    int fd;
+
+    fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+    {
+        perror("/dev/net/tun");
+        return -1;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr) < 0)
+    {
+        perror(name);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/******************************************************************************
+ * Function:        uint16_t TAPDeviceRead(int fd, uint8_t *frame, uint16_t size)
+ *
+ * PreCondition:    fd was returned by TAPDeviceOpen().
+ *
+ * Input:           fd: TAP device
+ *                  frame: Receives the frame, without FCS
+ *                  size: Size of frame, longer frames are truncated
+ *
+ * Output:          Length of the frame, 0 if none is waiting
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads the next frame queued by the kernel.
+ *
+ * Note:            None
+ *****************************************************************************/
+uint16_t TAPDeviceRead(int fd, uint8_t *frame, uint16_t size)
+{
+    ssize_t len = read(fd, frame, size);
+
+    if (len < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            perror("TAP read");
+        return 0;
+    }
+    return (uint16_t)len;
+}
+
+/******************************************************************************
+ * Function:        void TAPDeviceWrite(int fd, const uint8_t *frame, uint16_t len)
+ *
+ * PreCondition:    fd was returned by TAPDeviceOpen().
+ *
+ * Input:           fd: TAP device
+ *                  frame: The frame, padded to the minimum size, without FCS
+ *                  len: Its length
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sends a frame on the TAP device.
+ *
+ * Note:            Errors are printed, the frame is then lost as on a cable.
+ *****************************************************************************/
+void TAPDeviceWrite(int fd, const uint8_t *frame, uint16_t len)
+{
+    if (write(fd, frame, len) < 0)
+        perror("TAP write");
+}
+
+/******************************************************************************
+ * Function:        bool TAPDeviceIsPipe(int fd)
+ *
+ * PreCondition:    None
+ *
+ * Input:           fd: An open file
+ *
+ * Output:          true: If fd is a named pipe or a pipe
+ *                  false: Otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Lets linux_tap.c exchange the capture with a live peer
+ *                  instead of a file, see linux_tap.h.
+ *
+ * Note:            None
+ *****************************************************************************/
+bool TAPDeviceIsPipe(int fd)
+{
+    struct stat st;
+
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+/******************************************************************************
+ * Function:        bool TAPDeviceIsReadable(int fd)
+ *
+ * PreCondition:    None
+ *
+ * Input:           fd: An open file
+ *
+ * Output:          true: If a read would not block, data or end of file
+ *                  false: Otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Polls fd without waiting.
+ *
+ * Note:            None
+ *****************************************************************************/
+bool TAPDeviceIsReadable(int fd)
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/******************************************************************************
+ * Function:        void TAPDeviceWait(int fd, uint32_t microseconds)
+ *
+ * PreCondition:    None
+ *
+ * Input:           fd: An open file, or -1 to only sleep
+ *                  microseconds: Longest wait
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Waits until fd is readable, the time is over or a signal
+ *                  arrives.
+ *
+ * Note:            None
+ *****************************************************************************/
+void TAPDeviceWait(int fd, uint32_t microseconds)
+{
+    struct pollfd pfd;
+    struct timespec ts;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    ts.tv_sec = microseconds / 1000000ul;
+    ts.tv_nsec = (long)(microseconds % 1000000ul) * 1000l;
+    ppoll(&pfd, 1, &ts, NULL);
+}
+
+#endif
@@ -0,0 +1,29 @@
+/*******************************************************************************
+  File Name:
+    linux_tap_device.h
+
+  Summary:
+    System calls of the TAP MAC driver.
+
+  Description:
+    linux_tap_device.c opens, reads and writes the TAP device for
+    linux_tap.c, and tells it when a capture is a named pipe.  It does not
+    include the stack: <unistd.h>, <net/if.h> and the headers they pull in
+    declare gethostname(), socket(), select() and other names that the
+    Berkeley API of the stack declares too.
+ *******************************************************************************/
+
+#ifndef __LINUX_TAP_DEVICE_H_
+#define __LINUX_TAP_DEVICE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+int TAPDeviceOpen(const char *name);
+uint16_t TAPDeviceRead(int fd, uint8_t *frame, uint16_t size);
+void TAPDeviceWrite(int fd, const uint8_t *frame, uint16_t len);
+bool TAPDeviceIsPipe(int fd);
+bool TAPDeviceIsReadable(int fd);
+void TAPDeviceWait(int fd, uint32_t microseconds);
+
+#endif
@@ -90,6 +90,7 @@ extern NODE_INFO remoteNode;
 void NBNSInit(void)
 {
     smNBNS = NBNS_HOME;
+    StackSignal(STACK_MODULE_NBNS, STACK_EVENT_BUSY);
 }
 
 /*********************************************************************
@@ -211,6 +212,10 @@ void NBNSTask(void)
 
         break;
     }
+
+    // Requests wake the module up through UDP once it listens
+    if (smNBNS != NBNS_LISTEN)
+        StackSignal(STACK_MODULE_NBNS, STACK_EVENT_BUSY);
 }
 
 /*********************************************************************
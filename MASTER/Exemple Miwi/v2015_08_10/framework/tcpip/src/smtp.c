@@ -69,6 +69,19 @@ SMTP_POINTERS SMTPClient;
 static IP_ADDR SMTPServer; // IP address of the remote SMTP server
 static TCP_SOCKET MySocket = INVALID_SOCKET; // Socket currently in use by the SMTP client
 
+// Copies of SMTPClient made by SMTPSendMail, sent in order over one connection
+static SMTP_POINTERS SMTPQueue[SMTP_QUEUE_SIZE];
+static uint8_t QueueHead; // Index in SMTPQueue of the message being sent
+static uint8_t QueueCount; // Number of messages in SMTPQueue, including the one being sent
+static SMTP_POINTERS *CurMsg = &SMTPQueue[0]; // Message being sent
+
+// Number of replies still expected for commands sent without waiting for
+// their reply, when the server supports PIPELINING (RFC 2920)
+static uint16_t PendingReplies;
+
+// EHLO keyword of the PIPELINING extension
+static ROM char szPipelining[] = "PIPELINING";
+
 // State machine for the CR LF Period replacement
 // Used by SMTPPut to transparently replace "\r\n." with "\r\n.."
 static union {
@@ -156,9 +169,12 @@ static enum {
     RX_SEEK_LF
 } RXParserState;
 
+// Number of characters of szPipelining matched by the current response line
+static uint8_t RXMatch;
+
 // Internal flags used by the SMTP Client
 static union {
-    uint8_t Val;
+    uint16_t Val;
 
     struct {
         unsigned char RXSkipResponse : 1;
@@ -167,9 +183,12 @@ static union {
         unsigned char ReadyToStart : 1;
         unsigned char ReadyToFinish : 1;
         unsigned char ConnectedOnce : 1;
-        unsigned char filler : 2;
+        unsigned char ServerPipelining : 1; // The server listed PIPELINING in its EHLO reply
+        unsigned char CommandFailed : 1; // A pipelined command was rejected
+        unsigned char UseHELO : 1; // The server rejected EHLO
+        unsigned char filler : 7;
     } bits;
-} SMTPFlags = {0x00};
+} SMTPFlags = {0x0000};
 
 // Response code from server when an error exists
 static uint16_t ResponseCode;
@@ -180,6 +199,8 @@ static uint16_t ResponseCode;
  ***************************************************************************/
 static uint8_t *FindEmailAddress(uint8_t *str, uint16_t *wLen);
 static ROM uint8_t *FindROMEmailAddress(ROM uint8_t *str, uint16_t *wLen);
+static void EndCommand(void);
+static bool StartNextMessage(void);
 
 /****************************************************************************
   Section:
@@ -219,11 +240,15 @@ bool SMTPBeginUsage(void)
     if (SMTPFlags.bits.SMTPInUse)
         return false;
 
-    SMTPFlags.Val = 0x00;
+    SMTPFlags.Val = 0x0000;
     SMTPFlags.bits.SMTPInUse = true;
     TransportState = TRANSPORT_BEGIN;
     RXParserState = RX_BYTE_0;
     SMTPState = SMTP_HOME;
+    QueueHead = 0;
+    QueueCount = 0;
+    CurMsg = &SMTPQueue[0];
+    PendingReplies = 0;
     memset((void *) &SMTPClient, 0x00, sizeof (SMTPClient));
     SMTPClient.ServerPort = SMTP_PORT;
 
@@ -250,7 +275,7 @@ bool SMTPBeginUsage(void)
     None
 
   Return Values:
-    SMTP_SUCCESS - A message was successfully sent
+    SMTP_SUCCESS - All the messages passed to SMTPSendMail were sent
     SMTP_RESOLVE_ERROR - The SMTP server could not be resolved
     SMTP_CONNECT_ERROR - The connection to the SMTP server failed or was
         prematurely terminated
@@ -336,44 +361,44 @@ void SMTPTask(void)
             break;
 
         // Obtain the IP address associated with the SMTP mail server
-        if (SMTPClient.Server.szRAM || SMTPClient.Server.szROM) {
-            if (SMTPClient.ROMPointers.Server)
-                DNSResolveROM(SMTPClient.Server.szROM, DNS_TYPE_A);
+        if (CurMsg->Server.szRAM || CurMsg->Server.szROM) {
+            if (CurMsg->ROMPointers.Server)
+                DNSResolveROM(CurMsg->Server.szROM, DNS_TYPE_A);
             else
-                DNSResolve(SMTPClient.Server.szRAM, DNS_TYPE_A);
+                DNSResolve(CurMsg->Server.szRAM, DNS_TYPE_A);
         } else {
             // If we don't have a mail server, try to send the mail
             // directly to the destination SMTP server
-            if (SMTPClient.To.szRAM && !SMTPClient.ROMPointers.To) {
-                SMTPClient.Server.szRAM = (uint8_t *) strchr((char *) SMTPClient.To.szRAM, '@');
-                SMTPClient.ROMPointers.Server = 0;
-            } else if (SMTPClient.To.szROM && SMTPClient.ROMPointers.To) {
-                SMTPClient.Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) SMTPClient.To.szROM, '@');
-                SMTPClient.ROMPointers.Server = 1;
+            if (CurMsg->To.szRAM && !CurMsg->ROMPointers.To) {
+                CurMsg->Server.szRAM = (uint8_t *) strchr((char *) CurMsg->To.szRAM, '@');
+                CurMsg->ROMPointers.Server = 0;
+            } else if (CurMsg->To.szROM && CurMsg->ROMPointers.To) {
+                CurMsg->Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) CurMsg->To.szROM, '@');
+                CurMsg->ROMPointers.Server = 1;
             }
 
-            if (!(SMTPClient.Server.szRAM || SMTPClient.Server.szROM)) {
-                if (SMTPClient.CC.szRAM && !SMTPClient.ROMPointers.CC) {
-                    SMTPClient.Server.szRAM = (uint8_t *) strchr((char *) SMTPClient.CC.szRAM, '@');
-                    SMTPClient.ROMPointers.Server = 0;
-                } else if (SMTPClient.CC.szROM && SMTPClient.ROMPointers.CC) {
-                    SMTPClient.Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) SMTPClient.CC.szROM, '@');
-                    SMTPClient.ROMPointers.Server = 1;
+            if (!(CurMsg->Server.szRAM || CurMsg->Server.szROM)) {
+                if (CurMsg->CC.szRAM && !CurMsg->ROMPointers.CC) {
+                    CurMsg->Server.szRAM = (uint8_t *) strchr((char *) CurMsg->CC.szRAM, '@');
+                    CurMsg->ROMPointers.Server = 0;
+                } else if (CurMsg->CC.szROM && CurMsg->ROMPointers.CC) {
+                    CurMsg->Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) CurMsg->CC.szROM, '@');
+                    CurMsg->ROMPointers.Server = 1;
                 }
             }
 
-            if (!(SMTPClient.Server.szRAM || SMTPClient.Server.szROM)) {
-                if (SMTPClient.BCC.szRAM && !SMTPClient.ROMPointers.BCC) {
-                    SMTPClient.Server.szRAM = (uint8_t *) strchr((char *) SMTPClient.BCC.szRAM, '@');
-                    SMTPClient.ROMPointers.Server = 0;
-                } else if (SMTPClient.BCC.szROM && SMTPClient.ROMPointers.BCC) {
-                    SMTPClient.Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) SMTPClient.BCC.szROM, '@');
-                    SMTPClient.ROMPointers.Server = 1;
+            if (!(CurMsg->Server.szRAM || CurMsg->Server.szROM)) {
+                if (CurMsg->BCC.szRAM && !CurMsg->ROMPointers.BCC) {
+                    CurMsg->Server.szRAM = (uint8_t *) strchr((char *) CurMsg->BCC.szRAM, '@');
+                    CurMsg->ROMPointers.Server = 0;
+                } else if (CurMsg->BCC.szROM && CurMsg->ROMPointers.BCC) {
+                    CurMsg->Server.szROM = (ROM uint8_t *) strchrpgm((ROM char *) CurMsg->BCC.szROM, '@');
+                    CurMsg->ROMPointers.Server = 1;
                 }
             }
 
             // See if we found a hostname anywhere which we could resolve
-            if (!(SMTPClient.Server.szRAM || SMTPClient.Server.szROM)) {
+            if (!(CurMsg->Server.szRAM || CurMsg->Server.szROM)) {
                 DNSEndUsage();
                 ResponseCode = SMTP_RESOLVE_ERROR;
                 TransportState = TRANSPORT_HOME;
@@ -381,12 +406,12 @@ void SMTPTask(void)
             }
 
             // Skip over the @ sign and resolve the host name
-            if (SMTPClient.ROMPointers.Server) {
-                SMTPClient.Server.szROM++;
-                DNSResolveROM(SMTPClient.Server.szROM, DNS_TYPE_MX);
+            if (CurMsg->ROMPointers.Server) {
+                CurMsg->Server.szROM++;
+                DNSResolveROM(CurMsg->Server.szROM, DNS_TYPE_MX);
             } else {
-                SMTPClient.Server.szRAM++;
-                DNSResolve(SMTPClient.Server.szRAM, DNS_TYPE_MX);
+                CurMsg->Server.szRAM++;
+                DNSResolve(CurMsg->Server.szRAM, DNS_TYPE_MX);
             }
         }
 
@@ -420,7 +445,7 @@ void SMTPTask(void)
 
     case TRANSPORT_OBTAIN_SOCKET:
         // Connect a TCP socket to the remote SMTP server
-        MySocket = TCPOpen(SMTPServer.Val, TCP_OPEN_IP_ADDRESS, SMTPClient.ServerPort, TCP_PURPOSE_DEFAULT);
+        MySocket = TCPOpen(SMTPServer.Val, TCP_OPEN_IP_ADDRESS, CurMsg->ServerPort, TCP_PURPOSE_DEFAULT);
 
         // Abort operation if no TCP sockets are available
         // If this ever happens, add some more
@@ -449,7 +474,7 @@ void SMTPTask(void)
         SMTPFlags.bits.ConnectedOnce = true;
 
         // Start SSL if needed for this connection
-        if (SMTPClient.UseSSL && !TCPStartSSLClient(MySocket, NULL))
+        if (CurMsg->UseSSL && !TCPStartSSLClient(MySocket, NULL))
             break;
 
         // Move on to main state
@@ -475,7 +500,7 @@ void SMTPTask(void)
 
 #if defined(STACK_USE_SSL_CLIENT)
         // Make sure the SSL handshake has completed
-        if (SMTPClient.UseSSL && TCPSSLIsHandshaking(MySocket))
+        if (CurMsg->UseSSL && TCPSSLIsHandshaking(MySocket))
             break;
 #endif
 
@@ -494,10 +519,12 @@ void SMTPTask(void)
                 switch (i) {
                 case ' ':
                     SMTPFlags.bits.RXSkipResponse = false;
+                    RXMatch = 0;
                     RXParserState++;
                     break;
                 case '-':
                     SMTPFlags.bits.RXSkipResponse = true;
+                    RXMatch = 0;
                     RXParserState++;
                     break;
                 case '\r':
@@ -507,8 +534,15 @@ void SMTPTask(void)
                 break;
 
             case RX_SEEK_CR:
-                if (i == '\r')
+                if (i == '\r') {
+                    // Look for a "250-PIPELINING" line in the EHLO reply
+                    if ((SMTPState == SMTP_HELO_ACK) && (RXMatch == sizeof (szPipelining) - 1u))
+                        SMTPFlags.bits.ServerPipelining = true;
                     RXParserState++;
+                } else if ((RXMatch < sizeof (szPipelining) - 1u) && ((i & 0xDFu) == (uint8_t) szPipelining[RXMatch]))
+                    RXMatch++;
+                else
+                    RXMatch = 0xFF;
                 break;
 
             case RX_SEEK_LF:
@@ -520,30 +554,48 @@ void SMTPTask(void)
                         // The server sent us a response code
                         // Null terminate the ASCII reponse code so we can convert it to an integer
                         RXBuffer[3] = 0;
-                        ResponseCode = atoi((char *) RXBuffer);
+                        w = atoi((char *) RXBuffer);
+
+                        // Once a pipelined command failed, keep its code
+                        // rather than the ones of the following commands
+                        if (!SMTPFlags.bits.CommandFailed)
+                            ResponseCode = w;
+
+                        // Replies to pipelined commands arrive in the order
+                        // of the commands, before the reply to DATA
+                        if (PendingReplies) {
+                            PendingReplies--;
+                            if (w < 200u || w > 299u)
+                                SMTPFlags.bits.CommandFailed = true;
+                            continue;
+                        }
 
                         // Handle the response
                         switch (SMTPState) {
                         case SMTP_HELO_ACK:
-                            if (ResponseCode >= 200u && ResponseCode <= 299u) {
-                                if (SMTPClient.Username.szRAM || SMTPClient.Username.szROM)
+                            if (w >= 200u && w <= 299u) {
+                                if (CurMsg->Username.szRAM || CurMsg->Username.szROM)
                                     SMTPState = SMTP_AUTH_LOGIN;
                                 else
                                     SMTPState = SMTP_MAILFROM;
+                            } else if (!SMTPFlags.bits.UseHELO && !(CurMsg->Username.szRAM || CurMsg->Username.szROM)) {
+                                // Older servers may not know EHLO
+                                SMTPFlags.bits.UseHELO = true;
+                                SMTPState = SMTP_HELO;
                             } else
                                 SMTPState = SMTP_QUIT_INIT;
                             break;
 
                         case SMTP_AUTH_LOGIN_ACK:
                         case SMTP_AUTH_USERNAME_ACK:
-                            if (ResponseCode == 334u)
+                            if (w == 334u)
                                 SMTPState++;
                             else
                                 SMTPState = SMTP_QUIT_INIT;
                             break;
 
                         case SMTP_AUTH_PASSWORD_ACK:
-                            if (ResponseCode == 235u)
+                            if (w == 235u)
                                 SMTPState++;
                             else
                                 SMTPState = SMTP_QUIT_INIT;
@@ -554,22 +606,31 @@ void SMTPTask(void)
                         case SMTP_RCPTTO_ACK:
                         case SMTP_RCPTTOCC_ACK:
                         case SMTP_RCPTTOBCC_ACK:
-                            if (ResponseCode >= 200u && ResponseCode <= 299u)
+                            if (w >= 200u && w <= 299u)
                                 SMTPState++;
                             else
                                 SMTPState = SMTP_QUIT_INIT;
                             break;
 
                         case SMTP_DATA_ACK:
-                            if (ResponseCode == 354u)
-                                SMTPState++;
-                            else
+                            if (w == 354u) {
+                                // The server now takes everything as message
+                                // text, so a message with a rejected pipelined
+                                // command can only be dropped by closing
+                                if (SMTPFlags.bits.CommandFailed)
+                                    TransportState = TRANSPORT_CLOSE;
+                                else
+                                    SMTPState++;
+                            } else
                                 SMTPState = SMTP_QUIT_INIT;
                             break;
 
                         case SMTP_DATA_BODY_ACK:
-                            if (ResponseCode >= 200u && ResponseCode <= 299u)
+                            if (w >= 200u && w <= 299u) {
+                                if (StartNextMessage())
+                                    break;
                                 SMTPFlags.bits.SentSuccessfully = true;
+                            }
 
                             SMTPState = SMTP_QUIT_INIT;
                             break;
@@ -592,7 +653,9 @@ void SMTPTask(void)
 
         switch (SMTPState) {
         case SMTP_HELO:
-            if (SMTPClient.Username.szROM == NULL)
+            // EHLO is needed for AUTH and to learn if the server supports
+            // PIPELINING, HELO is only sent if the server rejected EHLO
+            if (SMTPFlags.bits.UseHELO)
                 TCPPutROMString(MySocket, (ROM uint8_t *) "HELO MCHPBOARD\r\n");
             else
                 TCPPutROMString(MySocket, (ROM uint8_t *) "EHLO MCHPBOARD\r\n");
@@ -602,8 +665,8 @@ void SMTPTask(void)
 
         case SMTP_AUTH_LOGIN:
             // Note: This state is only entered from SMTP_HELO_ACK if the application
-            // has specified a Username to use (either SMTPClient.Username.szROM or
-            // SMTPClient.Username.szRAM is non-NULL)
+            // has specified a Username to use (either CurMsg->Username.szROM or
+            // CurMsg->Username.szRAM is non-NULL)
             TCPPutROMString(MySocket, (ROM uint8_t *) "AUTH LOGIN\r\n");
             TCPFlush(MySocket);
             SMTPState++;
@@ -611,18 +674,18 @@ void SMTPTask(void)
 
         case SMTP_AUTH_USERNAME:
             // Base 64 encode and transmit the username.
-            if (SMTPClient.ROMPointers.Username) {
-                ROMStrPtr = SMTPClient.Username.szROM;
+            if (CurMsg->ROMPointers.Username) {
+                ROMStrPtr = CurMsg->Username.szROM;
                 w = strlenpgm((ROM char *) ROMStrPtr);
             } else {
-                RAMStrPtr = SMTPClient.Username.szRAM;
+                RAMStrPtr = CurMsg->Username.szRAM;
                 w = strlen((char *) RAMStrPtr);
             }
 
             while (w) {
                 i = 0;
                 while ((i < w) && (i < sizeof (vBase64Buffer)*3 / 4)) {
-                    if (SMTPClient.ROMPointers.Username)
+                    if (CurMsg->ROMPointers.Username)
                         vBase64Buffer[i] = *ROMStrPtr++;
                     else
                         vBase64Buffer[i] = *RAMStrPtr++;
@@ -639,18 +702,18 @@ void SMTPTask(void)
 
         case SMTP_AUTH_PASSWORD:
             // Base 64 encode and transmit the password
-            if (SMTPClient.ROMPointers.Password) {
-                ROMStrPtr = SMTPClient.Password.szROM;
+            if (CurMsg->ROMPointers.Password) {
+                ROMStrPtr = CurMsg->Password.szROM;
                 w = strlenpgm((ROM char *) ROMStrPtr);
             } else {
-                RAMStrPtr = SMTPClient.Password.szRAM;
+                RAMStrPtr = CurMsg->Password.szRAM;
                 w = strlen((char *) RAMStrPtr);
             }
 
             while (w) {
                 i = 0;
                 while ((i < w) && (i < sizeof (vBase64Buffer)*3 / 4)) {
-                    if (SMTPClient.ROMPointers.Password)
+                    if (CurMsg->ROMPointers.Password)
                         vBase64Buffer[i] = *ROMStrPtr++;
                     else
                         vBase64Buffer[i] = *RAMStrPtr++;
@@ -670,29 +733,28 @@ void SMTPTask(void)
             // not what actually will be displayed in the recipients mail client as a
             // return address.
             TCPPutROMString(MySocket, (ROM uint8_t *) "MAIL FROM:<");
-            if (SMTPClient.ROMPointers.From) {
-                ROMStrPtr = FindROMEmailAddress(SMTPClient.From.szROM, &wAddressLength);
+            if (CurMsg->ROMPointers.From) {
+                ROMStrPtr = FindROMEmailAddress(CurMsg->From.szROM, &wAddressLength);
                 TCPPutROMArray(MySocket, ROMStrPtr, wAddressLength);
             } else {
-                RAMStrPtr = FindEmailAddress(SMTPClient.From.szRAM, &wAddressLength);
+                RAMStrPtr = FindEmailAddress(CurMsg->From.szRAM, &wAddressLength);
                 TCPPutArray(MySocket, RAMStrPtr, wAddressLength);
             }
             TCPPutROMString(MySocket, (ROM uint8_t *) ">\r\n");
-            TCPFlush(MySocket);
-            SMTPState++;
+            EndCommand();
             break;
 
         case SMTP_RCPTTO_INIT:
             // See if there are any (To) recipients to process
-            if (SMTPClient.To.szRAM && !SMTPClient.ROMPointers.To) {
-                RAMStrPtr = FindEmailAddress(SMTPClient.To.szRAM, &wAddressLength);
+            if (CurMsg->To.szRAM && !CurMsg->ROMPointers.To) {
+                RAMStrPtr = FindEmailAddress(CurMsg->To.szRAM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTO;
                     break;
                 }
             }
-            if (SMTPClient.To.szROM && SMTPClient.ROMPointers.To) {
-                ROMStrPtr = FindROMEmailAddress(SMTPClient.To.szROM, &wAddressLength);
+            if (CurMsg->To.szROM && CurMsg->ROMPointers.To) {
+                ROMStrPtr = FindROMEmailAddress(CurMsg->To.szROM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTO;
                     break;
@@ -706,21 +768,20 @@ void SMTPTask(void)
         case SMTP_RCPTTOCC:
         case SMTP_RCPTTOBCC:
             TCPPutROMString(MySocket, (ROM uint8_t *) "RCPT TO:<");
-            if ((SMTPClient.ROMPointers.To && (SMTPState == SMTP_RCPTTO)) ||
-                    (SMTPClient.ROMPointers.CC && (SMTPState == SMTP_RCPTTOCC)) ||
-                    (SMTPClient.ROMPointers.BCC && (SMTPState == SMTP_RCPTTOBCC)))
+            if ((CurMsg->ROMPointers.To && (SMTPState == SMTP_RCPTTO)) ||
+                    (CurMsg->ROMPointers.CC && (SMTPState == SMTP_RCPTTOCC)) ||
+                    (CurMsg->ROMPointers.BCC && (SMTPState == SMTP_RCPTTOBCC)))
                 TCPPutROMArray(MySocket, ROMStrPtr, wAddressLength);
             else
                 TCPPutArray(MySocket, RAMStrPtr, wAddressLength);
             TCPPutROMString(MySocket, (ROM uint8_t *) ">\r\n");
-            TCPFlush(MySocket);
-            SMTPState++;
+            EndCommand();
             break;
 
         case SMTP_RCPTTO_ISDONE:
             // See if we have any more (To) recipients to process
             // If we do, we must roll back a couple of states
-            if (SMTPClient.ROMPointers.To)
+            if (CurMsg->ROMPointers.To)
                 ROMStrPtr = FindROMEmailAddress(ROMStrPtr + wAddressLength, &wAddressLength);
             else
                 RAMStrPtr = FindEmailAddress(RAMStrPtr + wAddressLength, &wAddressLength);
@@ -736,15 +797,15 @@ void SMTPTask(void)
 
         case SMTP_RCPTTOCC_INIT:
             // See if there are any Carbon Copy (CC) recipients to process
-            if (SMTPClient.CC.szRAM && !SMTPClient.ROMPointers.CC) {
-                RAMStrPtr = FindEmailAddress(SMTPClient.CC.szRAM, &wAddressLength);
+            if (CurMsg->CC.szRAM && !CurMsg->ROMPointers.CC) {
+                RAMStrPtr = FindEmailAddress(CurMsg->CC.szRAM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTOCC;
                     break;
                 }
             }
-            if (SMTPClient.CC.szROM && SMTPClient.ROMPointers.CC) {
-                ROMStrPtr = FindROMEmailAddress(SMTPClient.CC.szROM, &wAddressLength);
+            if (CurMsg->CC.szROM && CurMsg->ROMPointers.CC) {
+                ROMStrPtr = FindROMEmailAddress(CurMsg->CC.szROM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTOCC;
                     break;
@@ -757,7 +818,7 @@ void SMTPTask(void)
         case SMTP_RCPTTOCC_ISDONE:
             // See if we have any more Carbon Copy (CC) recipients to process
             // If we do, we must roll back a couple of states
-            if (SMTPClient.ROMPointers.CC)
+            if (CurMsg->ROMPointers.CC)
                 ROMStrPtr = FindROMEmailAddress(ROMStrPtr + wAddressLength, &wAddressLength);
             else
                 RAMStrPtr = FindEmailAddress(RAMStrPtr + wAddressLength, &wAddressLength);
@@ -773,15 +834,15 @@ void SMTPTask(void)
 
         case SMTP_RCPTTOBCC_INIT:
             // See if there are any Blind Carbon Copy (BCC) recipients to process
-            if (SMTPClient.BCC.szRAM && !SMTPClient.ROMPointers.BCC) {
-                RAMStrPtr = FindEmailAddress(SMTPClient.BCC.szRAM, &wAddressLength);
+            if (CurMsg->BCC.szRAM && !CurMsg->ROMPointers.BCC) {
+                RAMStrPtr = FindEmailAddress(CurMsg->BCC.szRAM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTOBCC;
                     break;
                 }
             }
-            if (SMTPClient.BCC.szROM && SMTPClient.ROMPointers.BCC) {
-                ROMStrPtr = FindROMEmailAddress(SMTPClient.BCC.szROM, &wAddressLength);
+            if (CurMsg->BCC.szROM && CurMsg->ROMPointers.BCC) {
+                ROMStrPtr = FindROMEmailAddress(CurMsg->BCC.szROM, &wAddressLength);
                 if (wAddressLength) {
                     SMTPState = SMTP_RCPTTOBCC;
                     break;
@@ -795,7 +856,7 @@ void SMTPTask(void)
         case SMTP_RCPTTOBCC_ISDONE:
             // See if we have any more Blind Carbon Copy (CC) recipients to process
             // If we do, we must roll back a couple of states
-            if (SMTPClient.ROMPointers.BCC)
+            if (CurMsg->ROMPointers.BCC)
                 ROMStrPtr = FindROMEmailAddress(ROMStrPtr + wAddressLength, &wAddressLength);
             else
                 RAMStrPtr = FindEmailAddress(RAMStrPtr + wAddressLength, &wAddressLength);
@@ -820,7 +881,7 @@ void SMTPTask(void)
             while ((PutHeadersState != PUTHEADERS_DONE) && (TCPIsPutReady(MySocket) > 64u)) {
                 switch (PutHeadersState) {
                 case PUTHEADERS_FROM_INIT:
-                    if (SMTPClient.From.szRAM || SMTPClient.From.szROM) {
+                    if (CurMsg->From.szRAM || CurMsg->From.szROM) {
                         PutHeadersState = PUTHEADERS_FROM;
                         TCPPutROMString(MySocket, (ROM uint8_t *) "From: ");
                     } else {
@@ -829,19 +890,19 @@ void SMTPTask(void)
                     break;
 
                 case PUTHEADERS_FROM:
-                    if (SMTPClient.ROMPointers.From) {
-                        SMTPClient.From.szROM = TCPPutROMString(MySocket, SMTPClient.From.szROM);
-                        if (*SMTPClient.From.szROM == 0u)
+                    if (CurMsg->ROMPointers.From) {
+                        CurMsg->From.szROM = TCPPutROMString(MySocket, CurMsg->From.szROM);
+                        if (*CurMsg->From.szROM == 0u)
                             PutHeadersState = PUTHEADERS_TO_INIT;
                     } else {
-                        SMTPClient.From.szRAM = TCPPutString(MySocket, SMTPClient.From.szRAM);
-                        if (*SMTPClient.From.szRAM == 0u)
+                        CurMsg->From.szRAM = TCPPutString(MySocket, CurMsg->From.szRAM);
+                        if (*CurMsg->From.szRAM == 0u)
                             PutHeadersState = PUTHEADERS_TO_INIT;
                     }
                     break;
 
                 case PUTHEADERS_TO_INIT:
-                    if (SMTPClient.To.szRAM || SMTPClient.To.szROM) {
+                    if (CurMsg->To.szRAM || CurMsg->To.szROM) {
                         PutHeadersState = PUTHEADERS_TO;
                         TCPPutROMString(MySocket, (ROM uint8_t *) "\r\nTo: ");
                     } else {
@@ -850,19 +911,19 @@ void SMTPTask(void)
                     break;
 
                 case PUTHEADERS_TO:
-                    if (SMTPClient.ROMPointers.To) {
-                        SMTPClient.To.szROM = TCPPutROMString(MySocket, SMTPClient.To.szROM);
-                        if (*SMTPClient.To.szROM == 0u)
+                    if (CurMsg->ROMPointers.To) {
+                        CurMsg->To.szROM = TCPPutROMString(MySocket, CurMsg->To.szROM);
+                        if (*CurMsg->To.szROM == 0u)
                             PutHeadersState = PUTHEADERS_CC_INIT;
                     } else {
-                        SMTPClient.To.szRAM = TCPPutString(MySocket, SMTPClient.To.szRAM);
-                        if (*SMTPClient.To.szRAM == 0u)
+                        CurMsg->To.szRAM = TCPPutString(MySocket, CurMsg->To.szRAM);
+                        if (*CurMsg->To.szRAM == 0u)
                             PutHeadersState = PUTHEADERS_CC_INIT;
                     }
                     break;
 
                 case PUTHEADERS_CC_INIT:
-                    if (SMTPClient.CC.szRAM || SMTPClient.CC.szROM) {
+                    if (CurMsg->CC.szRAM || CurMsg->CC.szROM) {
                         PutHeadersState = PUTHEADERS_CC;
                         TCPPutROMString(MySocket, (ROM uint8_t *) "\r\nCC: ");
                     } else {
@@ -871,19 +932,19 @@ void SMTPTask(void)
                     break;
 
                 case PUTHEADERS_CC:
-                    if (SMTPClient.ROMPointers.CC) {
-                        SMTPClient.CC.szROM = TCPPutROMString(MySocket, SMTPClient.CC.szROM);
-                        if (*SMTPClient.CC.szROM == 0u)
+                    if (CurMsg->ROMPointers.CC) {
+                        CurMsg->CC.szROM = TCPPutROMString(MySocket, CurMsg->CC.szROM);
+                        if (*CurMsg->CC.szROM == 0u)
                             PutHeadersState = PUTHEADERS_SUBJECT_INIT;
                     } else {
-                        SMTPClient.CC.szRAM = TCPPutString(MySocket, SMTPClient.CC.szRAM);
-                        if (*SMTPClient.CC.szRAM == 0u)
+                        CurMsg->CC.szRAM = TCPPutString(MySocket, CurMsg->CC.szRAM);
+                        if (*CurMsg->CC.szRAM == 0u)
                             PutHeadersState = PUTHEADERS_SUBJECT_INIT;
                     }
                     break;
 
                 case PUTHEADERS_SUBJECT_INIT:
-                    if (SMTPClient.Subject.szRAM || SMTPClient.Subject.szROM) {
+                    if (CurMsg->Subject.szRAM || CurMsg->Subject.szROM) {
                         PutHeadersState = PUTHEADERS_SUBJECT;
                         TCPPutROMString(MySocket, (ROM uint8_t *) "\r\nSubject: ");
                     } else {
@@ -892,20 +953,20 @@ void SMTPTask(void)
                     break;
 
                 case PUTHEADERS_SUBJECT:
-                    if (SMTPClient.ROMPointers.Subject) {
-                        SMTPClient.Subject.szROM = TCPPutROMString(MySocket, SMTPClient.Subject.szROM);
-                        if (*SMTPClient.Subject.szROM == 0u)
+                    if (CurMsg->ROMPointers.Subject) {
+                        CurMsg->Subject.szROM = TCPPutROMString(MySocket, CurMsg->Subject.szROM);
+                        if (*CurMsg->Subject.szROM == 0u)
                             PutHeadersState = PUTHEADERS_OTHER_INIT;
                     } else {
-                        SMTPClient.Subject.szRAM = TCPPutString(MySocket, SMTPClient.Subject.szRAM);
-                        if (*SMTPClient.Subject.szRAM == 0u)
+                        CurMsg->Subject.szRAM = TCPPutString(MySocket, CurMsg->Subject.szRAM);
+                        if (*CurMsg->Subject.szRAM == 0u)
                             PutHeadersState = PUTHEADERS_OTHER_INIT;
                     }
                     break;
 
                 case PUTHEADERS_OTHER_INIT:
                     TCPPutROMArray(MySocket, (ROM uint8_t *) "\r\n", 2);
-                    if (SMTPClient.OtherHeaders.szRAM || SMTPClient.OtherHeaders.szROM) {
+                    if (CurMsg->OtherHeaders.szRAM || CurMsg->OtherHeaders.szROM) {
                         PutHeadersState = PUTHEADERS_OTHER;
                     } else {
                         TCPPutROMArray(MySocket, (ROM uint8_t *) "\r\n", 2);
@@ -915,16 +976,16 @@ void SMTPTask(void)
                     break;
 
                 case PUTHEADERS_OTHER:
-                    if (SMTPClient.ROMPointers.OtherHeaders) {
-                        SMTPClient.OtherHeaders.szROM = TCPPutROMString(MySocket, SMTPClient.OtherHeaders.szROM);
-                        if (*SMTPClient.OtherHeaders.szROM == 0u) {
+                    if (CurMsg->ROMPointers.OtherHeaders) {
+                        CurMsg->OtherHeaders.szROM = TCPPutROMString(MySocket, CurMsg->OtherHeaders.szROM);
+                        if (*CurMsg->OtherHeaders.szROM == 0u) {
                             TCPPutROMArray(MySocket, (ROM uint8_t *) "\r\n", 2);
                             PutHeadersState = PUTHEADERS_DONE;
                             SMTPState++;
                         }
                     } else {
-                        SMTPClient.OtherHeaders.szRAM = TCPPutString(MySocket, SMTPClient.OtherHeaders.szRAM);
-                        if (*SMTPClient.OtherHeaders.szRAM == 0u) {
+                        CurMsg->OtherHeaders.szRAM = TCPPutString(MySocket, CurMsg->OtherHeaders.szRAM);
+                        if (*CurMsg->OtherHeaders.szRAM == 0u) {
                             TCPPutROMArray(MySocket, (ROM uint8_t *) "\r\n", 2);
                             PutHeadersState = PUTHEADERS_DONE;
                             SMTPState++;
@@ -942,7 +1003,7 @@ void SMTPTask(void)
 
         case SMTP_DATA_BODY_INIT:
             SMTPState++;
-            RAMStrPtr = SMTPClient.Body.szRAM;
+            RAMStrPtr = CurMsg->Body.szRAM;
             ROMStrPtr2 = (ROM uint8_t *) "\r\n.\r\n";
             CRPeriod.Pos = NULL;
             if (RAMStrPtr)
@@ -950,7 +1011,7 @@ void SMTPTask(void)
             // No break here
 
         case SMTP_DATA_BODY:
-            if (SMTPClient.Body.szRAM || SMTPClient.Body.szROM) {
+            if (CurMsg->Body.szRAM || CurMsg->Body.szROM) {
                 if (*ROMStrPtr2) {
                     // Put the application data, doing the transparancy replacement of "\r\n." with "\r\n.."
                     while (CRPeriod.Pos) {
@@ -984,7 +1045,13 @@ void SMTPTask(void)
             }
 
             if (*ROMStrPtr2 == 0u) {
-                SMTPState++;
+                // With PIPELINING, the commands of the next message follow
+                // the end of this one without waiting for its reply
+                if (SMTPFlags.bits.ServerPipelining && (QueueCount > 1u)) {
+                    PendingReplies++;
+                    StartNextMessage();
+                } else
+                    SMTPState++;
             }
             break;
 
@@ -1019,19 +1086,31 @@ void SMTPTask(void)
         TransportState = TRANSPORT_HOME;
         break;
     }
+
+    // Keep StackApplications() calling until the message is sent.  Replies
+    // from the server do not wake the module up.
+    if (TransportState != TRANSPORT_HOME &&
+            (TransportState != TRANSPORT_BEGIN || SMTPFlags.bits.ReadyToStart))
+        StackSignal(STACK_MODULE_SMTP, STACK_EVENT_BUSY);
 }
 
 /*****************************************************************************
   Function:
-    void SMTPSendMail(void)
+    bool SMTPSendMail(void)
 
   Summary:
     Initializes the message sending process.
 
   Description:
-    This function starts the state machine that performs the actual
-    transmission of the message.  Call this function after all the fields
-    in SMTPClient have been set.
+    This function queues a copy of SMTPClient and starts the state machine
+    that performs the actual transmission of the message.  Call this
+    function after all the fields in SMTPClient have been set.
+
+    SMTPClient may then be filled again and this function called again
+    to queue up to SMTP_QUEUE_SIZE messages, which are all sent over the
+    same connection.  When the server supports PIPELINING, the MAIL FROM
+    and RCPT TO commands of a message are sent together with DATA, and
+    right after the end of the previous message.
 
   Precondition:
     SMTPBeginUsage returned true on a previous call.
@@ -1039,12 +1118,33 @@ void SMTPTask(void)
   Parameters:
     None
 
-  Returns:
-    None
+  Return Values:
+    true - The message was queued
+    false - The queue is full, or the client already gave up or finished
+        sending the queued messages.  Wait for SMTPIsBusy to return
+        false, call SMTPEndUsage and start again.
+
+  Remarks:
+    The connection parameters (Server, Username, Password, ServerPort and
+    UseSSL) of the first message are used for all of them.  The strings
+    referenced by the queued messages must remain valid until SMTPIsBusy
+    returns false.  An on-the-fly message (Body set to NULL) must be the
+    last one queued.
+
+    SMTPEndUsage returns SMTP_SUCCESS only if all the messages were sent.
+    The messages following a failed one are not sent.
  ***************************************************************************/
-void SMTPSendMail(void)
+bool SMTPSendMail(void)
 {
+    if ((TransportState == TRANSPORT_HOME) || (TransportState == TRANSPORT_CLOSE) ||
+            (SMTPState >= SMTP_QUIT_INIT) || (QueueCount >= SMTP_QUEUE_SIZE))
+        return false;
+
+    memcpy((void *) &SMTPQueue[(QueueHead + QueueCount) % SMTP_QUEUE_SIZE], (void *) &SMTPClient, sizeof (SMTPClient));
+    QueueCount++;
     SMTPFlags.bits.ReadyToStart = true;
+    StackSignal(STACK_MODULE_SMTP, STACK_EVENT_APP);
+    return true;
 }
 
 /*****************************************************************************
@@ -1409,6 +1509,77 @@ void SMTPPutDone(void)
     SMTPFlags.bits.ReadyToFinish = true;
 }
 
+/*****************************************************************************
+  Function:
+    static void EndCommand(void)
+
+  Summary:
+    Completes a MAIL FROM or RCPT TO command.
+
+  Description:
+    Without PIPELINING, this function transmits the command and moves to
+    the state waiting for its reply.  With PIPELINING, the command stays in
+    the TX buffer to be sent along with the following ones, and the state
+    waiting for its reply is skipped.  The reply is then handled when it
+    arrives, before the reply to DATA.
+
+  Precondition:
+    The command was written to MySocket, SMTPState is the state that sent
+    it, followed by the state waiting for its reply.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void EndCommand(void)
+{
+    if (SMTPFlags.bits.ServerPipelining) {
+        PendingReplies++;
+        SMTPState += 2;
+    } else {
+        TCPFlush(MySocket);
+        SMTPState++;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    static bool StartNextMessage(void)
+
+  Summary:
+    Moves on to the next queued message.
+
+  Description:
+    Releases the message that was just sent from SMTPQueue and, if another
+    one is queued, starts its MAIL FROM command on the same connection.
+
+  Precondition:
+    The whole text of the current message was written to MySocket.
+
+  Parameters:
+    None
+
+  Return Values:
+    true - The next message is being sent
+    false - No other message is queued
+ ***************************************************************************/
+static bool StartNextMessage(void)
+{
+    if (QueueCount <= 1u)
+        return false;
+
+    QueueCount--;
+    if (++QueueHead >= SMTP_QUEUE_SIZE)
+        QueueHead = 0;
+    CurMsg = &SMTPQueue[QueueHead];
+
+    SMTPFlags.bits.ReadyToFinish = false;
+    SMTPState = SMTP_MAILFROM;
+    return true;
+}
+
 /*****************************************************************************
   Function:
     static uint8_t *FindEmailAddress(uint8_t *str, uint16_t *wLen)
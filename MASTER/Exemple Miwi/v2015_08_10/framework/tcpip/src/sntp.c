@@ -152,6 +152,7 @@ static enum {
 void SNTPInit(void)
 {
     SNTPState = SM_HOME;
+    StackSignal(STACK_MODULE_SNTP, STACK_EVENT_BUSY);
 }
 
 /*****************************************************************************
@@ -182,6 +183,7 @@ void SNTPClient(void)
 {
     NTP_PACKET pkt;
     uint16_t w;
+    uint32_t dwLeft;
     //static NODE_INFO Server;
     static uint32_t dwTimer;
     static UDP_SOCKET MySocket = INVALID_UDP_SOCKET;
@@ -356,6 +358,32 @@ void SNTPClient(void)
 
         break;
     }
+
+    // Tell StackApplications() when to call again.  The reply wakes the
+    // module up through UDP.
+    switch (SNTPState) {
+    case SM_UDP_RECV:
+        StackSetTimer(STACK_MODULE_SNTP, dwTimer + NTP_REPLY_TIMEOUT + 1);
+        break;
+
+    case SM_SHORT_WAIT:
+    case SM_WAIT:
+        // dwTimer counts 65536 ticks, keep the deadline within half the
+        // range of TickGet()
+        dwLeft = dwTimer + 1 - TickGetDiv64K();
+        if (SNTPState == SM_WAIT)
+            dwLeft += NTP_QUERY_INTERVAL / 65536ull;
+        else
+            dwLeft += NTP_FAST_QUERY_INTERVAL / 65536ull;
+        if (dwLeft > 0x4000ul)
+            dwLeft = 0x4000ul;
+        StackSetTimer(STACK_MODULE_SNTP, TickGet() + (dwLeft << 16));
+        break;
+
+    default:
+        StackSignal(STACK_MODULE_SNTP, STACK_EVENT_BUSY);
+        break;
+    }
 }
 
 /*****************************************************************************
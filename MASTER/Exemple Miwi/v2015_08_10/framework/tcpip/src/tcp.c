@@ -87,7 +87,9 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 // MSS (ex: > Ethernet MTU), this define sets a hard limit so that we don't
 // cause any TX buffer overflows.  If the remote node does not advirtise a MSS
 // option, all TX segments are fixed at 536 bytes maximum.
+#if !defined(TCP_MAX_SEG_SIZE_TX)
 #define TCP_MAX_SEG_SIZE_TX (1460u)
+#endif
 
 // TCP Maximum Segment Size for RX.  This value is advirtised during connection
 // establishment and the remote node should obey it.  This should be set to 536
@@ -95,10 +97,22 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 // its value can enhance performance at the (small) risk of introducing
 // incompatibility with certain special remote nodes (ex: ones connected via a
 // slow dial up modem).
+#if !defined(TCP_MAX_SEG_SIZE_RX)
 #define TCP_MAX_SEG_SIZE_RX (536u)
+#endif
+
+#if (TCP_MAX_SEG_SIZE_TX > 1460u) || (TCP_MAX_SEG_SIZE_RX > 1460u)
+#error "The TCP segment sizes cannot exceed the 1460 bytes of an Ethernet frame."
+#endif
 
 // TCP Timeout and retransmit numbers
-#define TCP_START_TIMEOUT_VAL       ((uint32_t)TICK_SECOND*1) // Timeout to retransmit unacked data
+#define TCP_START_TIMEOUT_VAL       ((uint32_t)TICK_SECOND*1) // Timeout to retransmit unacked data until the round trip time is measured
+#if !defined(TCP_MIN_RTO)
+#define TCP_MIN_RTO                 ((uint32_t)TICK_SECOND/4) // Lower limit of the timeout computed from the round trip time
+#endif
+#if !defined(TCP_MAX_RTO)
+#define TCP_MAX_RTO                 ((uint32_t)TICK_SECOND*60) // Upper limit of the timeout, including the exponential backoff
+#endif
 #define TCP_DELAYED_ACK_TIMEOUT     ((uint32_t)TICK_SECOND/10) // Timeout for delayed-acknowledgement algorithm
 #define TCP_FIN_WAIT_2_TIMEOUT      ((uint32_t)TICK_SECOND*5) // Timeout for FIN WAIT 2 state
 #define TCP_KEEP_ALIVE_TIMEOUT      ((uint32_t)TICK_SECOND*10) // Timeout for keep-alive messages when no traffic is sent
@@ -113,6 +127,25 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define TCP_SYN_QUEUE_MAX_ENTRIES (3u) // Number of TCP RX SYN packets to save if they cannot be serviced immediately
 #define TCP_SYN_QUEUE_TIMEOUT     ((uint32_t)TICK_SECOND*3) // Timeout for when SYN queue entries are deleted if unserviceable
 
+// Slots of the direct-mapped table from remoteHash to the last socket that
+// matched it, checked by FindMatchingSocket() before looping over all the
+// sockets.  Must be a power of 2, 0 disables the table.
+#if !defined(TCP_SOCKET_HASH_SIZE)
+#define TCP_SOCKET_HASH_SIZE (8u)
+#endif
+
+// TCBs kept in PIC RAM besides MyTCB, so that switching between active
+// sockets does not copy the TCB from/to the Ethernet or SPI RAM.  Entries are
+// written back to their memory medium only when replaced (LRU).  Each one
+// costs sizeof(TCB) bytes of RAM, so the cache is disabled on PIC18.
+#if !defined(TCP_TCB_CACHE_ENTRIES)
+#if defined(__XC8)
+#define TCP_TCB_CACHE_ENTRIES (0u)
+#else
+#define TCP_TCB_CACHE_ENTRIES (4u)
+#endif
+#endif
+
 /****************************************************************************
   Section:
     TCP Header Data Types
@@ -158,6 +191,8 @@ typedef struct {
 #define TCP_OPTIONS_END_OF_LIST  (0x00u) // End of List TCP Option Flag
 #define TCP_OPTIONS_NO_OP        (0x01u) // No Op TCP Option
 #define TCP_OPTIONS_MAX_SEG_SIZE (0x02u) // Maximum segment size TCP flag
+#define TCP_OPTIONS_SACK_PERMITTED (0x04u) // Selective acknowledgement permitted TCP Option (SYN only)
+#define TCP_OPTIONS_SACK         (0x05u) // Selective acknowledgement TCP Option
 
 typedef struct {
     uint8_t Kind; // Type of option
@@ -204,6 +239,18 @@ static TCB_STUB TCBStubs[TCP_SOCKET_COUNT];
 
 static TCB MyTCB; // Currently loaded TCB
 static TCP_SOCKET hCurrentTCP = INVALID_SOCKET; // Current TCP socket
+static TCP_SOCKET hLastTCB = INVALID_SOCKET; // Socket whose TCB is in MyTCB
+#if TCP_SOCKET_HASH_SIZE
+static TCP_SOCKET SocketHash[TCP_SOCKET_HASH_SIZE]; // Last socket matched for each remoteHash slot
+#define TCP_SOCKET_HASH_SLOT(h) (((h) ^ ((h) >> 8)) & (TCP_SOCKET_HASH_SIZE - 1u))
+#endif
+#if TCP_TCB_CACHE_ENTRIES
+static TCB TCBCache[TCP_TCB_CACHE_ENTRIES]; // Recently used TCBs, written back when replaced
+static TCP_SOCKET TCBCacheSocket[TCP_TCB_CACHE_ENTRIES]; // Owner of each entry, INVALID_SOCKET if free
+static uint16_t TCBCacheStamp[TCP_TCB_CACHE_ENTRIES]; // TCBCacheClock at the last load of each entry
+static uint16_t TCBCacheClock; // Incremented at each load from the cache or the memory medium
+static uint8_t TCBCacheEntry[TCP_SOCKET_COUNT]; // Cache entry of each socket, 0xFF if not cached
+#endif
 #if TCP_SYN_QUEUE_MAX_ENTRIES
 static TCP_SYN_QUEUE SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES]; // Array of saved incoming SYN requests that need to be serviced later
 #endif
@@ -213,6 +260,7 @@ static TCP_SYN_QUEUE SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES]; // Array of saved inco
     Function Prototypes
  ***************************************************************************/
 static void TCPRAMCopy(PTR_BASE wDest, uint8_t vDestType, PTR_BASE wSource, uint8_t vSourceType, uint16_t wLength);
+static uint16_t TCPRAMCopyChecksum(PTR_BASE ptrDest, PTR_BASE ptrSource, uint8_t vSourceType, uint16_t wLength);
 
 #if defined(__XC8)
 static void TCPRAMCopyROM(PTR_BASE wDest, uint8_t wDestType, ROM uint8_t * wSource, uint16_t wLength);
@@ -226,6 +274,9 @@ static bool FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote);
 static void SwapTCPHeader(TCP_HEADER* header);
 static void CloseSocket(void);
 static void SyncTCB(void);
+static uint32_t GetRTO(void);
+static void RetransmitLostSegment(uint32_t dwUnackedSEQ);
+static void ScheduleTick(void);
 
 #if defined(WF_CS_TRIS)
 uint16_t WFGetTCBSize(void);
@@ -273,10 +324,62 @@ static void SyncTCBStub(TCP_SOCKET hTCP)
 
 // Flushes MyTCB cache and loads up the specified TCB.
 // Does nothing on cache hit.
+#if TCP_TCB_CACHE_ENTRIES
 static void SyncTCB(void)
 {
-    static TCP_SOCKET hLastTCB = INVALID_SOCKET;
+    uint8_t i, vEntry;
+    TCP_SOCKET hOwner;
 
+    if (hLastTCB == hCurrentTCP)
+        return;
+
+    if (hLastTCB != INVALID_SOCKET) {
+        // Save the current TCB in its cache entry, or in its memory medium
+        // if the cache was reset since it was loaded
+        vEntry = TCBCacheEntry[hLastTCB];
+        if (vEntry < TCP_TCB_CACHE_ENTRIES)
+            memcpy((void *) &TCBCache[vEntry], (void *) &MyTCB, sizeof (MyTCB));
+        else
+            TCPRAMCopy(TCBStubs[hLastTCB].bufferTxStart - sizeof (MyTCB), TCBStubs[hLastTCB].vMemoryMedium, (PTR_BASE) & MyTCB, TCP_PIC_RAM, sizeof (MyTCB));
+    }
+
+    hLastTCB = hCurrentTCP;
+    TCBCacheClock++;
+
+    vEntry = TCBCacheEntry[hCurrentTCP];
+    if (vEntry < TCP_TCB_CACHE_ENTRIES) {
+        memcpy((void *) &MyTCB, (void *) &TCBCache[vEntry], sizeof (MyTCB));
+        TCBCacheStamp[vEntry] = TCBCacheClock;
+        return;
+    }
+
+    // Take a free entry, or else the least recently loaded one
+    vEntry = 0;
+    for (i = 0; i < TCP_TCB_CACHE_ENTRIES; i++) {
+        if (TCBCacheSocket[i] == INVALID_SOCKET) {
+            vEntry = i;
+            break;
+        }
+        if ((uint16_t) (TCBCacheClock - TCBCacheStamp[i]) > (uint16_t) (TCBCacheClock - TCBCacheStamp[vEntry]))
+            vEntry = i;
+    }
+
+    hOwner = TCBCacheSocket[vEntry];
+    if (hOwner != INVALID_SOCKET) {
+        // Write back the replaced TCB
+        TCPRAMCopy(TCBStubs[hOwner].bufferTxStart - sizeof (TCB), TCBStubs[hOwner].vMemoryMedium, (PTR_BASE) & TCBCache[vEntry], TCP_PIC_RAM, sizeof (TCB));
+        TCBCacheEntry[hOwner] = 0xFF;
+    }
+    TCBCacheSocket[vEntry] = hCurrentTCP;
+    TCBCacheStamp[vEntry] = TCBCacheClock;
+    TCBCacheEntry[hCurrentTCP] = vEntry;
+
+    // Load up the new TCB.  The cache entry is filled when MyTCB is saved.
+    TCPRAMCopy((PTR_BASE) & MyTCB, TCP_PIC_RAM, MyTCBStub.bufferTxStart - sizeof (MyTCB), MyTCBStub.vMemoryMedium, sizeof (MyTCB));
+}
+#else
+static void SyncTCB(void)
+{
     if (hLastTCB == hCurrentTCP)
         return;
 
@@ -289,6 +392,7 @@ static void SyncTCB(void)
     hLastTCB = hCurrentTCP;
     TCPRAMCopy((PTR_BASE) & MyTCB, TCP_PIC_RAM, MyTCBStub.bufferTxStart - sizeof (MyTCB), MyTCBStub.vMemoryMedium, sizeof (MyTCB));
 }
+#endif
 
 /*****************************************************************************
   Function:
@@ -346,6 +450,15 @@ void TCPInit(void)
     memset((void *) SYNQueue, 0x00, sizeof (SYNQueue));
 #endif
 
+#if TCP_SOCKET_HASH_SIZE
+    memset((void *) SocketHash, INVALID_SOCKET, sizeof (SocketHash));
+#endif
+#if TCP_TCB_CACHE_ENTRIES
+    // The TCB in MyTCB, if any, is saved to its memory medium by the next SyncTCB()
+    memset((void *) TCBCacheSocket, INVALID_SOCKET, sizeof (TCBCacheSocket));
+    memset((void *) TCBCacheEntry, 0xFF, sizeof (TCBCacheEntry));
+#endif
+
     // Allocate all socket FIFO addresses
     for (i = 0; i < TCP_SOCKET_COUNT; i++) {
         // Generate all needed sockets of each type (TCP_PURPOSE_*)
@@ -578,6 +691,7 @@ TCP_SOCKET TCPOpen(uint32_t dwRemoteHost, uint8_t vRemoteHostType, uint16_t wPor
                 // Flag to start the DNS, ARP, SYN processes
                 MyTCBStub.eventTime = TickGet();
                 MyTCBStub.Flags.bTimerEnabled = 1;
+                StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
 
                 switch (vRemoteHostType) {
 #if defined(STACK_USE_DNS_CLIENT)
@@ -772,6 +886,9 @@ void TCPDisconnect(TCP_SOCKET hTCP)
     // RX window is zero
     MyTCBStub.rxTail = MyTCBStub.rxHead;
 
+    // The FIN follows all the data put
+    MyTCBStub.Flags.bTXHold = 0;
+
     switch (MyTCBStub.smState) {
 #if defined(STACK_CLIENT_MODE) && defined(STACK_USE_DNS_CLIENT)
     case TCP_DNS_RESOLVE:
@@ -973,6 +1090,13 @@ void TCPFlush(TCP_SOCKET hTCP)
 
     // NOTE: Pending SSL data will NOT be transferred here
 
+    // Held data is flushed when the hold is released
+    if (MyTCBStub.Flags.bTXHold) {
+        MyTCBStub.Flags.bTXASAP = 1;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
+        return;
+    }
+
     if (MyTCBStub.txHead != MyTCB.txUnackedTail) {
         // Send the TCP segment with all unacked bytes
         SendTCP(ACK, SENDTCP_RESET_TIMERS);
@@ -1110,6 +1234,7 @@ bool TCPPut(TCP_SOCKET hTCP, uint8_t byte)
     else if (!MyTCBStub.Flags.bTimer2Enabled) {
         MyTCBStub.Flags.bTimer2Enabled = true;
         MyTCBStub.eventTime2 = (uint16_t) TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL / 256ull;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
 
     return true;
@@ -1214,6 +1339,7 @@ uint16_t TCPPutArray(TCP_SOCKET hTCP, uint8_t * data, uint16_t len)
     else if (!MyTCBStub.Flags.bTimer2Enabled) {
         MyTCBStub.Flags.bTimer2Enabled = true;
         MyTCBStub.eventTime2 = (uint16_t) TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL / 256ull;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
 
     return wActualLen + wRightLen;
@@ -1322,6 +1448,7 @@ uint16_t TCPPutROMArray(TCP_SOCKET hTCP, ROM uint8_t * data, uint16_t len)
     else if (!MyTCBStub.Flags.bTimer2Enabled) {
         MyTCBStub.Flags.bTimer2Enabled = true;
         MyTCBStub.eventTime2 = (uint16_t) TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL / 256ull;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
 
     return wActualLen + wRightLen;
@@ -1432,6 +1559,185 @@ uint16_t TCPGetTxFIFOFull(TCP_SOCKET hTCP)
     return wFIFOSize - wDataLen;
 }
 
+/*****************************************************************************
+  Function:
+    void TCPHoldTX(TCP_SOCKET hTCP, bool bHold)
+
+  Summary:
+    Holds the new data of the TCP TX FIFO back from transmission.
+
+  Description:
+    While the hold is set, data put in the TX FIFO is not transmitted, even
+    if the FIFO becomes full or TCPFlush() is called.  The application can
+    then change the held bytes with TCPPokeArray() or remove them with
+    TCPUnput(), ex: to fill in a length field once the data that follows
+    it has been written.  A flush requested during the hold is performed
+    when the hold is released.
+
+  Precondition:
+    TCP is initialized.
+
+  Parameters:
+    hTCP - The socket to hold or release.
+    bHold - true to hold the data back, false to release it.
+
+  Returns:
+    None
+
+  Remarks:
+    The hold must be released before returning to the main stack loop,
+    since no new data is transmitted while it is set.  Not supported on
+    SSL sockets.
+ ***************************************************************************/
+void TCPHoldTX(TCP_SOCKET hTCP, bool bHold)
+{
+    if (hTCP >= TCP_SOCKET_COUNT) {
+        return;
+    }
+
+    SyncTCBStub(hTCP);
+
+    MyTCBStub.Flags.bTXHold = bHold;
+
+    // Perform a flush deferred by the hold
+    if (!bHold && MyTCBStub.Flags.bTXASAP)
+        TCPFlush(hTCP);
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t TCPPokeArray(TCP_SOCKET hTCP, uint8_t *vBuffer, uint16_t wLen, uint16_t wStart)
+
+  Summary:
+    Overwrites data bytes in the TCP TX FIFO that have not been transmitted.
+
+  Description:
+    Copies vBuffer over bytes already put in the TCP TX FIFO.  This is the
+    counterpart of TCPPeekArray() for the TX FIFO.  Bytes that have been
+    transmitted are never changed.
+
+  Precondition:
+    TCP is initialized.
+
+  Parameters:
+    hTCP - The socket to write to.
+    vBuffer - Data bytes to copy in the TX FIFO.
+    wLen - Number of bytes to copy.
+    wStart - Zero-indexed position within the TX FIFO of the first byte to
+        overwrite, counted like TCPGetTxFIFOFull().
+
+  Return Values:
+    Number of bytes actually copied.  This is 0 if the bytes at wStart have
+    already been transmitted, and less than wLen if wStart + wLen is beyond
+    the last byte put in the TX FIFO.
+
+  Remarks:
+    Call TCPHoldTX() before putting the bytes to be changed, otherwise they
+    may be transmitted first.  Not supported on SSL sockets.
+ ***************************************************************************/
+uint16_t TCPPokeArray(TCP_SOCKET hTCP, uint8_t *vBuffer, uint16_t wLen, uint16_t wStart)
+{
+    PTR_BASE ptrWrite;
+    uint16_t w;
+    uint16_t wBytesUntilWrap;
+
+    if (hTCP >= TCP_SOCKET_COUNT || wLen == 0) {
+        return 0;
+    }
+
+    SyncTCBStub(hTCP);
+#if defined(STACK_USE_SSL)
+    if (MyTCBStub.sslStubID != SSL_INVALID_ID)
+        return 0;
+#endif
+    SyncTCB();
+
+    // Refuse to change bytes already transmitted
+    w = MyTCB.txUnackedTail - MyTCBStub.txTail;
+    if (MyTCB.txUnackedTail < MyTCBStub.txTail)
+        w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+    if (wStart < w)
+        return 0;
+
+    // Decrease the length if it goes beyond the last byte put
+    w = TCPGetTxFIFOFull(hTCP);
+    if (wStart >= w)
+        return 0;
+    if (wStart + wLen > w)
+        wLen = w - wStart;
+
+    // Find the write start location
+    ptrWrite = MyTCBStub.txTail + wStart;
+    if (ptrWrite >= MyTCBStub.bufferRxStart)
+        ptrWrite -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+
+    // Write the bytes up to the wrap position and the rest at the start of
+    // the buffer
+    wBytesUntilWrap = MyTCBStub.bufferRxStart - ptrWrite;
+    if (wLen <= wBytesUntilWrap) {
+        TCPRAMCopy(ptrWrite, MyTCBStub.vMemoryMedium, (PTR_BASE) vBuffer, TCP_PIC_RAM, wLen);
+    } else {
+        TCPRAMCopy(ptrWrite, MyTCBStub.vMemoryMedium, (PTR_BASE) vBuffer, TCP_PIC_RAM, wBytesUntilWrap);
+        TCPRAMCopy(MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, (PTR_BASE) vBuffer + wBytesUntilWrap, TCP_PIC_RAM, wLen - wBytesUntilWrap);
+    }
+
+    return wLen;
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t TCPUnput(TCP_SOCKET hTCP, uint16_t wLen)
+
+  Summary:
+    Removes the last bytes put in the TCP TX FIFO.
+
+  Description:
+    Removes up to wLen bytes from the end of the TCP TX FIFO, as if they
+    had never been put.  Bytes that have been transmitted are never removed.
+
+  Precondition:
+    TCP is initialized.
+
+  Parameters:
+    hTCP - The socket to remove the bytes from.
+    wLen - Number of bytes to remove.
+
+  Returns:
+    Number of bytes actually removed.
+
+  Remarks:
+    Call TCPHoldTX() before putting the bytes to be removed, otherwise they
+    may be transmitted first.  Not supported on SSL sockets.
+ ***************************************************************************/
+uint16_t TCPUnput(TCP_SOCKET hTCP, uint16_t wLen)
+{
+    uint16_t w;
+
+    if (hTCP >= TCP_SOCKET_COUNT) {
+        return 0;
+    }
+
+    SyncTCBStub(hTCP);
+#if defined(STACK_USE_SSL)
+    if (MyTCBStub.sslStubID != SSL_INVALID_ID)
+        return 0;
+#endif
+    SyncTCB();
+
+    // Only the bytes not transmitted yet can be removed
+    w = MyTCBStub.txHead - MyTCB.txUnackedTail;
+    if (MyTCBStub.txHead < MyTCB.txUnackedTail)
+        w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+    if (wLen > w)
+        wLen = w;
+
+    if (MyTCBStub.txHead - MyTCBStub.bufferTxStart < wLen)
+        MyTCBStub.txHead += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+    MyTCBStub.txHead -= wLen;
+
+    return wLen;
+}
+
 /****************************************************************************
   Section:
     Receive Functions
@@ -1539,12 +1845,14 @@ bool TCPGet(TCP_SOCKET hTCP, uint8_t * byte)
     // Send a window update if we've run out of data
     if (wGetReadyCount == 1u) {
         MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
     // If not already enabled, start a timer so a window
     // update will get sent to the remote node at some point
     else if (!MyTCBStub.Flags.bTimer2Enabled) {
         MyTCBStub.Flags.bTimer2Enabled = true;
         MyTCBStub.eventTime2 = (uint16_t) TickGetDiv256() + TCP_WINDOW_UPDATE_TIMEOUT_VAL / 256ull;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
 
     return true;
@@ -1605,11 +1913,13 @@ uint16_t TCPGetArray(TCP_SOCKET hTCP, uint8_t * buffer, uint16_t len)
     // Send a window update if we've run low on data
     if (wGetReadyCount - len <= len) {
         MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     } else if (!MyTCBStub.Flags.bTimer2Enabled) {
         // If not already enabled, start a timer so a window
         // update will get sent to the remote node at some point
         MyTCBStub.Flags.bTimer2Enabled = true;
         MyTCBStub.eventTime2 = (uint16_t) TickGetDiv256() + TCP_WINDOW_UPDATE_TIMEOUT_VAL / 256ull;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     }
 
     return len;
@@ -2524,6 +2834,20 @@ void TCPTick(void)
                 // Set the appropriate retry time
                 MyTCB.retryCount++;
                 MyTCB.retryInterval <<= 1;
+                if (MyTCB.retryInterval > TCP_MAX_RTO)
+                    MyTCB.retryInterval = TCP_MAX_RTO;
+
+                // Everything sent so far may be sent again, so no round trip
+                // time can be measured on it.  A fast recovery in progress
+                // has failed and the remote node may have dropped the data
+                // it SACKed.
+                MyTCB.dwRecover = MyTCB.MySEQ;
+                MyTCB.flags.bRTTPending = 0;
+                MyTCB.flags.bFastRecovery = 0;
+                MyTCB.flags.vDupACKs = 0;
+#if TCP_SACK_BLOCKS
+                MyTCB.vSACKBlocks = 0;
+#endif
 
                 // Calculate how many bytes we have to roll back and retransmit
                 w = MyTCB.txUnackedTail - MyTCBStub.txTail;
@@ -2565,6 +2889,85 @@ void TCPTick(void)
         }
     }
 #endif
+
+    ScheduleTick();
+}
+
+/*****************************************************************************
+  Function:
+    static void ScheduleTick(void)
+
+  Summary:
+    Sets the time of the next TCPTick() call.
+
+  Description:
+    Finds the earliest timer of all the sockets and of the SYN queue, and
+    asks StackTask() to call TCPTick() at that time.  TCPTick() runs on the
+    next pass if a socket has data to send as soon as possible or an SSL
+    operation in progress.  Incoming segments, SendTCP() and the API
+    functions that start a timer wake TCPTick() up earlier.
+
+  Precondition:
+    TCP is initialized.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void ScheduleTick(void)
+{
+    TCP_SOCKET hTCP;
+    uint32_t dwNow;
+    uint16_t wNow;
+    int16_t iWait;
+
+    dwNow = TickGet();
+    wNow = (uint16_t) TickGetDiv256();
+
+    for (hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++) {
+        SyncTCBStub(hTCP);
+
+#if defined(STACK_USE_SSL)
+        if (MyTCBStub.sslStubID != SSL_INVALID_ID) {
+            StackSignal(STACK_MODULE_TCP, STACK_EVENT_BUSY);
+            return;
+        }
+#endif
+
+        if (MyTCBStub.Flags.bTXASAP || MyTCBStub.Flags.bTXASAPWithoutTimerReset) {
+            StackSignal(STACK_MODULE_TCP, STACK_EVENT_BUSY);
+            return;
+        }
+
+        // Window updates and automatic transmissions, delayed ACKs and
+        // TCP_CLOSE_WAIT timeouts count in units of 256 ticks
+        if (MyTCBStub.Flags.bTimer2Enabled) {
+            iWait = (int16_t) (MyTCBStub.eventTime2 - wNow);
+            StackSetTimer(STACK_MODULE_TCP, iWait > 0 ? dwNow + ((uint32_t) iWait << 8) : dwNow);
+        }
+        if (MyTCBStub.Flags.bDelayedACKTimerEnabled || MyTCBStub.smState == TCP_CLOSE_WAIT) {
+            iWait = (int16_t) (MyTCBStub.OverlappedTimers.delayedACKTime - wNow);
+            StackSetTimer(STACK_MODULE_TCP, iWait > 0 ? dwNow + ((uint32_t) iWait << 8) : dwNow);
+        }
+
+        // Retransmissions, connection steps and keep-alives
+#if defined(TCP_KEEP_ALIVE_TIMEOUT)
+        if (MyTCBStub.Flags.bTimerEnabled || MyTCBStub.smState == TCP_ESTABLISHED)
+#else
+        if (MyTCBStub.Flags.bTimerEnabled)
+#endif
+            StackSetTimer(STACK_MODULE_TCP, MyTCBStub.eventTime);
+    }
+
+#if TCP_SYN_QUEUE_MAX_ENTRIES
+    // Queued SYNs expire in the order they arrived
+    if (SYNQueue[0].wDestPort != 0u) {
+        iWait = (int16_t) (SYNQueue[0].wTimestamp + (uint16_t) (TCP_SYN_QUEUE_TIMEOUT / 256ull) + 1u - wNow);
+        StackSetTimer(STACK_MODULE_TCP, iWait > 0 ? dwNow + ((uint32_t) iWait << 8) : dwNow);
+    }
+#endif
 }
 
 /*****************************************************************************
@@ -2639,6 +3042,10 @@ bool TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, uint16_t len)
             sizeof (TCPHeader));
     len = len - optionsSize - sizeof (TCPHeader);
 
+    // Queued SYNs and the timers started by the segment are handled by
+    // TCPTick()
+    StackSignal(STACK_MODULE_TCP, STACK_EVENT_RX);
+
     // Find matching socket.
     if (FindMatchingSocket(&TCPHeader, remote)) {
 #if defined(STACK_USE_SSL)
@@ -2661,6 +3068,11 @@ bool TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, uint16_t len)
             TCPSSLHandleIncoming(hCurrentTCP);
         }
 #endif
+
+        // Wake up the application for its new data, connection state or TX
+        // space
+        SyncTCB();
+        StackSignalSocket(hCurrentTCP, MyTCB.vSocketPurpose, STACK_EVENT_RX | STACK_EVENT_TX);
     }
     //  else
     //  {
@@ -2708,10 +3120,20 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
     TCP_HEADER header;
     TCP_OPTIONS options;
     PSEUDO_HEADER pseudoHeader;
+    PTR_BASE ptrPayload;
+    uint16_t wPayloadSum;
     uint16_t len;
+#if TCP_SACK_BLOCKS
+    TCPIP_UINT32_VAL dwSACKEdge;
+    uint8_t vSACKOption[12];
+    uint8_t vSACKOptionLen;
+#endif
 
     SyncTCB();
 
+    // Have TCPTick() look at the new timers and at the data left to send
+    StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
+
     // FINs must be handled specially
     if (vTCPFlags & FIN) {
         MyTCBStub.Flags.bTXFIN = 1;
@@ -2727,17 +3149,56 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
     MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
     MyTCBStub.Flags.bHalfFullFlush = 0;
 
+#if TCP_SACK_BLOCKS
+    // Offer the SACK option in a SYN, accept it in a SYN+ACK only if the
+    // remote node offered it.  Once connected, report the out of order data
+    // held after the RX hole so that the remote node resends only the hole.
+    // The option is built first since the application data goes after it.
+    vSACKOptionLen = 0;
+    vSACKOption[0] = TCP_OPTIONS_NO_OP;
+    vSACKOption[1] = TCP_OPTIONS_NO_OP;
+    if (vTCPFlags & SYN) {
+        if (!(vTCPFlags & ACK) || MyTCB.flags.bSACKPermitted) {
+            vSACKOption[2] = TCP_OPTIONS_SACK_PERMITTED;
+            vSACKOption[3] = 2;
+            vSACKOptionLen = 4;
+        }
+    } else if (MyTCB.flags.bSACKPermitted && (MyTCB.sHoleSize > 0) && MyTCB.wFutureDataSize) {
+        dwSACKEdge.Val = MyTCB.RemoteSEQ + (uint32_t) MyTCB.sHoleSize;
+        vSACKOption[2] = TCP_OPTIONS_SACK;
+        vSACKOption[3] = 10;
+        vSACKOption[4] = dwSACKEdge.v[3];
+        vSACKOption[5] = dwSACKEdge.v[2];
+        vSACKOption[6] = dwSACKEdge.v[1];
+        vSACKOption[7] = dwSACKEdge.v[0];
+        dwSACKEdge.Val += MyTCB.wFutureDataSize;
+        vSACKOption[8] = dwSACKEdge.v[3];
+        vSACKOption[9] = dwSACKEdge.v[2];
+        vSACKOption[10] = dwSACKEdge.v[1];
+        vSACKOption[11] = dwSACKEdge.v[0];
+        vSACKOptionLen = 12;
+    }
+#endif
+
+    ptrPayload = BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER) + sizeof (TCP_HEADER);
+#if TCP_SACK_BLOCKS
+    ptrPayload += vSACKOptionLen;
+#endif
+
     //  Make sure that we can write to the MAC transmit area
     while (!IPIsTxReady());
 
-    // Put all socket application data in the TX space
+    // Put all socket application data in the TX space.  The data is summed
+    // while it is copied, for the checksum.
+    wPayloadSum = 0;
     if (vTCPFlags & (SYN | RST)) {
         // Don't put any data in SYN and RST messages
         len = 0;
     } else {
         // Begin copying any application data over to the TX space
-        if (MyTCBStub.txHead == MyTCB.txUnackedTail) {
-            // All caught up on data TX, no real data for this packet
+        if (MyTCBStub.txHead == MyTCB.txUnackedTail || MyTCBStub.Flags.bTXHold) {
+            // All caught up on data TX or the data is held back, no real
+            // data for this packet
             len = 0;
         } else if (MyTCBStub.txHead > MyTCB.txUnackedTail) {
             len = MyTCBStub.txHead - MyTCB.txUnackedTail;
@@ -2751,7 +3212,7 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
             }
 
             // Copy application data into the raw TX buffer
-            TCPRAMCopy(BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER) + sizeof (TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, len);
+            wPayloadSum = TCPRAMCopyChecksum(ptrPayload, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, len);
             MyTCB.txUnackedTail += len;
         } else {
             pseudoHeader.Length = MyTCBStub.bufferRxStart - MyTCB.txUnackedTail;
@@ -2769,12 +3230,18 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
                 pseudoHeader.Length = len;
 
             // Copy application data into the raw TX buffer
-            TCPRAMCopy(BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER) + sizeof (TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+            wPayloadSum = TCPRAMCopyChecksum(ptrPayload, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
             pseudoHeader.Length = len - pseudoHeader.Length;
 
             // Copy any left over chunks of application data over
             if (pseudoHeader.Length) {
-                TCPRAMCopy(BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER) + sizeof (TCP_HEADER)+(MyTCBStub.bufferRxStart - MyTCB.txUnackedTail), TCP_ETH_RAM, MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+                wVal.Val = TCPRAMCopyChecksum(ptrPayload + (MyTCBStub.bufferRxStart - MyTCB.txUnackedTail), MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+
+                // After an odd length first chunk, the words of the second
+                // one are summed with their bytes swapped
+                if ((len - pseudoHeader.Length) & 0x1u)
+                    wVal.Val = swaps(wVal.Val);
+                wPayloadSum = CalcIPChecksumAdd(wPayloadSum, (uint8_t *) & wVal, sizeof (wVal));
             }
 
             MyTCB.txUnackedTail += len;
@@ -2804,7 +3271,16 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
 
         if (vSendFlags & SENDTCP_RESET_TIMERS) {
             MyTCB.retryCount = 0;
-            MyTCB.retryInterval = TCP_START_TIMEOUT_VAL;
+            MyTCB.retryInterval = GetRTO();
+        }
+
+        // Time one segment at a time to measure the round trip time.  Data
+        // below dwRecover may be a retransmission, which would give an
+        // ambiguous measurement (Karn's algorithm).
+        if (len && !MyTCB.flags.bRTTPending && !MyTCB.flags.bFastRecovery && ((int32_t) (MyTCB.MySEQ - MyTCB.dwRecover) >= 0)) {
+            MyTCB.dwRTTSEQ = MyTCB.MySEQ + len;
+            MyTCB.dwRTTTime = TickGet();
+            MyTCB.flags.bRTTPending = 1;
         }
 
         MyTCBStub.eventTime = TickGet() + MyTCB.retryInterval;
@@ -2813,9 +3289,11 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
         // Increment Keep Alive TX counter to handle disconnection if not response is returned
         MyTCBStub.Flags.vUnackedKeepalives++;
 
-        // Generate a dummy byte
+        // Generate a dummy byte, zero so that it does not change the sum
         MyTCB.MySEQ -= 1;
         len = 1;
+        MACSetWritePtr(ptrPayload);
+        MACPut(0x00);
     } else if (MyTCBStub.Flags.bTimerEnabled) {
         // If we have data to transmit, but the remote RX window is zero,
         // so we aren't transmitting any right now then make sure to not
@@ -2897,6 +3375,11 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
         header.DataOffset.Val += sizeof (options) >> 2;
     }
 
+#if TCP_SACK_BLOCKS
+    len += vSACKOptionLen;
+    header.DataOffset.Val += vSACKOptionLen >> 2;
+#endif
+
     // Calculate IP pseudoheader checksum.
     pseudoHeader.SourceAddress = AppConfig.MyIPAddr;
     pseudoHeader.DestAddress = MyTCB.remote.niRemoteMACIP.IPAddr;
@@ -2906,24 +3389,31 @@ static void SendTCP(uint8_t vTCPFlags, uint8_t vSendFlags)
     SwapPseudoHeader(pseudoHeader);
     header.Checksum = ~CalcIPChecksum((uint8_t *) & pseudoHeader, sizeof (pseudoHeader));
 
+    // Add the header and options to the pseudo header and data sums, so that
+    // the segment does not have to be read back from the MAC
+    wVal.Val = CalcIPChecksumAdd(wPayloadSum, (uint8_t *) & header, sizeof (header));
+    if (vTCPFlags & SYN)
+        wVal.Val = CalcIPChecksumAdd(wVal.Val, (uint8_t *) & options, sizeof (options));
+#if TCP_SACK_BLOCKS
+    wVal.Val = CalcIPChecksumAdd(wVal.Val, vSACKOption, vSACKOptionLen);
+#endif
+    header.Checksum = ~wVal.Val;
+#if defined(DEBUG_GENERATE_TX_LOSS)
+    // Damage TCP checksums on TX packets randomly
+    if (LFSRRand() > DEBUG_GENERATE_TX_LOSS) {
+        header.Checksum++;
+    }
+#endif
+
     // Write IP header
     MACSetWritePtr(BASE_TX_ADDR + sizeof (ETHER_HEADER));
     IPPutHeader(&MyTCB.remote.niRemoteMACIP, IP_PROT_TCP, len);
     MACPutArray((uint8_t *) & header, sizeof (header));
     if (vTCPFlags & SYN)
         MACPutArray((uint8_t *) & options, sizeof (options));
-
-    // Update the TCP checksum
-    MACSetReadPtr(BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER));
-    wVal.Val = CalcIPBufferChecksum(len);
-#if defined(DEBUG_GENERATE_TX_LOSS)
-    // Damage TCP checksums on TX packets randomly
-    if (LFSRRand() > DEBUG_GENERATE_TX_LOSS) {
-        wVal.Val++;
-    }
+#if TCP_SACK_BLOCKS
+    MACPutArray(vSACKOption, vSACKOptionLen);
 #endif
-    MACSetWritePtr(BASE_TX_ADDR + sizeof (ETHER_HEADER) + sizeof (IP_HEADER) + 16);
-    MACPutArray((uint8_t *) & wVal, sizeof (uint16_t));
 
     // Physically start the packet transmission over the network
     MACFlush();
@@ -2966,6 +3456,23 @@ static bool FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
     partialMatch = INVALID_SOCKET;
     hash = (remote->IPAddr.w[1] + remote->IPAddr.w[0] + h->SourcePort) ^ h->DestPort;
 
+#if TCP_SOCKET_HASH_SIZE
+    // Try the socket that last received a segment with this hash
+    hTCP = SocketHash[TCP_SOCKET_HASH_SLOT(hash)];
+    if (hTCP != INVALID_SOCKET) {
+        SyncTCBStub(hTCP);
+        if (MyTCBStub.smState != TCP_CLOSED && MyTCBStub.smState != TCP_LISTEN &&
+                MyTCBStub.remoteHash.Val == hash) {
+            SyncTCB();
+            if (h->DestPort == MyTCB.localPort.Val &&
+                    h->SourcePort == MyTCB.remotePort.Val &&
+                    remote->IPAddr.Val == MyTCB.remote.niRemoteMACIP.IPAddr.Val) {
+                return true;
+            }
+        }
+    }
+#endif
+
     // Loop through all sockets looking for a socket that is expecting this
     // packet or can handle it.
     for (hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++) {
@@ -2993,6 +3500,9 @@ static bool FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
         if (h->DestPort == MyTCB.localPort.Val &&
                 h->SourcePort == MyTCB.remotePort.Val &&
                 remote->IPAddr.Val == MyTCB.remote.niRemoteMACIP.IPAddr.Val) {
+#if TCP_SOCKET_HASH_SIZE
+            SocketHash[TCP_SOCKET_HASH_SLOT(hash)] = hTCP;
+#endif
             return true;
         }
     }
@@ -3025,6 +3535,9 @@ static bool FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
             MyTCB.remotePort.Val = h->SourcePort;
             MyTCB.localPort.Val = h->DestPort;
             MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
+#if TCP_SOCKET_HASH_SIZE
+            SocketHash[TCP_SOCKET_HASH_SLOT(hash)] = partialMatch;
+#endif
 
             // All done, and we have a match
             return true;
@@ -3154,6 +3667,11 @@ static void CloseSocket(void)
 {
     SyncTCB();
 
+    // Let the application see the reset, and TCPTick() give the socket to
+    // a queued SYN
+    StackSignalSocket(hCurrentTCP, MyTCB.vSocketPurpose, STACK_EVENT_RX);
+    StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
+
     MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
     MyTCBStub.txHead = MyTCBStub.bufferTxStart;
     MyTCBStub.txTail = MyTCBStub.bufferTxStart;
@@ -3169,6 +3687,7 @@ static void CloseSocket(void)
     MyTCBStub.Flags.bTXASAP = 0;
     MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
     MyTCBStub.Flags.bTXFIN = 0;
+    MyTCBStub.Flags.bTXHold = 0;
     MyTCBStub.Flags.bSocketReset = 1;
 
 #if defined(STACK_USE_SSL)
@@ -3194,26 +3713,35 @@ static void CloseSocket(void)
 
     MyTCB.flags.bFINSent = 0;
     MyTCB.flags.bSYNSent = 0;
-    MyTCB.flags.bRXNoneACKed1 = 0;
-    MyTCB.flags.bRXNoneACKed2 = 0;
+    MyTCB.flags.vDupACKs = 0;
+    MyTCB.flags.bFastRecovery = 0;
+    MyTCB.flags.bRTTPending = 0;
+    MyTCB.flags.bSACKPermitted = 0;
+    MyTCB.dwSRTT = 0;
+    MyTCB.dwRTTVar = 0;
+#if TCP_SACK_BLOCKS
+    MyTCB.vSACKBlocks = 0;
+#endif
     MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
     ((TCPIP_UINT32_VAL*) (&MyTCB.MySEQ))->w[0] = LFSRRand();
     ((TCPIP_UINT32_VAL*) (&MyTCB.MySEQ))->w[1] = LFSRRand();
+    MyTCB.dwRecover = MyTCB.MySEQ;
     MyTCB.sHoleSize = -1;
     MyTCB.remoteWindow = 1;
 }
 
 /*****************************************************************************
   Function:
-    static uint16_t GetMaxSegSizeOption(void)
+    static uint16_t GetSYNOptions(void)
 
   Summary:
-    Obtains the Maximum Segment Size (MSS) TCP Option out of the TCP header
-    for the current socket.
+    Obtains the Maximum Segment Size (MSS) and SACK Permitted TCP Options out
+    of the TCP header for the current socket.
 
   Description:
     Parses the current TCP packet header and extracts the Maximum Segment Size
-    option.
+    option.  MyTCB.flags.bSACKPermitted is set if the SACK Permitted option is
+    present and SACK is enabled (TCP_SACK_BLOCKS).
 
   Precondition:
     Must be called while a TCP packet is present and being processed via
@@ -3230,12 +3758,15 @@ static void CloseSocket(void)
   Remarks:
     The internal MAC Read Pointer is moved but not restored.
  ***************************************************************************/
-static uint16_t GetMaxSegSizeOption(void)
+static uint16_t GetSYNOptions(void)
 {
     uint8_t vOptionsBytes;
     uint8_t vOption;
+    uint8_t vLength;
     uint16_t wMSS;
 
+    MyTCB.flags.bSACKPermitted = 0;
+
     // Find out how many options bytes are in this packet.
     IPSetRxBuffer(2 + 2 + 4 + 4); // Seek to data offset field, skipping Source port (2), Destination port (2), Sequence number (4), and Acknowledgement number (4)
     vOptionsBytes = MACGet();
@@ -3249,50 +3780,395 @@ static uint16_t GetMaxSegSizeOption(void)
     // Seek to beginning of options
     MACGetArray(NULL, 7);
 
-    // Search for the Maximum Segment Size option
+    // Search for the Maximum Segment Size and SACK Permitted options
+    wMSS = 536;
     while (vOptionsBytes--) {
         vOption = MACGet();
 
-        if (vOption == 0u) // End of Options list
+        if (vOption == TCP_OPTIONS_END_OF_LIST)
             break;
 
-        if (vOption == 1u) // NOP option
+        if (vOption == TCP_OPTIONS_NO_OP)
             continue;
 
-        if (vOption == 2u) // Maximum Segment Size option
-        {
+        if (vOption == TCP_OPTIONS_MAX_SEG_SIZE) {
             if (vOptionsBytes < 3u)
                 break;
-
-            wMSS = 0;
+            vOptionsBytes -= 3;
 
             // Get option length
-            vOption = MACGet();
-            if (vOption == 4u) { // Retrieve MSS and swap value to little endian
-                ((uint8_t *) & wMSS)[1] = MACGet();
-                ((uint8_t *) & wMSS)[0] = MACGet();
-            }
+            if (MACGet() != 4u)
+                break;
+
+            // Retrieve MSS and swap value to little endian
+            ((uint8_t *) & wMSS)[1] = MACGet();
+            ((uint8_t *) & wMSS)[0] = MACGet();
 
             if (wMSS < 536u)
+                wMSS = 536;
+            else if (wMSS > TCP_MAX_SEG_SIZE_TX)
+                wMSS = TCP_MAX_SEG_SIZE_TX;
+        } else { // Multi byte option, throw it away unless it is SACK Permitted
+            if (vOptionsBytes < 1u)
                 break;
-            if (wMSS > TCP_MAX_SEG_SIZE_TX)
-                return TCP_MAX_SEG_SIZE_TX;
-            else
-                return wMSS;
-        } else { // Assume this is a multi byte option and throw it way
-            if (vOptionsBytes < 2u)
-                break;
-            vOption = MACGet();
-            if (vOptionsBytes < vOption)
+            vOptionsBytes--;
+
+            // Get option length, which counts the kind and length bytes
+            vLength = MACGet();
+            if ((vLength < 2u) || (vOptionsBytes < vLength - 2u))
                 break;
-            MACGetArray(NULL, vOption);
-            vOptionsBytes -= vOption;
+            vLength -= 2;
+            vOptionsBytes -= vLength;
+
+#if TCP_SACK_BLOCKS
+            if ((vOption == TCP_OPTIONS_SACK_PERMITTED) && (vLength == 0u))
+                MyTCB.flags.bSACKPermitted = 1;
+#endif
+            if (vLength)
+                MACGetArray(NULL, vLength);
+        }
+    }
+
+    return wMSS;
+}
+
+/*****************************************************************************
+  Function:
+    static uint32_t GetRTO(void)
+
+  Summary:
+    Computes the retransmission timeout of the current socket.
+
+  Description:
+    Returns SRTT + 4*RTTVAR (RFC 6298), bounded by TCP_MIN_RTO and
+    TCP_MAX_RTO, or TCP_START_TIMEOUT_VAL until the round trip time has been
+    measured.
+
+  Precondition:
+    MyTCB is synced.
+
+  Parameters:
+    None
+
+  Returns:
+    Retransmission timeout, in ticks.
+ ***************************************************************************/
+static uint32_t GetRTO(void)
+{
+    uint32_t dwRTO;
+
+    if (MyTCB.dwSRTT == 0u)
+        return TCP_START_TIMEOUT_VAL;
+
+    dwRTO = (MyTCB.dwSRTT >> 3) + MyTCB.dwRTTVar;
+    if (dwRTO < TCP_MIN_RTO)
+        return TCP_MIN_RTO;
+    if (dwRTO > TCP_MAX_RTO)
+        return TCP_MAX_RTO;
+    return dwRTO;
+}
+
+/*****************************************************************************
+  Function:
+    static void UpdateRTT(uint32_t dwRTT)
+
+  Summary:
+    Adds a round trip time measurement to the estimation.
+
+  Description:
+    Updates the smoothed round trip time and its variation with the
+    Jacobson/Karels algorithm: SRTT += (RTT - SRTT)/8 and
+    RTTVAR += (|RTT - SRTT| - RTTVAR)/4.  Both are kept scaled (by 8 and 4)
+    to avoid losing the fractions.
+
+  Precondition:
+    MyTCB is synced.
+
+  Parameters:
+    dwRTT - Measured round trip time, in ticks
+
+  Returns:
+    None
+ ***************************************************************************/
+static void UpdateRTT(uint32_t dwRTT)
+{
+    int32_t lError;
+
+    if (dwRTT == 0u)
+        dwRTT = 1;
+
+    // The first measurement gives SRTT = RTT and RTTVAR = RTT/2
+    if (MyTCB.dwSRTT == 0u) {
+        MyTCB.dwSRTT = dwRTT << 3;
+        MyTCB.dwRTTVar = dwRTT << 1;
+        return;
+    }
+
+    lError = (int32_t) dwRTT - (int32_t) (MyTCB.dwSRTT >> 3);
+    MyTCB.dwSRTT += lError;
+    if (lError < 0)
+        lError = -lError;
+    lError -= (int32_t) (MyTCB.dwRTTVar >> 2);
+    MyTCB.dwRTTVar += lError;
+}
+
+#if TCP_SACK_BLOCKS
+/*****************************************************************************
+  Function:
+    static void AddSACKBlock(uint32_t dwLeft, uint32_t dwRight,
+                             uint32_t dwUnackedSEQ)
+
+  Summary:
+    Adds a block received in a SACK option to the scoreboard.
+
+  Description:
+    Merges the block with the blocks of MyTCB.SACKBlocks[] that it overlaps
+    or touches and inserts the result in order.  When the scoreboard is full,
+    the highest block is dropped since the lowest holes are retransmitted
+    first.  Blocks that were already acknowledged or that cover data never
+    sent are ignored.
+
+  Precondition:
+    MyTCB is synced.
+
+  Parameters:
+    dwLeft - First sequence number of the block
+    dwRight - Sequence number following the block
+    dwUnackedSEQ - Sequence number of the first unacknowledged byte
+
+  Returns:
+    None
+ ***************************************************************************/
+static void AddSACKBlock(uint32_t dwLeft, uint32_t dwRight, uint32_t dwUnackedSEQ)
+{
+    uint8_t i;
+
+    if (((int32_t) (dwRight - dwLeft) <= 0) || ((int32_t) (dwRight - dwUnackedSEQ) <= 0) || ((int32_t) (dwRight - MyTCB.MySEQ) > 0))
+        return;
+    if ((int32_t) (dwLeft - dwUnackedSEQ) < 0)
+        dwLeft = dwUnackedSEQ;
+
+    i = 0;
+    while (i < MyTCB.vSACKBlocks) {
+        // Skip the blocks below, stop at the first block above
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwRight - dwLeft) < 0) {
+            i++;
+            continue;
         }
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwLeft - dwRight) > 0)
+            break;
 
+        // Overlapping block, absorb it
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwLeft - dwLeft) < 0)
+            dwLeft = MyTCB.SACKBlocks[i].dwLeft;
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwRight - dwRight) > 0)
+            dwRight = MyTCB.SACKBlocks[i].dwRight;
+        MyTCB.vSACKBlocks--;
+        memmove((void *) &MyTCB.SACKBlocks[i], (void *) &MyTCB.SACKBlocks[i + 1], (MyTCB.vSACKBlocks - i) * sizeof (MyTCB.SACKBlocks[0]));
     }
 
-    // Did not find MSS option, return worst case default
-    return 536;
+    if (MyTCB.vSACKBlocks == TCP_SACK_BLOCKS) {
+        if (i == TCP_SACK_BLOCKS)
+            return;
+        MyTCB.vSACKBlocks--;
+    }
+    memmove((void *) &MyTCB.SACKBlocks[i + 1], (void *) &MyTCB.SACKBlocks[i], (MyTCB.vSACKBlocks - i) * sizeof (MyTCB.SACKBlocks[0]));
+    MyTCB.SACKBlocks[i].dwLeft = dwLeft;
+    MyTCB.SACKBlocks[i].dwRight = dwRight;
+    MyTCB.vSACKBlocks++;
+}
+
+/*****************************************************************************
+  Function:
+    static void GetSACKOption(TCP_HEADER* h, uint32_t dwUnackedSEQ)
+
+  Summary:
+    Updates the SACK scoreboard of the current socket from an incoming ACK.
+
+  Description:
+    Removes the blocks of MyTCB.SACKBlocks[] that are now acknowledged, then
+    parses the current TCP packet header and adds each block of the SACK
+    option to the scoreboard.
+
+  Precondition:
+    Must be called while a TCP packet is present and being processed via
+    HandleTCPSeg() and only if the SACK option was negotiated.
+
+  Parameters:
+    h - The TCP header for this packet
+    dwUnackedSEQ - Sequence number of the first unacknowledged byte (SEG.ACK)
+
+  Returns:
+    None
+
+  Remarks:
+    The internal MAC Read Pointer is moved but not restored.
+ ***************************************************************************/
+static void GetSACKOption(TCP_HEADER* h, uint32_t dwUnackedSEQ)
+{
+    uint8_t vOptionsBytes;
+    uint8_t vOption;
+    uint8_t vLength;
+    TCPIP_UINT32_VAL dwLeft;
+    TCPIP_UINT32_VAL dwRight;
+
+    // Forget the blocks below the unacknowledged tail
+    for (vOption = 0; vOption < MyTCB.vSACKBlocks; vOption++) {
+        if ((int32_t) (MyTCB.SACKBlocks[vOption].dwRight - dwUnackedSEQ) > 0)
+            break;
+    }
+    if (vOption) {
+        MyTCB.vSACKBlocks -= vOption;
+        memmove((void *) &MyTCB.SACKBlocks[0], (void *) &MyTCB.SACKBlocks[vOption], MyTCB.vSACKBlocks * sizeof (MyTCB.SACKBlocks[0]));
+    }
+    if (MyTCB.vSACKBlocks && ((int32_t) (MyTCB.SACKBlocks[0].dwLeft - dwUnackedSEQ) < 0))
+        MyTCB.SACKBlocks[0].dwLeft = dwUnackedSEQ;
+
+    vOptionsBytes = (h->DataOffset.Val << 2) - sizeof (TCP_HEADER);
+    if (vOptionsBytes == 0u)
+        return;
+
+    // Seek to beginning of options
+    IPSetRxBuffer(sizeof (TCP_HEADER));
+
+    while (vOptionsBytes--) {
+        vOption = MACGet();
+
+        if (vOption == TCP_OPTIONS_END_OF_LIST)
+            break;
+
+        if (vOption == TCP_OPTIONS_NO_OP)
+            continue;
+
+        if (vOptionsBytes < 1u)
+            break;
+        vOptionsBytes--;
+
+        // Get option length, which counts the kind and length bytes
+        vLength = MACGet();
+        if ((vLength < 2u) || (vOptionsBytes < vLength - 2u))
+            break;
+        vLength -= 2;
+        vOptionsBytes -= vLength;
+
+        if (vOption != TCP_OPTIONS_SACK) {
+            if (vLength)
+                MACGetArray(NULL, vLength);
+            continue;
+        }
+
+        // Each block is a pair of big endian sequence numbers
+        while (vLength >= 8u) {
+            dwLeft.v[3] = MACGet();
+            dwLeft.v[2] = MACGet();
+            dwLeft.v[1] = MACGet();
+            dwLeft.v[0] = MACGet();
+            dwRight.v[3] = MACGet();
+            dwRight.v[2] = MACGet();
+            dwRight.v[1] = MACGet();
+            dwRight.v[0] = MACGet();
+            AddSACKBlock(dwLeft.Val, dwRight.Val, dwUnackedSEQ);
+            vLength -= 8;
+        }
+        break;
+    }
+}
+#endif
+
+/*****************************************************************************
+  Function:
+    static void RetransmitLostSegment(uint32_t dwUnackedSEQ)
+
+  Summary:
+    Retransmits the next lost segment during a fast recovery.
+
+  Description:
+    Without SACK information, the segment at the unacknowledged tail is sent
+    again (NewReno, RFC 6582).  With SACK, the next hole below SACKed data
+    that was not retransmitted yet is sent, so the data that the remote node
+    already holds is skipped.  At most one segment is sent, straight from the
+    TX FIFO, without rolling back the unacknowledged TX tail pointer.
+
+  Precondition:
+    MyTCB is synced and the TX FIFO tail matches dwUnackedSEQ.
+
+  Parameters:
+    dwUnackedSEQ - Sequence number of the first unacknowledged byte (SEG.ACK)
+
+  Returns:
+    None
+ ***************************************************************************/
+static void RetransmitLostSegment(uint32_t dwUnackedSEQ)
+{
+    uint32_t dwSEQ;
+    uint32_t dwEnd;
+    uint32_t dwSavedSEQ;
+    PTR_BASE wSavedUnackedTail;
+    uint16_t wSavedWindow;
+    bool bSavedTXASAP;
+    bool bSavedTXASAPWithoutTimerReset;
+    bool bSavedHalfFullFlush;
+#if TCP_SACK_BLOCKS
+    uint8_t i;
+#endif
+
+    // Holes end at the highest sequence number sent
+    dwSEQ = dwUnackedSEQ;
+    dwEnd = MyTCB.MySEQ;
+
+#if TCP_SACK_BLOCKS
+    // Resume after the last retransmitted hole and skip the SACKed blocks
+    if ((int32_t) (MyTCB.dwHighRxt - dwSEQ) > 0)
+        dwSEQ = MyTCB.dwHighRxt;
+    for (i = 0; i < MyTCB.vSACKBlocks; i++) {
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwRight - dwSEQ) <= 0)
+            continue;
+        if ((int32_t) (MyTCB.SACKBlocks[i].dwLeft - dwSEQ) > 0) {
+            dwEnd = MyTCB.SACKBlocks[i].dwLeft;
+            break;
+        }
+        dwSEQ = MyTCB.SACKBlocks[i].dwRight;
+    }
+
+    // Without SACKed data above it, only the hole at the unacknowledged tail
+    // is known to be lost
+    if ((i == MyTCB.vSACKBlocks) && (dwSEQ != dwUnackedSEQ))
+        return;
+#endif
+
+    if ((int32_t) (dwEnd - dwSEQ) <= 0)
+        return;
+    if (dwEnd - dwSEQ > MyTCB.wRemoteMSS)
+        dwEnd = dwSEQ + MyTCB.wRemoteMSS;
+
+    // Point SendTCP() at the hole and let the remote window limit it to the
+    // hole, then restore the transmission state
+    dwSavedSEQ = MyTCB.MySEQ;
+    wSavedUnackedTail = MyTCB.txUnackedTail;
+    wSavedWindow = MyTCB.remoteWindow;
+    bSavedTXASAP = MyTCBStub.Flags.bTXASAP;
+    bSavedTXASAPWithoutTimerReset = MyTCBStub.Flags.bTXASAPWithoutTimerReset;
+    bSavedHalfFullFlush = MyTCBStub.Flags.bHalfFullFlush;
+
+    MyTCB.MySEQ = dwSEQ;
+    MyTCB.txUnackedTail = MyTCBStub.txTail + (PTR_BASE) (dwSEQ - dwUnackedSEQ);
+    if (MyTCB.txUnackedTail >= MyTCBStub.bufferRxStart)
+        MyTCB.txUnackedTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+    MyTCB.remoteWindow = (uint16_t) (dwEnd - dwSEQ);
+
+    // The ACK of a segment timed after the hole would include the recovery
+    MyTCB.flags.bRTTPending = 0;
+    SendTCP(ACK, 0);
+
+    MyTCB.MySEQ = dwSavedSEQ;
+    MyTCB.txUnackedTail = wSavedUnackedTail;
+    MyTCB.remoteWindow = wSavedWindow;
+    MyTCBStub.Flags.bTXASAP = bSavedTXASAP;
+    MyTCBStub.Flags.bTXASAPWithoutTimerReset = bSavedTXASAPWithoutTimerReset;
+    MyTCBStub.Flags.bHalfFullFlush = bSavedHalfFullFlush;
+#if TCP_SACK_BLOCKS
+    MyTCB.dwHighRxt = dwEnd;
+#endif
 }
 
 /*****************************************************************************
@@ -3374,7 +4250,7 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
             MyTCB.RemoteSEQ = localSeqNumber + 1;
 
             // Get MSS option
-            MyTCB.wRemoteMSS = GetMaxSegSizeOption();
+            MyTCB.wRemoteMSS = GetSYNOptions();
 
             // Set Initial Send Sequence (ISS) number
             // Nothing to do on this step... ISS already set in CloseSocket()
@@ -3422,7 +4298,7 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
             MyTCB.remoteWindow = h->Window;
 
             // Get MSS option
-            MyTCB.wRemoteMSS = GetMaxSegSizeOption();
+            MyTCB.wRemoteMSS = GetSYNOptions();
 
             if (localHeaderFlags & ACK) {
                 SendTCP(ACK, SENDTCP_RESET_TIMERS);
@@ -3570,8 +4446,7 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
         // Calcluate how many bytes were ACKed with this packet
         dwTemp = localAckNumber - dwTemp;
         if (((int32_t) (dwTemp) > (int32_t) 0) && (dwTemp <= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart)) {
-            MyTCB.flags.bRXNoneACKed1 = 0;
-            MyTCB.flags.bRXNoneACKed2 = 0;
+            MyTCB.flags.vDupACKs = 0;
             MyTCBStub.Flags.bHalfFullFlush = false;
 
             // Bytes ACKed, free up the TX FIFO space
@@ -3593,22 +4468,53 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
                 MyTCBStub.txTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
             if (MyTCB.txUnackedTail >= MyTCBStub.bufferRxStart)
                 MyTCB.txUnackedTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
-        } else {
-            // See if we have outstanding TX data that is waiting for an ACK
-            if (MyTCBStub.txTail != MyTCB.txUnackedTail) {
-                if (MyTCB.flags.bRXNoneACKed1) {
-                    if (MyTCB.flags.bRXNoneACKed2) {
-                        // Set up to perform a fast retransmission
-                        // Roll back unacknowledged TX tail pointer to cause retransmit to occur
-                        MyTCB.MySEQ -= (int32_t) (int16_t) (MyTCB.txUnackedTail - MyTCBStub.txTail);
-                        if (MyTCB.txUnackedTail < MyTCBStub.txTail)
-                            MyTCB.MySEQ -= (int32_t) (int16_t) (MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart);
-                        MyTCB.txUnackedTail = MyTCBStub.txTail;
-                        MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
-                    }
-                    MyTCB.flags.bRXNoneACKed2 = 1;
-                }
-                MyTCB.flags.bRXNoneACKed1 = 1;
+
+            // Update the round trip time once the timed segment is ACKed.  A
+            // new measurement also ends the exponential backoff.
+            if (MyTCB.flags.bRTTPending && ((int32_t) (localAckNumber - MyTCB.dwRTTSEQ) >= 0)) {
+                MyTCB.flags.bRTTPending = 0;
+                UpdateRTT(TickGet() - MyTCB.dwRTTTime);
+                MyTCB.retryCount = 0;
+                MyTCB.retryInterval = GetRTO();
+            }
+
+#if TCP_SACK_BLOCKS
+            if (MyTCB.flags.bSACKPermitted)
+                GetSACKOption(h, localAckNumber);
+#endif
+
+            // During a fast recovery, an ACK that does not cover everything
+            // sent before the recovery shows that the next hole is lost too
+            if (MyTCB.flags.bFastRecovery) {
+                if ((int32_t) (localAckNumber - MyTCB.dwRecover) >= 0)
+                    MyTCB.flags.bFastRecovery = 0;
+                else
+                    RetransmitLostSegment(localAckNumber);
+            }
+        } else if ((dwTemp == 0u) && (wSegmentLength == 0u) && (MyTCBStub.txTail != MyTCB.txUnackedTail)) {
+            // Duplicate ACK: nothing new is acknowledged, no data is carried
+            // and we have outstanding TX data waiting for an ACK
+#if TCP_SACK_BLOCKS
+            if (MyTCB.flags.bSACKPermitted)
+                GetSACKOption(h, localAckNumber);
+#endif
+            if (MyTCB.flags.vDupACKs < 3u)
+                MyTCB.flags.vDupACKs++;
+
+            if (MyTCB.flags.bFastRecovery) {
+                // Each duplicate ACK may SACK data above another hole
+                RetransmitLostSegment(localAckNumber);
+            } else if ((MyTCB.flags.vDupACKs == 3u) && ((int32_t) (localAckNumber - MyTCB.dwRecover) >= 0)) {
+                // Fast retransmit: resend the segment at the unacknowledged
+                // tail without waiting for the retransmission timeout.  Not
+                // done for the duplicate ACKs caused by the retransmission
+                // of data sent before a timeout.
+                MyTCB.flags.bFastRecovery = 1;
+                MyTCB.dwRecover = MyTCB.MySEQ;
+#if TCP_SACK_BLOCKS
+                MyTCB.dwHighRxt = localAckNumber;
+#endif
+                RetransmitLostSegment(localAckNumber);
             }
         }
 
@@ -3956,7 +4862,8 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
     remaining space equally.
 
     Received data can be preserved as long as the buffer is expanding and
-    has not wrapped.
+    has not wrapped, or, if it has not wrapped, as long as it fits in the
+    smaller buffer: it is then moved to the new start of the RX FIFO.
 
   Precondition:
     TCP is initialized.
@@ -3985,7 +4892,8 @@ static void HandleTCPSeg(TCP_HEADER* h, uint16_t len)
 bool TCPAdjustFIFOSize(TCP_SOCKET hTCP, uint16_t wMinRXSize, uint16_t wMinTXSize, uint8_t vFlags)
 {
     PTR_BASE ptrTemp, ptrHead;
-    uint16_t wTXAllocation;
+    uint16_t wTXAllocation, wLength, wCount;
+    uint8_t vBuffer[32];
 
     if (hTCP >= TCP_SOCKET_COUNT) {
         return false;
@@ -4053,9 +4961,26 @@ bool TCPAdjustFIFOSize(TCP_SOCKET hTCP, uint16_t wMinRXSize, uint16_t wMinTXSize
     // Determine if resizing will lose any RX data
     if (MyTCBStub.rxTail < ptrHead) {
         if (ptrTemp > MyTCBStub.rxTail) {
-            if (vFlags & TCP_ADJUST_PRESERVE_RX)
-                return false;
-            else {
+            if (vFlags & TCP_ADJUST_PRESERVE_RX) {
+                // Move the data up to the new start of the RX FIFO, from
+                // its end since both areas may overlap.  Requests pipelined
+                // behind the one being answered are kept this way.
+                wLength = ptrHead - MyTCBStub.rxTail;
+                if (wLength > MyTCBStub.bufferEnd - ptrTemp)
+                    return false;
+                while (wLength) {
+                    wCount = (wLength < sizeof (vBuffer)) ? wLength : sizeof (vBuffer);
+                    wLength -= wCount;
+                    TCPRAMCopy((PTR_BASE) vBuffer, TCP_PIC_RAM, MyTCBStub.rxTail + wLength, MyTCBStub.vMemoryMedium, wCount);
+                    TCPRAMCopy(ptrTemp + wLength, MyTCBStub.vMemoryMedium, (PTR_BASE) vBuffer, TCP_PIC_RAM, wCount);
+                }
+                MyTCBStub.rxHead += ptrTemp - MyTCBStub.rxTail;
+#if defined(STACK_USE_SSL)
+                MyTCBStub.sslRxHead += ptrTemp - MyTCBStub.rxTail;
+#endif
+                ptrHead += ptrTemp - MyTCBStub.rxTail;
+                MyTCBStub.rxTail = ptrTemp;
+            } else {
                 MyTCBStub.rxTail = ptrTemp;
                 MyTCBStub.rxHead = ptrTemp;
 
@@ -4260,6 +5185,77 @@ static void TCPRAMCopy(PTR_BASE ptrDest, uint8_t vDestType, PTR_BASE ptrSource,
     }
 }
 
+/*****************************************************************************
+  Function:
+    static uint16_t TCPRAMCopyChecksum(PTR_BASE ptrDest, PTR_BASE ptrSource,
+                                        uint8_t vSourceType, uint16_t wLength)
+
+  Summary:
+    Copies socket data to the Ethernet buffer RAM and sums it.
+
+  Description:
+    This function copies data to the Ethernet buffer RAM like TCPRAMCopy()
+    and returns the one's complement sum of the copied bytes.  The bytes are
+    summed in the medium they are read from, so that SendTCP() does not read
+    the segment back from the MAC to calculate its checksum.
+
+  Precondition:
+    TCP is initialized.
+
+  Parameters:
+    ptrDest     - Address to write to in the Ethernet buffer RAM
+    ptrSource   - Address to copy from
+    vSourceType - Source medium (TCP_PIC_RAM, TCP_ETH_RAM, or TCP_SPI_RAM)
+    wLength     - Number of bytes to copy
+
+  Returns:
+    The one's complement sum of the copied bytes, not complemented (see
+    CalcIPChecksumAdd()).
+
+  Remarks:
+    The source and destination regions must not overlap.
+ ***************************************************************************/
+static uint16_t TCPRAMCopyChecksum(PTR_BASE ptrDest, PTR_BASE ptrSource, uint8_t vSourceType, uint16_t wLength)
+{
+#if defined(SPIRAM_CS_TRIS)
+    uint8_t vBuffer[16];
+    uint16_t w;
+    uint16_t wSum;
+#endif
+
+    switch (vSourceType) {
+    case TCP_PIC_RAM:
+        MACSetWritePtr(ptrDest);
+        MACPutArray((uint8_t *) ptrSource, wLength);
+        return CalcIPChecksumAdd(0, (uint8_t *) ptrSource, wLength);
+
+    case TCP_ETH_RAM:
+        return MACMemCopyChecksum(ptrDest, ptrSource, wLength);
+
+#if defined(SPIRAM_CS_TRIS)
+    case TCP_SPI_RAM:
+        // The chunks have an even size, they are summed as one array
+        MACSetWritePtr(ptrDest);
+        wSum = 0;
+        w = sizeof (vBuffer);
+        while (wLength) {
+            if (w > wLength)
+                w = wLength;
+
+            // Read, write and sum a chunk
+            SPIRAMGetArray(ptrSource, vBuffer, w);
+            ptrSource += w;
+            MACPutArray(vBuffer, w);
+            wSum = CalcIPChecksumAdd(wSum, vBuffer, w);
+            wLength -= w;
+        }
+        return wSum;
+#endif
+    }
+
+    return 0;
+}
+
 /*****************************************************************************
   Function:
     static void TCPRAMCopyROM(PTR_BASE wDest, uint8_t wDestType, ROM uint8_t * wSource,
@@ -4394,6 +5390,7 @@ bool TCPStartSSLClient(TCP_SOCKET hTCP, uint8_t * host)
 
     // Mark connection as handshaking and return
     MyTCBStub.sslReqMessage = SSL_CLIENT_HELLO;
+    StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     MyTCBStub.sslRxHead = MyTCBStub.rxHead;
     MyTCBStub.sslTxHead = MyTCBStub.txHead;
     MyTCBStub.Flags.bSSLHandshaking = 1;
@@ -4457,6 +5454,7 @@ bool TCPStartSSLClientEx(TCP_SOCKET hTCP, uint8_t * host, void * buffer, uint8_t
 
     // Mark connection as handshaking and return
     MyTCBStub.sslReqMessage = SSL_CLIENT_HELLO;
+    StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
     MyTCBStub.sslRxHead = MyTCBStub.rxHead;
     MyTCBStub.sslTxHead = MyTCBStub.txHead;
     MyTCBStub.Flags.bSSLHandshaking = 1;
@@ -4609,6 +5607,7 @@ bool TCPRequestSSLMessage(TCP_SOCKET hTCP, uint8_t msg)
 
     if (msg == SSL_NO_MESSAGE || MyTCBStub.sslReqMessage == SSL_NO_MESSAGE) {
         MyTCBStub.sslReqMessage = msg;
+        StackSignal(STACK_MODULE_TCP, STACK_EVENT_TX);
         return true;
     }
 
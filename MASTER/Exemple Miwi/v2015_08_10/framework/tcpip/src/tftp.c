@@ -52,10 +52,32 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define TFTP_CLIENT_PORT  65352L
 // The TFTP Server Port
 #define TFTP_SERVER_PORT  (69L)
-// The size of a TFTP block - 512 bytes
+// The size of a TFTP block when no blksize option is negotiated - 512 bytes
 #define TFTP_BLOCK_SIZE  (0x200L)
-// The MSB of the TFTP_BLOCK_SIZE
-#define TFTP_BLOCK_SIZE_MSB  (0x02u)
+
+// Room taken in the MAC RX buffer by a data block: Ethernet, IP, UDP and
+// TFTP headers
+#define TFTP_BLOCK_FRAME(size)  ((uint32_t) (size) + 46ul)
+
+// Data blocks that the MAC RX buffer can hold.  The internal MAC of PIC32
+// gives each frame a descriptor of its own, RXSIZE is the size of one, and
+// sets no limit here.
+#if !defined(ENC100_INTERFACE_MODE) && !defined(WF_CS_TRIS) && !defined(TAP_INTERFACE) && \
+    defined(__XC32) && defined(_ETH) && !defined(ENC_CS_TRIS)
+#define TFTP_RX_BLOCKS(size)  (0xFFFFul)
+#else
+#define TFTP_RX_BLOCKS(size)  ((uint32_t) RXSIZE / TFTP_BLOCK_FRAME(size))
+#endif
+
+// Block size and window asked for: 512 byte blocks when the MAC RX buffer
+// cannot hold two blocks of TFTP_BLOCK_SIZE_MAX, and a window of no more
+// blocks than it holds (mac.h makes RXSIZE at least two 512 byte blocks).
+// With the HTTP server, RXSIZE includes sizeof(HTTP_CONN), so these are
+// constant expressions rather than #if.
+#define TFTP_BLOCK_SIZE_ASKED   ((uint16_t) (TFTP_RX_BLOCKS(TFTP_BLOCK_SIZE_MAX) >= 2u ? \
+                                TFTP_BLOCK_SIZE_MAX : TFTP_BLOCK_SIZE))
+#define TFTP_WINDOW_SIZE_ASKED  ((uint16_t) (TFTP_RX_BLOCKS(TFTP_BLOCK_SIZE_ASKED) < TFTP_WINDOW_SIZE ? \
+                                TFTP_RX_BLOCKS(TFTP_BLOCK_SIZE_ASKED) : TFTP_WINDOW_SIZE))
 
 // The TFTP state machine
 typedef enum {
@@ -74,10 +96,11 @@ typedef enum {
     TFTP_OPCODE_WRQ, // Put
     TFTP_OPCODE_DATA, // Actual data
     TFTP_OPCODE_ACK, // Ack for Get/Put
-    TFTP_OPCODE_ERROR // Error
+    TFTP_OPCODE_ERROR, // Error
+    TFTP_OPCODE_OACK // Options accepted by the server (RFC 2347)
 } TFTP_OPCODE;
 
-UDP_SOCKET _tftpSocket = TFTP_UPLOAD_COMPLETE; // TFTP Socket for TFTP server link
+UDP_SOCKET _tftpSocket = INVALID_UDP_SOCKET; // TFTP Socket for TFTP server link
 uint16_t _tftpError; // Variable to preserve error condition causes for later transmission
 
 static union {
@@ -107,14 +130,33 @@ static union {
         unsigned int bIsClosed : 1;
         unsigned int bIsClosing : 1;
         unsigned int bIsReading : 1;
+        unsigned int bAckNow : 1; // Read: acknowledge even inside a window
+        unsigned int bGapAcked : 1; // The last in-order block was acknowledged again
+        unsigned int bWithOptions : 1; // Write: ask for blksize and windowsize
     } bits;
     uint8_t Val;
 } _tftpFlags;
 
+// Block size and window negotiated for the current file
+static uint16_t _tftpBlockSize;
+static uint16_t _tftpWindowSize;
+// Read: blocks received since the last ACK
+static uint16_t _tftpWindowCount;
+// Write: last block acknowledged by the server, and number of blocks
+// acknowledged since the file was opened
+static uint16_t _tftpAckedBlock;
+static uint32_t _tftpAckedBlocks;
+
 // Private helper function
 static void _TFTPSendFileName(TFTP_OPCODE command, uint8_t *fileName);
 // Private helper function
 static void _TFTPSendAck(TCPIP_UINT16_VAL blockNumber);
+// Private helper function
+static void _TFTPSendOptions(void);
+// Private helper function
+static bool _TFTPGetOptions(void);
+// Private helper function
+static void _TFTPOpenFile(TFTP_FILE_MODE mode);
 
 #if defined(__XC8)
 // PIC18 ROM variable argument implementation of _TFTPSendFileName
@@ -139,8 +181,10 @@ static ROM uint8_t *vUploadFilename;
 static TFTP_CHUNK_DESCRIPTOR *uploadChunkDescriptor;
 static uint16_t wUploadChunkOffset;
 static int8_t smUpload = TFTP_UPLOAD_COMPLETE;
-static TFTP_CHUNK_DESCRIPTOR *uploadChunkDescriptorForRetransmit;
-static uint16_t wUploadChunkOffsetForRetransmit;
+static TFTP_CHUNK_DESCRIPTOR *uploadFirstChunkDescriptor;
+
+static void _TFTPUploadOpenFile(void);
+static void _TFTPUploadRewind(void);
 
 /*****************************************************************************
   Function:
@@ -254,15 +298,18 @@ void TFTPUploadRAMFileToHost(ROM uint8_t *vRemoteHost, ROM uint8_t *vFilename, u
     TFTPUploadFragmentedRAMFileToHost(), you must wait until
     TFTPGetUploadStatus() returns a completion status code (<=0) before calling
     any other TFTP API functions.
+
+    The upload asks the server for blocks of up to TFTP_BLOCK_SIZE_MAX bytes
+    and a window of up to TFTP_WINDOW_SIZE blocks, and falls back to 512 byte blocks
+    acknowledged one by one with servers that do not support these options.
  ***************************************************************************/
 void TFTPUploadFragmentedRAMFileToHost(ROM uint8_t *vRemoteHost, ROM uint8_t *vFilename, TFTP_CHUNK_DESCRIPTOR *vFirstChunkDescriptor)
 {
     vUploadRemoteHost = vRemoteHost;
     vUploadFilename = vFilename;
     uploadChunkDescriptor = vFirstChunkDescriptor;
-    uploadChunkDescriptorForRetransmit = vFirstChunkDescriptor;
+    uploadFirstChunkDescriptor = vFirstChunkDescriptor;
     wUploadChunkOffset = 0;
-    wUploadChunkOffsetForRetransmit = 0;
     if (smUpload == TFTP_UPLOAD_RESOLVE_HOST)
         DNSEndUsage();
     smUpload = TFTP_UPLOAD_GET_DNS;
@@ -318,11 +365,18 @@ int8_t TFTPGetUploadStatus(void)
     uint16_t w, w2;
     uint8_t *vData;
 
-    if (UDPIsOpened(_tftpSocket) == false) {
+    // The socket of the last upload was closed, and its number may belong
+    // to another module now.  UDPIsOpened() is false until the socket has
+    // resolved the server, which is no reason for another one.
+    if (_tftpSocket == INVALID_UDP_SOCKET || UDPSocketInfo[_tftpSocket].smState == UDP_CLOSED) {
 
         _tftpSocket = UDPOpenEx((uint32_t) (ROM_PTR_BASE) vUploadRemoteHost,
                 UDP_OPEN_ROM_HOST, TFTP_CLIENT_PORT,
                 TFTP_SERVER_PORT);
+
+        // No free socket, try again on the next call
+        if (_tftpSocket == INVALID_UDP_SOCKET)
+            return smUpload;
     }
 
     switch (smUpload) {
@@ -347,7 +401,7 @@ int8_t TFTPGetUploadStatus(void)
     case TFTP_UPLOAD_CONNECT:
         switch (TFTPIsOpened()) {
         case TFTP_OK:
-            TFTPOpenROMFile(vUploadFilename, TFTP_FILE_MODE_WRITE);
+            _TFTPUploadOpenFile();
             smUpload = TFTP_UPLOAD_SEND_FILENAME;
             break;
         case TFTP_TIMEOUT:
@@ -365,7 +419,7 @@ int8_t TFTPGetUploadStatus(void)
             smUpload = TFTP_UPLOAD_SEND_DATA;
             break;
         case TFTP_RETRY:
-            TFTPOpenROMFile(vUploadFilename, TFTP_FILE_MODE_WRITE);
+            _TFTPUploadOpenFile();
             break;
         case TFTP_TIMEOUT:
             smUpload = TFTP_UPLOAD_CONNECT_TIMEOUT;
@@ -384,10 +438,8 @@ int8_t TFTPGetUploadStatus(void)
         switch (TFTPIsPutReady()) {
         case TFTP_OK:
             // Write blocksize bytes of data
-            uploadChunkDescriptorForRetransmit = uploadChunkDescriptor;
-            wUploadChunkOffsetForRetransmit = wUploadChunkOffset;
             vData = uploadChunkDescriptor->vDataPointer + wUploadChunkOffset;
-            w = TFTP_BLOCK_SIZE;
+            w = _tftpBlockSize;
             while (w) {
                 w2 = uploadChunkDescriptor->wDataLength - wUploadChunkOffset;
                 if (w2 > w)
@@ -411,8 +463,7 @@ int8_t TFTPGetUploadStatus(void)
             break;
 
         case TFTP_RETRY:
-            uploadChunkDescriptor = uploadChunkDescriptorForRetransmit;
-            wUploadChunkOffset = wUploadChunkOffsetForRetransmit;
+            _TFTPUploadRewind();
             break;
 
         case TFTP_TIMEOUT:
@@ -430,10 +481,10 @@ int8_t TFTPGetUploadStatus(void)
         case TFTP_OK:
             smUpload = TFTP_UPLOAD_COMPLETE;
             UDPClose(_tftpSocket);
+            _tftpSocket = INVALID_UDP_SOCKET;
             break;
         case TFTP_RETRY:
-            uploadChunkDescriptor = uploadChunkDescriptorForRetransmit;
-            wUploadChunkOffset = wUploadChunkOffsetForRetransmit;
+            _TFTPUploadRewind();
             smUpload = TFTP_UPLOAD_SEND_DATA;
             break;
         case TFTP_TIMEOUT:
@@ -451,6 +502,32 @@ int8_t TFTPGetUploadStatus(void)
 
     return smUpload;
 }
+
+// Sends the write request.  Since the whole file is in RAM, the upload can
+// ask for larger blocks and a window: it restarts from any block on
+// TFTP_RETRY.
+static void _TFTPUploadOpenFile(void)
+{
+    _tftpFlags.bits.bWithOptions = true;
+    TFTPOpenROMFile(vUploadFilename, TFTP_FILE_MODE_WRITE);
+}
+
+// Moves the upload back to the first block not acknowledged by the server
+static void _TFTPUploadRewind(void)
+{
+    uint32_t dwOffset;
+
+    dwOffset = _tftpAckedBlocks * _tftpBlockSize;
+    uploadChunkDescriptor = uploadFirstChunkDescriptor;
+    while (uploadChunkDescriptor->vDataPointer != NULL && dwOffset >= uploadChunkDescriptor->wDataLength) {
+        dwOffset -= uploadChunkDescriptor->wDataLength;
+        uploadChunkDescriptor++;
+    }
+    wUploadChunkOffset = (uint16_t) dwOffset;
+
+    // The last block is sent again, TFTPCloseFile() is called after it
+    _tftpFlags.bits.bIsClosing = false;
+}
 #endif
 
 /*********************************************************************
@@ -546,8 +623,10 @@ TFTP_RESULT TFTPIsOpened(void)
         // Wait for UDP to be ready.  Immediately after this user will
         // may TFTPGetFile or TFTPPutFile and we have to make sure that
         // UDP is read to transmit.  These functions do not check for
-        // UDP to get ready.
-        if (UDPIsPutReady(_tftpSocket))
+        // UDP to get ready.  The socket must be done resolving the
+        // server too: TFTPOpenFile() writes the server address over the
+        // host name that UDPTask() resolves.
+        if (UDPIsOpened(_tftpSocket) && UDPIsPutReady(_tftpSocket))
             return TFTP_OK;
     }
 
@@ -588,6 +667,13 @@ TFTP_RESULT TFTPIsOpened(void)
  *                  mode of file transfer.
  *                  Use TFTPIsFileOpened() to check if file is
  *                  ready to be read or written.
+ *                  Reads ask the server for blocks of up to
+ *                  TFTP_BLOCK_SIZE_MAX bytes and a window of up to
+ *                  TFTP_WINDOW_SIZE blocks, as many as the MAC RX
+ *                  buffer holds.
+ *                  Writes stay lock-step with 512 byte blocks, since
+ *                  the application resends the last block itself on
+ *                  TFTP_RETRY.
  ********************************************************************/
 void TFTPOpenFile(uint8_t *fileName, TFTP_FILE_MODE mode)
 {
@@ -604,33 +690,7 @@ void TFTPOpenFile(uint8_t *fileName, TFTP_FILE_MODE mode)
     // Tell remote server about our intention.
     _TFTPSendFileName(mode, fileName);
 
-    // Clear all flags.
-    _tftpFlags.Val = 0;
-
-    // Remember start tick for this operation.
-    _tftpStartTick = TickGet();
-
-    // Depending on mode of operation, remote server will respond with
-    // specific block number.
-    if (mode == TFTP_FILE_MODE_READ) {
-        // Remember that we are reading a file.
-        _tftpFlags.bits.bIsReading = true;
-
-        // For read operation, server would respond with data block of 1.
-        MutExVar.group2._tftpBlockNumber.Val = 1;
-
-        // Next packet would be the data packet.
-        _tftpState = SM_TFTP_WAIT_FOR_DATA;
-    } else {
-        // Remember that we are writing a file.
-        _tftpFlags.bits.bIsReading = false;
-
-        // For write operation, server would respond with data block of 0.
-        MutExVar.group2._tftpBlockNumber.Val = 0;
-
-        // Next packet would be the ACK packet.
-        _tftpState = SM_TFTP_WAIT_FOR_ACK;
-    }
+    _TFTPOpenFile(mode);
 }
 
 #if defined(__XC8)
@@ -649,9 +709,21 @@ void TFTPOpenROMFile(ROM uint8_t *fileName, TFTP_FILE_MODE mode)
     // Tell remote server about our intention.
     _TFTPSendROMFileName(mode, fileName);
 
+    _TFTPOpenFile(mode);
+}
+#endif
+
+static void _TFTPOpenFile(TFTP_FILE_MODE mode)
+{
     // Clear all flags.
     _tftpFlags.Val = 0;
 
+    // Until the server accepts our options, the transfer is lock-step
+    // with 512 byte blocks.
+    _tftpBlockSize = TFTP_BLOCK_SIZE;
+    _tftpWindowSize = 1;
+    _tftpWindowCount = 0;
+
     // Remember start tick for this operation.
     _tftpStartTick = TickGet();
 
@@ -671,13 +743,15 @@ void TFTPOpenROMFile(ROM uint8_t *fileName, TFTP_FILE_MODE mode)
         _tftpFlags.bits.bIsReading = false;
 
         // For write operation, server would respond with data block of 0.
+        // The request counts as block 0, and nothing is acknowledged yet.
         MutExVar.group2._tftpBlockNumber.Val = 0;
+        _tftpAckedBlock = 0xFFFFu;
+        _tftpAckedBlocks = 0xFFFFFFFFul;
 
         // Next packet would be the ACK packet.
         _tftpState = SM_TFTP_WAIT_FOR_ACK;
     }
 }
-#endif
 
 /*********************************************************************
  * Function:        TFTP_RESULT TFTPIsFileOpened(void)
@@ -798,6 +872,7 @@ TFTP_RESULT TFTPIsGetReady(void)
                 MutExVar.group2._tftpBlockNumber.Val--;
 
                 // Do it.
+                _tftpFlags.bits.bAckNow = true;
                 _tftpState = SM_TFTP_SEND_ACK;
                 break;
             }
@@ -811,6 +886,27 @@ TFTP_RESULT TFTPIsGetReady(void)
         UDPGet(&opCode.v[1]);
         UDPGet(&opCode.v[0]);
 
+        // The server may answer the request with the options it accepted
+        // instead of the first block.  Acknowledge them with block 0.
+        if (opCode.Val == (uint16_t) TFTP_OPCODE_OACK) {
+            if (MutExVar.group2._tftpBlockNumber.Val != 1u) {
+                UDPDiscard();
+                break;
+            }
+
+            if (!_TFTPGetOptions()) {
+                UDPDiscard();
+                _tftpError = TFTP_ERROR_OPTION_NEGOTIATION;
+                return TFTP_ERROR;
+            }
+            UDPDiscard();
+
+            MutExVar.group2._tftpBlockNumber.Val = 0;
+            _tftpFlags.bits.bAckNow = true;
+            _tftpState = SM_TFTP_SEND_ACK;
+            break;
+        }
+
         // Get block number.
         UDPGet(&blockNumber.v[1]);
         UDPGet(&blockNumber.v[0]);
@@ -821,13 +917,29 @@ TFTP_RESULT TFTPIsGetReady(void)
             if (MutExVar.group2._tftpBlockNumber.Val == blockNumber.Val) {
                 // Mark that we have not acked this block.
                 _tftpFlags.bits.bIsAcked = false;
+                _tftpFlags.bits.bGapAcked = false;
 
                 // Since we have a packet, forget about previous retry count.
                 _tftpRetries = 1;
 
                 _tftpState = SM_TFTP_READY;
-                return TFTP_OK;
-            }                
+
+                // The last block of a file of whole blocks is empty, and
+                // has no byte for TFTPGet()
+                if (UDPIsGetReady(_tftpSocket))
+                    return TFTP_OK;
+                break;
+            }
+            // Inside a window, a block was lost or the server sent the
+            // window again.  Acknowledge the last block received in order
+            // once, so that the server resends the blocks after it.
+            else if (_tftpWindowSize > 1u) {
+                if (!_tftpFlags.bits.bGapAcked) {
+                    _tftpFlags.bits.bGapAcked = true;
+                    MutExVar.group2._tftpDuplicateBlock.Val = MutExVar.group2._tftpBlockNumber.Val - 1;
+                    _tftpState = SM_TFTP_DUPLICATE_ACK;
+                }
+            }
             // If received block has already been received, simply ack it
             // so that Server can "get over" it and send next block.
             else if (MutExVar.group2._tftpBlockNumber.Val > blockNumber.Val) {
@@ -859,6 +971,7 @@ TFTP_RESULT TFTPIsGetReady(void)
     case SM_TFTP_DUPLICATE_ACK:
         if (UDPIsPutReady(_tftpSocket)) {
             _TFTPSendAck(MutExVar.group2._tftpDuplicateBlock);
+            _tftpWindowCount = 0;
             _tftpState = SM_TFTP_WAIT_FOR_DATA;
         }
         break;
@@ -868,19 +981,31 @@ TFTP_RESULT TFTPIsGetReady(void)
             _tftpStartTick = TickGet();
             return TFTP_OK;
         }
-        // End of file is reached when data block is less than 512 bytes long.
-        // To reduce code, only MSB compared against 0x02 (of 0x200 = 512) to
-        // determine if block is less than 512 bytes long or not.
-        else if (MutExVar.group2._tftpBlockLength.Val == 0u ||
-                MutExVar.group2._tftpBlockLength.v[1] < TFTP_BLOCK_SIZE_MSB)
+        // End of file is reached when data block is shorter than the
+        // negotiated block size.
+        else if (MutExVar.group2._tftpBlockLength.Val < _tftpBlockSize)
             _tftpState = SM_TFTP_SEND_LAST_ACK;
         else
             break;
 
     case SM_TFTP_SEND_LAST_ACK:
     case SM_TFTP_SEND_ACK:
+        // Inside a window, only the last block is acknowledged
+        if (_tftpState == SM_TFTP_SEND_ACK && !_tftpFlags.bits.bAckNow &&
+                _tftpWindowCount + 1u < _tftpWindowSize) {
+            _tftpWindowCount++;
+            MutExVar.group2._tftpBlockNumber.Val++;
+
+            // Nothing to acknowledge if the file is closed now
+            _tftpFlags.bits.bIsAcked = true;
+            _tftpState = SM_TFTP_WAIT_FOR_DATA;
+            break;
+        }
+
         if (UDPIsPutReady(_tftpSocket)) {
             _TFTPSendAck(MutExVar.group2._tftpBlockNumber);
+            _tftpWindowCount = 0;
+            _tftpFlags.bits.bAckNow = false;
 
             // This is the next block we are expecting.
             MutExVar.group2._tftpBlockNumber.Val++;
@@ -936,8 +1061,7 @@ uint8_t TFTPGet(void)
     MutExVar.group2._tftpBlockLength.Val++;
 
     // Check to see if entire data block is fetched.
-    // To reduce code, MSB is compared for 0x02 (of 0x200 = 512).
-    if (MutExVar.group2._tftpBlockLength.v[1] == TFTP_BLOCK_SIZE_MSB) {
+    if (MutExVar.group2._tftpBlockLength.Val == _tftpBlockSize) {
         // Entire block was fetched.  Discard everything else.
         UDPDiscard();
 
@@ -1129,65 +1253,105 @@ TFTP_RESULT TFTPIsPutReady(void)
             } else {
                 DEBUG(printf("TFTPIsPutReady(): Retry.\n"));
                 _tftpState = SM_TFTP_WAIT;
-                MutExVar.group2._tftpBlockNumber.Val--; // Roll back by one so proper block number ID is sent for the next packet
+                // Roll back to the first block not acknowledged, so proper
+                // block number ID is sent for the next packet
+                MutExVar.group2._tftpBlockNumber.Val = _tftpAckedBlock;
+                MutExVar.group2._tftpBlockLength.Val = 0;
                 return TFTP_RETRY;
             }
         }
 
-        // Must wait for ACK from server before we transmit next block.
-        if (!UDPIsGetReady(_tftpSocket))
-            break;
-
-        // Get opCode.
-        UDPGet(&opCode.v[1]);
-        UDPGet(&opCode.v[0]);
-
-        // Get block number.
-        UDPGet(&blockNumber.v[1]);
-        UDPGet(&blockNumber.v[0]);
-
-        // Discard everything else.
-        UDPDiscard();
-
-        // This must be ACK or else there is a problem.
-        if (opCode.Val == (uint16_t) TFTP_OPCODE_ACK) {
-            // Also the block number must match with what we are expecting.
-            if (MutExVar.group2._tftpBlockNumber.Val == blockNumber.Val) {
-                // Mark that block we sent previously has been ack'ed.
-                _tftpFlags.bits.bIsAcked = true;
+        if (UDPIsGetReady(_tftpSocket)) {
+            // Get opCode.
+            UDPGet(&opCode.v[1]);
+            UDPGet(&opCode.v[0]);
+
+            // Options accepted by the server stand for the ACK of block 0
+            if (opCode.Val == (uint16_t) TFTP_OPCODE_OACK && MutExVar.group2._tftpBlockNumber.Val == 0u) {
+                if (!_TFTPGetOptions()) {
+                    UDPDiscard();
+                    _tftpError = TFTP_ERROR_OPTION_NEGOTIATION;
+                    return TFTP_ERROR;
+                }
+                opCode.Val = TFTP_OPCODE_ACK;
+                blockNumber.Val = 0;
+            } else {
+                // Get block number.
+                UDPGet(&blockNumber.v[1]);
+                UDPGet(&blockNumber.v[0]);
+            }
 
-                // Since we have ack, forget about previous retry count.
-                _tftpRetries = 1;
+            // Discard everything else.
+            UDPDiscard();
 
-                // If this file is being closed, this must be last ack.
-                // Declare it as closed.
-                if (_tftpFlags.bits.bIsClosing) {
-                    _tftpFlags.bits.bIsClosed = true;
-                    return TFTP_OK;
+            // This must be ACK or else there is a problem.
+            if (opCode.Val == (uint16_t) TFTP_OPCODE_ACK) {
+                // Also the block number must be one we sent and which was
+                // not acknowledged yet.  Any block of the window may be.
+                if ((uint16_t) (blockNumber.Val - _tftpAckedBlock - 1u) <
+                        (uint16_t) (MutExVar.group2._tftpBlockNumber.Val - _tftpAckedBlock)) {
+                    _tftpAckedBlocks += (uint16_t) (blockNumber.Val - _tftpAckedBlock);
+                    _tftpAckedBlock = blockNumber.Val;
+                    _tftpFlags.bits.bGapAcked = false;
+
+                    // Mark whether every block we sent has been ack'ed.
+                    _tftpFlags.bits.bIsAcked = (_tftpAckedBlock == MutExVar.group2._tftpBlockNumber.Val);
+
+                    // Since we have ack, forget about previous retry count.
+                    _tftpRetries = 1;
+                    _tftpStartTick = TickGet();
+
+                    // If this file is being closed, this must be last ack.
+                    // Declare it as closed.
+                    if (_tftpFlags.bits.bIsClosing && _tftpFlags.bits.bIsAcked) {
+                        _tftpFlags.bits.bIsClosed = true;
+                        return TFTP_OK;
+                    }
+                } else if (blockNumber.Val != _tftpAckedBlock || _tftpFlags.bits.bIsAcked) {
+                    DEBUG(printf("TFTPIsPutReady(): "\
+                        "Unexpected block %d received - droping it...\n", \
+                        blockNumber.Val));
+                    return TFTP_NOT_READY;
                 }
 
-                // Or else, wait for put to become ready so that caller
-                // can transfer more data blocks.
-                _tftpState = SM_TFTP_WAIT;
-            } else {
-                DEBUG(printf("TFTPIsPutReady(): "\
-                    "Unexpected block %d received - droping it...\n", \
-                    blockNumber.Val));
-                return TFTP_NOT_READY;
-            }
-        } else if (opCode.Val == (uint16_t) TFTP_OPCODE_ERROR) {
-            // For error opCode, remember error code so that application
-            // can read it later.
-            _tftpError = blockNumber.Val;
+                // An ACK short of the last block sent means that the server
+                // lost a block of the window.  Go back to the block after it
+                // now rather than on timeout, once per acknowledged block.
+                if (!_tftpFlags.bits.bIsAcked && _tftpWindowSize > 1u && !_tftpFlags.bits.bGapAcked) {
+                    _tftpFlags.bits.bGapAcked = true;
+                    _tftpState = SM_TFTP_WAIT;
+                    MutExVar.group2._tftpBlockNumber.Val = _tftpAckedBlock;
+                    MutExVar.group2._tftpBlockLength.Val = 0;
+                    return TFTP_RETRY;
+                }
+            } else if (opCode.Val == (uint16_t) TFTP_OPCODE_ERROR) {
+                // For error opCode, remember error code so that application
+                // can read it later.
+                _tftpError = blockNumber.Val;
+
+                // Declare error.
+                return TFTP_ERROR;
+            } else
+                break;
+        }
 
-            // Declare error.
-            return TFTP_ERROR;
-        } else
+        // Must wait for ACK from server before we transmit next block,
+        // unless the window has room for it.
+        if (_tftpFlags.bits.bIsClosing ||
+                (uint16_t) (MutExVar.group2._tftpBlockNumber.Val - _tftpAckedBlock) >= _tftpWindowSize)
             break;
 
+        // Or else, wait for put to become ready so that caller
+        // can transfer more data blocks.
+        _tftpState = SM_TFTP_WAIT;
+
     case SM_TFTP_WAIT:
         // Wait for UDP is to be ready to transmit.
         if (UDPIsPutReady(_tftpSocket)) {
+            // The timeout counts from the oldest block not acknowledged
+            if (MutExVar.group2._tftpBlockNumber.Val == _tftpAckedBlock)
+                _tftpStartTick = TickGet();
+
             // Put next block of data.
             MutExVar.group2._tftpBlockNumber.Val++;
             UDPPut(0);
@@ -1254,7 +1418,7 @@ void TFTPPut(uint8_t c)
     ++MutExVar.group2._tftpBlockLength.Val;
 
     // Check to see if data block is full.
-    if (MutExVar.group2._tftpBlockLength.v[1] == TFTP_BLOCK_SIZE_MSB) {
+    if (MutExVar.group2._tftpBlockLength.Val == _tftpBlockSize) {
         // If it is, then transmit this block.
         UDPFlush();
 
@@ -1295,6 +1459,10 @@ static void _TFTPSendFileName(TFTP_OPCODE opcode, uint8_t *fileName)
     UDPPut('t');
     UDPPut(0);
 
+    // Ask for larger blocks and a window, if the transfer can use them
+    if (opcode == TFTP_OPCODE_RRQ || _tftpFlags.bits.bWithOptions)
+        _TFTPSendOptions();
+
     // Transmit it.
     UDPFlush();
 
@@ -1329,6 +1497,10 @@ static void _TFTPSendROMFileName(TFTP_OPCODE opcode, ROM uint8_t *fileName)
     UDPPut('t');
     UDPPut(0);
 
+    // Ask for larger blocks and a window, if the transfer can use them
+    if (opcode == TFTP_OPCODE_RRQ || _tftpFlags.bits.bWithOptions)
+        _TFTPSendOptions();
+
     // Transmit it.
     UDPFlush();
 
@@ -1337,6 +1509,75 @@ static void _TFTPSendROMFileName(TFTP_OPCODE opcode, ROM uint8_t *fileName)
 }
 #endif
 
+static void _TFTPSendOptions(void)
+{
+    uint8_t vValue[6];
+
+#if TFTP_BLOCK_SIZE_MAX > 512u
+    if (TFTP_BLOCK_SIZE_ASKED > TFTP_BLOCK_SIZE) {
+        UDPPutROMString((ROM uint8_t *) "blksize");
+        UDPPut(0);
+        uitoa(TFTP_BLOCK_SIZE_ASKED, vValue);
+        UDPPutString(vValue);
+        UDPPut(0);
+    }
+#endif
+
+#if TFTP_WINDOW_SIZE > 1u
+    if (TFTP_WINDOW_SIZE_ASKED > 1u) {
+        UDPPutROMString((ROM uint8_t *) "windowsize");
+        UDPPut(0);
+        uitoa(TFTP_WINDOW_SIZE_ASKED, vValue);
+        UDPPutString(vValue);
+        UDPPut(0);
+    }
+#endif
+}
+
+// Reads the options of an OACK packet.  Returns false if the server
+// answered with an option or a value we did not ask for.
+static bool _TFTPGetOptions(void)
+{
+    uint8_t vName[12];
+    uint8_t vValue[6];
+    uint8_t *p;
+    uint8_t i;
+    uint16_t wValue;
+
+    while (1) {
+        // Option name, then its value, both NUL terminated
+        for (p = vName, i = 0; i < sizeof (vName); i++, p++) {
+            if (!UDPGet(p))
+                return i == 0u;
+            if (*p == 0u)
+                break;
+        }
+        if (i == sizeof (vName))
+            return false;
+
+        for (p = vValue, i = 0; i < sizeof (vValue); i++, p++) {
+            if (!UDPGet(p))
+                return false;
+            if (*p == 0u)
+                break;
+        }
+        if (i == 0u || i == sizeof (vValue))
+            return false;
+        wValue = (uint16_t) atoi((char *) vValue);
+
+        if (stricmppgm2ram(vName, (ROM uint8_t *) "blksize") == 0) {
+            if (wValue < 8u || wValue > TFTP_BLOCK_SIZE_ASKED)
+                return false;
+            _tftpBlockSize = wValue;
+        } else if (stricmppgm2ram(vName, (ROM uint8_t *) "windowsize") == 0) {
+            if (wValue < 1u || wValue > TFTP_WINDOW_SIZE_ASKED)
+                return false;
+            _tftpWindowSize = wValue;
+        } else
+            return false;
+    }
+}
+
 static void _TFTPSendAck(TCPIP_UINT16_VAL blockNumber)
 {
     // Write opCode.
@@ -63,11 +63,29 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 //  - (Head pointer == Tail pointer - 1), accounting for wraparound,
 //    is defined as a completely full FIFO.  As a result, the max data
 //    in a FIFO is the buffer size - 1.
-static uint8_t vUARTRXFIFO[65];
-static uint8_t vUARTTXFIFO[17];
+static uint8_t vUARTRXFIFO[UART2TCPBRIDGE_RX_FIFO_SIZE];
+static uint8_t vUARTTXFIFO[UART2TCPBRIDGE_TX_FIFO_SIZE];
 static volatile uint8_t *RXHeadPtr = vUARTRXFIFO, *RXTailPtr = vUARTRXFIFO;
 static volatile uint8_t *TXHeadPtr = vUARTTXFIFO, *TXTailPtr = vUARTTXFIFO;
 
+// Number of bytes in one of the FIFOs
+#define FIFO_COUNT(Head, Tail, FIFO) \
+    ((uint16_t) ((Head) >= (Tail) ? (Head) - (Tail) : (Head) + sizeof (FIFO) - (Tail)))
+
+// Hardware flow control, used when the hardware profile defines the RTS
+// output (UARTRTS_TRIS/UARTRTS_IO) and CTS input (UARTCTS_TRIS/UARTCTS_IO)
+// pins, both active low.  RTS is released once the RX FIFO is 3/4 full, so
+// that the other side stops before it overflows, and asserted again when
+// the FIFO is back to half full.  Nothing is transmitted while CTS is
+// released.
+#define RX_FIFO_RTS_OFF     (sizeof (vUARTRXFIFO) * 3u / 4u)
+#define RX_FIFO_RTS_ON      (sizeof (vUARTRXFIFO) / 2u)
+#if defined(UARTCTS_IO)
+#define UART_MAY_SEND()     (UARTCTS_IO == 0u)
+#else
+#define UART_MAY_SEND()     (1)
+#endif
+
 /*********************************************************************
  * Function:        void UART2TCPBridgeInit(void)
  *
@@ -144,6 +162,14 @@ void UART2TCPBridgeInit(void)
     UBRG = CLOSEST_UBRG_VALUE;
 #endif
 
+#if defined(UARTRTS_IO)
+    // Ready to receive
+    UARTRTS_IO = 0;
+    UARTRTS_TRIS = 0;
+#endif
+#if defined(UARTCTS_TRIS)
+    UARTCTS_TRIS = 1;
+#endif
 }
 
 /*********************************************************************
@@ -168,6 +194,8 @@ void UART2TCPBridgeTask(void)
         SM_SOCKET_OBTAINED
     } BridgeState = SM_HOME;
     static TCP_SOCKET MySocket = INVALID_SOCKET;
+    static uint16_t wUnflushed; // UART bytes written to MySocket since the last flush
+    static uint32_t dwUnflushedTime; // When the first of them was written
     uint16_t wMaxPut, wMaxGet, w;
     uint8_t *RXHeadPtrShadow, *RXTailPtrShadow;
     uint8_t *TXHeadPtrShadow, *TXTailPtrShadow;
@@ -197,6 +225,8 @@ void UART2TCPBridgeTask(void)
     case SM_SOCKET_OBTAINED:
         // Reset all buffers if the connection was lost
         if (TCPWasReset(MySocket)) {
+            wUnflushed = 0;
+
             // Optionally discard anything in the UART FIFOs
             //RXHeadPtr = vUARTRXFIFO;
             //RXTailPtr = vUARTRXFIFO;
@@ -247,11 +277,11 @@ void UART2TCPBridgeTask(void)
         TXTailPtrShadow = (uint8_t *) TXTailPtr;
 #if defined(__XC8)
         PIE1bits.RCIE = 1;
-        if (TXHeadPtrShadow != TXTailPtrShadow)
+        if ((TXHeadPtrShadow != TXTailPtrShadow) && UART_MAY_SEND())
             PIE1bits.TXIE = 1;
 #else
         IEC1bits.U2RXIE = 1;
-        if (TXHeadPtrShadow != TXTailPtrShadow)
+        if ((TXHeadPtrShadow != TXTailPtrShadow) && UART_MAY_SEND())
             IEC1bits.U2TXIE = 1;
 #endif
 
@@ -266,6 +296,10 @@ void UART2TCPBridgeTask(void)
             wMaxPut = wMaxGet;
         if (wMaxPut) // See if we can transfer anything
         {
+            if (wUnflushed == 0u)
+                dwUnflushedTime = TickGet();
+            wUnflushed += wMaxPut;
+
             // Transfer the data over.  Note that a two part put
             // may be needed if the data spans the vUARTRXFIFO
             // end to start address.
@@ -277,12 +311,16 @@ void UART2TCPBridgeTask(void)
             }
             TCPPutArray(MySocket, RXTailPtrShadow, wMaxPut);
             RXTailPtrShadow += wMaxPut;
+        }
 
-            // No flush.  The stack will automatically flush and do
-            // transmit coallescing to minimize the number of TCP
-            // packets that get sent.  If you explicitly call TCPFlush()
-            // here, latency will go down, but so will max throughput
-            // and bandwidth efficiency.
+        // Coalesce the UART bytes into full segments, but do not hold
+        // them longer than UART2TCPBRIDGE_FLUSH_TIMEOUT.  Left alone, the
+        // stack would wait for half of the TX FIFO to be used or for
+        // TCP_AUTO_TRANSMIT_TIMEOUT_VAL.
+        if (wUnflushed && ((wUnflushed >= UART2TCPBRIDGE_FLUSH_SIZE) ||
+                (TickGet() - dwUnflushedTime >= UART2TCPBRIDGE_FLUSH_TIMEOUT))) {
+            TCPFlush(MySocket);
+            wUnflushed = 0;
         }
 
         //
@@ -319,13 +357,18 @@ void UART2TCPBridgeTask(void)
 #endif
         RXTailPtr = (volatile uint8_t *)RXTailPtrShadow;
         TXHeadPtr = (volatile uint8_t *)TXHeadPtrShadow;
+#if defined(UARTRTS_IO)
+        // Let the other side send again once the RX FIFO has drained
+        if (FIFO_COUNT(RXHeadPtr, RXTailPtr, vUARTRXFIFO) <= RX_FIFO_RTS_ON)
+            UARTRTS_IO = 0;
+#endif
 #if defined(__XC8)
         PIE1bits.RCIE = 1;
-        if (TXHeadPtrShadow != TXTailPtrShadow)
+        if ((TXHeadPtrShadow != TXTailPtrShadow) && UART_MAY_SEND())
             PIE1bits.TXIE = 1;
 #else
         IEC1bits.U2RXIE = 1;
-        if (TXHeadPtrShadow != TXTailPtrShadow)
+        if ((TXHeadPtrShadow != TXTailPtrShadow) && UART_MAY_SEND())
             IEC1bits.U2TXIE = 1;
 #endif
 
@@ -354,9 +397,11 @@ void UART2TCPBridgeISR(void)
 {
     // NOTE: All local variables used here should be declared static
     static uint8_t i;
+    static volatile uint8_t *NextPtr;
 
-    // Store a received byte, if pending, if possible
-    if (PIR1bits.RCIF) {
+    // Store the received bytes, if pending, if possible.  The UART holds
+    // up to two of them.
+    while (PIR1bits.RCIF) {
         // Get the byte
         i = RCREG;
 
@@ -364,18 +409,23 @@ void UART2TCPBridgeISR(void)
         PIR1bits.RCIF = 0;
 
         // Copy the byte into the local FIFO, if it won't cause an overflow
-        if (RXHeadPtr != RXTailPtr - 1) {
-            if ((RXHeadPtr != vUARTRXFIFO + sizeof (vUARTRXFIFO)) || (RXTailPtr != vUARTRXFIFO)) {
-                *RXHeadPtr++ = i;
-                if (RXHeadPtr >= vUARTRXFIFO + sizeof (vUARTRXFIFO))
-                    RXHeadPtr = (volatile uint8_t *)vUARTRXFIFO;
-            }
+        NextPtr = RXHeadPtr + 1;
+        if (NextPtr >= vUARTRXFIFO + sizeof (vUARTRXFIFO))
+            NextPtr = (volatile uint8_t *)vUARTRXFIFO;
+        if (NextPtr != RXTailPtr) {
+            *RXHeadPtr = i;
+            RXHeadPtr = NextPtr;
         }
+
+#if defined(UARTRTS_IO)
+        if (FIFO_COUNT(RXHeadPtr, RXTailPtr, vUARTRXFIFO) >= RX_FIFO_RTS_OFF)
+            UARTRTS_IO = 1;
+#endif
     }
 
     // Transmit a byte, if pending, if possible
     if (PIR1bits.TXIF) {
-        if (TXHeadPtr != TXTailPtr) {
+        if ((TXHeadPtr != TXTailPtr) && UART_MAY_SEND()) {
             TXREG = *TXTailPtr++;
             if (TXTailPtr >= vUARTTXFIFO + sizeof (vUARTTXFIFO))
                 TXTailPtr = (volatile uint8_t *)vUARTTXFIFO;
@@ -413,22 +463,30 @@ void _U2RXInterrupt(void)
 #endif
 {
     uint8_t i;
-
-    // Store a received byte, if pending, if possible
-    // Get the byte
-    i = U2RXREG;
+    volatile uint8_t *NextPtr;
 
     // Clear the interrupt flag so we don't keep entering this ISR
     IFS1bits.U2RXIF = 0;
 
-    // Copy the byte into the local FIFO, if it won't cause an overflow
-    if (RXHeadPtr != RXTailPtr - 1) {
-        if ((RXHeadPtr != vUARTRXFIFO + sizeof (vUARTRXFIFO)) || (RXTailPtr != vUARTRXFIFO)) {
-            *RXHeadPtr++ = i;
-            if (RXHeadPtr >= vUARTRXFIFO + sizeof (vUARTRXFIFO))
-                RXHeadPtr = vUARTRXFIFO;
+    // Store all the bytes waiting in the UART RX buffer, if possible
+    while (U2STAbits.URXDA) {
+        // Get the byte
+        i = U2RXREG;
+
+        // Copy the byte into the local FIFO, if it won't cause an overflow
+        NextPtr = RXHeadPtr + 1;
+        if (NextPtr >= vUARTRXFIFO + sizeof (vUARTRXFIFO))
+            NextPtr = vUARTRXFIFO;
+        if (NextPtr != RXTailPtr) {
+            *RXHeadPtr = i;
+            RXHeadPtr = NextPtr;
         }
     }
+
+#if defined(UARTRTS_IO)
+    if (FIFO_COUNT(RXHeadPtr, RXTailPtr, vUARTRXFIFO) >= RX_FIFO_RTS_OFF)
+        UARTRTS_IO = 1;
+#endif
 }
 /*********************************************************************
  * Function:        void _ISR _U2TXInterrupt(void)
@@ -455,14 +513,16 @@ void _ISR _U2TXInterrupt(void)
 void _U2TXInterrupt(void)
 #endif
 {
-    // Transmit a byte, if pending, if possible
-    if (TXHeadPtr != TXTailPtr) {
+    // Transmit the pending bytes, as many as the UART TX buffer takes
+    if ((TXHeadPtr != TXTailPtr) && UART_MAY_SEND()) {
         // Clear the TX interrupt flag before transmitting again
         IFS1bits.U2TXIF = 0;
 
-        U2TXREG = *TXTailPtr++;
-        if (TXTailPtr >= vUARTTXFIFO + sizeof (vUARTTXFIFO))
-            TXTailPtr = vUARTTXFIFO;
+        do {
+            U2TXREG = *TXTailPtr++;
+            if (TXTailPtr >= vUARTTXFIFO + sizeof (vUARTTXFIFO))
+                TXTailPtr = vUARTTXFIFO;
+        } while ((TXHeadPtr != TXTailPtr) && !U2STAbits.UTXBF);
     } else // Disable the TX interrupt if we are done so that we don't keep entering this ISR
     {
         IEC1bits.U2TXIE = 0;
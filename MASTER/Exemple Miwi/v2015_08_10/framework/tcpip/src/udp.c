@@ -58,6 +58,53 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 // Last port number for randomized local port number selection
 #define LOCAL_UDP_PORT_END_NUMBER (8192u)
 
+// Datagrams that can wait in the MAC RX buffer for all the sockets.  With a
+// MAC that cannot hold frames (see MAC_CAN_HOLD_RX), only the one that
+// StackTask() stopped at is queued.
+#if !defined(UDP_RX_QUEUE_SIZE)
+#define UDP_RX_QUEUE_SIZE (8u)
+#endif
+
+// Datagrams that can wait on one socket, the next ones are dropped
+#if !defined(UDP_RX_QUEUE_DEPTH)
+#define UDP_RX_QUEUE_DEPTH (4u)
+#endif
+
+// RX buffer space that queued datagrams leave to the other frames
+#if !defined(UDP_RX_MIN_FREE)
+#define UDP_RX_MIN_FREE (2u * 1518u)
+#endif
+
+// Time after which a datagram that no application read is dropped
+#if !defined(UDP_RX_TIMEOUT)
+#define UDP_RX_TIMEOUT (TICK_SECOND / 2)
+#endif
+
+#if (UDP_RX_QUEUE_SIZE < 1u) || (UDP_RX_QUEUE_SIZE > 254u)
+#error Invalid UDP_RX_QUEUE_SIZE value specified
+#endif
+
+#if (UDP_RX_QUEUE_DEPTH < 1u) || (UDP_RX_QUEUE_DEPTH > UDP_RX_QUEUE_SIZE)
+#error Invalid UDP_RX_QUEUE_DEPTH value specified
+#endif
+
+// Marks the end of a list of UDPRxQueue[] entries
+#define UDP_RX_NONE (0xffu)
+
+// A datagram waiting in the MAC RX buffer
+typedef struct {
+    UDP_DATAGRAM d;
+    uint16_t wGetOffset; // Bytes read by UDPGet() and UDPGetArray()
+    uint16_t wTime; // TickGetDiv256() when it was queued
+    uint8_t next; // Next datagram of the socket, or next free entry
+
+    struct {
+        unsigned char bRead : 1; // Seen by UDPIsGetReady(), released on the next StackTask()
+        unsigned char bGot : 1; // Returned by UDPGetDatagrams(), kept until UDPReleaseDatagrams()
+        unsigned char bNewRemote : 1; // The socket takes the sender as remote node once it is read
+    } flags;
+} UDP_RX_ENTRY;
+
 /***************************************************************************
   Section:
     UDP Global Variables
@@ -73,16 +120,14 @@ uint16_t UDPTxCount; // Number of bytes written to this UDP segment
 uint16_t UDPRxCount; // Number of bytes read from this UDP segment
 static UDP_SOCKET LastPutSocket = INVALID_UDP_SOCKET; // Indicates the last socket to which data was written
 static uint16_t wPutOffset; // Offset from beginning of payload where data is to be written.
-static uint16_t wGetOffset; // Offset from beginning of payload from where data is to be read.
 
-// Stores various flags for the UDP module
+// Datagrams waiting in the MAC RX buffer, linked in one list per socket
+static UDP_RX_ENTRY UDPRxQueue[UDP_RX_QUEUE_SIZE];
+static uint8_t UDPRxFree; // First unused entry
+static uint8_t UDPRxQueued; // Number of used entries
+static uint8_t activeRx = UDP_RX_NONE; // Datagram read by UDPGet() and UDPGetArray()
 
-static struct {
-    unsigned char bFirstRead : 1; // No data has been read from this segment yet
-    unsigned char bWasDiscarded : 1; // The data in this segment has been discarded
-} Flags;
-
-// Indicates which socket has currently received data for this loop
+// Indicates which socket has received the last datagram
 static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
 /****************************************************************************
@@ -91,7 +136,12 @@ static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
  ***************************************************************************/
 
 static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h, NODE_INFO *remoteNode,
-        IP_ADDR *localIP);
+        IP_ADDR *localIP, bool *bNewRemote);
+static bool QueueDatagram(UDP_SOCKET s, UDP_HEADER *h, NODE_INFO *remoteNode,
+        bool bNewRemote);
+static void ReleaseDatagram(UDP_SOCKET s);
+static UDP_RX_ENTRY *ActiveDatagram(void);
+static void SeekDatagram(UDP_DATAGRAM *d, uint16_t wOffset);
 
 /****************************************************************************
   Section:
@@ -124,11 +174,20 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h, NODE_INFO *remoteNode,
 void UDPInit(void)
 {
     UDP_SOCKET s;
+    uint8_t i;
+
+    for (i = 0; i < UDP_RX_QUEUE_SIZE; i++)
+        UDPRxQueue[i].next = i + 1u;
+    UDPRxQueue[UDP_RX_QUEUE_SIZE - 1u].next = UDP_RX_NONE;
+    UDPRxFree = 0;
+    UDPRxQueued = 0;
+    activeRx = UDP_RX_NONE;
+    UDPRxCount = 0;
 
     for (s = 0; s < MAX_UDP_SOCKETS; s++) {
+        UDPSocketInfo[s].rxCount = 0;
         UDPClose(s);
     }
-    Flags.bWasDiscarded = 1;
 }
 
 /*****************************************************************************
@@ -240,7 +299,7 @@ UDP_SOCKET UDPOpenEx(uint32_t remoteHost, uint8_t remoteHostType, UDP_PORT local
 #endif
                 case UDP_OPEN_NODE_INFO:
                     //skip DNS and ARP resolution steps if connecting to a remote node which we've already
-                    memcpy((void *) (uint8_t *) & p->remote, (void *) (uint8_t *) (PTR_BASE) remoteHost, sizeof (p->remote));
+                    memcpy((void *) (uint8_t *) & p->remote, (void *) (uint8_t *) (PTR_BASE) remoteHost, sizeof (p->remote.remoteNode));
                     p->smState = UDP_OPENED;
                     // CALL UDPFlushto transmit incluind peding data.
                     break;
@@ -250,6 +309,10 @@ UDP_SOCKET UDPOpenEx(uint32_t remoteHost, uint8_t remoteHostType, UDP_PORT local
             }
             p->remotePort = remotePort;
 
+            // Let UDPTask() resolve the remote node
+            if (p->smState != UDP_OPENED)
+                StackSignal(STACK_MODULE_UDP, STACK_EVENT_APP);
+
             // Mark this socket as active.
             // Once an active socket is set, subsequent operation can be
             // done without explicitely supply socket identifier.
@@ -294,6 +357,10 @@ void UDPTask(void)
         if ((UDPSocketInfo[ss].smState == UDP_OPENED) ||
                 (UDPSocketInfo[ss].smState == UDP_CLOSED))
             continue;
+
+        // Come back on the next pass until the remote node is resolved
+        StackSignal(STACK_MODULE_UDP, STACK_EVENT_BUSY);
+
         // A timeout has occured.  Respond to this timeout condition
         // depending on what state this socket is in.
         switch (UDPSocketInfo[ss].smState) {
@@ -543,12 +610,16 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
 
   Remarks:
     This function does not affect the previously designated active socket.
+    The datagrams still queued on the socket are discarded.
  ***************************************************************************/
 void UDPClose(UDP_SOCKET s)
 {
     if (s >= MAX_UDP_SOCKETS)
         return;
 
+    while (UDPSocketInfo[s].rxCount != 0u)
+        ReleaseDatagram(s);
+
     UDPSocketInfo[s].localPort = INVALID_UDP_PORT;
     UDPSocketInfo[s].remote.remoteNode.IPAddr.Val = 0x00000000;
     UDPSocketInfo[s].smState = UDP_CLOSED;
@@ -608,8 +679,14 @@ void UDPSetTxBuffer(uint16_t wOffset)
  ***************************************************************************/
 void UDPSetRxBuffer(uint16_t wOffset)
 {
-    IPSetRxBuffer(wOffset + sizeof (UDP_HEADER));
-    wGetOffset = wOffset;
+    UDP_RX_ENTRY *e;
+
+    e = ActiveDatagram();
+    if (e == NULL)
+        return;
+
+    SeekDatagram(&e->d, wOffset);
+    e->wGetOffset = wOffset;
 }
 
 /****************************************************************************
@@ -968,21 +1045,41 @@ void UDPFlush(void)
 
   Returns:
     The number of bytes that can be read from this socket.
+
+  Remarks:
+    The bytes are those of the oldest datagram queued on the socket.  It is
+    dropped on the next StackTask() call, or by UDPDiscard(), after which
+    this function returns the next one.
  ***************************************************************************/
 uint16_t UDPIsGetReady(UDP_SOCKET s)
 {
+    UDP_SOCKET_INFO *p;
+    UDP_RX_ENTRY *e;
+
     activeUDPSocket = s;
-    if (SocketWithRxData != s)
+    activeRx = UDP_RX_NONE;
+    if (s >= MAX_UDP_SOCKETS || UDPSocketInfo[s].rxCount == 0u)
         return 0;
 
-    // If this is the very first time we are accessing this packet,
-    // move the read point to the begining of the packet.
-    if (Flags.bFirstRead) {
-        Flags.bFirstRead = 0;
-        UDPSetRxBuffer(0);
+    p = &UDPSocketInfo[s];
+    activeRx = p->rxFirst;
+    e = &UDPRxQueue[activeRx];
+
+    // A server socket answers the sender of the datagram being read
+    if (!e->flags.bRead) {
+        e->flags.bRead = 1;
+        if (e->flags.bNewRemote) {
+            memcpy((void *) &p->remote.remoteNode,
+                    (const void *) &e->d.remoteNode, sizeof (p->remote.remoteNode));
+            p->remotePort = e->d.remotePort;
+        }
     }
 
-    return UDPRxCount - wGetOffset;
+    // Another socket or the TCP module may have moved the read pointer
+    SeekDatagram(&e->d, e->wGetOffset);
+    UDPRxCount = e->d.wLength;
+
+    return e->d.wLength - e->wGetOffset;
 }
 
 /*****************************************************************************
@@ -1009,12 +1106,15 @@ uint16_t UDPIsGetReady(UDP_SOCKET s)
  ***************************************************************************/
 bool UDPGet(uint8_t *v)
 {
+    UDP_RX_ENTRY *e;
+
     // Make sure that there is data to return
-    if ((wGetOffset >= UDPRxCount) || (SocketWithRxData != activeUDPSocket))
+    e = ActiveDatagram();
+    if (e == NULL || e->wGetOffset >= e->d.wLength)
         return false;
 
     *v = MACGet();
-    wGetOffset++;
+    e->wGetOffset++;
 
     return true;
 }
@@ -1049,18 +1149,20 @@ bool UDPGet(uint8_t *v)
 uint16_t UDPGetArray(uint8_t *cData, uint16_t wDataLen)
 {
     uint16_t wBytesAvailable;
+    UDP_RX_ENTRY *e;
 
     // Make sure that there is data to return
-    if ((wGetOffset >= UDPRxCount) || (SocketWithRxData != activeUDPSocket))
+    e = ActiveDatagram();
+    if (e == NULL || e->wGetOffset >= e->d.wLength)
         return 0;
 
     // Make sure we don't try to read more data than exists
-    wBytesAvailable = UDPRxCount - wGetOffset;
+    wBytesAvailable = e->d.wLength - e->wGetOffset;
     if (wBytesAvailable < wDataLen)
         wDataLen = wBytesAvailable;
 
     wDataLen = MACGetArray(cData, wDataLen);
-    wGetOffset += wDataLen;
+    e->wGetOffset += wDataLen;
 
     return wDataLen;
 }
@@ -1089,17 +1191,218 @@ uint16_t UDPGetArray(uint8_t *cData, uint16_t wDataLen)
   Remarks:
     It is safe to call this function more than is necessary.  If no data is
     available, this function does nothing.
+
+    The space of the datagram in the MAC RX buffer is freed, and the next
+    UDPIsGetReady() call returns the next datagram queued on the socket.
  ***************************************************************************/
 void UDPDiscard(void)
 {
-    if (!Flags.bWasDiscarded) {
-        MACDiscardRx();
-        UDPRxCount = 0;
-        SocketWithRxData = INVALID_UDP_SOCKET;
-        Flags.bWasDiscarded = 1;
+    if (ActiveDatagram() != NULL)
+        ReleaseDatagram(activeUDPSocket);
+}
+
+/*****************************************************************************
+  Function:
+    uint8_t UDPGetDatagrams(UDP_SOCKET s, UDP_DATAGRAM *dgrams, uint8_t count)
+
+  Summary:
+    Returns the datagrams queued on a socket.
+
+  Description:
+    This function describes up to count datagrams queued on the socket,
+    oldest first, without copying their data.  Read the data with
+    UDPGetDatagramArray(), then give the RX buffer space back with
+    UDPReleaseDatagrams().
+
+  Precondition:
+    UDPInit() must have been previously called.
+
+  Parameters:
+    s - The socket to read from
+    dgrams - Array receiving the descriptions
+    count - Size of the array
+
+  Returns:
+    The number of datagrams described.
+
+  Remarks:
+    The datagrams returned stay queued until UDPReleaseDatagrams() or
+    UDPClose() is called, they are not dropped by StackTask().  The socket
+    keeps its remote node: to answer a datagram, copy its remoteNode and
+    remotePort to UDPSocketInfo[s] before calling UDPIsPutReady().
+ ***************************************************************************/
+uint8_t UDPGetDatagrams(UDP_SOCKET s, UDP_DATAGRAM *dgrams, uint8_t count)
+{
+    uint8_t i, n;
+
+    if (s >= MAX_UDP_SOCKETS)
+        return 0;
+
+    i = UDPSocketInfo[s].rxFirst;
+    for (n = 0; n < count && n < UDPSocketInfo[s].rxCount; n++) {
+        UDPRxQueue[i].flags.bGot = 1;
+        memcpy((void *) &dgrams[n], (const void *) &UDPRxQueue[i].d, sizeof (UDP_DATAGRAM));
+        i = UDPRxQueue[i].next;
+    }
+
+    return n;
+}
+
+/*****************************************************************************
+  Function:
+    uint16_t UDPGetDatagramArray(UDP_DATAGRAM *dgram, uint16_t wOffset,
+                                 uint8_t *cData, uint16_t wDataLen)
+
+  Summary:
+    Reads bytes of a datagram returned by UDPGetDatagrams().
+
+  Description:
+    This function copies bytes of a queued datagram from the MAC RX buffer.
+    Any part of the datagram can be read, any number of times.
+
+  Precondition:
+    UDPGetDatagrams() returned dgram and it was not released.
+
+  Parameters:
+    dgram - The datagram to read
+    wOffset - Offset of the first byte to read in the datagram data
+    cData - The buffer to receive the bytes being read.  If NULL, the bytes
+            are only skipped.
+    wDataLen - Number of bytes to read
+
+  Returns:
+    The number of bytes read, less than wDataLen at the end of the datagram.
+
+  Remarks:
+    The MAC read pointer is moved: call UDPIsGetReady() again before using
+    UDPGet() or UDPGetArray().
+ ***************************************************************************/
+uint16_t UDPGetDatagramArray(UDP_DATAGRAM *dgram, uint16_t wOffset, uint8_t *cData, uint16_t wDataLen)
+{
+    if (wOffset >= dgram->wLength)
+        return 0;
+
+    if (wDataLen > dgram->wLength - wOffset)
+        wDataLen = dgram->wLength - wOffset;
+
+    SeekDatagram(dgram, wOffset);
+    return MACGetArray(cData, wDataLen);
+}
+
+/*****************************************************************************
+  Function:
+    void UDPReleaseDatagrams(UDP_SOCKET s, uint8_t count)
+
+  Summary:
+    Drops the oldest datagrams queued on a socket.
+
+  Description:
+    This function drops up to count datagrams, oldest first, and gives
+    their space back to the MAC RX buffer, where the frames waiting for it
+    can then be received.
+
+  Precondition:
+    UDPInit() must have been previously called.
+
+  Parameters:
+    s - The socket
+    count - Number of datagrams to drop, ex: the number UDPGetDatagrams()
+            returned
+
+  Returns:
+    None
+ ***************************************************************************/
+void UDPReleaseDatagrams(UDP_SOCKET s, uint8_t count)
+{
+    if (s >= MAX_UDP_SOCKETS)
+        return;
+
+    while (count-- != 0u && UDPSocketInfo[s].rxCount != 0u)
+        ReleaseDatagram(s);
+}
+
+/*****************************************************************************
+  Function:
+    void UDPReleaseRx(void)
+
+  Summary:
+    Drops the datagrams that the applications are done with.
+
+  Description:
+    This function drops the datagrams read with UDPIsGetReady() since the
+    last call, and the ones that no application read within
+    UDP_RX_TIMEOUT.  It is called by StackTask() before receiving new
+    frames.
+
+  Precondition:
+    UDPInit() must have been previously called.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+
+  Remarks:
+    Without MAC_CAN_HOLD_RX, every datagram is dropped since the MAC
+    discards the frame.
+ ***************************************************************************/
+void UDPReleaseRx(void)
+{
+    UDP_SOCKET s;
+    UDP_RX_ENTRY *e;
+
+    if (UDPRxQueued == 0u)
+        return;
+
+    for (s = 0; s < MAX_UDP_SOCKETS; s++) {
+        while (UDPSocketInfo[s].rxCount != 0u) {
+            e = &UDPRxQueue[UDPSocketInfo[s].rxFirst];
+#if defined(MAC_CAN_HOLD_RX)
+            if (e->flags.bGot)
+                break;
+            if (!e->flags.bRead && (uint16_t) TickGetDiv256() - e->wTime <= (uint16_t) (UDP_RX_TIMEOUT / 256))
+                break;
+#endif
+            ReleaseDatagram(s);
+        }
     }
 }
 
+/*****************************************************************************
+  Function:
+    bool UDPIsRxQueueFull(void)
+
+  Summary:
+    Determines if StackTask() must stop receiving frames.
+
+  Description:
+    This function tells if the socket which received the last datagram, the
+    queue or the MAC RX buffer is full.  StackTask() then lets the
+    applications read the datagrams, the next frames wait in the MAC.
+
+  Precondition:
+    UDPProcess() returned true.
+
+  Parameters:
+    None
+
+  Return Values:
+    true - No other datagram should be received now
+    false - Frames can still be received
+ ***************************************************************************/
+bool UDPIsRxQueueFull(void)
+{
+#if defined(MAC_CAN_HOLD_RX)
+    return UDPRxFree == UDP_RX_NONE ||
+            UDPSocketInfo[SocketWithRxData].rxCount >= UDP_RX_QUEUE_DEPTH ||
+            MACGetFreeRxSize() < UDP_RX_MIN_FREE;
+#else
+    // The datagram is lost when the MAC receives the next frame
+    return true;
+#endif
+}
+
 /****************************************************************************
   Section:
     Data Processing Functions
@@ -1126,8 +1429,8 @@ void UDPDiscard(void)
     len - Total length of the UDP segment.
 
   Return Values:
-    true - A valid packet is waiting and the stack applications should be
-        called to handle it.
+    true - A valid packet was queued on its socket and the stack
+        applications should be called to handle it.
     false - The packet was discarded.
  ***************************************************************************/
 bool UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, uint16_t len)
@@ -1136,8 +1439,7 @@ bool UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, uint16_t len)
     UDP_SOCKET s;
     PSEUDO_HEADER pseudoHeader;
     TCPIP_UINT32_VAL checksums;
-
-    UDPRxCount = 0;
+    bool bNewRemote;
 
     // Retrieve UDP header.
     MACGetArray((uint8_t *) & h, sizeof (h));
@@ -1170,26 +1472,150 @@ bool UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, uint16_t len)
         }
     }
 
-    s = FindMatchingSocket(&h, remoteNode, localIP);
-    if (s == INVALID_UDP_SOCKET) {
-        // If there is no matching socket, There is no one to handle
-        // this data.  Discard it.
+    s = FindMatchingSocket(&h, remoteNode, localIP, &bNewRemote);
+    if (s == INVALID_UDP_SOCKET || !QueueDatagram(s, &h, remoteNode, bNewRemote)) {
+        // If there is no matching socket, or no room on it, There is no
+        // one to handle this data.  Discard it.
         MACDiscardRx();
         return false;
-    } else {
-        SocketWithRxData = s;
-        UDPRxCount = h.Length;
-        Flags.bFirstRead = 1;
-        Flags.bWasDiscarded = 0;
     }
 
+    SocketWithRxData = s;
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    static bool QueueDatagram(UDP_SOCKET s, UDP_HEADER *h,
+                              NODE_INFO *remoteNode, bool bNewRemote)
+
+  Summary:
+    Queues the datagram being processed on a socket.
+
+  Description:
+    This function adds the current frame to the datagrams waiting on the
+    socket.  With MAC_CAN_HOLD_RX, the frame is kept in the MAC RX buffer
+    and StackTask() can go on with the next frames.
+
+  Precondition:
+    The UDP header of the current frame was read.
+
+  Parameters:
+    s - The socket which receives the datagram
+    h - Its UDP header
+    remoteNode - IP and MAC of the sender
+    bNewRemote - The socket takes the sender as remote node
+
+  Return Values:
+    true - The datagram was queued
+    false - The socket, the queue or the MAC RX buffer is full
+ ***************************************************************************/
+static bool QueueDatagram(UDP_SOCKET s, UDP_HEADER *h, NODE_INFO *remoteNode,
+        bool bNewRemote)
+{
+    UDP_SOCKET_INFO *p;
+    UDP_RX_ENTRY *e;
+    uint8_t i;
+
+    p = &UDPSocketInfo[s];
+    i = UDPRxFree;
+    if (i == UDP_RX_NONE || p->rxCount >= UDP_RX_QUEUE_DEPTH)
+        return false;
+
+#if defined(MAC_CAN_HOLD_RX)
+    // Leave room for the frames of the other protocols
+    if (UDPRxQueued != 0u && MACGetFreeRxSize() < UDP_RX_MIN_FREE)
+        return false;
+#endif
+
+    e = &UDPRxQueue[i];
+    UDPRxFree = e->next;
+    UDPRxQueued++;
+
+    memcpy((void *) &e->d.remoteNode, (const void *) remoteNode, sizeof (e->d.remoteNode));
+    e->d.remotePort = h->SourcePort;
+    e->d.wLength = h->Length;
+    e->wGetOffset = 0;
+    e->wTime = (uint16_t) TickGetDiv256();
+    e->next = UDP_RX_NONE;
+    e->flags.bRead = 0;
+    e->flags.bGot = 0;
+    e->flags.bNewRemote = bNewRemote;
+
+#if defined(MAC_CAN_HOLD_RX)
+    // The MAC no longer discards the frame on the next MACGetHeader()
+    IPSetRxBuffer(0);
+    e->d.ptrData = MACHoldRx() + sizeof (UDP_HEADER);
+#endif
+
+    if (p->rxCount++ == 0u)
+        p->rxFirst = i;
+    else
+        UDPRxQueue[p->rxLast].next = i;
+    p->rxLast = i;
+
+#if defined(STACK_USE_BERKELEY_API)
+    BerkeleySocketSignal(SOCK_DGRAM, s);
+#endif
+
     return true;
 }
 
+// Drops the oldest datagram queued on socket s
+static void ReleaseDatagram(UDP_SOCKET s)
+{
+    UDP_SOCKET_INFO *p;
+    uint8_t i;
+
+    p = &UDPSocketInfo[s];
+    i = p->rxFirst;
+
+#if defined(MAC_CAN_HOLD_RX)
+    // The UDP header is inside the frame even if there is no data
+    MACReleaseRx(UDPRxQueue[i].d.ptrData - sizeof (UDP_HEADER));
+#else
+    MACDiscardRx();
+#endif
+
+    p->rxFirst = UDPRxQueue[i].next;
+    p->rxCount--;
+
+    UDPRxQueue[i].next = UDPRxFree;
+    UDPRxFree = i;
+    UDPRxQueued--;
+
+    if (activeRx == i) {
+        activeRx = UDP_RX_NONE;
+        UDPRxCount = 0;
+    }
+}
+
+// Datagram read by UDPGet() and UDPGetArray(), NULL if the active socket has none
+static UDP_RX_ENTRY *ActiveDatagram(void)
+{
+    if (activeRx == UDP_RX_NONE || activeUDPSocket >= MAX_UDP_SOCKETS ||
+            UDPSocketInfo[activeUDPSocket].rxCount == 0u ||
+            UDPSocketInfo[activeUDPSocket].rxFirst != activeRx)
+        return NULL;
+
+    return &UDPRxQueue[activeRx];
+}
+
+// Moves the MAC read pointer to the data byte wOffset of a queued datagram
+static void SeekDatagram(UDP_DATAGRAM *d, uint16_t wOffset)
+{
+#if defined(MAC_CAN_HOLD_RX)
+    MACSetReadPtr(d->ptrData + wOffset);
+#else
+    // The datagram is still the current frame
+    IPSetRxBuffer(wOffset + sizeof (UDP_HEADER));
+#endif
+}
+
 /*****************************************************************************
   Function:
     static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h, NODE_INFO *remoteNode,
-                                            IP_ADDR *localIP)
+                                            IP_ADDR *localIP, bool *bNewRemote)
 
   Summary:
     Matches an incoming UDP segment to a currently active socket.
@@ -1205,6 +1631,8 @@ bool UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, uint16_t len)
     h - The UDP header that was received.
     remoteNode - IP and MAC of the remote node that sent this segment.
     localIP - IP address that this segment was destined for.
+    bNewRemote - Set if the socket must take the sender as remote node
+        once the segment is read.
 
   Returns:
     A UDP_SOCKET handle of a matching socket, or INVALID_UDP_SOCKET when no
@@ -1212,7 +1640,8 @@ bool UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, uint16_t len)
  ***************************************************************************/
 static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
         NODE_INFO *remoteNode,
-        IP_ADDR *localIP)
+        IP_ADDR *localIP,
+        bool *bNewRemote)
 {
     UDP_SOCKET s;
     UDP_SOCKET partialMatch;
@@ -1232,6 +1661,7 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
         return INVALID_UDP_SOCKET;
 
     partialMatch = INVALID_UDP_SOCKET;
+    *bNewRemote = false;
 
     p = UDPSocketInfo;
     for (s = 0; s < MAX_UDP_SOCKETS; s++) {
@@ -1251,14 +1681,10 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
         p++;
     }
 
-    if (partialMatch != INVALID_UDP_SOCKET) {
-        p = &UDPSocketInfo[partialMatch];
-
-        memcpy((void *) &p->remote.remoteNode,
-                (const void *) remoteNode, sizeof (p->remote.remoteNode));
-
-        p->remotePort = h->SourcePort;
-    }
+    // Datagrams queued before this one may still be answered, the remote
+    // node changes when it is read (UDPIsGetReady())
+    if (partialMatch != INVALID_UDP_SOCKET)
+        *bNewRemote = true;
 
     return partialMatch;
 }
@@ -49,6 +49,14 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 // Which UDP port to broadcast from for the UDP tests
 #define PERFORMANCE_PORT  9
 
+// Datagrams read at once by the receive test
+#define PERFORMANCE_RX_BATCH  8u
+
+// Datagrams received on PERFORMANCE_PORT, and missing from their counter
+static uint32_t dwRxCount, dwRxLost;
+
+static void UDPPerformanceRxTask(void);
+
 /*****************************************************************************
   Function:
     void UDPPerformanceTask(void)
@@ -70,6 +78,9 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
     after comparison will indicate if your application is unacceptably
     blocking the processor or taking too long to execute.
 
+    The receive performance is tested by sending datagrams to the
+    PERFORMANCE_PORT of the board, see UDPPerformanceGetRxStats().
+
   Precondition:
     UDP is initialized.
 
@@ -82,10 +93,14 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 void UDPPerformanceTask(void)
 {
     UDP_SOCKET MySocket;
-    NODE_INFO Remote;
+    // Static: UDPOpenEx() takes its address as 32 bits, which a stack
+    // address of a 64 bit host does not fit in
+    static NODE_INFO Remote;
     uint16_t wTemp;
     static uint32_t dwCounter = 1;
 
+    UDPPerformanceRxTask();
+
     if ((BUTTON3_IO) && (dwCounter > 1024u))
         return;
 
@@ -146,6 +161,88 @@ void UDPPerformanceTask(void)
 
     // Close the socket so it can be used by other modules
     UDPClose(MySocket);
+
+    // More datagrams to send, keep StackGetIdleTime() at 0
+    StackSignal(STACK_MODULE_UDP, STACK_EVENT_TX);
+}
+
+/*****************************************************************************
+  Function:
+    static void UDPPerformanceRxTask(void)
+
+  Summary:
+    Tests the receive performance of the UDP module.
+
+  Description:
+    This function reads the datagrams sent to PERFORMANCE_PORT in batches,
+    without copying them out of the MAC RX buffer.  Like the ones this
+    module sends, they start with a 32 bit counter, whose gaps give the
+    number of datagrams lost.
+
+  Precondition:
+    UDP is initialized.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ ***************************************************************************/
+static void UDPPerformanceRxTask(void)
+{
+    static UDP_SOCKET MySocket = INVALID_UDP_SOCKET;
+    static uint32_t dwNext = 1;
+    UDP_DATAGRAM dgrams[PERFORMANCE_RX_BATCH];
+    uint32_t dwCounter;
+    uint8_t i, n;
+
+    if (MySocket == INVALID_UDP_SOCKET) {
+        MySocket = UDPOpenEx(0, UDP_OPEN_SERVER, PERFORMANCE_PORT, 0);
+        if (MySocket == INVALID_UDP_SOCKET)
+            return;
+    }
+
+    while ((n = UDPGetDatagrams(MySocket, dgrams, PERFORMANCE_RX_BATCH)) != 0u) {
+        for (i = 0; i < n; i++) {
+            if (UDPGetDatagramArray(&dgrams[i], 0, (uint8_t *) & dwCounter, sizeof (dwCounter)) != sizeof (dwCounter))
+                continue;
+
+            // A counter going back is a new test run
+            if (dwCounter > dwNext)
+                dwRxLost += dwCounter - dwNext;
+            dwNext = dwCounter + 1;
+            dwRxCount++;
+        }
+        UDPReleaseDatagrams(MySocket, n);
+    }
+}
+
+/*****************************************************************************
+  Function:
+    void UDPPerformanceGetRxStats(uint32_t *received, uint32_t *lost)
+
+  Summary:
+    Returns the results of the receive test.
+
+  Description:
+    This function returns the number of datagrams received on
+    PERFORMANCE_PORT, and the number of datagrams missing from their
+    counter.
+
+  Precondition:
+    None
+
+  Parameters:
+    received - Number of datagrams received
+    lost - Number of datagrams lost
+
+  Returns:
+    None
+ ***************************************************************************/
+void UDPPerformanceGetRxStats(uint32_t *received, uint32_t *lost)
+{
+    *received = dwRxCount;
+    *lost = dwRxLost;
 }
 
 #endif // #if defined(STACK_USE_UDP_PERFORMANCE_TEST)
@@ -84,6 +84,20 @@ extern void DisplayIPValue(IP_ADDR IPVal);
 #define MDNS_ANNOUNCE_INTERVAL      250 // msecs (time between announcement packets)
 #define MDNS_ANNOUNCE_WAIT          250 // msecs (delay before announcing)
 
+/* Constants from RFC 6762 */
+#define MDNS_RESPONSE_DELAY_MIN      20 // msecs (random delay before answering with a shared record)
+#define MDNS_RESPONSE_DELAY_MAX     120 // msecs
+#define MDNS_RESPONSE_INTERVAL     1000 // msecs (minimum time between two multicasts of a record)
+#define MDNS_QUERY_INTERVAL_MAX      60 // secs (repeated queries are spaced by 1, 2, 4... secs up to this)
+#define MDNS_UNANSWERED_TTL         120 // secs (lifetime of the cache entry of a host that does not answer)
+
+/* Our records, pre-serialized by mDNSBuildTemplates(): NAME, TYPE,
+ * RDLENGTH and RDATA of A, PTR, SRV and TXT */
+#define MDNS_TEMPLATE_SIZE  ((MAX_HOST_NAME_SIZE + 1 + 2 + 2 + 4) + \
+                             (MAX_SRV_TYPE_SIZE + 1 + 2 + 2 + MAX_RR_NAME_SIZE + 1) + \
+                             (MAX_RR_NAME_SIZE + 1 + 2 + 2 + 6 + MAX_HOST_NAME_SIZE + 1) + \
+                             (MAX_RR_NAME_SIZE + 1 + 2 + 2 + 1 + MAX_TXT_DATA_SIZE))
+
 // SOFTAP_ZEROCONF_SUPPORT
 enum {
     MDNS_RESPONDER_INIT = 0,
@@ -183,6 +197,11 @@ typedef struct _mDNSResourceRecord {
     bool bNameAndTypeMatched;
     bool bResponseRequested;
     bool bResponseSuppressed;
+
+    uint16_t tmplOffset; // Position of the record in gResponderCtx.tmpl
+    uint16_t tmplNameLen; // Length of its NAME and TYPE there
+    uint16_t tmplLen; // Length of NAME, TYPE, RDLENGTH and RDATA, 0 if none
+    TICK lastMulticast; // Last time the record was multicast
 } mDNSResourceRecord;
 
 /* DNS-SD Specific Data-Structures */
@@ -212,6 +231,20 @@ typedef struct __attribute__((__packed__)) _mDNSResponderCtx
     bool bLastMsgIsIncomplete; // Last DNS msg was truncated
     TCPIP_UINT16_VAL query_id; // mDNS Query transaction ID
     IP_ADDR prev_ipaddr; // To keep track of changes in IP-addr
+
+    bool bTemplatesValid; // tmpl matches rr_list
+    uint8_t tmpl[MDNS_TEMPLATE_SIZE]; // rr_list, pre-serialized by mDNSBuildTemplates()
+
+    bool bProbeDefense; // The message being processed probes one of our records
+    uint8_t pendingAnswers; // Records to multicast at responseStart + responseDelay, bit i is rr_list[i]
+    TICK responseStart;
+    TICK responseDelay;
+
+    uint8_t szQueryName[MAX_HOST_NAME_SIZE]; // Host name looked up by mDNSResolve()
+    bool bQueryPending; // Its query goes out at queryStart + queryDelay
+    TICK queryStart;
+    TICK queryDelay;
+    TICK cacheTime; // Last aging of gCache
 }
 mDNSResponderCtx;
 
@@ -283,6 +316,20 @@ static mDNSProcessCtx_host gHostCtx;
 static mDNSProcessCtx_sd gSDCtx;
 static mDNSResponderCtx gResponderCtx;
 
+/* Host names of other devices, see mDNSResolve().  A host that is looked
+ * up but has not answered yet has an entry with no address, which keeps
+ * the spacing of its queries. */
+typedef struct {
+    uint8_t name[MAX_HOST_NAME_SIZE];
+    IP_ADDR ip;
+    uint32_t ttl; // Seconds left, 0 if the entry is free
+    uint32_t ttlReceived; // TTL of the record when it was received, 0 if no answer yet
+    TICK queryLast; // Last time the name was asked on the network
+    TICK queryInterval; // Minimum time before asking again
+} mDNSCacheEntry;
+
+static mDNSCacheEntry gCache[MDNS_CACHE_SIZE];
+
 /* DNS-SD State-Machine */
 
 const uint8_t *CONST_STR_local = (uint8_t *) "local";
@@ -496,37 +543,39 @@ MDNS_STATIC void mDNSRename(uint8_t *strLabel, uint8_t nLabelId, uint8_t *strBas
 
 /***************************************************************
   Function:
-    static void mDNSPutString(uint8_t * String)
+    static uint16_t mDNSEncodeString(uint8_t *string, uint8_t *dst, uint16_t size)
 
   Summary:
-    Writes a string to the Multicast-DNS socket.
+    Encodes a string as a DNS name.
 
   Description:
-    This function writes a string to the Multicast-DNS socket,
-    ensuring that it is properly formatted.
+    This function converts a dotted string into length-prefixed
+    labels, as specified in RFC 1035, followed by the null
+    terminator.  The '\.' and '\\' of a formatted Serv-Instance
+    are written as '.' and '\'.
 
   Precondition:
-    UDP socket is obtained and ready for writing.
+    None
 
   Parameters:
-    String - the string to write to the UDP socket.
+    string - the string to encode
+    dst - buffer receiving the encoded name
+    size - size of dst, the labels are truncated to fit
 
   Returns:
-    None
+    Length of the encoded name, including the null terminator
  **************************************************************/
-
-MDNS_STATIC void mDNSPutString(uint8_t * string)
+MDNS_STATIC uint16_t mDNSEncodeString(uint8_t *string, uint8_t *dst, uint16_t size)
 {
-    uint8_t *right_ptr, *label_ptr;
-    uint8_t label[MAX_LABEL_SIZE];
+    uint8_t *right_ptr, *len_ptr, *p, *end;
     uint8_t i;
-    uint8_t len;
 
     right_ptr = string;
+    p = dst;
+    end = dst + size - 1; // Keep room for the null terminator
 
-    while (1) {
-        label_ptr = label;
-        len = 0;
+    while (p < end) {
+        len_ptr = p++;
         while (*right_ptr) {
             i = *right_ptr;
 
@@ -536,27 +585,56 @@ MDNS_STATIC void mDNSPutString(uint8_t * string)
                  * instead of just '.' */
                 if (i == '\\') {
                     right_ptr++;
+                    if (*right_ptr == 0x00u)
+                        break;
                 } else
                     break;
             }
-            *label_ptr++ = *right_ptr;
-            len++;
+            if (p < end)
+                *p++ = *right_ptr;
             right_ptr++;
         }
         i = *right_ptr++;
 
-        // Put the length and data
-        // Also, skip over the '.' in the input string
-        UDPPUT_LOCAL(len);
-        UDPPutArray(label, len);
-        string = right_ptr;
+        // Put the length, skip over the '.' in the input string
+        *len_ptr = (uint8_t) (p - len_ptr - 1);
 
         if (i == 0x00u || i == '/' || i == ',' || i == '>')
             break;
     }
 
     // Put the string null terminator character
-    UDPPUT_LOCAL(0x00);
+    *p++ = 0x00;
+
+    return (uint16_t) (p - dst);
+}
+
+/***************************************************************
+  Function:
+    static void mDNSPutString(uint8_t * String)
+
+  Summary:
+    Writes a string to the Multicast-DNS socket.
+
+  Description:
+    This function writes a string to the Multicast-DNS socket,
+    ensuring that it is properly formatted.
+
+  Precondition:
+    UDP socket is obtained and ready for writing.
+
+  Parameters:
+    String - the string to write to the UDP socket.
+
+  Returns:
+    None
+ **************************************************************/
+
+MDNS_STATIC void mDNSPutString(uint8_t * string)
+{
+    uint8_t encoded[MAX_RR_NAME_SIZE + 1];
+
+    UDPPutArray(encoded, mDNSEncodeString(string, encoded, sizeof (encoded)));
 }
 
 /***************************************************************
@@ -725,6 +803,132 @@ MDNS_STATIC bool mDNSProbe(mDNSProcessCtx_common *pCtx)
     return true;
 }
 
+/***************************************************************
+  Function:
+    static void mDNSSetMulticastRemote(void)
+
+  Summary:
+    Points mDNS_socket back to the Multicast-Address.
+
+  Description:
+    The UDP layer sets the remote of mDNS_socket to the sender of
+    each received message.  This function restores 224.0.0.251:5353
+    before a multicast send.
+
+  Precondition:
+    UDP socket (mDNS_socket) is obtained.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSSetMulticastRemote(void)
+{
+    memcpy((void *) &UDPSocketInfo[mDNS_socket].remote.remoteNode,
+            (const void *) &mDNSRemote, sizeof (mDNSRemote));
+    UDPSocketInfo[mDNS_socket].remotePort = MDNS_PORT;
+    UDPSocketInfo[mDNS_socket].localPort = MDNS_PORT;
+}
+
+/***************************************************************
+  Function:
+    static void mDNSBuildTemplates(void)
+
+  Summary:
+    Pre-serializes our resource-records.
+
+  Description:
+    The NAME, TYPE, RDLENGTH and RDATA of each record in rr_list
+    are encoded once into gResponderCtx.tmpl, so that mDNSSendRR()
+    only copies them to the socket, with CLASS and TTL in between.
+    RDLENGTH of the records is updated from the encoded RDATA.
+
+    Whatever changes the names, the rdata or the port of a record
+    clears gResponderCtx.bTemplatesValid for the templates to be
+    built again on the next send.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSBuildTemplates(void)
+{
+    mDNSResourceRecord *pRR;
+    uint8_t *p, *pRDLength;
+    uint8_t i, len;
+
+    p = gResponderCtx.tmpl;
+    for (i = 0; i < MAX_RR_NUM; i++) {
+        pRR = &gResponderCtx.rr_list[i];
+        pRR->tmplOffset = (uint16_t) (p - gResponderCtx.tmpl);
+        pRR->tmplNameLen = 0;
+        pRR->tmplLen = 0;
+
+        if ((pRR->name == NULL) || (pRR->pOwnerCtx == NULL))
+            continue;
+
+        // NAME and TYPE
+        p += mDNSEncodeString(pRR->name, p,
+                (i == QTYPE_A_INDEX) ? (MAX_HOST_NAME_SIZE + 1) :
+                (i == QTYPE_PTR_INDEX) ? (MAX_SRV_TYPE_SIZE + 1) : (MAX_RR_NAME_SIZE + 1));
+        *p++ = pRR->type.v[1];
+        *p++ = pRR->type.v[0];
+        pRR->tmplNameLen = (uint16_t) (p - gResponderCtx.tmpl) - pRR->tmplOffset;
+
+        // RDLENGTH, written once RDATA is in
+        pRDLength = p;
+        p += 2;
+
+        switch (pRR->type.Val) {
+        case QTYPE_A:
+            memcpy(p, pRR->ip.v, 4);
+            p += 4;
+            break;
+
+        case QTYPE_PTR:
+            p += mDNSEncodeString(pRR->rdata, p, MAX_RR_NAME_SIZE + 1);
+            break;
+
+        case QTYPE_SRV:
+            *p++ = pRR->srv.priority.v[1];
+            *p++ = pRR->srv.priority.v[0];
+            *p++ = pRR->srv.weight.v[1];
+            *p++ = pRR->srv.weight.v[0];
+            *p++ = pRR->srv.port.v[1];
+            *p++ = pRR->srv.port.v[0];
+            p += mDNSEncodeString(pRR->rdata, p, MAX_HOST_NAME_SIZE + 1);
+            break;
+
+        case QTYPE_TXT:
+            // As of now only single TXT string supported!!
+            len = ((mDNSProcessCtx_sd *) pRR->pOwnerCtx)->sd_txt_rec_len;
+            if (len >= MAX_TXT_DATA_SIZE)
+                len = MAX_TXT_DATA_SIZE - 1;
+            *p++ = len;
+            memcpy(p, pRR->rdata, len);
+            p += len;
+            break;
+
+        default:
+            break;
+        }
+
+        pRR->rdlength.Val = (uint16_t) (p - pRDLength - 2);
+        pRDLength[0] = pRR->rdlength.v[1];
+        pRDLength[1] = pRR->rdlength.v[0];
+        pRR->tmplLen = (uint16_t) (p - gResponderCtx.tmpl) - pRR->tmplOffset;
+    }
+
+    gResponderCtx.bTemplatesValid = true;
+}
+
 /***************************************************************
   Function:
     static bool mDNSSendRR(struct mDNSResourceRecord *record,
@@ -770,7 +974,7 @@ mDNSSendRR(mDNSResourceRecord *pRecord,
 {
     MDNS_MSG_HEADER mDNS_header;
     TCPIP_UINT32_VAL ttl;
-    uint8_t rec_length;
+    uint8_t *tmpl;
     uint8_t record_type;
 
     record_type = pRecord->type.Val;
@@ -783,6 +987,15 @@ mDNSSendRR(mDNSResourceRecord *pRecord,
         return false;
     }
 
+    if (!gResponderCtx.bTemplatesValid)
+        mDNSBuildTemplates();
+
+    if (pRecord->tmplLen == 0u) {
+        WARN_MDNS_PRINT("RR Type not supported \n");
+        return false;
+    }
+    tmpl = &gResponderCtx.tmpl[pRecord->tmplOffset];
+
     while (!UDPIsPutReady(mDNS_socket));
 
     if (bIsFirstRR) {
@@ -802,19 +1015,8 @@ mDNSSendRR(mDNSResourceRecord *pRecord,
 
     ttl.Val = pRecord->ttl.Val;
 
-    //rex#if 0
-    //rex    if ( name != NULL)
-    //rex    {
-    //rex        mDNSPutString(name);
-    //rex    }
-    //rex    else
-    //rex#endif
-    //rex    {
-    mDNSPutString(pRecord->name);
-    //rex    }
-
-    UDPPUT_LOCAL(0x00);
-    UDPPUT_LOCAL(record_type); // Resource Record Type
+    // Name and Resource Record Type
+    UDPPutArray(tmpl, pRecord->tmplNameLen);
 
     /* MSB of Upper-byte in Class filed acts as
      * Cache-Flush bit to notify all Neighbors to
@@ -823,6 +1025,7 @@ mDNSSendRR(mDNSResourceRecord *pRecord,
     if (UDPSocketInfo[mDNS_socket].remotePort == MDNS_PORT) {
         UDPPUT_LOCAL(cFlush);
         UDPPUT_LOCAL(0x01); // Class
+        pRecord->lastMulticast = TickGet();
     } else {
         // Legacy/Unicast DNS response should not set the Cache-Flush bit.
         UDPPUT_LOCAL(0x00);
@@ -834,77 +1037,154 @@ mDNSSendRR(mDNSResourceRecord *pRecord,
     UDPPUT_LOCAL(ttl.v[1]);
     UDPPUT_LOCAL(ttl.v[0]);
 
-    switch (record_type) {
-    case QTYPE_A:
+    // Res-Data Length and Res-Data
+    UDPPutArray(tmpl + pRecord->tmplNameLen, pRecord->tmplLen - pRecord->tmplNameLen);
 
-        UDPPUT_LOCAL(0x00); // 0x0004 Data length
-        UDPPUT_LOCAL(0x04);
-        UDPPUT_LOCAL(pRecord->ip.v[0]); // Put out IP address
-        UDPPUT_LOCAL(pRecord->ip.v[1]); // AppConfig.MyIPAddr.v[1]
-        UDPPUT_LOCAL(pRecord->ip.v[2]);
-        UDPPUT_LOCAL(pRecord->ip.v[3]);
+    if (bIsLastRR) {
+        UDPFlush();
+    }
 
-        break;
+    return true;
+}
 
-    case QTYPE_PTR:
+/***************************************************************
+  Function:
+    static void mDNSSendResponse(uint8_t answers, uint8_t known,
+                                 uint16_t query_id)
 
-        /* 2 bytes extra. One for Prefix Length for first-label.
-         * Other one for NULL terminator */
-        pRecord->rdlength.Val = strlen((char *) pRecord->rdata) + 2;
+  Summary:
+    Sends one response with the requested records and the records
+    that the querier will need next.
 
-        UDPPUT_LOCAL(pRecord->rdlength.v[1]);
-        UDPPUT_LOCAL(pRecord->rdlength.v[0]); // Res-Data Length
+  Description:
+    The records of the answers are put in the Answer section.  As
+    in RFC 6763 (12), the Additional section gets the SRV, TXT and
+    A records with a PTR answer, and the A record with a SRV
+    answer, so that browsing a service takes a single query.
+    Additional records that are in the known answers of the query,
+    or that were multicast in the last second, are left out.
 
-        mDNSPutString(((mDNSProcessCtx_sd *) (pRecord->pOwnerCtx))->sd_qualified_name);
+  Precondition:
+    UDP socket (mDNS_socket) is obtained, with the remote set to
+    the querier or to the Multicast-Address.
 
-        break;
+  Parameters:
+    answers - records to answer, bit i is rr_list[i]
+    known - records already known by the querier
+    query_id - Query-ID of the response, 0 if multicast
 
-    case QTYPE_SRV:
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSSendResponse(uint8_t answers, uint8_t known, uint16_t query_id)
+{
+    MDNS_MSG_HEADER mDNS_header;
+    mDNSResourceRecord *pRR;
+    uint8_t additionals;
+    uint8_t i;
+    bool bMulticast;
 
-        /* 2 bytes extra. One for Prefix Length for first-label.
-         * Other one for NULL terminator */
+    if (mDNS_socket == INVALID_UDP_SOCKET)
+        return;
 
-        pRecord->rdlength.Val = strlen((char *) pRecord->rdata) + 2;
-        pRecord->rdlength.Val += 6; // for priority, weight, and port
+    bMulticast = (UDPSocketInfo[mDNS_socket].remotePort == MDNS_PORT);
 
-        UDPPUT_LOCAL(pRecord->rdlength.v[1]);
-        UDPPUT_LOCAL(pRecord->rdlength.v[0]); // Res-Data Length
+    additionals = 0;
+    if (answers & (1u << QTYPE_PTR_INDEX))
+        additionals |= (1u << QTYPE_SRV_INDEX) | (1u << QTYPE_TXT_INDEX) | (1u << QTYPE_A_INDEX);
+    if (answers & (1u << QTYPE_SRV_INDEX))
+        additionals |= (1u << QTYPE_A_INDEX);
+    additionals &= ~(answers | known);
 
-        UDPPUT_LOCAL(pRecord->srv.priority.v[1]); // Put Priority
-        UDPPUT_LOCAL(pRecord->srv.priority.v[0]);
-        UDPPUT_LOCAL(pRecord->srv.weight.v[1]);
-        UDPPUT_LOCAL(pRecord->srv.weight.v[0]);
-        UDPPUT_LOCAL(pRecord->srv.port.v[1]);
-        UDPPUT_LOCAL(pRecord->srv.port.v[0]);
+    for (i = 0; i < MAX_RR_NUM; i++) {
+        pRR = &gResponderCtx.rr_list[i];
+        if ((pRR->pOwnerCtx == NULL) || (pRR->pOwnerCtx->state != MDNS_STATE_DEFEND)) {
+            answers &= ~(1u << i);
+            additionals &= ~(1u << i);
+        } else if (bMulticast &&
+                (TickGet() - pRR->lastMulticast < (TICK) (MDNS_RESPONSE_INTERVAL * (TICK_SECOND / 1000)))) {
+            additionals &= ~(1u << i);
+        }
+    }
 
-        mDNSPutString(pRecord->rdata);
+    if (answers == 0u)
+        return;
 
-        break;
+    while (!UDPIsPutReady(mDNS_socket));
 
-    case QTYPE_TXT:
+    memset(&mDNS_header, 0, sizeof (MDNS_MSG_HEADER));
+    mDNS_header.query_id.Val = swaps(query_id);
+    mDNS_header.flags.bits.qr = 1; // this is a Response,
+    mDNS_header.flags.bits.aa = 1; // and we are authoritative
+    mDNS_header.flags.Val = swaps(mDNS_header.flags.Val);
 
-        rec_length = strlen((char *) pRecord->rdata);
-        pRecord->rdlength.Val = rec_length + 1;
+    for (i = 0; i < MAX_RR_NUM; i++) {
+        if (answers & (1u << i))
+            mDNS_header.nAnswers.Val++;
+        else if (additionals & (1u << i))
+            mDNS_header.nAdditionalRecords.Val++;
+    }
+    mDNS_header.nAnswers.Val = swaps(mDNS_header.nAnswers.Val);
+    mDNS_header.nAdditionalRecords.Val = swaps(mDNS_header.nAdditionalRecords.Val);
 
-        UDPPUT_LOCAL(pRecord->rdlength.v[1]);
-        UDPPUT_LOCAL(pRecord->rdlength.v[0]); // Res-Data Length
+    UDPPutArray((uint8_t *) & mDNS_header, sizeof (MDNS_MSG_HEADER));
 
-        UDPPUT_LOCAL(pRecord->rdlength.Val - 1); // As of now only single TXT string supported!!
+    // Answers first, then additional records
+    for (i = 0; i < MAX_RR_NUM; i++) {
+        if (answers & (1u << i)) {
+            pRR = &gResponderCtx.rr_list[i];
+            mDNSSendRR(pRR, query_id, (pRR->type.Val == QTYPE_PTR) ? (0x00) : (0x80), 0, false, false);
+        }
+    }
+    for (i = 0; i < MAX_RR_NUM; i++) {
+        if (additionals & (1u << i)) {
+            pRR = &gResponderCtx.rr_list[i];
+            mDNSSendRR(pRR, query_id, (pRR->type.Val == QTYPE_PTR) ? (0x00) : (0x80), 0, false, false);
+        }
+    }
 
-        UDPPutArray(pRecord->rdata, rec_length);
+    UDPFlush();
+}
 
-        break;
+/***************************************************************
+  Function:
+    static void mDNSSendQuestion(uint8_t *name)
 
-    default:
+  Summary:
+    Asks for the address of a host.
 
-        WARN_MDNS_PRINT("RR Type not supported \n");
-    }
+  Description:
+    This function multicasts a query with a single A question,
+    for the lookups of mDNSResolve().  The answer is requested by
+    multicast, so that the other hosts that want it learn it too.
 
-    if (bIsLastRR) {
-        UDPFlush();
-    }
+  Precondition:
+    UDP socket (mDNS_socket) is obtained, with the remote set to
+    the Multicast-Address.
 
-    return true;
+  Parameters:
+    name - Host name, ex: "printer.local"
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSSendQuestion(uint8_t *name)
+{
+    MDNS_MSG_HEADER mDNS_header;
+
+    while (!UDPIsPutReady(mDNS_socket));
+
+    memset(&mDNS_header, 0, sizeof (MDNS_MSG_HEADER));
+    mDNS_header.nQuestions.Val = swaps((uint16_t) 1u);
+    UDPPutArray((uint8_t *) & mDNS_header, sizeof (MDNS_MSG_HEADER));
+
+    mDNSPutString(name);
+    UDPPUT_LOCAL(0x00);
+    UDPPUT_LOCAL(QTYPE_A); // Type
+    UDPPUT_LOCAL(0x00); // Class, multicast response
+    UDPPUT_LOCAL(0x01);
+
+    UDPFlush();
 }
 
 /***************************************************************
@@ -1101,6 +1381,8 @@ void mDNSSDFillResRecords(mDNSProcessCtx_sd *sd)
     rr_list->ttl.Val = RESOURCE_RECORD_TTL_VAL;
     rr_list->pOwnerCtx = (mDNSProcessCtx_common *) sd; /* Save back ptr */
     rr_list->valid = 1; /* Mark as valid */
+
+    gResponderCtx.bTemplatesValid = false;
 }
 
 /***************************************************************
@@ -1157,6 +1439,7 @@ mDNSServiceUpdate(uint16_t port,
         sd->sd_port = port;
         /* Update Port Value in SRV Resource-record */
         gResponderCtx.rr_list[QTYPE_SRV_INDEX].srv.port.Val = port;
+        gResponderCtx.bTemplatesValid = false;
 
         if (txt_record != NULL) {
             sd->sd_txt_rec_len = strncpy_m((char *) sd->sd_txt_rec, sizeof (sd->sd_txt_rec), 1, (uint8_t *) txt_record);
@@ -1217,15 +1500,16 @@ MDNSD_ERR_CODE mDNSServiceDeRegister()
             /* Send GoodBye Packet */
             gResponderCtx.rr_list[QTYPE_PTR_INDEX].ttl.Val = 0;
             gResponderCtx.rr_list[QTYPE_SRV_INDEX].ttl.Val = 0;
-            gResponderCtx.rr_list[QTYPE_SRV_INDEX].ttl.Val = 0;
+            gResponderCtx.rr_list[QTYPE_TXT_INDEX].ttl.Val = 0;
 
             mDNSSendRR(&gResponderCtx.rr_list[QTYPE_PTR_INDEX], 0, 0x00, 3, true, false);
             mDNSSendRR(&gResponderCtx.rr_list[QTYPE_SRV_INDEX], 0, 0x80, 3, false, false);
-            mDNSSendRR(&gResponderCtx.rr_list[QTYPE_SRV_INDEX], 0, 0x80, 3, false, true);
+            mDNSSendRR(&gResponderCtx.rr_list[QTYPE_TXT_INDEX], 0, 0x80, 3, false, true);
         }
         /* Clear gSDCtx struct */
         sd->service_registered = 0;
         memset(sd, 0, sizeof (mDNSProcessCtx_sd));
+        gResponderCtx.bTemplatesValid = false;
         mDNS_responder_state = MDNS_RESPONDER_INIT;
         return MDNSD_SUCCESS;
     } else
@@ -1699,6 +1983,206 @@ mDNSTieBreaker(mDNSResourceRecord *their, mDNSResourceRecord *our)
     return WeWonTheTieBreaker;
 }
 
+/***************************************************************
+  Function:
+    static mDNSCacheEntry *mDNSCacheFind(uint8_t *name)
+
+  Summary:
+    Looks up a host name in the cache.
+
+  Description:
+    None
+
+  Precondition:
+    None
+
+  Parameters:
+    name - Host name, ex: "printer.local"
+
+  Returns:
+    The cache entry of the host, NULL if it has none
+ **************************************************************/
+MDNS_STATIC mDNSCacheEntry *mDNSCacheFind(uint8_t *name)
+{
+    uint8_t i;
+
+    for (i = 0; i < MDNS_CACHE_SIZE; i++) {
+        if ((gCache[i].ttl != 0u) && !strcmp_local_ignore_case(gCache[i].name, name))
+            return &gCache[i];
+    }
+    return NULL;
+}
+
+/***************************************************************
+  Function:
+    static mDNSCacheEntry *mDNSCacheNew(uint8_t *name, bool bReplace)
+
+  Summary:
+    Takes a cache entry for a host name.
+
+  Description:
+    The entry has no address yet and its queries are not spaced.
+
+  Precondition:
+    name is not in the cache, and is shorter than
+    MAX_HOST_NAME_SIZE.
+
+  Parameters:
+    name - Host name, ex: "printer.local"
+    bReplace - true to take the entry closest to expiring when none
+               is free, for the hosts looked up by mDNSResolve()
+
+  Returns:
+    The new entry, NULL if none is free and bReplace is false
+ **************************************************************/
+MDNS_STATIC mDNSCacheEntry *mDNSCacheNew(uint8_t *name, bool bReplace)
+{
+    mDNSCacheEntry *pEntry;
+    uint8_t i;
+
+    pEntry = &gCache[0];
+    for (i = 1; i < MDNS_CACHE_SIZE; i++) {
+        if (gCache[i].ttl < pEntry->ttl)
+            pEntry = &gCache[i];
+    }
+    if ((pEntry->ttl != 0u) && !bReplace)
+        return NULL;
+
+    strcpy((char *) pEntry->name, (char *) name);
+    pEntry->ip.Val = 0;
+    pEntry->ttl = MDNS_UNANSWERED_TTL;
+    pEntry->ttlReceived = 0;
+    pEntry->queryLast = TickGet();
+    pEntry->queryInterval = 0;
+    return pEntry;
+}
+
+/***************************************************************
+  Function:
+    static void mDNSQueryDone(void)
+
+  Summary:
+    Ends the pending lookup, asked on the network.
+
+  Description:
+    Either our query was sent, or another host asked the same
+    question.  The next query for the name is spaced from now.
+
+  Precondition:
+    gResponderCtx.bQueryPending is true.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSQueryDone(void)
+{
+    mDNSCacheEntry *pEntry;
+
+    gResponderCtx.bQueryPending = false;
+
+    pEntry = mDNSCacheFind(gResponderCtx.szQueryName);
+    if (pEntry != NULL)
+        pEntry->queryLast = TickGet();
+}
+
+/***************************************************************
+  Function:
+    static void mDNSCacheUpdate(uint8_t *name, IP_ADDR ip, uint32_t ttl)
+
+  Summary:
+    Stores the A record of another host.
+
+  Description:
+    A new host takes a free entry.  The answer to the lookup of
+    mDNSResolve() takes the entry closest to expiring when none is
+    free, so that the records multicast by all the hosts on the
+    network do not push out the ones the application asks for.
+    As in RFC 6762 (10.1), a record received with a TTL of 0 (a
+    goodbye) is kept one more second.  An answer restarts the
+    spacing of the queries for the host at one second.
+
+  Precondition:
+    None
+
+  Parameters:
+    name - Host name of the record
+    ip - Its address
+    ttl - Its Time-To-Live in seconds
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSCacheUpdate(uint8_t *name, IP_ADDR ip, uint32_t ttl)
+{
+    mDNSCacheEntry *pEntry;
+    bool bLookedUp;
+
+    if ((strlen((char *) name) >= MAX_HOST_NAME_SIZE) ||
+            !strcmp_local_ignore_case(name, gHostCtx.szHostName))
+        return;
+
+    bLookedUp = !strcmp_local_ignore_case(name, gResponderCtx.szQueryName);
+
+    pEntry = mDNSCacheFind(name);
+    if (pEntry == NULL) {
+        if (ttl == 0u)
+            return;
+
+        pEntry = mDNSCacheNew(name, bLookedUp);
+        if (pEntry == NULL)
+            return;
+    } else if ((pEntry->ttlReceived == 0u) && (ttl == 0u)) {
+        // Goodbye of a host that never answered our lookup
+        return;
+    }
+
+    if (ttl == 0u)
+        ttl = 1;
+    pEntry->ip.Val = ip.Val;
+    pEntry->ttl = ttl;
+    pEntry->ttlReceived = ttl;
+    pEntry->queryInterval = 0;
+
+    if (bLookedUp)
+        gResponderCtx.bQueryPending = false;
+}
+
+/***************************************************************
+  Function:
+    static void mDNSCacheAge(void)
+
+  Summary:
+    Counts down the TTL of the cache entries.
+
+  Description:
+    An entry is free again when its TTL reaches 0.
+
+  Precondition:
+    None
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSCacheAge(void)
+{
+    uint8_t i;
+
+    while ((TICK) (TickGet() - gResponderCtx.cacheTime) >= (TICK) TICK_SECOND) {
+        gResponderCtx.cacheTime += TICK_SECOND;
+
+        for (i = 0; i < MDNS_CACHE_SIZE; i++) {
+            if (gCache[i].ttl != 0u)
+                gCache[i].ttl--;
+        }
+    }
+}
+
 MDNS_STATIC uint8_t
 mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
         MDNS_MSG_HEADER * pmDNSMsgHeader,
@@ -1707,13 +2191,14 @@ mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
 {
     mDNSResourceRecord res_rec;
     uint8_t name[MAX_RR_NAME_SIZE];
-    uint16_t i, j;
+    uint16_t i;
     uint16_t len;
     mDNSProcessCtx_common *pOwnerCtx;
     mDNSResourceRecord *pMyRR;
     bool WeWonTheTieBreaker = false;
     bool bMsgIsAQuery; // QUERY or RESPNSE ?
     bool bSenderHasAuthority; // Sender has the authority ?
+    bool bKnown;
 
     bMsgIsAQuery = (pmDNSMsgHeader->flags.bits.qr == 0);
     bSenderHasAuthority = (pmDNSMsgHeader->flags.bits.qr == 1);
@@ -1766,6 +2251,8 @@ mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
                 !strcmp_local_ignore_case(name, (uint8_t *) "_services._dns-sd._udp.local")
                 &&
                 (res_rec.type.Val == QTYPE_PTR)
+                &&
+                (i == QTYPE_PTR_INDEX)
                 ) {
             gResponderCtx.rr_list[i].bNameAndTypeMatched = true;
         }
@@ -1773,6 +2260,16 @@ mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
 
     // Only AN, NS, AR records have extra fields
     if (tag == MDNS_RR_GROUP_QD) {
+        // Another host asks, without known answers and for a multicast
+        // response, the question of our pending lookup: its answer will
+        // reach us as well. RFC 6762 (7.3)
+        if (bMsgIsAQuery && gResponderCtx.bQueryPending &&
+                (pmDNSMsgHeader->nAnswers.Val == 0u) &&
+                ((res_rec.class.v[1] & 0x80) == 0u) &&
+                ((res_rec.type.Val == QTYPE_A) || (res_rec.type.Val == QTYPE_ANY)) &&
+                !strcmp_local_ignore_case(name, gResponderCtx.szQueryName)) {
+            mDNSQueryDone();
+        }
         goto ReviewStage;
     }
 
@@ -1832,7 +2329,12 @@ mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
         break;
 
     case QTYPE_TXT:
-        UDPGetArray(NULL, res_rec.rdlength.Val);
+        // Kept for the known-answer check
+        memset(name, 0, MAX_RR_NAME_SIZE);
+        if (res_rec.rdlength.Val <= MAX_RR_NAME_SIZE)
+            UDPGetArray(name, res_rec.rdlength.Val);
+        else
+            UDPGetArray(NULL, res_rec.rdlength.Val);
 
         g_mDNS_offset += res_rec.rdlength.Val;
 
@@ -1855,6 +2357,12 @@ mDNSProcessIncomingRR(MDNS_RR_GROUP tag,
 
     // We now have all info about this received RR.
 
+    // Remember the addresses of other hosts, for mDNSResolve()
+    if (!bMsgIsAQuery && (res_rec.type.Val == QTYPE_A) &&
+            ((tag == MDNS_RR_GROUP_AN) || (tag == MDNS_RR_GROUP_AR))) {
+        mDNSCacheUpdate(name, res_rec.ip, res_rec.ttl.Val);
+    }
+
 ReviewStage:
 
     // Do the second round
@@ -1870,11 +2378,10 @@ ReviewStage:
                 (pOwnerCtx->state == MDNS_STATE_DEFEND)
                 ) {
             // Simple reply to an incoming DNS query.
-            // Mark all of our RRs for reply.
+            // Mark the RR asked for; mDNSSendResponse() adds the
+            // ones that go with it.
 
-            for (j = 0; j < MAX_RR_NUM; j++) {
-                gResponderCtx.rr_list[j].bResponseRequested = true;
-            }
+            pMyRR->bResponseRequested = true;
         } else if (
                 bMsgIsAQuery &&
                 (tag == MDNS_RR_GROUP_AN) &&
@@ -1883,12 +2390,30 @@ ReviewStage:
             // An answer in the incoming DNS query.
             // Look for possible duplicate (known) answers suppression.
 
-            if ((((res_rec.type.Val == QTYPE_PTR) && (res_rec.ip.Val == gResponderCtx.rr_list[i].ip.Val))
-                    ||
-                    (!strcmp_local_ignore_case(name, gResponderCtx.rr_list[i].rdata)))
-                    &&
-                    (res_rec.ttl.Val > (gResponderCtx.rr_list[i].ttl.Val / 2))
-                    ) {
+            switch (pMyRR->type.Val) {
+            case QTYPE_A:
+                bKnown = (res_rec.ip.Val == pMyRR->ip.Val);
+                break;
+
+            case QTYPE_SRV:
+                bKnown = (res_rec.srv.port.Val == pMyRR->srv.port.Val) &&
+                        !strcmp_local_ignore_case(name, pMyRR->rdata);
+                break;
+
+            case QTYPE_TXT:
+                if (!gResponderCtx.bTemplatesValid)
+                    mDNSBuildTemplates();
+                bKnown = (res_rec.rdlength.Val == pMyRR->rdlength.Val) &&
+                        !memcmp(name, &gResponderCtx.tmpl[pMyRR->tmplOffset + pMyRR->tmplNameLen + 2],
+                        pMyRR->rdlength.Val);
+                break;
+
+            default:
+                bKnown = !strcmp_local_ignore_case(name, pMyRR->rdata);
+                break;
+            }
+
+            if (bKnown && (res_rec.ttl.Val > (pMyRR->ttl.Val / 2))) {
                 gResponderCtx.rr_list[i].bResponseSuppressed = true;
                 DEBUG_MDNS_PRINT("     rr suppressed\r\n");
             }
@@ -1940,6 +2465,7 @@ ReviewStage:
             INFO_MDNS_PRINT("Defending RR: \r\n");
 
             pMyRR->bResponseRequested = true;
+            gResponderCtx.bProbeDefense = true;
 
             UDPDiscard();
 
@@ -1965,6 +2491,45 @@ ReviewStage:
     return 0;
 }
 
+/***************************************************************
+  Function:
+    static void mDNSSendScheduled(void)
+
+  Summary:
+    Sends the delayed response and the lookup that are due.
+
+  Description:
+    Answers with shared records are delayed by mDNSResponder(), so
+    that one response covers the queries of several browsers, and
+    lookups of mDNSResolve() are delayed as in RFC 6762 (5.2).
+
+  Precondition:
+    UDP socket (mDNS_socket) is obtained, and the message received
+    last has been processed.
+
+  Parameters:
+    None
+
+  Returns:
+    None
+ **************************************************************/
+MDNS_STATIC void mDNSSendScheduled(void)
+{
+    if ((gResponderCtx.pendingAnswers != 0u) &&
+            (TickGet() - gResponderCtx.responseStart >= gResponderCtx.responseDelay)) {
+        mDNSSetMulticastRemote();
+        mDNSSendResponse(gResponderCtx.pendingAnswers, 0, 0);
+        gResponderCtx.pendingAnswers = 0;
+    }
+
+    if (gResponderCtx.bQueryPending &&
+            (TickGet() - gResponderCtx.queryStart >= gResponderCtx.queryDelay)) {
+        mDNSSetMulticastRemote();
+        mDNSSendQuestion(gResponderCtx.szQueryName);
+        mDNSQueryDone();
+    }
+}
+
 MDNS_STATIC void mDNSResponder(void)
 {
     MDNS_MSG_HEADER mDNS_header;
@@ -1977,7 +2542,9 @@ MDNS_STATIC void mDNSResponder(void)
 #endif
 
     uint16_t len;
-    uint16_t i, j, count;
+    uint16_t i, j;
+    uint8_t answers, known;
+    mDNSResourceRecord *pRR;
 
     uint16_t rr_count[4];
     MDNS_RR_GROUP rr_group[4];
@@ -2024,8 +2591,10 @@ MDNS_STATIC void mDNSResponder(void)
     case MDNS_RESPONDER_LISTEN:
 
         // Do nothing if no data is waiting
-        if (!UDPIsGetReady(mDNS_socket))
+        if (!UDPIsGetReady(mDNS_socket)) {
+            mDNSSendScheduled();
             return;
+        }
 
         INFO_MDNS_PRINT("mDNSResponder: MDNS_RESPONDER_LISTEN \r\n");
 
@@ -2041,10 +2610,7 @@ MDNS_STATIC void mDNSResponder(void)
             // See section 8.5, draft-cheshire-dnsext-multicastdns-08.txt.
         } else {
             /* Reset the Remote-node information in UDP-socket */
-            memcpy((void *) &UDPSocketInfo[mDNS_socket].remote.remoteNode,
-                    (const void *) &mDNSRemote, sizeof (mDNSRemote));
-            UDPSocketInfo[mDNS_socket].remotePort = MDNS_PORT;
-            UDPSocketInfo[mDNS_socket].localPort = MDNS_PORT;
+            mDNSSetMulticastRemote();
         }
 
         // Retrieve the mDNS header
@@ -2078,6 +2644,9 @@ MDNS_STATIC void mDNSResponder(void)
         rr_count[3] = mDNS_header.nAdditionalRecords.Val;
         rr_group[3] = MDNS_RR_GROUP_AR;
 
+        if (!gResponderCtx.bLastMsgIsIncomplete)
+            gResponderCtx.bProbeDefense = false;
+
         for (i = 0; i < MAX_RR_NUM; i++) {
             // Reset flags
             gResponderCtx.rr_list[i].bNameAndTypeMatched = false;
@@ -2125,38 +2694,54 @@ MDNS_STATIC void mDNSResponder(void)
             return;
         }
 
-        // Count all RRs marked as "reply needed".
-        count = 0;
+        // Collect the RRs marked as "reply needed", bit i is rr_list[i]
+        answers = 0;
+        known = 0;
         for (i = 0; i < MAX_RR_NUM; i++) {
-            if ((gResponderCtx.rr_list[i].pOwnerCtx != NULL) &&
-                    (gResponderCtx.rr_list[i].pOwnerCtx->state == MDNS_STATE_DEFEND) &&
-                    (gResponderCtx.rr_list[i].bResponseRequested == true) &&
-                    (gResponderCtx.rr_list[i].bResponseSuppressed == false)
-                    ) {
-                count++;
+            pRR = &gResponderCtx.rr_list[i];
+            if ((pRR->pOwnerCtx == NULL) || (pRR->pOwnerCtx->state != MDNS_STATE_DEFEND)) {
+                // not ours yet
+            } else if (pRR->bResponseSuppressed) {
+                known |= (1u << i);
+            } else if (pRR->bResponseRequested) {
+                answers |= (1u << i);
             }
         }
 
-        // Send all RRs marked as "reply needed".
-        j = 1;
-        for (i = 0; (count > 0) && (i < MAX_RR_NUM); i++) {
-            if ((gResponderCtx.rr_list[i].pOwnerCtx != NULL) &&
-                    (gResponderCtx.rr_list[i].pOwnerCtx->state == MDNS_STATE_DEFEND) &&
-                    (gResponderCtx.rr_list[i].bResponseRequested == true) &&
-                    (gResponderCtx.rr_list[i].bResponseSuppressed == false)) {
-                mDNSSendRR(
-                        &gResponderCtx.rr_list[i],
-                        mDNS_header.query_id.Val,
-                        (gResponderCtx.rr_list[i].type.Val == QTYPE_PTR) ?
-                        (0x00) : (0x80), // flush, except for PTR; for Conformance Test.
-                        count, // MAX_RR_NUM answers;
-                        (j == 1) ? true : false, // Is this the first RR?
-                        (j == count) ? true : false // Is this the last RR?
-                        );
-                j++;
+        if (UDPSocketInfo[mDNS_socket].remotePort != MDNS_PORT) {
+            // Legacy unicast query: answered at once, with its Query-ID
+            mDNSSendResponse(answers, known, mDNS_header.query_id.Val);
+            mDNSSetMulticastRemote();
+        } else {
+            // A record is multicast at most once per second, unless it
+            // defends against a probe. RFC 6762 (6)
+            for (i = 0; !gResponderCtx.bProbeDefense && (i < MAX_RR_NUM); i++) {
+                if (TickGet() - gResponderCtx.rr_list[i].lastMulticast <
+                        (TICK) (MDNS_RESPONSE_INTERVAL * (TICK_SECOND / 1000)))
+                    answers &= ~(1u << i);
+            }
+
+            if (answers == 0u) {
+                // nothing to send
+            } else if (gResponderCtx.bProbeDefense || (answers & ~(1u << QTYPE_PTR_INDEX))) {
+                // Unique records are answered at once, along with the
+                // shared ones that were waiting
+                mDNSSendResponse(answers | gResponderCtx.pendingAnswers, known, 0);
+                gResponderCtx.pendingAnswers = 0;
+            } else {
+                // The shared PTR record waits 20-120 ms, so that the
+                // browsers asking in that time get a single response
+                if (gResponderCtx.pendingAnswers == 0u) {
+                    gResponderCtx.responseStart = TickGet();
+                    gResponderCtx.responseDelay = (TICK) ((MDNS_RESPONSE_DELAY_MIN +
+                            LFSRRand() % (MDNS_RESPONSE_DELAY_MAX - MDNS_RESPONSE_DELAY_MIN + 1)) * (TICK_SECOND / 1000));
+                }
+                gResponderCtx.pendingAnswers |= answers;
             }
         }
 
+        mDNSSendScheduled();
+
         // end of MDNS_RESPONDER_LISTEN
         break;
 
@@ -2285,6 +2870,8 @@ void mDNSFillHostRecord(void)
 
     gResponderCtx.rr_list[QTYPE_A_INDEX].valid = 1;
     gResponderCtx.rr_list[QTYPE_A_INDEX].pOwnerCtx = (mDNSProcessCtx_common *) & gHostCtx;
+
+    gResponderCtx.bTemplatesValid = false;
 }
 
 MDNSD_ERR_CODE mDNSHostRegister(const char *host_name)
@@ -2317,6 +2904,7 @@ void mDNSInitialize(const char *szHostName)
 {
     gResponderCtx.query_id.Val = 0;
     gResponderCtx.prev_ipaddr.Val = AppConfig.MyIPAddr.Val;
+    gResponderCtx.cacheTime = TickGet();
 
     /* Initial Host-Name is seeded from DEFUALT_HOST_NAME
      * configured in tcpip_config.h. Later on if a name-conflict
@@ -2498,6 +3086,7 @@ void mDNSProcessInternal(mDNSProcessCtx_common *pCtx)
                         (uint8_t *) CONST_STR_local,
                         gHostCtx.szHostName,
                         MAX_HOST_NAME_SIZE);
+                gResponderCtx.bTemplatesValid = false;
 
                 INFO_MDNS_MESG(zeroconf_dbg_msg, "New host name : %s \r\n",
                         gHostCtx.szHostName);
@@ -2511,6 +3100,7 @@ void mDNSProcessInternal(mDNSProcessCtx_common *pCtx)
                             gSDCtx.srv_type,
                             gSDCtx.sd_qualified_name,
                             MAX_LABEL_SIZE);
+                    gResponderCtx.bTemplatesValid = false;
 
                     /* Reset Multicast-UDP socket */
 
@@ -2705,6 +3295,8 @@ void mDNSProcessInternal(mDNSProcessCtx_common *pCtx)
 
 void mDNSProcess(void)
 {
+    mDNSCacheAge();
+
     if (!MACIsLinked()) {
         gHostCtx.common.state = MDNS_STATE_INTF_NOT_CONNECTED;
         return;
@@ -2751,6 +3343,84 @@ void mDNSProcess(void)
     mDNSProcessInternal((mDNSProcessCtx_common *) & gHostCtx);
 }
 
+/***************************************************************
+  Function:
+    bool mDNSResolve(const char *szHostName, IP_ADDR *pIP)
+
+  Summary:
+    Looks up the address of a host on the local network.
+
+  Description:
+    The address comes from the cache of the A records seen in the
+    mDNS responses on the network, so that a lookup does not
+    always cost a query.  When the host is not in the cache, or its
+    record is at 80% of its lifetime, a query is multicast after a
+    random delay of 20-120 ms; the query is not sent if another
+    host asks the same question meanwhile.  A host that does not
+    answer is asked again after 1, 2, 4... seconds, up to one
+    minute.  This spacing is kept in the cache entry of each name,
+    which has no address until the host answers, so looking up
+    several hosts in turn does not restart it.
+
+    Only one name is looked up at a time: a call for another name
+    while a query is waiting returns false without a query.
+
+  Precondition:
+    mDNSInitialize() is called, and mDNSProcess() is polled.
+
+  Parameters:
+    szHostName - Host name, ex: "printer.local"
+    pIP - Receives the address of the host
+
+  Returns:
+    true - pIP holds the address
+    false - The address is not known yet, call again later
+ **************************************************************/
+bool mDNSResolve(const char *szHostName, IP_ADDR *pIP)
+{
+    mDNSCacheEntry *pEntry;
+    bool bKnown;
+
+    pEntry = mDNSCacheFind((uint8_t *) szHostName);
+    bKnown = (pEntry != NULL) && (pEntry->ttlReceived != 0u);
+    if (bKnown) {
+        pIP->Val = pEntry->ip.Val;
+
+        if (pEntry->ttl > pEntry->ttlReceived / 5u)
+            return true;
+    }
+
+    if (gResponderCtx.bQueryPending)
+        return bKnown;
+
+    if (pEntry == NULL) {
+        if (strlen(szHostName) >= MAX_HOST_NAME_SIZE)
+            return false;
+        pEntry = mDNSCacheNew((uint8_t *) szHostName, true);
+    } else if (TickGet() - pEntry->queryLast < pEntry->queryInterval) {
+        return bKnown;
+    }
+
+    strcpy((char *) gResponderCtx.szQueryName, szHostName);
+    gResponderCtx.bQueryPending = true;
+    gResponderCtx.queryStart = TickGet();
+    gResponderCtx.queryDelay = (TICK) ((MDNS_RESPONSE_DELAY_MIN +
+            LFSRRand() % (MDNS_RESPONSE_DELAY_MAX - MDNS_RESPONSE_DELAY_MIN + 1)) * (TICK_SECOND / 1000));
+
+    if (pEntry->queryInterval == 0u)
+        pEntry->queryInterval = TICK_SECOND;
+    else
+        pEntry->queryInterval *= 2;
+    if (pEntry->queryInterval > (TICK) (MDNS_QUERY_INTERVAL_MAX * TICK_SECOND))
+        pEntry->queryInterval = (TICK) (MDNS_QUERY_INTERVAL_MAX * TICK_SECOND);
+
+    // A host that does not answer keeps its entry while it is looked up
+    if (!bKnown)
+        pEntry->ttl = MDNS_UNANSWERED_TTL;
+
+    return bKnown;
+}
+
 /**
  * Zeroconf uses 224.0.0.251
  *            => E0.00.00.FB
@@ -2796,6 +3466,8 @@ mDNSMulticastFilterRegister(void)
 #else /* #if !defined(MRF24WG */
     WF_SetMultiCastFilter(WF_MULTICAST_FILTER_1, mcast_addr);
 #endif /* #if defined(MRF24WG */
+#elif defined(TAP_INTERFACE)
+    // Nothing to do, the Linux TAP driver receives every multicast frame
 #else
 #error Must call appropraite API to enable multicast packet reception in the network controller.
 #endif
@@ -92,6 +92,19 @@ typedef enum {
     TCB Definitions
  ***************************************************************************/
 
+// Blocks of the SACK scoreboard kept in each TCB (8 bytes each), listing the
+// data that the remote node reported as received above the unacknowledged
+// tail.  Only the holes between them are retransmitted during a fast
+// recovery.  0 disables the SACK option, as done on PIC18 to keep the TCB
+// small in the Ethernet RAM.
+#if !defined(TCP_SACK_BLOCKS)
+#if defined(__XC8)
+#define TCP_SACK_BLOCKS (0u)
+#else
+#define TCP_SACK_BLOCKS (3u)
+#endif
+#endif
+
 // TCP Control Block (TCB) stub data storage.  Stubs are stored in local PIC RAM for speed.
 // Current size is 34 bytes (PIC18), 36 bytes (PIC24), or 56 (PIC32)
 
@@ -125,7 +138,8 @@ typedef struct {
         unsigned char bTXFIN : 1; // FIN needs to be transmitted
         unsigned char bSocketReset : 1; // Socket has been reset (self-clearing semaphore)
         unsigned char bSSLHandshaking : 1; // Socket is in an SSL handshake
-        unsigned char filler : 2; // Future expansion
+        unsigned char bTXHold : 1; // New TX data is held back (TCPHoldTX)
+        unsigned char filler : 1; // Future expansion
     } Flags;
     TCPIP_UINT16_VAL remoteHash; // Consists of remoteIP, remotePort, localPort for connected sockets.  It is a localPort number only for listening server sockets.
 
@@ -142,7 +156,8 @@ typedef struct {
 
 // Remainder of TCP Control Block data.
 // The rest of the TCB is stored in Ethernet buffer RAM or elsewhere as defined by vMemoryMedium.
-// Current size is 41 (PIC18), 42 (PIC24), or 48 bytes (PIC32)
+// Current size is 61 (PIC18), 62 (PIC24), or 68 bytes (PIC32), plus
+// 5 + 8*TCP_SACK_BLOCKS bytes for the SACK scoreboard
 
 typedef struct {
     uint32_t retryInterval; // How long to wait before retrying transmission
@@ -164,11 +179,26 @@ typedef struct {
         unsigned char bFINSent : 1; // A FIN has been sent
         unsigned char bSYNSent : 1; // A SYN has been sent
         unsigned char bRemoteHostIsROM : 1; // Remote host is stored in ROM
-        unsigned char bRXNoneACKed1 : 1; // A duplicate ACK was likely received
-        unsigned char bRXNoneACKed2 : 1; // A second duplicate ACK was likely received
-        unsigned char filler : 3; // future use
+        unsigned char vDupACKs : 2; // Count of duplicate ACKs received in a row, up to 3
+        unsigned char bFastRecovery : 1; // Lost data is being retransmitted after 3 duplicate ACKs
+        unsigned char bRTTPending : 1; // dwRTTSEQ is being timed
+        unsigned char bSACKPermitted : 1; // Both ends negotiated the SACK option
     } flags;
     uint16_t wRemoteMSS; // Maximum Segment Size option advertised by the remote node during initial handshaking
+    uint32_t dwSRTT; // Smoothed round trip time, in ticks * 8.  0 until the first measurement
+    uint32_t dwRTTVar; // Round trip time variation, in ticks * 4
+    uint32_t dwRTTSEQ; // Sequence number that ends the segment being timed
+    uint32_t dwRTTTime; // TickGet() value when the timed segment was sent
+    uint32_t dwRecover; // Highest sequence number sent when the last recovery or retransmission timeout started
+#if TCP_SACK_BLOCKS
+    uint32_t dwHighRxt; // End of the last hole retransmitted during the fast recovery
+
+    struct {
+        uint32_t dwLeft; // First sequence number held by the remote node
+        uint32_t dwRight; // Sequence number following the block
+    } SACKBlocks[TCP_SACK_BLOCKS]; // Sorted by sequence number
+    uint8_t vSACKBlocks; // Number of used SACKBlocks
+#endif
 #if defined(STACK_USE_SSL)
     TCPIP_UINT16_VAL localSSLPort; // Local SSL port number (for listening sockets)
 #endif
@@ -265,6 +295,9 @@ ROM uint8_t * TCPPutROMString(TCP_SOCKET hTCP, ROM uint8_t * Data);
 #endif
 
 uint16_t TCPGetTxFIFOFull(TCP_SOCKET hTCP);
+void TCPHoldTX(TCP_SOCKET hTCP, bool bHold);
+uint16_t TCPPokeArray(TCP_SOCKET hTCP, uint8_t *vBuffer, uint16_t wLen, uint16_t wStart);
+uint16_t TCPUnput(TCP_SOCKET hTCP, uint16_t wLen);
 
 // Alias to TCPIsGetReady provided for API completeness
 #define TCPGetRxFIFOFull(a)             TCPIsGetReady(a)
@@ -0,0 +1,279 @@
+/*******************************************************************************
+  IP checksum tests and timing
+
+  Summary:
+    Runs the checksum functions of helpers.c on a Linux host against a
+    byte-wise reference.
+
+  Description:
+    The reference adds the bytes one at a time, at their offset in the data,
+    with end-around carries (RFC 1071).
+    - CalcIPChecksumAdd(): every length up to 300 bytes and longer ones, at
+      the 8 alignments of the buffer, with 0xFF data for the carries.
+    - Chaining: the data summed in two parts at every split point, the sum
+      of a part after an odd length swapped as helpers.h says.
+    - CalcIPChecksumCopy(): the 16 alignments of the destination and source,
+      the bytes around the destination unchanged.
+    - CalcIPChecksumUpdate(): the example of RFC 1624, where eq. 3 gives
+      0x0000, a sum that carries twice, then random words of random data
+      changed and checked against CalcIPChecksum() of the changed data.
+
+    The Makefile builds it for the host (checksum_test), with __XC16 for the
+    16-bit loop of PIC18 and PIC24 (checksum_test_xc16), and with __XC32 for
+    the copy loop of PIC32 (checksum_test_xc32).  With an iteration count,
+    it then times the sum and the copy in bytes per cycle (rdtsc):
+
+      checksum_test [iterations]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#if defined(__XC16)
+#define CHECKSUM_PATH   "16-bit words"
+#elif defined(__XC32)
+#define CHECKSUM_PATH   "32-bit words, PIC32 copy"
+#else
+#define CHECKSUM_PATH   "32-bit words"
+#endif
+
+#define MAX_DATA        (16384u)
+#define GUARD           (0xA5u)
+
+static uint8_t data[MAX_DATA + 8], copy[MAX_DATA + 16];
+static int failures;
+
+/****************************************************************************
+  Stub of the tick module, used by GenerateRandomDWORD() of helpers.c
+ ***************************************************************************/
+
+uint32_t TickGet(void)
+{
+    return 0;
+}
+
+/****************************************************************************
+  Reference
+ ***************************************************************************/
+
+static uint16_t Fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xFFFFu) + (sum >> 16);
+    return (uint16_t) sum;
+}
+
+// Sum of the bytes as words in memory order, like CalcIPChecksumAdd()
+static uint16_t ReferenceSum(uint16_t wSum, const uint8_t *buffer, unsigned count)
+{
+    uint32_t sum = wSum;
+    unsigned i;
+
+    for (i = 0; i < count; i++)
+    {
+        uint16_t word = 0;
+
+        ((uint8_t *) &word)[i & 1u] = buffer[i];
+        sum = Fold(sum + word);
+    }
+    return (uint16_t) sum;
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what, unsigned offset, unsigned count)
+{
+    if (!ok)
+    {
+        printf("checksum_test: FAILED: %s, offset %u, %u bytes\n", what, offset, count);
+        failures++;
+    }
+}
+
+static void Fill(bool ones)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof (data); i++)
+        data[i] = ones ? 0xFFu : (uint8_t) rand();
+}
+
+static void TestAdd(void)
+{
+    static const unsigned longer[] = {511, 536, 1024, 1460, 1500, 4097, MAX_DATA};
+    unsigned offset, count, i;
+    int ones;
+
+    for (ones = 0; ones < 2; ones++)
+    {
+        Fill(ones);
+        for (offset = 0; offset < 8; offset++)
+        {
+            for (count = 0; count <= 300; count++)
+            {
+                Check(CalcIPChecksumAdd(0, data + offset, count) == ReferenceSum(0, data + offset, count),
+                        "CalcIPChecksumAdd()", offset, count);
+                Check(CalcIPChecksumAdd(0x8001u, data + offset, count) == ReferenceSum(0x8001u, data + offset, count),
+                        "CalcIPChecksumAdd() with a previous sum", offset, count);
+            }
+            for (i = 0; i < sizeof (longer) / sizeof (longer[0]); i++)
+                Check(CalcIPChecksumAdd(0, data + offset, longer[i]) == ReferenceSum(0, data + offset, longer[i]),
+                        "CalcIPChecksumAdd()", offset, longer[i]);
+        }
+    }
+}
+
+static void TestChaining(void)
+{
+    unsigned offset, count, split;
+    uint16_t first, second, full;
+
+    Fill(false);
+    for (offset = 0; offset < 4; offset++)
+    {
+        for (count = 0; count <= 100; count++)
+        {
+            full = ReferenceSum(0, data + offset, count);
+            for (split = 0; split <= count; split++)
+            {
+                first = CalcIPChecksumAdd(0, data + offset, split);
+                if (split & 1u)
+                {
+                    second = CalcIPChecksumAdd(0, data + offset + split, count - split);
+                    second = Fold((uint32_t) first + swaps(second));
+                }
+                else
+                {
+                    second = CalcIPChecksumAdd(first, data + offset + split, count - split);
+                }
+                Check(second == full, "sum in two parts", offset, split);
+            }
+        }
+    }
+}
+
+static void TestCopy(void)
+{
+    unsigned destOffset, sourceOffset, count;
+    uint16_t sum;
+
+    Fill(false);
+    for (destOffset = 0; destOffset < 4; destOffset++)
+    {
+        for (sourceOffset = 0; sourceOffset < 4; sourceOffset++)
+        {
+            for (count = 0; count <= 1500; count += (count < 100) ? 1u : 37u)
+            {
+                memset(copy, GUARD, sizeof (copy));
+                sum = CalcIPChecksumCopy(0x1234u, copy + 4 + destOffset, data + sourceOffset, count);
+                Check(sum == ReferenceSum(0x1234u, data + sourceOffset, count), "CalcIPChecksumCopy() sum",
+                        destOffset * 4u + sourceOffset, count);
+                Check(memcmp(copy + 4 + destOffset, data + sourceOffset, count) == 0 &&
+                        copy[3 + destOffset] == GUARD && copy[4 + destOffset + count] == GUARD,
+                        "CalcIPChecksumCopy() copy", destOffset * 4u + sourceOffset, count);
+            }
+        }
+    }
+}
+
+static void TestUpdate(void)
+{
+    uint16_t words[32], checksum, word;
+    int n, i;
+
+    // RFC 1624, section 4: eq. 2 would give 0xFFFF
+    Check(CalcIPChecksumUpdate(0xDD2Fu, 0x5555u, 0x3285u) == 0x0000u, "RFC 1624 example", 0, 2);
+
+    // ~HC + ~m + m' = 0x1FFFF needs a second end-around carry
+    Check(CalcIPChecksumUpdate(0x0000u, 0x0000u, 0x0001u) == 0xFFFEu, "second carry", 0, 2);
+
+    // The first word stays non-zero, so that the data never sums to 0
+    for (i = 0; i < 32; i++)
+        words[i] = (uint16_t) rand();
+    words[0] |= 1u;
+    checksum = CalcIPChecksum((uint8_t *) words, sizeof (words));
+    for (n = 0; n < 100000; n++)
+    {
+        i = 1 + rand() % 31;
+        word = (n & 1) ? (uint16_t) rand() : (uint16_t) (0xFFFFu * (rand() & 1));
+        checksum = CalcIPChecksumUpdate(checksum, words[i], word);
+        words[i] = word;
+        if (checksum != CalcIPChecksum((uint8_t *) words, sizeof (words)))
+        {
+            Check(false, "CalcIPChecksumUpdate()", i * 2, sizeof (words));
+            return;
+        }
+    }
+}
+
+/****************************************************************************
+  Timing
+ ***************************************************************************/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT      "cycle"
+#define Now()           ((double) __rdtsc())
+#else
+#define BENCH_UNIT      "ns"
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+#endif
+
+static void Bench(int iterations)
+{
+    static const unsigned sizes[] = {64, 536, 1460, MAX_DATA};
+    volatile uint16_t sink = 0;
+    double start, sum, copied;
+    unsigned i;
+    int n;
+
+    Fill(false);
+    for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    {
+        int count = iterations * (int) (MAX_DATA / sizes[i]);
+
+        start = Now();
+        for (n = 0; n < count; n++)
+            sink += CalcIPChecksumAdd(0, data, sizes[i]);
+        sum = (double) sizes[i] * count / (Now() - start);
+
+        start = Now();
+        for (n = 0; n < count; n++)
+            sink += CalcIPChecksumCopy(0, copy, data, sizes[i]);
+        copied = (double) sizes[i] * count / (Now() - start);
+
+        printf("checksum_test: %5u bytes: sum %.2f, copy and sum %.2f bytes/" BENCH_UNIT "\n", sizes[i], sum, copied);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 0;
+
+    srand(1);
+    TestAdd();
+    TestChaining();
+    TestCopy();
+    TestUpdate();
+    if (iterations > 0)
+        Bench(iterations);
+
+    printf("checksum_test: %s: %s\n", CHECKSUM_PATH,
+            failures ? "FAILED" : "alignments, chaining, copy and RFC 1624 update passed");
+    return failures ? 1 : 0;
+}
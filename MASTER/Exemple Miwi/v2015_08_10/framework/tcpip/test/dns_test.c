@@ -0,0 +1,451 @@
+/*******************************************************************************
+  DNS client tests and timing
+
+  Summary:
+    Runs dns_client.c on a Linux host against canned server responses.
+
+  Description:
+    The UDP, ARP and tick functions are replaced by stubs: the queries that
+    the client sends are captured, the responses are built from them, and
+    the clock only moves when the test says so.
+    - A record: the query format, the answer, then a cache hit for the
+      same name in other case, and a new query once the TTL is over.
+    - NXDOMAIN with an SOA record: cached for the SOA MINIMUM, and for
+      DNS_NEGATIVE_TTL at most.
+    - SERVFAIL, then timeouts: the query goes to the secondary server
+      (DNSFailover), until DNS_RES_SERVER_ERROR after DNS_MAX_ATTEMPTS.
+    - Responses with an unknown transaction ID or from another host are
+      ignored.
+    - The least recently used cache entry is the one replaced.
+
+    With an iteration count, the test then times the lookups answered from
+    the cache and the ones answered by the canned server.
+
+      dns_test [iterations]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#define PRIMARY_DNS     (0x0101A8C0ul)  // 192.168.1.1
+#define SECONDARY_DNS   (0x0201A8C0ul)  // 192.168.1.2
+#define OTHER_HOST      (0x0301A8C0ul)
+
+APP_CONFIG AppConfig;
+UDP_SOCKET activeUDPSocket;
+UDP_SOCKET_INFO UDPSocketInfo[MAX_UDP_SOCKETS];
+
+static uint32_t ticks;
+static bool socketOpen;
+static uint8_t tx[512], query[512], response[512];
+static uint16_t txLen, queryLen, responseLen, responsePos;
+static uint32_t queryServer;
+static unsigned int queriesSent, arpRequests;
+static int failures;
+
+/****************************************************************************
+  Stubs of the tick, ARP and UDP modules
+ ***************************************************************************/
+
+uint32_t TickGet(void)
+{
+    return ticks;
+}
+
+uint32_t TickGetDiv256(void)
+{
+    return ticks >> 8;
+}
+
+void ARPResolve(IP_ADDR *IPAddr)
+{
+    arpRequests++;
+}
+
+bool ARPIsResolved(IP_ADDR *IPAddr, MAC_ADDR *MACAddr)
+{
+    memset(MACAddr->v, 0x02, sizeof (MACAddr->v));
+    return true;
+}
+
+UDP_SOCKET UDPOpenEx(uint32_t remoteHost, uint8_t remoteHostType, UDP_PORT localPort, UDP_PORT remotePort)
+{
+    socketOpen = true;
+    return 0;
+}
+
+void UDPClose(UDP_SOCKET s)
+{
+    socketOpen = false;
+}
+
+uint16_t UDPIsPutReady(UDP_SOCKET s)
+{
+    activeUDPSocket = s;
+    txLen = 0;
+    return sizeof (tx);
+}
+
+bool UDPPut(uint8_t v)
+{
+    tx[txLen++] = v;
+    return true;
+}
+
+uint16_t UDPPutArray(uint8_t *cData, uint16_t wDataLen)
+{
+    memcpy(&tx[txLen], cData, wDataLen);
+    txLen += wDataLen;
+    return wDataLen;
+}
+
+void UDPFlush(void)
+{
+    memcpy(query, tx, txLen);
+    queryLen = txLen;
+    queryServer = UDPSocketInfo[activeUDPSocket].remote.remoteNode.IPAddr.Val;
+    queriesSent++;
+}
+
+uint16_t UDPIsGetReady(UDP_SOCKET s)
+{
+    activeUDPSocket = s;
+    return responseLen - responsePos;
+}
+
+bool UDPGet(uint8_t *v)
+{
+    if (responsePos >= responseLen)
+        return false;
+    *v = response[responsePos++];
+    return true;
+}
+
+uint16_t UDPGetArray(uint8_t *cData, uint16_t wDataLen)
+{
+    if (wDataLen > responseLen - responsePos)
+        wDataLen = responseLen - responsePos;
+    if (cData != NULL)
+        memcpy(cData, &response[responsePos], wDataLen);
+    responsePos += wDataLen;
+    return wDataLen;
+}
+
+void UDPDiscard(void)
+{
+    responseLen = responsePos = 0;
+}
+
+/****************************************************************************
+  Canned server
+ ***************************************************************************/
+
+// Starts a response to the last query: its header and question
+static void Respond(uint32_t source, uint8_t rcode)
+{
+    memcpy(response, query, queryLen);
+    responseLen = queryLen;
+    responsePos = 0;
+    response[2] = 0x81;     // Response, recursion desired
+    response[3] = 0x80 | rcode;
+    UDPSocketInfo[0].remote.remoteNode.IPAddr.Val = source;
+}
+
+// Appends a record named by a pointer to the question, countOffset is 6
+// for the answer section and 8 for the authority section
+static void AddRecord(uint8_t countOffset, uint16_t type, uint32_t ttl, const uint8_t *data, uint16_t len)
+{
+    uint8_t *p = &response[responseLen];
+
+    response[countOffset + 1]++;
+    p[0] = 0xC0;
+    p[1] = 12;
+    p[2] = type >> 8;
+    p[3] = type;
+    p[4] = 0x00;
+    p[5] = 0x01;
+    p[6] = ttl >> 24;
+    p[7] = ttl >> 16;
+    p[8] = ttl >> 8;
+    p[9] = ttl;
+    p[10] = len >> 8;
+    p[11] = len;
+    memcpy(&p[12], data, len);
+    responseLen += 12 + len;
+}
+
+static void AddA(uint32_t ttl, uint32_t address)
+{
+    AddRecord(6, DNS_TYPE_A, ttl, (const uint8_t *) &address, 4);
+}
+
+static void AddSOA(uint32_t ttl, uint32_t minimum)
+{
+    // MNAME and RNAME at the root, then serial, refresh, retry, expire
+    uint8_t soa[22] = {0};
+
+    soa[18] = minimum >> 24;
+    soa[19] = minimum >> 16;
+    soa[20] = minimum >> 8;
+    soa[21] = minimum;
+    AddRecord(8, 6, ttl, soa, sizeof (soa));
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("dns_test: FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void Advance(uint32_t seconds)
+{
+    ticks += seconds * TICK_SECOND;
+}
+
+// Runs the client until it has nothing more to do
+static DNS_RESULT Result(DNS_HANDLE h, IP_ADDR *ip)
+{
+    DNS_RESULT r;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        r = DNSQueryResult(h, ip);
+    return r;
+}
+
+// Starts a query and runs it until it is sent or answered from the cache
+static DNS_HANDLE Query(const char *name, unsigned int *sent)
+{
+    unsigned int before = queriesSent;
+    IP_ADDR ip;
+    DNS_HANDLE h;
+
+    h = DNSQuery((uint8_t *) name, DNS_TYPE_A);
+    Result(h, &ip);
+    *sent = queriesSent - before;
+    return h;
+}
+
+// Resolves a name through the canned server, which answers with address
+static void Resolve(const char *name, uint32_t address, uint32_t ttl)
+{
+    unsigned int sent;
+    IP_ADDR ip;
+    DNS_HANDLE h;
+
+    h = Query(name, &sent);
+    if (sent)
+    {
+        Respond(queryServer, 0);
+        AddA(ttl, address);
+    }
+    Check(Result(h, &ip) == DNS_RES_OK && ip.Val == address, name);
+    DNSQueryRelease(h);
+}
+
+static void Reset(void)
+{
+    DNSInit();
+    DNSFlushCache();
+    AppConfig.PrimaryDNSServer.Val = PRIMARY_DNS;
+    AppConfig.SecondaryDNSServer.Val = SECONDARY_DNS;
+    UDPDiscard();
+}
+
+static void TestAnswer(void)
+{
+    static const uint8_t question[] = "\x03www\x07""Example\x03""com\x00\x00\x01\x00\x01";
+    unsigned int sent;
+    DNS_STATS stats;
+    IP_ADDR ip;
+    DNS_HANDLE h;
+
+    Reset();
+    h = Query("www.Example.com", &sent);
+    Check(sent == 1 && queryServer == PRIMARY_DNS, "A: no query sent to the primary server");
+    Check(queryLen == 12 + sizeof (question) - 1 && query[2] == 0x01 && query[5] == 1 &&
+            memcmp(&query[12], question, sizeof (question) - 1) == 0, "A: malformed query");
+    Check(Result(h, &ip) == DNS_RES_PENDING, "A: query done without response");
+
+    Respond(PRIMARY_DNS, 0);
+    AddA(300, 0x0D0C0B0Aul);
+    Check(Result(h, &ip) == DNS_RES_OK && ip.Val == 0x0D0C0B0Aul, "A: answer not read");
+    DNSQueryRelease(h);
+    Check(!socketOpen, "A: socket still open without query in flight");
+
+    Advance(299);
+    h = Query("WWW.example.COM", &sent);
+    Check(sent == 0 && Result(h, &ip) == DNS_RES_OK && ip.Val == 0x0D0C0B0Aul, "A: no cache hit before the TTL");
+    DNSQueryRelease(h);
+
+    Advance(2);
+    h = Query("www.example.com", &sent);
+    Check(sent == 1, "A: cache entry used after its TTL");
+    DNSQueryRelease(h);
+
+    DNSGetStats(&stats);
+    Check(stats.CacheHits >= 1, "A: cache hit not counted");
+}
+
+static void TestNegative(uint32_t minimum, uint32_t expected)
+{
+    unsigned int sent;
+    IP_ADDR ip;
+    DNS_HANDLE h;
+
+    Reset();
+    h = Query("nx.example.com", &sent);
+    Respond(PRIMARY_DNS, 3);
+    AddSOA(3600, minimum);
+    Check(Result(h, &ip) == DNS_RES_NAME_ERROR && ip.Val == 0u, "NXDOMAIN: not a name error");
+    DNSQueryRelease(h);
+
+    Advance(expected - 1);
+    h = Query("nx.example.com", &sent);
+    Check(sent == 0 && Result(h, &ip) == DNS_RES_NAME_ERROR, "NXDOMAIN: not cached for the negative TTL");
+    DNSQueryRelease(h);
+
+    Advance(2);
+    h = Query("nx.example.com", &sent);
+    Check(sent == 1, "NXDOMAIN: cached beyond the negative TTL");
+    DNSQueryRelease(h);
+}
+
+static void TestFailover(void)
+{
+    unsigned int sent, arp;
+    DNS_STATS before, after;
+    IP_ADDR ip;
+    DNS_HANDLE h;
+    int i;
+
+    Reset();
+    DNSGetStats(&before);
+    h = Query("fail.example.com", &sent);
+
+    // SERVFAIL: the same query goes to the other server at once
+    arp = arpRequests;
+    Respond(PRIMARY_DNS, 2);
+    Result(h, &ip);
+    Check(queryServer == SECONDARY_DNS && AppConfig.PrimaryDNSServer.Val == SECONDARY_DNS &&
+            arpRequests == arp + 1, "SERVFAIL: no failover to the secondary server");
+
+    // Responses from another host or with an unknown ID are ignored
+    Respond(OTHER_HOST, 0);
+    AddA(60, 0x01010101ul);
+    Check(Result(h, &ip) == DNS_RES_PENDING, "response of another host accepted");
+    Respond(queryServer, 0);
+    response[0] ^= 0xFF;
+    AddA(60, 0x01010101ul);
+    Check(Result(h, &ip) == DNS_RES_PENDING, "response with another transaction ID accepted");
+
+    // Timeouts: alternate between the servers until DNS_MAX_ATTEMPTS
+    for (i = 2; i < DNS_MAX_ATTEMPTS; i++)
+    {
+        Advance(2);
+        Result(h, &ip);
+        Check(queryServer == ((i & 1) ? SECONDARY_DNS : PRIMARY_DNS), "timeout: query not sent to the other server");
+    }
+    Advance(2);
+    Check(Result(h, &ip) == DNS_RES_SERVER_ERROR, "timeout: no server error after DNS_MAX_ATTEMPTS");
+    DNSQueryRelease(h);
+
+    DNSGetStats(&after);
+    Check(after.QueriesSent - before.QueriesSent == DNS_MAX_ATTEMPTS &&
+            after.Retransmits - before.Retransmits == DNS_MAX_ATTEMPTS - 1u &&
+            after.Failovers - before.Failovers == DNS_MAX_ATTEMPTS - 1u &&
+            after.Failures - before.Failures == 1u, "failover counters");
+
+    // The query after the error starts with the last server that was tried
+    h = Query("ok.example.com", &sent);
+    Check(sent == 1 && queryServer == AppConfig.PrimaryDNSServer.Val, "query after failover");
+    DNSQueryRelease(h);
+}
+
+static void TestLRU(void)
+{
+    char name[DNS_CACHE_ENTRIES + 1][16];
+    unsigned int sent;
+    DNS_HANDLE h;
+    int i;
+
+    Reset();
+    for (i = 0; i <= DNS_CACHE_ENTRIES; i++)
+        sprintf(name[i], "host%d.lan", i);
+
+    for (i = 0; i < DNS_CACHE_ENTRIES; i++)
+        Resolve(name[i], 0x0A000001ul + i, 600);
+    // Every entry but the second one is used again
+    for (i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if (i != 1)
+            Resolve(name[i], 0x0A000001ul + i, 600);
+    }
+    Resolve(name[DNS_CACHE_ENTRIES], 0x0A0000FFul, 600);
+
+    for (i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        h = Query(name[i], &sent);
+        Check(sent == (i == 1), "LRU: not the least recently used entry replaced");
+        DNSQueryRelease(h);
+    }
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void Bench(int iterations)
+{
+    double start, cached, network;
+    int i;
+
+    Reset();
+    Resolve("www.example.com", 0x0D0C0B0Aul, 3600);
+    start = Now();
+    for (i = 0; i < iterations; i++)
+        Resolve("www.example.com", 0x0D0C0B0Aul, 3600);
+    cached = Now() - start;
+
+    start = Now();
+    for (i = 0; i < iterations; i++)
+    {
+        DNSFlushCache();
+        Resolve("www.example.com", 0x0D0C0B0Aul, 3600);
+    }
+    network = Now() - start;
+
+    printf("dns_test: %.0f lookups/s from the cache, %.0f lookups/s through the canned server\n",
+            iterations / cached, iterations / network);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 0;
+
+    TestAnswer();
+    TestNegative(30, 30);
+    TestNegative(600, DNS_NEGATIVE_TTL);
+    TestFailover();
+    TestLRU();
+    if (iterations > 0)
+        Bench(iterations);
+
+    printf("dns_test: %s\n", failures ? "FAILED" : "A record, TTL, NXDOMAIN with SOA, SERVFAIL failover and LRU passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************
+  Stand-in for tcpip.h in mpfs_upload_test
+
+  Summary:
+    Builds mpfs2.c and spi_flash.c for the PIC32 on a host, with the SPI
+    registers of the SPI Flash served by the SST25 emulation of the test.
+
+  Description:
+    Each access to SPIFLASH_SSPBUF, SPIFLASH_SPISTATbits and SPIFLASH_CS_IO
+    goes through a function of mpfs_upload_test.c, which clocks the byte
+    written through the emulated part.  The Makefile puts this directory
+    first on the include path of mpfs_upload_test only.
+ *******************************************************************************/
+
+#ifndef __TCPIP_H_
+#define __TCPIP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define __XC32
+
+#define ROM                 const
+#define memcmppgm2ram(a, b, c)  memcmp(a, b, c)
+#define mMIN(a, b)          (((a) < (b)) ? (a) : (b))
+
+#define STACK_USE_MPFS2
+#define MPFS_USE_SPI_FLASH
+#define MPFS_RESERVE_BLOCK  (4096ul)
+#define MAX_MPFS_HANDLES    (7)
+
+#define SYS_CLK_FrequencyPeripheralGet()    (80000000ul)
+
+// SPI2 of the PIC32, emulated
+typedef struct
+{
+    unsigned ON;
+    unsigned SPITBE;
+    unsigned SPIRBF;
+} SPI_BITS;
+
+extern uint32_t spiCon, spiBrg;
+extern SPI_BITS spiConBits;
+extern uint8_t spiTris;
+uint8_t *SPIBuffer(void);
+SPI_BITS *SPIStatus(void);
+uint8_t *SPIChipSelect(void);
+
+#define _SPI2CON_ON_MASK    (0x8000)
+#define _SPI2CON_CKE_MASK   (0x0100)
+#define _SPI2CON_MSTEN_MASK (0x0020)
+
+#define SPIFLASH_CS_TRIS        spiTris
+#define SPIFLASH_SCK_TRIS       spiTris
+#define SPIFLASH_SDI_TRIS       spiTris
+#define SPIFLASH_SDO_TRIS       spiTris
+#define SPIFLASH_CS_IO          (*SPIChipSelect())
+#define SPIFLASH_SSPBUF         (*SPIBuffer())
+#define SPIFLASH_SPISTATbits    (*SPIStatus())
+#define SPIFLASH_SPICON1        spiCon
+#define SPIFLASH_SPICON1bits    spiConBits
+#define SPIFLASH_SPIBRG         spiBrg
+
+#include "tcpip/src/common/spi_flash.h"
+#include "tcpip/src/common/mpfs2.h"
+
+#endif
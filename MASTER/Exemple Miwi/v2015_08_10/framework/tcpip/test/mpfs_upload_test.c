@@ -0,0 +1,472 @@
+/*******************************************************************************
+  MPFS image upload test on an emulated SST25 SPI Flash
+
+  Summary:
+    Writes MPFS images with mpfs2.c and spi_flash.c on a Linux host, through
+    an emulation of the SPI protocol of the SST25 parts.
+
+  Description:
+    mpfs2.c and spi_flash.c are built for the PIC32 as they are, with
+    mpfs/tcpip/tcpip.h for the stack.  The SPI registers are served by
+    SPIBuffer(), SPIStatus() and SPIChipSelect(), which clock each byte
+    through the part in virtual time: 0.5 us per byte (16 MHz SCK), 18 ms
+    per sector or block erase, 7 us per AAI word and 1.5 ms per page
+    program.  The emulation counts the commands that the part would ignore:
+    an erase, a program or a read while busy, or an erase or a program
+    without WREN.
+    - SST25VF016B (AAI word programming) and SST25VF064C (page program, no
+      AAI mode): an image put in chunks of 1 to 700 bytes, with
+      MPFSPutEnd() called at random like the FTP server does, which
+      flushes the buffers at unaligned addresses.
+    - A program dropped by the part: MPFSPutEnd() sees the CRC mismatch,
+      returns false and erases the image header.
+    - The upload of a 512 KB image by HTTPMPFSUpload(), whose HTTP_MPFS_OK
+      state is copied here: a sender streams the image over a link of
+      10 Mbit/s or 1 Mbit/s with a 1 ms round trip, limited by the window
+      of the RX FIFO, and each pass of the stack takes PASS_US.  The upload
+      must end before the one that wrote through SPIFlashWriteArray(), on
+      the SST25VF016B with the same link and window.
+
+    Each run checks the image read back from the emulated part.  The test
+    prints the upload times:
+
+      mpfs_upload_test
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tcpip/tcpip.h"
+
+#define SST25VF016B     (0x41)
+#define SST25VF064C     (0x4b)
+
+#define FLASH_SIZE      (8ul << 20)
+#define SPI_BYTE_US     (0.5)
+#define ERASE_US        (18000.0)
+#define AAI_WORD_US     (7.0)
+#define PAGE_US         (1500.0)
+
+#define IMAGE_SIZE      (512ul * 1024ul)
+#define PUT_SIZE        (100000ul)
+#define MSS             (1460ul)
+#define RTT_US          (1000.0)
+#define PASS_US         (20.0)      // rest of the stack loop
+#define COPY_US         (0.1)       // TCPGetArray() and MPFSPutArray(), per byte
+#define CRC_US          (0.5)       // both CRC passes of mpfs2.c, per byte
+#define RING_SIZE       (65536u)
+
+#define NO_FAULT        (-1l)
+
+uint32_t spiCon, spiBrg;
+SPI_BITS spiConBits;
+uint8_t spiTris;
+
+static int failures;
+static uint8_t image[IMAGE_SIZE];
+
+// Emulated part
+static double now;                  // virtual time, us
+static uint8_t deviceId;
+static uint8_t memory[FLASH_SIZE];
+static uint8_t spiData;
+static uint8_t chipSelect = 1, chipSelectSeen = 1;
+static uint8_t exchange;            // 1 once SPIFLASH_SSPBUF is written, 2 once the byte is clocked
+static SPI_BITS status = {1, 1, 1};
+static double busyUntil;
+static bool writeEnabled, aaiMode;
+static uint8_t command[4 + SPI_FLASH_PROGRAM_PAGE];
+static int commandLength;
+static uint32_t aaiAddress;
+static long violations, programs;
+static long droppedProgram = NO_FAULT;
+
+/****************************************************************************
+  SST25 emulation
+ ***************************************************************************/
+
+static bool Busy(void)
+{
+    return now < busyUntil;
+}
+
+static uint32_t Address(void)
+{
+    return (uint32_t) command[1] << 16 | (uint32_t) command[2] << 8 | command[3];
+}
+
+static void Program(uint32_t address, uint8_t data)
+{
+    if (programs != droppedProgram)
+        memory[address & (FLASH_SIZE - 1ul)] &= data;
+}
+
+// Runs the command clocked in while the chip was selected
+static void EndCommand(void)
+{
+    uint32_t address, size;
+    int i, n, first;
+
+    if (commandLength == 0)
+        return;
+
+    switch (command[0])
+    {
+    case 0x06:  // WREN
+        writeEnabled = true;
+        break;
+
+    case 0x04:  // WRDI, also ends AAI mode
+        writeEnabled = false;
+        aaiMode = false;
+        break;
+
+    case 0x20:  // 4 KB sector erase
+    case 0x52:  // 32 KB block erase
+        size = (command[0] == 0x20) ? 4096ul : 32768ul;
+        if (Busy() || !writeEnabled)
+        {
+            violations++;
+            break;
+        }
+        address = Address() & ~(size - 1ul);
+        memset(&memory[address], 0xff, size);
+        busyUntil = now + ERASE_US;
+        writeEnabled = false;
+        break;
+
+    case 0x02:  // page program, wraps in the page
+        if (Busy() || !writeEnabled)
+        {
+            violations++;
+            break;
+        }
+        address = Address();
+        for (i = 4; i < commandLength; i++)
+            Program((address & ~0xfful) | ((address + i - 4) & 0xfful), command[i]);
+        busyUntil = now + PAGE_US;
+        writeEnabled = false;
+        programs++;
+        break;
+
+    case 0xad:  // AAI word
+    case 0xaf:  // AAI byte
+        n = (command[0] == 0xad) ? 2 : 1;
+        if (Busy())
+        {
+            violations++;
+            break;
+        }
+        if (!aaiMode)
+        {
+            if (!writeEnabled || commandLength != 4 + n)
+            {
+                violations++;
+                break;
+            }
+            aaiAddress = Address();
+            aaiMode = true;
+            first = 4;
+        }
+        else
+        {
+            if (commandLength != 1 + n)
+            {
+                violations++;
+                break;
+            }
+            first = 1;
+        }
+        for (i = 0; i < n; i++)
+            Program(aaiAddress++, command[first + i]);
+        busyUntil = now + AAI_WORD_US;
+        programs++;
+        break;
+
+    default:
+        break;
+    }
+    commandLength = 0;
+}
+
+static void SyncChipSelect(void)
+{
+    if (chipSelect == chipSelectSeen)
+        return;
+    if (chipSelect)
+        EndCommand();
+    else
+        commandLength = 0;
+    chipSelectSeen = chipSelect;
+}
+
+uint8_t *SPIChipSelect(void)
+{
+    SyncChipSelect();
+    return &chipSelect;
+}
+
+// spi_flash.c writes a byte to send, then reads the byte received
+uint8_t *SPIBuffer(void)
+{
+    exchange = (exchange == 0u) ? 1 : 0;
+    return &spiData;
+}
+
+// Clocks the byte written on the first poll of the status
+SPI_BITS *SPIStatus(void)
+{
+    uint8_t in, out = 0xff;
+
+    SyncChipSelect();
+    if (exchange != 1u)
+        return &status;
+    exchange = 2;
+    in = spiData;
+    now += SPI_BYTE_US;
+    spiData = 0xff;
+    if (chipSelect)
+        return &status;
+
+    if (commandLength < (int) sizeof (command))
+        command[commandLength] = in;
+    commandLength++;
+    switch (command[0])
+    {
+    case 0x05:  // RDSR
+        if (commandLength > 1)
+            out = (Busy() ? 0x01 : 0) | (writeEnabled ? 0x02 : 0) | (aaiMode ? 0x40 : 0);
+        break;
+
+    case 0x03:  // READ
+        if (commandLength > 4)
+        {
+            if (Busy())
+                violations++;
+            out = memory[(Address() + commandLength - 5) & (FLASH_SIZE - 1ul)];
+        }
+        break;
+
+    case 0x90:  // RDID
+        if (commandLength == 6)
+            out = deviceId;
+        break;
+    }
+    spiData = out;
+    return &status;
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what, uint8_t id)
+{
+    if (!ok)
+    {
+        printf("mpfs_upload_test: FAILED: %s, device %#x\n", what, id);
+        failures++;
+    }
+}
+
+static uint32_t Random(uint32_t *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16;
+}
+
+static void MakeImage(uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < IMAGE_SIZE; i++)
+        image[i] = (uint8_t) Random(&seed);
+    memcpy(image, "MPFS\x02\x01", 6);
+}
+
+// Powers the part up on memory that was not erased
+static void Start(uint8_t id)
+{
+    deviceId = id;
+    busyUntil = 0;
+    writeEnabled = false;
+    aaiMode = false;
+    violations = 0;
+    droppedProgram = NO_FAULT;
+    memset(memory, 0x5a, sizeof (memory));
+    MPFSInit();
+}
+
+static void TestPut(uint8_t id)
+{
+    uint32_t seed = 7, position, n;
+    MPFS_HANDLE file;
+    bool ok = true;
+
+    Start(id);
+    MakeImage(1);
+    file = MPFSFormat();
+    for (position = 0; position < PUT_SIZE; position += n)
+    {
+        n = 1u + Random(&seed) % 700u;
+        if (n > PUT_SIZE - position)
+            n = PUT_SIZE - position;
+        Check(MPFSPutArray(file, &image[position], (uint16_t) n) == n, "short put", id);
+        if (Random(&seed) % 5u == 0u)
+            ok &= MPFSPutEnd(true);
+    }
+    ok &= MPFSPutEnd(true);
+
+    Check(ok, "put: MPFSPutEnd() failed", id);
+    Check(memcmp(&memory[MPFS_RESERVE_BLOCK], image, PUT_SIZE) == 0, "put: image differs", id);
+    Check(violations == 0, "put: SPI Flash command ignored", id);
+}
+
+static void TestDroppedProgram(uint8_t id)
+{
+    MPFS_HANDLE file;
+
+    Start(id);
+    MakeImage(2);
+    file = MPFSFormat();
+    droppedProgram = programs + 100;
+    MPFSPutArray(file, image, PUT_SIZE / 2u);
+
+    Check(!MPFSPutEnd(true), "dropped program: MPFSPutEnd() passed", id);
+    Check(memory[MPFS_RESERVE_BLOCK] == 0xffu, "dropped program: header kept", id);
+}
+
+// HTTP_MPFS_OK state of HTTPMPFSUpload(), true once the image is written
+static bool Upload(MPFS_HANDLE file, uint32_t *received, uint32_t *taken, uint32_t *byteCount, bool *written)
+{
+    uint8_t c[16];
+    uint32_t lenA;
+    uint16_t lenB;
+
+    lenA = *received - *taken;
+    if (lenA > *byteCount)
+        lenA = *byteCount;
+
+    lenB = MPFSIsPutReady(file);
+    while (lenA > 0u)
+    {
+        if (lenB == 0u)
+            return false;
+
+        lenB = (uint16_t) mMIN(mMIN(lenA, 16u), lenB);
+        memcpy(c, &image[*taken], lenB);
+        *taken += lenB;
+        now += lenB * (COPY_US + CRC_US);
+        *byteCount -= lenB;
+        lenA -= lenB;
+        MPFSPutArray(file, c, lenB);
+        lenB = MPFSIsPutReady(file);
+    }
+
+    if (*byteCount != 0u)
+        return false;
+    *written = MPFSPutEnd(true);
+    return true;
+}
+
+// Uploads IMAGE_SIZE bytes over a link of linkUs per byte, returns the time
+static double TestUpload(uint8_t id, uint32_t window, double linkUs, double maxSeconds)
+{
+    // Segments in flight, and window updates in flight
+    static struct
+    {
+        double t;
+        uint32_t end;
+    } segments[RING_SIZE], acks[RING_SIZE];
+    uint32_t segmentHead = 0, segmentTail = 0, ackHead = 0, ackTail = 0;
+    uint32_t sent, edge, advertised, received, taken, byteCount, n;
+    double linkFree = 0, start;
+    MPFS_HANDLE file;
+    bool written = false;
+
+    Start(id);
+    MakeImage(3);
+    start = now;
+
+    // The header is checked before HTTP_MPFS_OK
+    file = MPFSFormat();
+    MPFSPutArray(file, image, 6);
+    sent = received = taken = 6;
+    edge = advertised = taken + window;
+    byteCount = IMAGE_SIZE - 6u;
+
+    while (now - start < 60e6)
+    {
+        // Sender
+        for (; ackHead != ackTail && acks[ackHead].t <= now; ackHead = (ackHead + 1u) % RING_SIZE)
+        {
+            if (acks[ackHead].end > edge)
+                edge = acks[ackHead].end;
+        }
+        while (sent < IMAGE_SIZE && sent < edge)
+        {
+            n = mMIN(mMIN(edge - sent, MSS), IMAGE_SIZE - sent);
+            linkFree = ((linkFree > now) ? linkFree : now) + n * linkUs;
+            sent += n;
+            segments[segmentTail].t = linkFree + RTT_US / 2;
+            segments[segmentTail].end = sent;
+            segmentTail = (segmentTail + 1u) % RING_SIZE;
+        }
+
+        // Stack: segments in, window updates out
+        for (; segmentHead != segmentTail && segments[segmentHead].t <= now; segmentHead = (segmentHead + 1u) % RING_SIZE)
+            received = segments[segmentHead].end;
+        if (taken + window != advertised)
+        {
+            advertised = taken + window;
+            acks[ackTail].t = now + RTT_US / 2;
+            acks[ackTail].end = advertised;
+            ackTail = (ackTail + 1u) % RING_SIZE;
+        }
+        now += PASS_US;
+
+        if (Upload(file, &received, &taken, &byteCount, &written))
+            break;
+    }
+
+    Check(byteCount == 0u, "upload: timed out", id);
+    Check(written, "upload: MPFSPutEnd() failed", id);
+    Check(memcmp(&memory[MPFS_RESERVE_BLOCK], image, IMAGE_SIZE) == 0, "upload: image differs", id);
+    Check(violations == 0, "upload: SPI Flash command ignored", id);
+    Check((now - start) / 1e6 < maxSeconds, "upload: too slow", id);
+    return (now - start) / 1e6;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        uint8_t id;
+        const char *name;
+        uint32_t window;
+        double linkUs;
+        const char *link;
+        double maxSeconds;      // synchronous writes, SST25VF016B
+    } uploads[] = {
+        {SST25VF016B, "SST25VF016B", 2048, 0.8, "10 Mbit/s", 5.14},
+        {SST25VF016B, "SST25VF016B", 8192, 0.8, "10 Mbit/s", 4.81},
+        {SST25VF016B, "SST25VF016B", 2048, 8.0, "1 Mbit/s", 7.83},
+        {SST25VF064C, "SST25VF064C", 2048, 0.8, "10 Mbit/s", 5.14},
+    };
+    size_t i;
+
+    TestPut(SST25VF016B);
+    TestPut(SST25VF064C);
+    TestDroppedProgram(SST25VF016B);
+    TestDroppedProgram(SST25VF064C);
+
+    for (i = 0; i < sizeof (uploads) / sizeof (uploads[0]); i++)
+    {
+        printf("mpfs_upload_test: %s, %s, %lu byte window: 512 KB image in %.2f s\n", uploads[i].name,
+                uploads[i].link, (unsigned long) uploads[i].window,
+                TestUpload(uploads[i].id, uploads[i].window, uploads[i].linkUs, uploads[i].maxSeconds));
+    }
+
+    printf("mpfs_upload_test: %s\n", failures ? "FAILED" : "puts, CRC check and uploads on SST25VF016B and SST25VF064C passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/*******************************************************************************
+  SHA-1, HMAC-SHA1 and PBKDF2 tests of the MRF24W driver
+
+  Summary:
+    Runs the hash functions of drv_wifi_pbkdf2.c on a Linux host against
+    published vectors.
+
+  Description:
+    drv_wifi_pbkdf2.c is included, so that the test builds it without the
+    configuration of a WiFi demo, which the driver headers need: the test
+    stands in for tcpip.h and drv_wifi_mac.h with the types and the
+    SHA1_MAC_LEN that the file uses, and enables it for the PIC32 like
+    WF_CS_TRIS and __XC32 do.
+    - sha1_vector(): the FIPS 180-1 messages, the million 'a' in 1000 byte
+      parts so that SHA1Update() carries partial blocks over.
+    - hmac_sha1(): the 7 SHA-1 cases of RFC 2202, with keys longer than a
+      block and data longer than a block.
+    - pbkdf2_sha1(): the WPA passphrase to PSK examples of IEEE 802.11i
+      H.4, and the cases of RFC 6070 that fit its parameters: 1 iteration,
+      which never reaches SHA1TransformWords(), 2 and 4096 iterations, and
+      an output longer than one digest.
+
+    With an iteration count, it then times the derivation of a 32 byte PSK
+    in 4096 iterations, which WF_ConvPassphraseToKey() runs:
+
+      pbkdf2_test [iterations]
+ *******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define __TCPIP_H_
+#define __DRV_WF_MAC_H_
+#define WF_CS_TRIS
+#define __XC32
+#define SHA1_MAC_LEN    (20)
+
+#include "../../driver/wifi/mrf24w/src/drv_wifi_pbkdf2.c"
+
+static int failures;
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(const uint8_t *result, const char *expected, const char *what, int n)
+{
+    char hex[2 * 64 + 1];
+    size_t i;
+
+    for (i = 0; i < strlen(expected) / 2u; i++)
+        sprintf(hex + 2 * i, "%02x", result[i]);
+    if (strcmp(hex, expected) != 0)
+    {
+        printf("pbkdf2_test: FAILED: %s %d: %s, expected %s\n", what, n, hex, expected);
+        failures++;
+    }
+}
+
+static void TestSHA1(void)
+{
+    static const char *messages[] = {
+        "abc",
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+    };
+    static const char *digests[] = {
+        "a9993e364706816aba3e25717850c26c9cd0d89d",
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+    };
+    static u8 a[1000];
+    const u8 *parts[1000];
+    size_t lengths[1000];
+    u8 digest[SHA1_MAC_LEN];
+    size_t i;
+
+    for (i = 0; i < 2; i++)
+    {
+        parts[0] = (const u8 *) messages[i];
+        lengths[0] = strlen(messages[i]);
+        sha1_vector(1, parts, lengths, digest);
+        Check(digest, digests[i], "SHA-1 FIPS 180-1", (int) i + 1);
+    }
+
+    memset(a, 'a', sizeof (a));
+    for (i = 0; i < 1000; i++)
+    {
+        parts[i] = a;
+        lengths[i] = sizeof (a);
+    }
+    sha1_vector(1000, parts, lengths, digest);
+    Check(digest, "34aa973cd4c4daa4f61eeb2bdbad27316534016f", "SHA-1 FIPS 180-1", 3);
+}
+
+static void TestHMAC(void)
+{
+    static const struct
+    {
+        u8 key;
+        size_t keyLength;
+        u8 data;
+        size_t dataLength;
+        const char *text;
+        const char *mac;
+    } cases[] = {
+        {0x0b, 20, 0, 0, "Hi There", "b617318655057264e28bc0b6fb378c8ef146be00"},
+        {0, 0, 0, 0, "what do ya want for nothing?", "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79"},
+        {0xaa, 20, 0xdd, 50, NULL, "125d7342b9ac11cd91a39af48aa17b4f63f175d3"},
+        {0x01, 25, 0xcd, 50, NULL, "4c9007f4026250c6bc8414f9bf50c86c2d7235da"},
+        {0x0c, 20, 0, 0, "Test With Truncation", "4c1a03424b55e07fe7f27be1d58bb9324a9a5a04"},
+        {0xaa, 80, 0, 0, "Test Using Larger Than Block-Size Key - Hash Key First",
+            "aa4ae5e15272d00e95705637ce8a3b55ed402112"},
+        {0xaa, 80, 0, 0, "Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data",
+            "e8e99d0f45237d786d6bbaa7965c7808bbff1a91"},
+    };
+    u8 key[80], data[80], mac[SHA1_MAC_LEN];
+    size_t keyLength, dataLength, i, j;
+
+    for (i = 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+    {
+        // Case 2 has the key "Jefe", case 4 the bytes 0x01 to 0x19
+        keyLength = cases[i].keyLength;
+        for (j = 0; j < keyLength; j++)
+            key[j] = (cases[i].key == 0x01) ? (u8) (j + 1u) : cases[i].key;
+        if (keyLength == 0u)
+        {
+            keyLength = 4;
+            memcpy(key, "Jefe", keyLength);
+        }
+        dataLength = cases[i].text ? strlen(cases[i].text) : cases[i].dataLength;
+        if (cases[i].text)
+            memcpy(data, cases[i].text, dataLength);
+        else
+            memset(data, cases[i].data, dataLength);
+
+        hmac_sha1(key, keyLength, data, dataLength, mac);
+        Check(mac, cases[i].mac, "HMAC-SHA1 RFC 2202", (int) i + 1);
+    }
+}
+
+static void TestPBKDF2(void)
+{
+    static const struct
+    {
+        const char *passphrase;
+        const char *ssid;
+        U16 iterations;
+        U16 length;
+        const char *key;
+        const char *what;
+        int n;
+    } cases[] = {
+        {"password", "IEEE", 4096, 32,
+            "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e", "PSK IEEE 802.11i H.4", 1},
+        {"ThisIsAPassword", "ThisIsASSID", 4096, 32,
+            "0dc0d6eb90555ed6419756b9a15ec3e3209b63df707dd508d14581f8982721af", "PSK IEEE 802.11i H.4", 2},
+        {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", "ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ", 4096, 32,
+            "becb93866bb8c3832cb777c2f559807c8c59afcb6eae734885001300a981cc62", "PSK IEEE 802.11i H.4", 3},
+        {"password", "salt", 1, 20, "0c60c80f961f0e71f3a9b524af6012062fe037a6", "PBKDF2 RFC 6070", 1},
+        {"password", "salt", 2, 20, "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957", "PBKDF2 RFC 6070", 2},
+        {"password", "salt", 4096, 20, "4b007901b765489abead49d926f721d065a429c1", "PBKDF2 RFC 6070", 3},
+        {"passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25,
+            "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038", "PBKDF2 RFC 6070", 5},
+    };
+    U8 key[32];
+    size_t i;
+
+    for (i = 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+    {
+        pbkdf2_sha1(cases[i].passphrase, cases[i].ssid, (U16) strlen(cases[i].ssid), cases[i].iterations,
+                key, cases[i].length);
+        Check(key, cases[i].key, cases[i].what, cases[i].n);
+    }
+}
+
+/****************************************************************************
+  Timing
+ ***************************************************************************/
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Bench(int iterations)
+{
+    U8 key[32];
+    double start;
+    int n;
+
+    start = Now();
+    for (n = 0; n < iterations; n++)
+        pbkdf2_sha1("ThisIsAPassword", "ThisIsASSID", 11, 4096, key, sizeof (key));
+    printf("pbkdf2_test: %.1f ms per 32 byte PSK, 4096 iterations\n", (Now() - start) * 1e3 / iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 0;
+
+    TestSHA1();
+    TestHMAC();
+    TestPBKDF2();
+    if (iterations > 0)
+        Bench(iterations);
+
+    printf("pbkdf2_test: %s\n", failures ? "FAILED" : "SHA-1 FIPS 180-1, HMAC-SHA1 RFC 2202, PSK IEEE 802.11i H.4 "
+            "and PBKDF2 RFC 6070 passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*******************************************************************************
+  RSA known-answer tests and timing
+
+  Summary:
+    Runs rsa.c on a Linux host against vectors computed by OpenSSL.
+
+  Description:
+    - Decryption (CRT with the private key) of ciphertexts including 0, 1
+      and n - 1, compared with the plaintexts of "openssl pkeyutl -decrypt".
+    - Encryption of premaster secrets with the public key, with RandomGet()
+      giving a known padding, compared with "openssl pkeyutl -encrypt".
+    The vectors are in rsa_test_vectors.h, made by rsa_test_vectors.py.
+
+    With an iteration count, the test then times decryption and encryption.
+    The Makefile builds it for each key size with RSA_USE_MONTGOMERY set to 1
+    and to 0, "make bench" runs the timings of both.
+
+      rsa_test [iterations]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+typedef struct
+{
+    const char *ciphertext;
+    const char *plaintext;
+} RSA_TEST_VECTOR;
+
+typedef struct
+{
+    uint32_t seed;
+    const char *secret;
+    const char *ciphertext;
+} RSA_TEST_ENCRYPT;
+
+#include "rsa_test_vectors.h"
+
+#define KEY_BYTES       (SSL_RSA_KEY_SIZE / 8)
+#define SECRET_BYTES    (48u)
+#define VECTORS(a)      (sizeof (a) / sizeof (a)[0])
+
+SSL_BUFFER sslBuffer;
+
+static uint32_t randomState;
+
+// Deterministic padding bytes, rsa_test_vectors.py uses the same generator
+uint8_t RandomGet(void)
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return (uint8_t) (randomState >> 16);
+}
+
+static void HexToBytes(const char *hex, uint8_t *bytes, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        sscanf(hex + 2 * i, "%2hhx", &bytes[i]);
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void Decrypt(const char *ciphertext)
+{
+    RSABeginDecrypt();
+    HexToBytes(ciphertext, sslBuffer.full, KEY_BYTES);
+    RSASetData(sslBuffer.full, KEY_BYTES, RSA_BIG_ENDIAN);
+    while (RSAStep() != RSA_DONE);
+    RSAEndDecrypt();
+}
+
+static void Encrypt(const uint8_t *modulus, const uint8_t *secret, uint8_t *result)
+{
+    static const uint8_t e[3] = {0x01, 0x00, 0x01};
+    uint8_t data[SECRET_BYTES], n[KEY_BYTES];
+
+    // RSASetData() and RSASetN() swap their buffers in place
+    memcpy(data, secret, SECRET_BYTES);
+    memcpy(n, modulus, KEY_BYTES);
+    RSABeginEncrypt(KEY_BYTES);
+    RSASetData(data, SECRET_BYTES, RSA_BIG_ENDIAN);
+    RSASetN(n, RSA_BIG_ENDIAN);
+    RSASetResult(result, RSA_BIG_ENDIAN);
+    RSASetE((uint8_t *) e, 3, RSA_BIG_ENDIAN);
+    while (RSAStep() != RSA_DONE);
+    RSAEndEncrypt();
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t modulus[KEY_BYTES], secret[SECRET_BYTES];
+    uint8_t expected[KEY_BYTES], result[KEY_BYTES];
+    int iterations = (argc > 1) ? atoi(argv[1]) : 0;
+    int failures = 0;
+    double start, decryptTime, encryptTime;
+    size_t i;
+
+    RSAInit();
+    HexToBytes(testModulus, modulus, KEY_BYTES);
+
+    for (i = 0; i < VECTORS(testDecrypt); i++)
+    {
+        Decrypt(testDecrypt[i].ciphertext);
+        HexToBytes(testDecrypt[i].plaintext, expected, KEY_BYTES);
+        if (memcmp(sslBuffer.full, expected, KEY_BYTES) != 0)
+        {
+            printf("rsa_test: decryption %u of %u bits is wrong\n", (unsigned int) i, (unsigned int) SSL_RSA_KEY_SIZE);
+            failures++;
+        }
+    }
+
+    for (i = 0; i < VECTORS(testEncrypt); i++)
+    {
+        randomState = testEncrypt[i].seed;
+        HexToBytes(testEncrypt[i].secret, secret, SECRET_BYTES);
+        Encrypt(modulus, secret, result);
+        HexToBytes(testEncrypt[i].ciphertext, expected, KEY_BYTES);
+        if (memcmp(result, expected, KEY_BYTES) != 0)
+        {
+            printf("rsa_test: encryption %u of %u bits is wrong\n", (unsigned int) i, (unsigned int) SSL_RSA_KEY_SIZE);
+            failures++;
+        }
+    }
+
+    printf("rsa_test: %u bits, RSA_USE_MONTGOMERY %d: %u decryptions, %u encryptions, %d failed\n",
+            (unsigned int) SSL_RSA_KEY_SIZE, RSA_USE_MONTGOMERY, (unsigned int) VECTORS(testDecrypt),
+            (unsigned int) VECTORS(testEncrypt), failures);
+
+    if (iterations > 0)
+    {
+        start = Now();
+        for (i = 0; i < (size_t) iterations; i++)
+            Decrypt(testDecrypt[i % VECTORS(testDecrypt)].ciphertext);
+        decryptTime = (Now() - start) / iterations;
+
+        start = Now();
+        for (i = 0; i < (size_t) iterations; i++)
+            Encrypt(modulus, secret, result);
+        encryptTime = (Now() - start) / iterations;
+
+        printf("rsa_test: %u bits, RSA_USE_MONTGOMERY %d: decrypt %.3f ms, encrypt %.3f ms\n",
+                (unsigned int) SSL_RSA_KEY_SIZE, RSA_USE_MONTGOMERY, decryptTime * 1e3, encryptTime * 1e3);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+// Generated by rsa_test_vectors.py, do not edit
+
+#if SSL_RSA_KEY_SIZE == 512u
+
+// Private key, least significant word first
+ROM BIGINT_DATA_TYPE SSL_P[RSA_PRIME_WORDS] = {
+    0xaa6146d5u, 0x27c3e9b5u, 0x2824e3fcu, 0x8261d6d0u,
+    0x97c80747u, 0x7e96374fu, 0xe658e13au, 0xcb15c310u
+};
+ROM BIGINT_DATA_TYPE SSL_Q[RSA_PRIME_WORDS] = {
+    0xcb06a895u, 0x87442129u, 0xc94b6f21u, 0xf69d855fu,
+    0xde230f28u, 0x88dce895u, 0x5c1753c1u, 0xca7090abu
+};
+ROM BIGINT_DATA_TYPE SSL_dP[RSA_PRIME_WORDS] = {
+    0x5a98da8du, 0xbf194278u, 0x955c628cu, 0xace05b1du,
+    0xfafe2460u, 0xe3e925dbu, 0x430d9afbu, 0x96b26c50u
+};
+ROM BIGINT_DATA_TYPE SSL_dQ[RSA_PRIME_WORDS] = {
+    0x850d1221u, 0x6aa84a10u, 0xe4774ee1u, 0x104f956cu,
+    0x1b2a5af8u, 0xbd7c239cu, 0x00768d33u, 0x12e7801bu
+};
+ROM BIGINT_DATA_TYPE SSL_qInv[RSA_PRIME_WORDS] = {
+    0x3652ab4du, 0x752e0043u, 0x15cd81f1u, 0x8c3c3e4fu,
+    0xc25e91c9u, 0xe918737du, 0x463ba8b7u, 0x94900d32u
+};
+
+static const char *testModulus =
+    "a0987834db7809f6bd0f3ed50360c91890a5f4a87fa3c91bdf1536b91eb696ae"
+    "155e2325220b50ccb9ac34ffe884f9eef7fcda6480ca587b360d2d1b911801f9";
+
+// Ciphertexts and the plaintexts OpenSSL decrypts them to
+static const RSA_TEST_VECTOR testDecrypt[] = {
+  { "07b7a8f5260e88615b30d2f7c7ba1bba641adee46614eaf5ec0d3d925f2ab827"
+    "c3e8b2a254382f4fbcd993a7891f31f2b3a4401de4d32299522dc31b739b44dd",
+    "9edf30d477b25f9734142b38a9a317c2707b99bcd12770e5f0d8db36240ed06c"
+    "86b382108fa12417bc8dc566f425e9faf2c643d64c1aeab1c9def5679a0f0389" },
+  { "9b4167144a0b7ff1adc7d7fa303b54a98b0107630a5ee50f059c84a3f3bfe007"
+    "4e56ccdb73d7fc1ca3f3f3bc56079838e75febfeb1dc65b63fae41a06e9a526b",
+    "82f5942c2e502451c19ec18ae911e67a7dc7cd7d8175bf471e59b05722df4e59"
+    "0d1a11c696a4203336da2cf8a406da67db96ce8c65eab7847d3a148378c76615" },
+  { "72fad0569eca50cb9ce294710420f35b96671c1a9b655b82d2620c9d76b79430"
+    "a3517c29f2c38dc5f0b6bc259e7f4522f494cf827a8f8ee5e7e44aebbd8724c5",
+    "26995e7e31bbdc21e4720b4c3b778b7325a8cd17c4792ef9c0e2efc68186f5f6"
+    "6f5328e52e79158e9df02e7e6b3bc0aeda8bef3f5a18f14af2e2788db0a51926" },
+  { "7de9d538a571ce5a2b302e078d81098c06b6fff633785edc7a3fdba1bc4fe829"
+    "97fc88ef9f144241ce40f9d6634e2e52b17b2427fdc029595cde30a52df72cc7",
+    "4770e44e1a6a8d291183cf7d81dc1de84ee3f695ed8631cf4e786db16eaec99a"
+    "a83e7f3c975f961df2a106b9507ac914b7f8024ebcedb9817a8f2b538aafa83c" },
+  { "98de0d0e1ac43251dde3a0d923845b5cfe255fb60d7b0324aaf95721ca422843"
+    "645e0f247052775c8fe6b580091217d08c869a3b67440cf9b19d226cfde72f69",
+    "2680881c8315b47eba5c5fe3d55dfb6a9ff60a95e075dda761680357414e5f71"
+    "8bc0c6eab25b6b6c5bc1f39d4159732a83481f63ea189cf598cfefc6f5edc3f5" },
+  { "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000" },
+  { "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000001",
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000001" },
+  { "a0987834db7809f6bd0f3ed50360c91890a5f4a87fa3c91bdf1536b91eb696ae"
+    "155e2325220b50ccb9ac34ffe884f9eef7fcda6480ca587b360d2d1b911801f8",
+    "a0987834db7809f6bd0f3ed50360c91890a5f4a87fa3c91bdf1536b91eb696ae"
+    "155e2325220b50ccb9ac34ffe884f9eef7fcda6480ca587b360d2d1b911801f8" },
+};
+
+// Premaster secrets with RandomGet() seeds, and the ciphertexts OpenSSL
+// encrypts the padded blocks to
+static const RSA_TEST_ENCRYPT testEncrypt[] = {
+  { 1u, "3132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f50"
+    "5152535455565758595a5b5c5d5e5f60",
+    "4eae9f05602e5d56a38b657660bbae36dfafc68ffb876fe902791c728e6020eb"
+    "9fd1240ed2a1ddadaf0852d12970e70fe9f7c2ad5931ef32e127f3ca49445a46" },
+  { 2u, "32333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f5051"
+    "52535455565758595a5b5c5d5e5f6061",
+    "35b0539f4eb7bb68d4d1bfdedc020138a0ec58fa135c154806c9362f05aec7a7"
+    "86ac3b8f46e4000fbd9b7a4092d63c08a90889de562aef0080481b0cec0351ec" },
+  { 3u, "333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f505152"
+    "535455565758595a5b5c5d5e5f606162",
+    "70ab7a5bc6b5e0b0beb849554003ccd0b418f0ed8a7a9d14db6089e93b56702f"
+    "0d6b9bf5f2bba65dabad06b21f2c9bcd35bfd9acfcaa805cf2e355caeccdc64a" },
+};
+
+#endif
+
+#if SSL_RSA_KEY_SIZE == 1024u
+
+// Private key, least significant word first
+ROM BIGINT_DATA_TYPE SSL_P[RSA_PRIME_WORDS] = {
+    0x4147753du, 0x29c91663u, 0x1d77f1bbu, 0xac08228bu,
+    0x935932c0u, 0x601c6f2fu, 0x4ac1dcebu, 0x5bb6ca73u,
+    0xc31f20c5u, 0x0b1ac778u, 0x4e3de089u, 0x15d48ab8u,
+    0x88f80c32u, 0xc22fc297u, 0xbee0879bu, 0xe4f813b3u
+};
+ROM BIGINT_DATA_TYPE SSL_Q[RSA_PRIME_WORDS] = {
+    0xb3386509u, 0xdc316c8du, 0x19505ffdu, 0x28adbfbfu,
+    0xa0201f53u, 0x659968e5u, 0xd13346d0u, 0x3b99909eu,
+    0x705553f6u, 0x1baa62bbu, 0x2ad95ee1u, 0x74d2621du,
+    0xcd187a36u, 0xb9dac453u, 0x5b4e1630u, 0xc89218f7u
+};
+ROM BIGINT_DATA_TYPE SSL_dP[RSA_PRIME_WORDS] = {
+    0xf208a1d1u, 0x16ef341du, 0xf9086427u, 0x1cdae6cau,
+    0x348bb202u, 0xbf728e36u, 0x084ac5a2u, 0x769b498bu,
+    0x3c336dfau, 0xa97a322eu, 0x53111a51u, 0x3fa07ccdu,
+    0xe55bf530u, 0xf8a490adu, 0x9d451071u, 0xa7848885u
+};
+ROM BIGINT_DATA_TYPE SSL_dQ[RSA_PRIME_WORDS] = {
+    0x13521661u, 0xee191643u, 0xccfceffdu, 0xbc9cb006u,
+    0x1955e80fu, 0x10a3f3ceu, 0x778bb29eu, 0x39cb70f4u,
+    0x159542b4u, 0xff2900a1u, 0xa80fa3bdu, 0x3ef4b03cu,
+    0x04298432u, 0xb68d19f1u, 0x9899fd7bu, 0x99023b61u
+};
+ROM BIGINT_DATA_TYPE SSL_qInv[RSA_PRIME_WORDS] = {
+    0x54c94689u, 0xc1644090u, 0x7377e76du, 0x27dbbae2u,
+    0x38971994u, 0x52e3e7e0u, 0x7f7b43f2u, 0xb1807f13u,
+    0x8b187de1u, 0xde5a2a0au, 0x752648d3u, 0x3c1daf51u,
+    0xfd97b56eu, 0xfcb9a16cu, 0x72c86dc5u, 0xa47767acu
+};
+
+static const char *testModulus =
+    "b3647b34288028c109f18e8f87f32b9db51f8f3ab861a462c70314dfdc62638a"
+    "82684a9b40da1cc31b49d9799e1d085197aa7e2d9edcf0e27e75561e7df36838"
+    "6e38b9cbbbc730713c1c6248fddf6a3b749446505c7d26a6dfc507bd8847c3dd"
+    "0c156062a26991b00bbe87516f6908f96a2aa3d4293bb1a110c07f72c91c3025";
+
+// Ciphertexts and the plaintexts OpenSSL decrypts them to
+static const RSA_TEST_VECTOR testDecrypt[] = {
+  { "94e812f22988a6b9ca2f37ef664e60f0b2ab68cd78529be44c4e2a09048410a7"
+    "a876fe26bfe982675f77cd16f2e2eb2fabf5e2ee80aef57a004198840870af07"
+    "94e812f22988a6b9ca2f37ef664e60f0b2ab68cd78529be44c4e2a09048410a7"
+    "a876fe26bfe982675f77cd16f2e2eb2fabf5e2ee80aef57a004198840870af07",
+    "a536b9f83d38af2c7c9e9c24c8edf4b34411829f85d18adca99f2397a49b23de"
+    "c2434a5210caa61b44f90646e2f4c0740bafa62ba841c2e24f02653f176fef46"
+    "b6ea28805b7165d5e7c980786527b26cf06108a9c68516046f7a0b5bb8b81c04"
+    "3a89545b6b65763528adf600aa6b1b3e53ff6183141f197d78393cccd4e492ea" },
+  { "8fb08551cec0ce3666ad2dddc9530a391a97ac88f4f6d6e223fd6a94916b846d"
+    "baa9ddc8e9af492fc0e4dda46212a688662890740af89bac5da53b55947e6512"
+    "8fb08551cec0ce3666ad2dddc9530a391a97ac88f4f6d6e223fd6a94916b846d"
+    "baa9ddc8e9af492fc0e4dda46212a688662890740af89bac5da53b55947e6512",
+    "2bd016ba1bd923e487331fd33b087f0bc24630e1df0e58d2f3aa434b228897c7"
+    "617b4a76f1db3bc53ed95e11141cc51d72973eb0610ea401ecb9a56d866b86e9"
+    "b6c65bd16101c02b26ed8f1a60d225c91f949bb9497f24ef171cd4f03117bbb2"
+    "0c39cf62695f81b4e498f712cb69c00295b4898960690c7afc63ce471a517547" },
+  { "29ea23a3b9c9f59414c7de27ce5c9c640b7feb8f2885bbfe9e1edd43465c9fbd"
+    "a6149cf780f7abea8400295060859c75952f4e4ab883bdf81c09e66b18c7d935"
+    "29ea23a3b9c9f59414c7de27ce5c9c640b7feb8f2885bbfe9e1edd43465c9fbd"
+    "a6149cf780f7abea8400295060859c75952f4e4ab883bdf81c09e66b18c7d935",
+    "66ce2b201a0fb65273ecdf1e0a8b7d4227fc5c679f508a87dfe08bb2cd8d94c9"
+    "632bc6e038bb122b307e84c9ac782b656ccc6c363f172f4d2718c354f6f76011"
+    "7f8961c3ff1893e79a0523b45aaefe37cff4807fd976ff1990cffb4f1a7e1e72"
+    "1ad8335706f5f4fdca23253cb223adf1c97f24329c1719108b339e3469f6f082" },
+  { "8e58ec726861fe97ea22518f7386582fa58156e49ce8e86f75794706869d805d"
+    "f1a3b4180c53b3f87478edc171eb226ba2abe2b32bc89b22cd5ae6e16a22942c"
+    "8e58ec726861fe97ea22518f7386582fa58156e49ce8e86f75794706869d805d"
+    "f1a3b4180c53b3f87478edc171eb226ba2abe2b32bc89b22cd5ae6e16a22942c",
+    "56dab499a812e5de8c067655c6ce0e933c09d265145ca1e208fb6a2bb5feaf61"
+    "57a21b6d1c1886891c889d79b1ca7900ac2624a32067568039d39369e8170be9"
+    "e1eedfe2f3aef51304fb1d38f3a1e23abbbf23ea3b5532a84bc1bec9dcf86922"
+    "bc7940ac89108bcd1c310d8649bae3ae2c52aa8b3bc329d8e68298f6537cc4d2" },
+  { "4ce4d830d842cda0a8c1ceda12f1c1b8bb690d9f172e3d1e4c51536ebcf8a96d"
+    "a0a145794b0fb338f693bf14a4f2c6aea7e6a517292969152809f9926cd6371b"
+    "4ce4d830d842cda0a8c1ceda12f1c1b8bb690d9f172e3d1e4c51536ebcf8a96d"
+    "a0a145794b0fb338f693bf14a4f2c6aea7e6a517292969152809f9926cd6371b",
+    "8072c5c82d22cc71812e949d601401f0fba8db62b02f46517da014d4e181067e"
+    "c12fbb88e1ba6a1cb0293cf721f549cdba9e5c23b3ddaf56256ceba45fe865c9"
+    "0693d34724833a30ee53a7fb065793f120630c27e76eb9a1246e366fe0029968"
+    "43fdce23585fb0a42630bfa1c1776d0f31bc9857c0fb5b3940e350f712b219a3" },
+  { "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000" },
+  { "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000001",
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000001" },
+  { "b3647b34288028c109f18e8f87f32b9db51f8f3ab861a462c70314dfdc62638a"
+    "82684a9b40da1cc31b49d9799e1d085197aa7e2d9edcf0e27e75561e7df36838"
+    "6e38b9cbbbc730713c1c6248fddf6a3b749446505c7d26a6dfc507bd8847c3dd"
+    "0c156062a26991b00bbe87516f6908f96a2aa3d4293bb1a110c07f72c91c3024",
+    "b3647b34288028c109f18e8f87f32b9db51f8f3ab861a462c70314dfdc62638a"
+    "82684a9b40da1cc31b49d9799e1d085197aa7e2d9edcf0e27e75561e7df36838"
+    "6e38b9cbbbc730713c1c6248fddf6a3b749446505c7d26a6dfc507bd8847c3dd"
+    "0c156062a26991b00bbe87516f6908f96a2aa3d4293bb1a110c07f72c91c3024" },
+};
+
+// Premaster secrets with RandomGet() seeds, and the ciphertexts OpenSSL
+// encrypts the padded blocks to
+static const RSA_TEST_ENCRYPT testEncrypt[] = {
+  { 1u, "3132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f50"
+    "5152535455565758595a5b5c5d5e5f60",
+    "afc15cb1df1031a8615ee4648d6078bab8f76ba6ce469ac7e6ad68d13253d427"
+    "594c5ef09872669085ede5475295e9db11d6c3f005316d6b01c01cc6fe29f1ed"
+    "496fe21c81edafef440217dd5bbf6a473007c44149bd24971c240edcc5295162"
+    "44120d482398f525131dd65efbfb60102535a114ae17b2b677aab1dde62c0ec1" },
+  { 2u, "32333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f5051"
+    "52535455565758595a5b5c5d5e5f6061",
+    "791a47507c477c1fd9421c9b9646a5c3498dbc5f623c8d213376468173bdbed2"
+    "0f74023223952ff311c11daf2b37dfbbc99a6d963e056e06ed541c69c41f502b"
+    "876339556d717fe9df1e4aa757dc9e870a62125e39ff646f1bcb5d94c5502a6e"
+    "fd3fde1c956a44e52de019e40b01339a7c64f82b840d4cbbbd0425e256130972" },
+  { 3u, "333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f505152"
+    "535455565758595a5b5c5d5e5f606162",
+    "aad0a040f1c9e82e1dd5ddc868cfa771d782fe3f72329d9e8a0b22c7f0f8e870"
+    "1d359947aec14498d2e333d6113e9a42b41d09cc717a5f3bd5cefbc0669c9af6"
+    "9fb1a59794cc5a388c1b6f3eebbdd0b4b3499e2ba9df3801710857d1bae210d5"
+    "2500effb86eecce41c303a238de2af9b6ffb1efcef77c1a4723a9c30e22ea32e" },
+};
+
+#endif
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# rsa_test_vectors.py
+#
+# Writes rsa_test_vectors.h for rsa_test.c: a 512-bit and a 1024-bit key made
+# by "openssl genrsa", and for each key
+#   - ciphertexts with the plaintexts OpenSSL gives for them
+#     ("openssl pkeyutl -decrypt", no padding),
+#   - premaster secrets with the ciphertexts OpenSSL gives for them once they
+#     are padded as RSASetData() pads them, with the bytes of the RandomGet()
+#     of rsa_test.c ("openssl pkeyutl -encrypt", no padding).
+#
+#   python3 rsa_test_vectors.py [openssl] > rsa_test_vectors.h
+
+import hashlib
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+OPENSSL = sys.argv[1] if len(sys.argv) > 1 else 'openssl'
+KEY_SIZES = (512, 1024)
+SECRET_SIZE = 48
+ENCRYPT_SEEDS = (1, 2, 3)
+
+
+def openssl(args, data=None):
+    return subprocess.run([OPENSSL] + args, input=data, stdout=subprocess.PIPE,
+                          check=True).stdout
+
+
+def key_fields(pem):
+    text = openssl(['rsa', '-in', pem, '-noout', '-text']).decode()
+    fields = {}
+    for name, hexdigits in re.findall(r'^(\w+):\s*\n((?:\s+[0-9a-f:]+\n)+)', text, re.M):
+        fields[name] = int(re.sub(r'[^0-9a-f]', '', hexdigits), 16)
+    return fields
+
+
+def raw(op, pem, value, size):
+    args = ['pkeyutl', op, '-inkey', pem, '-pkeyopt', 'rsa_padding_mode:none']
+    if op == '-encrypt':
+        args.append('-pubin')
+    out = openssl(args, value.to_bytes(size, 'big'))
+    return int.from_bytes(out, 'big')
+
+
+def random_bytes(seed):
+    # Same generator as RandomGet() in rsa_test.c
+    while True:
+        seed = (seed * 1103515245 + 12345) & 0xffffffff
+        yield (seed >> 16) & 0xff
+
+
+def pad(secret, size, seed):
+    # RSASetData() fills the block from its least significant byte:
+    # the secret, 0x00, nonzero random bytes, 0x02, 0x00
+    rnd = random_bytes(seed)
+    filler = []
+    while len(filler) < size - len(secret) - 3:
+        b = next(rnd)
+        if b:
+            filler.append(b)
+    return bytes([0x00, 0x02]) + bytes(reversed(filler)) + b'\x00' + secret
+
+
+def words(value, count):
+    w = ['0x%08xu' % ((value >> (32 * i)) & 0xffffffff) for i in range(count)]
+    return ',\n    '.join(', '.join(w[i:i + 4]) for i in range(0, count, 4))
+
+
+def hexstr(value, size):
+    h = '%0*x' % (2 * size, value)
+    return '\n    '.join('"%s"' % h[i:i + 64] for i in range(0, len(h), 64))
+
+
+def key_section(bits, tmp):
+    size = bits // 8
+    pem = os.path.join(tmp, 'key%d.pem' % bits)
+    pub = os.path.join(tmp, 'pub%d.pem' % bits)
+    openssl(['genrsa', '-out', pem, str(bits)])
+    openssl(['rsa', '-in', pem, '-pubout', '-out', pub])
+    k = key_fields(pem)
+    n, p, q = k['modulus'], k['prime1'], k['prime2']
+    pw = bits // 64
+
+    out = ['#if SSL_RSA_KEY_SIZE == %du' % bits, '']
+    out.append('// Private key, least significant word first')
+    for name, value in (('SSL_P', p), ('SSL_Q', q), ('SSL_dP', k['exponent1']),
+                        ('SSL_dQ', k['exponent2']), ('SSL_qInv', k['coefficient'])):
+        out.append('ROM BIGINT_DATA_TYPE %s[RSA_PRIME_WORDS] = {\n    %s\n};' % (name, words(value, pw)))
+    out.append('')
+    out.append('static const char *testModulus =\n    %s;' % hexstr(n, size))
+    out.append('')
+
+    # Random values below n, then the edge cases 0, 1 and n - 1
+    cts = [int.from_bytes(hashlib.sha512(b'%d-%d' % (bits, i)).digest() * 2, 'big') % n
+           for i in range(5)] + [0, 1, n - 1]
+    out.append('// Ciphertexts and the plaintexts OpenSSL decrypts them to')
+    out.append('static const RSA_TEST_VECTOR testDecrypt[] = {')
+    for c in cts:
+        m = raw('-decrypt', pem, c, size)
+        assert pow(m, 65537, n) == c
+        out.append('  { %s,\n    %s },' % (hexstr(c, size), hexstr(m, size)))
+    out.append('};')
+    out.append('')
+
+    out.append('// Premaster secrets with RandomGet() seeds, and the ciphertexts OpenSSL')
+    out.append('// encrypts the padded blocks to')
+    out.append('static const RSA_TEST_ENCRYPT testEncrypt[] = {')
+    for seed in ENCRYPT_SEEDS:
+        secret = bytes((0x30 + seed + j) & 0xff for j in range(SECRET_SIZE))
+        block = int.from_bytes(pad(secret, size, seed), 'big')
+        c = raw('-encrypt', pub, block, size)
+        out.append('  { %du, %s,\n    %s },' % (seed, hexstr(int.from_bytes(secret, 'big'), SECRET_SIZE),
+                                             hexstr(c, size)))
+    out.append('};')
+    out.append('')
+    out.append('#endif')
+    return '\n'.join(out)
+
+
+def main():
+    print('// Generated by rsa_test_vectors.py, do not edit')
+    print()
+    with tempfile.TemporaryDirectory() as tmp:
+        print('\n\n'.join(key_section(bits, tmp) for bits in KEY_SIZES))
+
+
+main()
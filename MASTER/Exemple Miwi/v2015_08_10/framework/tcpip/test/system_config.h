@@ -0,0 +1,57 @@
+/*******************************************************************************
+  Host configuration for the stack tests
+
+  Summary:
+    Builds single modules of the stack on a Linux host: the RSA module with
+    the portable C helpers of big_int_helper.c and 32-bit big integer words,
+    and the DNS client with stubs of the UDP, ARP and tick modules.
+
+  Description:
+    SSL_RSA_KEY_SIZE and RSA_USE_MONTGOMERY are given by the Makefile.
+ *******************************************************************************/
+
+#ifndef __TEST_SYSTEM_CONFIG_H_
+#define __TEST_SYSTEM_CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PTR_BASE            uintptr_t
+#define ROM_PTR_BASE        uintptr_t
+#define ROM                 const
+#define memcpypgm2ram       memcpy
+#define memcmppgm2ram       memcmp
+#define strcmppgm2ram       strcmp
+#define strcpypgm2ram       strcpy
+#define strlenpgm           strlen
+
+#define SYS_CLK_FrequencyInstructionGet()   1000000ul
+#define SYS_CLK_FrequencyPeripheralGet()    1000000ul
+
+#define TAP_INTERFACE       "tap0"
+
+#define STACK_USE_SSL_SERVER
+#define STACK_USE_SSL_CLIENT
+#define STACK_USE_RSA
+
+#if !defined(SSL_RSA_KEY_SIZE)
+#define SSL_RSA_KEY_SIZE    (1024ul)
+#endif
+#define MAX_SSL_CONNECTIONS (1)
+#define MAX_SSL_SESSIONS    (1)
+#define MAX_SSL_BUFFERS     (1)
+#define MAX_SSL_HASHES      (2)
+
+#define STACK_USE_DNS_CLIENT
+
+#define STACK_USE_TCP
+#define TCP_ETH_RAM_SIZE    (4096ul)
+#define TCP_PIC_RAM_SIZE    (0ul)
+#define TCP_SPI_RAM_SIZE    (0ul)
+#define TCP_SPI_RAM_BASE_ADDRESS    (0)
+#define MAX_UDP_SOCKETS     (2)
+#define MAX_HTTP_CONNECTIONS    (1)
+#define MY_DEFAULT_HOST_NAME    "TEST"
+
+#endif
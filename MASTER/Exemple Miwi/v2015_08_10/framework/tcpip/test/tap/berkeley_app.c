@@ -0,0 +1,214 @@
+/*******************************************************************************
+  Berkeley echo server of the TAP host target
+
+  Summary:
+    Serves the 32 connections of BSD_APP_PORT through berkeley_api.c, for
+    the select() and poll() checks of tap_check.py and the benchmark of
+    tap_bench.py.
+
+  Description:
+    With TAP_BSD_APP set, a listening socket takes every
+    TCP_PURPOSE_BERKELEY_SERVER socket of system_config.h as backlog.  Each
+    call of TapBSDTask() accepts the connections waiting and echoes the
+    data of the connections, BSD_APP_READ bytes per connection and call,
+    the way TAP_BSD_APP asks for:
+    - select: BerkeleySelect() on the listening socket and the connections;
+    - poll: BerkeleyPoll() on the same sockets;
+    - recv: accept() and recv() on every socket, without asking which ones
+      are ready, the loop of the applications written before select().
+
+    A connection closed or reset by the peer is closed with closesocket(),
+    which gives its socket back to the backlog.  On exit, main.c prints:
+
+      bsd_app accepted <connections> echoed <bytes> closed <connections> passes <calls> ready <sockets reported>
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#define BSD_APP_PORT    (7000u)
+
+// Bytes read per connection and call, less than the RX FIFO so that data
+// is left for the next call without a new segment
+#define BSD_APP_READ    (16)
+
+typedef enum
+{
+    BSD_APP_SELECT = 0,
+    BSD_APP_POLL,
+    BSD_APP_RECV
+} BSD_APP_MODE;
+
+static BSD_APP_MODE mode;
+static SOCKET listener = INVALID_SOCKET;
+static bool connected[BSD_SOCKET_COUNT];
+static unsigned long accepted, echoed, closed, passes, ready;
+
+static void Accept(void)
+{
+    SOCKET s;
+
+    while ((s = accept(listener, NULL, NULL)) != INVALID_SOCKET)
+    {
+        connected[s] = true;
+        accepted++;
+    }
+}
+
+static void Echo(SOCKET s)
+{
+    char data[BSD_APP_READ];
+    int n;
+
+    n = recv(s, data, sizeof (data), 0);
+    if (n < 0)
+    {
+        closesocket(s);
+        connected[s] = false;
+        closed++;
+        return;
+    }
+    // The peer reads the echoes, the TX FIFO has room for what was read
+    if (n > 0)
+        echoed += (unsigned long) send(s, data, n, 0);
+}
+
+static void Select(void)
+{
+    BSDFdSet readable;
+    BSDTimeval timeout = {0, 0};
+    SOCKET s;
+
+    BSD_FD_ZERO(&readable);
+    BSD_FD_SET(listener, &readable);
+    for (s = 0; s < BSD_SOCKET_COUNT; s++)
+    {
+        if (connected[s])
+            BSD_FD_SET(s, &readable);
+    }
+    if (BerkeleySelect(BSD_SOCKET_COUNT, &readable, NULL, NULL, &timeout) <= 0)
+        return;
+
+    for (s = 0; s < BSD_SOCKET_COUNT; s++)
+    {
+        if (!BSD_FD_ISSET(s, &readable))
+            continue;
+        ready++;
+        if (s == listener)
+            Accept();
+        else
+            Echo(s);
+    }
+}
+
+static void Poll(void)
+{
+    BSDPollFd fds[BSD_SOCKET_COUNT];
+    unsigned int n, i;
+    SOCKET s;
+
+    fds[0].fd = listener;
+    fds[0].events = BSD_POLLIN;
+    n = 1;
+    for (s = 0; s < BSD_SOCKET_COUNT; s++)
+    {
+        if (!connected[s])
+            continue;
+        fds[n].fd = s;
+        fds[n].events = BSD_POLLIN;
+        n++;
+    }
+    if (BerkeleyPoll(fds, n, 0) <= 0)
+        return;
+
+    for (i = 0; i < n; i++)
+    {
+        if (fds[i].revents == 0)
+            continue;
+        ready++;
+        if (fds[i].fd == listener)
+            Accept();
+        else
+            Echo(fds[i].fd);
+    }
+}
+
+static void Recv(void)
+{
+    SOCKET s;
+
+    Accept();
+    for (s = 0; s < BSD_SOCKET_COUNT; s++)
+    {
+        if (connected[s])
+            Echo(s);
+    }
+}
+
+/*****************************************************************************
+  Function:
+    bool TapBSDStart(void)
+
+  Summary:
+    Opens the listening socket if TAP_BSD_APP is set.
+
+  Returns:
+    true if the socket listens, false otherwise
+ ***************************************************************************/
+bool TapBSDStart(void)
+{
+    const char *asked = getenv("TAP_BSD_APP");
+    struct sockaddr_in address;
+
+    if (asked == NULL)
+        return false;
+    if (strcmp(asked, "poll") == 0)
+        mode = BSD_APP_POLL;
+    else if (strcmp(asked, "recv") == 0)
+        mode = BSD_APP_RECV;
+    else
+        mode = BSD_APP_SELECT;
+
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    memset(&address, 0, sizeof (address));
+    address.sin_port = BSD_APP_PORT;
+    if (bind(listener, (struct sockaddr *) &address, sizeof (address)) == SOCKET_ERROR)
+        return false;
+    // Every TCP_PURPOSE_BERKELEY_SERVER socket
+    return listen(listener, BSD_SOCKET_COUNT - 1) == 0;
+}
+
+/*****************************************************************************
+  Function:
+    void TapBSDTask(void)
+
+  Summary:
+    Accepts and echoes, called by main.c after StackApplications().
+ ***************************************************************************/
+void TapBSDTask(void)
+{
+    passes++;
+    if (mode == BSD_APP_SELECT)
+        Select();
+    else if (mode == BSD_APP_POLL)
+        Poll();
+    else
+        Recv();
+}
+
+/*****************************************************************************
+  Function:
+    void TapBSDPrint(void)
+
+  Summary:
+    Prints the counters for tap_check.py and tap_bench.py.
+ ***************************************************************************/
+void TapBSDPrint(void)
+{
+    printf("bsd_app accepted %lu echoed %lu closed %lu passes %lu ready %lu\n",
+            accepted, echoed, closed, passes, ready);
+}
@@ -0,0 +1,345 @@
+/*******************************************************************************
+  Stack main loop of the TAP host target
+
+  Summary:
+    Runs the unmodified stack as a Linux process, on a TAP device or on a
+    pcap capture replayed by linux_tap.c.
+
+  Description:
+    The loop is the one of the demo applications: StackTask() then
+    StackApplications().  On a TAP device it runs until SIGINT or SIGTERM.
+    When a capture is replayed, it keeps running for TAP_DRAIN_MS after the
+    last frame so that the answers are sent, then exits.  On exit it prints
+    the counters that the checks compare:
+
+      udp_rx <datagrams> lost <datagrams>
+      http_get <requests with arguments>
+      tx_dropped <frames dropped by the TX delay line>
+      radio_rx <frames> latency_us <mean> max <longest>
+      cpu_pct <CPU time of the process / time it ran>
+
+    With TAP_TFTP_GET or TAP_TFTP_PUT, it runs the TFTP transfer of
+    tftp_app.c and exits TAP_DRAIN_MS after it ends, so that its last ACK
+    leaves the TX delay line.  With TAP_UDP_APP, it runs the UDP receivers
+    of udp_app.c and prints their counters, with TAP_BSD_APP the Berkeley
+    echo server of berkeley_app.c, with TAP_SMTP_APP the SMTP messages of
+    smtp_app.c, with TAP_MDNS_APP the mDNS responder and lookups of
+    mdns_app.c, with TAP_UART the UART to TCP bridge on the UART of
+    uart_emu.c, and prints its byte counts.  TAP_LOAD_US stands for the
+    work of an application: the loop spins for that long after each
+    StackApplications().  TAP_STALL_MS stands for longer work, like a step
+    of an SSL handshake: the loop spins for that long every
+    TAP_STALL_PERIOD.
+
+    The last two lines measure what the stack leaves to a radio that shares
+    the CPU, like the MiWi stack of the demos:
+    - With TAP_RADIO_MS set, SIGALRM stands for the RX interrupt of the
+      radio at that period, and the loop takes the frame after
+      StackApplications(), where the MiWi demos call
+      MiApp_MessageAvailable().  The latency is from the signal to there.
+    - With TAP_IDLE set, the STACK_IDLE_HOOK of StackApplications() sleeps
+      in MACTapWait() for StackGetIdleTime(), where a PIC would sleep until
+      its next interrupt.  A frame or the radio signal ends the sleep.
+      Without it the loop spins, at 100 % of a CPU.
+
+    See the Makefile for the settings taken from the environment.
+ *******************************************************************************/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+// Milliseconds the stack keeps running after the end of a replay, the
+// TAP_DRAIN_MS environment variable overrides it
+#if !defined(TAP_DRAIN_MS)
+#define TAP_DRAIN_MS    (500u)
+#endif
+
+// Period of the TAP_STALL_MS spins
+#define TAP_STALL_PERIOD    (TICK_SECOND / 10u)
+
+// Longest sleep of TapIdle(): StackGetIdleTime() does not know when the
+// modules that StackApplications() calls on every pass have work
+#define TAP_IDLE_MAX_MS (10u)
+
+APP_CONFIG AppConfig;
+
+// MPFS2 image in memory, made from web/ by mpfs_image.py
+extern const uint8_t MPFS_Image[];
+uint32_t MPFS_Start;
+
+// tftp_app.c
+bool TapTFTPStart(void);
+bool TapTFTPTask(void);
+
+// udp_app.c
+bool TapUDPStart(void);
+void TapUDPTask(void);
+void TapUDPPrint(void);
+
+// berkeley_app.c
+bool TapBSDStart(void);
+void TapBSDTask(void);
+void TapBSDPrint(void);
+
+// smtp_app.c
+bool TapSMTPStart(void);
+void TapSMTPTask(void);
+void TapSMTPPrint(void);
+
+// mdns_app.c
+bool TapMDNSStart(void);
+void TapMDNSTask(void);
+void TapMDNSPrint(void);
+
+// uart_emu.c
+bool TapUARTStart(void);
+void TapUARTPrint(void);
+
+static volatile sig_atomic_t stop;
+static unsigned long httpGets;
+static bool idleSleep;
+
+// Radio RX interrupt: time of the last frame not yet taken by the loop
+static volatile sig_atomic_t radioPending;
+static volatile uint32_t radioTime;
+static unsigned long radioFrames;
+static uint64_t radioLatencySum;
+static uint32_t radioLatencyMax;
+
+char *(ultoa)(char *buf, unsigned long val, int radix)
+{
+    snprintf(buf, 11, radix == 16 ? "%lx" : "%lu", val);
+    return buf;
+}
+
+// The mDNS responder prints with the putsUART() of uart.c, which drives the
+// UART of a PIC
+void putsUART(char *data)
+{
+    fputs(data, stderr);
+}
+
+// Counts the GET requests with arguments, shown by ~hits~
+HTTP_IO_RESULT HTTPExecuteGet(void)
+{
+    httpGets++;
+    return HTTP_IO_DONE;
+}
+
+// The dynamic variables of web/, called by HTTPPrint() in http_print.h
+void HTTPPrint_title(void)
+{
+    TCPPutROMString(sktHTTP, (ROM uint8_t *) "TAP host target");
+}
+
+void HTTPPrint_hits(void)
+{
+    char digits[11];
+
+    ultoa(httpGets, digits);
+    TCPPutString(sktHTTP, (uint8_t *) digits);
+}
+
+static void Stop(int signal)
+{
+    stop = 1;
+}
+
+// Microseconds of CLOCK_MONOTONIC, the ticks of tick.c without its shared
+// reading buffer, so that the signal handler can use it
+static uint32_t Microseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000ull + (uint64_t) ts.tv_nsec / 1000ull);
+}
+
+static void RadioInterrupt(int signal)
+{
+    if (!radioPending)
+    {
+        radioTime = Microseconds();
+        radioPending = 1;
+    }
+}
+
+static void RadioTask(void)
+{
+    uint32_t latency;
+
+    if (!radioPending)
+        return;
+    latency = Microseconds() - radioTime;
+    radioPending = 0;
+    radioFrames++;
+    radioLatencySum += latency;
+    if (latency > radioLatencyMax)
+        radioLatencyMax = latency;
+}
+
+static void StartRadio(void)
+{
+    const char *period = getenv("TAP_RADIO_MS");
+    struct sigaction action;
+    struct itimerval timer;
+
+    if (period == NULL)
+        return;
+    memset(&action, 0, sizeof (action));
+    action.sa_handler = RadioInterrupt;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &action, NULL);
+
+    memset(&timer, 0, sizeof (timer));
+    timer.it_interval.tv_usec = strtoul(period, NULL, 10) * 1000ul;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+// STACK_IDLE_HOOK, see system_config.h
+void TapIdle(uint32_t ticks)
+{
+    if (!idleSleep || radioPending)
+        return;
+    if (ticks > TAP_IDLE_MAX_MS * (TICK_SECOND / 1000u))
+        ticks = TAP_IDLE_MAX_MS * (TICK_SECOND / 1000u);
+    MACTapWait(ticks / (TICK_SECOND / 1000000u));
+}
+
+// Work of an application between two passes of the loop
+static void Load(uint32_t microseconds)
+{
+    uint32_t start = Microseconds();
+
+    while (Microseconds() - start < microseconds);
+}
+
+static double CPUPercent(uint32_t start)
+{
+    struct rusage usage;
+    double cpu;
+
+    getrusage(RUSAGE_SELF, &usage);
+    cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    return 100.0 * cpu / ((Microseconds() - start) / 1e6);
+}
+
+static void InitAppConfig(void)
+{
+    memset(&AppConfig, 0, sizeof (AppConfig));
+    AppConfig.MyMACAddr.v[0] = MY_DEFAULT_MAC_BYTE1;
+    AppConfig.MyMACAddr.v[1] = MY_DEFAULT_MAC_BYTE2;
+    AppConfig.MyMACAddr.v[2] = MY_DEFAULT_MAC_BYTE3;
+    AppConfig.MyMACAddr.v[3] = MY_DEFAULT_MAC_BYTE4;
+    AppConfig.MyMACAddr.v[4] = MY_DEFAULT_MAC_BYTE5;
+    AppConfig.MyMACAddr.v[5] = MY_DEFAULT_MAC_BYTE6;
+    AppConfig.MyIPAddr.Val = MY_DEFAULT_IP_ADDR_BYTE1 | MY_DEFAULT_IP_ADDR_BYTE2 << 8ul |
+            MY_DEFAULT_IP_ADDR_BYTE3 << 16ul | MY_DEFAULT_IP_ADDR_BYTE4 << 24ul;
+    AppConfig.DefaultIPAddr.Val = AppConfig.MyIPAddr.Val;
+    AppConfig.MyMask.Val = MY_DEFAULT_MASK_BYTE1 | MY_DEFAULT_MASK_BYTE2 << 8ul |
+            MY_DEFAULT_MASK_BYTE3 << 16ul | MY_DEFAULT_MASK_BYTE4 << 24ul;
+    AppConfig.DefaultMask.Val = AppConfig.MyMask.Val;
+    AppConfig.MyGateway.Val = MY_DEFAULT_GATE_BYTE1 | MY_DEFAULT_GATE_BYTE2 << 8ul |
+            MY_DEFAULT_GATE_BYTE3 << 16ul | MY_DEFAULT_GATE_BYTE4 << 24ul;
+    AppConfig.PrimaryDNSServer.Val = MY_DEFAULT_PRIMARY_DNS_BYTE1 | MY_DEFAULT_PRIMARY_DNS_BYTE2 << 8ul |
+            MY_DEFAULT_PRIMARY_DNS_BYTE3 << 16ul | MY_DEFAULT_PRIMARY_DNS_BYTE4 << 24ul;
+    memcpypgm2ram(AppConfig.NetBIOSName, (ROM void *) MY_DEFAULT_HOST_NAME, 16);
+}
+
+int main(void)
+{
+    const char *drain = getenv("TAP_DRAIN_MS");
+    uint32_t drainTicks = (drain != NULL ? strtoul(drain, NULL, 10) : TAP_DRAIN_MS) * (TICK_SECOND / 1000u);
+    uint32_t replayEnd = 0;
+    bool replayDone = false;
+    uint32_t load = getenv("TAP_LOAD_US") != NULL ? strtoul(getenv("TAP_LOAD_US"), NULL, 10) : 0u;
+    uint32_t stall = getenv("TAP_STALL_MS") != NULL ? strtoul(getenv("TAP_STALL_MS"), NULL, 10) : 0u;
+    uint32_t lastStall;
+    bool tftp, udpApp, bsdApp, smtpApp, mdnsApp, uart;
+    uint32_t udpReceived, udpLost;
+    uint32_t start = Microseconds();
+
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+    idleSleep = getenv("TAP_IDLE") != NULL;
+    MPFS_Start = (uint32_t) (uintptr_t) MPFS_Image;
+
+    InitAppConfig();
+    TickInit();
+    MPFSInit();
+    StackInit();
+    // The servers listen before the first frame of a replay, which all
+    // arrives at once
+    StackApplications();
+    StartRadio();
+    tftp = TapTFTPStart();
+    udpApp = TapUDPStart();
+    bsdApp = TapBSDStart();
+    smtpApp = TapSMTPStart();
+    mdnsApp = TapMDNSStart();
+    uart = TapUARTStart();
+    lastStall = TickGet();
+
+    while (!stop)
+    {
+        StackTask();
+        StackApplications();
+        RadioTask();
+        if (udpApp)
+            TapUDPTask();
+        if (bsdApp)
+            TapBSDTask();
+        if (smtpApp)
+            TapSMTPTask();
+        if (mdnsApp)
+            TapMDNSTask();
+        if (load != 0u)
+            Load(load);
+        if (stall != 0u && TickGet() - lastStall >= TAP_STALL_PERIOD)
+        {
+            Load(stall * 1000u);
+            lastStall = TickGet();
+        }
+        if (tftp && TapTFTPTask())
+        {
+            tftp = false;
+            replayDone = true;
+            replayEnd = TickGet();
+        }
+
+        if (!replayDone && MACTapReplayDone())
+        {
+            replayDone = true;
+            replayEnd = TickGet();
+        }
+        if (replayDone && TickGet() - replayEnd >= drainTicks)
+            break;
+    }
+
+    UDPPerformanceGetRxStats(&udpReceived, &udpLost);
+    printf("udp_rx %lu lost %lu\n", (unsigned long) udpReceived, (unsigned long) udpLost);
+    if (udpApp)
+        TapUDPPrint();
+    if (bsdApp)
+        TapBSDPrint();
+    if (smtpApp)
+        TapSMTPPrint();
+    if (mdnsApp)
+        TapMDNSPrint();
+    if (uart)
+        TapUARTPrint();
+    printf("http_get %lu\n", httpGets);
+    printf("tx_dropped %lu\n", (unsigned long) MACTapTxDropped());
+    printf("radio_rx %lu latency_us %lu max %lu\n", radioFrames,
+            radioFrames ? (unsigned long) (radioLatencySum / radioFrames) : 0ul, (unsigned long) radioLatencyMax);
+    printf("cpu_pct %.1f\n", CPUPercent(start));
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+  mDNS responder and lookups of the TAP host target
+
+  Summary:
+    Runs the mDNS responder and the mDNSResolve() lookups of
+    zero_conf_link_multicast_dns.c, for the mDNS checks of tap_check.py.
+
+  Description:
+    With TAP_MDNS_APP set, the stack takes MDNS_APP_HOST_NAME.local and
+    registers the MDNS_APP_SERVICE_NAME web service, like the demo
+    applications, and main.c calls mDNSProcess() on every pass.  When
+    TAP_MDNS_APP holds host names separated by commas, they are looked up
+    in turn, one every MDNS_APP_LOOKUP, as an application cycling through
+    its peers would, from MDNS_APP_LOOKUP_START after boot, once the host
+    name is probed and announced.
+
+    On exit, main.c prints:
+
+      mdns_app lookups <mDNSResolve() calls> resolved <calls that returned true>
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+#include "tcpip/zero_conf_link_multicast_dns.h"
+
+#define MDNS_APP_HOST_NAME      "TAPHOST"
+#define MDNS_APP_SERVICE_NAME   "TAP Web"
+
+// Time between two lookups
+#define MDNS_APP_LOOKUP         (TICK_SECOND / 5u)
+
+// Time from boot to the first lookup
+#define MDNS_APP_LOOKUP_START   (4u * TICK_SECOND)
+
+// Host names looked up, and their size with the '\0', MAX_HOST_NAME_SIZE of
+// the responder
+#define MDNS_APP_NAMES          (4u)
+#define MDNS_APP_NAME_SIZE      (32u)
+
+static char names[MDNS_APP_NAMES][MDNS_APP_NAME_SIZE];
+static unsigned int nameCount, next;
+static uint32_t dwLast;
+static unsigned long lookups, resolved;
+
+/*****************************************************************************
+  Function:
+    bool TapMDNSStart(void)
+
+  Summary:
+    Starts the responder and takes the host names to look up from
+    TAP_MDNS_APP.
+
+  Returns:
+    true if TAP_MDNS_APP is set, false otherwise
+ ***************************************************************************/
+bool TapMDNSStart(void)
+{
+    const char *asked = getenv("TAP_MDNS_APP");
+    const char *comma;
+    size_t length;
+
+    if (asked == NULL)
+        return false;
+    while (*asked != '\0' && nameCount < MDNS_APP_NAMES)
+    {
+        comma = strchr(asked, ',');
+        length = comma != NULL ? (size_t) (comma - asked) : strlen(asked);
+        if (length != 0u && length < MDNS_APP_NAME_SIZE)
+        {
+            memcpy(names[nameCount], asked, length);
+            names[nameCount++][length] = '\0';
+        }
+        asked += length + (comma != NULL);
+    }
+
+    mDNSInitialize(MDNS_APP_HOST_NAME);
+    mDNSServiceRegister(MDNS_APP_SERVICE_NAME, "_http._tcp.local", HTTP_PORT,
+            (const uint8_t *) "path=/index.htm", 1, NULL, NULL);
+    mDNSMulticastFilterRegister();
+    dwLast = TickGet() - MDNS_APP_LOOKUP + MDNS_APP_LOOKUP_START;
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    void TapMDNSTask(void)
+
+  Summary:
+    Runs the responder and the lookups, called by main.c after
+    StackApplications().
+ ***************************************************************************/
+void TapMDNSTask(void)
+{
+    IP_ADDR ip;
+
+    mDNSProcess();
+    if (nameCount == 0u || TickGet() - dwLast < MDNS_APP_LOOKUP)
+        return;
+    dwLast = TickGet();
+    lookups++;
+    if (mDNSResolve(names[next], &ip))
+        resolved++;
+    next = (next + 1u) % nameCount;
+}
+
+/*****************************************************************************
+  Function:
+    void TapMDNSPrint(void)
+
+  Summary:
+    Prints the lookup counters for tap_check.py.
+ ***************************************************************************/
+void TapMDNSPrint(void)
+{
+    printf("mdns_app lookups %lu resolved %lu\n", lookups, resolved);
+}
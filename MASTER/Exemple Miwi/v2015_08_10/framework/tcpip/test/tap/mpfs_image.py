@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+#
+# Builds the MPFS2 image of the TAP host target from a web directory, with
+# the layout of utilities/mpfs2/mpfs2.jar, so that the tests run without a
+# Java runtime:
+#
+#   mpfs_image.py <web dir> <mpfs_image.c> <http_print.h>
+#
+# - .htm, .xml, .cgi, .js and .inc files get an index of their ~dynamic~
+#   variables, the variables are numbered in their order of appearance;
+# - the files are sorted by name hash, each index staying after its file,
+#   so that MPFSOpen() binary searches them;
+# - .css, .js and .gif files carry a Cache-Control max-age (MPFS2_FLAG_MAXAGE).
+#
+# ~inc:file~ and GZIP compression are not supported.
+
+import os
+import re
+import struct
+import sys
+
+DYNAMIC_TYPES = ('.htm', '.html', '.xml', '.cgi', '.js', '.inc')
+MAX_AGE = {'.css': 3600, '.js': 3600, '.gif': 86400}
+FLAG_HASINDEX = 0x0002
+FLAG_MAXAGE = 0x0004
+TIMESTAMP = 0x5f000000      # Fixed, the image is the same on every build
+VARIABLE = re.compile(rb'~([A-Za-z0-9_]{0,40})~')
+
+
+def name_hash(name):
+    h = 0
+    for c in name.encode():
+        h = ((h + c) << 1) & 0xffff
+    return h
+
+
+def main(web, image_c, print_h):
+    variables = []
+    groups = []     # [(name, data, flags, maxAge)], an index after its file
+    for name in sorted(os.listdir(web)):
+        data = open(os.path.join(web, name), 'rb').read()
+        ext = os.path.splitext(name)[1]
+        flags, age = 0, MAX_AGE.get(ext, 0)
+        if ext in MAX_AGE:
+            flags |= FLAG_MAXAGE
+        index = b''
+        if ext in DYNAMIC_TYPES:
+            for m in VARIABLE.finditer(data):
+                v = m.group(1).decode()
+                if v not in variables:
+                    variables.append(v)
+                index += struct.pack('<II', m.start(), variables.index(v))
+        if index:
+            groups.append([(name, data, flags | FLAG_HASINDEX, age), ('', index, 0, 0)])
+        else:
+            groups.append([(name, data, flags, age)])
+    groups.sort(key=lambda g: name_hash(g[0][0]))
+    files = [f for g in groups for f in g]
+
+    hashes = []
+    for name, _, _, _ in files:
+        hashes.append(name_hash(name) if name else hashes[-1])
+    header = b'MPFS\x02\x01' + struct.pack('<H', len(files))
+    pos = len(header) + 2 * len(files) + 22 * len(files)
+    strings, stringPtr = b'', []
+    for name, _, _, _ in files:
+        stringPtr.append(pos + len(strings))
+        strings += name.encode() + b'\0'
+    pos += len(strings)
+    fat, data = b'', b''
+    for i, (name, d, flags, age) in enumerate(files):
+        fat += struct.pack('<IIIIIH', stringPtr[i], pos + len(data), len(d), TIMESTAMP, age, flags)
+        data += d
+    image = header + b''.join(struct.pack('<H', h) for h in hashes) + fat + strings + data
+
+    with open(image_c, 'w') as f:
+        f.write('// Generated by mpfs_image.py from %s, do not edit\n' % os.path.basename(os.path.normpath(web)))
+        f.write('#include <stdint.h>\n\nconst uint8_t MPFS_Image[%d] =\n{\n' % len(image))
+        for i in range(0, len(image), 16):
+            f.write('    ' + ', '.join('0x%02x' % b for b in image[i:i + 16]) + ',\n')
+        f.write('};\n')
+
+    with open(print_h, 'w') as f:
+        f.write('// Generated by mpfs_image.py from %s, do not edit\n\n' % os.path.basename(os.path.normpath(web)))
+        f.write('#ifndef __HTTPPRINT_H_\n#define __HTTPPRINT_H_\n\n#include "tcpip/tcpip.h"\n\n')
+        f.write('#if defined(STACK_USE_HTTP2_SERVER)\n\n')
+        f.write('extern HTTP_STUB httpStubs[MAX_HTTP_CONNECTIONS];\nextern uint8_t curHTTPID;\n\n')
+        f.write('void HTTPPrint(uint32_t callbackID);\n')
+        for v in variables:
+            if v:
+                f.write('void HTTPPrint_%s(void);\n' % v)
+        f.write('\nvoid HTTPPrint(uint32_t callbackID)\n{\n    switch (callbackID)\n    {\n')
+        for i, v in enumerate(variables):
+            if v:
+                f.write('        case 0x%08x:\n            HTTPPrint_%s();\n            break;\n' % (i, v))
+            else:
+                f.write("        case 0x%08x:\n            TCPPut(sktHTTP, '~');\n            break;\n" % i)
+        f.write('        default:\n            // Output notification for undefined values\n')
+        f.write('            TCPPutROMArray(sktHTTP, (ROM uint8_t*)"!DEF", 4);\n    }\n}\n\n')
+        f.write('#endif\n\n#endif\n')
+    print('%s: %d files, %d bytes, %d variables' % (image_c, len(files), len(image), len(variables)))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 4:
+        sys.exit('usage: mpfs_image.py <web dir> <mpfs_image.c> <http_print.h>')
+    main(*sys.argv[1:])
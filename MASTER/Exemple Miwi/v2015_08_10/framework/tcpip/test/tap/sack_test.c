@@ -0,0 +1,157 @@
+/*******************************************************************************
+  SACK scoreboard and retransmission timeout tests of the TAP host target
+
+  Summary:
+    Runs AddSACKBlock(), UpdateRTT() and GetRTO() of tcp.c on MyTCB.
+
+  Description:
+    tcp.c is included, like in tcb_test.c, to reach its static functions.
+    - AddSACKBlock(): blocks that are empty, already acknowledged or above
+      the data sent are ignored, a block is clipped to the unacknowledged
+      tail, blocks are kept in order, overlapping and touching blocks are
+      merged into one, the highest block is dropped from a full scoreboard,
+      and all of it across the wrap of the sequence numbers.
+    - UpdateRTT() and GetRTO(): the first measurement, a second one by the
+      RFC 6298 formulas, convergence to TCP_MIN_RTO, the TCP_MAX_RTO limit.
+
+    The fast recovery that uses the scoreboard is checked end to end by
+    tap_check.py.
+ *******************************************************************************/
+
+#include "../../src/tcp.c"
+
+#include <stdio.h>
+
+APP_CONFIG AppConfig;
+
+static int failures;
+
+/****************************************************************************
+  Stubs of stack_task.c, which would bring in the applications
+ ***************************************************************************/
+
+void StackSignal(STACK_MODULE module, uint8_t events)
+{
+}
+
+void StackSignalSocket(uint8_t hSocket, uint8_t vSocketPurpose, uint8_t events)
+{
+}
+
+void StackSetTimer(STACK_MODULE module, uint32_t dwTime)
+{
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("sack_test: FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Compares the scoreboard with count pairs of left and right edges
+static bool Scoreboard(uint8_t count, const uint32_t *edges)
+{
+    uint8_t i;
+
+    if (MyTCB.vSACKBlocks != count)
+        return false;
+    for (i = 0; i < count; i++)
+    {
+        if (MyTCB.SACKBlocks[i].dwLeft != edges[2 * i] || MyTCB.SACKBlocks[i].dwRight != edges[2 * i + 1])
+            return false;
+    }
+    return true;
+}
+
+#define SCOREBOARD(...)     Scoreboard(sizeof ((uint32_t[]) {__VA_ARGS__}) / 8u, (uint32_t[]) {__VA_ARGS__})
+
+static void TestSACK(uint32_t base)
+{
+    uint32_t una = base + 1000u;
+
+    memset(&MyTCB, 0, sizeof (MyTCB));
+    MyTCB.MySEQ = base + 10000u;
+
+    AddSACKBlock(base + 2000u, base + 2000u, una);
+    AddSACKBlock(base + 3000u, base + 2000u, una);
+    AddSACKBlock(base + 500u, base + 1000u, una);
+    AddSACKBlock(base + 9000u, base + 10001u, una);
+    Check(MyTCB.vSACKBlocks == 0u, "empty, acknowledged or unsent block added");
+
+    AddSACKBlock(base + 900u, base + 1500u, una);
+    Check(SCOREBOARD(base + 1000u, base + 1500u), "block not clipped to the unacknowledged tail");
+
+    AddSACKBlock(base + 5000u, base + 6000u, una);
+    AddSACKBlock(base + 3000u, base + 4000u, una);
+    Check(SCOREBOARD(base + 1000u, base + 1500u, base + 3000u, base + 4000u, base + 5000u, base + 6000u),
+            "blocks not in order");
+
+    AddSACKBlock(base + 8000u, base + 9000u, una);
+    Check(SCOREBOARD(base + 1000u, base + 1500u, base + 3000u, base + 4000u, base + 5000u, base + 6000u),
+            "block above a full scoreboard added");
+
+    AddSACKBlock(base + 2000u, base + 2500u, una);
+    Check(SCOREBOARD(base + 1000u, base + 1500u, base + 2000u, base + 2500u, base + 3000u, base + 4000u),
+            "highest block not dropped from a full scoreboard");
+
+    AddSACKBlock(base + 1500u, base + 2000u, una);
+    Check(SCOREBOARD(base + 1000u, base + 2500u, base + 3000u, base + 4000u), "touching blocks not merged");
+
+    AddSACKBlock(base + 1200u, base + 1300u, una);
+    Check(SCOREBOARD(base + 1000u, base + 2500u, base + 3000u, base + 4000u), "block inside another one changed it");
+
+    AddSACKBlock(base + 2400u, base + 3100u, una);
+    Check(SCOREBOARD(base + 1000u, base + 4000u), "overlapping blocks not merged");
+
+    AddSACKBlock(base + 6000u, base + 7000u, una);
+    AddSACKBlock(base + 8000u, base + 9000u, una);
+    AddSACKBlock(base + 4500u, base + 9500u, una);
+    Check(SCOREBOARD(base + 1000u, base + 4000u, base + 4500u, base + 9500u), "block over several ones not merged");
+}
+
+static void TestRTO(void)
+{
+    int i;
+
+    memset(&MyTCB, 0, sizeof (MyTCB));
+    Check(GetRTO() == TCP_START_TIMEOUT_VAL, "RTO before the first measurement");
+
+    UpdateRTT(TICK_SECOND / 10u);
+    Check(MyTCB.dwSRTT == 8u * (TICK_SECOND / 10u) && MyTCB.dwRTTVar == 2u * (TICK_SECOND / 10u) &&
+            GetRTO() == 3u * (TICK_SECOND / 10u), "first measurement: SRTT = RTT, RTTVAR = RTT/2");
+
+    // SRTT = 7/8 * 100 ms + 1/8 * 300 ms, RTTVAR = 3/4 * 50 ms + 1/4 * 200 ms
+    UpdateRTT(3u * (TICK_SECOND / 10u));
+    Check(MyTCB.dwSRTT == 8u * (TICK_SECOND / 8u) && MyTCB.dwRTTVar == 4u * (TICK_SECOND * 7u / 80u) &&
+            GetRTO() == TICK_SECOND / 8u + 4u * (TICK_SECOND * 7u / 80u), "second measurement");
+
+    for (i = 0; i < 200; i++)
+        UpdateRTT(TICK_SECOND / 100u);
+    Check(GetRTO() == TCP_MIN_RTO, "RTO of a steady 10 ms RTT not TCP_MIN_RTO");
+
+    memset(&MyTCB, 0, sizeof (MyTCB));
+    UpdateRTT(TCP_MAX_RTO);
+    Check(GetRTO() == TCP_MAX_RTO, "RTO above TCP_MAX_RTO");
+
+    memset(&MyTCB, 0, sizeof (MyTCB));
+    UpdateRTT(0);
+    Check(MyTCB.dwSRTT == 8u, "RTT of 0 not counted as 1 tick");
+}
+
+int main(void)
+{
+    TestSACK(0);
+    TestSACK(0xFFFFFFFFul - 3000u);
+    TestRTO();
+
+    printf("sack_test: TCP_SACK_BLOCKS %u: %s\n", (unsigned) TCP_SACK_BLOCKS,
+            failures ? "FAILED" : "scoreboard, merges, wrap and RTO passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/*******************************************************************************
+  SMTP alerts of the TAP host target
+
+  Summary:
+    Queues messages with the SMTP client of smtp.c, for the SMTP checks of
+    tap_check.py, where the peer is the server.
+
+  Description:
+    With TAP_SMTP_APP=<messages>, SMTPSendMail() queues that many messages,
+    up to SMTP_QUEUE_SIZE, for the server on the gateway, 192.168.10.1, at
+    TAP_SMTP_START after boot like the TFTP transfers of tftp_app.c.  Each
+    message goes to two To recipients and one CC recipient, and has a body
+    line starting with a dot:
+
+      Alarm <n> raised
+      .leading dot
+      end
+
+    Once SMTPIsBusy() returns false, SMTPEndUsage() gives the result, and
+    on exit main.c prints:
+
+      smtp_app queued <messages> code <SMTPEndUsage() result>
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#define SMTP_SERVER     "192.168.10.1"
+
+// Time from boot to the first message
+#define TAP_SMTP_START  (TICK_SECOND)
+
+typedef enum
+{
+    SM_SMTP_APP_IDLE = 0,
+    SM_SMTP_APP_START,
+    SM_SMTP_APP_SEND,
+    SM_SMTP_APP_DONE
+} SM_SMTP_APP;
+
+static SM_SMTP_APP smSMTP;
+static uint32_t dwBoot;
+static unsigned int messages, queued;
+static uint16_t code = 0xFFFF;
+static char bodies[SMTP_QUEUE_SIZE][48];
+
+static void Fill(unsigned int n)
+{
+    SMTPClient.Server.szRAM = (uint8_t *) SMTP_SERVER;
+    SMTPClient.From.szRAM = (uint8_t *) "\"Board\" <board@dev.local>";
+    SMTPClient.To.szRAM = (uint8_t *) "ops1@site.local, \"Ops 2\" <ops2@site.local>";
+    SMTPClient.CC.szRAM = (uint8_t *) "oncall@site.local";
+    SMTPClient.Subject.szRAM = (uint8_t *) "Alarm";
+    snprintf(bodies[n], sizeof (bodies[n]), "Alarm %u raised\r\n.leading dot\r\nend", n + 1u);
+    SMTPClient.Body.szRAM = (uint8_t *) bodies[n];
+}
+
+/*****************************************************************************
+  Function:
+    bool TapSMTPStart(void)
+
+  Summary:
+    Takes the messages to send from TAP_SMTP_APP.
+
+  Returns:
+    true if TAP_SMTP_APP is set, false otherwise
+ ***************************************************************************/
+bool TapSMTPStart(void)
+{
+    const char *asked = getenv("TAP_SMTP_APP");
+
+    if (asked == NULL)
+        return false;
+    messages = strtoul(asked, NULL, 10);
+    if (messages == 0u || messages > SMTP_QUEUE_SIZE)
+        messages = SMTP_QUEUE_SIZE;
+    dwBoot = TickGet();
+    smSMTP = SM_SMTP_APP_START;
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    void TapSMTPTask(void)
+
+  Summary:
+    Queues the messages and waits for the client, called by main.c after
+    StackApplications().
+ ***************************************************************************/
+void TapSMTPTask(void)
+{
+    switch (smSMTP)
+    {
+        case SM_SMTP_APP_START:
+            if (TickGet() - dwBoot < TAP_SMTP_START || !SMTPBeginUsage())
+                break;
+            smSMTP = SM_SMTP_APP_SEND;
+            // No break
+
+        case SM_SMTP_APP_SEND:
+            // All of them fit in the queue, they go over one connection
+            while (queued < messages)
+            {
+                Fill(queued);
+                if (!SMTPSendMail())
+                    break;
+                queued++;
+            }
+            if (SMTPIsBusy())
+                break;
+            code = SMTPEndUsage();
+            smSMTP = SM_SMTP_APP_DONE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*****************************************************************************
+  Function:
+    void TapSMTPPrint(void)
+
+  Summary:
+    Prints the result for tap_check.py.
+ ***************************************************************************/
+void TapSMTPPrint(void)
+{
+    printf("smtp_app queued %u code %u\n", queued, (unsigned int) code);
+}
@@ -0,0 +1,235 @@
+/*******************************************************************************
+  Host configuration of the stack on a Linux TAP device
+
+  Summary:
+    Runs the unmodified stack as a Linux process, see
+    framework/tcpip/src/linux_tap.h.
+
+  Description:
+    TCP, UDP, ICMP, the HTTP2 server with its MPFS2 image in memory, the
+    TCP and UDP performance tests, the TFTP and DNS clients for the
+    transfers of tftp_app.c, and the Berkeley API for the echo server of
+    berkeley_app.c.  The address is static: 192.168.10.2/24,
+    the peer (tap0 or the scripted peer of tap_peer.py) is 192.168.10.1.
+ *******************************************************************************/
+
+#ifndef __TAP_SYSTEM_CONFIG_H_
+#define __TAP_SYSTEM_CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PTR_BASE            uintptr_t
+#define ROM_PTR_BASE        uintptr_t
+#define ROM                 const
+#define memcpypgm2ram       memcpy
+#define memcmppgm2ram       memcmp
+#define strcmppgm2ram       strcmp
+#define strcpypgm2ram       strcpy
+#define strlenpgm           strlen
+#define strchrpgm           strchr
+#define strstrrampgm        strstr
+
+// A 40 MHz PIC32, so that the baud rate generator of uart_to_tcp_bridge.c
+// gets within 2 % of its BAUD_RATE
+#define SYS_CLK_FrequencySystemGet()        40000000ul
+#define SYS_CLK_FrequencyInstructionGet()   40000000ul
+#define SYS_CLK_FrequencyPeripheralGet()    40000000ul
+
+// helpers.h maps ultoa() to the 3 parameter stdlib function of XC16 and XC32,
+// which glibc lacks: main.c defines it
+char *ultoa(char *buf, unsigned long val, int radix);
+
+// Idle hook of StackApplications(): main.c sleeps in it when the TAP_IDLE
+// environment variable is set
+void TapIdle(uint32_t ticks);
+#define STACK_IDLE_HOOK(ticks)  TapIdle(ticks)
+
+// Overridden by the TAP_INTERFACE, TAP_PCAP_INPUT and TAP_PCAP_OUTPUT
+// environment variables
+#define TAP_INTERFACE       "tap0"
+
+// UART2 of a PIC32 for uart_to_tcp_bridge.c, emulated on a pty by
+// uart_emu.c, with its RTS output and CTS input wired
+typedef struct
+{
+    volatile unsigned int U2RXIE, U2TXIE;
+} TAP_IEC1BITS;
+typedef struct
+{
+    volatile unsigned int U2RXIF, U2TXIF;
+} TAP_IFS1BITS;
+typedef struct
+{
+    volatile unsigned int OERR, URXDA, UTXBF;
+} TAP_U2STABITS;
+typedef struct
+{
+    volatile unsigned int U2IP;
+} TAP_IPC8BITS;
+extern TAP_IEC1BITS IEC1bits;
+extern TAP_IFS1BITS IFS1bits;
+extern TAP_U2STABITS U2STAbits;
+extern TAP_IPC8BITS IPC8bits;
+extern volatile uint32_t UMODE, USTA, UBRG;
+extern volatile uint8_t TapUARTTXTris, TapUARTRXTris;
+extern volatile uint8_t TapUARTRTS, TapUARTRTSTris, TapUARTCTS, TapUARTCTSTris;
+uint8_t TapUARTRead(void);
+volatile uint8_t *TapUARTWrite(void);
+#define U2RXREG             TapUARTRead()
+#define U2TXREG             (*TapUARTWrite())
+#define UARTTX_TRIS         TapUARTTXTris
+#define UARTRX_TRIS         TapUARTRXTris
+#define UARTRTS_IO          TapUARTRTS
+#define UARTRTS_TRIS        TapUARTRTSTris
+#define UARTCTS_IO          TapUARTCTS
+#define UARTCTS_TRIS        TapUARTCTSTris
+
+// Not pressed: the UDP performance test only sends its 1024 datagrams at
+// startup
+#define BUTTON3_IO          (1)
+
+#define STACK_USE_ICMP_SERVER
+#define STACK_USE_HTTP2_SERVER
+#define STACK_USE_TCP_PERFORMANCE_TEST
+#define STACK_USE_UDP_PERFORMANCE_TEST
+#define STACK_USE_TFTP_CLIENT
+#define STACK_USE_DNS_CLIENT
+#define STACK_USE_BERKELEY_API
+#define STACK_USE_SMTP_CLIENT
+#define STACK_USE_UART2TCP_BRIDGE
+#define STACK_USE_ZEROCONF_MDNS_SD
+
+#define STACK_USE_MPFS2
+#define MAX_MPFS_HANDLES    (2u * MAX_HTTP_CONNECTIONS + 2u)
+
+#define MY_DEFAULT_HOST_NAME    "TAPHOST         "
+
+#define MY_DEFAULT_MAC_BYTE1    (0x00)
+#define MY_DEFAULT_MAC_BYTE2    (0x04)
+#define MY_DEFAULT_MAC_BYTE3    (0xA3)
+#define MY_DEFAULT_MAC_BYTE4    (0x00)
+#define MY_DEFAULT_MAC_BYTE5    (0x00)
+#define MY_DEFAULT_MAC_BYTE6    (0x02)
+
+#define MY_DEFAULT_IP_ADDR_BYTE1        (192ul)
+#define MY_DEFAULT_IP_ADDR_BYTE2        (168ul)
+#define MY_DEFAULT_IP_ADDR_BYTE3        (10ul)
+#define MY_DEFAULT_IP_ADDR_BYTE4        (2ul)
+
+#define MY_DEFAULT_MASK_BYTE1           (255ul)
+#define MY_DEFAULT_MASK_BYTE2           (255ul)
+#define MY_DEFAULT_MASK_BYTE3           (255ul)
+#define MY_DEFAULT_MASK_BYTE4           (0ul)
+
+#define MY_DEFAULT_GATE_BYTE1           (192ul)
+#define MY_DEFAULT_GATE_BYTE2           (168ul)
+#define MY_DEFAULT_GATE_BYTE3           (10ul)
+#define MY_DEFAULT_GATE_BYTE4           (1ul)
+
+#define MY_DEFAULT_PRIMARY_DNS_BYTE1    (192ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE2    (168ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE3    (10ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE4    (1ul)
+
+#define MY_DEFAULT_SECONDARY_DNS_BYTE1  (0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE2  (0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE3  (0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE4  (0ul)
+
+#define STACK_USE_TCP
+#define STACK_USE_UDP
+#define TCP_ETH_RAM_SIZE            (16000ul)
+#define TCP_PIC_RAM_SIZE            (12000ul)
+#define TCP_SPI_RAM_SIZE            (0ul)
+#define TCP_SPI_RAM_BASE_ADDRESS    (0)
+
+#define TCP_PURPOSE_GENERIC_TCP_CLIENT  0
+#define TCP_PURPOSE_GENERIC_TCP_SERVER  1
+#define TCP_PURPOSE_TCP_PERFORMANCE_TX  2
+#define TCP_PURPOSE_TCP_PERFORMANCE_RX  3
+#define TCP_PURPOSE_HTTP_SERVER         4
+#define TCP_PURPOSE_DEFAULT             5
+#define TCP_PURPOSE_BERKELEY_SERVER     6
+#define TCP_PURPOSE_BERKELEY_CLIENT     7
+#define TCP_PURPOSE_UART_2_TCP_BRIDGE   8
+
+// The TX FIFO of the TCP performance TX test holds 11 segments of 536 bytes:
+// enough for the 3 duplicate ACKs of fast retransmit with two segments lost.
+// The Berkeley sockets and the UART bridge live in PIC RAM, 32 * (sizeof (TCB)
+// + 202) + sizeof (TCB) + 2002 bytes with the TCB of a 64 bit host, so that
+// the MAC RX buffer keeps its size.
+#if defined(__TCP_C_)
+#define TCP_CONFIGURATION
+ROM struct
+{
+    uint8_t vSocketPurpose;
+    uint8_t vMemoryMedium;
+    uint16_t wTXBufferSize;
+    uint16_t wRXBufferSize;
+} TCPSocketInitializer[] =
+{
+    {TCP_PURPOSE_GENERIC_TCP_CLIENT, TCP_ETH_RAM, 125, 100},
+    {TCP_PURPOSE_DEFAULT, TCP_ETH_RAM, 1000, 1000},
+    {TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_ETH_RAM, 6000, 1},
+    {TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_ETH_RAM, 40, 2000},
+    {TCP_PURPOSE_HTTP_SERVER, TCP_ETH_RAM, 1000, 1000},
+    {TCP_PURPOSE_HTTP_SERVER, TCP_ETH_RAM, 1000, 1000},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 100, 100},
+    {TCP_PURPOSE_UART_2_TCP_BRIDGE, TCP_PIC_RAM, 1000, 1000},
+};
+#define END_OF_TCP_SOCKET_TYPES
+#endif
+
+// The listening socket of berkeley_app.c and its 32 connections, one
+// TCP_PURPOSE_BERKELEY_SERVER socket each, so that the BSDFdSet of
+// BerkeleySelect() spans two words
+#define BSD_SOCKET_COUNT    (33u)
+
+#define MAX_UDP_SOCKETS     (6u)
+#define UDP_USE_TX_CHECKSUM
+
+#define MAX_HTTP_CONNECTIONS    (2u)
+#define HTTP_PORT               (80u)
+#define HTTPS_PORT              (443u)
+#define HTTP_MAX_DATA_LEN       (100u)
+#define HTTP_MIN_CALLBACK_FREE  (16u)
+#define HTTP_CACHE_LEN          ("600")
+#define HTTP_TIMEOUT            (45u)
+#define HTTP_DEFAULT_FILE       "index.htm"
+#define HTTPS_DEFAULT_FILE      "index.htm"
+#define HTTP_DEFAULT_LEN        (10u)
+
+#endif
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+#
+# make bench of the TAP host target, through the kernel TCP of the host:
+#
+#   tap_bench.py ./tap_stack <tap device> <seconds> [loss %]...
+#
+# Run as root: the device is created if needed and given 192.168.10.1/24.
+# Each test runs for the given number of seconds:
+# - TCP performance TX (port 9762): bytes per second received by the host;
+# - TCP performance RX (port 9763): bytes per second sent by the host;
+# - HTTP: GET /style.css per second, one connection per request, then
+#   requests on one keep-alive connection;
+# - HTTP page load: index.htm (dynamic, chunked), style.css and layout.css
+#   per second on one keep-alive connection, one request at a time, then
+#   the three requests pipelined, directly and with the TX delay line of
+#   linux_tap.c set to PAGE_LINK;
+# - UDP receive: UDP_RX_COUNT datagrams of 256 bytes with their counter,
+#   sent to the performance test port at each of UDP_RX_RATES per second,
+#   with TAP_LOAD_US of application work after each pass of the loop and
+#   UDP_RX_QUEUE frames in the kernel queue of the device, which stands for
+#   the buffer of a NIC: datagrams received and lost;
+# - TFTP: a 256 KB read and write of tftp_app.c with tftp_server.py, with
+#   the blksize and windowsize options then without (512 byte blocks, one
+#   ACK each), directly and through the TX delay line with TFTP_LINKS.  The
+#   data is checked on both sides;
+# - Berkeley sockets: round trips of 16 bytes per second on one connection
+#   of the echo server of berkeley_app.c (port 7000), with BSD_CONNECTIONS
+#   connections open and the others idle, for each way of finding the
+#   sockets ready (select, poll, recv on every socket), and the passes of
+#   the main loop per second;
+# - radio: the RX latency of the radio interrupt of main.c, every RADIO_MS,
+#   and the CPU share of tap_stack, with the stack idle then under HTTP
+#   load (keep-alive requests), with the loop spinning then sleeping in the
+#   idle hook (TAP_IDLE);
+# - for each loss percentage, TCP performance TX again through the TX delay
+#   line of linux_tap.c: LOSS_LINK delay and rate, and that share of the
+#   frames of the stack dropped (TAP_TX_LOSS).  The frames dropped include the
+#   ones of the boot burst of the UDP performance test that overflow the
+#   queue of the link.
+
+import os
+import random
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+STACK = ('192.168.10.2', 80)
+LOSS_LINK = {'TAP_TX_DELAY_MS': '20', 'TAP_TX_RATE_KBPS': '2000'}
+PAGE_LINK = {'TAP_TX_DELAY_MS': '10'}
+RADIO_MS = '10'
+UDP_RX_COUNT = 4000
+UDP_RX_RATES = (500, 1000, 2000, 4000)
+UDP_RX_LOAD_US = '1000'
+UDP_RX_QUEUE = '64'
+TFTP_LINKS = ({}, {'TAP_TX_DELAY_MS': '2'}, {'TAP_TX_DELAY_MS': '10'},
+              {'TAP_TX_DELAY_MS': '10', 'TAP_TX_LOSS': '1'})
+TFTP_BYTES = 262144
+BSD_CONNECTIONS = (1, 8, 32)
+
+
+def ip(*args):
+    return subprocess.run(['ip'] + list(args), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL).returncode
+
+
+def setup(tap):
+    if ip('link', 'show', tap) != 0 and ip('tuntap', 'add', 'dev', tap, 'mode', 'tap') != 0:
+        sys.exit('tap_bench: cannot create %s, run as root' % tap)
+    ip('addr', 'replace', '192.168.10.1/24', 'dev', tap)
+    ip('link', 'set', tap, 'up')
+
+
+def connect(port, timeout=5):
+    end = time.time() + timeout
+    while True:
+        try:
+            s = socket.create_connection((STACK[0], port), timeout=2)
+            s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            return s
+        except OSError:
+            if time.time() > end:
+                raise
+            time.sleep(0.1)
+
+
+def tcp_tx(seconds):
+    s = connect(9762)
+    total, end = 0, time.time() + seconds
+    while time.time() < end:
+        total += len(s.recv(65536))
+    s.close()
+    return total / seconds
+
+
+def tcp_rx(seconds):
+    s = connect(9763)
+    data = bytes(8192)
+    total, end = 0, time.time() + seconds
+    while time.time() < end:
+        total += s.send(data)
+    s.close()
+    return total / seconds
+
+
+def receive(s, buf, size):
+    while len(buf) < size:
+        d = s.recv(65536)
+        if not d:
+            raise EOFError
+        buf += d
+    return buf
+
+
+def response(s, buf):
+    while b'\r\n\r\n' not in buf:
+        buf = receive(s, buf, len(buf) + 1)
+    head, _, buf = buf.partition(b'\r\n\r\n')
+    if b'content-length:' in head.lower():
+        length = int(head.lower().split(b'content-length:')[1].split(b'\r\n')[0])
+        return receive(s, buf, length)[length:]
+    # Chunked: size line, data and CRLF until the last chunk of size 0
+    while True:
+        while b'\r\n' not in buf:
+            buf = receive(s, buf, len(buf) + 1)
+        line, _, buf = buf.partition(b'\r\n')
+        size = int(line, 16) + 2
+        buf = receive(s, buf, size)[size:]
+        if size == 2:
+            return buf
+
+
+def http(seconds, keepAlive):
+    request = b'GET /style.css HTTP/1.1\r\nHost: 192.168.10.2\r\n\r\n'
+    count, end = 0, time.time() + seconds
+    s = connect(80) if keepAlive else None
+    buf = b''
+    while time.time() < end:
+        if not keepAlive:
+            s = connect(80)
+        s.sendall(request)
+        buf = response(s, buf)
+        if not keepAlive:
+            s.close()
+        count += 1
+    if keepAlive:
+        s.close()
+    return count / seconds
+
+
+def page_load(seconds, pipelined):
+    requests = [b'GET /' + path + b' HTTP/1.1\r\nHost: 192.168.10.2\r\n\r\n'
+                for path in (b'', b'style.css', b'layout.css')]
+    count, end = 0, time.time() + seconds
+    s = connect(80)
+    buf = b''
+    while time.time() < end:
+        if pipelined:
+            s.sendall(b''.join(requests))
+            for _ in requests:
+                buf = response(s, buf)
+        else:
+            for request in requests:
+                s.sendall(request)
+                buf = response(s, buf)
+        count += 1
+    s.close()
+    return count / seconds
+
+
+def delayed_page_load(stack, tap, seconds):
+    process = subprocess.Popen([stack], env=dict(PAGE_LINK, TAP_INTERFACE=tap), stdout=subprocess.DEVNULL)
+    try:
+        time.sleep(2)
+        for pipelined in (False, True):
+            print('tap_bench: HTTP %.1f pages/s, %s, %s ms' % (page_load(seconds, pipelined),
+                  'pipelined' if pipelined else 'keep-alive', PAGE_LINK['TAP_TX_DELAY_MS']))
+    finally:
+        process.terminate()
+        process.wait()
+
+
+def radio(stack, tap, seconds, load, idle):
+    env = {'TAP_INTERFACE': tap, 'TAP_RADIO_MS': RADIO_MS}
+    if idle:
+        env['TAP_IDLE'] = '1'
+    process = subprocess.Popen([stack], env=env, stdout=subprocess.PIPE)
+    try:
+        time.sleep(2)
+        if load:
+            rate = '%.0f requests/s' % http(seconds, True)
+        else:
+            time.sleep(seconds)
+            rate = 'idle'
+    finally:
+        process.terminate()
+        out = process.communicate()[0].decode().split()
+    print('tap_bench: radio RX latency %s us, max %s us, CPU %s %%, %s, %s' %
+          (out[out.index('latency_us') + 1], out[out.index('max') + 1], out[out.index('cpu_pct') + 1], rate,
+           'idle hook sleeping' if idle else 'loop spinning'))
+
+
+def udp_rx(stack, tap, rate):
+    with open('/sys/class/net/%s/tx_queue_len' % tap) as f:
+        queue = f.read().strip()
+    ip('link', 'set', tap, 'txqueuelen', UDP_RX_QUEUE)
+    process = subprocess.Popen([stack], env={'TAP_INTERFACE': tap, 'TAP_LOAD_US': UDP_RX_LOAD_US},
+                               stdout=subprocess.PIPE)
+    try:
+        # After the 1024 datagrams that the UDP performance test sends at boot
+        time.sleep(2)
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        padding = b'x' * 252
+        start = time.perf_counter()
+        for n in range(1, UDP_RX_COUNT + 1):
+            while time.perf_counter() < start + n / rate:
+                pass
+            s.sendto(struct.pack('<I', n) + padding, (STACK[0], 9))
+        time.sleep(0.5)
+        s.close()
+    finally:
+        process.terminate()
+        out = process.communicate()[0].decode().split()
+        ip('link', 'set', tap, 'txqueuelen', queue)
+    print('tap_bench: UDP receive %s of %d datagrams, %s lost, %d/s, %s us of load' %
+          (out[out.index('udp_rx') + 1], UDP_RX_COUNT, out[out.index('lost') + 1], rate, UDP_RX_LOAD_US))
+
+
+def berkeley(stack, tap, seconds, mode, count):
+    process = subprocess.Popen([stack], env={'TAP_INTERFACE': tap, 'TAP_BSD_APP': mode}, stdout=subprocess.PIPE)
+    launch = time.time()
+    try:
+        time.sleep(2)
+        conns = [connect(7000) for _ in range(count)]
+        data = b'0123456789abcdef'
+        rounds = 0
+        start = time.time()
+        while time.time() - start < seconds:
+            conns[0].sendall(data)
+            echo = b''
+            while len(echo) < len(data):
+                echo += conns[0].recv(len(data) - len(echo))
+            rounds += 1
+        elapsed = time.time() - start
+        for c in conns:
+            c.close()
+    finally:
+        process.terminate()
+        out = process.communicate()[0].decode().split()
+        # The loop passes over the life of the process
+        life = time.time() - launch
+    print('tap_bench: Berkeley %s, %d connections: %.0f round trips/s, %.0f passes/s' %
+          (mode, count, rounds / elapsed, int(out[out.index('passes') + 1]) / life))
+
+
+def tftp_sum(data):
+    """Sum() of tftp_app.c."""
+    total = 0
+    for c in data:
+        total = (total * 31 + c) & 0xFFFFFFFF
+    return total
+
+
+def tftp(stack, tap, options):
+    directory = tempfile.mkdtemp()
+    data = bytes(random.Random(1).getrandbits(8) for _ in range(TFTP_BYTES))
+    # Pattern() of tftp_app.c
+    pattern = bytes((i * 7 + (i >> 11)) & 0xFF for i in range(TFTP_BYTES))
+    with open(os.path.join(directory, 'get.bin'), 'wb') as f:
+        f.write(data)
+    here = os.path.dirname(os.path.abspath(__file__))
+    server = subprocess.Popen([sys.executable, os.path.join(here, 'tftp_server.py'), directory] +
+                              ([] if options else ['--no-options']), stdout=subprocess.PIPE)
+    try:
+        server.stdout.readline()
+        for link in TFTP_LINKS:
+            for transfer, name, expected in (('GET', 'get.bin', data), ('PUT', 'put.bin', pattern)):
+                env = dict(link, TAP_INTERFACE=tap)
+                env['TAP_TFTP_' + transfer] = name
+                process = subprocess.Popen([stack], env=env, stdout=subprocess.PIPE)
+                try:
+                    out = process.communicate(timeout=120)[0].decode().split('tftp ')[1].split()
+                except subprocess.TimeoutExpired:
+                    process.kill()
+                    process.wait()
+                    out = ['timeout']
+                if out[0] == transfer.lower():
+                    received = expected if transfer == 'GET' else open(os.path.join(directory, name), 'rb').read()
+                    ok = received == expected and int(out[3], 16) == tftp_sum(expected)
+                    result = '%.0f bytes/s%s' % (TFTP_BYTES / float(out[4]), '' if ok else ', DATA DIFFERS')
+                else:
+                    result = 'failed: ' + ' '.join(out)
+                print('tap_bench: TFTP %s %s, %s, %s ms, %s%% loss' %
+                      (transfer, result, 'options' if options else 'no options',
+                       link.get('TAP_TX_DELAY_MS', '0'), link.get('TAP_TX_LOSS', '0')))
+    finally:
+        server.terminate()
+        server.wait()
+
+
+def lossy_tx(stack, tap, seconds, loss):
+    env = dict(LOSS_LINK, TAP_INTERFACE=tap, TAP_TX_LOSS=loss)
+    process = subprocess.Popen([stack], env=env, stdout=subprocess.PIPE)
+    try:
+        # The 1024 datagrams that the UDP performance test sends at boot
+        # fill the queue of the link for about 1 s, and overflow it
+        time.sleep(2)
+        rate = tcp_tx(seconds)
+    finally:
+        process.terminate()
+        dropped = process.communicate()[0].decode().split('tx_dropped ')[1].split()[0]
+    print('tap_bench: TCP performance TX %.0f bytes/s, %s%% loss, %s ms, %s kbit/s, %s frames dropped' %
+          (rate, loss, LOSS_LINK['TAP_TX_DELAY_MS'], LOSS_LINK['TAP_TX_RATE_KBPS'], dropped))
+
+
+def main():
+    stack, tap, seconds = sys.argv[1], sys.argv[2], float(sys.argv[3])
+    setup(tap)
+    process = subprocess.Popen([stack], env={'TAP_INTERFACE': tap}, stdout=subprocess.DEVNULL)
+    try:
+        print('tap_bench: TCP performance TX %.0f bytes/s' % tcp_tx(seconds))
+        print('tap_bench: TCP performance RX %.0f bytes/s' % tcp_rx(seconds))
+        print('tap_bench: HTTP %.0f requests/s, one connection each' % http(seconds, False))
+        print('tap_bench: HTTP %.0f requests/s, keep-alive' % http(seconds, True))
+        print('tap_bench: HTTP %.0f pages/s, keep-alive' % page_load(seconds, False))
+        print('tap_bench: HTTP %.0f pages/s, pipelined' % page_load(seconds, True))
+    finally:
+        process.terminate()
+        process.wait()
+    delayed_page_load(stack, tap, seconds)
+    for rate in UDP_RX_RATES:
+        udp_rx(stack, tap, rate)
+    for options in (True, False):
+        tftp(stack, tap, options)
+    for mode in ('select', 'poll', 'recv'):
+        for count in BSD_CONNECTIONS:
+            berkeley(stack, tap, seconds, mode, count)
+    for idle in (False, True):
+        for load in (False, True):
+            radio(stack, tap, seconds, load, idle)
+    for loss in sys.argv[4:]:
+        lossy_tx(stack, tap, seconds, loss)
+
+
+if __name__ == '__main__':
+    main()
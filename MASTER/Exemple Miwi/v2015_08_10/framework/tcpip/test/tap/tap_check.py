@@ -0,0 +1,775 @@
+#!/usr/bin/env python3
+#
+# make check of the TAP host target:
+#
+#   tap_check.py ./tap_stack
+#
+# - replay of a capture: ARP request, ICMP echo requests, UDP datagrams to
+#   the performance test port with two counters missing; the capture of the
+#   answers must hold the ARP reply, the echo replies with their data, and
+#   the 1024 datagrams that the UDP performance test broadcasts at boot;
+# - UDP RX queue, replay with udp_app.c: datagrams that are never read
+#   come first in the MAC RX buffer, then datagrams held with
+#   UDPGetDatagrams() for longer than UDP_RX_TIMEOUT, then datagrams echoed
+#   and counters of the performance test.  The held ones must keep their
+#   data while the later frames are released before them, the unread ones
+#   must be dropped so that the buffer is reused, and every counter and echo
+#   must get through;
+# - scripted peer (tap_peer.py) on named pipes: TCP performance TX lines,
+#   TCP performance RX report, HTTP GET of a dynamic page with arguments
+#   (HTTPExecuteGet()), of a static file with its Cache-Control max-age,
+#   and of a missing file;
+# - HTTP pipelining on one keep-alive connection: a static file, a static
+#   file larger than the TX FIFO, a dynamic page (chunked) and the first
+#   file with its ETag (304) in its first segment, then the first file again
+#   and a dynamic XML file;
+# - fast recovery: two segments of the TCP performance TX stream are lost,
+#   the duplicate ACKs carry SACK blocks, and the stack must resend these
+#   two segments only;
+# - Berkeley sockets, with BerkeleySelect() then BerkeleyPoll() in
+#   berkeley_app.c: 32 connections echo at once, then one at a time after
+#   an idle gap, so that the sockets of both words of the BSDFdSet must be
+#   found from their hints alone.  A connection that does not acknowledge
+#   the echoes gets its data read in several passes without a new segment,
+#   8 connections closed by the peer must be closed by the application and
+#   accepted again;
+# - SMTP, the peer as the server of the 3 messages of smtp_app.c: with
+#   PIPELINING, MAIL FROM, the RCPT TO of the 3 recipients and DATA of a
+#   message must come in one batch, the next batch before the reply to the
+#   previous message, and the bodies dot-stuffed; without it, one command
+#   per reply.  With the RCPT TO of the second recipient refused, the 354
+#   reply to the DATA of the same batch must be followed by the close of
+#   the connection, without the message, and SMTPEndUsage() must return
+#   the 550 of the refusal;
+# - UART to TCP bridge on the UART of uart_emu.c, a pty at 115200 baud,
+#   with the main loop spinning 20 ms every 100 ms (TAP_STALL_MS): 1 s of
+#   UART bytes must reach the connection of port 9761 intact at line rate,
+#   short lines in less than the auto-transmit timeout, and 1 s of
+#   TCP bytes the UART, without UART overruns.  With 150 ms spins the RX
+#   FIFO of the bridge overflows, and RTS/CTS (TAP_UART_FLOW) must then
+#   keep every byte;
+# - mDNS responder and lookups of mdns_app.c: once the host name and the
+#   service are announced, a PTR question must be answered after the 20-120
+#   ms of a shared record, and not at all with the PTR as known answer, nor
+#   the SRV, TXT and A questions with theirs.  A second SRV question within
+#   1 s must not be answered, one after it must.  Of the 3 names looked up
+#   in turn, the 2 that never answer must be asked after 1, 2, 4... s each,
+#   and the one answered by the peer no more, while its lookups resolve.
+
+import os
+import re
+import struct
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+from tap_peer import *
+
+failures = 0
+
+
+def check(ok, what):
+    global failures
+    if not ok:
+        print('tap_check: FAILED: %s' % what)
+        failures += 1
+
+
+def check_replay(stack):
+    frames = [arp(1, STACK_IP)]
+    pings = [(0x1234, seq, bytes(range(256)) * (size // 256) + b'x' * (size % 256))
+             for seq, size in enumerate((0, 56, 1000, 1472))]
+    frames += [icmp_echo(*p) for p in pings]
+    counters = [n for n in range(1, 51) if n not in (10, 11)]
+    frames += [udp(5000, 9, struct.pack('<I', n) + b'u' * 100) for n in counters]
+
+    out, stdout = run_replay(stack, frames)
+    replies = [f for f in out if f.type == ETH_ARP and f.op == 2]
+    check(len(replies) == 1 and replies[0].senderIP == STACK_IP and replies[0].senderMAC == STACK_MAC
+          and replies[0].targetMAC == PEER_MAC, 'replay: no ARP reply to the request')
+
+    echoes = [f for f in out if f.proto == IP_ICMP and f.icmpType == 0]
+    check([(f.ident, f.seq, f.data) for f in echoes] == pings, 'replay: echo replies missing or not matching')
+    check(all(f.valid and f.dst == PEER_MAC for f in echoes), 'replay: echo reply with a bad checksum or address')
+
+    burst = [f for f in out if f.proto == IP_UDP and f.dport == 9 and f.dst == BROADCAST_MAC]
+    check(len(burst) == 1024 and all(f.valid and len(f.data) == 1024 for f in burst),
+          'replay: %d of the 1024 boot datagrams sent' % len(burst))
+    check([struct.unpack('<I', f.data[:4])[0] for f in burst] == list(range(1, len(burst) + 1)),
+          'replay: boot datagrams out of order')
+    check('udp_rx %d lost 2' % len(counters) in stdout, 'replay: UDP receive counters: ' + stdout.split('\n')[0])
+    print('tap_check: replay: ARP, %d echo replies, %d boot datagrams, %s' %
+          (len(echoes), len(burst), stdout.split('\n')[0]))
+
+
+def held_datagram(n):
+    """Datagram n of UDP_APP_HOLD_PORT: its number, then Pattern() of udp_app.c."""
+    return udp(5000, 5002, struct.pack('<I', n) + bytes((n * 7 + i) & 0xff for i in range(4, 204)))
+
+
+def check_udp_queue(stack):
+    frames, times, echoes = [], [], []
+
+    def send(t, frame):
+        frames.append(frame)
+        times.append(t + len(frames) * 1e-6)
+
+    def counters(t, first, last):
+        for n in range(first, last + 1):
+            send(t, udp(5000, 9, struct.pack('<I', n) + b'u' * 100))
+            if n % 10 == 0:
+                echoes.append(b'echo %d ' % len(echoes) + b'e' * 50)
+                send(t, udp(5000, 7, echoes[-1]))
+
+    send(0, udp(5000, 5001, b'unread 1'))
+    send(0, udp(5000, 5001, b'unread 2'))
+    for n in range(1, 5):
+        send(0, held_datagram(n))
+    counters(0, 1, 40)
+    counters(0.2, 41, 60)
+    for n in range(5, 9):
+        send(1.5, held_datagram(n))
+    send(1.5, udp(5000, 5001, b'unread 3'))
+    counters(1.5, 61, 80)
+
+    try:
+        out, stdout = run_replay(stack, frames, drainMs=2500, times=times, env={'TAP_UDP_APP': '1'})
+    except subprocess.TimeoutExpired:
+        check(False, 'UDP RX queue: the replay stalls, the MAC RX buffer is never freed')
+        return
+    replies = [f.data for f in out if f.proto == IP_UDP and f.sport == 7 and f.dport == 5000 and f.valid]
+    check(replies == echoes, 'UDP RX queue: %d of the %d echoes, or not matching' % (len(replies), len(echoes)))
+    check('udp_app echoed %d held 8 bad 0' % len(echoes) in stdout,
+          'UDP RX queue: held datagrams: ' + stdout.split('udp_app ')[-1].split('\n')[0])
+    check('udp_rx 80 lost 0' in stdout, 'UDP RX queue: counters: ' + stdout.split('\n')[0])
+    print('tap_check: UDP RX queue: %d echoes, 8 datagrams held, unread ones dropped, %s' %
+          (len(replies), stdout.split('\n')[0]))
+
+
+def http_get(peer, sport, path):
+    c = TCPConnection(peer, 80, sport)
+    if not c.connect():
+        return None, b''
+    c.send(b'GET /' + path + b' HTTP/1.1\r\nHost: 192.168.10.2\r\nConnection: close\r\n\r\n')
+    c.close()
+    head, _, body = c.received.partition(b'\r\n\r\n')
+    return head, body
+
+
+def http_response(c, start, timeout=5):
+    """Next response of a persistent connection in c.received: (head, body, end)."""
+    def parse():
+        data = c.received
+        pos = data.find(b'\r\n\r\n', start)
+        if pos < 0:
+            return None
+        head, pos = data[start:pos], pos + 4
+        if head.startswith(b'HTTP/1.1 304'):
+            return head, b'', pos
+        length = re.search(rb'\r\nContent-Length: *([0-9]+)', head, re.I)
+        if length:
+            end = pos + int(length.group(1))
+            return (head, data[pos:end], end) if len(data) >= end else None
+        if not re.search(rb'\r\nTransfer-Encoding: *chunked', head, re.I):
+            return head, None, pos
+        body = b''
+        while True:
+            line = data.find(b'\r\n', pos)
+            if line < 0:
+                return None
+            if not re.fullmatch(rb'[0-9A-Fa-f]+', data[pos:line]):
+                return head, None, line
+            size = int(data[pos:line], 16)
+            end = line + 2 + size + 2
+            if len(data) < end:
+                return None
+            if data[end - 2:end] != b'\r\n':
+                return head, None, end
+            if size == 0:
+                return head, body, end
+            body, pos = body + data[line + 2:end - 2], end
+
+    c.pump(timeout, lambda: parse() is not None)
+    return parse() or (None, None, start)
+
+
+def get_requests(requests):
+    return b''.join(b'GET ' + path + b' HTTP/1.1\r\nHost: 192.168.10.2\r\n' + extra + b'\r\n'
+                    for path, extra in requests)
+
+
+def check_pipelining(peer, etag):
+    style, layout = open('web/style.css', 'rb').read(), open('web/layout.css', 'rb').read()
+    # A small window keeps the TX FIFO full of layout.css while the next
+    # request is parsed, so that its headers have to wait for room
+    c = TCPConnection(peer, 80, 40007, window=256)
+    check(c.connect(), 'HTTP pipelining: no connection')
+
+    # The first segment of the connection: the requests behind the first one
+    # must survive the FIFO adjustment of its response
+    first = [(b'/style.css', b''), (b'/layout.css', b''), (b'/?page=2', b''),
+             (b'/style.css', b'If-None-Match: ' + etag + b'\r\n')]
+    c.send(get_requests(first))
+    responses, end = [], 0
+    for _ in first:
+        head, body, end = http_response(c, end)
+        responses.append((head or b'', body))
+    (static, staticBody), (large, largeBody), (page, pageBody), (cached, _) = responses
+    check(static.startswith(b'HTTP/1.1 200') and b'Connection: close' not in static and staticBody == style,
+          'HTTP pipelining: style.css not served with Content-Length')
+    check(large.startswith(b'HTTP/1.1 200') and largeBody == layout, 'HTTP pipelining: layout.css')
+    check(page.startswith(b'HTTP/1.1 200') and b'chunked' in page and pageBody is not None
+          and b'<title>TAP host target</title>' in pageBody and b'GET requests served: 2<' in pageBody,
+          'HTTP pipelining: dynamic page not chunked or not printed')
+    check(cached.startswith(b'HTTP/1.1 304') and etag in cached and b'Content-Length' not in cached,
+          'HTTP pipelining: no 304 for the ETag of style.css')
+
+    # Then on the persistent connection
+    second = [(b'/style.css', b''), (b'/status.xml', b'')]
+    c.send(get_requests(second))
+    responses = []
+    for _ in second:
+        head, body, end = http_response(c, end)
+        responses.append((head or b'', body))
+    (static, staticBody), (xml, xmlBody) = responses
+    check(static.startswith(b'HTTP/1.1 200') and staticBody == style, 'HTTP pipelining: static file after the 304')
+    check(xml.startswith(b'HTTP/1.1 200') and xmlBody is not None and b'<hits>2</hits>' in xmlBody,
+          'HTTP pipelining: status.xml not chunked or not printed')
+    check(c.pump(0.5) is False and len(c.received) == end and not c.finReceived,
+          'HTTP pipelining: data after the last response or connection closed')
+    c.close()
+    print('tap_check: HTTP pipelining: static, large static, chunked dynamic, 304, then static, chunked XML')
+
+
+def check_recovery(peer):
+    c = TCPConnection(peer, 9762, 40006)
+    check(c.connect(mss=536, sack=True), 'recovery: no connection')
+    lost = {2, 4}           # Indexes of the first transmissions dropped
+    first = []              # Sequence numbers of the first transmissions
+    resent = []
+    blocks = []             # Data held above rcvNxt, as (left, right)
+    end = time.time() + 5
+    while time.time() < end and (len(first) < 12 or blocks):
+        frame = peer.receive(0.05)
+        if frame is None or frame.proto != IP_TCP or frame.dport != c.sport or not frame.data:
+            continue
+        seq, right = frame.seq, (frame.seq + len(frame.data)) % 2**32
+        if seq not in first and (not first or (seq - first[-1]) % 2**32 < 2**31):
+            first.append(seq)
+            if len(first) - 1 in lost:
+                continue
+        else:
+            resent.append(seq)
+        if seq == c.rcvNxt:
+            c.rcvNxt = right
+            while blocks and blocks[0][0] == c.rcvNxt:
+                c.rcvNxt = blocks.pop(0)[1]
+        elif (seq - c.rcvNxt) % 2**32 < 2**31:
+            blocks = sorted(blocks + [(seq, right)], key=lambda b: (b[0] - c.rcvNxt) % 2**32)
+            merged = [blocks[0]]
+            for left, r in blocks[1:]:
+                if left == merged[-1][1]:
+                    merged[-1] = (merged[-1][0], r)
+                else:
+                    merged.append((left, r))
+            blocks = merged
+        c.ack(blocks[:3])
+    check(len(first) >= 12 and not blocks, 'recovery: the lost segments were not resent')
+    check(resent == [first[i] for i in sorted(lost)],
+          'recovery: resent %s, lost %s' % (resent, [first[i] for i in sorted(lost) if i < len(first)]))
+    c.received = b''
+    c.close()
+    print('tap_check: recovery: %d lost segments resent alone' % len(resent))
+
+
+def check_peer(stack):
+    peer = Peer(stack)
+
+    c = TCPConnection(peer, 9762, 40001)
+    check(c.connect(), 'TCP performance TX: no connection')
+    c.receive_until(rb'([^\n]*\n){20}')
+    received = len(c.received)
+    lines = c.received.split(b'\r\n')[:-1]
+    pattern = re.compile(rb'0x[0-9A-Fa-f]{8}: We are currently achieving +[0-9]*00 bytes/second TX throughput\.')
+    check(len(lines) >= 20 and all(pattern.fullmatch(l) for l in lines), 'TCP performance TX: lines missing or malformed')
+    c.close()
+    print('tap_check: TCP performance TX: %d lines in %d bytes' % (len(lines), received))
+
+    c = TCPConnection(peer, 9763, 40002)
+    check(c.connect(), 'TCP performance RX: no connection')
+    check(c.send(bytes(65536)), 'TCP performance RX: 64 KB not acknowledged')
+    time.sleep(1.1)
+    check(c.send(bytes(1000)) and c.receive_until(rb'[0-9]+ bytes/second\r\n'), 'TCP performance RX: no report')
+    c.close()
+    print('tap_check: TCP performance RX: %s' % c.received.split(b'\r\n')[-2].decode())
+
+    head, body = http_get(peer, 40003, b'?page=1')
+    check(head is not None and head.startswith(b'HTTP/1.1 200'), 'HTTP: GET /?page=1 failed')
+    check(b'<title>TAP host target</title>' in body and b'GET requests served: 1<' in body,
+          'HTTP: dynamic variables of index.htm not printed')
+    head, body = http_get(peer, 40004, b'style.css')
+    etag = re.search(rb'\r\nETag: *("[^"]*")', head)
+    check(head.startswith(b'HTTP/1.1 200') and b'max-age=3600' in head and body == open('web/style.css', 'rb').read(),
+          'HTTP: style.css not served with its max-age')
+    head, body = http_get(peer, 40005, b'missing.htm')
+    check(head.startswith(b'HTTP/1.1 404'), 'HTTP: no 404 for a missing file')
+    check(etag is not None, 'HTTP: no ETag for style.css')
+    print('tap_check: HTTP: dynamic page, static file with max-age, 404')
+
+    check_pipelining(peer, etag.group(1) if etag else b'""')
+    check_recovery(peer)
+
+    stdout = peer.close()
+    check('http_get 2' in stdout, 'HTTP: HTTPExecuteGet() count: ' + stdout)
+
+
+def check_berkeley(stack, mode):
+    peer = Peer(stack, env={'TAP_BSD_APP': mode})
+    what = 'Berkeley %s' % mode
+    conns = [TCPConnection(peer, 7000, 41000 + i) for i in range(32)]
+    connected = sum(c.connect() for c in conns)
+    check(connected == 32, '%s: %d connections of 32' % (what, connected))
+    if connected < 32:
+        peer.close()
+        return
+    expected = 0
+
+    def echo(group, data):
+        nonlocal expected
+        for c in group:
+            c.received = b''
+            c.push(data(c))
+        expected += sum(len(data(c)) for c in group)
+        return peer.pump(conns, 5, lambda: all(c.received == data(c) for c in group))
+
+    message = lambda c: b'%d says hello' % c.sport
+    check(echo(conns, message), '%s: no echo on some of the 32 connections' % what)
+
+    # Each connection alone, after the hints of the others were cleared
+    alone = 0
+    while alone < 32:
+        time.sleep(0.02)
+        if not echo([conns[alone]], message):
+            break
+        alone += 1
+    check(alone == 32, '%s: connection %d of 32 does not echo alone' % (what, alone))
+
+    # 90 bytes, BSD_APP_READ at a time, and no ACK to wake the socket up
+    conns[17].quiet = True
+    burst = lambda c: bytes(range(65, 65 + 90))
+    check(echo([conns[17]], burst), '%s: data left unread without a new segment' % what)
+    conns[17].quiet = False
+    conns[17].ack()
+
+    closing, conns = conns[:8], conns[8:]
+    closed = sum(c.close() for c in closing)
+    check(closed == 8, '%s: %d connections of 8 closed' % (what, closed))
+    check(echo(conns, message), '%s: no echo after the close of 8 connections' % what)
+    again = [TCPConnection(peer, 7000, 41100 + i) for i in range(8)]
+    check(all(c.connect() for c in again), '%s: closed connections not accepted again' % what)
+    conns += again
+    check(echo(again, message), '%s: no echo on the connections accepted again' % what)
+
+    stdout = peer.close()
+    counters = re.search(r'bsd_app accepted (\d+) echoed (\d+) closed (\d+)', stdout)
+    check(counters is not None and counters.groups() == ('40', str(expected), '8'),
+          '%s: bsd_app counters, %d bytes echoed: %s' % (what, expected, stdout))
+    print('tap_check: %s: 32 connections, %d bytes echoed, 8 closed and accepted again' % (what, expected))
+
+
+def smtp_serve(c, pipelining, refuse=None, timeout=5):
+    """Serves the SMTP client of the stack on c, after accept().  Returns
+    the batches of command lines answered together, the message texts, and
+    the number of messages followed by commands before their reply."""
+    ehlo = b'250-tap_check\r\n' + (b'250-PIPELINING\r\n' if pipelining else b'') + b'250 8BITMIME\r\n'
+    batches, texts = [], []
+    early = 0
+    pos = 0
+    c.push(b'220 tap_check ESMTP\r\n')
+    done = lambda: c.finReceived or c.reset
+    while True:
+        if not c.pump(timeout, lambda: b'\r\n' in c.received[pos:] or done()) or b'\r\n' not in c.received[pos:]:
+            return batches, texts, early
+        # A pipelined batch ends with DATA
+        if pipelining and c.received[pos:].startswith(b'MAIL'):
+            c.pump(timeout, lambda: b'DATA\r\n' in c.received[pos:] or done())
+        end = c.received.rindex(b'\r\n') + 2
+        lines = c.received[pos:end].split(b'\r\n')[:-1]
+        pos = end
+        batches.append(lines)
+        replies = b''
+        for line in lines:
+            verb = line[:4].upper()
+            if verb == b'EHLO':
+                replies += ehlo
+            elif verb == b'RCPT' and refuse is not None and refuse in line:
+                replies += b'550 no such user\r\n'
+            elif verb in (b'HELO', b'MAIL', b'RCPT', b'RSET'):
+                replies += b'250 ok\r\n'
+            elif verb == b'DATA':
+                replies += b'354 go ahead\r\n'
+            elif verb == b'QUIT':
+                replies += b'221 bye\r\n'
+            else:
+                replies += b'500 what\r\n'
+        c.push(replies)
+        if lines[-1].upper() == b'QUIT':
+            c.close()
+            return batches, texts, early
+        if lines[-1].upper() != b'DATA':
+            continue
+
+        if not c.pump(timeout, lambda: b'\r\n.\r\n' in c.received[pos:] or done()):
+            return batches, texts, early
+        if b'\r\n.\r\n' not in c.received[pos:]:
+            return batches, texts, early
+        end = c.received.index(b'\r\n.\r\n', pos)
+        texts.append(c.received[pos:end])
+        pos = end + 5
+        # Commands of the next message before the reply to this one
+        if c.pump(0.5, lambda: b'\r\n' in c.received[pos:]) and not c.received[pos:].startswith(b'QUIT'):
+            early += 1
+        c.push(b'250 queued\r\n')
+
+
+def check_smtp(stack, pipelining, refuse=None):
+    peer = Peer(stack, env={'TAP_SMTP_APP': '3'})
+    what = 'SMTP %s%s' % ('PIPELINING' if pipelining else 'no PIPELINING', ', RCPT refused' if refuse else '')
+    c = TCPConnection(peer, None, 25)
+    if not c.accept():
+        check(False, '%s: no connection from the client' % what)
+        peer.close()
+        return
+    batches, texts, early = smtp_serve(c, pipelining, refuse)
+    closed = c.finReceived or c.reset
+    stdout = peer.close()
+    result = re.search(r'smtp_app queued (\d+) code (\d+)', stdout)
+    result = result.groups() if result else stdout
+
+    commands = [line for batch in batches for line in batch]
+    recipients = [b'RCPT TO:<ops1@site.local>', b'RCPT TO:<ops2@site.local>', b'RCPT TO:<oncall@site.local>']
+    message = [b'MAIL FROM:<board@dev.local>'] + recipients + [b'DATA']
+    check(commands[:1] and commands[0].startswith(b'EHLO'), '%s: no EHLO: %r' % (what, commands[:1]))
+    if refuse:
+        check(commands[1:] == message and len(batches) == 2, '%s: commands %r' % (what, batches))
+        check(closed and not texts and c.received.endswith(b'DATA\r\n'),
+              '%s: message sent after 354 with a recipient refused: %r' % (what, c.received[-80:]))
+        check(result == ('3', '550'), '%s: queued and SMTPEndUsage() code: %s' % (what, result))
+        print('tap_check: %s: connection closed after 354, code %s' % (what, result[1]))
+        return
+
+    check(commands[1:] == message * 3 + [b'QUIT'], '%s: commands %r' % (what, commands[1:]))
+    expected = [[commands[0]]] + [message] * 3 + [[b'QUIT']] if pipelining else [[line] for line in commands]
+    check(batches == expected, '%s: %d batches of commands: %r' % (what, len(batches), batches))
+    check(early == (2 if pipelining else 0), '%s: %d messages followed by commands before their reply' % (what, early))
+    check(len(texts) == 3 and all(text.endswith(b'\r\n\r\nAlarm %d raised\r\n..leading dot\r\nend' % (n + 1))
+                                  for n, text in enumerate(texts)),
+          '%s: message texts %r' % (what, texts))
+    check(result == ('3', '0'), '%s: queued and SMTPEndUsage() code: %s' % (what, result))
+    print('tap_check: %s: 3 messages in %d batches of commands' % (what, len(batches)))
+
+
+class UARTLine:
+    """The other end of the UART of uart_emu.c, the master of a pty."""
+
+    def __init__(self):
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.slave)
+        self.path = os.ttyname(self.slave)
+        self.received = b''
+        self.last = None
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        while True:
+            try:
+                data = os.read(self.master, 4096)
+            except OSError:
+                return
+            if not data:
+                return
+            self.received += data
+            self.last = time.time()
+
+    def write(self, data):
+        """Writes data in the background, returns the thread."""
+        writer = threading.Thread(target=lambda: os.write(self.master, data) and None, daemon=True)
+        writer.start()
+        return writer
+
+    def close(self):
+        os.close(self.slave)
+        os.close(self.master)
+
+
+UART_PORT = 9761
+UART_BYTES_PER_SECOND = 11520
+
+
+def uart_pattern(n, seed):
+    return bytes((i * seed + i // 251) & 0xff for i in range(n))
+
+
+def uart_up(c, line, n):
+    """Sends n bytes from the UART, returns them and the time to receive them."""
+    data = uart_pattern(n, 7)
+    c.received = b''
+    start = time.time()
+    line.write(data)
+    c.pump(2 + n / UART_BYTES_PER_SECOND, lambda: len(c.received) >= n)
+    return data, time.time() - start
+
+
+def check_uart(stack, stall, flow):
+    what = 'UART bridge, %d ms stalls%s' % (stall, ', RTS/CTS' if flow else '')
+    line = UARTLine()
+    env = {'TAP_UART': line.path, 'TAP_STALL_MS': str(stall)}
+    if flow:
+        env['TAP_UART_FLOW'] = '1'
+    peer = Peer(stack, env=env)
+    c = TCPConnection(peer, UART_PORT, 42000)
+    if not c.connect():
+        check(False, '%s: no connection' % what)
+        peer.close()
+        line.close()
+        return None
+
+    data, seconds = uart_up(c, line, UART_BYTES_PER_SECOND)
+    result = (len(data) - len(c.received), len(c.received) / seconds)
+    if stall < 100:
+        check(c.received == data, '%s: UART to TCP, %d of %d bytes intact' % (what, len(c.received), len(data)))
+        check(result[1] > 0.8 * UART_BYTES_PER_SECOND, '%s: UART to TCP at %d bytes/s' % (what, result[1]))
+
+        # One line at a time, after the stall
+        delays = []
+        for n in range(20):
+            time.sleep(0.02)
+            message = b'M%04d\n' % n
+            start = time.time()
+            line.write(message)
+            if c.pump(1, lambda: c.received.endswith(message)):
+                delays.append(time.time() - start)
+        delays.sort()
+        check(len(delays) == 20 and delays[10] < 0.03,
+              '%s: %d lines of 20, median delay %s' % (what, len(delays), delays[10:11]))
+        result += (delays[10] * 1000, delays[-1] * 1000)
+
+        down = uart_pattern(UART_BYTES_PER_SECOND, 13)
+        start = time.time()
+        c.send(down)
+        end = time.time() + 2 + len(down) / UART_BYTES_PER_SECOND
+        while len(line.received) < len(down) and time.time() < end:
+            time.sleep(0.05)
+        check(line.received == down, '%s: TCP to UART, %d of %d bytes intact' %
+              (what, len(line.received), len(down)))
+        result += (len(line.received) / ((line.last or end) - start),)
+    elif flow:
+        check(c.received == data, '%s: %d of %d bytes intact' % (what, len(c.received), len(data)))
+    else:
+        check(len(c.received) < len(data), '%s: no byte lost' % what)
+
+    c.close()
+    stdout = peer.close()
+    line.close()
+    counters = re.search(r'uart rx (\d+) overruns (\d+) tx (\d+)', stdout)
+    # The bytes are lost in the RX FIFO of the bridge, its interrupt keeps up
+    check(counters is not None and counters.group(2) == '0',
+          '%s: UART overruns: %s' % (what, counters.group(0) if counters else stdout))
+    if stall < 100:
+        print('tap_check: %s: UART to TCP at %d bytes/s, lines in %.0f ms, at most %.0f ms, '
+              'TCP to UART at %d bytes/s' % (what, result[1], result[2], result[3], result[4]))
+    else:
+        print('tap_check: %s: %d of %d bytes lost' % (what, result[0], len(data)))
+
+
+MDNS_MAC = bytes.fromhex('01005e0000fb')
+MDNS_IP = bytes([224, 0, 0, 251])
+MDNS_PORT = 5353
+DNS_A, DNS_PTR, DNS_TXT, DNS_SRV = 1, 12, 16, 33
+
+
+def dns_name(name):
+    return b''.join(bytes([len(label)]) + label for label in name.split(b'.')) + b'\0'
+
+
+def dns_read_name(message, offset):
+    """Returns the name at offset, with its compression pointers followed,
+    and the offset after it."""
+    labels, end = [], None
+    while message[offset]:
+        if message[offset] >= 0xc0:
+            if end is None:
+                end = offset + 2
+            offset = struct.unpack('!H', message[offset:offset + 2])[0] & 0x3fff
+            continue
+        labels.append(message[offset + 1:offset + 1 + message[offset]])
+        offset += 1 + message[offset]
+    return b'.'.join(labels), end if end is not None else offset + 1
+
+
+def mdns_parse(message):
+    """Returns (flags, [(name, type)], [(name, type, ttl, rdata)]), with the
+    names of PTR and SRV rdata decoded."""
+    flags, questions, answers, authorities, additionals = struct.unpack('!HHHHH', message[2:12])
+    offset = 12
+    parsed = []
+    for _ in range(questions):
+        name, offset = dns_read_name(message, offset)
+        parsed.append((name, struct.unpack('!H', message[offset:offset + 2])[0]))
+        offset += 4
+    records = []
+    for _ in range(answers + authorities + additionals):
+        name, offset = dns_read_name(message, offset)
+        rrType, _, ttl, length = struct.unpack('!HHIH', message[offset:offset + 10])
+        offset += 10
+        rdata = message[offset:offset + length]
+        if rrType == DNS_PTR:
+            rdata = dns_read_name(message, offset)[0]
+        elif rrType == DNS_SRV:
+            rdata = struct.unpack('!HHH', rdata[:6]) + (dns_read_name(message, offset + 6)[0],)
+        records.append((name, rrType, ttl, rdata))
+        offset += length
+    return flags, parsed, records
+
+
+def mdns_message(flags, questions=(), answers=()):
+    """Builds a message of (name, type) questions and (name, type, ttl,
+    rdata) answers, rdata as mdns_parse() returns it."""
+    message = struct.pack('!6H', 0, flags, len(questions), len(answers), 0, 0)
+    for name, qType in questions:
+        message += dns_name(name) + struct.pack('!HH', qType, 1)
+    for name, rrType, ttl, rdata in answers:
+        if rrType == DNS_PTR:
+            rdata = dns_name(rdata)
+        elif rrType == DNS_SRV:
+            rdata = struct.pack('!HHH', *rdata[:3]) + dns_name(rdata[3])
+        message += dns_name(name) + struct.pack('!HHIH', rrType, 1, ttl, len(rdata)) + rdata
+    return message
+
+
+class MDNSHost:
+    """The hosts of the peer: logs the mDNS messages of the stack, and
+    answers its A questions for the names of hosts."""
+
+    def __init__(self, peer, hosts):
+        self.peer, self.hosts = peer, hosts
+        self.log = []
+
+    def send(self, message):
+        self.peer.send(udp(MDNS_PORT, MDNS_PORT, message, dst=MDNS_MAC, dstIP=MDNS_IP))
+
+    def ask(self, questions, answers=()):
+        self.send(mdns_message(0, questions, answers))
+        return time.time()
+
+    def wait(self, seconds, until=lambda flags, questions, records: False):
+        """Logs the messages for seconds, returns the time of the first
+        one for which until() is true, else None."""
+        end = time.time() + seconds
+        while time.time() < end:
+            frame = self.peer.receive(min(0.02, max(end - time.time(), 0.001)))
+            if frame is None or frame.proto != IP_UDP or frame.dport != MDNS_PORT:
+                continue
+            now = time.time()
+            flags, questions, records = mdns_parse(frame.data)
+            self.log.append((now, flags, questions, records))
+            if not flags & 0x8000:
+                answers = [(name, DNS_A, 120, self.hosts[name]) for name, qType in questions
+                           if qType == DNS_A and name in self.hosts]
+                if answers:
+                    self.send(mdns_message(0x8400, answers=answers))
+            if until(flags, questions, records):
+                return now
+        return None
+
+    def answered(self, rrType, seconds=0.5):
+        return self.wait(seconds, lambda flags, questions, records:
+                         flags & 0x8000 and any(r[1] == rrType for r in records))
+
+
+def check_mdns(stack):
+    silent = [b'silent1.local', b'silent2.local']
+    hosts = {b'peer1.local': bytes([192, 168, 10, 101])}
+    peer = Peer(stack, env={'TAP_MDNS_APP': ','.join(n.decode() for n in silent + list(hosts))})
+    mdns = MDNSHost(peer, hosts)
+    service = b'_http._tcp.local'
+
+    # The announcements of the host name, of the SRV record then of the PTR
+    announced = mdns.answered(DNS_PTR, 12)
+    check(announced is not None, 'mDNS: service not announced')
+    if announced is None:
+        peer.close()
+        return
+    mdns.wait(1.2)
+
+    start = mdns.ask([(service, DNS_PTR)])
+    answered = mdns.answered(DNS_PTR)
+    delay = answered - start if answered else None
+    check(delay is not None and 0.015 < delay < 0.3, 'mDNS: shared PTR answered after %s s' % delay)
+    instance = b'TAP Web.' + service
+    mdns.ask([(instance, DNS_TXT)])
+    mdns.answered(DNS_TXT)
+    records = {r[1]: r for entry in mdns.log if entry[1] & 0x8000 for r in entry[3]}
+    check(all(t in records for t in (DNS_A, DNS_PTR, DNS_TXT, DNS_SRV)),
+          'mDNS: records answered: %s' % sorted(records))
+    mdns.wait(1.2)
+
+    suppressed = []
+    for name, rrType in ((service, DNS_PTR), (instance, DNS_TXT), (instance, DNS_SRV), (b'TAPHOST.local', DNS_A)):
+        known = [r for r in records.values() if r[1] == rrType]
+        mdns.ask([(name, rrType)], known)
+        if mdns.answered(rrType) is None:
+            suppressed.append(rrType)
+    check(suppressed == [DNS_PTR, DNS_TXT, DNS_SRV, DNS_A],
+          'mDNS: known answers suppressed only for types %s' % suppressed)
+    mdns.wait(1.2)
+
+    start = mdns.ask([(instance, DNS_SRV)])
+    first = mdns.answered(DNS_SRV)
+    check(first is not None and first - start < 0.1, 'mDNS: unique SRV record not answered at once')
+    mdns.ask([(instance, DNS_SRV)])
+    check(mdns.answered(DNS_SRV, 0.5) is None, 'mDNS: SRV record multicast twice within 1 s')
+    mdns.wait(max(0, (first or 0) + 1.1 - time.time()))
+    mdns.ask([(instance, DNS_SRV)])
+    check(mdns.answered(DNS_SRV) is not None, 'mDNS: SRV record not answered 1 s after the last time')
+
+    # The lookups, until each silent name was asked 4 times
+    mdns.wait(20, lambda flags, questions, records:
+              all(sum(1 for entry in mdns.log if not entry[1] & 0x8000 and (name, DNS_A) in entry[2]) >= 4
+                  for name in silent))
+    stdout = peer.close()
+    queries = lambda name: [entry[0] for entry in mdns.log if not entry[1] & 0x8000 and (name, DNS_A) in entry[2]]
+    for name in silent:
+        times = queries(name)
+        gaps = [b - a for a, b in zip(times, times[1:])]
+        check(len(times) >= 4 and all(2**i - 0.1 < gap < 2**i + 1 for i, gap in enumerate(gaps)),
+              'mDNS: %s asked at intervals %s' % (name.decode(), ['%.1f' % gap for gap in gaps]))
+    check(len(queries(b'peer1.local')) == 1, 'mDNS: peer1.local asked %d times' % len(queries(b'peer1.local')))
+    counters = re.search(r'mdns_app lookups (\d+) resolved (\d+)', stdout)
+    check(counters is not None and int(counters.group(2)) > 0, 'mDNS: lookups: %s' % stdout)
+    print('tap_check: mDNS: PTR answered after %.0f ms, 4 known answers suppressed, SRV once per second, '
+          'silent hosts asked after %s s, %s' % ((delay or 0) * 1000,
+          ', '.join('%.1f' % gap for gap in gaps), counters.group(0) if counters else stdout))
+
+
+def main():
+    check_replay(sys.argv[1])
+    check_udp_queue(sys.argv[1])
+    check_peer(sys.argv[1])
+    check_berkeley(sys.argv[1], 'select')
+    check_berkeley(sys.argv[1], 'poll')
+    check_smtp(sys.argv[1], True)
+    check_smtp(sys.argv[1], False)
+    check_smtp(sys.argv[1], True, b'ops2')
+    check_uart(sys.argv[1], 20, False)
+    check_uart(sys.argv[1], 150, False)
+    check_uart(sys.argv[1], 150, True)
+    check_mdns(sys.argv[1])
+    print('tap_check: %s' % ('FAILED' if failures else 'passed'))
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
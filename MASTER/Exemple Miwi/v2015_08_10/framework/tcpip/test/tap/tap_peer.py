@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+#
+# Frames, pcap files and a scripted peer for the TAP host target.
+#
+# The peer runs tap_stack with TAP_PCAP_INPUT and TAP_PCAP_OUTPUT on two
+# named pipes (see src/linux_tap.h), answers its ARP requests and speaks
+# enough TCP for one connection at a time: in order segments, an ACK for
+# each, retransmission after TCP_RTO, connections opened by either side.  Peer.pump() serves several
+# connections at once, for segments sent with TCPConnection.push(), which
+# are not resent.  It is the other end of the wire for
+# the checks that need a conversation, where a fixed capture cannot follow
+# the sequence numbers the stack picks at random.
+
+import os
+import queue
+import re
+import struct
+import subprocess
+import tempfile
+import threading
+import time
+
+STACK_MAC = bytes.fromhex('0004a3000002')
+STACK_IP = bytes([192, 168, 10, 2])
+PEER_MAC = bytes.fromhex('020000000001')
+PEER_IP = bytes([192, 168, 10, 1])
+BROADCAST_MAC = b'\xff' * 6
+
+ETH_IP, ETH_ARP = 0x0800, 0x0806
+IP_ICMP, IP_TCP, IP_UDP = 1, 6, 17
+FIN, SYN, RST, PSH, ACK = 0x01, 0x02, 0x04, 0x08, 0x10
+
+PCAP_HEADER = struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1)
+TCP_RTO = 1.0
+TCP_MSS = 1460
+
+
+def checksum(data):
+    if len(data) & 1:
+        data += b'\0'
+    s = sum(struct.unpack('!%dH' % (len(data) // 2), data))
+    while s >> 16:
+        s = (s & 0xffff) + (s >> 16)
+    return ~s & 0xffff
+
+
+def ether(dst, ethType, payload, src=PEER_MAC):
+    return dst + src + struct.pack('!H', ethType) + payload
+
+
+def ipv4(proto, payload, src=PEER_IP, dst=STACK_IP, ident=0):
+    header = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(payload), ident, 0x4000, 64, proto, 0, src, dst)
+    return header[:10] + struct.pack('!H', checksum(header)) + header[12:] + payload
+
+
+def pseudo(proto, src, dst, segment):
+    return src + dst + struct.pack('!BBH', 0, proto, len(segment)) + segment
+
+
+def arp(op, targetIP, targetMAC=b'\0' * 6, senderIP=PEER_IP, senderMAC=PEER_MAC):
+    payload = struct.pack('!HHBBH6s4s6s4s', 1, ETH_IP, 6, 4, op, senderMAC, senderIP, targetMAC, targetIP)
+    return ether(BROADCAST_MAC if op == 1 else targetMAC, ETH_ARP, payload, senderMAC)
+
+
+def icmp_echo(ident, seq, data, dst=STACK_MAC):
+    message = struct.pack('!BBHHH', 8, 0, 0, ident, seq) + data
+    message = message[:2] + struct.pack('!H', checksum(message)) + message[4:]
+    return ether(dst, ETH_IP, ipv4(IP_ICMP, message, ident=seq))
+
+
+def udp(sport, dport, data, dst=STACK_MAC, dstIP=STACK_IP):
+    segment = struct.pack('!HHHH', sport, dport, 8 + len(data), 0) + data
+    segment = segment[:6] + struct.pack('!H', checksum(pseudo(IP_UDP, PEER_IP, dstIP, segment)) or 0xffff) + segment[8:]
+    return ether(dst, ETH_IP, ipv4(IP_UDP, segment, dst=dstIP))
+
+
+def tcp(sport, dport, seq, ack, flags, data=b'', window=32768, options=b''):
+    offset = (20 + len(options)) // 4
+    segment = struct.pack('!HHIIBBHHH', sport, dport, seq, ack, offset << 4, flags, window, 0, 0) + options + data
+    segment = segment[:16] + struct.pack('!H', checksum(pseudo(IP_TCP, PEER_IP, STACK_IP, segment))) + segment[18:]
+    return ether(STACK_MAC, ETH_IP, ipv4(IP_TCP, segment))
+
+
+class Frame:
+    """A received frame, with the fields of its ARP, IP, ICMP, UDP or TCP header."""
+
+    def __init__(self, raw):
+        self.raw = raw
+        self.dst, self.src = raw[0:6], raw[6:12]
+        self.type = struct.unpack('!H', raw[12:14])[0]
+        self.proto = None
+        self.valid = True
+        if self.type == ETH_ARP:
+            (_, _, _, _, self.op, self.senderMAC, self.senderIP,
+             self.targetMAC, self.targetIP) = struct.unpack('!HHBBH6s4s6s4s', raw[14:42])
+        elif self.type == ETH_IP:
+            ihl = (raw[14] & 0x0f) * 4
+            total = struct.unpack('!H', raw[16:18])[0]
+            ip = raw[14:14 + total]
+            self.proto = ip[9]
+            self.srcIP, self.dstIP = ip[12:16], ip[16:20]
+            self.valid = checksum(ip[:ihl]) == 0
+            l4 = ip[ihl:]
+            if self.proto == IP_ICMP:
+                self.icmpType, self.icmpCode, _, self.ident, self.seq = struct.unpack('!BBHHH', l4[:8])
+                self.data = l4[8:]
+                self.valid = self.valid and checksum(l4) == 0
+            elif self.proto == IP_UDP:
+                self.sport, self.dport, length, sum = struct.unpack('!HHHH', l4[:8])
+                self.data = l4[8:length]
+                if sum:
+                    self.valid = self.valid and checksum(pseudo(IP_UDP, self.srcIP, self.dstIP, l4[:length])) == 0
+            elif self.proto == IP_TCP:
+                (self.sport, self.dport, self.seq, self.ack, offset, self.flags,
+                 self.window) = struct.unpack('!HHIIBBH', l4[:16])
+                self.data = l4[(offset >> 4) * 4:]
+                self.valid = self.valid and checksum(pseudo(IP_TCP, self.srcIP, self.dstIP, l4)) == 0
+
+
+def write_pcap(path, frames, times=None):
+    """Writes frames 1 us apart, or at the given times in seconds."""
+    with open(path, 'wb') as f:
+        f.write(PCAP_HEADER)
+        for i, frame in enumerate(frames):
+            stamp = 1000000 + (round(times[i] * 1000000) if times else i)
+            f.write(struct.pack('<IIII', stamp // 1000000, stamp % 1000000, len(frame), len(frame)) + frame)
+
+
+def read_records(f):
+    if f.read(24)[:4] != PCAP_HEADER[:4]:
+        raise ValueError('not a pcap stream')
+    while True:
+        header = f.read(16)
+        if len(header) < 16:
+            return
+        length = struct.unpack('<IIII', header)[2]
+        yield f.read(length)
+
+
+def read_pcap(path):
+    with open(path, 'rb') as f:
+        return [Frame(raw) for raw in read_records(f)]
+
+
+def run_replay(stack, frames, drainMs=500, times=None, env={}):
+    """Replays frames through tap_stack, returns (frames sent, stdout)."""
+    with tempfile.TemporaryDirectory() as tmp:
+        inPath, outPath = os.path.join(tmp, 'in.pcap'), os.path.join(tmp, 'out.pcap')
+        write_pcap(inPath, frames, times)
+        env = dict(os.environ, TAP_PCAP_INPUT=inPath, TAP_PCAP_OUTPUT=outPath, TAP_DRAIN_MS=str(drainMs), **env)
+        out = subprocess.run([stack], env=env, stdout=subprocess.PIPE, check=True, timeout=60).stdout
+        return read_pcap(outPath), out.decode()
+
+
+class Peer:
+    """tap_stack driven through named pipes, see the top of this file."""
+
+    def __init__(self, stack, drainMs=200, env={}):
+        self.tmp = tempfile.TemporaryDirectory()
+        inPath, outPath = os.path.join(self.tmp.name, 'in'), os.path.join(self.tmp.name, 'out')
+        os.mkfifo(inPath)
+        os.mkfifo(outPath)
+        env = dict(os.environ, TAP_PCAP_INPUT=inPath, TAP_PCAP_OUTPUT=outPath, TAP_DRAIN_MS=str(drainMs), **env)
+        self.process = subprocess.Popen([stack], env=env, stdout=subprocess.PIPE)
+        # Same order as MACInit(): input, its header, then output
+        self.input = open(inPath, 'wb', buffering=0)
+        self.input.write(PCAP_HEADER)
+        self.output = open(outPath, 'rb', buffering=0)
+        self.lock = threading.Lock()
+        self.frames = queue.Queue()
+        self.sent = 0
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        self.reader.start()
+
+    def _read(self):
+        for raw in read_records(self.output):
+            frame = Frame(raw)
+            if frame.type == ETH_ARP and frame.op == 1 and frame.targetIP == PEER_IP:
+                self.send(arp(2, frame.senderIP, frame.senderMAC))
+            elif frame.proto == IP_UDP and frame.dst == BROADCAST_MAC:
+                pass    # The boot burst of the UDP performance test
+            else:
+                self.frames.put(frame)
+        self.frames.put(None)
+
+    def send(self, frame):
+        now = time.time()
+        with self.lock:
+            self.input.write(struct.pack('<IIII', int(now), int(now % 1 * 1e6), len(frame), len(frame)) + frame)
+            self.sent += 1
+
+    def receive(self, timeout):
+        """The next frame that is not ARP or a broadcast, None after timeout."""
+        try:
+            return self.frames.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def pump(self, connections, timeout, until):
+        """Hands every frame to all the connections until until() or timeout."""
+        end = time.time() + timeout
+        while not until():
+            left = end - time.time()
+            if left <= 0:
+                return False
+            frame = self.receive(min(left, 0.05))
+            if frame is not None:
+                for c in connections:
+                    c._segment(frame)
+        return True
+
+    def close(self):
+        """Ends the replay, returns the output of tap_stack."""
+        with self.lock:
+            self.input.close()
+        out = self.process.communicate(timeout=30)[0].decode()
+        self.reader.join(5)
+        self.output.close()
+        self.tmp.cleanup()
+        return out
+
+
+class TCPConnection:
+    """A connection between the peer and a port of the stack, opened by
+    connect() from sport, or by the stack to sport with accept()."""
+
+    def __init__(self, peer, port, sport=40000, window=32768):
+        self.peer, self.port, self.sport, self.window = peer, port, sport, window
+        self.iss = 0x10000000 + sport
+        self.sndUna = self.sndNxt = self.iss
+        self.sndWnd = 0
+        self.rcvNxt = 0
+        self.received = b''
+        self.finReceived = False
+        self.reset = False
+        self.segments = 0
+        self.retransmits = 0
+        # No ACK for the data of the stack while set
+        self.quiet = False
+
+    def _send(self, flags, seq, data=b'', options=b''):
+        self.peer.send(tcp(self.sport, self.port, seq, self.rcvNxt, flags, data, self.window, options))
+
+    def _segment(self, frame):
+        if frame.proto != IP_TCP or frame.sport != self.port or frame.dport != self.sport:
+            return
+        if not frame.valid:
+            raise AssertionError('segment with a bad checksum from port %d' % self.port)
+        self.segments += 1
+        if frame.flags & RST:
+            self.reset = True
+            return
+        if frame.flags & ACK and 0 < (frame.ack - self.sndUna) % 2**32 <= (self.sndNxt - self.sndUna) % 2**32:
+            self.sndUna = frame.ack
+        if frame.flags & ACK:
+            self.sndWnd = frame.window
+        if frame.seq == self.rcvNxt:
+            self.received += frame.data
+            self.rcvNxt = (self.rcvNxt + len(frame.data)) % 2**32
+            if frame.flags & FIN:
+                self.rcvNxt = (self.rcvNxt + 1) % 2**32
+                self.finReceived = True
+        if (frame.data and not self.quiet) or frame.flags & FIN:
+            self._send(ACK, self.sndNxt)
+
+    def pump(self, timeout, until=lambda: False):
+        """Handles the segments of the stack until until() or timeout."""
+        end = time.time() + timeout
+        while not until() and not self.reset:
+            left = end - time.time()
+            if left <= 0:
+                return False
+            frame = self.peer.receive(min(left, 0.05))
+            if frame is not None:
+                self._segment(frame)
+        return until()
+
+    def connect(self, timeout=5, mss=TCP_MSS, sack=False):
+        options = struct.pack('!BBH', 2, 4, mss) + (b'\x01\x01\x04\x02' if sack else b'')
+        for _ in range(int(timeout / TCP_RTO)):
+            self._send(SYN, self.iss, options=options)
+            frame = self.peer.receive(TCP_RTO)
+            while frame is not None and not (frame.proto == IP_TCP and frame.sport == self.port):
+                frame = self.peer.receive(TCP_RTO)
+            if frame is not None and frame.flags & (SYN | ACK) == SYN | ACK:
+                self.rcvNxt = (frame.seq + 1) % 2**32
+                self.sndUna = self.sndNxt = (self.iss + 1) % 2**32
+                self.sndWnd = frame.window
+                self._send(ACK, self.sndNxt)
+                return True
+        return False
+
+    def accept(self, timeout=5):
+        """Waits for a SYN of the stack to sport and answers it."""
+        end = time.time() + timeout
+        while time.time() < end:
+            frame = self.peer.receive(TCP_RTO)
+            if frame is None or frame.proto != IP_TCP or frame.dport != self.sport or frame.flags & SYN == 0:
+                continue
+            self.port = frame.sport
+            self.rcvNxt = (frame.seq + 1) % 2**32
+            self.sndWnd = frame.window
+            self._send(SYN | ACK, self.iss, options=struct.pack('!BBH', 2, 4, TCP_MSS))
+            self.sndNxt = (self.iss + 1) % 2**32
+            return self.pump(end - time.time(), lambda: self.sndUna == self.sndNxt)
+        return False
+
+    def ack(self, blocks=()):
+        """Acknowledges rcvNxt, with a SACK option for the (left, right) blocks."""
+        options = b''
+        if blocks:
+            options = b'\x01\x01' + struct.pack('!BB', 5, 2 + 8 * len(blocks))
+            options += b''.join(struct.pack('!II', left, right) for left, right in blocks)
+        self._send(ACK, self.sndNxt, options=options)
+
+    def push(self, data):
+        """Sends data in one segment and returns, see Peer.pump()."""
+        self._send(ACK | PSH, self.sndNxt, data)
+        self.sndNxt = (self.sndNxt + len(data)) % 2**32
+
+    def send(self, data, timeout=10):
+        """Sends data within the window of the stack, returns when all is acknowledged."""
+        end = time.time() + timeout
+        start = self.sndUna
+        lastProgress = time.time()
+        while (self.sndUna - start) % 2**32 < len(data) and not self.reset:
+            if time.time() > end:
+                return False
+            acked = (self.sndUna - start) % 2**32
+            sent = (self.sndNxt - start) % 2**32
+            if time.time() - lastProgress > TCP_RTO:
+                # Go back to the first unacknowledged byte
+                self.sndNxt = self.sndUna
+                sent = acked
+                self.retransmits += 1
+                lastProgress = time.time()
+            while sent < len(data) and sent - acked < self.sndWnd:
+                n = min(TCP_MSS, len(data) - sent, self.sndWnd - (sent - acked))
+                self._send(ACK | PSH, self.sndNxt, data[sent:sent + n])
+                self.sndNxt = (self.sndNxt + n) % 2**32
+                sent += n
+            before = self.sndUna
+            frame = self.peer.receive(0.05)
+            if frame is not None:
+                self._segment(frame)
+            if self.sndUna != before:
+                lastProgress = time.time()
+        return not self.reset
+
+    def receive_until(self, pattern, timeout=5):
+        """Waits until the received data matches the regular expression."""
+        regex = re.compile(pattern, re.S)
+        return self.pump(timeout, lambda: regex.search(self.received) is not None)
+
+    def close(self, timeout=5):
+        """Sends FIN and waits for the FIN of the stack."""
+        self._send(FIN | ACK, self.sndNxt)
+        self.sndNxt = (self.sndNxt + 1) % 2**32
+        return self.pump(timeout, lambda: self.finReceived and self.sndUna == self.sndNxt)
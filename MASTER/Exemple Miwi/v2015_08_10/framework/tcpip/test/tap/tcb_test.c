@@ -0,0 +1,256 @@
+/*******************************************************************************
+  TCB cache and socket lookup tests of the TAP host target
+
+  Summary:
+    Runs the static functions of tcp.c against the emulated MAC RAM of
+    linux_tap.c, where the TCBs of the TAP configuration live.
+
+  Description:
+    tcp.c is included, so that the test reaches SyncTCB(),
+    FindMatchingSocket() and the TCBs behind them.  The sockets of
+    system_config.h listen on their own port, then a SYN of their own remote
+    node connects each one (partial match of FindMatchingSocket()).
+    - Segments to random sockets: each lookup must give the right socket,
+      and a counter that the test keeps in its TCB must survive the cache
+      evictions.  A socket that is neither cached nor in MyTCB must have its
+      last values in the MAC RAM (write-back).
+    - TCPInit() with a dirty TCB in MyTCB and a full cache: every TCB must
+      be closed afterwards, and no stale TCB written back later.  Then the
+      same segments again.
+
+    The Makefile builds it with the default TCP_TCB_CACHE_ENTRIES and
+    TCP_SOCKET_HASH_SIZE (tcb_test), and with both set to 0 (tcb_test_nocache).
+    With a segment count, it then times FindMatchingSocket() with 1, 4 and
+    all the sockets receiving:
+
+      tcb_test [segments]
+ *******************************************************************************/
+
+#include "../../src/tcp.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FIRST_PORT      (1000u)
+#define FIRST_SOURCE    (40000u)
+
+APP_CONFIG AppConfig;
+
+static TCP_HEADER headers[TCP_SOCKET_COUNT];
+static NODE_INFO remotes[TCP_SOCKET_COUNT];
+static uint32_t segments[TCP_SOCKET_COUNT];
+static int failures;
+
+/****************************************************************************
+  Stubs of stack_task.c, which would bring in the applications
+ ***************************************************************************/
+
+void StackSignal(STACK_MODULE module, uint8_t events)
+{
+}
+
+void StackSignalSocket(uint8_t hSocket, uint8_t vSocketPurpose, uint8_t events)
+{
+}
+
+void StackSetTimer(STACK_MODULE module, uint32_t dwTime)
+{
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what, int socket)
+{
+    if (!ok)
+    {
+        printf("tcb_test: FAILED: %s, socket %d\n", what, socket);
+        failures++;
+    }
+}
+
+// TCB of a socket as seen by tcp.c, through the cache
+static void LoadTCB(TCP_SOCKET hTCP)
+{
+    SyncTCBStub(hTCP);
+    SyncTCB();
+}
+
+#if TCP_TCB_CACHE_ENTRIES
+// TCB of a socket in the MAC RAM, false if it is cached or in MyTCB
+static bool ReadMediumTCB(TCP_SOCKET hTCP, TCB *tcb)
+{
+    if (TCBCacheEntry[hTCP] < TCP_TCB_CACHE_ENTRIES || hLastTCB == hTCP)
+        return false;
+
+    TCPRAMCopy((PTR_BASE) tcb, TCP_PIC_RAM, TCBStubs[hTCP].bufferTxStart - sizeof (TCB),
+            TCBStubs[hTCP].vMemoryMedium, sizeof (TCB));
+    return true;
+}
+#endif
+
+// Each socket listens on its own port, and a SYN connects it
+static void Connect(void)
+{
+    TCP_SOCKET hTCP;
+    int i;
+
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+    {
+        hTCP = TCPOpen(0, TCP_OPEN_SERVER, FIRST_PORT + i, TCPSocketInitializer[i].vSocketPurpose);
+        Check(hTCP == i, "TCPOpen() did not give the socket of its purpose", i);
+
+        memset(&headers[i], 0, sizeof (headers[i]));
+        headers[i].SourcePort = FIRST_SOURCE + i;
+        headers[i].DestPort = FIRST_PORT + i;
+        headers[i].Flags.bits.flagSYN = 1;
+        memset(&remotes[i], 0, sizeof (remotes[i]));
+        remotes[i].IPAddr.Val = 0x0A0AA8C0ul + ((uint32_t) i << 24); // 192.168.10.10 + i
+        remotes[i].MACAddr.v[5] = i;
+
+        Check(FindMatchingSocket(&headers[i], &remotes[i]) && hCurrentTCP == i, "SYN not matched to its listener", i);
+        MyTCBStub.smState = TCP_ESTABLISHED;
+        MyTCB.RemoteSEQ = 0;
+        MyTCB.remoteWindow = 1000u + i;
+        segments[i] = 0;
+        headers[i].Flags.bits.flagSYN = 0;
+        headers[i].Flags.bits.flagACK = 1;
+    }
+}
+
+// Segments to random sockets, each one counted in RemoteSEQ
+static void Receive(int count)
+{
+    int i, n;
+
+    for (n = 0; n < count; n++)
+    {
+        i = rand() % TCP_SOCKET_COUNT;
+        if (!FindMatchingSocket(&headers[i], &remotes[i]) || hCurrentTCP != i)
+        {
+            Check(false, "segment not matched to its socket", i);
+            return;
+        }
+        Check(MyTCB.RemoteSEQ == segments[i], "TCB lost an update", i);
+        MyTCB.RemoteSEQ++;
+        segments[i]++;
+    }
+}
+
+static void CheckWriteBack(void)
+{
+#if TCP_TCB_CACHE_ENTRIES
+    TCB tcb;
+    int i, evicted = 0;
+
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+    {
+        if (!ReadMediumTCB(i, &tcb))
+            continue;
+        Check(tcb.RemoteSEQ == segments[i] && tcb.remoteWindow == 1000u + i, "evicted TCB not written back", i);
+        evicted++;
+    }
+    Check(evicted >= TCP_SOCKET_COUNT - TCP_TCB_CACHE_ENTRIES - 1, "fewer sockets than cache entries", evicted);
+#endif
+}
+
+static void CheckCounters(void)
+{
+    int i;
+
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+    {
+        LoadTCB(i);
+        Check(MyTCB.RemoteSEQ == segments[i] && MyTCB.remoteWindow == 1000u + i &&
+                MyTCB.remote.niRemoteMACIP.IPAddr.Val == remotes[i].IPAddr.Val, "TCB not as last written", i);
+    }
+}
+
+static void TestCache(void)
+{
+    int i;
+
+    TCPInit();
+    Connect();
+    Receive(100000);
+    CheckWriteBack();
+    CheckCounters();
+
+    // MyTCB holds the TCB of a connected socket, not yet saved, and the
+    // cache is full of connected sockets
+    Receive(TCP_SOCKET_COUNT * 4);
+    TCPInit();
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+    {
+        LoadTCB(i);
+        Check(MyTCBStub.smState == TCP_CLOSED && MyTCB.vSocketPurpose == TCPSocketInitializer[i].vSocketPurpose &&
+                MyTCB.remoteWindow == 1u && MyTCB.dwRecover == MyTCB.MySEQ, "TCB not closed by TCPInit()", i);
+    }
+#if TCP_TCB_CACHE_ENTRIES
+    // A stale TCB written back now would show in the MAC RAM
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+        LoadTCB(i);
+    for (i = 0; i < TCP_SOCKET_COUNT; i++)
+    {
+        TCB tcb;
+
+        if (ReadMediumTCB(i, &tcb))
+            Check(tcb.remoteWindow == 1u, "stale TCB written back after TCPInit()", i);
+    }
+#endif
+
+    Connect();
+    Receive(100000);
+    CheckWriteBack();
+    CheckCounters();
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void Bench(int count)
+{
+    static const int actives[] = {1, 4, TCP_SOCKET_COUNT};
+    static uint8_t order[1024];
+    double start;
+    int a, i, n;
+
+    TCPInit();
+    Connect();
+    for (a = 0; a < sizeof (actives) / sizeof (actives[0]); a++)
+    {
+        for (i = 0; i < sizeof (order); i++)
+            order[i] = rand() % actives[a];
+
+        start = Now();
+        for (n = 0; n < count; n++)
+        {
+            i = order[n & (sizeof (order) - 1)];
+            FindMatchingSocket(&headers[i], &remotes[i]);
+        }
+        printf("tcb_test: %d sockets, %d receiving: %.1f ns per FindMatchingSocket()\n",
+                (int) TCP_SOCKET_COUNT, actives[a], (Now() - start) * 1e9 / count);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 0;
+
+    srand(1);
+    TickInit();
+    TestCache();
+    if (count > 0)
+        Bench(count);
+
+    printf("tcb_test: TCP_TCB_CACHE_ENTRIES %u, TCP_SOCKET_HASH_SIZE %u: %s\n", (unsigned) TCP_TCB_CACHE_ENTRIES,
+            (unsigned) TCP_SOCKET_HASH_SIZE, failures ? "FAILED" : "lookups, write-back and TCPInit() passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+/*******************************************************************************
+  TFTP transfers of the TAP host target
+
+  Summary:
+    Reads or writes one file with the TFTP client of tftp.c, for the TFTP
+    benchmark of tap_bench.py.
+
+  Description:
+    The server is the gateway, 192.168.10.1 (tftp_server.py).
+    - TAP_TFTP_GET=<file>: reads the file with TFTPOpenFile() and
+      TFTPGet(), starting over on TFTP_RETRY like the demo applications.
+    - TAP_TFTP_PUT=<file>: writes TAP_TFTP_PUT_BYTES bytes of Pattern() to
+      the file with TFTPUploadFragmentedRAMFileToHost(), in chunks of 65535
+      bytes.
+
+    The transfer starts TAP_TFTP_START after boot, once the 1024 datagrams
+    that the UDP performance test sends at boot have left: they overflow the
+    TX delay line of linux_tap.c.
+
+    When the transfer ends, main.c prints the result and exits:
+
+      tftp get|put <bytes> sum <Sum() of the data> <seconds> s
+      tftp failed <TFTP_RESULT or upload status> error <TFTPGetError()>
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#define TFTP_SERVER     "192.168.10.1"
+
+// Size of the file written by TAP_TFTP_PUT
+#if !defined(TAP_TFTP_PUT_BYTES)
+#define TAP_TFTP_PUT_BYTES  (262144ul)
+#endif
+
+// Time from boot to the start of the transfer
+#define TAP_TFTP_START  (TICK_SECOND)
+
+#define PUT_CHUNK       (65535ul)
+#define PUT_CHUNKS      ((TAP_TFTP_PUT_BYTES + PUT_CHUNK - 1ul) / PUT_CHUNK)
+
+typedef enum
+{
+    SM_TFTP_APP_IDLE = 0,
+    SM_TFTP_APP_START_GET,
+    SM_TFTP_APP_START_PUT,
+    SM_TFTP_APP_SOCKET,
+    SM_TFTP_APP_OPEN,
+    SM_TFTP_APP_GET,
+    SM_TFTP_APP_PUT
+} SM_TFTP_APP;
+
+static SM_TFTP_APP smTFTP;
+static uint8_t *fileName;
+static uint32_t dwBoot;
+static uint32_t dwStart;
+static uint32_t dwBytes;
+static uint32_t dwSum;
+static uint8_t putData[TAP_TFTP_PUT_BYTES];
+static TFTP_CHUNK_DESCRIPTOR putChunks[PUT_CHUNKS + 1ul];
+
+// Data of the file written, which tap_bench.py compares with the file
+// received by the server
+static uint8_t Pattern(uint32_t i)
+{
+    return (uint8_t) (i * 7u + (i >> 11));
+}
+
+// Checksum of the data, sum * 31 + byte
+static uint32_t Sum(uint32_t sum, uint8_t c)
+{
+    return sum * 31u + c;
+}
+
+static bool Done(const char *what)
+{
+    printf("tftp %s %lu sum %08lx %.3f s\n", what, (unsigned long) dwBytes, (unsigned long) dwSum,
+            (double) (TickGet() - dwStart) / TICK_SECOND);
+    return true;
+}
+
+static bool Failed(int result)
+{
+    printf("tftp failed %d error %u\n", result, (unsigned) TFTPGetError());
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    bool TapTFTPStart(void)
+
+  Summary:
+    Starts the transfer asked for by TAP_TFTP_GET or TAP_TFTP_PUT.
+
+  Returns:
+    true if a transfer was asked for, false otherwise
+ ***************************************************************************/
+bool TapTFTPStart(void)
+{
+    uint32_t i;
+
+    dwBoot = TickGet();
+    if (getenv("TAP_TFTP_GET") != NULL)
+    {
+        fileName = (uint8_t *) getenv("TAP_TFTP_GET");
+        smTFTP = SM_TFTP_APP_START_GET;
+        return true;
+    }
+    if (getenv("TAP_TFTP_PUT") == NULL)
+        return false;
+
+    for (i = 0; i < TAP_TFTP_PUT_BYTES; i++)
+    {
+        putData[i] = Pattern(i);
+        dwSum = Sum(dwSum, putData[i]);
+    }
+    for (i = 0; i < PUT_CHUNKS; i++)
+    {
+        putChunks[i].vDataPointer = &putData[i * PUT_CHUNK];
+        putChunks[i].wDataLength = (uint16_t) ((i + 1ul < PUT_CHUNKS) ? PUT_CHUNK : TAP_TFTP_PUT_BYTES - i * PUT_CHUNK);
+    }
+    putChunks[PUT_CHUNKS].vDataPointer = NULL;
+    dwBytes = TAP_TFTP_PUT_BYTES;
+    fileName = (uint8_t *) getenv("TAP_TFTP_PUT");
+    smTFTP = SM_TFTP_APP_START_PUT;
+    return true;
+}
+
+/*****************************************************************************
+  Function:
+    bool TapTFTPTask(void)
+
+  Summary:
+    Runs the transfer, called by main.c after StackApplications().
+
+  Returns:
+    true once the transfer is over and its result printed
+ ***************************************************************************/
+bool TapTFTPTask(void)
+{
+    IP_ADDR server;
+    TFTP_RESULT result;
+    int8_t status;
+
+    switch (smTFTP)
+    {
+        case SM_TFTP_APP_START_GET:
+        case SM_TFTP_APP_START_PUT:
+            if (TickGet() - dwBoot < TAP_TFTP_START)
+                break;
+            dwStart = TickGet();
+            if (smTFTP == SM_TFTP_APP_START_GET)
+            {
+                smTFTP = SM_TFTP_APP_SOCKET;
+                break;
+            }
+            TFTPUploadFragmentedRAMFileToHost((ROM uint8_t *) TFTP_SERVER, (ROM uint8_t *) fileName, putChunks);
+            smTFTP = SM_TFTP_APP_PUT;
+            break;
+
+        case SM_TFTP_APP_SOCKET:
+            // TFTPOpen() leaves the socket to the application
+            server.Val = MY_DEFAULT_GATE_BYTE1 | MY_DEFAULT_GATE_BYTE2 << 8ul |
+                    MY_DEFAULT_GATE_BYTE3 << 16ul | MY_DEFAULT_GATE_BYTE4 << 24ul;
+            // Port TFTP_CLIENT_PORT of tftp.c
+            _tftpSocket = UDPOpenEx(server.Val, UDP_OPEN_IP_ADDRESS, 65352u, 69u);
+            if (_tftpSocket == INVALID_UDP_SOCKET)
+                return Failed(TFTP_ERROR);
+            TFTPOpen(&server);
+            smTFTP = SM_TFTP_APP_OPEN;
+            break;
+
+        case SM_TFTP_APP_OPEN:
+            result = TFTPIsOpened();
+            if (result == TFTP_TIMEOUT)
+                return Failed(result);
+            if (result != TFTP_OK)
+                break;
+            TFTPOpenFile(fileName, TFTP_FILE_MODE_READ);
+            smTFTP = SM_TFTP_APP_GET;
+            break;
+
+        case SM_TFTP_APP_GET:
+            // Takes every byte that has arrived before the stack runs again
+            while ((result = TFTPIsGetReady()) == TFTP_OK)
+            {
+                dwSum = Sum(dwSum, TFTPGet());
+                dwBytes++;
+            }
+            if (result == TFTP_END_OF_FILE)
+                return Done("get");
+            if (result == TFTP_RETRY)
+            {
+                dwBytes = 0;
+                dwSum = 0;
+                TFTPOpenFile(fileName, TFTP_FILE_MODE_READ);
+            }
+            else if (result == TFTP_TIMEOUT || result == TFTP_ERROR)
+            {
+                return Failed(result);
+            }
+            break;
+
+        case SM_TFTP_APP_PUT:
+            status = TFTPGetUploadStatus();
+            if (status == TFTP_UPLOAD_COMPLETE)
+                return Done("put");
+            if (status < 0)
+                return Failed(status);
+            break;
+
+        default:
+            break;
+    }
+    return false;
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# TFTP server for the TFTP benchmark of tap_bench.py, on the host side of
+# the TAP device:
+#
+#   tftp_server.py <directory> [--no-options]
+#
+# Serves reads and writes of the files of the directory on 192.168.10.1:69,
+# one transfer at a time, with the blksize (RFC 2348) and windowsize
+# (RFC 7440) options the client asks for.  With --no-options it ignores
+# them, like the servers that tftp.c falls back to 512 byte blocks with, one
+# ACK per block.  Each transfer prints a line:
+#
+#   tftp_server: read|write <file> <bytes> bytes, blksize <n>, windowsize <n>
+#
+# Lost packets are resent after TIMEOUT seconds of silence, from the last
+# block acknowledged.
+
+import os
+import socket
+import struct
+import sys
+
+ADDRESS = ('192.168.10.1', 69)
+TIMEOUT = 1.0
+RETRIES = 10
+
+RRQ, WRQ, DATA, ACK, ERROR, OACK = 1, 2, 3, 4, 5, 6
+
+
+def options(fields, allowed):
+    """The blksize and windowsize asked for in fields, and the OACK."""
+    asked = dict((fields[i].decode().lower(), fields[i + 1].decode()) for i in range(0, len(fields) - 1, 2))
+    size, window, accepted = 512, 1, b''
+    if allowed and 'blksize' in asked:
+        size = min(int(asked['blksize']), 65464)
+        accepted += b'blksize\0%d\0' % size
+    if allowed and 'windowsize' in asked:
+        window = min(int(asked['windowsize']), 64)
+        accepted += b'windowsize\0%d\0' % window
+    return size, window, accepted
+
+
+def receive(s, peer):
+    """The opcode, block number and data of the next packet of peer, None on timeout."""
+    while True:
+        try:
+            packet, source = s.recvfrom(70000)
+        except socket.timeout:
+            return None
+        if source == peer and len(packet) >= 4:
+            opcode, block = struct.unpack('!HH', packet[:4])
+            return opcode, block, packet[4:]
+
+
+def read(s, peer, data, size, window, accepted):
+    blocks = len(data) // size + 1
+    if accepted:
+        for _ in range(RETRIES):
+            s.sendto(struct.pack('!H', OACK) + accepted, peer)
+            packet = receive(s, peer)
+            if packet is not None and packet[:2] == (ACK, 0):
+                break
+        else:
+            return False
+
+    # first: lowest block not acknowledged, from 1 to blocks
+    first, retries = 1, 0
+    while first <= blocks:
+        last = min(first + window, blocks + 1) - 1
+        for block in range(first, last + 1):
+            s.sendto(struct.pack('!HH', DATA, block & 0xFFFF) + data[(block - 1) * size:block * size], peer)
+        while True:
+            packet = receive(s, peer)
+            if packet is None:
+                retries += 1
+                if retries == RETRIES:
+                    return False
+                break
+            if packet[0] != ACK:
+                continue
+            block = first - 1 + ((packet[1] - (first - 1)) & 0xFFFF)
+            if first - 1 <= block <= last:
+                retries = 0
+                first = block + 1
+                break
+    return True
+
+
+def write(s, peer, path, size, window, accepted):
+    s.sendto(struct.pack('!H', OACK) + accepted if accepted else struct.pack('!HH', ACK, 0), peer)
+    data, expected, count, retries = bytearray(), 1, 0, 0
+    while True:
+        packet = receive(s, peer)
+        if packet is None or (packet[0] == DATA and packet[1] != expected & 0xFFFF):
+            # Timeout or gap: acknowledge the last block in order
+            retries = retries + 1 if packet is None else 0
+            if retries == RETRIES:
+                return False
+            s.sendto(struct.pack('!HH', ACK, (expected - 1) & 0xFFFF), peer)
+            count = 0
+            continue
+        if packet[0] != DATA:
+            continue
+        retries = 0
+        data += packet[2]
+        expected += 1
+        count += 1
+        if len(packet[2]) < size:
+            s.sendto(struct.pack('!HH', ACK, packet[1]), peer)
+            with open(path, 'wb') as f:
+                f.write(data)
+            return True
+        if count == window:
+            s.sendto(struct.pack('!HH', ACK, packet[1]), peer)
+            count = 0
+
+
+def main():
+    directory = sys.argv[1]
+    allowed = '--no-options' not in sys.argv[2:]
+    server = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(ADDRESS)
+    print('tftp_server: ready', flush=True)
+    while True:
+        request, peer = server.recvfrom(1500)
+        opcode = struct.unpack('!H', request[:2])[0]
+        fields = request[2:].split(b'\0')
+        name = os.path.basename(fields[0].decode())
+        size, window, accepted = options(fields[2:-1], allowed)
+
+        # A new port for each transfer (its TID)
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.bind((ADDRESS[0], 0))
+        s.settimeout(TIMEOUT)
+        path = os.path.join(directory, name)
+        if opcode == RRQ:
+            with open(path, 'rb') as f:
+                data = f.read()
+            done = read(s, peer, data, size, window, accepted)
+        elif opcode == WRQ:
+            done = write(s, peer, path, size, window, accepted)
+        else:
+            done = False
+        s.close()
+        print('tftp_server: %s %s %s, blksize %d, windowsize %d' %
+              ('read' if opcode == RRQ else 'write', name,
+               '%d bytes' % os.path.getsize(path) if done else 'failed', size, window), flush=True)
+
+
+if __name__ == '__main__':
+    main()
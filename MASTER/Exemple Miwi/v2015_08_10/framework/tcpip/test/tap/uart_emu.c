@@ -0,0 +1,246 @@
+/*******************************************************************************
+  UART emulation of the TAP host target
+
+  Summary:
+    Emulates the PIC32 UART2 of uart_to_tcp_bridge.c on a pty, for the UART
+    bridge checks of tap_check.py.
+
+  Description:
+    With TAP_UART=<terminal>, the UART is wired to that terminal, the slave
+    of a pty whose master the check holds, at TAP_UART_BAUD (115200 by
+    default, 10 bits per byte) rather than at the rate of UBRG.  A timer
+    signal every UART_EMU_PERIOD_US stands for the UART clock: it moves the
+    bytes due since the last signal between the terminal and the 4 byte
+    buffers of the UART, then calls the interrupt handlers of the bridge,
+    _U2RXInterrupt() and _U2TXInterrupt(), when their flag and enable bits
+    are set.  A byte received while the RX buffer is full sets OERR and is
+    lost, like on the PIC.
+
+    UART2TCPBridgeTask() clears the enable bits around its FIFO pointer
+    updates: a signal that comes then does nothing, the next one moves the
+    bytes it left, as the PIC would hold the interrupt.  RTS and CTS are
+    wired (see system_config.h): the terminal side stops sending while RTS
+    is released only with TAP_UART_FLOW set, and always leaves CTS
+    asserted.
+
+    On exit, main.c prints:
+
+      uart rx <bytes received> overruns <bytes lost> tx <bytes sent>
+ *******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Not tcpip.h: the gethostname() of berkeley_api.h differs from unistd.h
+#include "system_config.h"
+#include "tcpip/uart_to_tcp_bridge.h"
+
+// Period of the timer signal
+#define UART_EMU_PERIOD_US  (250u)
+
+// Bytes held by the RX and TX buffers of the UART
+#define UART_EMU_DEPTH      (4u)
+
+// Longest a late signal catches up: beyond it the line was idle
+#define UART_EMU_LATE_NS    (5000000ull)
+
+TAP_IEC1BITS IEC1bits;
+TAP_IFS1BITS IFS1bits = {0, 1};
+TAP_U2STABITS U2STAbits;
+TAP_IPC8BITS IPC8bits;
+volatile uint32_t UMODE, USTA, UBRG;
+volatile uint8_t TapUARTTXTris, TapUARTRXTris;
+volatile uint8_t TapUARTRTS = 1, TapUARTRTSTris = 1, TapUARTCTS, TapUARTCTSTris;
+
+void _U2RXInterrupt(void);
+void _U2TXInterrupt(void);
+
+static int fd = -1;
+static bool flow;
+static uint64_t byteNs, nextByte;
+static uint8_t rxBuffer[UART_EMU_DEPTH], txBuffer[UART_EMU_DEPTH];
+static volatile unsigned int rxCount, txCount;
+static uint8_t remote[64];
+static unsigned int remoteLength, remotePosition;
+static uint8_t txLine[256];
+static unsigned int txLineLength;
+static unsigned long rxBytes, overruns, txBytes;
+
+static uint64_t Nanoseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// U2RXREG
+uint8_t TapUARTRead(void)
+{
+    uint8_t b = rxBuffer[0];
+
+    if (rxCount == 0u)
+        return 0;
+    memmove(rxBuffer, rxBuffer + 1, UART_EMU_DEPTH - 1u);
+    rxCount--;
+    U2STAbits.URXDA = rxCount != 0u;
+    return b;
+}
+
+// U2TXREG, a byte written with UTXBF set is lost
+volatile uint8_t *TapUARTWrite(void)
+{
+    static volatile uint8_t overflow;
+
+    if (txCount == UART_EMU_DEPTH)
+        return &overflow;
+    U2STAbits.UTXBF = txCount + 1u == UART_EMU_DEPTH;
+    return (volatile uint8_t *) &txBuffer[txCount++];
+}
+
+// One byte time of the receiver: the byte the terminal sends, if any
+static void Receive(void)
+{
+    ssize_t n;
+
+    if (flow && TapUARTRTS)
+        return;
+    if (remotePosition == remoteLength)
+    {
+        n = read(fd, remote, sizeof (remote));
+        remoteLength = n > 0 ? (unsigned int) n : 0u;
+        remotePosition = 0;
+    }
+    if (remotePosition == remoteLength)
+        return;
+
+    rxBytes++;
+    if (U2STAbits.OERR || rxCount == UART_EMU_DEPTH)
+    {
+        U2STAbits.OERR = 1;
+        overruns++;
+        remotePosition++;
+        return;
+    }
+    rxBuffer[rxCount++] = remote[remotePosition++];
+    U2STAbits.URXDA = 1;
+    IFS1bits.U2RXIF = 1;
+}
+
+// One byte time of the transmitter
+static void Transmit(void)
+{
+    if (txCount == 0u)
+        return;
+    txLine[txLineLength++] = txBuffer[0];
+    memmove(txBuffer, txBuffer + 1, UART_EMU_DEPTH - 1u);
+    txCount--;
+    U2STAbits.UTXBF = 0;
+    IFS1bits.U2TXIF = 1;
+    txBytes++;
+}
+
+static void Clock(int signal)
+{
+    int saved = errno;
+    uint64_t now = Nanoseconds();
+
+    if (!IEC1bits.U2RXIE)
+    {
+        errno = saved;
+        return;
+    }
+    if (nextByte < now && now - nextByte > UART_EMU_LATE_NS)
+        nextByte = now - UART_EMU_LATE_NS;
+
+    while (nextByte <= now)
+    {
+        nextByte += byteNs;
+        Receive();
+        Transmit();
+        if (IEC1bits.U2RXIE && IFS1bits.U2RXIF)
+            _U2RXInterrupt();
+        if (IEC1bits.U2TXIE && IFS1bits.U2TXIF)
+            _U2TXInterrupt();
+        if (txLineLength == sizeof (txLine))
+        {
+            if (write(fd, txLine, txLineLength) < 0)
+                perror("uart_emu: write");
+            txLineLength = 0;
+        }
+    }
+    if (txLineLength != 0u && write(fd, txLine, txLineLength) < 0)
+        perror("uart_emu: write");
+    txLineLength = 0;
+    errno = saved;
+}
+
+/*****************************************************************************
+  Function:
+    bool TapUARTStart(void)
+
+  Summary:
+    Wires the UART to TAP_UART, if set, and initializes the bridge.
+
+  Returns:
+    true if the UART runs, false otherwise
+ ***************************************************************************/
+bool TapUARTStart(void)
+{
+    const char *path = getenv("TAP_UART");
+    const char *baud = getenv("TAP_UART_BAUD");
+    struct termios raw;
+    struct sigaction action;
+    struct sigevent event;
+    struct itimerspec period;
+    timer_t timer;
+
+    if (path == NULL)
+        return false;
+    fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    if (tcgetattr(fd, &raw) == 0)
+    {
+        cfmakeraw(&raw);
+        tcsetattr(fd, TCSANOW, &raw);
+    }
+    flow = getenv("TAP_UART_FLOW") != NULL;
+    byteNs = 10000000000ull / (baud != NULL ? strtoul(baud, NULL, 10) : 115200ul);
+    nextByte = Nanoseconds();
+    UART2TCPBridgeInit();
+
+    memset(&action, 0, sizeof (action));
+    action.sa_handler = Clock;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGRTMIN, &action, NULL);
+
+    memset(&event, 0, sizeof (event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGRTMIN;
+    memset(&period, 0, sizeof (period));
+    period.it_interval.tv_nsec = UART_EMU_PERIOD_US * 1000l;
+    period.it_value = period.it_interval;
+    return timer_create(CLOCK_MONOTONIC, &event, &timer) == 0 && timer_settime(timer, 0, &period, NULL) == 0;
+}
+
+/*****************************************************************************
+  Function:
+    void TapUARTPrint(void)
+
+  Summary:
+    Prints the byte counts of the UART for tap_check.py.
+ ***************************************************************************/
+void TapUARTPrint(void)
+{
+    printf("uart rx %lu overruns %lu tx %lu\n", rxBytes, overruns, txBytes);
+}
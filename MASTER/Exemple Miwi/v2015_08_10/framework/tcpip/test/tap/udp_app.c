@@ -0,0 +1,152 @@
+/*******************************************************************************
+  UDP receivers of the TAP host target
+
+  Summary:
+    Reads datagrams in the three ways that udp.c allows, for the UDP RX
+    queue check of tap_check.py.
+
+  Description:
+    With TAP_UDP_APP set, three server sockets are opened:
+    - UDP_APP_ECHO_PORT answers each datagram with its data.  It reads one
+      datagram per call with UDPIsGetReady() and UDPGetArray(), like the
+      demo servers, and udp.c releases it on the next StackTask().
+    - UDP_APP_IDLE_PORT is never read: udp.c drops its datagrams after
+      UDP_RX_TIMEOUT.
+    - UDP_APP_HOLD_PORT takes its datagrams with UDPGetDatagrams() and
+      keeps them for UDP_APP_HOLD, longer than UDP_RX_TIMEOUT, before it
+      checks their data and releases them.  Each one holds its number, then
+      bytes of Pattern().
+
+    The frames of the sockets are interleaved in the MAC RX buffer, so they
+    are released out of order.  On exit, main.c prints:
+
+      udp_app echoed <datagrams> held <datagrams> bad <held datagrams whose data changed>
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "system_config.h"
+#include "tcpip/tcpip.h"
+
+#define UDP_APP_ECHO_PORT   (7u)
+#define UDP_APP_IDLE_PORT   (5001u)
+#define UDP_APP_HOLD_PORT   (5002u)
+
+// How long the datagrams of UDP_APP_HOLD_PORT are kept, UDP_RX_TIMEOUT of
+// udp.c is half a second
+#define UDP_APP_HOLD        (TICK_SECOND)
+
+// Datagrams kept at once, UDP_RX_QUEUE_DEPTH of udp.c
+#define UDP_APP_HOLD_BATCH  (4u)
+
+static UDP_SOCKET echoSocket = INVALID_UDP_SOCKET;
+static UDP_SOCKET idleSocket = INVALID_UDP_SOCKET;
+static UDP_SOCKET holdSocket = INVALID_UDP_SOCKET;
+static UDP_DATAGRAM held[UDP_APP_HOLD_BATCH];
+static uint8_t heldCount;
+static uint32_t dwHeldSince;
+static unsigned long echoed, heldTotal, heldBad;
+
+// Data of the datagrams of UDP_APP_HOLD_PORT after their number, which
+// tap_check.py sends too
+static uint8_t Pattern(uint32_t number, uint16_t i)
+{
+    return (uint8_t) (number * 7u + i);
+}
+
+static void Echo(void)
+{
+    uint8_t data[1472];
+    uint16_t w;
+
+    w = UDPIsGetReady(echoSocket);
+    if (w == 0u)
+        return;
+    if (w > sizeof (data))
+        w = sizeof (data);
+    UDPGetArray(data, w);
+
+    // The socket took the sender as remote node when the datagram was read
+    if (UDPIsPutReady(echoSocket) < w)
+        return;
+    UDPPutArray(data, w);
+    UDPFlush();
+    echoed++;
+}
+
+static void Hold(void)
+{
+    uint8_t data[1472];
+    uint32_t number;
+    uint16_t w, i;
+    uint8_t n;
+
+    if (heldCount == 0u)
+    {
+        heldCount = UDPGetDatagrams(holdSocket, held, UDP_APP_HOLD_BATCH);
+        dwHeldSince = TickGet();
+        return;
+    }
+    if (TickGet() - dwHeldSince < UDP_APP_HOLD)
+        return;
+
+    for (n = 0; n < heldCount; n++)
+    {
+        w = UDPGetDatagramArray(&held[n], 0, data, sizeof (data));
+        memcpy((void *) &number, (const void *) data, sizeof (number));
+        for (i = sizeof (number); i < w && data[i] == Pattern(number, i); i++);
+        if (w < sizeof (number) || i != w || w != held[n].wLength)
+            heldBad++;
+        heldTotal++;
+    }
+    UDPReleaseDatagrams(holdSocket, heldCount);
+    heldCount = 0;
+}
+
+/*****************************************************************************
+  Function:
+    bool TapUDPStart(void)
+
+  Summary:
+    Opens the sockets if TAP_UDP_APP is set.
+
+  Returns:
+    true if the sockets were opened, false otherwise
+ ***************************************************************************/
+bool TapUDPStart(void)
+{
+    if (getenv("TAP_UDP_APP") == NULL)
+        return false;
+
+    echoSocket = UDPOpenEx(0, UDP_OPEN_SERVER, UDP_APP_ECHO_PORT, 0);
+    idleSocket = UDPOpenEx(0, UDP_OPEN_SERVER, UDP_APP_IDLE_PORT, 0);
+    holdSocket = UDPOpenEx(0, UDP_OPEN_SERVER, UDP_APP_HOLD_PORT, 0);
+    return echoSocket != INVALID_UDP_SOCKET && idleSocket != INVALID_UDP_SOCKET &&
+            holdSocket != INVALID_UDP_SOCKET;
+}
+
+/*****************************************************************************
+  Function:
+    void TapUDPTask(void)
+
+  Summary:
+    Reads the datagrams, called by main.c after StackApplications().
+ ***************************************************************************/
+void TapUDPTask(void)
+{
+    Echo();
+    Hold();
+}
+
+/*****************************************************************************
+  Function:
+    void TapUDPPrint(void)
+
+  Summary:
+    Prints the counters for tap_check.py.
+ ***************************************************************************/
+void TapUDPPrint(void)
+{
+    printf("udp_app echoed %lu held %lu bad %lu\n", echoed, heldTotal, heldBad);
+}
@@ -0,0 +1,34 @@
+/*******************************************************************************
+  Stand-in for tcpip.h in wifi_reconnect_test
+
+  Summary:
+    What the connection manager, connection algorithm, connection profile
+    and scan modules of the MRF24W driver take from the stack.
+
+  Description:
+    The real tcpip.h pulls in the drv_wifi_config.h of a WiFi demo through
+    stack_task.h.  The Makefile puts this directory first on the include
+    path of wifi_reconnect_test only, which supplies TickGet() and
+    StackGetIdleTime().
+ *******************************************************************************/
+
+#ifndef __TCPIP_H_
+#define __TCPIP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WF_CS_TRIS
+#define MRF24WG
+#define WF_USE_SCAN_FUNCTIONS
+#define WF_USE_FAST_RECONNECT
+
+#define ROM                 const
+#define TICK_SECOND         (1000ul)
+
+uint32_t TickGet(void);
+uint32_t StackGetIdleTime(void);
+
+#endif
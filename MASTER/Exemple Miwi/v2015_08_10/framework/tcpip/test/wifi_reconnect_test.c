@@ -0,0 +1,545 @@
+/*******************************************************************************
+  Reconnection test of the MRF24W connection manager
+
+  Summary:
+    Runs the connection manager of the MRF24W driver on a Linux host against
+    a model of the management messages of the MRF24WG, and compares the time
+    to IP of WF_CMConnect() and WF_CMFastConnect() after a link loss.
+
+  Description:
+    drv_wifi_connection_manager.c, drv_wifi_connection_algorithm.c,
+    drv_wifi_connection_profile.c and drv_wifi_scan.c are built as they are,
+    with wifi/tcpip/tcpip.h for the stack.  The test stands in for
+    SendMgmtMsg() and the functions that read the replies: the module keeps
+    the connection algorithm and profile elements that it is sent, and
+    answers the connect and scan messages from a model of the air, in steps
+    of 1 ms of TickGet():
+    - 3 access points of the network "lab": channel 6, RSSI 100; channel 11,
+      RSSI 80; channel 1, RSSI 70.
+    - An active scan takes the max channel time on a channel with an access
+      point, the min channel time elsewhere, 400 and 200 ms as set by the
+      application on the 11 channels.
+    - A connection takes a scan of the channel list then ASSOC_MS, to the
+      strongest access point found; with WF_RETRY_FOREVER the list is
+      scanned up to MAX_LIST_SCANS times.
+    - The loss of an access point is seen after BEACON_TMO_MS.  The address
+      is renewed DHCP_MS after the link is back.
+
+    At 60 s, the link is lost in one of three ways:
+    - deauthentication, the access point stays up;
+    - the access point of channel 6 reboots, back 300 ms after the beacon
+      timeout;
+    - it is gone for good, the connection roams to channel 11.
+
+    Each scenario is run in a child process, since the modules keep their
+    state in static variables, with the reconnection of the MRF24W
+    (WF_CMConnect(), the actions set to WF_ATTEMPT_TO_RECONNECT) and with
+    WF_CMFastConnect() and WFFastReconnectTask().  The test checks that the
+    link comes back, to the strongest access point left, that the fast
+    reconnection is quicker, and that its background scans keep the module
+    busy less than MAX_SCAN_SHARE percent of the connected time.  It prints
+    the time from the detection of the loss to IP, and the share of the
+    background scans.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tcpip/tcpip.h"
+#include "drv_wifi_mac.h"
+
+#define ASSOC_MS        (80ul)      // authentication, association and 4-way handshake
+#define BEACON_TMO_MS   (4096ul)    // 40 beacons of 102.4 ms
+#define DHCP_MS         (50ul)      // lease renewal on the LAN
+#define MAX_LIST_SCANS  (20)        // stands for WF_RETRY_FOREVER
+
+#define LOSS_MS         (60000ul)
+#define END_MS          (120000ul)
+#define MAX_SCAN_SHARE  (5.0)
+
+extern void WFFastReconnectEvent(uint8_t event, uint16_t eventInfo);
+extern void WFFastReconnectTask(void);
+
+#define NO_AP           (0xff)
+#define AP_COUNT        (3)
+
+typedef struct
+{
+    uint8_t bssid[WF_BSSID_LENGTH];
+    uint8_t channel;
+    uint8_t rssi;
+    uint32_t down;          // TickGet() of the loss
+    uint32_t up;            // and of the return
+} AP;
+
+typedef struct
+{
+    uint32_t t;
+    uint8_t event;
+    uint16_t info;
+    uint8_t ap;
+} EVENT;
+
+typedef struct
+{
+    bool linked;
+    uint8_t ap;
+    double detected;        // s from the loss
+    double ip;              // s from the detection
+    double scanShare;       // % of the connected time before the loss
+} RESULT;
+
+enum
+{
+    SCENARIO_DEAUTH = 0,
+    SCENARIO_REBOOT,
+    SCENARIO_GONE,
+    SCENARIO_COUNT
+};
+
+static const char *scenarioNames[SCENARIO_COUNT] = {"deauthentication", "access point reboot", "access point gone"};
+
+static AP aps[AP_COUNT] = {
+    {{0x00, 0x04, 0xa3, 0x00, 0x00, 0x01}, 6, 100, 0xfffffffful, 0xfffffffful},
+    {{0x00, 0x04, 0xa3, 0x00, 0x00, 0x02}, 11, 80, 0xfffffffful, 0xfffffffful},
+    {{0x00, 0x04, 0xa3, 0x00, 0x00, 0x03}, 1, 70, 0xfffffffful, 0xfffffffful},
+};
+
+static int failures;
+static uint32_t now;
+static int scenario;
+static bool fast;
+
+// Elements kept by the module
+static uint8_t caElements[WF_CA_ELEMENT_DTIM_INTERVAL + 1][WF_CHANNEL_LIST_LENGTH];
+static uint8_t caLengths[WF_CA_ELEMENT_DTIM_INTERVAL + 1];
+static uint8_t cpElements[WF_MAX_NUM_CPID + 1][WF_CP_ELEMENT_READ_WPS_CRED + 1][WF_MAX_SECURITY_KEY_LENGTH];
+static uint8_t cpLengths[WF_MAX_NUM_CPID + 1][WF_CP_ELEMENT_READ_WPS_CRED + 1];
+static uint8_t reply[128];
+static uint8_t state = WF_CSTATE_NOT_CONNECTED;
+static uint8_t cpId;
+static uint8_t currentAp = NO_AP;
+static tWFScanResult results[AP_COUNT];
+static uint8_t resultCount;
+static uint32_t scanBusy;
+
+static EVENT events[8];
+static int eventCount;
+static uint32_t lossSeen, linked;
+
+/****************************************************************************
+  Stack
+ ***************************************************************************/
+
+uint32_t TickGet(void)
+{
+    return now;
+}
+
+// No stack timer is pending, background scans may start
+uint32_t StackGetIdleTime(void)
+{
+    return 0xfffffffful;
+}
+
+void WF_AssertionFailed(uint8_t moduleNumber, uint16_t lineNumber)
+{
+    printf("wifi_reconnect_test: FAILED: assertion in module %u line %u\n", moduleNumber, lineNumber);
+    exit(1);
+}
+
+/****************************************************************************
+  Module
+ ***************************************************************************/
+
+static bool APUp(int i, uint32_t t)
+{
+    return t < aps[i].down || t >= aps[i].up;
+}
+
+static uint16_t CAWord(uint8_t element)
+{
+    return (uint16_t) (caElements[element][0] << 8 | caElements[element][1]);
+}
+
+static bool AnyBssid(uint8_t id)
+{
+    static const uint8_t broadcast[WF_BSSID_LENGTH] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+    return cpLengths[id][WF_CP_ELEMENT_BSSID] == 0u ||
+            memcmp(cpElements[id][WF_CP_ELEMENT_BSSID], broadcast, WF_BSSID_LENGTH) == 0;
+}
+
+static void Post(uint32_t t, uint8_t event, uint16_t info, uint8_t ap)
+{
+    events[eventCount].t = t;
+    events[eventCount].event = event;
+    events[eventCount].info = info;
+    events[eventCount].ap = ap;
+    eventCount++;
+}
+
+// Scans the channel list from t for the access points of the profile,
+// returns the duration
+static uint32_t Scan(uint8_t id, uint32_t t)
+{
+    uint8_t *channels = caElements[WF_CA_ELEMENT_CHANNEL_LIST];
+    uint32_t duration = 0;
+    bool found;
+    int i, j;
+
+    resultCount = 0;
+    for (i = 0; i < caLengths[WF_CA_ELEMENT_CHANNEL_LIST]; i++)
+    {
+        found = false;
+        for (j = 0; j < AP_COUNT; j++)
+        {
+            if (aps[j].channel != channels[i] || !APUp(j, t + duration))
+                continue;
+            if (!AnyBssid(id) && memcmp(cpElements[id][WF_CP_ELEMENT_BSSID], aps[j].bssid, WF_BSSID_LENGTH) != 0)
+                continue;
+            found = true;
+            memset(&results[resultCount], 0, sizeof (results[0]));
+            memcpy(results[resultCount].bssid, aps[j].bssid, WF_BSSID_LENGTH);
+            memcpy(results[resultCount].ssid, "lab", 3);
+            results[resultCount].ssidLen = 3;
+            results[resultCount].channel = aps[j].channel;
+            results[resultCount].rssi = aps[j].rssi;
+            results[resultCount].bssType = WF_INFRASTRUCTURE;
+            resultCount++;
+        }
+        duration += CAWord(found ? WF_CA_ELEMENT_MAX_CHANNEL_TIME : WF_CA_ELEMENT_MIN_CHANNEL_TIME);
+    }
+    return duration;
+}
+
+// Connects from t to the strongest access point found, posts okEvent or
+// failEvent when done
+static void Connect(uint32_t t, uint8_t id, uint8_t okEvent, uint8_t failEvent)
+{
+    int scans = caElements[WF_CA_ELEMENT_LIST_RETRY_COUNT][0];
+    int i, best;
+
+    if (scans == WF_RETRY_FOREVER || scans > MAX_LIST_SCANS)
+        scans = MAX_LIST_SCANS;
+    if (scans == 0)
+        scans = 1;
+    cpId = id;
+
+    while (scans-- > 0)
+    {
+        t += Scan(id, t);
+        best = -1;
+        for (i = 0; i < resultCount; i++)
+        {
+            if (best < 0 || results[i].rssi > results[best].rssi)
+                best = i;
+        }
+        if (best < 0)
+            continue;
+        for (i = 0; i < AP_COUNT; i++)
+        {
+            if (memcmp(aps[i].bssid, results[best].bssid, WF_BSSID_LENGTH) == 0)
+                break;
+        }
+        Post(t + ASSOC_MS, okEvent, 0, (uint8_t) i);
+        return;
+    }
+    Post(t, failEvent, 0, NO_AP);
+}
+
+void SendMgmtMsg(uint8_t *p_header, uint8_t headerLength, uint8_t *p_data, uint8_t dataLength)
+{
+    uint32_t duration;
+
+    (void) headerLength;
+    memset(reply, 0, sizeof (reply));
+    reply[0] = WF_MGMT_CONFIRM_TYPE;
+    reply[1] = p_header[1];
+    reply[2] = WF_SUCCESS;
+
+    switch (p_header[1])
+    {
+    case WF_CA_SET_ELEMENT_SUBTYPE:
+        memcpy(caElements[p_header[2]], p_data, dataLength);
+        caLengths[p_header[2]] = dataLength;
+        break;
+
+    case WF_CA_GET_ELEMENT_SUBTYPE:
+        reply[4] = p_header[2];
+        reply[5] = caLengths[p_header[2]];
+        memcpy(&reply[6], caElements[p_header[2]], caLengths[p_header[2]]);
+        break;
+
+    case WF_CP_SET_ELEMENT_SUBTYPE:
+        memcpy(cpElements[p_header[2]][p_header[3]], p_data, dataLength);
+        cpLengths[p_header[2]][p_header[3]] = dataLength;
+        break;
+
+    case WF_CP_GET_ELEMENT_SUBTYPE:
+        reply[4] = p_header[2];
+        reply[5] = p_header[3];
+        reply[6] = cpLengths[p_header[2]][p_header[3]];
+        memcpy(&reply[7], cpElements[p_header[2]][p_header[3]], cpLengths[p_header[2]][p_header[3]]);
+        break;
+
+    case WF_CM_CONNECT_SUBYTPE:
+        state = WF_CSTATE_CONNECTION_IN_PROGRESS;
+        Connect(now, p_header[2], WF_EVENT_CONNECTION_SUCCESSFUL, WF_EVENT_CONNECTION_FAILED);
+        break;
+
+    case WF_CM_DISCONNECT_SUBYTPE:
+        state = WF_CSTATE_NOT_CONNECTED;
+        break;
+
+    case WF_CM_GET_CONNECTION_STATUS_SUBYTPE:
+        reply[4] = state;
+        reply[5] = cpId;
+        break;
+
+    case WF_SCAN_START_SUBTYPE:
+        duration = Scan(p_header[2], now);
+        scanBusy += duration;
+        Post(now + duration, WF_EVENT_SCAN_RESULTS_READY, resultCount, NO_AP);
+        break;
+
+    case WF_SCAN_GET_RESULTS_SUBTYPE:
+        reply[4] = 1;
+        memcpy(&reply[5], &results[p_header[2]], sizeof (tWFScanResult));
+        break;
+
+    default:
+        printf("wifi_reconnect_test: FAILED: management message %u not modelled\n", p_header[1]);
+        exit(1);
+    }
+}
+
+void WaitForMgmtResponse(uint8_t expectedSubtype, uint8_t freeAction)
+{
+    (void) expectedSubtype;
+    (void) freeAction;
+}
+
+void WaitForMgmtResponseAndReadData(uint8_t expectedSubtype, uint8_t numDataBytes, uint8_t startIndex,
+        uint8_t *p_data)
+{
+    (void) expectedSubtype;
+    memcpy(p_data, &reply[startIndex], numDataBytes);
+}
+
+void RawRead(uint8_t rawId, uint16_t startIndex, uint16_t length, uint8_t *p_dest)
+{
+    (void) rawId;
+    memcpy(p_dest, &reply[startIndex], length);
+}
+
+void DeallocateMgmtRxBuffer(void)
+{
+}
+
+void SendGetParamMsg(uint8_t paramType, uint8_t *p_paramData, uint8_t paramDataLength)
+{
+    tWFConnectContext context;
+
+    (void) paramType;
+    (void) paramDataLength;
+    memset(&context, 0, sizeof (context));
+    if (currentAp != NO_AP)
+    {
+        context.channel = aps[currentAp].channel;
+        memcpy(context.bssid, aps[currentAp].bssid, WF_BSSID_LENGTH);
+    }
+    memcpy(p_paramData, &context, sizeof (context));
+}
+
+/****************************************************************************
+  Air
+ ***************************************************************************/
+
+// Delivers the events due, as WFProcessMgmtIndicateMsg() does
+static void Deliver(void)
+{
+    EVENT e;
+    int i;
+
+    for (i = 0; i < eventCount; i++)
+    {
+        if (events[i].t > now)
+            continue;
+        e = events[i];
+        events[i--] = events[--eventCount];
+
+        switch (e.event)
+        {
+        case WF_EVENT_CONNECTION_SUCCESSFUL:
+        case WF_EVENT_CONNECTION_REESTABLISHED:
+            if (!APUp(e.ap, now))
+            {
+                // Gone during the handshake
+                e.event = WF_EVENT_CONNECTION_FAILED;
+                state = WF_CSTATE_NOT_CONNECTED;
+                break;
+            }
+            state = WF_CSTATE_CONNECTED_INFRASTRUCTURE;
+            currentAp = e.ap;
+            if (lossSeen != 0u && linked == 0u)
+                linked = now;
+            break;
+
+        case WF_EVENT_CONNECTION_FAILED:
+        case WF_EVENT_CONNECTION_PERMANENTLY_LOST:
+            state = WF_CSTATE_NOT_CONNECTED;
+            currentAp = NO_AP;
+            break;
+        }
+        if (fast)
+            WFFastReconnectEvent(e.event, e.info);
+    }
+}
+
+// The MRF24W reconnects by itself or reports the loss, as the action of
+// the connection algorithm says
+static void Lose(uint8_t action)
+{
+    lossSeen = now;
+    currentAp = NO_AP;
+    if (caElements[action][0] == WF_ATTEMPT_TO_RECONNECT)
+    {
+        state = WF_CSTATE_RECONNECTION_IN_PROGRESS;
+        if (fast)
+            WFFastReconnectEvent(WF_EVENT_CONNECTION_TEMPORARILY_LOST, 0);
+        Connect(now, cpId, WF_EVENT_CONNECTION_REESTABLISHED, WF_EVENT_CONNECTION_PERMANENTLY_LOST);
+    }
+    else
+    {
+        state = WF_CSTATE_NOT_CONNECTED;
+        Post(now, WF_EVENT_CONNECTION_PERMANENTLY_LOST, 0, NO_AP);
+    }
+}
+
+static void Watch(void)
+{
+    if (state != WF_CSTATE_CONNECTED_INFRASTRUCTURE || currentAp == NO_AP || lossSeen != 0u)
+        return;
+    if (scenario == SCENARIO_DEAUTH && now == LOSS_MS)
+        Lose(WF_CA_ELEMENT_DEAUTH_ACTION);
+    else if (!APUp(currentAp, now) && now - aps[currentAp].down >= BEACON_TMO_MS)
+        Lose(WF_CA_ELEMENT_BEACON_TIMEOUT_ACTION);
+}
+
+static RESULT Run(void)
+{
+    static const uint8_t channels[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    static const uint8_t broadcast[WF_BSSID_LENGTH] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    RESULT result;
+
+    if (scenario != SCENARIO_DEAUTH)
+        aps[0].down = LOSS_MS;
+    if (scenario == SCENARIO_REBOOT)
+        aps[0].up = LOSS_MS + BEACON_TMO_MS + 300ul;
+
+    // Configuration of the demos
+    WF_CASetChannelList((uint8_t *) channels, sizeof (channels));
+    WF_CASetScanType(WF_ACTIVE_SCAN);
+    WF_CASetListRetryCount(WF_RETRY_FOREVER);
+    WF_CASetBeaconTimeoutAction(WF_ATTEMPT_TO_RECONNECT);
+    WF_CASetDeauthAction(WF_ATTEMPT_TO_RECONNECT);
+    WF_CASetMinChannelTime(200);
+    WF_CASetMaxChannelTime(400);
+    WF_CPSetSsid(1, (uint8_t *) "lab", 3);
+    WF_CPSetBssid(1, (uint8_t *) broadcast);
+
+    if (fast)
+        WF_CMFastConnect(1);
+    else
+        WF_CMConnect(1);
+
+    for (now = 0; now < END_MS && linked == 0u; now++)
+    {
+        Deliver();
+        Watch();
+        if (fast)
+            WFFastReconnectTask();
+    }
+
+    result.linked = linked != 0u;
+    result.ap = currentAp;
+    result.detected = (lossSeen - LOSS_MS) / 1000.0;
+    result.ip = (linked + DHCP_MS - lossSeen) / 1000.0;
+    result.scanShare = scanBusy * 100.0 / LOSS_MS;
+    return result;
+}
+
+/****************************************************************************
+  Tests
+ ***************************************************************************/
+
+static void Check(bool ok, const char *what, int n, bool withFast)
+{
+    if (!ok)
+    {
+        printf("wifi_reconnect_test: FAILED: %s, %s, %s\n", what, scenarioNames[n], withFast ? "fast" : "base");
+        failures++;
+    }
+}
+
+// Runs a scenario in a child process, which starts with the modules and the
+// model as they are before Run()
+static RESULT Fork(int n, bool withFast)
+{
+    RESULT result;
+    int fds[2];
+    pid_t pid;
+
+    memset(&result, 0, sizeof (result));
+    fflush(stdout);
+    if (pipe(fds) != 0 || (pid = fork()) < 0)
+    {
+        perror("wifi_reconnect_test");
+        exit(1);
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        scenario = n;
+        fast = withFast;
+        result = Run();
+        _exit(write(fds[1], &result, sizeof (result)) == sizeof (result) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (read(fds[0], &result, sizeof (result)) != sizeof (result))
+        result.linked = false;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return result;
+}
+
+int main(void)
+{
+    RESULT base, fastResult;
+    int n;
+
+    for (n = 0; n < SCENARIO_COUNT; n++)
+    {
+        base = Fork(n, false);
+        fastResult = Fork(n, true);
+
+        Check(base.linked, "no link", n, false);
+        Check(fastResult.linked, "no link", n, true);
+        // The strongest access point up: the one of channel 6 is down when
+        // the loss is seen, unless deauthenticated
+        Check(base.ap == 0 || (n != SCENARIO_DEAUTH && base.ap == 1), "wrong access point", n, false);
+        Check(fastResult.ap == 0 || (n != SCENARIO_DEAUTH && fastResult.ap == 1), "wrong access point", n, true);
+        Check(fastResult.ip < base.ip, "not quicker", n, true);
+        Check(fastResult.scanShare < MAX_SCAN_SHARE, "background scans too long", n, true);
+
+        printf("wifi_reconnect_test: %s, loss seen after %.2f s, IP after %.2f s, %.2f s with "
+                "WF_CMFastConnect() (background scans %.1f%% of the time)\n", scenarioNames[n],
+                base.detected, base.ip, fastResult.ip, fastResult.scanShare);
+    }
+
+    printf("wifi_reconnect_test: %s\n", failures ? "FAILED" : "link losses, reconnection and roaming passed");
+    return failures ? 1 : 0;
+}
@@ -57,6 +57,25 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #error Retry count must at least be 1
 #endif
 
+// Largest block size asked for with the blksize option (RFC 2348).  1432
+// bytes fit in an Ethernet frame, 512 disables the option.  tftp.c asks for
+// 512 byte blocks when the MAC RX buffer (RXSIZE) cannot hold two of these.
+#if !defined(TFTP_BLOCK_SIZE_MAX)
+#define TFTP_BLOCK_SIZE_MAX  (1432u)
+#endif
+
+// Number of blocks sent between two ACKs, asked for with the windowsize
+// option (RFC 7440).  A download needs room for as many blocks in the MAC
+// RX buffer: tftp.c asks for fewer when RXSIZE cannot hold them.  1 disables
+// the option.
+#if !defined(TFTP_WINDOW_SIZE)
+#define TFTP_WINDOW_SIZE  (4u)
+#endif
+
+#if TFTP_BLOCK_SIZE_MAX < 512u || TFTP_WINDOW_SIZE < 1u
+#error TFTP_BLOCK_SIZE_MAX must be at least 512 and TFTP_WINDOW_SIZE at least 1
+#endif
+
 // Enum. of results returned by most of the TFTP functions.
 typedef enum _TFTP_RESULT {
     TFTP_OK = 0,
@@ -83,7 +102,8 @@ typedef enum _TFTP_ACCESS_ERROR {
     TFTP_ERROR_INVALID_OPERATION,
     TFTP_ERROR_UNKNOWN_TID,
     TFTP_ERROR_FILE_EXISTS,
-    TFTP_ERROR_NO_SUCH_USE
+    TFTP_ERROR_NO_SUCH_USE,
+    TFTP_ERROR_OPTION_NEGOTIATION // RFC 2347, also set when the server returns options we did not ask for
 } TFTP_ACCESS_ERROR;
 
 // Status codes for TFTPGetUploadStatus() function.  Zero means upload success, >0 means working and <0 means fatal error.
@@ -43,6 +43,36 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #ifndef __UART2TCPBRIDGE_H_
 #define __UART2TCPBRIDGE_H_
 
+// Sizes of the FIFOs between the UART interrupts and the TCP socket.  The RX
+// FIFO holds what the UART receives while StackTask() is busy elsewhere, ex:
+// 20ms of SSL work at 115200 baud is 230 bytes.  One byte of each FIFO is
+// left unused to tell a full FIFO from an empty one.
+#if !defined(UART2TCPBRIDGE_RX_FIFO_SIZE)
+#if defined(__XC8)
+#define UART2TCPBRIDGE_RX_FIFO_SIZE     (65u)
+#else
+#define UART2TCPBRIDGE_RX_FIFO_SIZE     (1025u)
+#endif
+#endif
+
+#if !defined(UART2TCPBRIDGE_TX_FIFO_SIZE)
+#if defined(__XC8)
+#define UART2TCPBRIDGE_TX_FIFO_SIZE     (17u)
+#else
+#define UART2TCPBRIDGE_TX_FIFO_SIZE     (257u)
+#endif
+#endif
+
+// UART bytes coalesced in the socket before they are flushed
+#if !defined(UART2TCPBRIDGE_FLUSH_SIZE)
+#define UART2TCPBRIDGE_FLUSH_SIZE       (536u)
+#endif
+
+// Longest time the first of them waits for the others before the flush
+#if !defined(UART2TCPBRIDGE_FLUSH_TIMEOUT)
+#define UART2TCPBRIDGE_FLUSH_TIMEOUT    (TICK_SECOND/100)
+#endif
+
 void UART2TCPBridgeInit(void);
 void UART2TCPBridgeTask(void);
 void UART2TCPBridgeISR(void);
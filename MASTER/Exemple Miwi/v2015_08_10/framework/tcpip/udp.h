@@ -74,8 +74,19 @@ typedef struct {
         unsigned char bRemoteHostIsROM: 1; // Remote host is stored in ROM
     } flags;
     uint16_t eventTime;
+    uint8_t rxFirst; // Oldest datagram queued on this socket
+    uint8_t rxLast; // Newest datagram queued on this socket
+    uint8_t rxCount; // Number of datagrams queued on this socket
 } UDP_SOCKET_INFO;
 
+// A datagram queued on a socket, see UDPGetDatagrams()
+typedef struct {
+    NODE_INFO remoteNode; // IP and MAC of the sender
+    UDP_PORT remotePort; // Port of the sender
+    uint16_t wLength; // Number of data bytes
+    PTR_BASE ptrData; // Data in the MAC RX buffer
+} UDP_DATAGRAM;
+
 #define INVALID_UDP_SOCKET (0xffu) // Indicates a UDP socket that is not valid
 #define INVALID_UDP_PORT (0ul) // Indicates a UDP port that is not valid
 
@@ -155,6 +166,12 @@ uint16_t UDPGetArray(uint8_t *cData, uint16_t wDataLen);
 void UDPDiscard(void);
 bool UDPIsOpened(UDP_SOCKET socket);
 
+uint8_t UDPGetDatagrams(UDP_SOCKET s, UDP_DATAGRAM *dgrams, uint8_t count);
+uint16_t UDPGetDatagramArray(UDP_DATAGRAM *dgram, uint16_t wOffset, uint8_t *cData, uint16_t wDataLen);
+void UDPReleaseDatagrams(UDP_SOCKET s, uint8_t count);
+void UDPReleaseRx(void);
+bool UDPIsRxQueueFull(void);
+
 /*****************************************************************************
   Function:
     UDP_SOCKET UDPOpen(UDP_PORT localPort, NODE_INFO* remoteNode,
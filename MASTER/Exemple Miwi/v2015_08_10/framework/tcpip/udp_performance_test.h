@@ -42,5 +42,6 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define __UDPPERFORMANCETEST_H_
 
 void UDPPerformanceTask(void);
+void UDPPerformanceGetRxStats(uint32_t *received, uint32_t *lost);
 
 #endif
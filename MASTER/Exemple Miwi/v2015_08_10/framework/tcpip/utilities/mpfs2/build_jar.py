@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+#
+# Rebuilds mpfs2.jar from the sources in src/mpfs2_java with a JDK, without
+# NetBeans or Ant:
+#
+#   build_jar.py [javac]
+#
+# The swing-layout, AbsoluteLayout and beans-binding classes that the GUI
+# needs are not in the tree: they are kept from the mpfs2.jar in place, and
+# the sources are compiled against them.  The MicrochipMPFS classes and
+# Resource/ are replaced by the ones of src/mpfs2_java/src.  The classes
+# target Java 8 (--release 8), the oldest release that current JDKs build.
+
+import os
+import subprocess
+import sys
+import tempfile
+import zipfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+JAR = os.path.join(HERE, 'mpfs2.jar')
+SOURCES = os.path.join(HERE, 'src', 'mpfs2_java', 'src')
+REPLACED = ('MicrochipMPFS/', 'Resource/')
+
+
+def tree(root):
+    """Files under root, as (path, name in the jar)."""
+    for parent, _, names in os.walk(root):
+        for name in sorted(names):
+            path = os.path.join(parent, name)
+            yield path, os.path.relpath(path, root).replace(os.sep, '/')
+
+
+def main():
+    javac = sys.argv[1] if len(sys.argv) > 1 else 'javac'
+    with tempfile.TemporaryDirectory() as classes:
+        java = [path for path, name in tree(os.path.join(SOURCES, 'MicrochipMPFS')) if name.endswith('.java')]
+        result = subprocess.run([javac, '--release', '8', '-encoding', 'UTF-8', '-nowarn', '-cp', JAR,
+                                 '-d', classes] + java)
+        if result.returncode != 0:
+            sys.exit('build_jar: %s failed' % javac)
+
+        with zipfile.ZipFile(JAR) as old, zipfile.ZipFile(JAR + '.new', 'w', zipfile.ZIP_DEFLATED) as new:
+            kept = [entry for entry in old.infolist() if not entry.filename.startswith(REPLACED)]
+            for entry in kept:
+                new.writestr(entry, old.read(entry))
+            built = list(tree(classes))
+            built += [(path, 'Resource/' + name) for path, name in tree(os.path.join(SOURCES, 'Resource'))]
+            for path, name in built:
+                new.write(path, name)
+    os.replace(JAR + '.new', JAR)
+    print('build_jar: mpfs2.jar: %d library entries kept, %d built' % (len(kept), len(built)))
+
+
+if __name__ == '__main__':
+    main()
@@ -52,6 +52,7 @@ public class AdvanceSettings extends javax.swing.JDialog {
     public  int reserveBlock=64;
     public  String DynVarStr = "*.htm, *.html, *.cgi, *.xml";
     public  String NoCompStr = "*.inc, snmp.bib";
+    public  String CacheStr = "*.css=3600, *.js=3600, *.gif=86400, *.png=86400, *.jpg=86400";
 
     /** Creates new form AdvanceSettings */
     public AdvanceSettings(javax.swing.JFrame parent, boolean modal) {
@@ -71,6 +72,7 @@ public class AdvanceSettings extends javax.swing.JDialog {
         AdvanceSettingKeyEventActionIntialization();
         DynVarStr = txtDynFiles.getText();
         NoCompStr = txtDoNotCompress.getText();
+        CacheStr = txtCacheTypes.getText();
         
 //        Action  ESCactionListener = new AbstractAction () {
 //          public void actionPerformed(ActionEvent actionEvent) {
@@ -103,6 +105,8 @@ public class AdvanceSettings extends javax.swing.JDialog {
         txtDynFiles = new javax.swing.JTextField();
         lblDoNotCompress = new javax.swing.JLabel();
         txtDoNotCompress = new javax.swing.JTextField();
+        lblCacheTypes = new javax.swing.JLabel();
+        txtCacheTypes = new javax.swing.JTextField();
         lblTcpIpHelp = new javax.swing.JLabel();
         btnOK = new javax.swing.JButton();
         btnDefault = new javax.swing.JButton();
@@ -127,6 +131,12 @@ public class AdvanceSettings extends javax.swing.JDialog {
         txtDoNotCompress.setFont(new java.awt.Font("Microsoft Sans Serif", 0, 11)); // NOI18N
         txtDoNotCompress.setText("*.inc, snmp.bib");
 
+        lblCacheTypes.setFont(new java.awt.Font("Microsoft Sans Serif", 0, 11)); // NOI18N
+        lblCacheTypes.setText("Cache Max-Age (sec):");
+
+        txtCacheTypes.setFont(new java.awt.Font("Microsoft Sans Serif", 0, 11)); // NOI18N
+        txtCacheTypes.setText("*.css=3600, *.js=3600, *.gif=86400, *.png=86400, *.jpg=86400");
+
         lblTcpIpHelp.setFont(new java.awt.Font("Microsoft Sans Serif", 0, 11)); // NOI18N
         lblTcpIpHelp.setText("( Reserve block is only configured in tcpip_config.h. )");
 
@@ -179,6 +189,12 @@ public class AdvanceSettings extends javax.swing.JDialog {
                     .addGroup(layout.createSequentialGroup()
                         .addContainerGap()
                         .addComponent(txtDoNotCompress, javax.swing.GroupLayout.PREFERRED_SIZE, 260, javax.swing.GroupLayout.PREFERRED_SIZE))
+                    .addGroup(layout.createSequentialGroup()
+                        .addContainerGap()
+                        .addComponent(lblCacheTypes, javax.swing.GroupLayout.PREFERRED_SIZE, 150, javax.swing.GroupLayout.PREFERRED_SIZE))
+                    .addGroup(layout.createSequentialGroup()
+                        .addContainerGap()
+                        .addComponent(txtCacheTypes, javax.swing.GroupLayout.PREFERRED_SIZE, 260, javax.swing.GroupLayout.PREFERRED_SIZE))
                     .addGroup(layout.createSequentialGroup()
                         .addContainerGap()
                         .addComponent(lblTcpIpHelp, javax.swing.GroupLayout.DEFAULT_SIZE, javax.swing.GroupLayout.DEFAULT_SIZE, Short.MAX_VALUE)))
@@ -195,6 +211,10 @@ public class AdvanceSettings extends javax.swing.JDialog {
                 .addComponent(lblDoNotCompress, javax.swing.GroupLayout.PREFERRED_SIZE, 20, javax.swing.GroupLayout.PREFERRED_SIZE)
                 .addPreferredGap(javax.swing.LayoutStyle.ComponentPlacement.RELATED)
                 .addComponent(txtDoNotCompress, javax.swing.GroupLayout.PREFERRED_SIZE, javax.swing.GroupLayout.DEFAULT_SIZE, javax.swing.GroupLayout.PREFERRED_SIZE)
+                .addPreferredGap(javax.swing.LayoutStyle.ComponentPlacement.RELATED)
+                .addComponent(lblCacheTypes, javax.swing.GroupLayout.PREFERRED_SIZE, 20, javax.swing.GroupLayout.PREFERRED_SIZE)
+                .addPreferredGap(javax.swing.LayoutStyle.ComponentPlacement.RELATED)
+                .addComponent(txtCacheTypes, javax.swing.GroupLayout.PREFERRED_SIZE, javax.swing.GroupLayout.DEFAULT_SIZE, javax.swing.GroupLayout.PREFERRED_SIZE)
                 .addPreferredGap(javax.swing.LayoutStyle.ComponentPlacement.UNRELATED)
                 .addComponent(lblTcpIpHelp, javax.swing.GroupLayout.PREFERRED_SIZE, 20, javax.swing.GroupLayout.PREFERRED_SIZE)
                 .addPreferredGap(javax.swing.LayoutStyle.ComponentPlacement.RELATED)
@@ -214,6 +234,8 @@ public class AdvanceSettings extends javax.swing.JDialog {
         txtDynFiles.setText(DynVarStr);
         NoCompStr = txtDoNotCompress.getText();
         txtDoNotCompress.setText(NoCompStr);
+        CacheStr = txtCacheTypes.getText();
+        txtCacheTypes.setText(CacheStr);
         // TODO add your handling code here:
        /* if(radBtnMPFS2.isSelected() == true)
         {
@@ -240,8 +262,10 @@ public class AdvanceSettings extends javax.swing.JDialog {
         defaultAdvanceSetting();
         DynVarStr = "*.htm, *.html, *.cgi, *.xml";
         NoCompStr = "*.inc, snmp.bib";
+        CacheStr = "*.css=3600, *.js=3600, *.gif=86400, *.png=86400, *.jpg=86400";
         txtDynFiles.setText(DynVarStr);
         txtDoNotCompress.setText(NoCompStr);
+        txtCacheTypes.setText(CacheStr);
         /*
         radBtnMPFS2.setSelected(true);
         txtResvBlk.setText("64");
@@ -255,6 +279,7 @@ public class AdvanceSettings extends javax.swing.JDialog {
         // TODO add your handling code here:
         txtDynFiles.setText(DynVarStr);
         txtDoNotCompress.setText(NoCompStr);
+        txtCacheTypes.setText(CacheStr);
 
         /*
         if(getRadBtnMpfs2Status())
@@ -427,6 +452,12 @@ private void btnCancelActionPerformed(java.awt.event.ActionEvent evt) {//GEN-FIR
                 "read by the device.Files that need to be <br>" +
                 "accessed locally should not be compressed.<br>" +
                 "Enter file names or extentions."+"</body></html>");
+
+        txtCacheTypes.setToolTipText(infoString+"Browsers keep these files for" +
+                " the given <br>number of seconds before asking again, <br>" +
+                "other static files for HTTP_CACHE_LEN.<br>" +
+                "Enter file names or extensions with <br>" +
+                "their time, ex: *.png=86400."+"</body></html>");
     }
 
     private void AdvanceSettingKeyEventActionIntialization()
@@ -505,9 +536,11 @@ private void btnCancelActionPerformed(java.awt.event.ActionEvent evt) {//GEN-FIR
     private javax.swing.JButton btnDefault;
     private javax.swing.JButton btnOK;
     private javax.swing.ButtonGroup buttonGroup1;
+    private javax.swing.JLabel lblCacheTypes;
     private javax.swing.JLabel lblDoNotCompress;
     private javax.swing.JLabel lblDynFiles;
     private javax.swing.JLabel lblTcpIpHelp;
+    private javax.swing.JTextField txtCacheTypes;
     private javax.swing.JTextField txtDoNotCompress;
     private javax.swing.JTextField txtDynFiles;
     // End of variables declaration//GEN-END:variables
@@ -55,6 +55,7 @@ public class MPFS2Lib //: MPFS2Writer
     public String SourcePath;
     private Collection<String> dynamicTypes;
     private Collection<String> nonGZipTypes;
+    private Map<String,Long> cacheTypes;
     private DynVar dynVarParser;
     public List<String> log;
     public List<MPFSFileRecord> files;
@@ -64,6 +65,7 @@ public class MPFS2Lib //: MPFS2Writer
     public DataOutputStream data_out;
     public int MPFS2_FLAG_ISZIPPED = 0x0001;
     public int MPFS2_FLAG_HASINDEX = 0x0002;
+    public int MPFS2_FLAG_MAXAGE = 0x0004;
     //public static long ImageLength=0;
     public static String ASCIILine;
     public static String emptyStr;
@@ -148,6 +150,7 @@ public class MPFS2Lib //: MPFS2Writer
         //this.SourcePath = sourcePath;
         this.dynamicTypes = new ArrayList<String>();
         this.nonGZipTypes = new ArrayList<String>();
+        this.cacheTypes = new LinkedHashMap<String,Long>();
         this.log = new ArrayList<String>();
         this.files = new LinkedList<MPFSFileRecord>();
         this.dynVarParser = new MicrochipMPFS.DynVar(localPath);
@@ -189,6 +192,33 @@ public class MPFS2Lib //: MPFS2Writer
         }
     }
 
+    /// <summary>
+    /// Sets a comma-separated list of types with their Cache-Control
+    /// max-age in seconds, ex: "*.css=3600, *.png=86400"
+    /// </summary>
+    public void CacheTypes(String cacheFiles)
+    {
+        String[] str = cacheFiles.split(",");
+        this.cacheTypes.clear();
+        for(String s:str)
+        {
+            int eq = s.indexOf('=');
+            if(eq < 0)
+                continue;
+            String s_trimmed = s.substring(0, eq).replace('*',' ').trim();
+            try
+            {
+                long maxAge = Long.parseLong(s.substring(eq + 1).trim());
+                if(s_trimmed.length() > 0 && maxAge >= 0 && maxAge <= 0xffffffffL)
+                    this.cacheTypes.put(s_trimmed, maxAge);
+            }
+            catch(NumberFormatException e)
+            {
+                log.add("\r\nWARNING: Ignored cache setting " + s.trim());
+            }
+        }
+    }
+
     /// <summary>
     /// Adds a file to the MPFS image
     /// </summary>
@@ -225,6 +255,14 @@ public class MPFS2Lib //: MPFS2Writer
         MPFSFileRecord newFile = new MPFSFileRecord();
         newFile.SetFileName(imageName);//FileName = imageName;
         newFile.SetFiledate(file.lastModified());
+        for(Map.Entry<String,Long> type : this.cacheTypes.entrySet())
+        {
+            if(localName.endsWith(type.getKey()))
+            {
+                newFile.maxAge = type.getValue();
+                break;
+            }
+        }
 
         // Read the data in
         try{
@@ -442,6 +480,9 @@ public class MPFS2Lib //: MPFS2Writer
 
         // Write any index files that have changed
         indexUpdated = dynVarParser.WriteIndices();
+
+        // Sort the hash table so that the firmware can binary search it
+        SortByNameHash();
       
         // Determine address of each file and string
         int numFiles = (int)files.size();
@@ -496,6 +537,44 @@ public class MPFS2Lib //: MPFS2Writer
        return true;
     }
 
+    /// <summary>
+    /// Sorts the files by name hash.  An index file has no name, and is
+    /// opened as the file after its own, so it stays there and takes the
+    /// hash of its file.
+    /// </summary>
+    private void SortByNameHash()
+    {
+        List<List<MPFSFileRecord>> groups = new ArrayList<List<MPFSFileRecord>>();
+        for (MPFSFileRecord file : files)
+        {
+            if (file.isIndex && groups.size() > 0)
+            {
+                List<MPFSFileRecord> group = groups.get(groups.size() - 1);
+                file.nameHash = group.get(0).nameHash;
+                group.add(file);
+            }
+            else
+            {
+                List<MPFSFileRecord> group = new ArrayList<MPFSFileRecord>();
+                group.add(file);
+                groups.add(group);
+            }
+        }
+
+        // The sort is stable, files with the same hash keep their order
+        Collections.sort(groups, new Comparator<List<MPFSFileRecord>>()
+        {
+            public int compare(List<MPFSFileRecord> a, List<MPFSFileRecord> b)
+            {
+                return (a.get(0).nameHash & 0xffff) - (b.get(0).nameHash & 0xffff);
+            }
+        });
+
+        files.clear();
+        for (List<MPFSFileRecord> group : groups)
+            files.addAll(group);
+    }
+
     private void WriteImage(MPFS2Writer x)
     {
         //byte[] hashByte= new byte[2];
@@ -523,12 +602,16 @@ public class MPFS2Lib //: MPFS2Writer
             w.Write(file.fileSizeLen);
             epoch = file.fileDate/1000;
             w.Write((int)(epoch));
-            w.Write((int)0);
+            // The microtime field carries the max-age, the server reads it
+            // when MPFS2_FLAG_MAXAGE is set
+            w.Write((int)(file.maxAge >= 0 ? file.maxAge : 0));
             flags = 0;
             if (file.hasIndex)
                 flags |= MPFS2_FLAG_HASINDEX;
             if (file.isZipped)
                 flags |= MPFS2_FLAG_ISZIPPED;
+            if (file.maxAge >= 0)
+                flags |= MPFS2_FLAG_MAXAGE;
             w.Write((short)(flags));
             timeVal=(long)621355968000000000L;
         }
@@ -1105,6 +1188,7 @@ public void MDDWriter(String localPath)
     int counter = 0;
     int loopCntr = 0;
     int numFileRecrds = 0;
+    int recordOffset = 0;
 
     FileRecrd = new FilesRecordWriter(localPath);
     DynVarRecrd = new DynamicVarRecordWriter(localPath);
@@ -1118,6 +1202,10 @@ public void MDDWriter(String localPath)
       loopCntr=0;
       if(file.dynVarCntr >0)
       {
+        // DynVar set the offsets in parse order, the records are written
+        // in the order of the sorted files
+        file.fileRecordOffset = recordOffset;
+        recordOffset += file.fileRecordLength;
         FileRcrdList.add(new FileRecord((short)file.nameHash,
                     (int)file.fileRecordOffset,(int)file.dynVarCntr));
         numFileRecrds++;
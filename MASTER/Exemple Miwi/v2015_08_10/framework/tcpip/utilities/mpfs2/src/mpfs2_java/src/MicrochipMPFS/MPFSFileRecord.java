@@ -55,6 +55,7 @@ public class MPFSFileRecord
     public boolean hasIndex;
     public boolean isIndex;
     public boolean isZipped;
+    public long maxAge;/*Cache-Control max-age in seconds, -1 for the server's default*/
     public int dynVarCntr=0;/*Number of Dynamic Variables in the file*/
     public Vector<Byte> dynVarOffsetAndIndexID = new Vector<Byte>(8,8);/*Location of dynamic var and its ID*/
     public int fileRecordOffset;/* Byte location in the Record file where this file record/information is written from*/
@@ -70,6 +71,7 @@ public class MPFSFileRecord
         hasIndex = false;
         isIndex = false;
         isZipped = false;
+        maxAge = -1;
         dynVarCntr=0;
         //data = new Vector<Byte>(0);
         //Calendar cl = Calendar.getInstance();
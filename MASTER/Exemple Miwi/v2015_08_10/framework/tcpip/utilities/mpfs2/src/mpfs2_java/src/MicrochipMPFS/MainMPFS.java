@@ -767,6 +767,7 @@ public class MainMPFS extends javax.swing.JFrame {
             builder.MPFS2Builder(txtProjectDir.getText(),txtProjectImageName.getText());
             builder.DynamicTypes(advSetting.DynVarStr);
             builder.NonGZipTypes(advSetting.NoCompStr);
+            builder.CacheTypes(advSetting.CacheStr);
             lblMessage.setText("Adding source files to image...");
             builder.AddDirectory(TextSrcDir.getText());
         }
@@ -1818,7 +1819,8 @@ public class MainMPFS extends javax.swing.JFrame {
                     "    /mpfs2\t\t(/2)\t: MPFS2 format (Default)\n" +
                 //    "    /reserve #\t\t(/r #)\t: Reserved space for Classic BINs (Default 64)\n" +
                     "    /html \"...\"\t\t(/h)\t: Dynamic file types (\"*.htm, *.html, *.xml, *.cgi\")\n" +
-                    "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n\n" +
+                    "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n" +
+                    "    /cache \"...\"\t(/k)\t: Cache max-age (sec) of types (\"*.css=3600, *.js=3600, *.gif=86400, *.png=86400, *.jpg=86400\")\n\n" +
                     "SourceDir, ProjectDir, and OutputFile are required and should be enclosed in quotes.\n" +
                     "OutputFile is placed relative to ProjectDir and *CANNOT* be a full path name.");
                 return;
@@ -1842,6 +1844,7 @@ public class MainMPFS extends javax.swing.JFrame {
             int reserveBlock = 64;
             String htmlTypes = "*.htm, *.html, *.xml, *.cgi";
             String noGZipTypes = "*.inc, snmp.bib";
+            String cacheTypes = "*.css=3600, *.js=3600, *.gif=86400, *.png=86400, *.jpg=86400";
 
             // Process each command line argument
             for(int i =0; i < (args.length - 3); i++)
@@ -1870,6 +1873,8 @@ public class MainMPFS extends javax.swing.JFrame {
                         htmlTypes = args[++i];
                 else if(arg.compareTo("/xgzip")==0 || arg.compareTo("/z")==0)
                         noGZipTypes = args[++i];
+                else if(arg.compareTo("/cache")==0 || arg.compareTo("/k")==0)
+                        cacheTypes = args[++i];
                 else
                 {
                     System.out.println("The command-line option \""+args[i]+"\" was not recognized.");
@@ -1882,6 +1887,7 @@ public class MainMPFS extends javax.swing.JFrame {
                 builder.MPFS2Builder(projectSourceCodeDir,outputFile);
                 builder.DynamicTypes(htmlTypes);
                 builder.NonGZipTypes(noGZipTypes);
+                builder.CacheTypes(cacheTypes);
                 // Add the files to the image and generate the image
                 builder.AddDirectory(sourceDir);
                 genResult = builder.Generate(fmt);
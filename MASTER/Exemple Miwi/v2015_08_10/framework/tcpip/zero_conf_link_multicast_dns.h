@@ -49,6 +49,14 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 
 #define MDNS_DEFAULT_SERVICE_NAME "Microchip Demo"
 
+// Number of host names of other devices, with their IP address, that are
+// kept for mDNSResolve().  They are learnt from the mDNS responses seen on
+// the network and expire with the TTL of their record.  A host looked up
+// that does not answer also takes an entry, which spaces its queries.
+#if !defined(MDNS_CACHE_SIZE)
+#define MDNS_CACHE_SIZE (4u)
+#endif
+
 // define the debugging levels
 #include "tcpip/src/zero_conf_helper.h"
 
@@ -109,6 +117,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 void mDNSInitialize(const char *szHostName);
 void mDNSProcess(void);
 void mDNSFillHostRecord(void);
+bool mDNSResolve(const char *szHostName, IP_ADDR *pIP);
 
 //void DisplayHostName(uint8_t *HostName);
 